@@ -0,0 +1,626 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief ConfigMgr hot path benchmarks
+ *
+ * Runs the C APIs against in-process fake etcd servers, one insecure for
+ * dev mode and one serving TLS for prod mode, so that the real gRPC client
+ * path is measured without a provisioned etcd. Every benchmark reports the
+ * number of heap allocations per operation made by the calling thread.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <condition_variable>
+#include <benchmark/benchmark.h>
+
+// gRPC headers must come before the ConfigMgr ones, which define macros
+// such as NAME clashing with protobuf identifiers
+#include "eii/config_manager/kv_store_plugin/etcd_client/etcd_client.h"
+#include "fake_etcd_server.h"
+#include "eii/config_manager/cfgmgr.h"
+#include "eii/config_manager/cfgmgr_util.h"
+#include "eii/config_manager/cfgmgr_view.h"
+#include "eii/config_manager/cfgmgr_json.h"
+
+#define BENCH_APP_NAME      "BenchApp"
+#define BENCH_PUB_APP_NAME  "BenchPublisher"
+#define BENCH_SERV_APP_NAME "BenchServer"
+#define BENCH_WATCH_KEY     "/BenchApp/watch"
+
+// Z85 encoded curve keys are 40 characters long
+#define BENCH_CURVE_KEY     "0123456789012345678901234567890123456789"
+
+#ifndef CFGMGR_BENCH_CERTS_DIR
+#define CFGMGR_BENCH_CERTS_DIR "./certs"
+#endif
+
+//
+// Allocation counting: malloc, calloc and realloc are interposed for the
+// whole process, only the allocations of threads which enabled counting
+// are recorded
+//
+
+static std::atomic<uint64_t> alloc_count(0);
+static thread_local bool count_allocs = false;
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    if (count_allocs) {
+        alloc_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+    if (count_allocs) {
+        alloc_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (count_allocs) {
+        alloc_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+}
+
+/**
+ * Counts the allocations of the current thread from construction until
+ * report(), which adds them to the benchmark as allocs_per_op
+ */
+class AllocationCounter {
+    public:
+        AllocationCounter() {
+            start = alloc_count.load(std::memory_order_relaxed);
+            count_allocs = true;
+        }
+
+        void report(benchmark::State& state) {
+            count_allocs = false;
+            uint64_t allocs = alloc_count.load(std::memory_order_relaxed) - start;
+            state.counters["allocs_per_op"] = benchmark::Counter(
+                    (double) allocs, benchmark::Counter::kAvgIterations);
+        }
+
+    private:
+        uint64_t start;
+};
+
+//
+// Fake etcd servers shared by all benchmarks
+//
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+class BenchEnv {
+    public:
+        BenchEnv() : seeded_publishers(0) {
+            dev_port = dev_server.start();
+
+            std::string certs_dir = CFGMGR_BENCH_CERTS_DIR;
+            char* certs_env = getenv("CFGMGR_BENCH_CERTS_DIR");
+            if (certs_env != NULL) {
+                certs_dir = certs_env;
+            }
+            cert_file = certs_dir + "/client_certificate.pem";
+            key_file = certs_dir + "/client_key.pem";
+            ca_file = certs_dir + "/ca_certificate.pem";
+
+            grpc::SslServerCredentialsOptions ssl_opts(
+                    GRPC_SSL_REQUEST_AND_REQUIRE_CLIENT_CERTIFICATE_AND_VERIFY);
+            grpc::SslServerCredentialsOptions::PemKeyCertPair key_cert = {
+                read_file(certs_dir + "/server_key.pem"),
+                read_file(certs_dir + "/server_certificate.pem")
+            };
+            ssl_opts.pem_root_certs = read_file(ca_file);
+            ssl_opts.pem_key_cert_pairs.push_back(key_cert);
+            prod_port = -1;
+            if (!key_cert.private_key.empty() && !ssl_opts.pem_root_certs.empty()) {
+                prod_port = prod_server.start("127.0.0.1:0", grpc::SslServerCredentials(ssl_opts));
+            }
+
+            dev_writer = new EtcdClient(dev_server.in_process_channel());
+            if (prod_port > 0) {
+                prod_writer = new EtcdClient(prod_server.in_process_channel());
+            } else {
+                prod_writer = NULL;
+            }
+            setenv("AppName", BENCH_APP_NAME, 1);
+            setenv("C_LOG_LEVEL", "ERROR", 1);
+        }
+
+        ~BenchEnv() {
+            delete dev_writer;
+            delete prod_writer;
+        }
+
+        /**
+        * Points the ConfigMgr env at the server of the given mode
+        * @return false if the mode is not available
+        */
+        bool use_mode(bool dev_mode) {
+            if (dev_mode) {
+                setenv("DEV_MODE", "true", 1);
+                setenv("ETCD_HOST", "127.0.0.1", 1);
+                setenv("ETCD_CLIENT_PORT", std::to_string(dev_port).c_str(), 1);
+                return dev_port > 0;
+            }
+            setenv("DEV_MODE", "false", 1);
+            setenv("ETCD_HOST", "localhost", 1);
+            setenv("ETCD_CLIENT_PORT", std::to_string(prod_port).c_str(), 1);
+            setenv("CONFIGMGR_CERT", cert_file.c_str(), 1);
+            setenv("CONFIGMGR_KEY", key_file.c_str(), 1);
+            setenv("CONFIGMGR_CACERT", ca_file.c_str(), 1);
+            return prod_port > 0;
+        }
+
+        /**
+        * Stores the config, keys and an interfaces document with
+        * num_publishers publishers and subscribers, one server and one
+        * client, in both servers
+        */
+        void seed(int num_publishers) {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (seeded_publishers == num_publishers) {
+                return;
+            }
+            std::string interfaces = make_interfaces(num_publishers);
+            for (EtcdClient* writer : {dev_writer, prod_writer}) {
+                if (writer == NULL) {
+                    continue;
+                }
+                put(writer, "/GlobalEnv/", "{\"C_LOG_LEVEL\": \"ERROR\"}");
+                put(writer, "/" BENCH_APP_NAME "/config", "{\"loop_video\": true, \"max_workers\": 4}");
+                put(writer, "/" BENCH_APP_NAME "/interfaces", interfaces);
+                put(writer, "/" BENCH_APP_NAME "/private_key", BENCH_CURVE_KEY);
+                put(writer, "/Publickeys/" BENCH_APP_NAME, BENCH_CURVE_KEY);
+                put(writer, "/Publickeys/" BENCH_PUB_APP_NAME, BENCH_CURVE_KEY);
+                put(writer, "/Publickeys/" BENCH_SERV_APP_NAME, BENCH_CURVE_KEY);
+            }
+            seeded_publishers = num_publishers;
+        }
+
+        void put(EtcdClient* writer, std::string key, std::string value) {
+            writer->put(key, value);
+        }
+
+        EtcdClient* dev_writer;
+        EtcdClient* prod_writer;
+
+    private:
+        static std::string make_interfaces(int num_publishers) {
+            std::ostringstream pubs;
+            std::ostringstream subs;
+            for (int i = 0; i < num_publishers; i++) {
+                std::string sep = (i == 0) ? "" : ",";
+                pubs << sep << "{\"Name\": \"pub" << i << "\", \"Type\": \"zmq_tcp\", "
+                     << "\"EndPoint\": \"127.0.0.1:" << (20000 + i) << "\", "
+                     << "\"Topics\": [\"topic" << i << "\"], \"AllowedClients\": [\"*\"]}";
+                subs << sep << "{\"Name\": \"sub" << i << "\", \"Type\": \"zmq_tcp\", "
+                     << "\"EndPoint\": \"127.0.0.1:" << (30000 + i) << "\", "
+                     << "\"PublisherAppName\": \"" BENCH_PUB_APP_NAME "\", "
+                     << "\"Topics\": [\"topic" << i << "\"]}";
+            }
+            std::ostringstream out;
+            out << "{\"Publishers\": [" << pubs.str() << "], "
+                << "\"Subscribers\": [" << subs.str() << "], "
+                << "\"Servers\": [{\"Name\": \"server0\", \"Type\": \"zmq_tcp\", "
+                << "\"EndPoint\": \"127.0.0.1:40000\", \"AllowedClients\": [\"*\"]}], "
+                << "\"Clients\": [{\"Name\": \"client0\", \"Type\": \"zmq_tcp\", "
+                << "\"EndPoint\": \"127.0.0.1:40000\", \"ServerAppName\": \"" BENCH_SERV_APP_NAME "\"}]}";
+            return out.str();
+        }
+
+        FakeEtcdServer dev_server;
+        FakeEtcdServer prod_server;
+        int dev_port;
+        int prod_port;
+        std::string cert_file;
+        std::string key_file;
+        std::string ca_file;
+        std::mutex mtx;
+        int seeded_publishers;
+};
+
+static BenchEnv* bench_env() {
+    static BenchEnv* env = new BenchEnv();
+    return env;
+}
+
+static const char* mode_label(bool dev_mode) {
+    return dev_mode ? "dev" : "prod";
+}
+
+//
+// Benchmarks
+//
+
+static void BM_Initialize(benchmark::State& state) {
+    bool dev_mode = state.range(0) == 0;
+    BenchEnv* env = bench_env();
+    if (!env->use_mode(dev_mode)) {
+        state.SkipWithError("Fake etcd server not available for this mode");
+        return;
+    }
+    env->seed(8);
+    state.SetLabel(mode_label(dev_mode));
+
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        cfgmgr_ctx_t* ctx = cfgmgr_initialize();
+        if (ctx == NULL) {
+            state.SkipWithError("cfgmgr_initialize() failed");
+            break;
+        }
+        cfgmgr_destroy(ctx);
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_Initialize)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+static void BM_GetPublisherByName(benchmark::State& state) {
+    int num_publishers = (int) state.range(0);
+    BenchEnv* env = bench_env();
+    env->use_mode(true);
+    env->seed(num_publishers);
+    cfgmgr_ctx_t* ctx = cfgmgr_initialize();
+    if (ctx == NULL) {
+        state.SkipWithError("cfgmgr_initialize() failed");
+        return;
+    }
+    // Last publisher, the worst case of a linear scan
+    std::string name = "pub" + std::to_string(num_publishers - 1);
+
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        cfgmgr_interface_t* iface = cfgmgr_get_publisher_by_name(ctx, name.c_str());
+        if (iface == NULL) {
+            state.SkipWithError("cfgmgr_get_publisher_by_name() failed");
+            break;
+        }
+        cfgmgr_interface_destroy(iface);
+    }
+    allocs.report(state);
+    cfgmgr_destroy(ctx);
+}
+BENCHMARK(BM_GetPublisherByName)->RangeMultiplier(4)->Range(1, 256);
+
+static cfgmgr_interface_t* get_interface(cfgmgr_ctx_t* ctx, cfgmgr_iface_type_t type) {
+    switch (type) {
+        case CFGMGR_PUBLISHER:  return cfgmgr_get_publisher_by_index(ctx, 0);
+        case CFGMGR_SUBSCRIBER: return cfgmgr_get_subscriber_by_index(ctx, 0);
+        case CFGMGR_SERVER:     return cfgmgr_get_server_by_index(ctx, 0);
+        case CFGMGR_CLIENT:     return cfgmgr_get_client_by_index(ctx, 0);
+        default:                return NULL;
+    }
+}
+
+static void BM_GetMsgbusConfig(benchmark::State& state) {
+    static const char* type_labels[] = {"publisher", "subscriber", "server", "client"};
+    cfgmgr_iface_type_t type = (cfgmgr_iface_type_t) state.range(0);
+    bool dev_mode = state.range(1) == 0;
+    BenchEnv* env = bench_env();
+    if (!env->use_mode(dev_mode)) {
+        state.SkipWithError("Fake etcd server not available for this mode");
+        return;
+    }
+    env->seed(8);
+    state.SetLabel(std::string(type_labels[type]) + "/" + mode_label(dev_mode));
+
+    cfgmgr_ctx_t* ctx = cfgmgr_initialize();
+    if (ctx == NULL) {
+        state.SkipWithError("cfgmgr_initialize() failed");
+        return;
+    }
+    cfgmgr_interface_t* iface = get_interface(ctx, type);
+    if (iface == NULL) {
+        state.SkipWithError("Failed to get interface");
+        cfgmgr_destroy(ctx);
+        return;
+    }
+
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        config_t* config = cfgmgr_get_msgbus_config(iface);
+        if (config == NULL) {
+            state.SkipWithError("cfgmgr_get_msgbus_config() failed");
+            break;
+        }
+        config_destroy(config);
+    }
+    allocs.report(state);
+    cfgmgr_interface_destroy(iface);
+    cfgmgr_destroy(ctx);
+}
+BENCHMARK(BM_GetMsgbusConfig)->ArgsProduct({{CFGMGR_PUBLISHER, CFGMGR_SUBSCRIBER,
+                                             CFGMGR_SERVER, CFGMGR_CLIENT}, {0, 1}});
+
+// Builds the msgbus config of every interface with a cold cache, one
+// interface at a time (0) or through the bulk API (1)
+static void BM_GetAllMsgbusConfigs(benchmark::State& state) {
+    bool bulk = state.range(0) == 1;
+    bool dev_mode = state.range(1) == 0;
+    BenchEnv* env = bench_env();
+    if (!env->use_mode(dev_mode)) {
+        state.SkipWithError("Fake etcd server not available for this mode");
+        return;
+    }
+    env->seed(8);
+    state.SetLabel(std::string(bulk ? "bulk" : "per-interface") + "/" + mode_label(dev_mode));
+
+    cfgmgr_ctx_t* ctx = cfgmgr_initialize();
+    if (ctx == NULL) {
+        state.SkipWithError("cfgmgr_initialize() failed");
+        return;
+    }
+    std::vector<cfgmgr_interface_t*> ifaces;
+    for (int i = 0; i < cfgmgr_get_num_publishers(ctx); i++) {
+        ifaces.push_back(cfgmgr_get_publisher_by_index(ctx, i));
+    }
+    for (int i = 0; i < cfgmgr_get_num_subscribers(ctx); i++) {
+        ifaces.push_back(cfgmgr_get_subscriber_by_index(ctx, i));
+    }
+    for (int i = 0; i < cfgmgr_get_num_servers(ctx); i++) {
+        ifaces.push_back(cfgmgr_get_server_by_index(ctx, i));
+    }
+    for (int i = 0; i < cfgmgr_get_num_clients(ctx); i++) {
+        ifaces.push_back(cfgmgr_get_client_by_index(ctx, i));
+    }
+
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        cfgmgr_msgbus_cache_invalidate(ctx->msgbus_cache);
+        if (bulk) {
+            cfgmgr_msgbus_configs_t* configs = cfgmgr_get_all_msgbus_configs(ctx);
+            if (configs == NULL) {
+                state.SkipWithError("cfgmgr_get_all_msgbus_configs() failed");
+                break;
+            }
+            cfgmgr_msgbus_configs_destroy(configs);
+            continue;
+        }
+        bool failed = false;
+        for (cfgmgr_interface_t* iface : ifaces) {
+            config_t* config = cfgmgr_get_msgbus_config(iface);
+            if (config == NULL) {
+                failed = true;
+                break;
+            }
+            config_destroy(config);
+        }
+        if (failed) {
+            state.SkipWithError("cfgmgr_get_msgbus_config() failed");
+            break;
+        }
+    }
+    allocs.report(state);
+    for (cfgmgr_interface_t* iface : ifaces) {
+        cfgmgr_interface_destroy(iface);
+    }
+    cfgmgr_destroy(ctx);
+}
+BENCHMARK(BM_GetAllMsgbusConfigs)->ArgsProduct({{0, 1}, {0, 1}});
+
+static void BM_GetIpcConfig(benchmark::State& state) {
+    config_t* iface_config = json_config_new_from_buffer(
+        "{\"Name\": \"default\", \"Type\": \"zmq_ipc\", \"EndPoint\": \"/EII/sockets\", "
+        "\"Topics\": [\"camera1_stream\", \"camera2_stream\"], \"AllowedClients\": [\"*\"]}");
+    if (iface_config == NULL) {
+        state.SkipWithError("Failed to parse interface");
+        return;
+    }
+    config_value_t* iface = config_value_new_object(iface_config->cfg, get_config_value, NULL);
+
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        config_t* c_json = json_config_new_from_buffer("{}");
+        if (!get_ipc_config(c_json, iface, "/EII/sockets", CFGMGR_PUBLISHER)) {
+            state.SkipWithError("get_ipc_config() failed");
+            config_destroy(c_json);
+            break;
+        }
+        config_destroy(c_json);
+    }
+    allocs.report(state);
+    config_value_destroy(iface);
+    config_destroy(iface_config);
+}
+BENCHMARK(BM_GetIpcConfig);
+
+// Parses an app config embedding state.range(0) UDFs and a 64 KiB blob of
+// model metadata, with cJSON (0) or cfgmgr_json_parse() (1), whose backend
+// depends on WITH_SIMDJSON
+static void BM_JsonParse(benchmark::State& state) {
+    bool use_cfgmgr = state.range(1) == 1;
+    std::string doc = "{\"udfs\": [";
+    for (int64_t i = 0; i < state.range(0); i++) {
+        doc += (i == 0) ? "" : ",";
+        doc += "{\"name\": \"model_" + std::to_string(i) + "\", \"device\": \"CPU\", "
+               "\"weights\": [0.25, 0.5, " + std::to_string(i) + "], \"enabled\": true}";
+    }
+    doc += "], \"metadata\": \"" + std::string(65536, 'm') + "\"}";
+    state.SetLabel(use_cfgmgr ? cfgmgr_json_backend() : "cJSON_Parse");
+
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        cJSON* json = use_cfgmgr ? cfgmgr_json_parse(doc.data(), doc.size())
+                                 : cJSON_ParseWithLength(doc.data(), doc.size());
+        if (json == NULL) {
+            state.SkipWithError("Failed to parse the document");
+            break;
+        }
+        cJSON_Delete(json);
+    }
+    allocs.report(state);
+    state.SetBytesProcessed(state.iterations() * doc.size());
+}
+BENCHMARK(BM_JsonParse)->ArgsProduct({{100, 1000, 10000}, {0, 1}});
+
+// Reads two app config values and the topics of a publisher, through the
+// allocating getters (0) or borrowed views (1)
+static void BM_ReadConfig(benchmark::State& state) {
+    bool use_views = state.range(0) == 1;
+    BenchEnv* env = bench_env();
+    env->use_mode(true);
+    env->seed(8);
+    state.SetLabel(use_views ? "views" : "config_value_t");
+    cfgmgr_ctx_t* ctx = cfgmgr_initialize();
+    if (ctx == NULL) {
+        state.SkipWithError("cfgmgr_initialize() failed");
+        return;
+    }
+    cfgmgr_interface_t* iface = cfgmgr_get_publisher_by_index(ctx, 0);
+    if (iface == NULL) {
+        state.SkipWithError("Failed to get interface");
+        cfgmgr_destroy(ctx);
+        return;
+    }
+
+    int64_t sum = 0;
+    AllocationCounter allocs;
+    for (auto _ : state) {
+        if (use_views) {
+            cfgmgr_view_t app_config = cfgmgr_view_app_config(ctx);
+            int64_t max_workers = 0;
+            bool loop_video = false;
+            cfgmgr_view_integer(cfgmgr_view_get(app_config, "max_workers"), &max_workers);
+            cfgmgr_view_boolean(cfgmgr_view_get(app_config, "loop_video"), &loop_video);
+            const char* const* topics = NULL;
+            size_t count = 0;
+            cfgmgr_view_topics(iface, &topics, &count);
+            sum += max_workers + loop_video + count;
+        } else {
+            config_value_t* max_workers = cfgmgr_get_app_config_value(ctx, "max_workers");
+            config_value_t* loop_video = cfgmgr_get_app_config_value(ctx, "loop_video");
+            config_value_t* topics = cfgmgr_get_topics(iface);
+            sum += max_workers->body.integer + loop_video->body.boolean +
+                   config_value_array_len(topics);
+            config_value_destroy(max_workers);
+            config_value_destroy(loop_video);
+            config_value_destroy(topics);
+        }
+    }
+    allocs.report(state);
+    benchmark::DoNotOptimize(sum);
+    cfgmgr_interface_destroy(iface);
+    cfgmgr_destroy(ctx);
+}
+BENCHMARK(BM_ReadConfig)->Arg(0)->Arg(1);
+
+struct watch_sync_t {
+    std::mutex mtx;
+    std::condition_variable cv;
+    // "seq" of the last value received, events of a key come in order
+    int64_t last_seq;
+    // Allocation count at the end of the last callback
+    uint64_t allocs;
+};
+
+static void bench_watch_callback(const char* key, config_t* value, void* user_data) {
+    watch_sync_t* sync = (watch_sync_t*) user_data;
+    int64_t seq = -1;
+    config_value_t* seq_value = config_get(value, "seq");
+    if (seq_value != NULL) {
+        if (seq_value->type == CVT_INTEGER) {
+            seq = seq_value->body.integer;
+        }
+        config_value_destroy(seq_value);
+    }
+    config_destroy(value);
+    // The events are delivered on the watch thread, whose allocations are
+    // counted from here on
+    count_allocs = true;
+    std::lock_guard<std::mutex> lk(sync->mtx);
+    sync->last_seq = seq;
+    sync->allocs = alloc_count.load(std::memory_order_relaxed);
+    sync->cv.notify_one();
+}
+
+static void bench_watch_put(BenchEnv* env, int64_t seq) {
+    env->put(env->dev_writer, BENCH_WATCH_KEY, "{\"seq\": " + std::to_string(seq) + "}");
+}
+
+static void BM_WatchLatency(benchmark::State& state) {
+    BenchEnv* env = bench_env();
+    env->use_mode(true);
+    env->seed(8);
+    cfgmgr_ctx_t* ctx = cfgmgr_initialize();
+    if (ctx == NULL) {
+        state.SkipWithError("cfgmgr_initialize() failed");
+        return;
+    }
+    watch_sync_t sync;
+    sync.last_seq = 0;
+    sync.allocs = 0;
+    cfgmgr_watch(ctx, BENCH_WATCH_KEY, bench_watch_callback, &sync);
+
+    // Wait for the watch stream to be established and for the events of
+    // every warmup put, which would otherwise be taken for timed ones
+    int64_t seq = 0;
+    uint64_t allocs_start = 0;
+    while (true) {
+        bench_watch_put(env, ++seq);
+        std::unique_lock<std::mutex> lk(sync.mtx);
+        if (sync.cv.wait_for(lk, std::chrono::milliseconds(100),
+                             [&] { return sync.last_seq == seq; })) {
+            allocs_start = sync.allocs;
+            break;
+        }
+    }
+
+    // Time from put() to the callback being run on the watch thread
+    for (auto _ : state) {
+        bench_watch_put(env, ++seq);
+        std::unique_lock<std::mutex> lk(sync.mtx);
+        sync.cv.wait(lk, [&] { return sync.last_seq == seq; });
+    }
+
+    // Allocations of the watch thread per event, from the callback of the
+    // last warmup event to the callback of the last timed one
+    {
+        std::lock_guard<std::mutex> lk(sync.mtx);
+        state.counters["allocs_per_op"] = benchmark::Counter(
+                (double) (sync.allocs - allocs_start), benchmark::Counter::kAvgIterations);
+    }
+    cfgmgr_destroy(ctx);
+}
+BENCHMARK(BM_WatchLatency)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,49 @@
+#!/bin/bash -e
+
+# Copyright (c) 2021 Intel Corporation.
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Generates a throwaway CA, server and client certificate used by the
+# benchmarks to run the fake etcd server in prod mode (TLS).
+# Usage: ./gen_certs.sh <output directory>
+
+OUT_DIR=$1
+if [ -z "$OUT_DIR" ]; then
+    echo "Usage: $0 <output directory>"
+    exit 1
+fi
+mkdir -p $OUT_DIR
+cd $OUT_DIR
+
+openssl req -x509 -newkey rsa:2048 -nodes -days 3650 -subj "/CN=cfgmgr-bench-ca" \
+    -keyout ca_key.pem -out ca_certificate.pem 2>/dev/null
+
+openssl req -newkey rsa:2048 -nodes -subj "/CN=localhost" \
+    -keyout server_key.pem -out server.csr 2>/dev/null
+printf "subjectAltName=DNS:localhost,IP:127.0.0.1\n" > server.ext
+openssl x509 -req -in server.csr -CA ca_certificate.pem -CAkey ca_key.pem \
+    -CAcreateserial -days 3650 -extfile server.ext -out server_certificate.pem 2>/dev/null
+
+openssl req -newkey rsa:2048 -nodes -subj "/CN=root" \
+    -keyout client_key.pem -out client.csr 2>/dev/null
+openssl x509 -req -in client.csr -CA ca_certificate.pem -CAkey ca_key.pem \
+    -CAcreateserial -days 3650 -out client_certificate.pem 2>/dev/null
+
+rm -f server.csr server.ext client.csr ca_certificate.srl
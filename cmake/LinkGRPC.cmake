@@ -26,6 +26,8 @@ if(SYSTEM_GRPC)
     # Find the gRPC package on the system
     find_package(PROTOBUF REQUIRED)
     find_package(GRPC REQUIRED)
+    # libcrypto for the warm-start snapshots
+    find_package(OpenSSL REQUIRED)
 
     # Add include directories
     include_directories(
@@ -35,11 +37,13 @@ if(SYSTEM_GRPC)
     target_link_libraries(eiiconfigmanager_static
         PUBLIC
             ${GRPC_LIBRARIES}
-            ${PROTOBUF_LIBRARIES})
+            ${PROTOBUF_LIBRARIES}
+            OpenSSL::Crypto)
     target_link_libraries(eiiconfigmanager
         PUBLIC
             ${GRPC_LIBRARIES}
-            ${PROTOBUF_LIBRARIES})
+            ${PROTOBUF_LIBRARIES}
+            OpenSSL::Crypto)
 else()
     # Set gRPC_INSTALL to ON so that the gRPC targets get installed with the
     # EII Config Manager targets.
@@ -57,6 +61,7 @@ else()
     set(FETCHCONTENT_QUIET OFF)
     FetchContent_MakeAvailable(gRPC)
 
-    target_link_libraries(eiiconfigmanager_static PRIVATE grpc++)
-    target_link_libraries(eiiconfigmanager PRIVATE grpc++)
+    # The warm-start snapshots use the BoringSSL libcrypto gRPC builds
+    target_link_libraries(eiiconfigmanager_static PRIVATE grpc++ crypto)
+    target_link_libraries(eiiconfigmanager PRIVATE grpc++ crypto)
 endif()
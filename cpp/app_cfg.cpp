@@ -72,6 +72,18 @@ config_value_t* AppCfg::getConfigValue(const char* key) {
     return value;
 }
 
+cfgmgr_view_t AppCfg::getConfigView(const char* key) {
+    return cfgmgr_view_get(cfgmgr_view_app_config(m_cfgmgr), key);
+}
+
+cfgmgr_snapshot_guard_t AppCfg::acquireSnapshot() {
+    return cfgmgr_acquire_snapshot(m_cfgmgr);
+}
+
+void AppCfg::releaseSnapshot(cfgmgr_snapshot_guard_t* guard) {
+    cfgmgr_release_snapshot(m_cfgmgr, guard);
+}
+
 
 bool AppCfg::watch(const char* key, cfgmgr_watch_callback_t watch_callback, void* user_data) {
     try {
@@ -121,12 +133,33 @@ bool AppCfg::watchInterface(cfgmgr_watch_callback_t watch_callback, void* user_d
     return true;
 }
 
+bool AppCfg::watchPublicKeys(cfgmgr_public_keys_callback_t callback, void* user_data) {
+    // Calling the base cfgmgr_watch_public_keys C API
+    return cfgmgr_watch_public_keys(m_cfgmgr, callback, user_data) == 0;
+}
+
+bool AppCfg::watchInterfaceChanges(cfgmgr_changes_callback_t callback, void* user_data) {
+    // Calling the base cfgmgr_watch_interface_changes C API
+    return cfgmgr_watch_interface_changes(m_cfgmgr, callback, user_data) == 0;
+}
+
+bool AppCfg::watchConfigChanges(cfgmgr_changes_callback_t callback, void* user_data) {
+    // Calling the base cfgmgr_watch_config_changes C API
+    return cfgmgr_watch_config_changes(m_cfgmgr, callback, user_data) == 0;
+}
+
 // This virtual method is implemented
 // by sub class objects
 config_t* AppCfg::getMsgBusConfig() {
     return NULL;
 }
 
+// This virtual method is implemented
+// by sub class objects
+BinaryConfig* AppCfg::getMsgBusConfigBinary() {
+    return NULL;
+}
+
 // This virtual method is implemented
 // by sub class objects
 std::string AppCfg::getEndpoint() {
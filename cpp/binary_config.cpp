@@ -0,0 +1,158 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @brief BinaryConfig Implementation
+ * Holds the implementaion of APIs supported by BinaryConfig and BinaryValue classes
+ */
+
+#include <stdlib.h>
+#include "eii/config_manager/binary_config.hpp"
+
+using namespace eii::config_manager;
+
+BinaryValue::BinaryValue(cfgmgr_binary_t value) : m_value(value) {
+}
+
+cfgmgr_view_type_t BinaryValue::type() const {
+    return cfgmgr_binary_type(m_value);
+}
+
+bool BinaryValue::exists() const {
+    return m_value.node != NULL;
+}
+
+BinaryValue BinaryValue::operator[](const char* key) const {
+    return BinaryValue(cfgmgr_binary_get(m_value, key));
+}
+
+BinaryValue BinaryValue::operator[](size_t index) const {
+    return BinaryValue(cfgmgr_binary_at(m_value, index));
+}
+
+size_t BinaryValue::size() const {
+    return cfgmgr_binary_len(m_value);
+}
+
+const char* BinaryValue::keyAt(size_t index) const {
+    if (type() != CFGMGR_VIEW_OBJECT || index >= size()) {
+        throw "Not a member of an object";
+    }
+    cfgmgr_binary_iter_t iter = cfgmgr_binary_iter(m_value);
+    iter.index = index;
+    cfgmgr_binary_t item;
+    const char* key = NULL;
+    cfgmgr_binary_next(&iter, &item, &key);
+    return key;
+}
+
+BinaryValue BinaryValue::valueAt(size_t index) const {
+    if (type() != CFGMGR_VIEW_OBJECT || index >= size()) {
+        throw "Not a member of an object";
+    }
+    cfgmgr_binary_iter_t iter = cfgmgr_binary_iter(m_value);
+    iter.index = index;
+    cfgmgr_binary_t item;
+    cfgmgr_binary_next(&iter, &item, NULL);
+    return BinaryValue(item);
+}
+
+const char* BinaryValue::getString() const {
+    const char* str = NULL;
+    if (!cfgmgr_binary_string(m_value, &str, NULL)) {
+        throw "Value is not a string";
+    }
+    return str;
+}
+
+int64_t BinaryValue::getInteger() const {
+    int64_t result = 0;
+    if (!cfgmgr_binary_integer(m_value, &result)) {
+        throw "Value is not an integer";
+    }
+    return result;
+}
+
+double BinaryValue::getFloating() const {
+    double result = 0;
+    if (!cfgmgr_binary_floating(m_value, &result)) {
+        throw "Value is not a number";
+    }
+    return result;
+}
+
+bool BinaryValue::getBoolean() const {
+    bool result = false;
+    if (!cfgmgr_binary_boolean(m_value, &result)) {
+        throw "Value is not a boolean";
+    }
+    return result;
+}
+
+BinaryConfig::BinaryConfig(void* buf, size_t size, bool owned) :
+    m_buf(buf), m_size(size), m_owned(owned)
+{
+    m_root = cfgmgr_binary_root(buf, size);
+    if (m_root.node == NULL) {
+        if (m_owned) {
+            free(m_buf);
+        }
+        throw "Invalid binary config";
+    }
+}
+
+BinaryConfig::BinaryConfig(const BinaryConfig& src) {
+    throw "This object should not be copied";
+}
+
+BinaryConfig& BinaryConfig::operator=(const BinaryConfig& src) {
+    return *this;
+}
+
+BinaryValue BinaryConfig::root() const {
+    return BinaryValue(m_root);
+}
+
+BinaryValue BinaryConfig::operator[](const char* key) const {
+    return BinaryValue(cfgmgr_binary_get(m_root, key));
+}
+
+const void* BinaryConfig::data() const {
+    return m_buf;
+}
+
+size_t BinaryConfig::size() const {
+    return m_size;
+}
+
+config_t* BinaryConfig::toConfig() const {
+    config_t* config = cfgmgr_binary_config_new(m_buf, m_size);
+    if (config == NULL) {
+        throw "Unable to create config_t over binary config";
+    }
+    return config;
+}
+
+BinaryConfig::~BinaryConfig() {
+    if (m_owned) {
+        free(m_buf);
+    }
+}
@@ -57,6 +57,16 @@ config_t* ClientCfg::getMsgBusConfig() {
     return cpp_client_config;
 }
 
+// getMsgBusConfigBinary of Client class
+BinaryConfig* ClientCfg::getMsgBusConfigBinary() {
+    size_t size = 0;
+    void* buf = cfgmgr_get_msgbus_config_binary(m_cfgmgr_interface, &size);
+    if (buf == NULL) {
+        throw "Unable to fetch client binary msgbus config";
+    }
+    return new BinaryConfig(buf, size, true);
+}
+
 // Get the Interface Value of Client.
 config_value_t* ClientCfg::getInterfaceValue(const char* key){
     config_value_t* interface_value = cfgmgr_get_interface_value(m_cfgmgr_interface, key);
@@ -68,22 +78,12 @@ config_value_t* ClientCfg::getInterfaceValue(const char* key){
 
 // To fetch endpoint from config
 std::string ClientCfg::getEndpoint() {
-    // Fetching EndPoint from config
-    config_value_t* ep = cfgmgr_get_endpoint(m_cfgmgr_interface);
+    // Reading the EndPoint compiled into the interface, without copying it
+    const char* ep = cfgmgr_view_endpoint(m_cfgmgr_interface);
     if (ep == NULL) {
         throw "Endpoint is not set";
     }
-
-    char* value;
-    value = cvt_obj_str_to_char(ep);
-    if (value == NULL) {
-        throw "Endpoint object to string conversion failed";
-    }
-
-    std::string s(value);
-    // Destroying ep
-    config_value_destroy(ep);
-    return s;
+    return std::string(ep);
 }
 
 // Destructor
@@ -97,6 +97,20 @@ bool ConfigMgr::isDevMode() {
     return cfgmgr_is_dev_mode(m_cfgmgr);
 }
 
+bool ConfigMgr::reloadEnv() {
+    // Calling the base C cfgmgr_reload_env API
+    return cfgmgr_reload_env(m_cfgmgr) == 0;
+}
+
+cfgmgr_msgbus_configs_t* ConfigMgr::getAllMsgBusConfigs() {
+    // Calling the base C cfgmgr_get_all_msgbus_configs API
+    cfgmgr_msgbus_configs_t* configs = cfgmgr_get_all_msgbus_configs(m_cfgmgr);
+    if (configs == NULL) {
+        throw "Unable to fetch msgbus configs";
+    }
+    return configs;
+}
+
 std::string ConfigMgr::getAppName() {
     // Calling the base C cfgmgr_get_appname_base API
     config_value_t* appname = cfgmgr_get_appname(m_cfgmgr);
@@ -58,6 +58,16 @@ config_t* PublisherCfg::getMsgBusConfig() {
     return pub_config;
 }
 
+// getMsgBusConfigBinary of Publisher class
+BinaryConfig* PublisherCfg::getMsgBusConfigBinary() {
+    size_t size = 0;
+    void* buf = cfgmgr_get_msgbus_config_binary(m_cfgmgr_interface, &size);
+    if (buf == NULL) {
+        throw "Unable to fetch publisher binary msgbus config";
+    }
+    return new BinaryConfig(buf, size, true);
+}
+
 // Get the Interface Value of Publisher.
 config_value_t* PublisherCfg::getInterfaceValue(const char* key){
     config_value_t* interface_value = cfgmgr_get_interface_value(m_cfgmgr_interface, key);
@@ -70,52 +80,23 @@ config_value_t* PublisherCfg::getInterfaceValue(const char* key){
 
 // To fetch endpoint from config
 std::string PublisherCfg::getEndpoint() {
-    // Calling the base C get_endpoint() API
-    config_value_t* ep = cfgmgr_get_endpoint(m_cfgmgr_interface);
+    // Reading the EndPoint compiled into the interface, without copying it
+    const char* ep = cfgmgr_view_endpoint(m_cfgmgr_interface);
     if (ep == NULL) {
         throw "Endpoint not found";
     }
-
-    char* value;
-    value = cvt_obj_str_to_char(ep);
-    if (value == NULL) {
-        config_value_destroy(ep);
-        throw "Endpoint object to string conversion failed";
-    }
-
-    std::string s(value);
-    // Destroying ep
-    config_value_destroy(ep);
-    return s;
+    return std::string(ep);
 }
 
 // To fetch topics from config
 std::vector<std::string> PublisherCfg::getTopics() {
-
-    std::vector<std::string> topic_list;
-    // Calling the base C get_topics() API
-    config_value_t* topics = cfgmgr_get_topics(m_cfgmgr_interface);
-    if (topics == NULL) {
+    const char* const* topics = NULL;
+    size_t arr_len = 0;
+    // Borrowing the topics compiled into the interface
+    if (!cfgmgr_view_topics(m_cfgmgr_interface, &topics, &arr_len)) {
         throw "topics initialization failed";
     }
-    config_value_t* topic_value;
-    size_t arr_len = config_value_array_len(topics);
-    if (arr_len == 0) {
-        throw "Empty array is not supported, atleast one value should be given.";
-    }
-    for (size_t i = 0; i < arr_len; i++) {
-        topic_value = config_value_array_get(topics, i);
-        if (topic_value == NULL) {
-            config_value_destroy(topics);
-            throw "topic_value initialization failed";
-        }
-        topic_list.push_back(topic_value->body.string);
-        // Destroying topic_value
-        config_value_destroy(topic_value);
-    }
-    // Destroying topics
-    config_value_destroy(topics);
-    return topic_list;
+    return std::vector<std::string>(topics, topics + arr_len);
 }
 
 // To set topics in config
@@ -155,30 +136,16 @@ bool PublisherCfg::setTopics(std::vector<std::string> topics_list) {
 
 // To fetch list of allowed clients from config
 std::vector<std::string> PublisherCfg::getAllowedClients() {
-
-    std::vector<std::string> client_list;
-    // Calling the base C get_topics() API
-    config_value_t* clients = cfgmgr_get_allowed_clients(m_cfgmgr_interface);
-    if (clients == NULL) {
+    const char* const* clients = NULL;
+    size_t arr_len = 0;
+    // Borrowing the allowed clients compiled into the interface
+    if (!cfgmgr_view_allowed_clients(m_cfgmgr_interface, &clients, &arr_len)) {
         throw "clients initialization failed";
     }
-    config_value_t* client_value;
-    size_t arr_len = config_value_array_len(clients);
     if (arr_len == 0) {
         throw "Empty array is not supported, atleast one value should be given.";
     }
-    for (size_t i = 0; i < arr_len; i++) {
-        client_value = config_value_array_get(clients, i);
-        if (client_value == NULL) {
-            throw "client_value initialization failed";
-        }
-        client_list.push_back(client_value->body.string);
-        // Destroying client_value
-        config_value_destroy(client_value);
-    }
-    // Destroying clients
-    config_value_destroy(clients);
-    return client_list;
+    return std::vector<std::string>(clients, clients + arr_len);
 }
 
 // Destructor
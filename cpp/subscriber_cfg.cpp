@@ -58,6 +58,16 @@ config_t* SubscriberCfg::getMsgBusConfig() {
     return sub_config;
 }
 
+// getMsgBusConfigBinary of Subscriber class
+BinaryConfig* SubscriberCfg::getMsgBusConfigBinary() {
+    size_t size = 0;
+    void* buf = cfgmgr_get_msgbus_config_binary(m_cfgmgr_interface, &size);
+    if (buf == NULL) {
+        throw "Unable to fetch subscriber binary msgbus config";
+    }
+    return new BinaryConfig(buf, size, true);
+}
+
 // Get the Interface Value of Subscriber.
 config_value_t* SubscriberCfg::getInterfaceValue(const char* key){
     config_value_t* interface_value = cfgmgr_get_interface_value(m_cfgmgr_interface, key);
@@ -69,48 +79,23 @@ config_value_t* SubscriberCfg::getInterfaceValue(const char* key){
 
 // To fetch endpoint from config
 std::string SubscriberCfg::getEndpoint() {
-    // Calling the base C get_endpoint_sub() API
-    config_value_t* ep = cfgmgr_get_endpoint(m_cfgmgr_interface);
+    // Reading the EndPoint compiled into the interface, without copying it
+    const char* ep = cfgmgr_view_endpoint(m_cfgmgr_interface);
     if (ep == NULL) {
         throw "Endpoint not found";
     }
-
-    char* value;
-    value = cvt_obj_str_to_char(ep);
-    if(value == NULL){
-        config_value_destroy(ep);
-        throw "Endpoint object to string conversion failed";
-    }
-
-    std::string s(value);
-    // Destroying ep
-    config_value_destroy(ep);
-    return s;
+    return std::string(ep);
 }
 
 // To fetch topics from config
 std::vector<std::string> SubscriberCfg::getTopics() {
-
-    std::vector<std::string> topic_list;
-    // Calling the base C get_topics() API
-    config_value_t* topics = cfgmgr_get_topics(m_cfgmgr_interface);
-    if (topics == NULL) {
+    const char* const* topics = NULL;
+    size_t arr_len = 0;
+    // Borrowing the topics compiled into the interface
+    if (!cfgmgr_view_topics(m_cfgmgr_interface, &topics, &arr_len)) {
         throw "topics initialization failed";
     }
-    config_value_t* topic_value;
-    for (size_t i = 0; i < config_value_array_len(topics); i++) {
-        topic_value = config_value_array_get(topics, i);
-        if (topic_value == NULL) {
-            config_value_destroy(topics);
-            throw "topics initialization failed";
-        }
-        topic_list.push_back(topic_value->body.string);
-        // Destroying topics
-        config_value_destroy(topic_value);
-    }
-    // Destroying topics
-    config_value_destroy(topics);
-    return topic_list;
+    return std::vector<std::string>(topics, topics + arr_len);
 }
 
 // To set topics in config
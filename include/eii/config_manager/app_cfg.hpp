@@ -37,6 +37,8 @@
 #include "eii/utils/json_config.h"
 #include "eii/config_manager/kv_store_plugin/kv_store_plugin.h"
 #include "eii/config_manager/cfgmgr.h"
+#include "eii/config_manager/cfgmgr_view.h"
+#include "eii/config_manager/binary_config.hpp"
 
 
 namespace eii {
@@ -107,10 +109,33 @@ namespace eii {
                 /**
                  * Gets value from respective application's config
                  * @param key - Key for which value is needed
-                 * @return config_value_t* - config_value_t object
+                 * @return config_value_t* - config_value_t object, a copy
+                 *         to be freed with config_value_destroy()
                  */
                 config_value_t* getConfigValue(const char* key);
 
+                /**
+                 * Gets a borrowed view of a value from respective application's
+                 * config, without copying it. The view stays valid until the
+                 * ConfigMgr is destroyed.
+                 * @param key - Key for which value is needed
+                 * @return cfgmgr_view_t - view of type CFGMGR_VIEW_NONE if not found
+                 */
+                cfgmgr_view_t getConfigView(const char* key);
+
+                /**
+                 * Pin the current snapshot of app config and interface, lock-free
+                 * @return cfgmgr_snapshot_guard_t - guard whose snapshot stays
+                 *                                  unchanged until released
+                 */
+                cfgmgr_snapshot_guard_t acquireSnapshot();
+
+                /**
+                 * Release a snapshot pinned by acquireSnapshot()
+                 * @param guard - guard returned by acquireSnapshot()
+                 */
+                void releaseSnapshot(cfgmgr_snapshot_guard_t* guard);
+
                 /**
                  * Register a callback to watch on any given key
                  * @param key - key to watch
@@ -145,6 +170,33 @@ namespace eii {
                  */
                 bool watchInterface(cfgmgr_watch_callback_t watch_callback, void* user_data);
 
+                /**
+                 * Register a callback to watch on the public keys under /Publickeys/,
+                 * called with the AppName and its new key, NULL if removed
+                 * @param callback - callback object
+                 * @param user_data - user data to be sent to callback
+                 * @return bool - Boolean whether the callback was registered,
+                 *                false in dev mode
+                 */
+                bool watchPublicKeys(cfgmgr_public_keys_callback_t callback, void* user_data);
+
+                /**
+                 * Register a callback for the changes of app interface, such as the
+                 * EndPoint of a publisher or the Topics added to a subscriber
+                 * @param callback - callback object
+                 * @param user_data - user data to be sent to callback
+                 * @return bool - Boolean whether the callback was registered
+                 */
+                bool watchInterfaceChanges(cfgmgr_changes_callback_t callback, void* user_data);
+
+                /**
+                 * Register a callback for the changes of app config, per changed path
+                 * @param callback - callback object
+                 * @param user_data - user data to be sent to callback
+                 * @return bool - Boolean whether the callback was registered
+                 */
+                bool watchConfigChanges(cfgmgr_changes_callback_t callback, void* user_data);
+
                 /**
                  * Get msgbus configuration for application to communicate over EII message bus
                  * @return config_t* - JSON msg bus server config of type config_t
@@ -152,6 +204,14 @@ namespace eii {
                  */
                 virtual config_t* getMsgBusConfig();
 
+                /**
+                 * Get msgbus configuration in the binary form, read in place
+                 * without JSON
+                 * @return BinaryConfig* - binary msg bus config, to be deleted by the caller
+                 *                       - On Failure, returns NULL
+                 */
+                virtual BinaryConfig* getMsgBusConfigBinary();
+
                 /**
                  * virtual getEndpoint function implemented by child classes to fetch Endpoint
                  * @return std::string - On Success, Endpoint of associated config of type std::string
@@ -0,0 +1,207 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief C++ accessors of binary msgbus configs
+ */
+
+#ifndef _EII_CH_BINARY_CONFIG_H
+#define _EII_CH_BINARY_CONFIG_H
+
+#include <stdint.h>
+#include <string>
+#include "eii/utils/config.h"
+#include "eii/config_manager/cfgmgr_binary.h"
+
+namespace eii {
+    namespace config_manager {
+
+        /**
+         * Value of a BinaryConfig, read in place from its buffer and valid
+         * as long as the BinaryConfig
+         */
+        class BinaryValue {
+            private:
+
+                // Node of the value
+                cfgmgr_binary_t m_value;
+
+            public:
+
+                /**
+                 * BinaryValue Constructor
+                 * @param value - node of a checked buffer
+                 */
+                explicit BinaryValue(cfgmgr_binary_t value);
+
+                /**
+                 * Type of the value
+                 * @return cfgmgr_view_type_t - CFGMGR_VIEW_NONE for a missing value
+                 */
+                cfgmgr_view_type_t type() const;
+
+                /**
+                 * Whether the value exists
+                 * @return bool - false for a missing key or index
+                 */
+                bool exists() const;
+
+                /**
+                 * Value of a key of an object
+                 * @param key - key to look up
+                 * @return BinaryValue - missing value if there is no such key
+                 */
+                BinaryValue operator[](const char* key) const;
+
+                /**
+                 * Item of an array
+                 * @param index - index of the item
+                 * @return BinaryValue - missing value if out of range
+                 */
+                BinaryValue operator[](size_t index) const;
+
+                /**
+                 * Number of items of an array or keys of an object
+                 * @return size_t - 0 for any other type
+                 */
+                size_t size() const;
+
+                /**
+                 * Key of the index-th member of an object, in key order
+                 * @param index - index of the member
+                 * @return const char* - key, inside the buffer
+                 */
+                const char* keyAt(size_t index) const;
+
+                /**
+                 * Value of the index-th member of an object, in key order
+                 * @param index - index of the member
+                 * @return BinaryValue - value of the member
+                 */
+                BinaryValue valueAt(size_t index) const;
+
+                /**
+                 * String value, inside the buffer
+                 * @return const char* - NUL terminated string
+                 */
+                const char* getString() const;
+
+                /**
+                 * Integer value
+                 * @return int64_t - value
+                 */
+                int64_t getInteger() const;
+
+                /**
+                 * Floating point value, integers included
+                 * @return double - value
+                 */
+                double getFloating() const;
+
+                /**
+                 * Boolean value
+                 * @return bool - value
+                 */
+                bool getBoolean() const;
+        };
+
+        /**
+         * Binary msgbus config, see cfgmgr_binary.h for the layout
+         */
+        class BinaryConfig {
+            private:
+
+                // Buffer of the config
+                void* m_buf;
+
+                // Size of the buffer
+                size_t m_size;
+
+                // Whether m_buf is freed with the object
+                bool m_owned;
+
+                // Root of the config
+                cfgmgr_binary_t m_root;
+
+                /**
+                 * Private @c BinaryConfig copy constructor.
+                 */
+                BinaryConfig(const BinaryConfig& src);
+
+                /**
+                 * Private @c BinaryConfig assignment operator.
+                 */
+                BinaryConfig& operator=(const BinaryConfig& src);
+
+            public:
+
+                /**
+                 * BinaryConfig Constructor, checks the buffer
+                 * @param buf   - buffer of the config
+                 * @param size  - size of the buffer
+                 * @param owned - whether the buffer, allocated with malloc(),
+                 *                is freed with the object; otherwise it is
+                 *                borrowed and must outlive the object
+                 */
+                BinaryConfig(void* buf, size_t size, bool owned);
+
+                /**
+                 * Root of the config
+                 * @return BinaryValue - root, an object for msgbus configs
+                 */
+                BinaryValue root() const;
+
+                /**
+                 * Value of a key of the root object
+                 * @param key - key to look up
+                 * @return BinaryValue - missing value if there is no such key
+                 */
+                BinaryValue operator[](const char* key) const;
+
+                /**
+                 * Buffer of the config, ex: to be written to a file
+                 * @return const void* - buffer
+                 */
+                const void* data() const;
+
+                /**
+                 * Size of the buffer
+                 * @return size_t - size
+                 */
+                size_t size() const;
+
+                /**
+                 * Read-only config_t over the buffer, for APIs taking a
+                 * config_t such as msgbus_initialize()
+                 * @return config_t* - config_t to be destroyed by the caller,
+                 *                     valid as long as the object
+                 */
+                config_t* toConfig() const;
+
+                /**
+                 * Destructor
+                 */
+                ~BinaryConfig();
+        };
+    }
+}
+#endif
@@ -24,8 +24,20 @@
  */
 
 #include <ctype.h>
+#include <pthread.h>
 #include "eii/config_manager/kv_store_plugin/kv_store_plugin.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_metrics.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_fault.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_mirror.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_shm.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_warm.h"
 #include "eii/config_manager/cfgmgr_util.h"
+#include "eii/config_manager/cfgmgr_iface_index.h"
+#include "eii/config_manager/cfgmgr_msgbus_cache.h"
+#include "eii/config_manager/cfgmgr_env_overrides.h"
+#include "eii/config_manager/cfgmgr_diff.h"
+#include "eii/config_manager/cfgmgr_snapshot.h"
+#include "eii/config_manager/cfgmgr_trace.h"
 
 #define PUBLISHERS "Publishers"
 #define SUBSCRIBERS "Subscribers"
@@ -61,10 +73,13 @@ typedef struct  {
     // to be set in the Go/Py/Cpp bindings
     char* env_var;
 
-    // Application config
+    // Application config as first loaded, owned by snapshots;
+    // cfgmgr_get_app_config() returns the current one
     config_t* app_config;
 
-    // Application interface
+    // Application interfaces as first loaded, referenced in the interface
+    // index until the context is destroyed; cfgmgr_get_app_interface()
+    // returns the current ones
     config_t* app_interface;
 
     // Application data store
@@ -82,6 +97,60 @@ typedef struct  {
     // kv_store_handle to hold the kv_store object
     void* kv_store_handle;
 
+    // Index of the application interfaces by type and Name,
+    // owns app_interface and is rebuilt when it changes
+    cfgmgr_iface_index_t* iface_index;
+
+    // Message bus configs built per interface, invalidated when
+    // the interfaces or the keys they are built from change
+    cfgmgr_msgbus_cache_t* msgbus_cache;
+
+    // Message bus configs are built in an arena each, so that one is a
+    // few chunks freed at once by config_destroy(); set by CONFIGMGR_ARENA
+    bool msgbus_arena;
+
+    // Type and EndPoint env overrides, scanned at initialization
+    // and by cfgmgr_reload_env()
+    cfgmgr_env_overrides_t* env_overrides;
+
+    // Set for the contexts cfgmgr_bundle_bake() resolves msgbus
+    // configs with, which neither read the env overrides nor set
+    // /GlobalEnv/ in the environment
+    bool baking;
+
+    // Set with CONFIGMGR_LAZY, which connects once other threads may
+    // run: /GlobalEnv/ is then kept in env_overrides, never set in the
+    // environment
+    bool lazy;
+
+    // In-memory copy of /Publickeys/ in prod mode, part of the
+    // kv_store_client chain and freed with it; NULL in dev mode
+    kv_store_client_t* public_keys;
+
+    // Listeners of cfgmgr_watch_interface_changes(), notified by
+    // the watch which rebuilds the interface index
+    struct cfgmgr_change_watch* iface_watches;
+
+    // Listeners of cfgmgr_watch_config_changes(), notified by
+    // the watch which publishes config snapshots
+    struct cfgmgr_change_watch* config_watches;
+
+    // Callbacks of cfgmgr_watch() on /<AppName>/config,
+    // /<AppName>/interfaces or the private key, notified by the
+    // watches the context keeps instead of opening new ones
+    struct cfgmgr_key_watch* key_watches;
+
+    // Current application config and interfaces, published by the
+    // watches on /<AppName>/config and /<AppName>/interfaces
+    cfgmgr_snapshots_t* snapshots;
+
+    // Parts of the context loaded so far. cfgmgr_initialize() loads
+    // them all unless CONFIGMGR_LAZY is set, then the first call
+    // needing the kv_store, the config, the interfaces or the keys
+    // loads that part, serialized by load_mtx
+    int loaded;
+    pthread_mutex_t load_mtx;
+
 } cfgmgr_ctx_t;
 
 /**
@@ -100,8 +169,40 @@ typedef struct {
     // Holds the cfgmgr context
     cfgmgr_ctx_t* cfg_mgr;
 
+    // Compiled interface, owned by the interface index
+    const cfgmgr_iface_model_t* model;
+
+    // Index referenced by model, which stays alive until the interface
+    // is destroyed, even after cfgmgr_destroy()
+    cfgmgr_iface_index_t* iface_index;
+
 } cfgmgr_interface_t;
 
+/**
+ * Message bus configuration of one interface, see
+ * cfgmgr_get_all_msgbus_configs()
+ */
+typedef struct {
+    // Interface type
+    cfgmgr_iface_type_t type;
+
+    // Name of the interface, NULL if it has none
+    char* name;
+
+    // Message bus configuration, NULL if it could not be built. Set it to
+    // NULL to take ownership of it before destroying the list
+    config_t* config;
+} cfgmgr_msgbus_config_entry_t;
+
+/**
+ * Message bus configurations of every interface of the application
+ */
+typedef struct {
+    // Publishers, Subscribers, Servers then Clients, each in array order
+    cfgmgr_msgbus_config_entry_t* entries;
+    size_t count;
+} cfgmgr_msgbus_configs_t;
+
 
 /**
  * To check whether environment is dev mode or prod mode
@@ -118,24 +219,70 @@ bool cfgmgr_is_dev_mode(cfgmgr_ctx_t* cfgmgr);
 config_value_t* cfgmgr_get_appname(cfgmgr_ctx_t* cfgmgr);
 
 /**
- * cfgmgr_get_app_config function to return app config
+ * cfgmgr_get_app_config function to return app config, as last published
+ * by the watch on /<AppName>/config. The config returned stays valid until
+ * cfgmgr_destroy(), so every config this returns is kept until then, even
+ * once the watch replaced it. Callers of a context whose config is updated
+ * often use cfgmgr_acquire_app_config() instead, and
+ * cfgmgr_acquire_snapshot() reads a config along with the matching
+ * interfaces.
  * @param cfgmgr - cfgmgr_ctx_t object
  *  @return NULL for any errors occured or config_t* on success
  */
 config_t* cfgmgr_get_app_config(cfgmgr_ctx_t* cfgmgr);
 
 /**
- * cfgmgr_get_app_interface function to return app interface
+ * cfgmgr_acquire_app_config function to reference the current app config,
+ * which stays valid until cfgmgr_release_app_config(). Configs replaced by
+ * the watch on /<AppName>/config are freed with their last reference, so
+ * unlike cfgmgr_get_app_config() memory stays bounded however often the
+ * config is updated.
+ * @param cfgmgr - cfgmgr_ctx_t object
+ *  @return NULL for any errors occured or config_t* on success
+ */
+config_t* cfgmgr_acquire_app_config(cfgmgr_ctx_t* cfgmgr);
+
+/**
+ * cfgmgr_release_app_config function to release a config returned by
+ * cfgmgr_acquire_app_config()
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @param app_config - config to release, may be NULL
+ */
+void cfgmgr_release_app_config(cfgmgr_ctx_t* cfgmgr, config_t* app_config);
+
+/**
+ * Pin the current snapshot of the application config and interfaces,
+ * without locking. The snapshot does not change while pinned, even if the
+ * watches publish newer ones meanwhile; release it promptly, as snapshots
+ * replaced since are only freed once no reader pins them anymore.
+ * @param cfgmgr - cfgmgr_ctx_t object
+ *  @return guard whose snapshot field is the pinned snapshot
+ */
+cfgmgr_snapshot_guard_t cfgmgr_acquire_snapshot(cfgmgr_ctx_t* cfgmgr);
+
+/**
+ * Release a snapshot pinned by cfgmgr_acquire_snapshot()
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @param guard - guard returned by cfgmgr_acquire_snapshot()
+ */
+void cfgmgr_release_snapshot(cfgmgr_ctx_t* cfgmgr, cfgmgr_snapshot_guard_t* guard);
+
+/**
+ * cfgmgr_get_app_interface function to return app interface, as last
+ * indexed from /<AppName>/interfaces. The document returned stays valid
+ * until a later call returns a newer one, or cfgmgr_destroy().
  * @param cfgmgr - cfgmgr_ctx_t object
  *  @return NULL for any errors occured or config_t* on success
  */
 config_t* cfgmgr_get_app_interface(cfgmgr_ctx_t* cfgmgr);
 
 /**
- * cfgmgr_get_app_config_value function to fetch config value
+ * cfgmgr_get_app_config_value function to fetch config value, copied from
+ * the current app config so that it stays valid once the config is replaced
  * @param cfgmgr - cfgmgr_ctx_t object
  * @param key - value of key to be fetched
- *  @return NULL for any errors occured or config_value_t* on success
+ *  @return NULL for any errors occured or config_value_t* on success, to be
+ *  freed with config_value_destroy()
  */
 config_value_t* cfgmgr_get_app_config_value(cfgmgr_ctx_t* cfgmgr, const char* key);
 
@@ -155,6 +302,27 @@ config_value_t* cfgmgr_get_app_interface_value(cfgmgr_ctx_t* cfgmgr, const char*
  */
 config_t* cfgmgr_get_msgbus_config(cfgmgr_interface_t* ctx);
 
+/**
+ * cfgmgr_get_all_msgbus_configs function to build the msgbus config of
+ * every publisher, subscriber, server and client in one call. The keys
+ * needed by all of them (own keys, public keys of peers, or every public
+ * key for AllowedClients "*") are read from the kv_store in one batch
+ * and shared between the interfaces.
+ *
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @return NULL for any errors occured or cfgmgr_msgbus_configs_t* on
+ *         success, to be destroyed with cfgmgr_msgbus_configs_destroy()
+ */
+cfgmgr_msgbus_configs_t* cfgmgr_get_all_msgbus_configs(cfgmgr_ctx_t* cfgmgr);
+
+/**
+ * Destroy a list returned by cfgmgr_get_all_msgbus_configs() and the
+ * configs it still owns
+ *
+ * @param configs - cfgmgr_msgbus_configs_t object
+ */
+void cfgmgr_msgbus_configs_destroy(cfgmgr_msgbus_configs_t* configs);
+
 /**
  * get_endpoint_base function to fetch endpoint
  * 
@@ -246,6 +414,53 @@ void cfgmgr_watch(cfgmgr_ctx_t* cfgmgr, const char* key, cfgmgr_watch_callback_t
  */
 void cfgmgr_watch_prefix(cfgmgr_ctx_t* cfgmgr, char* prefix, cfgmgr_watch_callback_t watch_callback, void* user_data);
 
+// cfgmgr callback type of cfgmgr_watch_public_keys(), called with the
+// AppName whose public key changed and its new key, NULL if removed
+typedef kv_store_mirror_callback_t cfgmgr_public_keys_callback_t;
+
+/**
+ * function to register a callback for changes of the public keys under
+ * /Publickeys/, so that running publishers and servers allowing any client
+ * can update their authorized keys without rebuilding their msgbus config.
+ * Callbacks run on the watch thread and user_data must outlive the cfgmgr.
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @param callback - cfgmgr_public_keys_callback_t object
+ * @param user_data - user_data to be sent to callback
+ * @return 0 on success, -1 in dev mode or if the public keys are not
+ *         kept in memory
+ */
+int cfgmgr_watch_public_keys(cfgmgr_ctx_t* cfgmgr, cfgmgr_public_keys_callback_t callback, void* user_data);
+
+// cfgmgr callback type of cfgmgr_watch_interface_changes() and
+// cfgmgr_watch_config_changes(), called with the changes of one update
+typedef void (*cfgmgr_changes_callback_t)(const cfgmgr_changes_t* changes, void* user_data);
+
+/**
+ * function to register a callback for the changes of /<AppName>/interfaces,
+ * such as the EndPoint of a publisher or the Topics added to a subscriber,
+ * so that only the affected msgbus sockets need to be restarted. The
+ * callback runs on the watch thread after the interface index was
+ * rebuilt, so the cfgmgr_get_*_by_name() APIs already return the new
+ * interfaces; updates which change nothing are not reported.
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @param callback - cfgmgr_changes_callback_t object
+ * @param user_data - user_data to be sent to callback
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_watch_interface_changes(cfgmgr_ctx_t* cfgmgr, cfgmgr_changes_callback_t callback, void* user_data);
+
+/**
+ * function to register a callback for the changes of /<AppName>/config,
+ * reported per changed leaf such as "a.b.c". The callback runs on the
+ * watch thread after the new config was published, so
+ * cfgmgr_get_app_config() already returns it.
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @param callback - cfgmgr_changes_callback_t object
+ * @param user_data - user_data to be sent to callback
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_watch_config_changes(cfgmgr_ctx_t* cfgmgr, cfgmgr_changes_callback_t callback, void* user_data);
+
 /**
  * cfgmgr_get_interface_value function to fetch interface value
  * @param cfgmgr_interface - cfgmgr_interface_t object
@@ -319,11 +534,37 @@ cfgmgr_interface_t* cfgmgr_get_client_by_name(cfgmgr_ctx_t* cfgmgr, const char*
 cfgmgr_interface_t* cfgmgr_get_client_by_index(cfgmgr_ctx_t* cfgmgr, int index);
 
 /**
- * cfgmgr_initialize function to create a new cfgmgr_ctx_t instance
+ * create_kv_store_config function to create the kv_store config of the
+ * application from the KVStore, DEV_MODE, AppName and CONFIGMGR_CERT,
+ * CONFIGMGR_KEY and CONFIGMGR_CACERT envs, as passed to create_kv_client()
+ *  @return NULL for any errors occured or config_t* on success
+ */
+config_t* create_kv_store_config();
+
+/**
+ * cfgmgr_initialize function to create a new cfgmgr_ctx_t instance. With
+ * CONFIGMGR_LAZY=true it does not connect to the kv_store, which happens
+ * along with fetching the config, the interfaces or watching the keys
+ * on the first call needing each of them. Nothing is set in the environment
+ * after cfgmgr_initialize() returns: the <TYPE>_* overrides and C_LOG_LEVEL
+ * of /GlobalEnv/ are then kept by the context, on top of the environment,
+ * and the rest of /GlobalEnv/ is not applied.
+ * With CONFIGMGR_ARENA=true message bus configs are built in an arena each
+ * instead of node by node on the heap.
  *  @return NULL for any errors occured or cfgmgr_ctx_t* on success
  */
 cfgmgr_ctx_t* cfgmgr_initialize();
 
+/**
+ * Scan the environment again for the <TYPE>_<Name>_ENDPOINT, <TYPE>_ENDPOINT,
+ * <TYPE>_<Name>_TYPE and <TYPE>_TYPE overrides, which are otherwise only read
+ * by cfgmgr_initialize(). Message bus configs fetched afterwards use them.
+ *
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_reload_env(cfgmgr_ctx_t* cfgmgr);
+
 /**
  * Destroy cfgmgr_ctx_t* object.
  *
@@ -338,7 +579,9 @@ void cfgmgr_destroy(cfgmgr_ctx_t *cfg_mgr);
 cfgmgr_interface_t* cfgmgr_interface_initialize();
 
 /**
- * Destroy cfgmgr_ctx_t* object.
+ * Destroy cfgmgr_interface_t* object, before the cfgmgr_ctx_t* it was
+ * returned by. Interfaces keep the interfaces document they were read
+ * from alive until then.
  *
  * @param cfg_mgr_interface - configuration to destroy
  */
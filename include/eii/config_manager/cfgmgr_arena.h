@@ -0,0 +1,218 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Arena allocator of the ConfigManager
+ *
+ * Bump allocator handing out memory from a list of chunks, all of which are
+ * freed at once when the arena is destroyed. It also builds cJSON trees
+ * whose nodes, keys and strings all live in the arena, so that a message
+ * bus configuration is a handful of chunks instead of hundreds of small
+ * heap allocations.
+ *
+ * Nodes of an arena tree must never be passed to cJSON_Delete() or to the
+ * cJSON functions adding, replacing or removing items; use the
+ * cfgmgr_arena_json_* functions to modify them. Reading them with cJSON,
+ * e.g. cJSON_Print() or cJSON_Duplicate(), is fine.
+ */
+
+#ifndef _EII_C_CFGMGR_ARENA_H
+#define _EII_C_CFGMGR_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <cjson/cJSON.h>
+#include "eii/utils/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Opaque arena
+ */
+typedef struct cfgmgr_arena cfgmgr_arena_t;
+
+/**
+ * Create an arena
+ *
+ * @param chunk_size - size of its chunks, larger allocations get their own
+ * @return @c cfgmgr_arena_t, or NULL on failure
+ */
+cfgmgr_arena_t* cfgmgr_arena_new(size_t chunk_size);
+
+/**
+ * Allocate memory aligned for any type, freed with the arena
+ *
+ * @param arena - arena
+ * @param size  - number of bytes
+ * @return pointer to the memory, or NULL on failure
+ */
+void* cfgmgr_arena_alloc(cfgmgr_arena_t* arena, size_t size);
+
+/**
+ * Copy the first @p len characters of a string into the arena
+ *
+ * @param arena - arena
+ * @param str   - string to copy
+ * @param len   - number of characters to copy
+ * @return NUL terminated copy, or NULL on failure
+ */
+char* cfgmgr_arena_strndup(cfgmgr_arena_t* arena, const char* str, size_t len);
+
+/**
+ * Copy a string into the arena
+ *
+ * @param arena - arena
+ * @param str   - string to copy
+ * @return copy, or NULL on failure
+ */
+char* cfgmgr_arena_strdup(cfgmgr_arena_t* arena, const char* str);
+
+/**
+ * Whether a pointer points into memory of the arena
+ *
+ * @param arena - arena
+ * @param ptr   - pointer
+ * @return true if @p ptr was allocated from @p arena
+ */
+bool cfgmgr_arena_owns(const cfgmgr_arena_t* arena, const void* ptr);
+
+/**
+ * Number of bytes reserved by the arena, chunk headers included
+ *
+ * @param arena - arena
+ * @return size of all the chunks of the arena
+ */
+size_t cfgmgr_arena_reserved(const cfgmgr_arena_t* arena);
+
+/**
+ * Free every chunk of the arena, and the arena itself
+ *
+ * @param arena - arena to destroy
+ */
+void cfgmgr_arena_destroy(cfgmgr_arena_t* arena);
+
+/**
+ * Create an empty JSON object in the arena
+ *
+ * @param arena - arena
+ * @return node, or NULL on failure
+ */
+cJSON* cfgmgr_arena_json_object(cfgmgr_arena_t* arena);
+
+/**
+ * Create an empty JSON array in the arena
+ *
+ * @param arena - arena
+ * @return node, or NULL on failure
+ */
+cJSON* cfgmgr_arena_json_array(cfgmgr_arena_t* arena);
+
+/**
+ * Create a JSON string in the arena
+ *
+ * @param arena - arena
+ * @param str   - value, copied into the arena
+ * @return node, or NULL on failure
+ */
+cJSON* cfgmgr_arena_json_string(cfgmgr_arena_t* arena, const char* str);
+
+/**
+ * Create a JSON number in the arena
+ *
+ * @param arena - arena
+ * @param num   - value
+ * @return node, or NULL on failure
+ */
+cJSON* cfgmgr_arena_json_number(cfgmgr_arena_t* arena, double num);
+
+/**
+ * Create a JSON boolean in the arena
+ *
+ * @param arena - arena
+ * @param value - value
+ * @return node, or NULL on failure
+ */
+cJSON* cfgmgr_arena_json_bool(cfgmgr_arena_t* arena, bool value);
+
+/**
+ * Deep copy a JSON tree, allocated anywhere, into the arena
+ *
+ * @param arena - arena
+ * @param src   - tree to copy
+ * @return root of the copy, or NULL on failure
+ */
+cJSON* cfgmgr_arena_json_copy(cfgmgr_arena_t* arena, const cJSON* src);
+
+/**
+ * Set a key of an arena object, replacing any previous value
+ *
+ * @param arena - arena of @p obj and @p item
+ * @param obj   - object
+ * @param key   - key, copied into the arena
+ * @param item  - value, not yet part of any tree; NULL fails
+ * @return true on success
+ */
+bool cfgmgr_arena_json_set(cfgmgr_arena_t* arena, cJSON* obj, const char* key, cJSON* item);
+
+/**
+ * Append an item to an arena array
+ *
+ * @param array - array
+ * @param item  - item of the same arena, not yet part of any tree
+ */
+void cfgmgr_arena_json_append(cJSON* array, cJSON* item);
+
+/**
+ * Create a configuration whose root is an empty object of the arena.
+ * Destroying it destroys the arena, and config_set() copies values into
+ * the arena. Like with json configs, objects and arrays whose
+ * @c config_value_t has no free function belong to the configuration once
+ * set, so they are freed after being copied.
+ *
+ * @param arena - arena, owned by the configuration on success
+ * @return @c config_t, or NULL on failure
+ */
+config_t* cfgmgr_arena_config_new(cfgmgr_arena_t* arena);
+
+/**
+ * Arena of a configuration created by cfgmgr_arena_config_new()
+ *
+ * @param config - configuration
+ * @return arena of @p config
+ */
+cfgmgr_arena_t* cfgmgr_arena_config_arena(const config_t* config);
+
+/**
+ * Deep copy a JSON tree into a new arena configuration
+ *
+ * @param src        - object to copy
+ * @param chunk_size - size of the chunks of the arena
+ * @return @c config_t to be destroyed by the caller, or NULL on failure
+ */
+config_t* cfgmgr_arena_config_copy(const cJSON* src, size_t chunk_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
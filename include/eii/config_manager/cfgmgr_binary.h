@@ -0,0 +1,247 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Compact binary form of resolved msgbus configs
+ *
+ * A resolved msgbus config can be compiled into one flat, versioned buffer
+ * which is read in place: no JSON is printed or parsed, strings are handed
+ * out as pointers into the buffer, and objects are looked up by binary
+ * search. The buffer holds no pointers, so it can be written to a file,
+ * shared memory or a socket and read by another process, from C, C++
+ * (eii/config_manager/binary_config.hpp) or Python (cfgmgr.binary_config).
+ *
+ * Layout, all integers little-endian:
+ *
+ *   header  "CFGB", u16 version, u16 reserved (0), u32 size, u32 root
+ *   node    u8 type (a @c cfgmgr_view_type_t), u8[3] reserved (0), u32 len,
+ *           followed by
+ *             BOOLEAN   nothing, len is 0 or 1
+ *             NULL      nothing
+ *             INTEGER   i64 value
+ *             FLOATING  f64 value
+ *             STRING    len bytes and a NUL, no NUL within
+ *             ARRAY     len u32 offsets of the items
+ *             OBJECT    len pairs of u32 offsets of the key (a STRING node)
+ *                       and of the value, sorted by key, keys unique
+ *
+ * Nodes start on 4 byte boundaries. root is the offset of the root node
+ * from the start of the buffer, other offsets are from the start of the
+ * node holding them and always point forward, so a buffer has no cycles.
+ * Readers check the whole buffer once in cfgmgr_binary_root(); accessors
+ * then read it without further checks.
+ */
+
+#ifndef _EII_C_CFGMGR_BINARY_H
+#define _EII_C_CFGMGR_BINARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <cjson/cJSON.h>
+#include "eii/config_manager/cfgmgr.h"
+#include "eii/config_manager/cfgmgr_view.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Magic of the binary form, at the start of the buffer
+#define CFGMGR_BINARY_MAGIC         "CFGB"
+
+// Version of the layout, bumped on incompatible changes
+#define CFGMGR_BINARY_VERSION       1
+
+// Size of the header preceding the nodes
+#define CFGMGR_BINARY_HEADER_SIZE   16
+
+/**
+ * Node of a checked buffer, passed by value
+ */
+typedef struct {
+    const void* node;
+} cfgmgr_binary_t;
+
+/**
+ * Position of an iteration over the items of an array or object
+ */
+typedef struct {
+    const void* node;
+    size_t index;
+} cfgmgr_binary_iter_t;
+
+/**
+ * Compile a JSON tree into the binary form
+ *
+ * @param json - tree to compile, ex: the cfg of a json or msgbus config_t
+ * @param size - set to the size of the buffer
+ * @return buffer to be freed with free(), or NULL on failure
+ */
+void* cfgmgr_binary_encode(const cJSON* json, size_t* size);
+
+/**
+ * Resolve the msgbus config of an interface, as cfgmgr_get_msgbus_config()
+ * does, into the binary form
+ *
+ * @param ctx  - cfgmgr_interface_t object
+ * @param size - set to the size of the buffer
+ * @return buffer to be freed with free(), or NULL on failure
+ */
+void* cfgmgr_get_msgbus_config_binary(cfgmgr_interface_t* ctx, size_t* size);
+
+/**
+ * Check a buffer and return its root node
+ *
+ * Every node of the buffer is checked, so that the other accessors can
+ * read it without bounds checks. The buffer must not change while nodes
+ * of it are used.
+ *
+ * @param buf  - buffer, of any alignment
+ * @param size - size of the buffer
+ * @return root node, of type CFGMGR_VIEW_NONE if the buffer is not a
+ *         valid binary config of a supported version
+ */
+cfgmgr_binary_t cfgmgr_binary_root(const void* buf, size_t size);
+
+/**
+ * Type of a node
+ *
+ * @param value - node
+ * @return @c cfgmgr_view_type_t
+ */
+cfgmgr_view_type_t cfgmgr_binary_type(cfgmgr_binary_t value);
+
+/**
+ * Value of a key of an object, found by binary search
+ *
+ * @param object - node of an object
+ * @param key    - key to look up
+ * @return node of the value, of type CFGMGR_VIEW_NONE if @p object is not
+ *         an object or has no such key
+ */
+cfgmgr_binary_t cfgmgr_binary_get(cfgmgr_binary_t object, const char* key);
+
+/**
+ * Item of an array
+ *
+ * @param array - node of an array
+ * @param index - index of the item
+ * @return node of the item, of type CFGMGR_VIEW_NONE if @p array is not an
+ *         array or @p index is out of range
+ */
+cfgmgr_binary_t cfgmgr_binary_at(cfgmgr_binary_t array, size_t index);
+
+/**
+ * Number of items of an array or keys of an object
+ *
+ * @param value - node
+ * @return number of items, 0 for any other type
+ */
+size_t cfgmgr_binary_len(cfgmgr_binary_t value);
+
+/**
+ * String value of a node
+ *
+ * @param value - node
+ * @param str   - set to the NUL terminated string, inside the buffer
+ * @param len   - set to the length of the string, may be NULL
+ * @return false if the node is not a string
+ */
+bool cfgmgr_binary_string(cfgmgr_binary_t value, const char** str, size_t* len);
+
+/**
+ * Integer value of a node
+ *
+ * @param value  - node
+ * @param result - set to the value
+ * @return false if the node is not an integer
+ */
+bool cfgmgr_binary_integer(cfgmgr_binary_t value, int64_t* result);
+
+/**
+ * Floating point value of a node, integers included
+ *
+ * @param value  - node
+ * @param result - set to the value
+ * @return false if the node is not a number
+ */
+bool cfgmgr_binary_floating(cfgmgr_binary_t value, double* result);
+
+/**
+ * Boolean value of a node
+ *
+ * @param value  - node
+ * @param result - set to the value
+ * @return false if the node is not a boolean
+ */
+bool cfgmgr_binary_boolean(cfgmgr_binary_t value, bool* result);
+
+/**
+ * Start iterating over the items of an array or object, objects are
+ * iterated in key order
+ *
+ * @param value - node of an array or object
+ * @return iteration position, at the end for any other type
+ */
+cfgmgr_binary_iter_t cfgmgr_binary_iter(cfgmgr_binary_t value);
+
+/**
+ * Next item of an iteration
+ *
+ * @param iter - iteration position, advanced on success
+ * @param item - set to the item
+ * @param key  - set to the key of the item in an object, NULL in an
+ *               array; may be NULL
+ * @return false at the end of the iteration
+ */
+bool cfgmgr_binary_next(cfgmgr_binary_iter_t* iter, cfgmgr_binary_t* item, const char** key);
+
+/**
+ * Decode a node and everything it holds back into a JSON tree
+ *
+ * @param value - node
+ * @return tree to be freed with cJSON_Delete(), or NULL on failure or for
+ *         a node of type CFGMGR_VIEW_NONE
+ */
+cJSON* cfgmgr_binary_decode(cfgmgr_binary_t value);
+
+/**
+ * Read-only @c config_t over a buffer, for APIs taking a config_t such as
+ * msgbus_initialize()
+ *
+ * Values are read from the buffer, which is borrowed: it must outlive the
+ * configuration and is not freed with it. Objects and arrays got from the
+ * configuration reference the buffer and can't be set into other
+ * configurations.
+ *
+ * @param buf  - buffer, checked as by cfgmgr_binary_root()
+ * @param size - size of the buffer
+ * @return @c config_t to be destroyed by the caller, or NULL if the buffer
+ *         is not valid or its root is not an object
+ */
+config_t* cfgmgr_binary_config_new(const void* buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
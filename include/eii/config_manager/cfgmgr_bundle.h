@@ -0,0 +1,215 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Config bundles baked by cfgmgr-bake
+ *
+ * A bundle holds every key the applications it was baked for read at
+ * startup: /GlobalEnv/, /<AppName>/interfaces, /<AppName>/config and, in
+ * prod mode, their private keys and the public keys. It also holds the
+ * msgbus config of every interface of those applications, resolved by the
+ * msgbus config builders when baking. Setting CONFIGMGR_BUNDLE makes
+ * cfgmgr_initialize() load the bundle instead of connecting to the
+ * kv_store, and serve the baked msgbus configs without building them.
+ *
+ * Bundles are written in the binary form of cfgmgr_binary.h, sealed as
+ * described in cfgmgr_seal.h, as the object:
+ *
+ *   {
+ *     "Bundle": 1,
+ *     "DevMode": true,
+ *     "Keys": {"/GlobalEnv/": "{...}", "/<AppName>/interfaces": "{...}", ...},
+ *     "Apps": {
+ *       "<AppName>": {"Publishers": [{...}], "Subscribers": [], "Servers": [], "Clients": []}
+ *     }
+ *   }
+ *
+ * where the msgbus configs of an application are in the order of its
+ * interfaces. Bundles baked in prod mode hold a private key: they are only
+ * written encrypted, with one application each, see cfgmgr_bundle_app().
+ * Files are created with mode 0600.
+ */
+
+#ifndef _EII_C_CFGMGR_BUNDLE_H
+#define _EII_C_CFGMGR_BUNDLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "eii/config_manager/cfgmgr.h"
+#include "eii/config_manager/cfgmgr_seal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Version of the bundle content, bumped on incompatible changes
+#define CFGMGR_BUNDLE_VERSION   2
+
+// Largest bundle file loaded
+#define CFGMGR_BUNDLE_MAX_SIZE  (256 * 1024 * 1024)
+
+/**
+ * Opaque config bundle
+ */
+typedef struct cfgmgr_bundle cfgmgr_bundle_t;
+
+/**
+ * Bake a bundle: read the keys of the applications from the kv_store, in
+ * one get_batch() call when the kv_store has it, then resolve the msgbus
+ * configs of every interface of every application from those keys
+ *
+ * @param client    - initialized kv_store client to read from
+ * @param handle    - handle returned by the init() of @p client
+ * @param dev_mode  - whether the applications run in dev mode, no keys
+ *                    are baked then
+ * @param app_names - AppNames of the applications
+ * @param count     - number of AppNames, 0 for every application with
+ *                    /<AppName>/interfaces in the kv_store
+ * @return @c cfgmgr_bundle_t to be destroyed with cfgmgr_bundle_destroy(),
+ *         or NULL on failure
+ */
+cfgmgr_bundle_t* cfgmgr_bundle_bake(kv_store_client_t* client, void* handle, bool dev_mode,
+                                    const char* const* app_names, size_t count);
+
+/**
+ * Bundle of one application of a bundle: its msgbus configs and the keys
+ * it reads, so of the private keys only its own
+ *
+ * @param bundle   - bundle
+ * @param app_name - AppName of the application
+ * @return @c cfgmgr_bundle_t to be destroyed with cfgmgr_bundle_destroy(),
+ *         or NULL if the application is not in @p bundle or on failure
+ */
+cfgmgr_bundle_t* cfgmgr_bundle_app(const cfgmgr_bundle_t* bundle, const char* app_name);
+
+/**
+ * Write a bundle to a file, atomically replacing it. Bundles baked in prod
+ * mode must be encrypted and hold one application.
+ *
+ * @param bundle - bundle to write
+ * @param path   - file, created with mode 0600
+ * @param key    - CFGMGR_SEAL_KEY_SIZE bytes encrypting the bundle, NULL
+ *                 to only checksum a bundle baked in dev mode
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_bundle_write(const cfgmgr_bundle_t* bundle, const char* path,
+                        const unsigned char* key);
+
+/**
+ * Read a bundle written by cfgmgr_bundle_write()
+ *
+ * @param path - file
+ * @param key  - key the bundle was encrypted with, NULL if it was not
+ * @return @c cfgmgr_bundle_t to be destroyed with cfgmgr_bundle_destroy(),
+ *         or NULL if the file is missing, corrupted, of another version or
+ *         not sealed with @p key
+ */
+cfgmgr_bundle_t* cfgmgr_bundle_read(const char* path, const unsigned char* key);
+
+/**
+ * Whether a bundle was baked in dev mode
+ *
+ * @param bundle - bundle
+ * @return true for dev mode
+ */
+bool cfgmgr_bundle_dev_mode(const cfgmgr_bundle_t* bundle);
+
+/**
+ * Number of applications of a bundle
+ *
+ * @param bundle - bundle
+ * @return number of applications
+ */
+size_t cfgmgr_bundle_app_count(const cfgmgr_bundle_t* bundle);
+
+/**
+ * AppName of an application of a bundle, in AppName order
+ *
+ * @param bundle - bundle
+ * @param index  - index of the application
+ * @return AppName valid until the bundle is destroyed, NULL if @p index is
+ *         out of range
+ */
+const char* cfgmgr_bundle_app_name(const cfgmgr_bundle_t* bundle, size_t index);
+
+/**
+ * Read-only kv_store client serving the keys of a bundle
+ *
+ * @param bundle - bundle
+ * @return @c kv_store_client_t independent of the bundle, to be freed with
+ *         kv_client_free(), or NULL on failure
+ */
+kv_store_client_t* cfgmgr_bundle_kv_client(const cfgmgr_bundle_t* bundle);
+
+/**
+ * Baked msgbus config of an interface
+ *
+ * @param bundle   - bundle
+ * @param app_name - AppName of the application
+ * @param type     - type of the interface
+ * @param index    - index of the interface among those of its type
+ * @return JSON @c config_t to be destroyed by the caller, NULL if none was
+ *         baked
+ */
+config_t* cfgmgr_bundle_msgbus_config(const cfgmgr_bundle_t* bundle, const char* app_name,
+                                      cfgmgr_iface_type_t type, int index);
+
+/**
+ * Initialize the context of an application from a bundle, as
+ * cfgmgr_initialize() does with CONFIGMGR_BUNDLE set. Nothing is connected
+ * to, the baked msgbus configs of the application are served without
+ * building them and the others are built from the baked keys.
+ *
+ * @param bundle   - bundle, only used during the call
+ * @param app_name - AppName of the application
+ * @return @c cfgmgr_ctx_t to be destroyed with cfgmgr_destroy(), or NULL on
+ *         failure
+ */
+cfgmgr_ctx_t* cfgmgr_bundle_initialize(const cfgmgr_bundle_t* bundle, const char* app_name);
+
+/**
+ * Initialize the context cfgmgr_bundle_bake() resolves the msgbus configs
+ * of an application with: as cfgmgr_bundle_initialize(), but the
+ * <TYPE>_* overrides are not read from the environment and /GlobalEnv/ is
+ * not set in it. The baked configs then neither depend on the environment
+ * of the baking process nor on the applications baked before; overrides
+ * apply when the application starts from the bundle.
+ *
+ * @param bundle   - bundle, only used during the call
+ * @param app_name - AppName of the application
+ * @return @c cfgmgr_ctx_t to be destroyed with cfgmgr_destroy(), or NULL on
+ *         failure
+ */
+cfgmgr_ctx_t* cfgmgr_bundle_bake_initialize(const cfgmgr_bundle_t* bundle, const char* app_name);
+
+/**
+ * Destroy a bundle
+ *
+ * @param bundle - bundle
+ */
+void cfgmgr_bundle_destroy(cfgmgr_bundle_t* bundle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Structural diff of ConfigManager documents
+ *
+ * Compares two snapshots of the application config or interfaces documents
+ * and lists what changed between them as typed change events, so that
+ * applications can restart only the message bus sockets affected by an
+ * update instead of rebuilding every publisher and subscriber.
+ *
+ * Config changes are reported per leaf: objects are compared key by key,
+ * any other value (including arrays) is compared as a whole. Interfaces are
+ * matched by type and Name; an interface is reported added or removed as a
+ * whole, otherwise every key of it which changed is reported. Topics and
+ * AllowedClients are compared as sets and report the entries added and
+ * removed.
+ */
+
+#ifndef _EII_C_CFGMGR_DIFF_H
+#define _EII_C_CFGMGR_DIFF_H
+
+#include <stdbool.h>
+#include "eii/utils/config.h"
+#include "eii/config_manager/cfgmgr_util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Kind of a change
+ */
+typedef enum {
+    CFGMGR_CHANGE_ADDED     = 0,
+    CFGMGR_CHANGE_REMOVED   = 1,
+    CFGMGR_CHANGE_MODIFIED  = 2,
+} cfgmgr_change_kind_t;
+
+/**
+ * One change between two snapshots
+ */
+typedef struct {
+    cfgmgr_change_kind_t kind;
+
+    // Keys leading to the changed value joined with '.', e.g. "a.b.c", or
+    // "Publishers.<Name>[.<key>]" for interfaces ("Publishers[<i>]..."
+    // for an interface without Name)
+    const char* path;
+
+    // Set for changes of the interfaces document
+    bool iface;
+
+    // Type and Name of the changed interface, name NULL if it has none
+    cfgmgr_iface_type_t iface_type;
+    const char* iface_name;
+
+    // Key of the interface which changed, NULL when the whole interface
+    // was added or removed
+    const char* field;
+
+    // Topics or AllowedClients entry added or removed, NULL otherwise
+    const char* item;
+
+    // Unformatted JSON of the value before and after the change, NULL
+    // when absent; for an entry of Topics or AllowedClients the entry
+    const char* old_value;
+    const char* new_value;
+} cfgmgr_change_t;
+
+/**
+ * Changes between two snapshots: changed and removed values in the order of
+ * the previous snapshot, then added values in the order of the new one
+ */
+typedef struct {
+    cfgmgr_change_t* changes;
+    size_t count;
+} cfgmgr_changes_t;
+
+/**
+ * Compare two application config documents
+ *
+ * @param old_config - previous config, NULL for an empty one
+ * @param new_config - new config, NULL for an empty one
+ * @return @c cfgmgr_changes_t to be destroyed with cfgmgr_changes_destroy(),
+ *         NULL on failure
+ */
+cfgmgr_changes_t* cfgmgr_diff_config(const config_t* old_config, const config_t* new_config);
+
+/**
+ * Compare two interfaces documents
+ *
+ * @param old_interfaces - previous interfaces, NULL for an empty one
+ * @param new_interfaces - new interfaces, NULL for an empty one
+ * @return @c cfgmgr_changes_t to be destroyed with cfgmgr_changes_destroy(),
+ *         NULL on failure
+ */
+cfgmgr_changes_t* cfgmgr_diff_interfaces(const config_t* old_interfaces,
+                                         const config_t* new_interfaces);
+
+/**
+ * Destroy a list of changes
+ *
+ * @param changes - changes returned by cfgmgr_diff_config() or
+ *                  cfgmgr_diff_interfaces()
+ */
+void cfgmgr_changes_destroy(cfgmgr_changes_t* changes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Environment overrides of the ConfigManager
+ *
+ * Table of the <TYPE>_<Name>_ENDPOINT, <TYPE>_ENDPOINT, <TYPE>_<Name>_TYPE
+ * and <TYPE>_TYPE environment variables overriding the EndPoint and Type of
+ * interfaces, where <TYPE> is PUBLISHER, SUBSCRIBER, SERVER or CLIENT. The
+ * environment is scanned on load only. A /GlobalEnv/ document kept by the
+ * table overrides the environment, as setting its entries would. Each load publishes a generation of
+ * the table in a @c cfgmgr_gens_t store, so values looked up while pinned
+ * with cfgmgr_env_overrides_pin() stay valid until unpinned, even across
+ * loads, and replaced generations are freed once nothing pins them.
+ */
+
+#ifndef _EII_C_CFGMGR_ENV_OVERRIDES_H
+#define _EII_C_CFGMGR_ENV_OVERRIDES_H
+
+#include "eii/config_manager/cfgmgr_util.h"
+#include "eii/config_manager/cfgmgr_generations.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Interface field overridden by the environment
+ */
+typedef enum {
+    CFGMGR_OVERRIDE_ENDPOINT = 0,
+    CFGMGR_OVERRIDE_TYPE = 1,
+} cfgmgr_override_field_t;
+
+/**
+ * Opaque environment override table
+ */
+typedef struct cfgmgr_env_overrides cfgmgr_env_overrides_t;
+
+/**
+ * Create an empty environment override table
+ *
+ * @return @c cfgmgr_env_overrides_t, or NULL on failure
+ */
+cfgmgr_env_overrides_t* cfgmgr_env_overrides_new();
+
+/**
+ * Scan the environment and make the overrides found the current ones
+ *
+ * @param overrides - environment override table
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_env_overrides_load(cfgmgr_env_overrides_t* overrides);
+
+/**
+ * Keep the entries of a /GlobalEnv/ document on top of the environment, for
+ * this and every later load, instead of setting them in the environment
+ * while other threads may run. Then load the table.
+ *
+ * @param overrides  - environment override table
+ * @param global_env - /GlobalEnv/ JSON object, replacing any kept before
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_env_overrides_load_global_env(cfgmgr_env_overrides_t* overrides, const char* global_env);
+
+/**
+ * Pin the table, lock-free
+ *
+ * @param overrides - environment override table
+ * @return guard to pass to cfgmgr_env_overrides_unpin()
+ */
+cfgmgr_gen_guard_t cfgmgr_env_overrides_pin(cfgmgr_env_overrides_t* overrides);
+
+/**
+ * Unpin the table
+ *
+ * @param overrides - environment override table
+ * @param guard     - guard returned by cfgmgr_env_overrides_pin(), reset
+ */
+void cfgmgr_env_overrides_unpin(cfgmgr_env_overrides_t* overrides, cfgmgr_gen_guard_t* guard);
+
+/**
+ * Number of replaced generations not freed yet
+ *
+ * @param overrides - environment override table
+ * @return count
+ */
+size_t cfgmgr_env_overrides_retired(cfgmgr_env_overrides_t* overrides);
+
+/**
+ * Look up an override, while pinned. Overrides set to an empty string are
+ * ignored.
+ *
+ * @param overrides - environment override table
+ * @param type      - interface type
+ * @param name      - value of the Name key of the interface, NULL for the
+ *                    override of every interface of the type
+ * @param field     - field overridden
+ * @return value owned by the table, valid while pinned, NULL if not
+ *         overridden
+ */
+const char* cfgmgr_env_overrides_get(cfgmgr_env_overrides_t* overrides, cfgmgr_iface_type_t type,
+                                     const char* name, cfgmgr_override_field_t field);
+
+/**
+ * Destroy the table and every value it handed out. Nothing may be pinned.
+ *
+ * @param overrides - environment override table
+ */
+void cfgmgr_env_overrides_destroy(cfgmgr_env_overrides_t* overrides);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
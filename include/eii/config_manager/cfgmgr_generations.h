@@ -0,0 +1,191 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Generations of the ConfigManager immutable tables
+ *
+ * Holds the current generation of a table which is rebuilt as a whole,
+ * such as the interface index, and reclaims the generations it replaced.
+ * Publishing swaps the current generation with an atomic pointer store and
+ * retires the previous one at the current epoch.
+ *
+ * Readers pin the store with cfgmgr_gens_pin(), which claims a reader slot
+ * tagged with the current epoch without locking; any generation they load
+ * while pinned stays valid until they unpin. Pointers kept past a pin are
+ * covered by a reference taken with cfgmgr_gens_ref() while pinned. A
+ * retired generation is freed once it is older than every pinned epoch and
+ * no reference is left, by the publish or the unref which comes last.
+ *
+ * Generations are typically open addressing tables, sized with
+ * cfgmgr_gen_capacity() and probed linearly from cfgmgr_gen_hash().
+ */
+
+#ifndef _EII_C_CFGMGR_GENERATIONS_H
+#define _EII_C_CFGMGR_GENERATIONS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Frees a generation no reader can see anymore
+ */
+typedef void (*cfgmgr_gen_free_t)(void* gen);
+
+/**
+ * Matches a generation against an argument, see cfgmgr_gens_find()
+ */
+typedef bool (*cfgmgr_gen_match_t)(const void* gen, const void* arg);
+
+/**
+ * Pin held by a reader
+ */
+typedef struct {
+    // Current generation when pinned, NULL if none was published
+    void* gen;
+
+    // Reader slot holding the pin, -1 once unpinned
+    int slot;
+} cfgmgr_gen_guard_t;
+
+/**
+ * Opaque generation store
+ */
+typedef struct cfgmgr_gens cfgmgr_gens_t;
+
+/**
+ * Create an empty generation store
+ *
+ * @param free_gen - frees the generations the store reclaims
+ * @return @c cfgmgr_gens_t, or NULL on failure
+ */
+cfgmgr_gens_t* cfgmgr_gens_new(cfgmgr_gen_free_t free_gen);
+
+/**
+ * Make @p gen the current generation, retire the previous one and
+ * reclaim the retired generations nobody can read anymore. The store
+ * takes ownership of @p gen.
+ *
+ * @param gens - generation store
+ * @param gen  - new generation
+ * @return 0 on success, -1 on failure, @p gen is then left to the caller
+ */
+int cfgmgr_gens_publish(cfgmgr_gens_t* gens, void* gen);
+
+/**
+ * Current generation, only valid while pinned or referenced
+ *
+ * @param gens - generation store
+ * @return current generation, NULL if none was published
+ */
+void* cfgmgr_gens_current(cfgmgr_gens_t* gens);
+
+/**
+ * Pin the store, lock-free
+ *
+ * @param gens - generation store
+ * @return guard to pass to cfgmgr_gens_unpin()
+ */
+cfgmgr_gen_guard_t cfgmgr_gens_pin(cfgmgr_gens_t* gens);
+
+/**
+ * Unpin the store
+ *
+ * @param gens  - generation store
+ * @param guard - guard returned by cfgmgr_gens_pin(), reset
+ */
+void cfgmgr_gens_unpin(cfgmgr_gens_t* gens, cfgmgr_gen_guard_t* guard);
+
+/**
+ * Reference a generation, which must be pinned or already referenced
+ *
+ * @param gens - generation store
+ * @param gen  - generation of the store
+ * @return 0 on success, -1 if @p gen is not a generation of the store
+ */
+int cfgmgr_gens_ref(cfgmgr_gens_t* gens, const void* gen);
+
+/**
+ * Drop a reference taken with cfgmgr_gens_ref(), reclaiming the
+ * generation if it was retired and nobody can read it anymore
+ *
+ * @param gens - generation store
+ * @param gen  - referenced generation
+ */
+void cfgmgr_gens_unref(cfgmgr_gens_t* gens, const void* gen);
+
+/**
+ * Find the current or a retired generation, which must be pinned or
+ * referenced to be used
+ *
+ * @param gens  - generation store
+ * @param match - returns true for the generation looked for
+ * @param arg   - argument of @p match
+ * @return generation, NULL if none matches
+ */
+void* cfgmgr_gens_find(cfgmgr_gens_t* gens, cfgmgr_gen_match_t match, const void* arg);
+
+/**
+ * Number of retired generations not reclaimed yet
+ *
+ * @param gens - generation store
+ * @return count
+ */
+size_t cfgmgr_gens_retired(cfgmgr_gens_t* gens);
+
+/**
+ * Destroy the store and every generation, referenced or not. Nothing may
+ * be pinned.
+ *
+ * @param gens - generation store
+ */
+void cfgmgr_gens_destroy(cfgmgr_gens_t* gens);
+
+/**
+ * FNV-1a hash of a string, mixed with a tag so that equal strings of
+ * different kinds land in different slots
+ *
+ * @param str - string
+ * @param len - number of bytes of @p str hashed
+ * @param tag - kind of the string, 0 for none
+ * @return hash
+ */
+uint32_t cfgmgr_gen_hash(const char* str, size_t len, uint32_t tag);
+
+/**
+ * Capacity of a table holding @p count entries: the power of two, at
+ * least 8, which keeps the load factor under 0.5
+ *
+ * @param count - number of entries
+ * @return capacity
+ */
+size_t cfgmgr_gen_capacity(size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
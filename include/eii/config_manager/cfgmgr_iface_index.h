@@ -0,0 +1,327 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Interface index of the ConfigManager
+ *
+ * Maps (interface type, Name) to the parsed interface of the application,
+ * so that interfaces are looked up by name without scanning the
+ * Publishers, Subscribers, Servers or Clients arrays. The index owns the
+ * interfaces documents it is built from. Updating it publishes a new
+ * generation in a @c cfgmgr_gens_t store: lookups are only valid while the
+ * index is pinned with cfgmgr_iface_index_pin(), and models or documents
+ * kept past a pin are referenced with cfgmgr_iface_index_ref() or
+ * cfgmgr_iface_index_acquire_interfaces(). A replaced generation is freed
+ * once nothing pins or references it. Every reference also keeps the index
+ * itself alive, so models may be released after the index is destroyed.
+ *
+ * Each generation also compiles every interface into a typed
+ * @c cfgmgr_iface_model_t: strings are interned once per generation, the
+ * transport and TCP host/port are parsed and the JSON type of every known
+ * key is validated, so accessors and msgbus config builders read plain
+ * struct fields instead of walking cJSON on every call.
+ */
+
+#ifndef _EII_C_CFGMGR_IFACE_INDEX_H
+#define _EII_C_CFGMGR_IFACE_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "eii/utils/config.h"
+#include "eii/config_manager/cfgmgr_util.h"
+#include "eii/config_manager/cfgmgr_generations.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transport of an interface, parsed from its Type key
+ */
+typedef enum {
+    CFGMGR_TRANSPORT_OTHER   = 0,
+    CFGMGR_TRANSPORT_ZMQ_TCP = 1,
+    CFGMGR_TRANSPORT_ZMQ_IPC = 2,
+} cfgmgr_transport_t;
+
+/**
+ * Bits of @c cfgmgr_iface_model_t.invalid, set for keys which are present
+ * in the interface with an unexpected JSON type
+ */
+typedef enum {
+    CFGMGR_IFACE_BAD_NAME               = 1 << 0,
+    CFGMGR_IFACE_BAD_TYPE               = 1 << 1,
+    CFGMGR_IFACE_BAD_ENDPOINT           = 1 << 2,
+    CFGMGR_IFACE_BAD_TOPICS             = 1 << 3,
+    CFGMGR_IFACE_BAD_ALLOWED_CLIENTS    = 1 << 4,
+    CFGMGR_IFACE_BAD_ZMQ_RECV_HWM       = 1 << 5,
+    CFGMGR_IFACE_BAD_BROKERED           = 1 << 6,
+    CFGMGR_IFACE_BAD_BROKER_APPNAME     = 1 << 7,
+    CFGMGR_IFACE_BAD_PUBLISHER_APPNAME  = 1 << 8,
+    CFGMGR_IFACE_BAD_SERVER_APPNAME     = 1 << 9,
+} cfgmgr_iface_invalid_t;
+
+/**
+ * Immutable list of strings of an interface (Topics or AllowedClients)
+ */
+typedef struct {
+    // Interned strings, in document order
+    const char** items;
+    size_t count;
+
+    // Single "*" entry
+    bool wildcard;
+
+    // cJSON array handed out by the accessors; for a wildcard Topics list
+    // this is the [""] array the message bus subscribes to everything with
+    const void* array;
+} cfgmgr_iface_strings_t;
+
+/**
+ * Compiled interface. Strings point into the generation it was compiled
+ * with and every field is NULL/false when the key is absent or invalid.
+ */
+typedef struct {
+    cfgmgr_iface_type_t iface_type;
+
+    // Bitmask of cfgmgr_iface_invalid_t
+    uint32_t invalid;
+
+    const char* name;
+
+    // Value of the Type key and the transport it names
+    const char* type;
+    cfgmgr_transport_t transport;
+
+    // EndPoint, either a string or an object (ipc socket directory/file)
+    const char* endpoint;
+    const void* endpoint_object;
+
+    // Host and port parsed from a zmq_tcp string EndPoint
+    bool has_host_port;
+    const char* host;
+    int64_t port;
+
+    // Topics, changed only by publishing a new generation with
+    // cfgmgr_iface_index_set_topics()
+    const cfgmgr_iface_strings_t* topics;
+
+    const cfgmgr_iface_strings_t* allowed_clients;
+
+    const char* broker_appname;
+    const char* publisher_appname;
+    const char* server_appname;
+
+    bool has_zmq_recv_hwm;
+    int64_t zmq_recv_hwm;
+
+    bool has_brokered;
+    bool brokered;
+
+    // Interface object in the interfaces document
+    const void* node;
+} cfgmgr_iface_model_t;
+
+/**
+ * Opaque interface index
+ */
+typedef struct cfgmgr_iface_index cfgmgr_iface_index_t;
+
+/**
+ * Create an empty interface index
+ *
+ * @return @c cfgmgr_iface_index_t, or NULL on failure
+ */
+cfgmgr_iface_index_t* cfgmgr_iface_index_new();
+
+/**
+ * Index a new interfaces document and make it the current one. On success
+ * the index takes ownership of @p app_interface.
+ *
+ * @param index         - interface index
+ * @param app_interface - /<AppName>/interfaces document
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_iface_index_update(cfgmgr_iface_index_t* index, config_t* app_interface);
+
+/**
+ * Pin the index, lock-free. Lookups made until it is unpinned stay valid
+ * until then, even if the index is updated meanwhile.
+ *
+ * @param index - interface index
+ * @return guard to pass to cfgmgr_iface_index_unpin()
+ */
+cfgmgr_gen_guard_t cfgmgr_iface_index_pin(cfgmgr_iface_index_t* index);
+
+/**
+ * Unpin the index
+ *
+ * @param index - interface index
+ * @param guard - guard returned by cfgmgr_iface_index_pin(), reset
+ */
+void cfgmgr_iface_index_unpin(cfgmgr_iface_index_t* index, cfgmgr_gen_guard_t* guard);
+
+/**
+ * Reference the generation of a model, which then stays valid until
+ * cfgmgr_iface_index_unref(), even if the index is destroyed meanwhile
+ *
+ * @param index - interface index
+ * @param model - model looked up while pinned, or already referenced
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_iface_index_ref(cfgmgr_iface_index_t* index, const cfgmgr_iface_model_t* model);
+
+/**
+ * Drop a reference taken with cfgmgr_iface_index_ref()
+ *
+ * @param index - interface index
+ * @param model - referenced model
+ */
+void cfgmgr_iface_index_unref(cfgmgr_iface_index_t* index, const cfgmgr_iface_model_t* model);
+
+/**
+ * Current interfaces document of the index, valid while pinned
+ *
+ * @param index - interface index
+ * @return @c config_t owned by the index, NULL if never updated
+ */
+config_t* cfgmgr_iface_index_interfaces(cfgmgr_iface_index_t* index);
+
+/**
+ * Reference the current interfaces document, which stays valid until
+ * released with cfgmgr_iface_index_release_interfaces()
+ *
+ * @param index - interface index
+ * @return @c config_t owned by the index, NULL if never updated
+ */
+config_t* cfgmgr_iface_index_acquire_interfaces(cfgmgr_iface_index_t* index);
+
+/**
+ * Release a document referenced by cfgmgr_iface_index_acquire_interfaces()
+ *
+ * @param index         - interface index
+ * @param app_interface - document to release, may be NULL
+ */
+void cfgmgr_iface_index_release_interfaces(cfgmgr_iface_index_t* index, config_t* app_interface);
+
+/**
+ * Current interfaces document, valid until a later call returns a newer
+ * document or the index is destroyed
+ *
+ * @param index - interface index
+ * @return @c config_t owned by the index, NULL if never updated
+ */
+config_t* cfgmgr_iface_index_app_interface(cfgmgr_iface_index_t* index);
+
+/**
+ * Number of replaced generations not freed yet
+ *
+ * @param index - interface index
+ * @return count
+ */
+size_t cfgmgr_iface_index_retired(cfgmgr_iface_index_t* index);
+
+/**
+ * Look up an interface by type and name
+ *
+ * @param index - interface index
+ * @param type  - interface type
+ * @param name  - value of the Name key of the interface
+ * @return new @c config_value_t object referencing the interface, valid
+ *         while pinned, which must be destroyed by the caller, or NULL if
+ *         not found
+ */
+config_value_t* cfgmgr_iface_index_get(cfgmgr_iface_index_t* index, cfgmgr_iface_type_t type,
+                                       const char* name);
+
+/**
+ * Look up the compiled model of an interface by type and name
+ *
+ * @param index - interface index
+ * @param type  - interface type
+ * @param name  - value of the Name key of the interface
+ * @return model owned by the index, valid while pinned, or NULL if not found
+ */
+const cfgmgr_iface_model_t* cfgmgr_iface_index_find(cfgmgr_iface_index_t* index,
+                                                    cfgmgr_iface_type_t type,
+                                                    const char* name);
+
+/**
+ * Compiled model of the interface at a position of the Publishers,
+ * Subscribers, Servers or Clients array
+ *
+ * @param index - interface index
+ * @param type  - interface type
+ * @param i     - position in the array
+ * @return model owned by the index, valid while pinned, or NULL if out of
+ *         range
+ */
+const cfgmgr_iface_model_t* cfgmgr_iface_index_at(cfgmgr_iface_index_t* index,
+                                                  cfgmgr_iface_type_t type, int i);
+
+/**
+ * Number of interfaces of a type
+ *
+ * @param index - interface index
+ * @param type  - interface type
+ * @return array length, or -1 if the array is absent or not an array
+ */
+int cfgmgr_iface_index_count(cfgmgr_iface_index_t* index, cfgmgr_iface_type_t type);
+
+/**
+ * Topics of a model
+ *
+ * @param model - compiled interface
+ * @return topics, or NULL if the interface has no valid Topics array
+ */
+const cfgmgr_iface_strings_t* cfgmgr_iface_model_topics(const cfgmgr_iface_model_t* model);
+
+/**
+ * Publish a new generation in which the interface of a model has the given
+ * Topics. The published documents are not modified: the current document is
+ * copied, so models of older generations keep their Topics. The interface is
+ * looked up in the current generation by (type, Name) if the model belongs
+ * to an older one.
+ *
+ * @param index  - interface index
+ * @param model  - referenced model
+ * @param topics - cJSON array of the new Topics, copied
+ * @return referenced model of the new generation, release it with
+ *         cfgmgr_iface_index_unref(), or NULL on failure
+ */
+const cfgmgr_iface_model_t* cfgmgr_iface_index_set_topics(cfgmgr_iface_index_t* index,
+                                                          const cfgmgr_iface_model_t* model,
+                                                          const void* topics);
+
+/**
+ * Drop the reference of the creator of the index. The index and its
+ * interfaces documents are freed once no model or document is referenced
+ * anymore. Nothing may be pinned.
+ *
+ * @param index - interface index
+ */
+void cfgmgr_iface_index_destroy(cfgmgr_iface_index_t* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
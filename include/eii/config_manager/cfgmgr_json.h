@@ -0,0 +1,118 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief JSON parsing of the ConfigManager
+ *
+ * Parses the JSON documents of the kv_store (the application config and
+ * interfaces, GlobalEnv, watch events) into the cJSON trees the rest of
+ * the ConfigManager and @c config_t work on. When built WITH_SIMDJSON,
+ * documents of at least @c CFGMGR_JSON_SIMD_MIN_SIZE bytes are parsed with
+ * simdjson's on-demand parser, which validates and tokenizes the document
+ * with SIMD instructions, and the cJSON tree is built from it in one pass.
+ * Smaller documents, and builds without simdjson, use cJSON.
+ *
+ * Flat objects with many members, like GlobalEnv, can instead be streamed
+ * with cfgmgr_json_each_member(), which hands out every member as it is
+ * tokenized without building a tree of the document.
+ */
+
+#ifndef _EII_C_CFGMGR_JSON_H
+#define _EII_C_CFGMGR_JSON_H
+
+#include <stddef.h>
+#include <cjson/cJSON.h>
+#include "eii/utils/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size from which documents are parsed with simdjson, when built with it
+#ifndef CFGMGR_JSON_SIMD_MIN_SIZE
+#define CFGMGR_JSON_SIMD_MIN_SIZE   16384
+#endif
+
+/**
+ * Parse a JSON document
+ *
+ * @param buf - document, not necessarily NUL terminated
+ * @param len - length of the document
+ * @return cJSON tree to be freed with cJSON_Delete(), or NULL if the
+ *         document is not valid JSON
+ */
+cJSON* cfgmgr_json_parse(const char* buf, size_t len);
+
+/**
+ * Drop-in for json_config_new_from_buffer(), parsing with
+ * cfgmgr_json_parse()
+ *
+ * @param buf - NUL terminated JSON document
+ * @return @c config_t to be destroyed by the caller, or NULL on failure
+ */
+config_t* cfgmgr_json_config_new(const char* buf);
+
+/**
+ * Callback of cfgmgr_json_each_member(), called with every member of the
+ * object in document order
+ *
+ * @param key       - unescaped key of the member
+ * @param value     - unescaped value for strings, the JSON text of the
+ *                    value for other types (ex: "42", "true", "null")
+ * @param user_data - user data passed
+ * @return 0 to go on, any other value stops the parsing
+ */
+typedef int (*cfgmgr_json_member_cb_t)(const char* key, const char* value, void* user_data);
+
+/**
+ * Stream the members of a JSON object, decoding each key and value into a
+ * buffer reused for every member; no tree of the document is built
+ *
+ * @param buf       - document, not necessarily NUL terminated
+ * @param len       - length of the document
+ * @param cb        - called with every member, NULL to only validate
+ * @param user_data - user data passed to cb
+ * @return number of members, -1 if the document is not a valid JSON
+ *         object or cb stopped the parsing. Members before the error
+ *         have already been passed to cb
+ */
+int cfgmgr_json_each_member(const char* buf, size_t len, cfgmgr_json_member_cb_t cb,
+                            void* user_data);
+
+/**
+ * Name of the parser used for large documents
+ *
+ * @return "simdjson" when built with it, "cjson" otherwise
+ */
+const char* cfgmgr_json_backend();
+
+#ifdef CFGMGR_WITH_SIMDJSON
+/**
+ * Parse a JSON document with simdjson, see cfgmgr_json_parse()
+ */
+cJSON* cfgmgr_json_simdjson_parse(const char* buf, size_t len);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
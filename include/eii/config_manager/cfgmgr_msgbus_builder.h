@@ -0,0 +1,68 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Message bus configuration builder of the ConfigManager
+ *
+ * Builds the message bus configuration of a publisher, subscriber, server
+ * or client in a single pass over its compiled interface model, straight
+ * into the cJSON tree handed to the caller. What differs between interface
+ * types (where the endpoint object goes, which peer keys are exchanged
+ * with) and between transports is described by tables, so supporting a
+ * new transport is one more table entry.
+ *
+ * When the context builds message bus configs in arenas, every node, key
+ * and string of the config, and the temporaries of the build, are bump
+ * allocated from one arena which config_destroy() frees at once. Only the
+ * @c config_t itself and the values the kv_store client returns come from
+ * the heap.
+ */
+
+#ifndef _EII_C_CFGMGR_MSGBUS_BUILDER_H
+#define _EII_C_CFGMGR_MSGBUS_BUILDER_H
+
+#include "eii/config_manager/cfgmgr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Chunk size of the arenas message bus configs are built in, enough for
+// most configs to fit in one chunk
+#define CFGMGR_MSGBUS_ARENA_CHUNK_SIZE  4096
+
+/**
+ * Build the message bus configuration of an interface, with its Type and
+ * EndPoint env overrides applied
+ *
+ * @param ctx             - interface
+ * @param kv_store_client - kv_store client the keys are read with in prod mode
+ * @param kv_store_handle - handle of @p kv_store_client
+ * @return new @c config_t owned by the caller, or NULL on failure
+ */
+config_t* cfgmgr_msgbus_build(cfgmgr_interface_t* ctx, kv_store_client_t* kv_store_client,
+                              void* kv_store_handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
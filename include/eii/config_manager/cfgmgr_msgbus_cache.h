@@ -0,0 +1,107 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Message bus configuration cache of the ConfigManager
+ *
+ * Caches the message bus configuration built for an interface, keyed by
+ * the interface node it was built from.
+ * Hits hand out deep copies, so callers keep owning what they are given.
+ * Entries and copies are either heap cJSON trees or, for caches of
+ * contexts building their configs in arenas, each in an arena of its own.
+ * Entries built before the last invalidation are never handed out.
+ */
+
+#ifndef _EII_C_CFGMGR_MSGBUS_CACHE_H
+#define _EII_C_CFGMGR_MSGBUS_CACHE_H
+
+#include <stdint.h>
+#include "eii/utils/config.h"
+#include "eii/config_manager/cfgmgr_util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Opaque message bus configuration cache
+ */
+typedef struct cfgmgr_msgbus_cache cfgmgr_msgbus_cache_t;
+
+/**
+ * Create an empty message bus configuration cache
+ *
+ * @return @c cfgmgr_msgbus_cache_t, or NULL on failure
+ */
+cfgmgr_msgbus_cache_t* cfgmgr_msgbus_cache_new();
+
+/**
+ * Keep entries and hand out copies in arenas, or on the heap again
+ *
+ * @param cache      - message bus configuration cache
+ * @param chunk_size - chunk size of the arenas, 0 for the heap
+ */
+void cfgmgr_msgbus_cache_use_arena(cfgmgr_msgbus_cache_t* cache, size_t chunk_size);
+
+/**
+ * Look up the message bus configuration of an interface
+ *
+ * @param cache     - message bus configuration cache
+ * @param iface     - interface node the configuration is built from
+ * @param epoch     - set to the epoch to pass to cfgmgr_msgbus_cache_put()
+ *                    on a miss
+ * @return copy of the cached @c config_t to be destroyed by the caller,
+ *         NULL on a miss
+ */
+config_t* cfgmgr_msgbus_cache_get(cfgmgr_msgbus_cache_t* cache, const void* iface, uint64_t* epoch);
+
+/**
+ * Cache the message bus configuration of an interface. Nothing is cached
+ * if the cache was invalidated since @p epoch was handed out.
+ *
+ * @param cache     - message bus configuration cache
+ * @param iface     - interface node the configuration is built from
+ * @param epoch     - epoch returned by the missing cfgmgr_msgbus_cache_get()
+ * @param config    - JSON configuration to copy into the cache
+ */
+void cfgmgr_msgbus_cache_put(cfgmgr_msgbus_cache_t* cache, const void* iface,
+                             uint64_t epoch, const config_t* config);
+
+/**
+ * Drop every cached configuration, e.g. when the interfaces, the keys or
+ * the env overrides they are built from change
+ *
+ * @param cache - message bus configuration cache
+ */
+void cfgmgr_msgbus_cache_invalidate(cfgmgr_msgbus_cache_t* cache);
+
+/**
+ * Destroy the cache and every configuration it holds
+ *
+ * @param cache - message bus configuration cache
+ */
+void cfgmgr_msgbus_cache_destroy(cfgmgr_msgbus_cache_t* cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
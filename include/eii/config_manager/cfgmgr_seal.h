@@ -0,0 +1,100 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Sealed files: checksummed or encrypted and authenticated images
+ *
+ * A sealed image is a header, the data, then either the SHA-256 of the
+ * header and data or, when sealed with a key, the data encrypted with
+ * AES-256-GCM followed by the tag authenticating the header and the
+ * encrypted data. The header holds the magic and version of the file
+ * format, whether the data is encrypted, the random IV and the data
+ * length. Warm-start snapshots and config bundles are sealed.
+ */
+
+#ifndef _EII_C_CFGMGR_SEAL_H
+#define _EII_C_CFGMGR_SEAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bytes of a sealing key
+#define CFGMGR_SEAL_KEY_SIZE    32
+
+/**
+ * Seal data into a file image
+ *
+ * @param magic   - magic of the file format
+ * @param version - version of the file format
+ * @param key     - CFGMGR_SEAL_KEY_SIZE bytes encrypting the data, NULL to
+ *                  only checksum it
+ * @param data    - data
+ * @param length  - bytes of data
+ * @param size    - set to the size of the image
+ * @return image to be freed by the caller, or NULL on failure
+ */
+void* cfgmgr_seal(uint32_t magic, uint32_t version, const unsigned char* key,
+                  const void* data, size_t length, size_t* size);
+
+/**
+ * Verify, and decrypt, a file image sealed by cfgmgr_seal()
+ *
+ * @param magic   - expected magic
+ * @param version - expected version
+ * @param key     - key the image was sealed with, NULL if it was not
+ *                  encrypted
+ * @param image   - image
+ * @param size    - size of the image
+ * @param length  - set to the bytes of data
+ * @param name    - name of the file, for the logs
+ * @return data followed by a NUL byte, to be freed by the caller, or NULL
+ *         if the image is of another format, version or key, or corrupt
+ */
+void* cfgmgr_seal_open(uint32_t magic, uint32_t version, const unsigned char* key,
+                       const void* image, size_t size, size_t* length, const char* name);
+
+/**
+ * Read a sealing key from a file holding either CFGMGR_SEAL_KEY_SIZE raw
+ * bytes or their hex encoding
+ *
+ * @param path - key file
+ * @param key  - filled with the key
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_seal_read_key(const char* path, unsigned char* key);
+
+/**
+ * Erase a key from memory
+ *
+ * @param key - CFGMGR_SEAL_KEY_SIZE bytes
+ */
+void cfgmgr_seal_clear_key(unsigned char* key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Versioned snapshots of the ConfigManager configuration
+ *
+ * Holds the current application config and interfaces as an immutable
+ * @c cfgmgr_snapshot_t. The watches on /<AppName>/config and
+ * /<AppName>/interfaces publish a new snapshot with an atomic pointer swap,
+ * so readers never see a config from one update and interfaces from
+ * another, and never block on a writer.
+ *
+ * Readers pin the snapshot they read with cfgmgr_snapshots_pin(): pinning
+ * claims a reader slot tagged with the current epoch, without locking.
+ * Publishing retires the previous snapshot at the current epoch and frees
+ * every retired snapshot older than the oldest pinned epoch, so a pinned
+ * snapshot is never freed under its reader. Configs held past a pin are
+ * referenced with cfgmgr_snapshots_acquire_config(), a retired config is
+ * freed with its last reference. The legacy accessor
+ * cfgmgr_snapshots_app_config() holds a reference on every config it
+ * returned until the store is destroyed.
+ */
+
+#ifndef _EII_C_CFGMGR_SNAPSHOT_H
+#define _EII_C_CFGMGR_SNAPSHOT_H
+
+#include <stdint.h>
+#include "eii/utils/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Immutable snapshot of the application config and interfaces
+ */
+typedef struct {
+    // Bumped by every snapshot published, the first one is 1
+    uint64_t version;
+
+    // Application config, owned by the snapshot store
+    config_t* app_config;
+
+    // Application interfaces, owned by the interface index and
+    // released through cfgmgr_snapshots_set_interface_release()
+    config_t* app_interface;
+} cfgmgr_snapshot_t;
+
+/**
+ * Snapshot pinned by a reader
+ */
+typedef struct {
+    const cfgmgr_snapshot_t* snapshot;
+
+    // Reader slot holding the pin
+    int slot;
+} cfgmgr_snapshot_guard_t;
+
+/**
+ * Opaque snapshot store
+ */
+typedef struct cfgmgr_snapshots cfgmgr_snapshots_t;
+
+/**
+ * Releases interfaces no snapshot holds anymore
+ */
+typedef void (*cfgmgr_snapshots_release_t)(config_t* app_interface, void* user_data);
+
+/**
+ * Create a snapshot store holding a first snapshot. On success the store
+ * takes ownership of @p app_config.
+ *
+ * @param app_config    - application config, or NULL until one is published
+ * @param app_interface - application interfaces, not owned by the store,
+ *                        or NULL until published
+ * @return @c cfgmgr_snapshots_t, or NULL on failure
+ */
+cfgmgr_snapshots_t* cfgmgr_snapshots_new(config_t* app_config, config_t* app_interface);
+
+/**
+ * Publish a new snapshot, reusing the config or the interfaces of the
+ * current one for a NULL argument, and reclaim the retired snapshots no
+ * reader pins anymore. On success the store takes ownership of
+ * @p app_config.
+ *
+ * @param snapshots     - snapshot store
+ * @param app_config    - new application config, or NULL
+ * @param app_interface - new application interfaces, or NULL
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_snapshots_publish(cfgmgr_snapshots_t* snapshots, config_t* app_config,
+                             config_t* app_interface);
+
+/**
+ * Pin the current snapshot, lock-free. It stays valid until unpinned.
+ *
+ * @param snapshots - snapshot store
+ * @return guard to pass to cfgmgr_snapshots_unpin()
+ */
+cfgmgr_snapshot_guard_t cfgmgr_snapshots_pin(cfgmgr_snapshots_t* snapshots);
+
+/**
+ * Unpin a snapshot
+ *
+ * @param snapshots - snapshot store
+ * @param guard     - guard returned by cfgmgr_snapshots_pin(), reset
+ */
+void cfgmgr_snapshots_unpin(cfgmgr_snapshots_t* snapshots, cfgmgr_snapshot_guard_t* guard);
+
+/**
+ * Reference the current application config, which stays valid until
+ * released with cfgmgr_snapshots_release_config()
+ *
+ * @param snapshots - snapshot store
+ * @return @c config_t owned by the store, NULL if none was published
+ */
+config_t* cfgmgr_snapshots_acquire_config(cfgmgr_snapshots_t* snapshots);
+
+/**
+ * Release a config referenced by cfgmgr_snapshots_acquire_config(), freeing
+ * it if it was retired and this was its last reference
+ *
+ * @param snapshots  - snapshot store
+ * @param app_config - config to release, may be NULL
+ */
+void cfgmgr_snapshots_release_config(cfgmgr_snapshots_t* snapshots, config_t* app_config);
+
+/**
+ * Current application config, valid until the store is destroyed: every
+ * config returned is kept until then, even once replaced
+ *
+ * @param snapshots - snapshot store
+ * @return @c config_t owned by the store, NULL if none was published
+ */
+config_t* cfgmgr_snapshots_app_config(cfgmgr_snapshots_t* snapshots);
+
+/**
+ * Number of retired snapshots not reclaimed yet
+ *
+ * @param snapshots - snapshot store
+ * @return count
+ */
+size_t cfgmgr_snapshots_retired(cfgmgr_snapshots_t* snapshots);
+
+/**
+ * Set the callback releasing the interfaces published once no snapshot
+ * holds them anymore, so that their owner can free them. Each interfaces
+ * argument of cfgmgr_snapshots_new() or cfgmgr_snapshots_publish() is
+ * released once, called with the store mutex held.
+ *
+ * @param snapshots - snapshot store
+ * @param release   - callback, NULL to not release interfaces
+ * @param user_data - argument of the callback
+ */
+void cfgmgr_snapshots_set_interface_release(cfgmgr_snapshots_t* snapshots,
+                                            cfgmgr_snapshots_release_t release,
+                                            void* user_data);
+
+/**
+ * Number of configs no snapshot owns anymore, kept for their references
+ *
+ * @param snapshots - snapshot store
+ * @return count
+ */
+size_t cfgmgr_snapshots_held(cfgmgr_snapshots_t* snapshots);
+
+/**
+ * Destroy the store and every config it owns. No snapshot may be pinned.
+ *
+ * @param snapshots - snapshot store
+ */
+void cfgmgr_snapshots_destroy(cfgmgr_snapshots_t* snapshots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
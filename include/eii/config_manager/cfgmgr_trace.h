@@ -0,0 +1,147 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Startup and msgbus config tracing of the ConfigManager
+ *
+ * Records high-resolution spans of cfgmgr_initialize(), the etcd client
+ * (TLS file reads, channel creation, Range and Txn requests) and the
+ * msgbus config builders, when enabled by setting CONFIGMGR_TRACE to the
+ * file the Chrome trace-event JSON is written to. The file is written when
+ * cfgmgr_initialize() returns and again by cfgmgr_destroy(); load it in
+ * chrome://tracing or https://ui.perfetto.dev. cfgmgr_trace_summary()
+ * aggregates the same spans per name.
+ *
+ * Spans are process wide and nest per thread by time. While tracing is
+ * disabled, beginning and ending a span costs one atomic load.
+ */
+
+#ifndef _EII_C_CFGMGR_TRACE_H
+#define _EII_C_CFGMGR_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Spans kept in memory, further spans are counted as dropped
+#define CFGMGR_TRACE_MAX_SPANS  65536
+
+/**
+ * Span being recorded
+ */
+typedef struct {
+    // Static string naming the span, e.g. "etcd.range"
+    const char* name;
+
+    // Monotonic start time, 0 if tracing was disabled at the start
+    uint64_t start_ns;
+} cfgmgr_trace_span_t;
+
+/**
+ * Time spent in the spans of one name
+ */
+typedef struct {
+    const char* name;
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} cfgmgr_trace_stat_t;
+
+/**
+ * Spans aggregated per name
+ */
+typedef struct {
+    // Sorted by decreasing total time
+    cfgmgr_trace_stat_t* stats;
+    size_t count;
+
+    // Spans not recorded as CFGMGR_TRACE_MAX_SPANS was reached
+    uint64_t dropped;
+} cfgmgr_trace_summary_t;
+
+/**
+ * Enable or disable recording spans
+ *
+ * @param enable - whether spans are recorded
+ */
+void cfgmgr_trace_enable(bool enable);
+
+/**
+ * Whether spans are recorded
+ *
+ * @return true if enabled
+ */
+bool cfgmgr_trace_enabled();
+
+/**
+ * Begin a span
+ *
+ * @param name - static string naming the span
+ * @return span to pass to cfgmgr_trace_end()
+ */
+cfgmgr_trace_span_t cfgmgr_trace_begin(const char* name);
+
+/**
+ * End and record a span
+ *
+ * @param span   - span returned by cfgmgr_trace_begin()
+ * @param detail - what the span worked on, e.g. the key read, copied; may
+ *                 be NULL
+ */
+void cfgmgr_trace_end(cfgmgr_trace_span_t* span, const char* detail);
+
+/**
+ * Write the recorded spans as Chrome trace-event JSON
+ *
+ * @param path - file to write
+ * @return 0 on success, -1 on failure
+ */
+int cfgmgr_trace_export(const char* path);
+
+/**
+ * Aggregate the recorded spans per name
+ *
+ * @return @c cfgmgr_trace_summary_t to be destroyed with
+ *         cfgmgr_trace_summary_destroy(), NULL on failure
+ */
+cfgmgr_trace_summary_t* cfgmgr_trace_summary();
+
+/**
+ * Destroy a summary
+ *
+ * @param summary - summary returned by cfgmgr_trace_summary()
+ */
+void cfgmgr_trace_summary_destroy(cfgmgr_trace_summary_t* summary);
+
+/**
+ * Drop every recorded span
+ */
+void cfgmgr_trace_reset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,220 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Borrowed, read-only views of the ConfigManager configuration
+ *
+ * A @c cfgmgr_view_t references a value inside the application config or
+ * interfaces documents held by the ConfigMgr, without copying it into a
+ * @c config_value_t. Reading through views allocates nothing; strings,
+ * arrays and objects are read in place.
+ *
+ * The documents form the snapshot a view belongs to. Application configs
+ * handed out to views and interfaces documents replaced by a watch on
+ * /<AppName>/interfaces are retired rather than freed, so views stay valid
+ * until cfgmgr_destroy(). The only exception is cfgmgr_set_topics(), which
+ * replaces the Topics array of an interface in place: raw views into that
+ * array must not be used after it. The lists returned by
+ * cfgmgr_view_topics() and cfgmgr_view_allowed_clients() are compiled
+ * copies and are not affected.
+ */
+
+#ifndef _EII_C_CFGMGR_VIEW_H
+#define _EII_C_CFGMGR_VIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "eii/config_manager/cfgmgr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Type of the value a view references
+ */
+typedef enum {
+    // Missing key, out of range item or view of nothing
+    CFGMGR_VIEW_NONE     = 0,
+    CFGMGR_VIEW_NULL     = 1,
+    CFGMGR_VIEW_BOOLEAN  = 2,
+    CFGMGR_VIEW_INTEGER  = 3,
+    CFGMGR_VIEW_FLOATING = 4,
+    CFGMGR_VIEW_STRING   = 5,
+    CFGMGR_VIEW_ARRAY    = 6,
+    CFGMGR_VIEW_OBJECT   = 7,
+} cfgmgr_view_type_t;
+
+/**
+ * Borrowed view of a config value, passed by value
+ */
+typedef struct {
+    const void* node;
+} cfgmgr_view_t;
+
+/**
+ * Position of an iteration over the items of an array or object
+ */
+typedef struct {
+    const void* next;
+} cfgmgr_view_iter_t;
+
+/**
+ * View of /<AppName>/config
+ *
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @return view of the config object
+ */
+cfgmgr_view_t cfgmgr_view_app_config(cfgmgr_ctx_t* cfgmgr);
+
+/**
+ * View of the current /<AppName>/interfaces
+ *
+ * @param cfgmgr - cfgmgr_ctx_t object
+ * @return view of the interfaces object
+ */
+cfgmgr_view_t cfgmgr_view_app_interface(cfgmgr_ctx_t* cfgmgr);
+
+/**
+ * View of an interface object
+ *
+ * @param ctx - cfgmgr_interface_t object
+ * @return view of the interface object
+ */
+cfgmgr_view_t cfgmgr_view_interface(cfgmgr_interface_t* ctx);
+
+/**
+ * Value of a key of an object
+ *
+ * @param object - view of an object
+ * @param key    - key to look up
+ * @return view of the value, of type CFGMGR_VIEW_NONE if @p object is not
+ *         an object or has no such key
+ */
+cfgmgr_view_t cfgmgr_view_get(cfgmgr_view_t object, const char* key);
+
+/**
+ * Type of the value a view references
+ *
+ * @param view - view
+ * @return @c cfgmgr_view_type_t
+ */
+cfgmgr_view_type_t cfgmgr_view_type(cfgmgr_view_t view);
+
+/**
+ * String value of a view
+ *
+ * @param view - view
+ * @param str  - set to the string, owned by the snapshot
+ * @param len  - set to the length of the string, may be NULL
+ * @return false if the view is not a string
+ */
+bool cfgmgr_view_string(cfgmgr_view_t view, const char** str, size_t* len);
+
+/**
+ * Integer value of a view, numbers with a fractional part are not integers
+ *
+ * @param view  - view
+ * @param value - set to the value
+ * @return false if the view is not an integer
+ */
+bool cfgmgr_view_integer(cfgmgr_view_t view, int64_t* value);
+
+/**
+ * Floating point value of a view, integers included
+ *
+ * @param view  - view
+ * @param value - set to the value
+ * @return false if the view is not a number
+ */
+bool cfgmgr_view_floating(cfgmgr_view_t view, double* value);
+
+/**
+ * Boolean value of a view
+ *
+ * @param view  - view
+ * @param value - set to the value
+ * @return false if the view is not a boolean
+ */
+bool cfgmgr_view_boolean(cfgmgr_view_t view, bool* value);
+
+/**
+ * Number of items of an array or keys of an object
+ *
+ * @param view - view
+ * @return number of items, 0 for any other type
+ */
+size_t cfgmgr_view_len(cfgmgr_view_t view);
+
+/**
+ * Start iterating over the items of an array or object
+ *
+ * @param view - view of an array or object
+ * @return iteration position, at the end for any other type
+ */
+cfgmgr_view_iter_t cfgmgr_view_iter(cfgmgr_view_t view);
+
+/**
+ * Next item of an iteration
+ *
+ * @param iter - iteration position, advanced on success
+ * @param item - set to the item
+ * @param key  - set to the key of the item in an object, NULL in an
+ *               array; may be NULL
+ * @return false at the end of the iteration
+ */
+bool cfgmgr_view_next(cfgmgr_view_iter_t* iter, cfgmgr_view_t* item, const char** key);
+
+/**
+ * Topics of a publisher or subscriber, as returned by cfgmgr_get_topics()
+ *
+ * @param ctx    - cfgmgr_interface_t object
+ * @param topics - set to the topics, owned by the snapshot
+ * @param count  - set to the number of topics
+ * @return false if the interface has no valid, non empty Topics
+ */
+bool cfgmgr_view_topics(cfgmgr_interface_t* ctx, const char* const** topics, size_t* count);
+
+/**
+ * AllowedClients of a publisher or server
+ *
+ * @param ctx     - cfgmgr_interface_t object
+ * @param clients - set to the allowed clients, owned by the snapshot
+ * @param count   - set to the number of allowed clients
+ * @return false if the interface has no valid AllowedClients
+ */
+bool cfgmgr_view_allowed_clients(cfgmgr_interface_t* ctx, const char* const** clients,
+                                 size_t* count);
+
+/**
+ * EndPoint of an interface; an ipc EndPoint object is returned as JSON
+ *
+ * @param ctx - cfgmgr_interface_t object
+ * @return endpoint owned by the snapshot, NULL if missing or invalid
+ */
+const char* cfgmgr_view_endpoint(cfgmgr_interface_t* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
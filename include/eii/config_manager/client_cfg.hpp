@@ -70,6 +70,13 @@ namespace eii {
                  */
                 config_t* getMsgBusConfig() override;
 
+                /**
+                 * Constructs message bus config for Client in the binary form
+                 * @return BinaryConfig* - On Success, binary msg bus client config, to be deleted by the caller
+                 *                       - On Failure, throws
+                 */
+                BinaryConfig* getMsgBusConfigBinary() override;
+
                 /**
                  * To fetch particular interface value from Client interface config
                  * @param key - Key on which interface value is extracted.
@@ -108,6 +108,21 @@ namespace eii {
                  */
                 bool isDevMode();
 
+                /**
+                 * Scan the environment again for the Type and EndPoint overrides
+                 * of the interfaces, which are otherwise only read at initialization
+                 * @return bool - True on success & false on failure
+                 */
+                bool reloadEnv();
+
+                /**
+                 * Build the msgbus config of every publisher, subscriber,
+                 * server and client, reading the keys they need in one batch
+                 * @return cfgmgr_msgbus_configs_t* - configs to be destroyed
+                 *         with cfgmgr_msgbus_configs_destroy()
+                 */
+                cfgmgr_msgbus_configs_t* getAllMsgBusConfigs();
+
                 /**
                  * Get the AppName for any service
                  * @return std::string - AppName string
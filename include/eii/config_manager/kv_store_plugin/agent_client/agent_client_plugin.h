@@ -0,0 +1,66 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Interface between kv_store_plugin and the cfgmgr-agent client
+ *
+ * The agent client reads and watches keys through the cfgmgr-agent of the
+ * node over a Unix domain socket instead of connecting to the kv_store.
+ * It reconnects when the agent restarts, and watches are then registered
+ * again and notified of the keys that changed in between.
+ *
+ * An agent in prod mode only serves the keys shared by every application.
+ * Once it denies a request, the other keys, writes and leases go to the
+ * kv_store through an own etcd client with the credentials of the
+ * "etcd_kv_store" object of the config.
+ */
+
+#ifndef EII_CFGMGR_AGENT_CLIENT_PLUGIN_H
+#define EII_CFGMGR_AGENT_CLIENT_PLUGIN_H
+
+#include <eii/utils/logger.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Optional object of the config, its "socket_path" overrides
+// CONFIGMGR_AGENT_SOCKET
+#define AGENT_KV_STORE          "agent_kv_store"
+
+// Milliseconds between two attempts to reconnect to the agent
+#define AGENT_RECONNECT_MS      500
+
+/**
+ * Create a kv_store_client object talking to the cfgmgr-agent. The
+ * socket is connected by init(), which fails if the agent is not running.
+ * This function would be called by kv_store_plugin's create_kv_client() internally
+ * @param config - Configuration object
+ * @return kv_store_client instance, or NULL
+ */
+kv_store_client_t* create_agent_client(config_t* config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
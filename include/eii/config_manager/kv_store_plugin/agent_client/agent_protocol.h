@@ -0,0 +1,185 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Wire protocol between the cfgmgr-agent and its clients
+ *
+ * Every message is a frame: an @c agent_frame_header_t in host byte order,
+ * the socket being local, followed by header.length bytes of payload.
+ * Payloads are sequences of fields: u8, u32, i64 and strings, encoded as a
+ * u32 length, the bytes and a NUL terminator so that they are read in place.
+ *
+ * | op             | request payload          | response payload          |
+ * |----------------|--------------------------|---------------------------|
+ * | GET            | key                      | value                     |
+ * | GET_PREFIX     | prefix                   | u32 n, n x (key, value)   |
+ * | PUT            | key, value               |                           |
+ * | WATCH          | u8 is_prefix, key        | u32 n, n x (key, value)   |
+ * | GRANT_LEASE    | i64 ttl                  | i64 lease_id              |
+ * | PUT_WITH_LEASE | key, value, i64 lease_id |                           |
+ * | KEEPALIVE      | i64 lease_id             |                           |
+ * | REVOKE_LEASE   | i64 lease_id             |                           |
+ *
+ * Responses carry the op and id of their request and a status. WATCH
+ * requests are identified by the id the client chose for the watch, the
+ * response holds the current keys of the watch and is followed by EVENT
+ * frames with the same id: u8 deleted, key, value (empty when deleted).
+ *
+ * In prod mode the agent only serves reads and watches of the keys every
+ * application may read, see agent_key_shared(). Other requests are
+ * answered with PERMISSION_DENIED, clients send them to the kv_store with
+ * their own credentials.
+ */
+
+#ifndef EII_CFGMGR_AGENT_PROTOCOL_H
+#define EII_CFGMGR_AGENT_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Socket the agent listens on when CONFIGMGR_AGENT_SOCKET is not set
+#define AGENT_DEFAULT_SOCKET    "/run/eii/cfgmgr-agent.sock"
+
+// Largest payload accepted, larger frames close the connection
+#define AGENT_MAX_PAYLOAD       (16 * 1024 * 1024)
+
+typedef enum {
+    AGENT_OP_GET = 1,
+    AGENT_OP_GET_PREFIX = 2,
+    AGENT_OP_PUT = 3,
+    AGENT_OP_WATCH = 4,
+    AGENT_OP_GRANT_LEASE = 5,
+    AGENT_OP_PUT_WITH_LEASE = 6,
+    AGENT_OP_KEEPALIVE = 7,
+    AGENT_OP_REVOKE_LEASE = 8,
+    AGENT_OP_EVENT = 9,
+} agent_op_t;
+
+typedef enum {
+    AGENT_STATUS_OK = 0,
+    AGENT_STATUS_NOT_FOUND = 1,
+    AGENT_STATUS_ERROR = 2,
+    // Not served in prod mode
+    AGENT_STATUS_PERMISSION_DENIED = 3,
+} agent_status_t;
+
+/**
+ * Frame header
+ */
+typedef struct {
+    // Bytes of payload following the header
+    uint32_t length;
+    uint8_t op;
+    uint8_t status;
+    uint16_t reserved;
+    uint32_t id;
+} agent_frame_header_t;
+
+/**
+ * Growable payload being written
+ */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} agent_buf_t;
+
+/**
+ * Payload being read, strings point into it
+ */
+typedef struct {
+    const uint8_t* data;
+    size_t len;
+    size_t pos;
+} agent_reader_t;
+
+/**
+ * Append a field to a payload
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int agent_buf_put_u8(agent_buf_t* buf, uint8_t value);
+int agent_buf_put_u32(agent_buf_t* buf, uint32_t value);
+int agent_buf_put_i64(agent_buf_t* buf, int64_t value);
+int agent_buf_put_str(agent_buf_t* buf, const char* str);
+
+/**
+ * Empty a payload, keeping its memory
+ */
+void agent_buf_reset(agent_buf_t* buf);
+
+/**
+ * Free the memory of a payload
+ */
+void agent_buf_free(agent_buf_t* buf);
+
+/**
+ * Read a field of a payload
+ *
+ * @return 0 on success, -1 if the payload is too short or malformed
+ */
+int agent_read_u8(agent_reader_t* reader, uint8_t* value);
+int agent_read_u32(agent_reader_t* reader, uint32_t* value);
+int agent_read_i64(agent_reader_t* reader, int64_t* value);
+int agent_read_str(agent_reader_t* reader, const char** str);
+
+/**
+ * Whether a key or key prefix is below /GlobalEnv/ or /Publickeys/, the
+ * keys every application may read
+ *
+ * @param key - key or key prefix
+ * @return true if the agent serves it in prod mode
+ */
+bool agent_key_shared(const char* key);
+
+/**
+ * Write a frame, retrying on partial writes
+ *
+ * @param fd      - connected socket
+ * @param op      - @c agent_op_t
+ * @param status  - @c agent_status_t, AGENT_STATUS_OK for requests
+ * @param id      - request or watch id
+ * @param payload - payload, NULL if empty
+ * @return 0 on success, -1 on failure
+ */
+int agent_send_frame(int fd, uint8_t op, uint8_t status, uint32_t id, const agent_buf_t* payload);
+
+/**
+ * Read a frame
+ *
+ * @param fd      - connected socket
+ * @param header  - filled with the frame header
+ * @param payload - filled with the payload, replacing its content
+ * @return 0 on success, -1 once the connection is closed or broken
+ */
+int agent_recv_frame(int fd, agent_frame_header_t* header, agent_buf_t* payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Server side of the cfgmgr-agent
+ *
+ * Serves the requests of the agent clients of a node with one kv_store
+ * client. Keys and key prefixes read or watched are mirrored with
+ * watch_prefix_kv() the first time they are requested: later reads are
+ * answered from memory and every watch of a key shares the one kv_store
+ * watch of the agent. Writes and leases are forwarded to the kv_store, and
+ * reach the mirrors through their watches.
+ *
+ * The agent does not know which application a client is, so in prod mode
+ * it only serves the keys every application may read, see
+ * agent_key_shared(). Private keys, writes and leases are denied, clients
+ * send them to the kv_store under their own credentials. In dev mode
+ * anyone able to connect to the socket, created with mode 0660, reads and
+ * writes every key the kv_store client of the agent can.
+ */
+
+#ifndef EII_CFGMGR_AGENT_SERVER_H
+#define EII_CFGMGR_AGENT_SERVER_H
+
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Top-level prefixes mirrored, e.g. "/<AppName>/", each through one watch
+// of the kv_store. Reads beyond it are forwarded, watches fail
+#define AGENT_SERVER_MAX_ROOTS      256
+
+// Milliseconds the keys of a prefix without watches are kept after its
+// last read
+#define AGENT_SERVER_IDLE_MS        60000
+
+// Milliseconds a write to a client may block before it is disconnected
+#define AGENT_SERVER_SEND_TIMEOUT_MS    5000
+
+typedef struct agent_server agent_server_t;
+
+/**
+ * Initialize a kv_store client and serve it on a Unix domain socket
+ *
+ * @param client      - client to serve, must support watch_prefix_kv(). The
+ *                      server takes ownership of it, even on failure
+ * @param socket_path - path of the socket, replaced if no agent listens on it
+ * @param dev_mode    - serve every key and forward writes and leases,
+ *                      otherwise only serve reads and watches of shared keys
+ * @return server, or NULL on failure
+ */
+agent_server_t* agent_server_start(kv_store_client_t* client, const char* socket_path,
+                                   bool dev_mode);
+
+/**
+ * Disconnect every client, stop serving and free the server and its
+ * kv_store client
+ *
+ * @param server - server returned by agent_server_start()
+ */
+void agent_server_stop(agent_server_t* server);
+
+/**
+ * Drop the keys of the mirrored prefixes without watches which were not
+ * read for @p idle_ms. They are read again on their next use. The server
+ * does so on its own after AGENT_SERVER_IDLE_MS
+ *
+ * @param server  - server returned by agent_server_start()
+ * @param idle_ms - milliseconds since the last read
+ * @return number of prefixes evicted
+ */
+size_t agent_server_evict_idle(agent_server_t* server, uint64_t idle_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
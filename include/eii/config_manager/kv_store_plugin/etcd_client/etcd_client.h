@@ -33,6 +33,13 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
 #include <sstream>
 #include <fstream>
 #include "eii/utils/json_config.h"
@@ -56,9 +63,19 @@ using etcdserverpb::RangeRequest;
 using etcdserverpb::PutRequest;
 using etcdserverpb::RequestOp;
 using etcdserverpb::PutResponse;
+using etcdserverpb::TxnRequest;
+using etcdserverpb::TxnResponse;
+using etcdserverpb::ResponseOp;
 using etcdserverpb::WatchCreateRequest;
 using etcdserverpb::WatchRequest;
 using etcdserverpb::WatchResponse;
+using etcdserverpb::Lease;
+using etcdserverpb::LeaseGrantRequest;
+using etcdserverpb::LeaseGrantResponse;
+using etcdserverpb::LeaseRevokeRequest;
+using etcdserverpb::LeaseRevokeResponse;
+using etcdserverpb::LeaseKeepAliveRequest;
+using etcdserverpb::LeaseKeepAliveResponse;
 
 /**
  * Format for the user callback to notify the user when any update occurs on a key
@@ -69,6 +86,27 @@ using etcdserverpb::WatchResponse;
  */
 typedef void (*kv_store_watch_callback_t)(const char *key, config_t* value, void* cb_user_data);
 
+/**
+ * Format for the user callback of watch_prefix_kv, called with the raw value
+ * of every key of the watched prefix. After a compaction every current key
+ * is delivered again between a call with a NULL key and the prefix as
+ * value and one with a NULL key and a NULL value
+ * @param key           key being updated, without ETCD_PREFIX
+ * @param value         updated value, NULL if the key was deleted
+ * @param cb_user_data  user data passed
+ */
+typedef void (*kv_store_watch_kv_callback_t)(const char *key, const char* value, void *cb_user_data);
+
+/**
+ * Format for the user callback of get_prefix_kv, called with every key of
+ * the prefix and its raw value as they are read
+ * @param key           key read, without ETCD_PREFIX
+ * @param value         raw value of the key
+ * @param cb_user_data  user data passed
+ * @return 0 to go on, any other value stops reading the prefix
+ */
+typedef int (*kv_store_get_kv_callback_t)(const char *key, const char* value, void *cb_user_data);
+
 class EtcdClient {
     public:
         /**
@@ -89,7 +127,14 @@ class EtcdClient {
         EtcdClient(const std::string& host, const std::string& port, const std::string& cert_file, const std::string& key_file, const std::string ca_file);
 
         /**
-        * Destructor
+        * EtcdClient Constructor over an existing gRPC channel, ex: an
+        * in-process channel to a local etcd compatible server
+        * @param channel - channel to be used for all requests and watches
+        */
+        EtcdClient(std::shared_ptr<Channel> channel);
+
+        /**
+        * Destructor, cancels and joins all watches of this client
         */
         ~EtcdClient();
 
@@ -107,6 +152,30 @@ class EtcdClient {
         */
         std::vector<std::string> get_prefix(std::string& key_prefix);
 
+        /**
+        * Streams every key of a prefix and its raw value to user_callback,
+        * a page of keys at a time, all pages read at the same revision
+        * @param key is the prefix of the keys to be read
+        * @param user_callback user_call back called for every key
+        * @param user_data user_data to be passed, it can be NULL also
+        * @return number of keys delivered, -1 on failure
+        */
+        int get_prefix_kv(std::string& key, kv_store_get_kv_callback_t user_cb, void *user_data);
+
+        /**
+        * Reads several keys and key prefixes with one Txn of range requests
+        * per ETCD_MAX_TXN_OPS keys, all read at the revision of the first Txn
+        * so that the batch is a consistent snapshot
+        * @param keys is the list of keys and key prefixes to be read
+        * @param prefixes tells for every entry of keys whether it is a prefix
+        * @param kvs is filled with the (key, value) pairs found, in the order
+        *            of keys and sorted by key within a prefix; ETCD_PREFIX is
+        *            stripped from the returned keys
+        * @return 0 on success, -1 on failure
+        */
+        int get_batch(const std::vector<std::string>& keys, const std::vector<bool>& prefixes,
+                      std::vector<std::pair<std::string, std::string>>& kvs);
+
         /**
         * Saves the value of a key to etcd. The key will be modified if already exists or created
         * if it does not exist.
@@ -116,6 +185,41 @@ class EtcdClient {
         */
         int put(std::string& key, std::string& value);
 
+        /**
+        * Saves the value of a key to etcd and attaches it to the given lease.
+        * The key is deleted by etcd once the lease expires or is revoked.
+        * @param key is the key to be created or modified
+        * @param value is the new value to be set
+        * @param lease_id is the lease to attach the key to, 0 for no lease
+        * @return 0 on success, -1 on failure
+        */
+        int put(std::string& key, std::string& value, int64_t lease_id);
+
+        /**
+        * Grants a new lease from the etcd server
+        * @param ttl is the requested time-to-live of the lease in seconds
+        * @param lease_id is set to the granted lease id on success
+        * @return 0 on success, -1 on failure
+        */
+        int lease_grant(int64_t ttl, int64_t* lease_id);
+
+        /**
+        * Adds a lease to the set of leases kept alive by this client. All
+        * leases are renewed over a single LeaseKeepAlive stream owned by
+        * the client, at a third of their TTL.
+        * @param lease_id is the lease to be kept alive
+        * @return 0 on success, -1 on failure
+        */
+        int lease_keepalive(int64_t lease_id);
+
+        /**
+        * Revokes a lease, deleting all the keys attached to it, and stops
+        * keeping it alive
+        * @param lease_id is the lease to be revoked
+        * @return 0 on success, -1 on failure
+        */
+        int lease_revoke(int64_t lease_id);
+
         /**
         * Watches for changes of a key, registers user_callback and notify
         * user if any change on key occured
@@ -134,10 +238,92 @@ class EtcdClient {
         */
         void watch_prefix(std::string& key, kv_store_watch_callback_t user_cb, void *user_data);
 
+        /**
+        * Delivers every key of a prefix and its raw value, then watches the
+        * prefix from the revision they were read at, delivering later puts
+        * and deletes (with a NULL value), and resyncs after compactions
+        * @param key is the prefix to be mirrored
+        * @param user_callback user_call back called for every key
+        * @param user_data user_data to be passed, it can be NULL also
+        * @return 0 once the current keys were delivered, -1 on failure
+        */
+        int watch_prefix_kv(std::string& key, kv_store_watch_kv_callback_t user_cb, void *user_data);
+
     private:
         char address[ADDRESS_LEN];
         grpc::SslCredentialsOptions ssl_opts;
+        std::shared_ptr<Channel> channel;
         std::unique_ptr<KV::Stub> kv_stub;
+        std::unique_ptr<Lease::Stub> lease_stub;
+
+        // Leases renewed by the keepalive thread, mapped to their TTL
+        // in seconds and the time of their next renewal
+        struct lease_entry_t {
+            int64_t ttl;
+            std::chrono::steady_clock::time_point next_renewal;
+        };
+        std::map<int64_t, lease_entry_t> leases;
+        std::mutex lease_mtx;
+        std::condition_variable lease_cv;
+        std::thread keepalive_thread;
+        ClientContext* keepalive_ctx;
+        bool keepalive_stop;
+
+        /**
+        * Keepalive thread body, renews every due lease over a single
+        * LeaseKeepAlive stream and re-opens the stream on failure
+        */
+        void keepalive_loop();
+
+        // Watch threads, their in-flight stream contexts are cancelled
+        // by the destructor
+        std::mutex watch_mtx;
+        std::condition_variable watch_cv;
+        std::vector<std::thread> watch_threads;
+        std::set<ClientContext*> watch_ctxs;
+        bool watch_stop;
+
+        /**
+        * Reads every key of [start, range_end) with Range requests of at
+        * most ETCD_RANGE_PAGE_SIZE keys, all at the revision of the first
+        * one, so only one page is held at a time
+        * @param on_kv called for every key, reading stops when it returns false
+        * @param revision set to the revision the keys were read at, can be NULL
+        * @return true once every key was read or on_kv stopped, false on failure
+        */
+        bool range_paged(const std::string& start, const std::string& range_end,
+                         const std::function<bool(const mvccpb::KeyValue&)>& on_kv,
+                         int64_t* revision);
+
+        /**
+        * Starts the thread of a watch, events go to user_kv_cb as raw values
+        * if it is set and to user_cb otherwise
+        */
+        void start_watch(WatchRequest& watch_req, kv_store_watch_callback_t user_cb, void *user_data,
+                         kv_store_watch_kv_callback_t user_kv_cb = NULL);
+
+        /**
+        * Watch thread body, re-opens the watch stream whenever it breaks,
+        * resuming from the revision following the last event delivered
+        */
+        void register_watch_loop(WatchRequest watch_req, kv_store_watch_callback_t user_cb, void *user_data,
+                                 kv_store_watch_kv_callback_t user_kv_cb);
+
+        /**
+        * Opens one watch stream and delivers its events
+        * @return true if the client is being destroyed, false if the
+        *         stream broke and the watch must be re-opened
+        */
+        bool register_watch(WatchRequest& watch_req, kv_store_watch_callback_t user_cb, void *user_data,
+                            kv_store_watch_kv_callback_t user_kv_cb);
+
+        /**
+        * Delivers the current keys of a watch which missed updates, ex:
+        * after a compaction, and moves its start revision past them
+        * @return false if the keys could not be read
+        */
+        bool resync_watch(WatchCreateRequest* watch_create_req, kv_store_watch_callback_t user_cb,
+                          void *user_data, kv_store_watch_kv_callback_t user_kv_cb);
 };
 
 #endif // _EII_ETCD_CLIENT_H
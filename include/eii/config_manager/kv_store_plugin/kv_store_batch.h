@@ -0,0 +1,83 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store read-through snapshot
+ *
+ * Short-lived @c kv_store_client_t over an initialized client, for callers
+ * which read many keys at once. Keys and key prefixes are queued and read
+ * in one round trip with get_batch(), later get() and get_prefix() calls
+ * are answered from the result. Keys which were not prefetched are read
+ * from the underlying client once and remembered, so every distinct key
+ * or prefix is read at most once over the lifetime of the snapshot.
+ *
+ * A snapshot is not thread-safe and is meant to be used by one caller.
+ */
+
+#ifndef EII_KV_STORE_BATCH_H
+#define EII_KV_STORE_BATCH_H
+
+#include <stdbool.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a snapshot over an initialized KV store client. The snapshot
+ * borrows @p inner and @p inner_handle, which must outlive it. Its handle
+ * is returned by its init() and it is freed by kv_client_free(), which
+ * leaves @p inner untouched.
+ *
+ * @param inner        - client to read from
+ * @param inner_handle - handle returned by the init() of @p inner
+ * @return snapshot @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_batch_new(kv_store_client_t* inner, void* inner_handle);
+
+/**
+ * Queue a key or a key prefix to be read by kv_store_batch_fetch().
+ * Duplicates are queued once.
+ *
+ * @param batch  - client returned by kv_store_batch_new()
+ * @param key    - key or key prefix
+ * @param prefix - whether @p key is a prefix
+ * @return 0 on success, -1 on failure
+ */
+int kv_store_batch_add(kv_store_client_t* batch, const char* key, bool prefix);
+
+/**
+ * Read every queued key and prefix in one get_batch() call. Keys covered
+ * by a queued prefix are not read on their own. On failure, or if the
+ * underlying client has no get_batch(), keys are read one by one on
+ * first use instead.
+ *
+ * @param batch - client returned by kv_store_batch_new()
+ * @return 0 if the queued keys were read, -1 otherwise
+ */
+int kv_store_batch_fetch(kv_store_client_t* batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief KV Store client over a fixed set of keys
+ *
+ * Read-only @c kv_store_client_t serving the keys it is created with, e.g.
+ * the keys baked into a config bundle by cfgmgr-bake. Nothing is connected
+ * to: init() always succeeds, keys never change so watches are never
+ * notified, and writes and leases fail.
+ */
+
+#ifndef EII_KV_STORE_BUNDLE_H
+#define EII_KV_STORE_BUNDLE_H
+
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a client serving a fixed set of keys. The client takes ownership
+ * of @p values, which is destroyed once the keys are copied.
+ *
+ * @param values - JSON object of every key and its value, values which
+ *                 are not strings are ignored
+ * @return read-only @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_bundle_new(config_t* values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store fault injection decorator
+ *
+ * Wraps any @c kv_store_client_t and injects latency, errors, dropped watch
+ * streams and synthetic compactions, to reproduce slow or flaky KV stores
+ * without a real cluster.
+ */
+
+#ifndef EII_KV_STORE_FAULT_H
+#define EII_KV_STORE_FAULT_H
+
+#include <stdint.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_metrics.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Latency distributions which can be injected before an operation
+ */
+typedef enum {
+    // No added latency
+    KV_FAULT_LATENCY_NONE = 0,
+    // Always min_us
+    KV_FAULT_LATENCY_FIXED = 1,
+    // Uniform between min_us and max_us
+    KV_FAULT_LATENCY_UNIFORM = 2,
+    // min_us plus an exponential tail with a mean of max_us
+    KV_FAULT_LATENCY_EXPONENTIAL = 3,
+} kv_fault_latency_t;
+
+/**
+ * Faults injected into one operation. Operations are indexed by
+ * @c kv_store_op_t, for @c KV_OP_WATCH_EVENT the latency is added before
+ * the user callback and the error rate is the probability that an event
+ * breaks its watch stream.
+ */
+typedef struct {
+    kv_fault_latency_t latency;
+    uint64_t min_us;
+    uint64_t max_us;
+    // Probability in [0, 1] of failing the operation
+    double error_rate;
+} kv_fault_op_config_t;
+
+/**
+ * Fault injection configuration
+ */
+typedef struct {
+    kv_fault_op_config_t ops[KV_OP_COUNT];
+
+    // Probability in [0, 1] that a watch event triggers a synthetic
+    // compaction: the event is lost and the watched key or prefix is
+    // re-read and delivered as etcd clients do on ErrCompacted
+    double watch_compact_rate;
+
+    // Outage of a dropped watch stream in microseconds. Events are lost
+    // until the stream reconnects, which re-reads and delivers the watched
+    // key or prefix the same way as after a compaction
+    uint64_t watch_reconnect_us;
+
+    // Seed of the random number generators, 0 for a time based seed
+    uint64_t seed;
+} kv_fault_config_t;
+
+/**
+ * Counters of the faults injected so far
+ */
+typedef struct {
+    uint64_t injected_errors[KV_OP_COUNT];
+    uint64_t injected_delay_us[KV_OP_COUNT];
+    // Watch events lost, by the stream drops or while the streams were down
+    uint64_t dropped_events;
+    uint64_t stream_drops;
+    uint64_t reconnects;
+    uint64_t compactions;
+} kv_fault_stats_t;
+
+/**
+ * Wrap a KV store client with the fault injection decorator. The returned
+ * client takes ownership of @p inner, which is initialized by the returned
+ * client's init() and freed along with it by kv_client_free().
+ *
+ * @param inner  - client to inject faults into
+ * @param config - initial fault configuration, NULL for no faults
+ * @return decorated @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_fault_wrap(kv_store_client_t* inner, const kv_fault_config_t* config);
+
+/**
+ * Replace the fault configuration of a decorated client, takes effect
+ * on the next operation
+ *
+ * @param client - client returned by kv_store_fault_wrap()
+ * @param config - new fault configuration
+ * @return 0 on success, -1 if @p client is not decorated
+ */
+int kv_store_fault_configure(kv_store_client_t* client, const kv_fault_config_t* config);
+
+/**
+ * Parse a fault specification string into a configuration. The format is
+ * a semicolon separated list of `<op>:<key>=<value>[,<key>=<value>...]`
+ * where op is one of get, get_prefix, get_batch, put or watch and keys are:
+ *  - `latency=fixed:<us>`, `latency=uniform:<min_us>:<max_us>` or
+ *    `latency=exp:<min_us>:<mean_us>`
+ *  - `error=<rate>` (`drop=<rate>` for watch)
+ *  - `compact=<rate>` and `reconnect=<us>` (watch only)
+ * plus an optional `seed=<n>` entry. Rates must lie in [0, 1].
+ * Ex: `get:latency=exp:200:1000,error=0.01;watch:drop=0.1,reconnect=500000;seed=7`
+ *
+ * @param spec   - fault specification
+ * @param config - configuration to fill
+ * @return 0 on success, -1 on parse error
+ */
+int kv_store_fault_parse(const char* spec, kv_fault_config_t* config);
+
+/**
+ * Fetch the counters of injected faults
+ *
+ * @param client - client returned by kv_store_fault_wrap()
+ * @param stats  - counters to fill
+ * @return 0 on success, -1 if @p client is not decorated
+ */
+int kv_store_fault_stats(kv_store_client_t* client, kv_fault_stats_t* stats);
+
+/**
+ * Reconnect every dropped watch stream now, without waiting for the end of
+ * their outage. The watched keys are resynced before returning.
+ *
+ * @param client - client returned by kv_store_fault_wrap()
+ * @return number of streams reconnected, -1 if @p client is not decorated
+ */
+int kv_store_fault_reconnect(kv_store_client_t* client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store metrics decorator
+ *
+ * Wraps any @c kv_store_client_t and records per-operation counts, counts
+ * per @c kv_store_status_t, payload bytes and latency histograms. Histograms are log-linear (8
+ * sub-buckets per power of two, ~12.5% relative error) over nanoseconds.
+ * Recording is lock-free, each thread updates its own cache-aligned shard
+ * which are summed when a snapshot is taken.
+ */
+
+#ifndef EII_KV_STORE_METRICS_H
+#define EII_KV_STORE_METRICS_H
+
+#include <stdint.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sub-bucket bits of the latency histogram
+#define KV_METRICS_SUB_BITS     3
+
+// Highest power of two (in ns) tracked by the histogram, ~68 seconds
+#define KV_METRICS_MAX_BITS     36
+
+// Number of latency buckets per operation
+#define KV_METRICS_BUCKETS      (((KV_METRICS_MAX_BITS - KV_METRICS_SUB_BITS + 1) << KV_METRICS_SUB_BITS) + \
+                                 (1 << KV_METRICS_SUB_BITS))
+
+/**
+ * Operations recorded by the metrics decorator
+ */
+typedef enum {
+    KV_OP_GET = 0,
+    KV_OP_GET_PREFIX = 1,
+    KV_OP_PUT = 2,
+    KV_OP_WATCH_EVENT = 3,
+    KV_OP_GET_BATCH = 4,
+    KV_OP_COUNT = 5,
+} kv_store_op_t;
+
+/**
+ * Aggregated metrics of one operation. For watch events the latency is
+ * the time spent in the user callback. Reads of missing keys are counted
+ * as KV_STORE_NOT_FOUND, not as errors. get_prefix() reads don't count
+ * bytes, only those streamed by get_prefix_kv() do.
+ */
+typedef struct {
+    uint64_t count;
+    // Operations which failed, every status but KV_STORE_OK and
+    // KV_STORE_NOT_FOUND
+    uint64_t errors;
+    uint64_t statuses[KV_STORE_STATUS_COUNT];
+    uint64_t bytes;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+    uint64_t buckets[KV_METRICS_BUCKETS];
+} kv_store_op_metrics_t;
+
+/**
+ * Point in time copy of the metrics of a client
+ */
+typedef struct {
+    kv_store_op_metrics_t ops[KV_OP_COUNT];
+} kv_store_metrics_snapshot_t;
+
+/**
+ * Wrap a KV store client with the metrics decorator. The returned client
+ * takes ownership of @p inner, which is initialized by the returned
+ * client's init() and freed along with it by kv_client_free().
+ *
+ * @param inner - client to be instrumented
+ * @return instrumented @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_metrics_wrap(kv_store_client_t* inner);
+
+/**
+ * Check whether a client is wrapped by the metrics decorator
+ *
+ * @param client - KV store client
+ * @return true if @p client was returned by kv_store_metrics_wrap()
+ */
+bool kv_store_metrics_enabled(kv_store_client_t* client);
+
+/**
+ * Take a snapshot of the metrics recorded so far
+ *
+ * @param client   - client returned by kv_store_metrics_wrap()
+ * @param snapshot - snapshot to fill
+ * @return 0 on success, -1 if @p client is not instrumented
+ */
+int kv_store_metrics_snapshot(kv_store_client_t* client, kv_store_metrics_snapshot_t* snapshot);
+
+/**
+ * Reset all metrics of a client to zero
+ *
+ * @param client - client returned by kv_store_metrics_wrap()
+ */
+void kv_store_metrics_reset(kv_store_client_t* client);
+
+/**
+ * Latency percentile of an operation from a snapshot
+ *
+ * @param op         - operation metrics from a snapshot
+ * @param percentile - percentile in the range [0, 100]
+ * @return upper bound of the bucket holding the percentile in ns, 0 if
+ *         no operation was recorded
+ */
+uint64_t kv_store_metrics_percentile(const kv_store_op_metrics_t* op, double percentile);
+
+/**
+ * Name of an operation, as used in the Prometheus labels
+ */
+const char* kv_store_metrics_op_name(kv_store_op_t op);
+
+/**
+ * Dump the metrics of a client in the Prometheus text exposition format
+ *
+ * @param client - client returned by kv_store_metrics_wrap()
+ * @return malloc'd NULL terminated string which must be freed by the
+ *         caller, or NULL on failure
+ */
+char* kv_store_metrics_prometheus(kv_store_client_t* client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store prefix mirror
+ *
+ * Wraps any @c kv_store_client_t and keeps an in-memory copy of every key
+ * under one prefix. The copy is seeded when the client is initialized and
+ * kept current by a single watch_prefix_kv(), so get(), get_prefix() and
+ * get_batch() of keys under the prefix are answered without a round trip.
+ * Everything else goes to the wrapped client, as do all reads if it has no
+ * watch_prefix_kv() or the prefix could not be mirrored.
+ *
+ * Mirrored reads trail the kv_store by the latency of the watch.
+ */
+
+#ifndef EII_KV_STORE_MIRROR_H
+#define EII_KV_STORE_MIRROR_H
+
+#include <stdbool.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Format for the callback notified of changes of the mirrored keys
+ * @param name       key without the mirrored prefix
+ * @param value      new value, NULL if the key was deleted
+ * @param user_data  user data passed
+ */
+typedef void (*kv_store_mirror_callback_t)(const char* name, const char* value, void* user_data);
+
+/**
+ * Wrap a KV store client with a mirror of a key prefix. The returned client
+ * takes ownership of @p inner, which is initialized by the returned client's
+ * init() and freed along with it by kv_client_free().
+ *
+ * @param inner  - client to mirror the prefix of
+ * @param prefix - key prefix to keep in memory
+ * @return decorated @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_mirror_wrap(kv_store_client_t* inner, const char* prefix);
+
+/**
+ * Whether reads of the prefix are answered from memory, true once the
+ * client was initialized and the prefix mirrored
+ *
+ * @param client - client returned by kv_store_mirror_wrap()
+ * @return false if the prefix is not mirrored or @p client is not a mirror
+ */
+bool kv_store_mirror_active(kv_store_client_t* client);
+
+/**
+ * Register a callback called from the watch thread after every change of
+ * the mirrored keys. Callbacks can't be unregistered and @p user_data must
+ * outlive the client.
+ *
+ * @param client    - client returned by kv_store_mirror_wrap()
+ * @param cb        - callback
+ * @param user_data - user data passed to @p cb
+ * @return 0 on success, -1 if the prefix is not mirrored
+ */
+int kv_store_mirror_listen(kv_store_client_t* client, kv_store_mirror_callback_t cb, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
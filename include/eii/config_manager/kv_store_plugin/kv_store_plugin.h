@@ -25,6 +25,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <eii/utils/config.h>
@@ -46,6 +48,34 @@ extern "C" {
  */
 typedef void (*kv_store_watch_callback_t)(const char *key, config_t* value, void *cb_user_data);
 
+/**
+ * Format for the user callback of watch_prefix_kv, called with the raw value
+ * of every key of the watched prefix.
+ *
+ * When the watch can not replay the updates it missed, ex: once etcd has
+ * compacted them away, every current key of the prefix is delivered again
+ * between two calls with a NULL key: the first one has the watched prefix
+ * as value, the last one a NULL value. Keys which are not delivered in
+ * between were deleted meanwhile, callers should replace their keys of the
+ * prefix by the delivered ones once the resync ends.
+ * @param key           key being updated, without ETCD_PREFIX. NULL for
+ *                      the start and the end of a resync
+ * @param value         updated value, NULL if the key was deleted
+ * @param cb_user_data  user data passed
+ */
+typedef void (*kv_store_watch_kv_callback_t)(const char *key, const char* value, void *cb_user_data);
+
+/**
+ * Format for the user callback of get_prefix_kv, called with every key of
+ * the prefix and its raw value as they are read
+ * @param key           key read, without ETCD_PREFIX. NULL when falling
+ *                      back to get_prefix(), which only returns values
+ * @param value         raw value of the key, only valid during the call
+ * @param cb_user_data  user data passed
+ * @return 0 to go on, any other value stops reading the prefix
+ */
+typedef int (*kv_store_get_kv_callback_t)(const char *key, const char* value, void *cb_user_data);
+
 
 /*
  * Representation of kv_store_client object
@@ -65,7 +95,19 @@ typedef struct {
 
         // function pointer to assign to get all value of 
         // a prefixed key from kv_store_client
-        char* (*get_prefix) (void* handle, char *key);
+        config_value_t* (*get_prefix) (void* handle, char *key);
+
+        // function pointer to stream all keys of a prefix: calls cb with every
+        // key and its raw value in key order, a page at a time, without
+        // collecting them first. Returns the number of keys delivered, -1 on
+        // failure. NULL for kv_stores without it
+        int (*get_prefix_kv) (void* handle, char *key, kv_store_get_kv_callback_t cb, void* user_data);
+
+        // function pointer to read several keys and key prefixes in one round
+        // trip, prefixes[i] tells whether keys[i] is a prefix. Returns a JSON
+        // object of every key found and its value, or NULL on failure. NULL
+        // for kv_stores without batched reads
+        config_t* (*get_batch) (void* handle, char **keys, const bool* prefixes, size_t count);
 
         // function poiner to assign to store value of a particular key into kv_store
         int (*put) (void* handle, char *key, char *value);
@@ -78,10 +120,65 @@ typedef struct {
         // notify user if any change on key occured
         void (*watch_prefix) (void* handle, char *key, kv_store_watch_callback_t cb, void* user_data);
 
+        // function pointer to mirror a key prefix: calls cb with every key of
+        // the prefix and its raw value before returning, then with every later
+        // put and with a NULL value for deleted keys, resyncing the prefix when
+        // updates were lost. Returns 0 once the current keys were delivered, -1
+        // on failure. NULL for kv_stores without it
+        int (*watch_prefix_kv) (void* handle, char *key, kv_store_watch_kv_callback_t cb, void* user_data);
+
+        // function pointer to grant a lease of ttl seconds from kv_store,
+        // granted lease id is written to lease_id
+        int (*grant_lease) (void* handle, int64_t ttl, int64_t* lease_id);
+
+        // function pointer to store value of a key attached to a lease,
+        // the key is removed from kv_store once the lease expires
+        int (*put_with_lease) (void* handle, char *key, char *value, int64_t lease_id);
+
+        // function pointer to keep a lease alive, all leases of a client
+        // are renewed over one shared keepalive stream
+        int (*keepalive) (void* handle, int64_t lease_id);
+
+        // function pointer to revoke a lease, removing all keys attached to it
+        int (*revoke_lease) (void* handle, int64_t lease_id);
+
         // function pointer to delete respective kv_store
         void (*deinit)(void* handle);
 } kv_store_client_t;
 
+/**
+ * Outcome of the last operation of a kv_store_client on the calling thread,
+ * so that a NULL value from get() can be told from a failed read
+ */
+typedef enum {
+    KV_STORE_OK = 0,
+    KV_STORE_NOT_FOUND = 1,
+    KV_STORE_UNAVAILABLE = 2,
+    KV_STORE_DEADLINE_EXCEEDED = 3,
+    KV_STORE_PERMISSION_DENIED = 4,
+    KV_STORE_ERROR = 5,
+    KV_STORE_STATUS_COUNT = 6,
+} kv_store_status_t;
+
+/**
+ * Record the outcome of an operation, called by kv_store_client
+ * implementations before returning
+ * @param status  outcome of the operation
+ */
+void kv_store_set_status(kv_store_status_t status);
+
+/**
+ * Outcome of the last operation of the calling thread. kv_store_clients
+ * which don't record it leave KV_STORE_OK
+ * @return @c kv_store_status_t
+ */
+kv_store_status_t kv_store_last_status(void);
+
+/**
+ * Name of a status, as used in the metrics labels
+ */
+const char* kv_store_status_name(kv_store_status_t status);
+
 /**
  * Create KV_Store based on the config passed. 
  * Ex: if config's `type` is `etcd, it will create etcd_client instance
@@ -95,6 +192,19 @@ kv_store_client_t* create_kv_client(config_t* config);
  */
 void kv_client_free(kv_store_client_t* kv_store_client);
 
+/**
+ * Calls cb with every value of a prefix, streamed with get_prefix_kv() when
+ * the kv_store_client supports it, else read with get_prefix()
+ * @param client  kv_store_client to read from
+ * @param handle  handle of the kv_store_client
+ * @param key     prefix to be read
+ * @param cb      callback called for every value
+ * @param user_data user data passed to cb
+ * @return number of values delivered, -1 on failure
+ */
+int kv_store_get_prefix_each(kv_store_client_t* client, void* handle, char* key,
+                             kv_store_get_kv_callback_t cb, void* user_data);
+
 #ifdef __cplusplus
 }
 #endif
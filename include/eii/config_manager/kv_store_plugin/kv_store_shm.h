@@ -0,0 +1,103 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store node-local shared-memory cache
+ *
+ * Wraps any @c kv_store_client_t and shares the keys under a set of prefixes
+ * between every process of a node through a POSIX shared-memory segment.
+ * The processes wrapping a client with the same segment name elect one
+ * leader by locking the segment: the leader mirrors the prefixes with
+ * watch_prefix_kv() and publishes them to the segment under a seqlock.
+ * The other processes map the segment and read those keys without locking
+ * and without connecting to the kv_store. Their watches on shared keys are
+ * served by polling the segment.
+ *
+ * Followers only initialize the wrapped client, i.e. open their own
+ * connection, once they read, write or watch a key outside of the shared
+ * prefixes. When the leader exits, a follower takes its place within one
+ * poll interval; until then reads are served from the last published
+ * snapshot.
+ *
+ * Every process sharing a segment must run with the same user or group and
+ * the same /dev/shm, e.g. containers with a shared IPC namespace. Shared
+ * keys are readable by all of them, so prefixes holding private keys must
+ * only be shared between processes trusted with them.
+ */
+
+#ifndef EII_KV_STORE_SHM_H
+#define EII_KV_STORE_SHM_H
+
+#include <stdbool.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Prefixes shared when none are given, the keys every application reads
+#define KV_STORE_SHM_DEFAULT_PREFIXES  "/GlobalEnv/,/Publickeys/"
+
+// Bytes of the segment, snapshots not fitting are not shared
+#define KV_STORE_SHM_SIZE  (4 * 1024 * 1024)
+
+// Milliseconds between two polls of the segment for watches and leadership
+#define KV_STORE_SHM_POLL_MS  100
+
+// Milliseconds a follower waits for the leader to publish a first snapshot
+#define KV_STORE_SHM_WAIT_MS  10000
+
+/**
+ * Wrap a KV store client with a node-local shared-memory cache. The
+ * returned client takes ownership of @p inner, which is only initialized
+ * when needed and freed along with the returned client by
+ * kv_client_free().
+ *
+ * @param inner    - client reading the kv_store
+ * @param name     - name of the segment, e.g. "/eii_cfgmgr", shared by the
+ *                   processes of the node
+ * @param prefixes - comma separated key prefixes to share
+ * @return decorated @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_shm_wrap(kv_store_client_t* inner, const char* name, const char* prefixes);
+
+/**
+ * Whether this process is the leader publishing the segment
+ *
+ * @param client - client returned by kv_store_shm_wrap()
+ * @return false for followers or if @p client is not a shared-memory cache
+ */
+bool kv_store_shm_leader(kv_store_client_t* client);
+
+/**
+ * Whether this process opened its own connection to the kv_store, always
+ * true for the leader
+ *
+ * @param client - client returned by kv_store_shm_wrap()
+ * @return false if every request was served from the segment so far
+ */
+bool kv_store_shm_connected(kv_store_client_t* client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
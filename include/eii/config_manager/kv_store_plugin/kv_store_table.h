@@ -0,0 +1,143 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Sorted key-value table
+ *
+ * Keys and their values kept sorted by key in one array, as the kv_store
+ * returns them. Shared by the mirror, the shared memory segment, the warm
+ * start snapshot, the bundle and the agent, which all look keys up by
+ * binary search and walk prefixes in key order.
+ */
+
+#ifndef EII_KV_STORE_TABLE_H
+#define EII_KV_STORE_TABLE_H
+
+#include <stddef.h>
+#include <eii/utils/config.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    char* key;
+    char* value;
+} kv_table_entry_t;
+
+/**
+ * Entries sorted by key, zero initialized tables are empty
+ */
+typedef struct {
+    kv_table_entry_t* items;
+    size_t count;
+    size_t cap;
+} kv_table_t;
+
+/**
+ * Callback of kv_table_diff(), @p value is NULL for removed keys
+ */
+typedef void (*kv_table_diff_cb_t)(const char* key, const char* value, void* user_data);
+
+/**
+ * Index of the first entry not less than @p key
+ */
+size_t kv_table_lower_bound(const kv_table_t* table, const char* key);
+
+/**
+ * Entry of @p key, NULL if there is none
+ */
+kv_table_entry_t* kv_table_find(const kv_table_t* table, const char* key);
+
+/**
+ * Insert an entry at @p pos, taking ownership of @p key and @p value
+ *
+ * @return 0 on success, -1 if out of memory, in which case the caller
+ *         keeps ownership of @p key and @p value
+ */
+int kv_table_insert(kv_table_t* table, size_t pos, char* key, char* value);
+
+/**
+ * Free and remove the entry at @p pos
+ */
+void kv_table_remove_at(kv_table_t* table, size_t pos);
+
+/**
+ * Copy @p value into the entry of @p key, NULL values are kept as such
+ *
+ * @return 1 if the table changed, 0 if not, -1 if out of memory
+ */
+int kv_table_set(kv_table_t* table, const char* key, const char* value);
+
+/**
+ * Copy a put or, with a NULL @p value, a delete into the table
+ *
+ * @return 1 if the table changed, 0 if not, -1 if out of memory
+ */
+int kv_table_apply(kv_table_t* table, const char* key, const char* value);
+
+/**
+ * Sort entries appended out of order, ex: with kv_table_insert() at the
+ * end of the table
+ */
+void kv_table_sort(kv_table_t* table);
+
+/**
+ * Free every entry, keeping the table usable
+ */
+void kv_table_clear(kv_table_t* table);
+
+/**
+ * Replace the entries of @p dst by the ones of @p src, which is left empty
+ */
+void kv_table_move(kv_table_t* dst, kv_table_t* src);
+
+/**
+ * Merge two tables, calling @p cb for every key of @p to which is not in
+ * @p from or has another value there, and with a NULL value for every key
+ * of @p from which is not in @p to
+ */
+void kv_table_diff(const kv_table_t* from, const kv_table_t* to, kv_table_diff_cb_t cb,
+                   void* user_data);
+
+/**
+ * Replace every entry of @p table under @p prefix by the entries of
+ * @p keys, which must all be under @p prefix and which is left empty
+ *
+ * @return 0 on success, -1 if out of memory, leaving @p table unchanged
+ */
+int kv_table_replace_prefix(kv_table_t* table, const char* prefix, kv_table_t* keys);
+
+/**
+ * Values of the entries under @p prefix, in key order, as the kv_store's
+ * get_prefix() returns them: NULL if no key has the prefix, otherwise an
+ * array without a free function, which config_set() hands over
+ *
+ * @return new @c config_value_t owned by the caller, or NULL
+ */
+config_value_t* kv_table_to_prefix_value(const kv_table_t* table, const char* prefix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store warm-start snapshot
+ *
+ * Wraps any @c kv_store_client_t and records every key and key prefix read
+ * through it in a snapshot file, written atomically by a background thread
+ * whenever the recorded keys change. When the client is initialized and
+ * a valid snapshot of the same scope exists, the wrapped client is not
+ * waited for: recorded keys are read from the snapshot, and a background
+ * thread initializes the wrapped client, registers the watches and
+ * notifies them of every key which changed since the snapshot was taken.
+ * From then on reads go to the wrapped client. Keys which were not
+ * recorded are always read from the wrapped client.
+ *
+ * Snapshots end with a SHA-256 of their content, so that torn or corrupt
+ * files are ignored. Given a 256-bit key, they are instead encrypted and
+ * authenticated with AES-256-GCM. Keys under the secret prefixes are only
+ * recorded in encrypted snapshots. Unencrypted snapshots are only
+ * protected by the permissions of the file, created with mode 0600.
+ */
+
+#ifndef EII_KV_STORE_WARM_H
+#define EII_KV_STORE_WARM_H
+
+#include <stdbool.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
+#include <eii/config_manager/cfgmgr_seal.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bytes of the snapshot encryption key
+#define KV_STORE_WARM_KEY_SIZE  CFGMGR_SEAL_KEY_SIZE
+
+// Largest snapshot file loaded
+#define KV_STORE_WARM_MAX_SIZE  (64 * 1024 * 1024)
+
+// Milliseconds between two attempts to initialize the wrapped client
+#define KV_STORE_WARM_RETRY_MS  1000
+
+/**
+ * Wrap a KV store client with a warm-start snapshot. The returned client
+ * takes ownership of @p inner, which is initialized by the returned
+ * client's init(), in the background when starting from a snapshot, and
+ * freed along with it by kv_client_free().
+ *
+ * @param inner   - client to record the reads of
+ * @param path    - snapshot file
+ * @param scope   - identity of the reader, e.g. the AppName, snapshots of
+ *                  another scope are ignored
+ * @param key     - KV_STORE_WARM_KEY_SIZE bytes encrypting the snapshot,
+ *                  NULL to write it in clear
+ * @param secrets - comma separated key prefixes only recorded when @p key
+ *                  is given, NULL or empty for none
+ * @return decorated @c kv_store_client_t, or NULL on failure
+ */
+kv_store_client_t* kv_store_warm_wrap(kv_store_client_t* inner, const char* path, const char* scope,
+                                      const unsigned char* key, const char* secrets);
+
+/**
+ * Read a snapshot encryption key from a file holding either
+ * KV_STORE_WARM_KEY_SIZE raw bytes or their hex encoding
+ *
+ * @param path - key file
+ * @param key  - filled with the key
+ * @return 0 on success, -1 on failure
+ */
+int kv_store_warm_read_key(const char* path, unsigned char* key);
+
+/**
+ * Write the recorded keys to the snapshot file now, instead of waiting for
+ * the background writer
+ *
+ * @param client - client returned by kv_store_warm_wrap()
+ * @return 0 on success, -1 on failure or if @p client is not a warm-start
+ *         client
+ */
+int kv_store_warm_persist(kv_store_client_t* client);
+
+/**
+ * Whether the client was initialized from a snapshot
+ *
+ * @param client - client returned by kv_store_warm_wrap()
+ * @return false after a cold start or if @p client is not a warm-start
+ *         client
+ */
+bool kv_store_warm_started(kv_store_client_t* client);
+
+/**
+ * Whether reads go to the wrapped client, true after a cold start and once
+ * the watches were reconciled after a warm start
+ *
+ * @param client - client returned by kv_store_warm_wrap()
+ * @return false while serving the snapshot or if @p client is not a
+ *         warm-start client
+ */
+bool kv_store_warm_live(kv_store_client_t* client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -74,6 +74,13 @@ namespace eii {
                  */
                 config_t* getMsgBusConfig() override;
 
+                /**
+                 * Constructs message bus config for Publisher in the binary form
+                 * @return BinaryConfig* - On Success, binary msg bus publisher config, to be deleted by the caller
+                 *                       - On Failure, throws
+                 */
+                BinaryConfig* getMsgBusConfigBinary() override;
+
                 /**
                  * To get endpoint for particular publisher from it's interface config
                  * @return std::string - On Success, returns Endpoint of server config
@@ -71,6 +71,13 @@ namespace eii {
                  */
                 config_t* getMsgBusConfig() override;
 
+                /**
+                 * Constructs message bus config for Server in the binary form
+                 * @return BinaryConfig* - On Success, binary msg bus server config, to be deleted by the caller
+                 *                       - On Failure, throws
+                 */
+                BinaryConfig* getMsgBusConfigBinary() override;
+
                 /**
                  * To get particular interface value from Server interface config
                  * @param key - Key on which interface value is extracted.
@@ -70,6 +70,13 @@ namespace eii {
                  */
                 config_t* getMsgBusConfig() override;
 
+                /**
+                 * Constructs message bus config for Subscriber in the binary form
+                 * @return BinaryConfig* - On Success, binary msg bus subscriber config, to be deleted by the caller
+                 *                       - On Failure, throws
+                 */
+                BinaryConfig* getMsgBusConfigBinary() override;
+
                 /**
                  * To get particular interface value from Subscriber interface config
                  * @param key - Key on which interface value is extracted.
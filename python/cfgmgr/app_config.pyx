@@ -20,6 +20,8 @@
 """EII Message Bus Publisher wrapper object
 """
 
+import json
+
 from .libeiiconfigmanager cimport *
 
 
@@ -36,6 +38,55 @@ cdef void watch_callback_fn(const char* key, config_t* value, void* func) with g
     config_destroy(value)
     (<object>func)(key.decode(), py_value.decode())
 
+cdef void public_keys_callback_fn(const char* app_name, const char* public_key, void* func) with gil:
+    """C callback def which internally calls
+       the Py callback function with the new key, None if removed
+    """
+    py_key = None
+    if public_key is not NULL:
+        py_key = public_key.decode()
+    (<object>func)(app_name.decode(), py_key)
+
+cdef object change_str(const char* value):
+    """Decodes an optional string of a change
+    """
+    if value is NULL:
+        return None
+    return value.decode()
+
+cdef void changes_callback_fn(const cfgmgr_changes_t* changes, void* func) with gil:
+    """C callback def which internally calls the Py callback
+       function with the list of changes, each as a dict
+    """
+    kinds = {
+        CFGMGR_CHANGE_ADDED: "added",
+        CFGMGR_CHANGE_REMOVED: "removed",
+        CFGMGR_CHANGE_MODIFIED: "modified",
+    }
+    type_keys = {
+        CFGMGR_PUBLISHER: "Publishers",
+        CFGMGR_SUBSCRIBER: "Subscribers",
+        CFGMGR_SERVER: "Servers",
+        CFGMGR_CLIENT: "Clients",
+    }
+    cdef const cfgmgr_change_t* change
+    py_changes = []
+    for i in range(changes.count):
+        change = &changes.changes[i]
+        old_value = change_str(change.old_value)
+        new_value = change_str(change.new_value)
+        py_changes.append({
+            "kind": kinds[change.kind],
+            "path": change.path.decode(),
+            "interface": type_keys[change.iface_type] if change.iface else None,
+            "name": change_str(change.iface_name),
+            "field": change_str(change.field),
+            "item": change_str(change.item),
+            "old": json.loads(old_value) if old_value is not None else None,
+            "new": json.loads(new_value) if new_value is not None else None,
+        })
+    (<object>func)(py_changes)
+
 class AppCfg:
     """EII Message Bus Publisher object
     """
@@ -159,3 +210,40 @@ cdef class Watch:
             return
         except Exception as ex:
             raise Exception("Failed to register watch interface callback {}".format(ex))
+
+    def watch_public_keys(self, pyFunc):
+        """Method to watch over the public keys of all applications,
+           pyFunc is called with the AppName and its new public key,
+           None if it was removed. Calls the base C
+           cfgmgr_watch_public_keys() API
+
+        :param pyFunc: python function
+        :type: object
+        """
+        if cfgmgr_watch_public_keys(self.cfg_mgr, public_keys_callback_fn, <void *> pyFunc) != 0:
+            raise Exception("Failed to register watch public keys callback")
+
+    def watch_interface_changes(self, pyFunc):
+        """Method to watch over the changes of an application's interfaces,
+           pyFunc is called with a list of dicts with the keys kind
+           ("added", "removed" or "modified"), path, interface
+           ("Publishers", ...), name, field, item, old and new.
+           Calls the base C cfgmgr_watch_interface_changes() API
+
+        :param pyFunc: python function
+        :type: object
+        """
+        if cfgmgr_watch_interface_changes(self.cfg_mgr, changes_callback_fn, <void *> pyFunc) != 0:
+            raise Exception("Failed to register watch interface changes callback")
+
+    def watch_config_changes(self, pyFunc):
+        """Method to watch over the changes of an application's config,
+           pyFunc is called with a list of dicts as for
+           watch_interface_changes(), with interface set to None.
+           Calls the base C cfgmgr_watch_config_changes() API
+
+        :param pyFunc: python function
+        :type: object
+        """
+        if cfgmgr_watch_config_changes(self.cfg_mgr, changes_callback_fn, <void *> pyFunc) != 0:
+            raise Exception("Failed to register watch config changes callback")
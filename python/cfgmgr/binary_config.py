@@ -0,0 +1,294 @@
+# Copyright (c) 2021 Intel Corporation.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+"""Reader of binary msgbus configs
+
+Binary msgbus configs are read in place, without JSON: values are decoded
+from the buffer only when accessed. See cfgmgr_binary.h for the layout.
+"""
+
+import struct
+
+# Magic and version of the layout read
+MAGIC = b'CFGB'
+VERSION = 1
+
+# Node types, as cfgmgr_view_type_t
+TYPE_NONE = 0
+TYPE_NULL = 1
+TYPE_BOOLEAN = 2
+TYPE_INTEGER = 3
+TYPE_FLOATING = 4
+TYPE_STRING = 5
+TYPE_ARRAY = 6
+TYPE_OBJECT = 7
+
+_HEADER = struct.Struct('<4sHHII')
+_NODE = struct.Struct('<B3xI')
+_U32 = struct.Struct('<I')
+_PAIR = struct.Struct('<II')
+_I64 = struct.Struct('<q')
+_F64 = struct.Struct('<d')
+
+# Deepest nesting accepted, as by the C reader
+_NESTING_LIMIT = 1000
+
+
+class BinaryValue:
+    """Value of a binary config, read from the buffer when accessed
+    """
+
+    __slots__ = ('_buf', '_off', 'type', '_len')
+
+    def __init__(self, buf, off):
+        """Constructor
+
+        :param buf: Checked buffer
+        :type: memoryview
+        :param off: Offset of the node
+        :type: int
+        """
+        self._buf = buf
+        self._off = off
+        self.type, self._len = _NODE.unpack_from(buf, off)
+
+    def _at(self, index):
+        rel, = _U32.unpack_from(self._buf, self._off + 8 + index * 4)
+        return BinaryValue(self._buf, self._off + rel)
+
+    def _pair(self, index):
+        key, value = _PAIR.unpack_from(self._buf, self._off + 8 + index * 8)
+        return self._off + key, self._off + value
+
+    def _key(self, off):
+        length, = _U32.unpack_from(self._buf, off + 4)
+        return bytes(self._buf[off + 8:off + 8 + length])
+
+    def __len__(self):
+        if self.type in (TYPE_ARRAY, TYPE_OBJECT):
+            return self._len
+        return 0
+
+    def __getitem__(self, key):
+        """Value of a key of an object, or item of an array
+
+        :param key: Key, or index for arrays
+        :type: str or int
+        :return: Value
+        :rtype: BinaryValue
+        :raises KeyError: If the object has no such key
+        :raises IndexError: If the index is out of range
+        """
+        if self.type == TYPE_ARRAY:
+            if key < 0:
+                key += self._len
+            if not 0 <= key < self._len:
+                raise IndexError(key)
+            return self._at(key)
+        if self.type != TYPE_OBJECT:
+            raise TypeError('Binary value is not an object or array')
+        # Keys are sorted by their bytes
+        target = key.encode('utf-8')
+        lo, hi = 0, self._len
+        while lo < hi:
+            mid = (lo + hi) // 2
+            key_off, value_off = self._pair(mid)
+            found = self._key(key_off)
+            if found == target:
+                return BinaryValue(self._buf, value_off)
+            if target < found:
+                hi = mid
+            else:
+                lo = mid + 1
+        raise KeyError(key)
+
+    def get(self, key, default=None):
+        """Value of a key of an object, or default if missing
+        """
+        try:
+            return self[key]
+        except KeyError:
+            return default
+
+    def __contains__(self, key):
+        return self.get(key) is not None
+
+    def keys(self):
+        """Keys of an object, in key order
+        """
+        if self.type != TYPE_OBJECT:
+            raise TypeError('Binary value is not an object')
+        return [self._key(self._pair(i)[0]).decode('utf-8')
+                for i in range(self._len)]
+
+    def items(self):
+        """(key, value) pairs of an object, in key order
+        """
+        if self.type != TYPE_OBJECT:
+            raise TypeError('Binary value is not an object')
+        for i in range(self._len):
+            key_off, value_off = self._pair(i)
+            yield (self._key(key_off).decode('utf-8'),
+                   BinaryValue(self._buf, value_off))
+
+    def __iter__(self):
+        if self.type == TYPE_OBJECT:
+            return iter(self.keys())
+        if self.type == TYPE_ARRAY:
+            return (self._at(i) for i in range(self._len))
+        raise TypeError('Binary value is not an object or array')
+
+    def value(self):
+        """Scalar value
+
+        :return: Value of a string, number, boolean or null
+        :rtype: str, int, float, bool or None
+        """
+        if self.type == TYPE_STRING:
+            return self._key(self._off).decode('utf-8')
+        if self.type == TYPE_INTEGER:
+            return _I64.unpack_from(self._buf, self._off + 8)[0]
+        if self.type == TYPE_FLOATING:
+            return _F64.unpack_from(self._buf, self._off + 8)[0]
+        if self.type == TYPE_BOOLEAN:
+            return self._len != 0
+        if self.type == TYPE_NULL:
+            return None
+        raise TypeError('Binary value is not a scalar')
+
+    def to_python(self):
+        """Decode the value and everything it holds
+
+        :return: Same value as json.loads() of the JSON config
+        :rtype: dict, list or scalar
+        """
+        if self.type == TYPE_OBJECT:
+            return {k: v.to_python() for k, v in self.items()}
+        if self.type == TYPE_ARRAY:
+            return [v.to_python() for v in self]
+        return self.value()
+
+
+def _check(buf, size, off, depth, budget):
+    """Checks the node at off and everything it references, as the C
+    reader does
+    """
+    if depth >= _NESTING_LIMIT or budget[0] == 0:
+        return False
+    budget[0] -= 1
+    if off % 4 != 0 or off > size or size - off < 8:
+        return False
+    if buf[off + 1] or buf[off + 2] or buf[off + 3]:
+        return False
+    kind, length = _NODE.unpack_from(buf, off)
+    avail = size - off - 8
+    if kind == TYPE_NULL:
+        return length == 0
+    if kind == TYPE_BOOLEAN:
+        return length <= 1
+    if kind in (TYPE_INTEGER, TYPE_FLOATING):
+        return length == 0 and avail >= 8
+    if kind == TYPE_STRING:
+        return (avail > length and buf[off + 8 + length] == 0 and
+                0 not in buf[off + 8:off + 8 + length])
+    if kind == TYPE_ARRAY:
+        if length > avail // 4:
+            return False
+        for i in range(length):
+            rel, = _U32.unpack_from(buf, off + 8 + i * 4)
+            if rel < 8 or not _check(buf, size, off + rel, depth + 1, budget):
+                return False
+        return True
+    if kind == TYPE_OBJECT:
+        if length > avail // 8:
+            return False
+        prev = None
+        for i in range(length):
+            key, value = _PAIR.unpack_from(buf, off + 8 + i * 8)
+            if (key < 8 or value < 8 or
+                    not _check(buf, size, off + key, depth + 1, budget) or
+                    buf[off + key] != TYPE_STRING or
+                    not _check(buf, size, off + value, depth + 1, budget)):
+                return False
+            klen, = _U32.unpack_from(buf, off + key + 4)
+            found = bytes(buf[off + key + 8:off + key + 8 + klen])
+            if prev is not None and prev >= found:
+                return False
+            prev = found
+        return True
+    return False
+
+
+class BinaryConfig:
+    """Binary msgbus config, read in place
+
+    Keeps a reference to the buffer, which must not change while the
+    config is used.
+    """
+
+    def __init__(self, data):
+        """Constructor, checks the whole buffer
+
+        :param data: Binary config, ex: from get_msgbus_config_binary() or
+                     a file
+        :type: bytes-like object
+        :raises ValueError: If the buffer is not a valid binary config of a
+                            supported version
+        """
+        buf = memoryview(data).cast('B')
+        if len(buf) < _HEADER.size:
+            raise ValueError('Not a binary config')
+        magic, version, reserved, size, root = _HEADER.unpack_from(buf, 0)
+        if magic != MAGIC:
+            raise ValueError('Not a binary config')
+        if version != VERSION or reserved != 0:
+            raise ValueError(
+                'Unsupported binary config version {}'.format(version))
+        # The buffer may be larger than the config
+        try:
+            valid = (size <= len(buf) and root >= _HEADER.size and
+                     _check(buf, size, root, 0, [size // 8]))
+        except RecursionError:
+            valid = False
+        if not valid:
+            raise ValueError('Binary config is corrupted')
+        self._buf = buf[:size]
+        self.root = BinaryValue(self._buf, root)
+
+    def __getitem__(self, key):
+        return self.root[key]
+
+    def get(self, key, default=None):
+        return self.root.get(key, default)
+
+    def __len__(self):
+        return len(self.root)
+
+    def __iter__(self):
+        return iter(self.root)
+
+    def tobytes(self):
+        """Buffer of the config, ex: to be written to a file
+        """
+        return self._buf.tobytes()
+
+    def to_python(self):
+        """Decode the whole config, as json.loads() of the JSON config
+        """
+        return self.root.to_python()
@@ -91,22 +91,23 @@ cdef class ConfigMgr:
         """
         cdef config_t* conf
         cdef char* config
-        try: 
-            conf = cfgmgr_get_app_config(self.cfgmgr)
-            if conf is NULL:
-                raise Exception("[GetAppConfig] Conf received from base c layer is NULL")
-
+        # Only held while converted, so that replaced configs are freed
+        conf = cfgmgr_acquire_app_config(self.cfgmgr)
+        if conf is NULL:
+            raise Exception("[GetAppConfig] Conf received from base c layer is NULL")
+        try:
             config = configt_to_char(conf)
             if config is NULL:
                 raise Exception("[GetAppConfig] Configt to char conversion failed")
-                
+
             config_str = config.decode('utf-8')
+            free(config)
             cfg = json.loads(config_str)
 
             obj = AppCfg(cfg)
             return obj
-        except Exception as ex:
-            raise ex
+        finally:
+            cfgmgr_release_app_config(self.cfgmgr, conf)
 
 
     def get_watch_obj(self):
@@ -138,6 +139,54 @@ cdef class ConfigMgr:
             raise ex
 
 
+    def reload_env(self):
+        """Scan the environment again for the Type and EndPoint overrides
+        of the interfaces, which are otherwise only read at initialization
+        """
+        ret = cfgmgr_reload_env(self.cfgmgr)
+        if ret != 0:
+            raise Exception("Failed to reload env overrides")
+
+
+    def get_all_msgbus_configs(self):
+        """Constructs the message bus config of every publisher,
+        subscriber, server and client, reading the keys they need from
+        the kv_store in one batch
+
+        :return: Messagebus configs keyed by "Publishers", "Subscribers",
+                 "Servers" and "Clients", then by interface name
+        :rtype: dict
+        """
+        cdef cfgmgr_msgbus_configs_t* configs
+        cdef cfgmgr_msgbus_config_entry_t* entry
+        cdef char* config
+        type_keys = {
+            CFGMGR_PUBLISHER: "Publishers",
+            CFGMGR_SUBSCRIBER: "Subscribers",
+            CFGMGR_SERVER: "Servers",
+            CFGMGR_CLIENT: "Clients",
+        }
+        result = {key: {} for key in type_keys.values()}
+        configs = cfgmgr_get_all_msgbus_configs(self.cfgmgr)
+        if configs is NULL:
+            raise Exception("Getting msgbus configs from base c layer failed")
+        try:
+            for i in range(configs.count):
+                entry = &configs.entries[i]
+                if entry.name is NULL or entry.config is NULL:
+                    raise Exception("Failed to build the msgbus config of an interface")
+                config = configt_to_char(entry.config)
+                if config is NULL:
+                    raise Exception("config failed to get converted to char")
+                config_str = config.decode('utf-8')
+                free(config)
+                name = entry.name.decode('utf-8')
+                result[type_keys[entry.type]][name] = json.loads(config_str)
+            return result
+        finally:
+            cfgmgr_msgbus_configs_destroy(configs)
+
+
     def get_app_name(self):
         """Get the AppName for any application
         
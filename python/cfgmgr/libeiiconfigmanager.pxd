@@ -76,18 +76,59 @@ cdef extern from "eii/config_manager/cfgmgr.h" nogil:
         config_value_t* interface
         cfgmgr_ctx_t* cfg_mgr
 
+    ctypedef enum cfgmgr_iface_type_t:
+        CFGMGR_PUBLISHER
+        CFGMGR_SUBSCRIBER
+        CFGMGR_SERVER
+        CFGMGR_CLIENT
+
+    ctypedef struct cfgmgr_msgbus_config_entry_t:
+        cfgmgr_iface_type_t type
+        char* name
+        config_t* config
+
+    ctypedef struct cfgmgr_msgbus_configs_t:
+        cfgmgr_msgbus_config_entry_t* entries
+        size_t count
+
+    ctypedef enum cfgmgr_change_kind_t:
+        CFGMGR_CHANGE_ADDED
+        CFGMGR_CHANGE_REMOVED
+        CFGMGR_CHANGE_MODIFIED
+
+    ctypedef struct cfgmgr_change_t:
+        cfgmgr_change_kind_t kind
+        const char* path
+        bool iface
+        cfgmgr_iface_type_t iface_type
+        const char* iface_name
+        const char* field
+        const char* item
+        const char* old_value
+        const char* new_value
+
+    ctypedef struct cfgmgr_changes_t:
+        cfgmgr_change_t* changes
+        size_t count
+
     # C callback type definition
     ctypedef void (*cfgmgr_watch_callback_t)(const char* key, config_t* value, void* cb_user_data)
+    ctypedef void (*cfgmgr_public_keys_callback_t)(const char* app_name, const char* public_key, void* user_data)
+    ctypedef void (*cfgmgr_changes_callback_t)(const cfgmgr_changes_t* changes, void* user_data)
 
     # cfg_mgr APIs
     bool cfgmgr_is_dev_mode(cfgmgr_ctx_t* cfgmgr)
     config_value_t* cfgmgr_get_appname(cfgmgr_ctx_t* cfgmgr)
     config_t* cfgmgr_get_app_config(cfgmgr_ctx_t* cfgmgr)
+    config_t* cfgmgr_acquire_app_config(cfgmgr_ctx_t* cfgmgr)
+    void cfgmgr_release_app_config(cfgmgr_ctx_t* cfgmgr, config_t* app_config)
     config_t* cfgmgr_get_app_interface(cfgmgr_ctx_t* cfgmgr)
     config_value_t* cfgmgr_get_interface_value(cfgmgr_interface_t* cfgmgr_interface, const char* key)
     config_value_t* cfgmgr_get_app_config_value(cfgmgr_ctx_t* cfgmgr, const char* key)
     config_value_t* cfgmgr_get_app_interface_value(cfgmgr_ctx_t* cfgmgr, const char* key)
     config_t* cfgmgr_get_msgbus_config(cfgmgr_interface_t* ctx)
+    cfgmgr_msgbus_configs_t* cfgmgr_get_all_msgbus_configs(cfgmgr_ctx_t* cfgmgr)
+    void cfgmgr_msgbus_configs_destroy(cfgmgr_msgbus_configs_t* configs)
     config_value_t* cfgmgr_get_endpoint(cfgmgr_interface_t* ctx)
     config_value_t* cfgmgr_get_topics(cfgmgr_interface_t* ctx)
     bool cfgmgr_set_topics(cfgmgr_interface_t* ctx, char** topics_list, int len)
@@ -105,6 +146,7 @@ cdef extern from "eii/config_manager/cfgmgr.h" nogil:
     cfgmgr_interface_t* cfgmgr_get_client_by_name(cfgmgr_ctx_t* cfgmgr, const char* name)
     cfgmgr_interface_t* cfgmgr_get_client_by_index(cfgmgr_ctx_t* cfgmgr, int index)
     cfgmgr_ctx_t* cfgmgr_initialize()
+    int cfgmgr_reload_env(cfgmgr_ctx_t* cfgmgr)
     void cfgmgr_destroy(cfgmgr_ctx_t *cfg_mgr)
     cfgmgr_interface_t* cfgmgr_interface_initialize()
     void cfgmgr_interface_destroy(cfgmgr_interface_t *cfg_mgr_interface)
@@ -116,9 +158,16 @@ cdef extern from "eii/config_manager/cfgmgr.h" nogil:
     # watch APIs
     void cfgmgr_watch(cfgmgr_ctx_t* cfgmgr, const char* key, cfgmgr_watch_callback_t watch_callback, void* user_data)
     void cfgmgr_watch_prefix(cfgmgr_ctx_t* cfgmgr, char* prefix, cfgmgr_watch_callback_t watch_callback, void* user_data)
+    int cfgmgr_watch_public_keys(cfgmgr_ctx_t* cfgmgr, cfgmgr_public_keys_callback_t callback, void* user_data)
+    int cfgmgr_watch_interface_changes(cfgmgr_ctx_t* cfgmgr, cfgmgr_changes_callback_t callback, void* user_data)
+    int cfgmgr_watch_config_changes(cfgmgr_ctx_t* cfgmgr, cfgmgr_changes_callback_t callback, void* user_data)
 
     # config_value_t APIs
     size_t config_value_array_len(const config_value_t* arr)
     config_value_t* config_value_array_get(const config_value_t* arr, int idx)
     void config_value_destroy(config_value_t* value)
     void config_destroy(config_t* config)
+
+cdef extern from "eii/config_manager/cfgmgr_binary.h" nogil:
+    # Binary msgbus config APIs
+    void* cfgmgr_get_msgbus_config_binary(cfgmgr_interface_t* ctx, size_t* size)
@@ -26,6 +26,7 @@ from .libeiiconfigmanager cimport *
 from libc.stdlib cimport malloc
 from libc.stdlib cimport free
 from .util cimport Util
+from .binary_config import BinaryConfig
 
 
 cdef class Server:
@@ -90,6 +91,22 @@ cdef class Server:
         except Exception as ex:
             raise ex
 
+    def get_msgbus_config_binary(self):
+        """Constructs message bus config for Server in the binary form,
+        read in place without JSON
+
+        :return: Binary messagebus config
+        :rtype: BinaryConfig
+        """
+        cdef void* buf
+        cdef size_t size = 0
+        buf = cfgmgr_get_msgbus_config_binary(self.cfgmgr_interface, &size)
+        if buf is NULL:
+            raise Exception("[Server] Getting binary msgbus config from base c layer failed")
+        data = (<char*> buf)[:size]
+        free(buf)
+        return BinaryConfig(data)
+
     def get_interface_value(self, key):
         """To get particular interface value from Server interface config
 
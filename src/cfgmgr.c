@@ -27,6 +27,20 @@
 #include <stdint.h>
 #include <cjson/cJSON.h>
 #include "eii/config_manager/cfgmgr.h"
+#include "eii/config_manager/cfgmgr_msgbus_builder.h"
+#include "eii/config_manager/cfgmgr_bundle.h"
+#include "eii/config_manager/cfgmgr_json.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_batch.h"
+
+// Parts of the context loaded by cfgmgr_initialize(), or with
+// CONFIGMGR_LAZY by the first call needing them
+#define CFGMGR_LOAD_CONNECTION  0x1
+#define CFGMGR_LOAD_INTERFACES  0x2
+#define CFGMGR_LOAD_CONFIG      0x4
+#define CFGMGR_LOAD_KEYS        0x8
+#define CFGMGR_LOAD_ALL         0xf
+
+static int cfgmgr_load(cfgmgr_ctx_t* cfgmgr, int parts);
 
 // function to generate kv_store_config from env
 config_t* create_kv_store_config() {
@@ -353,150 +367,108 @@ cfgmgr_interface_t* cfgmgr_interface_initialize() {
         LOG_ERROR_0("Malloc failed for cfgmgr_ctx_t");
         return NULL;
     }
+    cfgmgr_ctx->interface = NULL;
+    cfgmgr_ctx->model = NULL;
+    cfgmgr_ctx->iface_index = NULL;
     return cfgmgr_ctx;
 }
 
-cfgmgr_interface_t* cfgmgr_get_interface_by_name(cfgmgr_ctx_t* cfgmgr, const char* name, cfgmgr_iface_type_t type) {
-    LOG_DEBUG("In %s function", __func__);
-    char* interface_type = NULL;
-    if (type == CFGMGR_PUBLISHER) {
-        interface_type = PUBLISHERS;
-    } else if (type == CFGMGR_SUBSCRIBER) {
-        interface_type = SUBSCRIBERS;
-    } else if (type == CFGMGR_SERVER) {
-        interface_type = SERVERS;
-    } else if (type == CFGMGR_CLIENT) {
-        interface_type = CLIENTS;
-    } else {
-        LOG_ERROR_0("Interface type not supported");
-        return NULL;
+// Current interfaces document, which the watch on /<AppName>/interfaces
+// may replace at any time; valid until a newer one is returned
+static config_t* cfgmgr_current_interface(cfgmgr_ctx_t* cfgmgr) {
+    if (cfgmgr->iface_index != NULL) {
+        return cfgmgr_iface_index_app_interface(cfgmgr->iface_index);
     }
-    int result = 0;
+    return cfgmgr->app_interface;
+}
+
+// Interface of a model looked up while the index is pinned, which
+// references the model until cfgmgr_interface_destroy()
+static cfgmgr_interface_t* cfgmgr_interface_of_model(cfgmgr_ctx_t* cfgmgr,
+                                                     const cfgmgr_iface_model_t* model,
+                                                     cfgmgr_iface_type_t type) {
+    config_value_t* config = NULL;
     cfgmgr_interface_t* ctx = NULL;
-    config_value_t* config_name = NULL;
-    config_value_t* interface = NULL;
 
-    config_t* app_interface = cfgmgr->app_interface;
+    if (cfgmgr_iface_index_ref(cfgmgr->iface_index, model) != 0) {
+        return NULL;
+    }
+    config = config_value_new_object((void*) model->node, get_config_value, NULL);
+    if (config == NULL) {
+        LOG_ERROR_0("config initialization failed");
+        goto err;
+    }
     ctx = cfgmgr_interface_initialize();
     if (ctx == NULL) {
         LOG_ERROR_0("cfgmgr initialization failed");
         goto err;
     }
+    ctx->cfg_mgr = cfgmgr;
+    ctx->interface = config;
+    ctx->type = type;
+    ctx->model = model;
+    ctx->iface_index = cfgmgr->iface_index;
+    return ctx;
 
-    // Fetching list of Publisher interfaces
-    interface = app_interface->get_config_value(app_interface->cfg, interface_type);
-    if (interface == NULL) {
-        LOG_ERROR_0("interface initialization failed");
-        goto err;
+err:
+    if (config != NULL) {
+        config_value_destroy(config);
     }
+    cfgmgr_iface_index_unref(cfgmgr->iface_index, model);
+    return NULL;
+}
 
-    size_t arr_len = config_value_array_len(interface);
-    if (arr_len == 0) {
-        LOG_ERROR_0("Empty array is not supported, atleast one value should be given.");
-        goto err;
+cfgmgr_interface_t* cfgmgr_get_interface_by_name(cfgmgr_ctx_t* cfgmgr, const char* name, cfgmgr_iface_type_t type) {
+    LOG_DEBUG("In %s function", __func__);
+    if (type != CFGMGR_PUBLISHER && type != CFGMGR_SUBSCRIBER &&
+            type != CFGMGR_SERVER && type != CFGMGR_CLIENT) {
+        LOG_ERROR_0("Interface type not supported");
+        return NULL;
     }
-    // Iterating through available publisher configs
-    for (size_t i = 0; i < arr_len; i++) {
-        // Fetch name of individual publisher config
-        config_value_t* config = config_value_array_get(interface, i);
-        if (config == NULL) {
-            LOG_ERROR_0("config initialization failed");
-            goto err;
-        }
-        config_name = config_value_object_get(config, "Name");
-        if (config_name == NULL || config_name->body.string == NULL) {
-            LOG_ERROR_0("config_name initialization failed");
-            goto err;
-        }
-        // Verifying publisher config with name exists
-        strcmp_s(config_name->body.string, strlen(config_name->body.string), name, &result);
-        if(result == 0) {
-            ctx->cfg_mgr = cfgmgr;
-            ctx->interface = config;
-            ctx->type = type;
-            goto err;
-        } else if(i == config_value_array_len(interface)) {
-            LOG_ERROR("Publisher by name %s not found", name);
-            goto err;
-        } else {
-            if (config_name != NULL) {
-                config_value_destroy(config_name);
-            }
-            if (config != NULL) {
-                config_value_destroy(config);
-            }
-        }
+    if (name == NULL) {
+        LOG_ERROR_0("Interface name is NULL");
+        return NULL;
     }
-
-err:
-    if (interface != NULL) {
-        config_value_destroy(interface);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return NULL;
     }
-    if (config_name != NULL) {
-        config_value_destroy(config_name);
+
+    cfgmgr_interface_t* ctx = NULL;
+    cfgmgr_gen_guard_t guard = cfgmgr_iface_index_pin(cfgmgr->iface_index);
+    const cfgmgr_iface_model_t* model = cfgmgr_iface_index_find(cfgmgr->iface_index, type, name);
+    if (model == NULL) {
+        LOG_ERROR("Interface by name %s not found", name);
+    } else {
+        ctx = cfgmgr_interface_of_model(cfgmgr, model, type);
     }
+    cfgmgr_iface_index_unpin(cfgmgr->iface_index, &guard);
     return ctx;
 }
 
 cfgmgr_interface_t* cfgmgr_get_interface_by_index(cfgmgr_ctx_t* cfgmgr, int index, cfgmgr_iface_type_t type) {
     LOG_DEBUG("In %s function", __func__);
-    char* interface_type = NULL;
-    if (type == CFGMGR_PUBLISHER) {
-        interface_type = PUBLISHERS;
-    } else if (type == CFGMGR_SUBSCRIBER) {
-        interface_type = SUBSCRIBERS;
-    } else if (type == CFGMGR_SERVER) {
-        interface_type = SERVERS;
-    } else if (type == CFGMGR_CLIENT) {
-        interface_type = CLIENTS;
-    } else {
+    if (type != CFGMGR_PUBLISHER && type != CFGMGR_SUBSCRIBER &&
+            type != CFGMGR_SERVER && type != CFGMGR_CLIENT) {
         LOG_ERROR_0("Interface type not supported");
         return NULL;
     }
-    config_value_t* config = NULL;
-    config_value_t* interface = NULL;
-    config_t* app_interface = cfgmgr->app_interface;
-    cfgmgr_interface_t* ctx = NULL;
-    ctx = cfgmgr_interface_initialize();
-    if (ctx == NULL) {
-        LOG_ERROR_0("cfgmgr initialization failed");
-        goto err;
-    }
-
-    // Fetching list of Publisher interfaces
-    interface = app_interface->get_config_value(app_interface->cfg, interface_type);
-    if (interface == NULL) {
-        LOG_ERROR_0("interface initialization failed");
-        goto err;
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return NULL;
     }
+    cfgmgr_interface_t* ctx = NULL;
 
-    // Fetch publisher config associated with index
-    config = config_value_array_get(interface, index);
-    if (config == NULL) {
+    // Fetch interface model associated with index
+    cfgmgr_gen_guard_t guard = cfgmgr_iface_index_pin(cfgmgr->iface_index);
+    const cfgmgr_iface_model_t* model = cfgmgr_iface_index_at(cfgmgr->iface_index, type, index);
+    if (model == NULL) {
         LOG_ERROR_0("config initialization failed");
-        goto err;
-    }
-
-    ctx->cfg_mgr = cfgmgr;
-    ctx->interface = config;
-    ctx->type = type;
-
-    if (interface != NULL) {
-        config_value_destroy(interface);
+    } else {
+        ctx = cfgmgr_interface_of_model(cfgmgr, model, type);
     }
+    cfgmgr_iface_index_unpin(cfgmgr->iface_index, &guard);
     return ctx;
-
-err:
-    if (interface != NULL) {
-        config_value_destroy(interface);
-    }
-    if (config != NULL) {
-        config_value_destroy(config);
-    }
-    if (ctx != NULL) {
-        cfgmgr_interface_destroy(ctx);
-    }
-    return NULL;
 }
 
 cfgmgr_interface_t* cfgmgr_get_publisher_by_name(cfgmgr_ctx_t* cfgmgr, const char* name) {
@@ -581,18 +553,20 @@ cfgmgr_interface_t* cfgmgr_get_client_by_index(cfgmgr_ctx_t* cfgmgr, int index)
 
 config_value_t* cfgmgr_get_endpoint(cfgmgr_interface_t* ctx) {
     LOG_DEBUG("In %s function", __func__);
-    config_value_t* config = ctx->interface;
-    if (config == NULL) {
+    const cfgmgr_iface_model_t* model = ctx->model;
+    if (model == NULL) {
         LOG_ERROR_0("config initialization failed");
         return NULL;
     }
-    // Fetching EndPoint from config
-    config_value_t* end_point = config_value_object_get(config, "EndPoint");
-    if (end_point == NULL) {
+    // EndPoint is either an ipc socket object or a string
+    if (model->endpoint_object != NULL) {
+        return config_value_new_object((void*) model->endpoint_object, get_config_value, NULL);
+    }
+    if (model->endpoint == NULL) {
         LOG_ERROR_0("end_point initialization failed");
         return NULL;
     }
-    return end_point;
+    return config_value_new_string(model->endpoint);
 }
 
 config_value_t* cfgmgr_get_topics(cfgmgr_interface_t* ctx) {
@@ -601,130 +575,88 @@ config_value_t* cfgmgr_get_topics(cfgmgr_interface_t* ctx) {
         LOG_ERROR_0("cfgmgr_get_topics not applicable for CFGMGR_SERVER/CFGMGR_CLIENT");
         return NULL;
     }
-    // Setting default to 1 since strcmp_s
-    // changes it to 0
-    int ret = 1;
-    config_t* topics_cvt = NULL;
-    // Fetching interface
-    config_value_t* config = ctx->interface;
-    if (config == NULL) {
+    const cfgmgr_iface_model_t* model = ctx->model;
+    if (model == NULL) {
         LOG_ERROR_0("config initialization failed");
         return NULL;
     }
-    // Fetching topics from interface
-    config_value_t* topics = config_value_object_get(ctx->interface, "Topics");
-    if (topics == NULL) {
-        LOG_ERROR_0("topics initialization failed");
+    if (model->invalid & CFGMGR_IFACE_BAD_TOPICS) {
+        LOG_ERROR_0("Topics type mismatch, it should be array");
         return NULL;
     }
-    if (topics->type != CVT_ARRAY) {
-        LOG_ERROR_0("Topics type mismatch, it should be array");
+    const cfgmgr_iface_strings_t* topics = cfgmgr_iface_model_topics(model);
+    if (topics == NULL) {
+        LOG_ERROR_0("topics initialization failed");
         return NULL;
     }
-
-    size_t arrlen = config_value_array_len(topics);
-    if (arrlen == 0) {
+    if (topics->count == 0) {
         LOG_ERROR_0("Empty String is not supported in Topics. Atleast one topic is required");
         return NULL;
     }
-    config_value_t* topic_value = NULL;
-    topic_value = config_value_array_get(topics, 0);
-    if (topic_value == NULL) {
-        LOG_ERROR_0("Extracting first topic from topics array failed ");
+    // A single * topic is compiled to the [""] array which allows all
+    // clients to subscribe
+    config_value_t* topics_cvt = config_value_new_array(
+            (void*) topics->array, topics->count, get_array_item, NULL);
+    if (topics_cvt == NULL) {
+        LOG_ERROR_0("config value new array for topic failed");
         return NULL;
     }
-    // If only one item in Topics and it is *,
-    // then add empty string in order to allow all clients to subscribe
-    strcmp_s(topic_value->body.string, strlen(topic_value->body.string), "*", &ret);
-    if ((arrlen == 1) && (ret == 0 )) {
-        // Creating empty config array for * single topic
-        config_t* topics_cvt = json_config_new_from_buffer("[\"\"]");
-        if (topics_cvt == NULL) {
-            LOG_ERROR_0("Failed to create topics_cvt config_value_t object");
-            return NULL;
-        }
-        topics = config_value_new_array(
-                (void*) topics_cvt->cfg , arrlen, get_array_item, NULL);
-        if (topics == NULL) {
-            LOG_ERROR_0("config value new array for topic failed");
-            return NULL;
-        }
-        return topics;
-    }
-    if (topic_value != NULL) {
-        config_value_destroy(topic_value);
-    }
-    return topics;
+    return topics_cvt;
 }
 
+static int cfgmgr_publish_interfaces(cfgmgr_ctx_t* cfgmgr);
+
 bool cfgmgr_set_topics(cfgmgr_interface_t* ctx, char const* const* topics_list, int len) {
     LOG_DEBUG("In %s function", __func__);
     if (ctx->type == CFGMGR_SERVER || ctx->type == CFGMGR_CLIENT) {
         LOG_ERROR_0("cfgmgr_set_topics not applicable for CFGMGR_SERVER/CFGMGR_CLIENT");
         return NULL;
     }
-    char* type = NULL;
-    if (ctx->type == CFGMGR_PUBLISHER) {
-        type = PUBLISHERS;
-    } else if (ctx->type == CFGMGR_SUBSCRIBER) {
-        type = SUBSCRIBERS;
-    }
+    cfgmgr_ctx_t* cfg_mgr = ctx->cfg_mgr;
     config_t* config_arr = NULL;
-    config_value_t* config_arr_cvt = NULL;
-    config_t* config_input = NULL;
+    config_value_t* interface = NULL;
+    const cfgmgr_iface_model_t* model = NULL;
 
-    bool ret_val = true;
+    bool ret_val = false;
     // Creating config array from char**
     config_arr = json_config_new_array(topics_list, len);
     if (config_arr == NULL) {
         LOG_ERROR_0("Failed to create config_arr config_t object");
         goto err;
     }
-    // Creating config_value_t object from config array
-    config_arr_cvt = config_value_new_array(
-                (void*) config_arr->cfg , len, get_array_item, NULL);
-    if (config_arr_cvt == NULL) {
-        LOG_ERROR_0("Failed to create config_arr_cvt config_value_t object");
-        goto err;
-    }
-    // Creating config_t object to set new topics value
-    config_input = config_new(
-            (void*) ctx->interface->body.object->object, free_json, get_config_value, set_config_value);
-    if (config_input == NULL) {
-        LOG_ERROR_0("Failed to create config_input config_t object");
+    // Published interfaces are shared with other readers, so the new topics
+    // go into a new generation of the index instead of the live document
+    model = cfgmgr_iface_index_set_topics(ctx->iface_index, ctx->model, config_arr->cfg);
+    if (model == NULL) {
+        LOG_ERROR_0("Failed to update topics of the interface model");
         goto err;
     }
-    // Setting new topics
-    ret_val = config_set(config_input, TOPICS, config_arr_cvt);
-    if (!ret_val) {
-        LOG_ERROR_0("Unable to set config value");
+    interface = config_value_new_object((void*) model->node, get_config_value, NULL);
+    if (interface == NULL) {
+        LOG_ERROR_0("Failed to create interface config_value_t object");
         goto err;
     }
-    if (config_arr_cvt != NULL) {
-        config_value_destroy(config_arr_cvt);
-    }
-    // Freeing this instead of destroying since we do
-    // not want to free the inner config_input->cfg
-    if (config_input != NULL) {
-        free(config_input);
+    config_value_destroy(ctx->interface);
+    ctx->interface = interface;
+    cfgmgr_iface_index_unref(ctx->iface_index, ctx->model);
+    ctx->model = model;
+    model = NULL;
+    // msgbus configs built with the old topics are stale now
+    if (cfg_mgr->msgbus_cache != NULL) {
+        cfgmgr_msgbus_cache_invalidate(cfg_mgr->msgbus_cache);
     }
-    // Freeing this instead of destroying since we do
-    // not want to free the inner config_arr->cfg
-    if (config_arr != NULL) {
-        free(config_arr);
+    if (cfgmgr_publish_interfaces(cfg_mgr) != 0) {
+        LOG_ERROR_0("Failed to publish snapshot of the new topics");
     }
+    ret_val = true;
 
-    return ret_val;
 err:
+    if (model != NULL) {
+        cfgmgr_iface_index_unref(ctx->iface_index, model);
+    }
     if (config_arr != NULL) {
         config_destroy(config_arr);
     }
-    if (config_input != NULL) {
-        config_destroy(config_input);
-    }
-    if (config_arr_cvt != NULL) {
-        config_value_destroy(config_arr_cvt);
-    }
     return ret_val;
 }
 
@@ -734,2008 +666,1334 @@ config_value_t* cfgmgr_get_allowed_clients(cfgmgr_interface_t* ctx) {
         LOG_ERROR_0("cfgmgr_get_allowed_clients not applicable for CFGMGR_SUBSCRIBER/CFGMGR_CLIENT");
         return NULL;
     }
-    config_value_t* config = ctx->interface;
-    if (config == NULL) {
+    const cfgmgr_iface_model_t* model = ctx->model;
+    if (model == NULL) {
         LOG_ERROR_0("config initialization failed");
         return NULL;
     }
-    config_value_t* clients = config_value_object_get(config, "AllowedClients");
-    if (clients == NULL) {
-        LOG_ERROR_0("topics initialization failed");
+    if (model->invalid & CFGMGR_IFACE_BAD_ALLOWED_CLIENTS) {
+        LOG_ERROR_0("Allowed Clients type mismatch, it should be array");
         return NULL;
     }
-    if (clients->type != CVT_ARRAY) {
-        LOG_ERROR_0("Allowed Clients type mismatch, it should be array");
+    const cfgmgr_iface_strings_t* clients = model->allowed_clients;
+    if (clients == NULL) {
+        LOG_ERROR_0("topics initialization failed");
         return NULL;
     }
-    return clients;
+    return config_value_new_array((void*) clients->array, clients->count, get_array_item, NULL);
 }
 
-config_t* cfgmgr_get_msgbus_config_pub(cfgmgr_interface_t* ctx) {
-    LOG_DEBUG("In %s function", __func__);
-    config_t* m_config = NULL;
-    config_value_t* broker_app_name = NULL;
-    char** host_port = NULL;
-    char* host = NULL;
-    char* port = NULL;
-    // Initializing base_cfg variables
-    config_value_t* pub_config = ctx->interface;
-    char* app_name = ctx->cfg_mgr->app_name;
-    int dev_mode = ctx->cfg_mgr->dev_mode;
-    kv_store_client_t* kv_store_client = ctx->cfg_mgr->kv_store_client;
-    void* kv_store_handle = ctx->cfg_mgr->kv_store_handle;
-    config_value_t* publish_config_type = NULL;
-    config_value_t* publish_config_endpoint = NULL;
-    config_value_t* publish_config_name = NULL;
-    config_value_t* cvt_type = NULL;
-    config_value_t* zmq_recv_hwm_value = NULL;
-    config_value_t* brokered_value = NULL;
-    config_t* zmq_tcp_publish_cvt = NULL;
-    config_value_t* zmq_tcp_host = NULL;
-    config_value_t* zmq_tcp_port = NULL;
-    config_value_t* zmq_tcp_publish = NULL;
-    char* config_value_cr = NULL;
-    bool config_set_result = false;
-    config_value_t* type_value = NULL;
-    config_value_t* zmq_tcp_publish_data = NULL;
-    config_value_t* zmq_tcp_publish_port = NULL;
-    config_value_t* zmq_tcp_publish_host = NULL;
-    config_value_t* zmq_tcp_publish_brokered = NULL;
-    // Creating final config object
-    m_config = json_config_new_from_buffer("{}");
-    if (m_config == NULL) {
-        LOG_ERROR_0("Error creating m_config object");
-        goto err;
-    }
-
-    // Fetching Type from config
-    publish_config_type = config_value_object_get(pub_config, TYPE);
-    if (publish_config_type == NULL) {
-        LOG_ERROR_0("publish_config_type initialization failed");
-        goto err;
-    }
-
-    if (publish_config_type->type != CVT_STRING || publish_config_type->body.string == NULL) {
-        LOG_ERROR_0("publish_config_type type mismatch or the string value is NULL");
-        goto err;
-    }
-
-    char* type = publish_config_type->body.string;
+// Builds the msgbus config of an interface, reading keys through the
+// given kv_store client
+static config_t* cfgmgr_build_msgbus_config(cfgmgr_interface_t* ctx,
+        kv_store_client_t* kv_store_client, void* kv_store_handle) {
+    cfgmgr_trace_span_t span = cfgmgr_trace_begin("cfgmgr.build_msgbus_config");
+    config_t* config = cfgmgr_msgbus_build(ctx, kv_store_client, kv_store_handle);
+    cfgmgr_trace_end(&span, (ctx->model != NULL) ? ctx->model->name : NULL);
+    return config;
+}
 
-    // Fetching EndPoint from config
-    publish_config_endpoint = config_value_object_get(pub_config, ENDPOINT);
-    if (publish_config_endpoint == NULL) {
-        LOG_ERROR_0("publish_config_endpoint initialization failed");
-        goto err;
+// Interface node the msgbus config of an interface is cached under
+static const void* cfgmgr_msgbus_cache_key(cfgmgr_interface_t* ctx) {
+    if (ctx->cfg_mgr->msgbus_cache == NULL || ctx->interface == NULL ||
+            ctx->interface->type != CVT_OBJECT) {
+        return NULL;
     }
+    return ctx->interface->body.object->object;
+}
 
-    char* end_point = NULL;
-    if (publish_config_endpoint->type == CVT_OBJECT) {
-        end_point = cvt_to_char(publish_config_endpoint);
-    } else if(publish_config_endpoint->type == CVT_STRING && publish_config_endpoint->body.string != NULL) {
-        end_point = publish_config_endpoint->body.string;
+config_t* cfgmgr_get_msgbus_config(cfgmgr_interface_t* ctx) {
+    LOG_DEBUG("In %s function", __func__);
+    config_t* config;
+    cfgmgr_msgbus_cache_t* cache = ctx->cfg_mgr->msgbus_cache;
+    const void* iface = cfgmgr_msgbus_cache_key(ctx);
+    uint64_t epoch = 0;
+    cfgmgr_trace_span_t span = cfgmgr_trace_begin("cfgmgr_get_msgbus_config");
+    const char* name = (ctx->model != NULL) ? ctx->model->name : NULL;
+    if (cfgmgr_load(ctx->cfg_mgr, CFGMGR_LOAD_KEYS) != 0) {
+        LOG_ERROR_0("Failed to connect to the kv_store");
+        cfgmgr_trace_end(&span, name);
+        return NULL;
     }
-
-    if (end_point == NULL) {
-        LOG_ERROR_0("Failed to get endpoint, its NULL");
-        goto err;
+    if (iface != NULL) {
+        config = cfgmgr_msgbus_cache_get(cache, iface, &epoch);
+        if (config != NULL) {
+            LOG_DEBUG_0("msgbus config served from cache");
+            cfgmgr_trace_end(&span, name);
+            return config;
+        }
     }
 
-    // Fetching Name from config
-    publish_config_name = config_value_object_get(pub_config, NAME);
-    if (publish_config_name == NULL) {
-        LOG_ERROR_0("publish_config_name initialization failed");
-        goto err;
+    config = cfgmgr_build_msgbus_config(ctx, ctx->cfg_mgr->kv_store_client,
+                                        ctx->cfg_mgr->kv_store_handle);
+    if (iface != NULL && config != NULL) {
+        cfgmgr_msgbus_cache_put(cache, iface, epoch, config);
     }
+    cfgmgr_trace_end(&span, name);
+    return config;
+}
 
-    if(publish_config_name->type != CVT_STRING || publish_config_name->body.string == NULL){
-        LOG_ERROR_0("publish_config_name type mismatch or the string value is NULL");
-        goto err;
+// Queues a key of the kv_store, PUBLIC_KEYS or "/" followed by the name
+// and the suffix
+static int cfgmgr_batch_add_key(kv_store_client_t* batch, const char* base,
+                                const char* name, const char* suffix) {
+    size_t init_len = strlen(base) + strlen(name) + strlen(suffix) + 1;
+    char* key = concat_s(init_len, 3, base, name, suffix);
+    if (key == NULL) {
+        LOG_ERROR_0("Concatenation failed for the batch key");
+        return -1;
     }
+    int ret = kv_store_batch_add(batch, key, false);
+    free(key);
+    return ret;
+}
 
-    // Overriding endpoint with PUBLISHER_<Name>_ENDPOINT if set
-    size_t init_len = strlen("PUBLISHER_") + strlen(publish_config_name->body.string) + strlen("_ENDPOINT") + 2;
-    char* ep_override_env = concat_s(init_len, 3, "PUBLISHER_", publish_config_name->body.string, "_ENDPOINT");
-    if (ep_override_env == NULL) {
-        LOG_ERROR_0("concatenation for ep_override_env failed");
-        goto err;
+// Queues the keys the msgbus config builders read for an interface: the
+// own keys of the application and the public keys of its peers, or every
+// public key when AllowedClients is "*"
+static int cfgmgr_batch_add_keys(kv_store_client_t* batch, const char* app_name,
+                                 const cfgmgr_iface_model_t* model) {
+    // Only zmq_tcp interfaces are secured with keys
+    if (model->transport != CFGMGR_TRANSPORT_ZMQ_TCP) {
+        return 0;
+    }
+    if (cfgmgr_batch_add_key(batch, PUBLIC_KEYS, app_name, "") != 0 ||
+            cfgmgr_batch_add_key(batch, "/", app_name, PRIVATE_KEY) != 0) {
+        return -1;
     }
-    char publisher_ep[MAX_ENDPOINT_LENGTH] = "";
-    char* ep_override = getenv(ep_override_env);
-    if (ep_override != NULL) {
-
-        int ret = strncpy_s(publisher_ep, MAX_ENDPOINT_LENGTH + 1,
-                        ep_override, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR("failed to copy PUBLISHER_%s_ENDPOINT env value", publish_config_name->body.string);
-            goto err;
-        }
-
-        if (strlen(publisher_ep) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", ep_override_env);
-            end_point = publisher_ep;
+    const char* peers[] = {
+        model->broker_appname, model->publisher_appname, model->server_appname,
+    };
+    for (size_t i = 0; i < sizeof(peers) / sizeof(peers[0]); i++) {
+        if (peers[i] != NULL && cfgmgr_batch_add_key(batch, PUBLIC_KEYS, peers[i], "") != 0) {
+            return -1;
         }
-    } else {
-        LOG_DEBUG("env not set for overridding %s, and hence endpoint taking from interface ", ep_override_env);
     }
-    free(ep_override_env);
-
-    // Overriding endpoint with PUBLISHER_ENDPOINT if set
-    // Note: This overrides all the publisher endpoints if set
-    char* pub_ep_env  = getenv("PUBLISHER_ENDPOINT");
-    if (pub_ep_env != NULL) {
-
-        int ret = strncpy_s(publisher_ep, MAX_ENDPOINT_LENGTH + 1,
-                        pub_ep_env, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR_0("failed to copy PUBLISHER_ENDPOINT env value");
-            goto err;
-        }
-
-        LOG_DEBUG_0("Overriding endpoint with PUBLISHER_ENDPOINT");
-        if (strlen(publisher_ep) != 0) {
-            end_point = publisher_ep;
-        }
-    } else {
-        LOG_DEBUG_0("env not set for overridding PUBLISHER_ENDPOINT, and hence endpoint taking from interface ");
+    const cfgmgr_iface_strings_t* clients = model->allowed_clients;
+    if (clients == NULL) {
+        return 0;
     }
-
-    // Overriding endpoint with PUBLISHER_<Name>_TYPE if set
-    init_len = strlen("PUBLISHER_") + strlen(publish_config_name->body.string) + strlen("_TYPE") + 2;
-    char* type_override_env = concat_s(init_len, 3, "PUBLISHER_", publish_config_name->body.string, "_TYPE");
-    if (type_override_env == NULL) {
-        LOG_ERROR_0("concatenation for type_override_env failed");
-        goto err;
+    if (clients->wildcard) {
+        return kv_store_batch_add(batch, PUBLIC_KEYS, true);
     }
-    char* type_override = getenv(type_override_env);
-    if (type_override != NULL) {
-        if (strlen(type_override) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", type_override_env);
-            type = type_override;
+    for (size_t i = 0; i < clients->count; i++) {
+        if (cfgmgr_batch_add_key(batch, PUBLIC_KEYS, clients->items[i], "") != 0) {
+            return -1;
         }
-    } else {
-        LOG_DEBUG("env not set for overridding %s, and hence type taking from interface ", type_override_env);
     }
-    free(type_override_env);
+    return 0;
+}
 
-    // Overriding endpoint with PUBLISHER_TYPE if set
-    // Note: This overrides all the publisher type if set
-    char* publisher_type = getenv("PUBLISHER_TYPE");
-    if (publisher_type != NULL) {
-        LOG_DEBUG_0("Overriding endpoint with PUBLISHER_TYPE");
-        if (strlen(publisher_type) != 0) {
-            type = publisher_type;
+cfgmgr_msgbus_configs_t* cfgmgr_get_all_msgbus_configs(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    static const cfgmgr_iface_type_t types[] = {
+        CFGMGR_PUBLISHER, CFGMGR_SUBSCRIBER, CFGMGR_SERVER, CFGMGR_CLIENT,
+    };
+    cfgmgr_msgbus_configs_t* configs = NULL;
+    cfgmgr_interface_t** ifaces = NULL;
+    uint64_t* epochs = NULL;
+    kv_store_client_t* kv_store_client = cfgmgr->kv_store_client;
+    void* kv_store_handle = NULL;
+    kv_store_client_t* batch = NULL;
+    size_t misses = 0;
+    size_t total = 0;
+    bool ret_val = false;
+
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES | CFGMGR_LOAD_KEYS) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return NULL;
+    }
+    kv_store_handle = cfgmgr->kv_store_handle;
+    cfgmgr_trace_span_t span = cfgmgr_trace_begin("cfgmgr_get_all_msgbus_configs");
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        int count = cfgmgr_iface_index_count(cfgmgr->iface_index, types[t]);
+        if (count > 0) {
+            total += (size_t) count;
         }
-    } else {
-        LOG_DEBUG("env not set for overridding PUBLISHER_TYPE, and hence type taking from interface ");
     }
 
-    // Creating type config_value_t to set in final config
-    cvt_type = config_value_new_string(type);
-    if (cvt_type == NULL) {
-        LOG_ERROR_0("Error creating config_value_t object");
+    configs = (cfgmgr_msgbus_configs_t*) calloc(1, sizeof(cfgmgr_msgbus_configs_t));
+    if (configs == NULL) {
+        LOG_ERROR_0("Failed to allocate msgbus configs");
         goto err;
     }
-    config_set_result = config_set(m_config, "type", cvt_type);
-    if (!config_set_result) {
-        LOG_ERROR("Unable to set config value");
+    configs->entries = (cfgmgr_msgbus_config_entry_t*) calloc(total + 1, sizeof(cfgmgr_msgbus_config_entry_t));
+    ifaces = (cfgmgr_interface_t**) calloc(total + 1, sizeof(cfgmgr_interface_t*));
+    epochs = (uint64_t*) calloc(total + 1, sizeof(uint64_t));
+    if (configs->entries == NULL || ifaces == NULL || epochs == NULL) {
+        LOG_ERROR_0("Failed to allocate msgbus configs");
         goto err;
     }
 
-    // Adding zmq_recv_hwm value if available
-    zmq_recv_hwm_value = config_value_object_get(pub_config, ZMQ_RECV_HWM);
-    if (zmq_recv_hwm_value != NULL) {
-        if (zmq_recv_hwm_value->type != CVT_INTEGER) {
-            LOG_ERROR_0("zmq_recv_hwm type is not integer");
-            goto err;
-        }
-        config_set_result = config_set(m_config, ZMQ_RECV_HWM, zmq_recv_hwm_value);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
-        }
-    }
-
-    // Adding brokered value if available
-    brokered_value = config_value_object_get(pub_config, BROKERED);
-    if (brokered_value != NULL) {
-        if (brokered_value->type != CVT_BOOLEAN) {
-            LOG_ERROR_0("brokered_value type is not boolean");
-            goto err;
-        }
-    }
-
-    if (!strcmp(type, "zmq_ipc")) {
-        bool ret = get_ipc_config(m_config, pub_config, end_point, CFGMGR_PUBLISHER);
-        if (ret == false){
-            LOG_ERROR_0("IPC configuration for publisher failed");
-            goto err;
-        }
-    } else if (!strcmp(type, "zmq_tcp")) {
-        // Add host & port to zmq_tcp_publish object
-        host_port = get_host_port(end_point);
-        if (host_port == NULL) {
-            LOG_ERROR_0("Get host and port failed");
-            goto err;
-        }
-        host = host_port[0];
-        trim(host);
-        port = host_port[1];
-        trim(port);
-        int64_t i_port = atoi(port);
-        // Creating empty config object
-        zmq_tcp_publish_cvt = json_config_new_from_buffer("{}");
-        if (zmq_tcp_publish_cvt == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_publish_cvt failed");
-            goto err;
-        }
-        zmq_tcp_host = config_value_new_string(host);
-        if (zmq_tcp_host == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_host failed");
-            goto err;
-        }
-        zmq_tcp_port = config_value_new_integer(i_port);
-        if (zmq_tcp_port == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_port failed");
-            goto err;
-        }
-        config_set_result = config_set(zmq_tcp_publish_cvt, "host", zmq_tcp_host);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
-        }
-        config_set_result = config_set(zmq_tcp_publish_cvt, "port", zmq_tcp_port);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
-        }
-        if (brokered_value != NULL) {
-            config_set_result = config_set(zmq_tcp_publish_cvt, BROKERED, brokered_value);
-            if (!config_set_result) {
-                LOG_ERROR("Unable to set config value");
-                goto err;
+    // Serve what the cache holds, the keys are only read for the rest
+    size_t n = 0;
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        int count = cfgmgr_iface_index_count(cfgmgr->iface_index, types[t]);
+        for (int i = 0; i < count && n < total; i++, n++) {
+            cfgmgr_msgbus_config_entry_t* entry = &configs->entries[n];
+            entry->type = types[t];
+            ifaces[n] = cfgmgr_get_interface_by_index(cfgmgr, i, types[t]);
+            if (ifaces[n] == NULL) {
+                LOG_ERROR("Interface %d of type %d not found", i, types[t]);
+                continue;
             }
-        }
-        if (dev_mode != 0) {
-            LOG_DEBUG_0("Running in Prod Mode...");
-            bool ret_val;
-
-            // Checking if Publisher is using Broker to publish or not and constructing
-            // the publisher messagebus config based on the check.
-            broker_app_name = config_value_object_get(pub_config, BROKER_APPNAME);
-            if(broker_app_name != NULL){
-
-                if(broker_app_name->type != CVT_STRING){
-                    LOG_ERROR_0("[Type Missmatch]: BrokerAppName should be of type String");
-                    goto err;
-                }
-                // If a publisher is using broker to communicate with its respective subscriber
-                // then publisher will act as a subscriber to X-SUB, hence publishers
-                // message bus config looks like a subscriber one.
-                ret_val = add_keys_to_config(zmq_tcp_publish_cvt, app_name, kv_store_client, kv_store_handle, broker_app_name, pub_config);
-                if(!ret_val) {
-                    LOG_ERROR_0("Failed to add respective cert keys");
-                    goto err;
-                }
-            } else{
-                ret_val = construct_tcp_publisher_prod(app_name, m_config, zmq_tcp_publish_cvt, kv_store_handle, pub_config, kv_store_client);
-                if(!ret_val) {
-                    LOG_ERROR_0("Failed to construct tcp config struct");
+            if (ifaces[n]->model->name != NULL) {
+                entry->name = strdup(ifaces[n]->model->name);
+                if (entry->name == NULL) {
+                    LOG_ERROR_0("Failed to copy interface name");
                     goto err;
                 }
             }
-        } else {
-            LOG_DEBUG_0("Running in Dev Mode...");
-        }
-        zmq_tcp_publish = config_value_new_object(zmq_tcp_publish_cvt->cfg, get_config_value, NULL);
-        config_set_result = config_set(m_config, "zmq_tcp_publish", zmq_tcp_publish);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
+            const void* iface = cfgmgr_msgbus_cache_key(ifaces[n]);
+            if (iface != NULL) {
+                entry->config = cfgmgr_msgbus_cache_get(cfgmgr->msgbus_cache, iface, &epochs[n]);
+            }
+            if (entry->config == NULL) {
+                misses++;
+            }
         }
-    } else {
-        LOG_ERROR_0("Type should be either \"zmq_ipc\" or \"zmq_tcp\"");
-        goto err;
     }
+    configs->count = n;
 
-    // Extracting and printing non-secret data from the config
-    type_value = m_config->get_config_value(m_config->cfg, "type");
-    if (type_value == NULL) {
-        LOG_ERROR_0("\"type\" key is missing in the config");
-        m_config = NULL;
-        goto err;
-    } else if (type_value->type != CVT_STRING) {
-        LOG_ERROR_0("\"type\" value has to be of string type");
-        m_config = NULL;
-        goto err;
-    }
-    if (!strcmp(type_value->body.string, "zmq_ipc")) {
-        config_value_cr = configt_to_char(m_config);
-        if (config_value_cr == NULL) {
-            LOG_ERROR_0("config_value_cr initialization failed");
-            m_config = NULL;
+    // Keys are only read in prod mode
+    if (misses > 0 && cfgmgr->dev_mode != 0) {
+        batch = kv_store_batch_new(cfgmgr->kv_store_client, cfgmgr->kv_store_handle);
+        if (batch == NULL) {
+            LOG_ERROR_0("Failed to create kv_store batch");
             goto err;
         }
-        LOG_DEBUG("Env publisher Config is : %s \n", config_value_cr);
-    } else {
-        uint8_t flag = 0;
-        char* brokered = "false";
-        zmq_tcp_publish_data = m_config->get_config_value(m_config->cfg,
-                                                          "zmq_tcp_publish");
-        if (zmq_tcp_publish_data == NULL) {
-            LOG_ERROR_0("\"zmq_tcp_publish\" key is missing in the config");
-            m_config = NULL;
-            goto err;
-        } else {
-            zmq_tcp_publish_host = config_value_object_get(zmq_tcp_publish_data,
-                                                                        "host");
-            if ( zmq_tcp_publish_host == NULL ) {
-                LOG_ERROR_0("zmq_tcp_publish \"host\" key missing");
-                m_config = NULL;
-                goto err;
-            }
-            if (zmq_tcp_publish_host->type != CVT_STRING) {
-                LOG_ERROR_0("zmq_tcp_publish \"host\" value has to be of string type");
-                m_config = NULL;
-                goto err;
-            }
-            zmq_tcp_publish_port = config_value_object_get(zmq_tcp_publish_data,
-                                                                        "port");
-            if ( zmq_tcp_publish_port == NULL ) {
-                LOG_ERROR_0("zmq_tcp_publish \"port\" key missing");
-                m_config = NULL;
-                goto err;
-            }
-            if (zmq_tcp_publish_port->type != CVT_INTEGER) {
-                LOG_ERROR_0("zmq_tcp_publish \"port\" value has to be of integer type");
-                m_config = NULL;
+        for (size_t i = 0; i < n; i++) {
+            if (ifaces[i] != NULL && configs->entries[i].config == NULL &&
+                    cfgmgr_batch_add_keys(batch, cfgmgr->app_name, ifaces[i]->model) != 0) {
+                LOG_ERROR_0("Failed to queue interface keys");
                 goto err;
             }
         }
-        if (brokered_value != NULL) {
-            zmq_tcp_publish_brokered = config_value_object_get(zmq_tcp_publish_data,
-                                                                        "brokered");
-            if ( zmq_tcp_publish_brokered == NULL ) {
-                LOG_ERROR_0("zmq_tcp_publish \"brokered\" key missing");
-                m_config = NULL;
-                goto err;
-            }
+        cfgmgr_trace_span_t fetch_span = cfgmgr_trace_begin("cfgmgr.batch_fetch_keys");
+        int fetched = kv_store_batch_fetch(batch);
+        cfgmgr_trace_end(&fetch_span, NULL);
+        if (fetched != 0) {
+            LOG_WARN_0("Keys could not be read in one batch, reading them one by one");
+        }
+        kv_store_client = batch;
+        kv_store_handle = batch->init(batch);
+    }
 
-            if (zmq_tcp_publish_brokered->type != CVT_BOOLEAN) {
-                LOG_ERROR_0("zmq_tcp_publish \"brokered\" value has to be of boolean type");
-                m_config = NULL;
-                goto err;
-            }
-            flag = zmq_tcp_publish_brokered->body.boolean;
-            if (flag) {
-                brokered = "true";
-            }
+    for (size_t i = 0; i < n; i++) {
+        cfgmgr_msgbus_config_entry_t* entry = &configs->entries[i];
+        if (ifaces[i] == NULL || entry->config != NULL) {
+            continue;
+        }
+        entry->config = cfgmgr_build_msgbus_config(ifaces[i], kv_store_client, kv_store_handle);
+        if (entry->config == NULL) {
+            LOG_ERROR("Failed to build msgbus config of interface %s",
+                      (entry->name != NULL) ? entry->name : "(unnamed)");
+            continue;
+        }
+        const void* iface = cfgmgr_msgbus_cache_key(ifaces[i]);
+        if (iface != NULL) {
+            cfgmgr_msgbus_cache_put(cfgmgr->msgbus_cache, iface, epochs[i], entry->config);
         }
-        LOG_DEBUG("\nEnv publisher Config is : \n Type : %s \n Host : %s \n Port : %d \n brokered : %s\n", \
-                   type_value->body.string, \
-                   zmq_tcp_publish_host->body.string, \
-                   zmq_tcp_publish_port->body.integer, \
-                   brokered);
     }
 
+    // We should add all success-path code above this line.
+    ret_val = true;
+
 err:
-    if (type_value != NULL) {
-        config_value_destroy(type_value);
-    }
-    if (zmq_tcp_publish_data != NULL) {
-        config_value_destroy(zmq_tcp_publish_data);
+    if (!ret_val) {
+        cfgmgr_msgbus_configs_destroy(configs);
+        configs = NULL;
     }
-    if (zmq_tcp_publish_port != NULL) {
-        config_value_destroy(zmq_tcp_publish_port);
+    if (batch != NULL) {
+        kv_client_free(batch);
     }
-    if (zmq_tcp_publish_host != NULL) {
-        config_value_destroy(zmq_tcp_publish_host);
+    if (ifaces != NULL) {
+        for (size_t i = 0; i < total; i++) {
+            if (ifaces[i] != NULL) {
+                cfgmgr_interface_destroy(ifaces[i]);
+            }
+        }
+        free(ifaces);
     }
-    if (zmq_tcp_publish_brokered != NULL) {
-        config_value_destroy(zmq_tcp_publish_brokered);
+    free(epochs);
+    cfgmgr_trace_end(&span, NULL);
+    return configs;
+}
+
+void cfgmgr_msgbus_configs_destroy(cfgmgr_msgbus_configs_t* configs) {
+    if (configs == NULL) {
+        return;
     }
-    if (config_value_cr != NULL) {
-        free(config_value_cr);
-    }
-    if (zmq_tcp_publish != NULL) {
-        config_value_destroy(zmq_tcp_publish);
-    }
-    if (publish_config_type != NULL) {
-        config_value_destroy(publish_config_type);
-    }
-    if (publish_config_name != NULL) {
-        config_value_destroy(publish_config_name);
-    }
-    if (publish_config_endpoint != NULL) {
-        config_value_destroy(publish_config_endpoint);
-    }
-    if (broker_app_name != NULL) {
-        config_value_destroy(broker_app_name);
-    }
-    if (cvt_type != NULL) {
-        config_value_destroy(cvt_type);
-    }
-    if (host_port != NULL) {
-        free_mem(host_port);
-    }
-    // Freeing this instead of destroying since we don't
-    // want to free the inner zmq_tcp_publish_cvt->cfg
-    if (zmq_tcp_publish_cvt != NULL) {
-        free(zmq_tcp_publish_cvt);
-    }
-    if (zmq_recv_hwm_value != NULL) {
-        config_value_destroy(zmq_recv_hwm_value);
-    }
-    if (brokered_value != NULL) {
-        config_value_destroy(brokered_value);
-    }
-    if (zmq_tcp_host != NULL) {
-        config_value_destroy(zmq_tcp_host);
-    }
-    if (zmq_tcp_port != NULL) {
-        config_value_destroy(zmq_tcp_port);
+    if (configs->entries != NULL) {
+        for (size_t i = 0; i < configs->count; i++) {
+            free(configs->entries[i].name);
+            if (configs->entries[i].config != NULL) {
+                config_destroy(configs->entries[i].config);
+            }
+        }
+        free(configs->entries);
     }
-    return m_config;
+    free(configs);
 }
 
-config_t* cfgmgr_get_msgbus_config_sub(cfgmgr_interface_t* ctx) {
+bool cfgmgr_is_dev_mode(cfgmgr_ctx_t* cfgmgr) {
     LOG_DEBUG("In %s function", __func__);
-    char** host_port = NULL;
-    char* host = NULL;
-    char* port = NULL;
-    int topicret = 0;
-    config_value_t* sub_config = ctx->interface;
-    char* app_name = ctx->cfg_mgr->app_name;
-    bool dev_mode = false;
-    config_value_t* topic_array = NULL;
-    config_value_t* publisher_appname = NULL;
-    config_value_t* topic = NULL;
-    char* config_value_cr = NULL;
-    config_value_t* subscribe_config_name = NULL;
-    config_value_t* subscribe_config_endpoint = NULL;
-    char* type_override_env = NULL;
-    char* type_override = NULL;
-    config_value_t* subscribe_config_type = NULL;
-    char* ep_override_env = NULL;
-    char* ep_override = NULL;
-    config_value_t* zmq_recv_hwm_value = NULL;
-    config_t* topics = NULL;
-    kv_store_client_t* kv_store_client = NULL;
-    config_t* c_json = NULL;
-    config_value_t* type_cvt = NULL;
-    config_value_t* zmq_tcp_host = NULL;
-    config_value_t* zmq_tcp_port = NULL;
-    config_value_t* type_value = NULL;
-    config_value_t* topic_data = NULL;
-    config_value_t* zmq_tcp_subscriber_port = NULL;
-    config_value_t* zmq_tcp_subscriber_host = NULL;
-
-    int devmode = ctx->cfg_mgr->dev_mode;
-    if (devmode == 0) {
-        dev_mode = true;
-    }
-
-    kv_store_client = ctx->cfg_mgr->kv_store_client;
-    void* kv_store_handle = ctx->cfg_mgr->kv_store_handle;
-
-    // Creating final config object
-    c_json = json_config_new_from_buffer("{}");
-    if (c_json == NULL) {
-        LOG_ERROR_0("Error creating c_json object");
-        goto err;
-    }
-
-    // Fetching Type from config
-    subscribe_config_type = config_value_object_get(sub_config, TYPE);
-    if (subscribe_config_type == NULL || subscribe_config_type->body.string == NULL) {
-        LOG_ERROR_0("subscribe_config_type initialization failed");
-        goto err;
+    // Fetching dev mode from cfgmgr
+    int result = cfgmgr->dev_mode;
+    if (result == 0) {
+        return true;
     }
+    return false;
+}
 
-    if(subscribe_config_type->type != CVT_STRING || subscribe_config_type->body.string == NULL){
-        LOG_ERROR_0("subscribe_config_type type mismatch or the string value is NULL");
-        goto err;
+config_value_t* cfgmgr_get_appname(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    // Fetching app name from cfgmgr
+    config_value_t* app_name = config_value_new_string(cfgmgr->app_name);
+    if (app_name == NULL) {
+        LOG_ERROR_0("Fetching appname failed");
+        return NULL;
     }
-    char* type = subscribe_config_type->body.string;
+    return app_name;
+}
 
-    // Fetching EndPoint from config
-    subscribe_config_endpoint = config_value_object_get(sub_config, ENDPOINT);
-    if (subscribe_config_endpoint == NULL) {
-        LOG_ERROR_0("subscribe_config_endpoint initialization failed");
-        goto err;
+int cfgmgr_get_num_elements(config_t* config, const char* key) {
+    LOG_DEBUG("In %s function", __func__);
+    // Fetching list of interface elements
+    config_value_t* interfaces = config_get(config, key);
+    if (interfaces == NULL) {
+        LOG_ERROR_0("Failed to fetch number of elements in interface");
+        return -1;
     }
-
-    char* end_point = NULL;
-    if (subscribe_config_endpoint->type == CVT_OBJECT) {
-        end_point = cvt_to_char(subscribe_config_endpoint);
-    } else {
-        end_point = subscribe_config_endpoint->body.string;
+    if (interfaces->type != CVT_ARRAY) {
+        LOG_ERROR("%s interface is not an array type", key);
+        return -1;
     }
+    int result = config_value_array_len(interfaces);
+    config_value_destroy(interfaces);
+    return result;
+}
 
-    if (end_point == NULL) {
-        LOG_ERROR_0("Failed to get endpoint, its NULL");
-        goto err;
+int cfgmgr_get_num_publishers(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return -1;
     }
-
-    // Fetching Name from config
-    subscribe_config_name = config_value_object_get(sub_config, NAME);
-    if (subscribe_config_name == NULL) {
-        LOG_ERROR_0("subscribe_config_name initialization failed");
-        goto err;
+    int result = cfgmgr_iface_index_count(cfgmgr->iface_index, CFGMGR_PUBLISHER);
+    if (result < 0) {
+        LOG_ERROR("%s interface is not an array type", PUBLISHERS);
     }
+    return result;
+}
 
-    // Overriding endpoint with SUBSCRIBER_<Name>_ENDPOINT if set
-    size_t init_len = strlen("SUBSCRIBER_") + strlen(subscribe_config_name->body.string) + strlen("_ENDPOINT") + 2;
-    ep_override_env = concat_s(init_len, 3, "SUBSCRIBER_", subscribe_config_name->body.string, "_ENDPOINT");
-    if (ep_override_env == NULL) {
-        LOG_ERROR_0("concatenation for ep_override_env failed");
-        goto err;
+int cfgmgr_get_num_subscribers(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return -1;
     }
-
-    char subscriber_ep[MAX_ENDPOINT_LENGTH] = "";
-    ep_override = getenv(ep_override_env);
-    if (ep_override != NULL) {
-
-        int ret = strncpy_s(subscriber_ep, MAX_ENDPOINT_LENGTH + 1,
-                        ep_override, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR("failed to copy SUBSCRIBER_%s_ENDPOINT env value", subscribe_config_name->body.string);
-            goto err;
-        }
-
-        if (strlen(subscriber_ep) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", ep_override_env);
-            end_point = subscriber_ep;
-        }
-    } else {
-        LOG_DEBUG("env not set for overridding %s, and hence endpoint taking from interface ", ep_override_env);
+    int result = cfgmgr_iface_index_count(cfgmgr->iface_index, CFGMGR_SUBSCRIBER);
+    if (result < 0) {
+        LOG_ERROR("%s interface is not an array type", SUBSCRIBERS);
     }
+    return result;
+}
 
-    // Overriding endpoint with SUBSCRIBER_ENDPOINT if set
-    // Note: This overrides all the subscriber type if set
-    char* sub_ep_env = getenv("SUBSCRIBER_ENDPOINT");
-    if (sub_ep_env != NULL) {
-        int ret = strncpy_s(subscriber_ep, MAX_ENDPOINT_LENGTH + 1,
-                        sub_ep_env, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR_0("failed to copy SUBSCRIBER_ENDPOINT env value");
-            goto err;
-        }
-    } else {
-        LOG_DEBUG_0("env not set for overridding SUBSCRIBER_ENDPOINT, and hence endpoint taking from interface ");
+int cfgmgr_get_num_servers(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return -1;
     }
-
-    LOG_DEBUG_0("Overriding endpoint with SUBSCRIBER_ENDPOINT");
-    if (strlen(subscriber_ep) != 0) {
-        end_point = subscriber_ep;
+    int result = cfgmgr_iface_index_count(cfgmgr->iface_index, CFGMGR_SERVER);
+    if (result < 0) {
+        LOG_ERROR("%s interface is not an array type", SERVERS);
     }
+    return result;
+}
 
-    // Overriding endpoint with SUBSCRIBER_<Name>_TYPE if set
-    init_len = strlen("SUBSCRIBER_") + strlen(subscribe_config_name->body.string) + strlen("_TYPE") + 2;
-    type_override_env = concat_s(init_len, 3, "SUBSCRIBER_", subscribe_config_name->body.string, "_TYPE");
-    if (type_override_env == NULL) {
-        LOG_ERROR_0("concatenation for type_override_env failed");
-        goto err;
-    }
-    type_override = getenv(type_override_env);
-    if (type_override != NULL) {
-        if (strlen(type_override) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", type_override_env);
-            type = type_override;
-        }
-    } else {
-        LOG_DEBUG("env not set for overridding %s, and hence type taking from interface ", type_override_env);
+int cfgmgr_get_num_clients(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return -1;
     }
-
-    // Overriding endpoint with SUBSCRIBER_TYPE if set
-    // Note: This overrides all the subscriber endpoints if set
-    char* subscriber_type = getenv("SUBSCRIBER_TYPE");
-    if (subscriber_type != NULL) {
-        LOG_DEBUG_0("Overriding endpoint with SUBSCRIBER_TYPE");
-        if (strlen(subscriber_type) != 0) {
-            type = subscriber_type;
-        }
-    } else {
-        LOG_DEBUG("env not set for overridding SUBSCRIBER_TYPE, and hence type taking from interface ");
+    int result = cfgmgr_iface_index_count(cfgmgr->iface_index, CFGMGR_CLIENT);
+    if (result < 0) {
+        LOG_ERROR("%s interface is not an array type", CLIENTS);
     }
+    return result;
+}
 
-    type_cvt = config_value_new_string(type);
-    if (type_cvt == NULL) {
-        LOG_ERROR_0("Get type_cvt failed");
-        goto err;
-    }
-    bool config_set_result = config_set(c_json, "type", type_cvt);
-    if (!config_set_result) {
-        LOG_ERROR_0("Unable to set config value");
-        goto err;
+config_t* cfgmgr_get_app_config(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_CONFIG) != 0) {
+        LOG_ERROR_0("Failed to load the app config");
+        return NULL;
     }
+    return cfgmgr_snapshots_app_config(cfgmgr->snapshots);
+}
 
-    // Adding zmq_recv_hwm value if available
-    zmq_recv_hwm_value = config_value_object_get(sub_config, ZMQ_RECV_HWM);
-    if (zmq_recv_hwm_value != NULL) {
-        if (zmq_recv_hwm_value->type != CVT_INTEGER) {
-            LOG_ERROR_0("zmq_recv_hwm type is not integer");
-            goto err;
-        }
-        bool config_set_result = config_set(c_json, ZMQ_RECV_HWM, zmq_recv_hwm_value);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-        }
+config_t* cfgmgr_acquire_app_config(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_CONFIG) != 0) {
+        LOG_ERROR_0("Failed to load the app config");
+        return NULL;
     }
-    if(!strcmp(type, "zmq_ipc")) {
-        bool ret = get_ipc_config(c_json, sub_config, end_point, CFGMGR_SUBSCRIBER);
-        if (ret == false) {
-            LOG_ERROR_0("IPC configuration for subscriber failed");
-            goto err;
-        }
-    } else if(!strcmp(type, "zmq_tcp")) {
-        // Fetching Topics from config
-        topic_array = config_value_object_get(sub_config, TOPICS);
-        if (topic_array == NULL) {
-            LOG_ERROR_0("topic_array initialization failed");
-            goto err;
-        }
-        size_t arr_len = config_value_array_len(topic_array);
-        if(arr_len == 0){
-            LOG_ERROR_0("Empty array is not supported, atleast one value should be given.");
-            goto err;
-        }
-        host_port = get_host_port(end_point);
-        if (host_port == NULL){
-            LOG_ERROR_0("Get host and port failed");
-            goto err;
-        }
-        host = host_port[0];
-        trim(host);
-        port = host_port[1];
-        trim(port);
-        int64_t i_port = atoi(port);
-
-        int ret;
-        // comparing the first topic in the array of subscribers topic with "*"
-        topic = config_value_array_get(topic_array, 0);
-        if (topic == NULL || topic->body.string == NULL){
-            LOG_ERROR_0("topic initialization failed");
-            goto err;
-        }
-        strcmp_s(topic->body.string, strlen(topic->body.string), "*", &topicret);
-        if (topic != NULL) {
-            config_value_destroy(topic);
-        }
-
-        publisher_appname = config_value_object_get(sub_config, PUBLISHER_APPNAME);
-        if (publisher_appname == NULL) {
-            LOG_ERROR("%s initialization failed", PUBLISHER_APPNAME);
-            goto err;
-        }
-        if(publisher_appname->type != CVT_STRING || publisher_appname->body.string == NULL){
-            LOG_ERROR("PublisherAppName type mismatch or the string is NULL");
-            goto err;
-        }
-        for (size_t i = 0; i < arr_len; i++) {
-            // Creating empty config object
-            topics = json_config_new_from_buffer("{}");
-            zmq_tcp_host = config_value_new_string(host);
-            if (zmq_tcp_host == NULL) {
-                LOG_ERROR_0("Get zmq_tcp_host failed");
-                goto err;
-            }
-            zmq_tcp_port = config_value_new_integer(i_port);
-            if (zmq_tcp_port == NULL) {
-                LOG_ERROR_0("Get zmq_tcp_port failed");
-                goto err;
-            }
-            config_set_result = config_set(topics, "host", zmq_tcp_host);
-            if (!config_set_result) {
-                LOG_ERROR("Unable to set config value");
-            }
-            config_set_result = config_set(topics, "port", zmq_tcp_port);
-            if (!config_set_result) {
-                LOG_ERROR("Unable to set config value");
-            }
+    return cfgmgr_snapshots_acquire_config(cfgmgr->snapshots);
+}
 
-            topic = config_value_array_get(topic_array, i);
-            if (topic == NULL) {
-                LOG_ERROR_0("topic initialization failed");
-                goto err;
-            }
+void cfgmgr_release_app_config(cfgmgr_ctx_t* cfgmgr, config_t* app_config) {
+    cfgmgr_snapshots_release_config(cfgmgr->snapshots, app_config);
+}
 
-            // if topics lenght is not 1 or the topic is not equal to "*",
-            // then we are adding that topic for subscription.
-            if (!dev_mode) {
-                LOG_DEBUG_0("Running in Prod Mode...");
-                bool ret_val;
-                // This is ZmqBroker usecase, where in "PublisherAppname" will be specified as "*"
-                // hence comparing for "PublisherAppname" and "*"
-                strcmp_s(publisher_appname->body.string, strlen(publisher_appname->body.string), "*", &ret);
-                if(ret == 0) {
-                    // In case of ZmqBroker, it is "X-SUB" which needs "publishers" way of
-                    // messagebus config, hence calling "construct_tcp_publisher_prod()" function
-                    ret_val = construct_tcp_publisher_prod(app_name, c_json, topics, kv_store_handle, sub_config, kv_store_client);
-                     if(!ret_val) {
-                        LOG_ERROR_0("Failed in construct_tcp_publisher_prod()");
-                        goto err;
-                    }
-                }else {
-                    ret_val = add_keys_to_config(topics, app_name, kv_store_client, kv_store_handle, publisher_appname, sub_config);
-                    if(!ret_val) {
-                        LOG_ERROR_0("Failed in add_keys_to_config()");
-                        goto err;
-                    }
-                }
-            } else {
-                LOG_DEBUG_0("Running in Dev Mode...");
-            }
-            config_value_t* topics_cvt = config_value_new_object(topics->cfg, get_config_value, NULL);
-            if (topics_cvt == NULL) {
-                LOG_ERROR_0("Unable to create topics_cvt config_value_t object");
-                goto err;
-            }
-            if((arr_len == 1) && (topicret == 0)) {
-                config_set_result = config_set(c_json, "", topics_cvt);
-                if (!config_set_result) {
-                    LOG_ERROR_0("Unable to set config value");
-                    goto err;
-                }
-            } else {
-                config_set_result = config_set(c_json, topic->body.string, topics_cvt);
-                if (!config_set_result) {
-                    LOG_ERROR_0("Unable to set config value");
-                    goto err;
-                }
-            }
-        }
-    } else {
-        LOG_ERROR_0("Type should be either \"zmq_ipc\" or \"zmq_tcp\"");
-        goto err;
+config_t* cfgmgr_get_app_interface(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        return NULL;
     }
+    return cfgmgr_current_interface(cfgmgr);
+}
 
-    // Extracting and printing non-secret data from the config
-    type_value = c_json->get_config_value(c_json->cfg, "type");
-    if (type_value == NULL) {
-        LOG_ERROR_0("\"type\" key is missing in the config");
-        c_json = NULL;
-        goto err;
-    } else if (type_value->type != CVT_STRING) {
-        LOG_ERROR_0("\"type\" value has to be of string type");
-        c_json = NULL;
-        goto err;
+config_value_t* cfgmgr_get_app_config_value(cfgmgr_ctx_t* cfgmgr, const char* key) {
+    LOG_DEBUG("In %s function", __func__);
+    config_t* app_config = cfgmgr_acquire_app_config(cfgmgr);
+    if (app_config == NULL) {
+        return NULL;
     }
-    if (!strcmp(type_value->body.string, "zmq_ipc")) {
-        config_value_cr = configt_to_char(c_json);
-        if (config_value_cr == NULL) {
-            LOG_ERROR_0("config_value_cr initialization failed");
-            c_json = NULL;
-            goto err;
-        }
-        LOG_DEBUG("Env Subscriber Config is : %s \n", config_value_cr);
-    } else {
-        // Checking if topic is "*", if yes, then in the config we need to check with empty string
-        if ( topicret == 0 ) {
-            topic_data = c_json->get_config_value(c_json->cfg, "");
+    config_value_t* value = app_config->get_config_value(app_config->cfg, key);
+    config_value_t* copy = value;
+    // Objects and arrays point into the config, which is released below
+    if (value != NULL && (value->type == CVT_OBJECT || value->type == CVT_ARRAY)) {
+        const cJSON* json = (value->type == CVT_OBJECT) ? (const cJSON*) value->body.object->object
+                                                        : (const cJSON*) value->body.array->array;
+        cJSON* json_copy = cJSON_Duplicate(json, true);
+        if (json_copy == NULL) {
+            LOG_ERROR("Failed to copy the value of %s", key);
+            copy = NULL;
+        } else if (value->type == CVT_OBJECT) {
+            copy = config_value_new_object((void*) json_copy, get_config_value, free_json);
         } else {
-            topic_data = c_json->get_config_value(c_json->cfg, topic->body.string);
+            copy = config_value_new_array((void*) json_copy, cJSON_GetArraySize(json_copy),
+                                          get_array_item, free_json);
         }
-        if (topic_data == NULL) {
-            LOG_ERROR("\"Topic\" key is missing in the config");
-            c_json = NULL;
-            goto err;
-        } else {
-            zmq_tcp_subscriber_host = config_value_object_get(topic_data,
-                                                                        "host");
-            if ( zmq_tcp_subscriber_host == NULL ) {
-                LOG_ERROR_0("Subscriber \"host\" key missing");
-                c_json = NULL;
-                goto err;
-            }
-            if (zmq_tcp_subscriber_host->type != CVT_STRING) {
-                LOG_ERROR_0("Subscriber \"host\" value has to be of string type");
-                c_json = NULL;
-                goto err;
-            }
-            zmq_tcp_subscriber_port = config_value_object_get(topic_data,
-                                                                        "port");
-            if ( zmq_tcp_subscriber_port == NULL ) {
-                LOG_ERROR_0("Subscriber \"port\" key missing");
-                c_json = NULL;
-                goto err;
-            }
-            if (zmq_tcp_subscriber_port->type != CVT_INTEGER) {
-                LOG_ERROR_0("Subscriber \"port\" value has to be of integer type");
-                c_json = NULL;
-                goto err;
-            }
+        if (json_copy != NULL && copy == NULL) {
+            LOG_ERROR("Failed to initialize the value of %s", key);
+            cJSON_Delete(json_copy);
         }
-
-        LOG_DEBUG("\nEnv Subscriber Config is : \n Type : %s \n Topic : %s \n Host : %s \n Port : %d \n", \
-                   type_value->body.string, \
-                   topic->body.string, \
-                   zmq_tcp_subscriber_host->body.string, \
-                   zmq_tcp_subscriber_port->body.integer);
+        config_value_destroy(value);
     }
+    cfgmgr_release_app_config(cfgmgr, app_config);
+    return copy;
+}
 
-err:
-    if (type_value != NULL) {
-        config_value_destroy(type_value);
-    }
-    if (topic_data != NULL) {
-        config_value_destroy(topic_data);
-    }
-    if (zmq_tcp_subscriber_port != NULL) {
-        config_value_destroy(zmq_tcp_subscriber_port);
-    }
-    if (zmq_tcp_subscriber_host != NULL) {
-        config_value_destroy(zmq_tcp_subscriber_host);
-    }
-    if (topic != NULL) {
-        config_value_destroy(topic);
-    }
-    if (host_port != NULL) {
-        free_mem(host_port);
-    }
-    if (subscribe_config_type != NULL) {
-        config_value_destroy(subscribe_config_type);
-    }
-    if (subscribe_config_endpoint != NULL) {
-        config_value_destroy(subscribe_config_endpoint);
-    }
-    if (subscribe_config_name != NULL) {
-        config_value_destroy(subscribe_config_name);
-    }
-    if (ep_override_env != NULL) {
-        free(ep_override_env);
-    }
-    if (type_override_env != NULL) {
-        free(type_override_env);
-    }
-    if (zmq_recv_hwm_value != NULL) {
-        config_value_destroy(zmq_recv_hwm_value);
-    }
-    if (topic_array != NULL) {
-        config_value_destroy(topic_array);
-    }
-    if (publisher_appname != NULL) {
-        config_value_destroy(publisher_appname);
-    }
-    if (config_value_cr != NULL) {
-        free(config_value_cr);
-    }
-    if (type_cvt != NULL) {
-        config_value_destroy(type_cvt);
-    }
-    if (zmq_tcp_host != NULL) {
-        config_value_destroy(zmq_tcp_host);
-    }
-    if (zmq_tcp_port != NULL) {
-        config_value_destroy(zmq_tcp_port);
+config_value_t* cfgmgr_get_app_interface_value(cfgmgr_ctx_t* cfgmgr, const char* key) {
+    LOG_DEBUG("In %s function", __func__);
+    config_t* app_interface = cfgmgr_get_app_interface(cfgmgr);
+    if (app_interface == NULL) {
+        return NULL;
     }
-return c_json;
+    return app_interface->get_config_value(app_interface->cfg, key);
 }
 
-config_t* cfgmgr_get_msgbus_config_server(cfgmgr_interface_t* ctx) {
+config_value_t* cfgmgr_get_interface_value(cfgmgr_interface_t* cfgmgr_interface, const char* key) {
     LOG_DEBUG("In %s function", __func__);
-    config_value_t* serv_config = ctx->interface;
-    char* app_name = ctx->cfg_mgr->app_name;
-    int dev_mode = ctx->cfg_mgr->dev_mode;
-    kv_store_client_t* kv_store_client = ctx->cfg_mgr->kv_store_client;
-    void* kv_store_handle = ctx->cfg_mgr->kv_store_handle;
-    config_value_t* temp_array_value = NULL;
-    config_value_t* server_name = NULL;
-    config_value_t* server_config_type = NULL;
-    char* ep_override_env = NULL;
-    char** host_port = NULL;
-    char* type_override_env = NULL;
-    config_value_t* server_json_clients = NULL;
-    config_value_t* pub_key_values = NULL;
-    char* pub_pri_key = NULL;
-    char* server_secret_key = NULL;
-    config_value_t* server_endpoint = NULL;
-    char* grab_public_key = NULL;
-    char* client_public_key = NULL;
-    char* config_value_cr = NULL;
-    char **all_clients = NULL;
-    config_value_t* type_cvt = NULL;
-    config_value_t* zmq_recv_hwm_value = NULL;
-    config_t* server_topic = NULL;
-    config_value_t* zmq_tcp_host = NULL;
-    config_value_t* zmq_tcp_port = NULL;
-    config_t* all_clients_arr_config = NULL;
-    config_value_t* all_clients_cvt = NULL;
-    config_value_t* server_secret_key_cvt = NULL;
-    config_value_t* server_topic_cvt = NULL;
-    config_value_t* type_value = NULL;
-    config_value_t* server_data = NULL;
-    config_value_t* zmq_tcp_server_port = NULL;
-    config_value_t* zmq_tcp_server_host = NULL;
-
-    config_t* c_json = NULL;
-    // Creating final config object
-    c_json = json_config_new_from_buffer("{}");
-    if (c_json == NULL) {
-        LOG_ERROR_0("Error creating c_json object");
-        goto err;
-    }
+    config_value_t* interface_value = config_value_object_get(cfgmgr_interface->interface, key);
+    return interface_value;
+}
 
-    // Fetching Name from name
-    server_name = config_value_object_get(serv_config, NAME);
-    if (server_name == NULL) {
-        LOG_ERROR_0("server_name initialization failed");
-        goto err;
-    }
+// Registration of cfgmgr_watch() on a key the context already watches
+struct cfgmgr_key_watch {
+    // Part of the context whose watch delivers the key
+    int part;
+    cfgmgr_watch_callback_t callback;
+    void* user_data;
+    struct cfgmgr_key_watch* next;
+};
 
-    // Fetching Type from config
-    server_config_type = config_value_object_get(serv_config, TYPE);
-    if (server_config_type == NULL || server_config_type->body.string == NULL) {
-        LOG_ERROR_0("server_config_type initialization failed");
-        goto err;
+// Returns the part of the context watching @p key, 0 if none does
+static int cfgmgr_key_watch_part(cfgmgr_ctx_t* cfgmgr, const char* key) {
+    size_t app_len = strlen(cfgmgr->app_name);
+    if (key[0] != '/' || strncmp(key + 1, cfgmgr->app_name, app_len) != 0) {
+        return 0;
     }
-
-    if(server_config_type->type != CVT_STRING || server_config_type->body.string == NULL){
-        LOG_ERROR_0("server_config_type type mismatch or the string value is NULL");
-        goto err;
+    const char* suffix = key + 1 + app_len;
+    if (strcmp(suffix, "/config") == 0) {
+        return CFGMGR_LOAD_CONFIG;
     }
-
-    char* type = server_config_type->body.string;
-
-    // Fetching EndPoint from config
-    server_endpoint = config_value_object_get(serv_config, ENDPOINT);
-    if (server_endpoint == NULL || server_endpoint->body.string == NULL) {
-        LOG_ERROR_0("server_endpoint initialization failed");
-        goto err;
+    if (strcmp(suffix, "/interfaces") == 0) {
+        return CFGMGR_LOAD_INTERFACES;
     }
-    char* end_point = server_endpoint->body.string;
-
-    // // Overriding endpoint with SERVER_<Name>_ENDPOINT if set
-    size_t init_len = strlen("SERVER_") + strlen(server_name->body.string) + strlen("_ENDPOINT") + 2;
-    ep_override_env = concat_s(init_len, 3, "SERVER_", server_name->body.string, "_ENDPOINT");
-    if (ep_override_env == NULL) {
-        LOG_ERROR_0("concatenation for ep_override_env failed");
-        goto err;
+    if (cfgmgr->dev_mode != 0 && strcmp(suffix, PRIVATE_KEY) == 0) {
+        return CFGMGR_LOAD_KEYS;
     }
+    return 0;
+}
 
-    char server_ep[MAX_ENDPOINT_LENGTH] = "";
-    char* ep_override = getenv(ep_override_env);
-    if (ep_override != NULL) {
-
-        int ret = strncpy_s(server_ep, MAX_ENDPOINT_LENGTH + 1,
-                        ep_override, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR("failed to copy SERVER_%s_ENDPOINT env value", server_name->body.string);
-            goto err;
-        }
-
-        if (strlen(server_ep) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", ep_override_env);
-            end_point = server_ep;
+// Hands each callback registered on @p part its own copy of @p value,
+// which the caller keeps
+static void cfgmgr_key_watches_notify(cfgmgr_ctx_t* cfgmgr, int part,
+                                      const char* key, const config_t* value) {
+    struct cfgmgr_key_watch* watch = __atomic_load_n(&cfgmgr->key_watches, __ATOMIC_ACQUIRE);
+    for (; watch != NULL; watch = watch->next) {
+        if (watch->part != part) {
+            continue;
+        }
+        config_t* copy = NULL;
+        if (value != NULL) {
+            cJSON* json = cJSON_Duplicate((const cJSON*) value->cfg, true);
+            if (json == NULL) {
+                LOG_ERROR("Failed to copy %s for a watch", key);
+                continue;
+            }
+            copy = config_new((void*) json, free_json, get_config_value, set_config_value);
+            if (copy == NULL) {
+                LOG_ERROR_0("Failed to initialize configuration object");
+                cJSON_Delete(json);
+                continue;
+            }
         }
-    } else {
-        LOG_DEBUG_0("env not set for overridding endpoint, hence endpoint is taken from interface");
+        watch->callback(key, copy, watch->user_data);
     }
+}
 
-    // Overriding endpoint with SERVER_ENDPOINT if set
-    // Note: This overrides all the server endpoints if set
-    char* server_ep_env = getenv("SERVER_ENDPOINT");
-    if (server_ep_env != NULL) {
-        int ret = strncpy_s(server_ep, MAX_ENDPOINT_LENGTH + 1,
-                        server_ep_env, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR_0("failed to copy SERVER_ENDPOINT env value");
-            goto err;
-        }
-
-        LOG_DEBUG_0("Overriding endpoint with SERVER_ENDPOINT");
-        if (strlen(server_ep) != 0) {
-            end_point = server_ep;
-        }
-    } else {
-        LOG_DEBUG_0("env not set for overridding SERVER_ENDPOINT, and hence endpoint taking from interface ");
+static void cfgmgr_key_watches_free(struct cfgmgr_key_watch* watch) {
+    while (watch != NULL) {
+        struct cfgmgr_key_watch* next = watch->next;
+        free(watch);
+        watch = next;
     }
+}
 
-    // Overriding endpoint with SERVER_<Name>_TYPE if set
-    init_len = strlen("SERVER_") + strlen(server_name->body.string) + strlen("_TYPE") + 2;
-    type_override_env = concat_s(init_len, 3, "SERVER_", server_name->body.string, "_TYPE");
-    if (type_override_env == NULL) {
-        LOG_ERROR_0("concatenation for type_override_env failed");
-        goto err;
-    }
-    char* type_override = getenv(type_override_env);
-    if (type_override != NULL) {
-        if (strlen(type_override) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", type_override_env);
-            type = type_override;
-        }
-    } else {
-        LOG_DEBUG_0("env not set for type overridding, and hence type is taken from interface");
-    }
+void cfgmgr_watch(cfgmgr_ctx_t* cfgmgr, const char* key, cfgmgr_watch_callback_t watch_callback, void* user_data) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_CONNECTION) != 0) {
+        LOG_ERROR("Failed to connect to the kv_store to watch %s", key);
+        return;
+    }
+    int part = cfgmgr_key_watch_part(cfgmgr, key);
+    if (part == 0) {
+        // Calling the base watch API
+        cfgmgr->kv_store_client->watch(cfgmgr->kv_store_handle, key, watch_callback, user_data);
+        return;
+    }
+
+    // Sharing the watch the context keeps on the key
+    if (cfgmgr_load(cfgmgr, part) != 0) {
+        LOG_ERROR("Failed to load the context to watch %s", key);
+        return;
+    }
+    struct cfgmgr_key_watch* watch = (struct cfgmgr_key_watch*) calloc(
+            1, sizeof(struct cfgmgr_key_watch));
+    if (watch == NULL) {
+        LOG_ERROR("Calloc failed for the watch of %s", key);
+        return;
+    }
+    watch->part = part;
+    watch->callback = watch_callback;
+    watch->user_data = user_data;
+    watch->next = __atomic_load_n(&cfgmgr->key_watches, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&cfgmgr->key_watches, &watch->next, watch, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {}
+    return;
+}
 
-    // Overriding endpoint with SERVER_TYPE if set
-    // Note: This overrides all the server type if set
-    char* server_type = getenv("SERVER_TYPE");
-    if (server_type != NULL) {
-        LOG_DEBUG_0("Overriding endpoint with SERVER_TYPE");
-        if (strlen(server_type) != 0) {
-            type = server_type;
-        }
-    }  else {
-        LOG_DEBUG_0("env not set for overridding SERVER_TYPE, and hence type taking from interface ");
+void cfgmgr_watch_prefix(cfgmgr_ctx_t* cfgmgr, char* prefix, cfgmgr_watch_callback_t watch_callback, void* user_data) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_CONNECTION) != 0) {
+        LOG_ERROR("Failed to connect to the kv_store to watch %s", prefix);
+        return;
     }
+    // Calling the base watch_prefix API
+    cfgmgr->kv_store_client->watch_prefix(cfgmgr->kv_store_handle, prefix, watch_callback, user_data);
+    return;
+}
 
-    type_cvt = config_value_new_string(type);
-    if (type_cvt == NULL) {
-        LOG_ERROR_0("Get type_cvt failed");
-        goto err;
+int cfgmgr_watch_public_keys(cfgmgr_ctx_t* cfgmgr, cfgmgr_public_keys_callback_t callback, void* user_data) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_CONNECTION) != 0) {
+        LOG_ERROR_0("Failed to connect to the kv_store");
+        return -1;
     }
-    bool config_set_result = config_set(c_json, "type", type_cvt);
-    if (!config_set_result) {
-        LOG_ERROR("Unable to set config value");
-        goto err;
+    if (cfgmgr->public_keys == NULL) {
+        LOG_ERROR_0("Public keys are not kept in memory, watch /Publickeys/ instead");
+        return -1;
     }
+    return kv_store_mirror_listen(cfgmgr->public_keys, callback, user_data);
+}
 
-    // Adding zmq_recv_hwm value if available
-    zmq_recv_hwm_value = config_value_object_get(serv_config, ZMQ_RECV_HWM);
-    if (zmq_recv_hwm_value != NULL) {
-        if (zmq_recv_hwm_value->type != CVT_INTEGER) {
-            LOG_ERROR_0("zmq_recv_hwm type is not integer");
-            goto err;
-        }
+// Registration of cfgmgr_watch_interface_changes() or
+// cfgmgr_watch_config_changes()
+struct cfgmgr_change_watch {
+    cfgmgr_changes_callback_t callback;
+    void* user_data;
+    struct cfgmgr_change_watch* next;
+};
+
+// Prepends a registration, lists are only read by watch threads
+static void cfgmgr_change_watch_push(struct cfgmgr_change_watch** list,
+                                     struct cfgmgr_change_watch* watch) {
+    watch->next = __atomic_load_n(list, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(list, &watch->next, watch, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {}
+}
 
-        bool config_set_result = config_set(c_json, ZMQ_RECV_HWM, zmq_recv_hwm_value);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
-        }
+static void cfgmgr_change_watches_free(struct cfgmgr_change_watch* watch) {
+    while (watch != NULL) {
+        struct cfgmgr_change_watch* next = watch->next;
+        free(watch);
+        watch = next;
     }
+}
 
-    if (!strcmp(type, "zmq_ipc")) {
-        bool ret = get_ipc_config(c_json, serv_config, end_point, CFGMGR_SERVER);
-        if (ret == false) {
-            LOG_ERROR_0("IPC configuration for server failed");
-            goto err;
-        }
-    } else if (!strcmp(type, "zmq_tcp")) {
-        // Add host & port to zmq_tcp_publish object
-        server_topic = json_config_new_from_buffer("{}");
-        if (server_topic == NULL) {
-            LOG_ERROR_0("server_topic initialization failed");
-            goto err;
-        }
-
-        host_port = get_host_port(end_point);
-        if (host_port == NULL) {
-            LOG_ERROR_0("Get host and port failed");
-            goto err;
-        }
-        char* host = host_port[0];
-        trim(host);
-        char* port = host_port[1];
-        trim(port);
-        int64_t i_port = atoi(port);
-
-        zmq_tcp_host = config_value_new_string(host);
-        if (zmq_tcp_host == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_host failed");
-            goto err;
-        }
-        zmq_tcp_port = config_value_new_integer(i_port);
-        if (zmq_tcp_port == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_port failed");
-            goto err;
-        }
-
-        config_set_result = config_set(server_topic, "host", zmq_tcp_host);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
-        }
-        config_set_result = config_set(server_topic, "port", zmq_tcp_port);
-        if (!config_set_result) {
-            LOG_ERROR("Unable to set config value");
-            goto err;
-        }
-
-        if (dev_mode != 0) {
-            LOG_DEBUG_0("Running in Prod Mode...");
-
-            // Fetching AllowedClients from config
-            server_json_clients = config_value_object_get(serv_config, ALLOWED_CLIENTS);
-            if (server_json_clients == NULL) {
-                LOG_ERROR_0("server_json_clients initialization failed");
-                goto err;
-            }
-
-            // Checking if Allowed clients is empty string
-            if (config_value_array_len(server_json_clients) == 0) {
-                LOG_ERROR_0("Empty String is not supported in AllowedClients. Atleast one allowed clients is required");
-                goto err;
-            }
-
-            // Fetch the first item in allowed_clients
-            temp_array_value = config_value_array_get(server_json_clients, 0);
-            if (temp_array_value == NULL || temp_array_value->body.string == NULL) {
-                LOG_ERROR_0("temp_array_value initialization failed");
-                goto err;
-            }
-            int result;
-            strcmp_s(temp_array_value->body.string, strlen(temp_array_value->body.string), "*", &result);
-            // If only one item in allowed_clients and it is *
-            // Add all available Publickeys
-            if ((config_value_array_len(server_json_clients) == 1) && (result == 0)) {
-                pub_key_values = kv_store_client->get_prefix(kv_store_handle, "/Publickeys/");
-                if (pub_key_values == NULL) {
-                    LOG_ERROR_0("pub_key_values initialization failed");
-                    goto err;
-                }
-
-                config_set_result = config_set(c_json, "allowed_clients", pub_key_values);
-                if (!config_set_result) {
-                    LOG_ERROR_0("Unable to set config value");
-                    goto err;
-                }
-            } else {
-                config_value_t* array_value;
-                size_t arr_len = config_value_array_len(server_json_clients);
-                if(arr_len == 0){
-                    LOG_ERROR_0("Empty array is not supported, atleast one value should be given.");
-                    goto err;
-                }
-                all_clients = (char**)calloc(arr_len, sizeof(char*));
-                if (all_clients == NULL) {
-                    LOG_ERROR_0("all_clients initialization failed");
-                    goto err;
-                }
-                for (int i =0; i < arr_len; i++) {
-                    // Fetching individual public keys of all AllowedClients
-                    array_value = config_value_array_get(server_json_clients, i);
-                    if (array_value == NULL) {
-                        LOG_ERROR_0("array_value initialization failed");
-                        goto err;
-                    }
-                    size_t init_len = strlen(PUBLIC_KEYS) + strlen(array_value->body.string) + 2;
-                    char* grab_public_key = concat_s(init_len, 2, PUBLIC_KEYS, array_value->body.string);
-                    if (grab_public_key == NULL) {
-                        LOG_ERROR_0("concatenation for grab_public_key failed");
-                        goto err;
-                    }
-                    const char* client_public_key = kv_store_client->get(kv_store_handle, grab_public_key);
-                    if(client_public_key == NULL){
-                        // If any service isn't provisioned, ignore if key not found
-                        LOG_DEBUG("Value is not found for the key: %s", grab_public_key);
-                        all_clients[i] = NULL;
-                    } else {
-                        all_clients[i] = client_public_key;
-                    }
-                    free(grab_public_key);
-
-                    config_value_destroy(array_value);
-                }
-                // Adding all public keys of clients to allowed_clients of config
-                all_clients_arr_config = json_config_new_array(all_clients, arr_len);
-                if (all_clients_arr_config == NULL) {
-                    LOG_ERROR_0("Failed to create all_clients_arr_config config_t object");
-                    goto err;
-                }
-
-                all_clients_cvt = config_value_new_object(all_clients_arr_config->cfg, get_config_value, NULL);
-                if (all_clients_cvt == NULL) {
-                    LOG_ERROR_0("Unable to create config_value_t all_clients_cvt object");
-                    goto err;
-                }
-
-                config_set_result = config_set(c_json, "allowed_clients", all_clients_cvt);
-                if (!config_set_result) {
-                    LOG_ERROR_0("Unable to set config value");
-                    goto err;
-                }
-            }
-
-            // Fetching Publisher private key & adding it to server_topic object
-            size_t init_len = strlen("/") + strlen(PRIVATE_KEY) + strlen(app_name) + 2;
-            pub_pri_key = concat_s(init_len, 3, "/", app_name, PRIVATE_KEY);
-            if (pub_pri_key == NULL) {
-                LOG_ERROR_0("concatenation for pub_pri_key failed");
-                goto err;
-            }
-            server_secret_key = kv_store_client->get(kv_store_handle, pub_pri_key);
-            if (server_secret_key == NULL) {
-                LOG_ERROR("Value is not found for the key: %s", pub_pri_key);
-                goto err;
-            }
-
-            server_secret_key_cvt = config_value_new_string(server_secret_key);
-            if (server_secret_key_cvt == NULL) {
-                LOG_ERROR_0("Get server_secret_key_cvt failed");
-                goto err;
-            }
-            config_set_result = config_set(server_topic, "server_secret_key", server_secret_key_cvt);
-            if (!config_set_result) {
-                LOG_ERROR("Unable to set config value");
-                goto err;
-            }
-
-        } else {
-            LOG_DEBUG_0("Running in Dev Mode...");
-        }
-        // Creating the server_topic config_value_t object
-        server_topic_cvt = config_value_new_object(server_topic->cfg, get_config_value, set_config_value);
-        if (server_topic_cvt == NULL) {
-            LOG_ERROR_0("server_topic_cvt config_value_t initialization failed");
-            goto err;
-        }
-        config_set_result = config_set(c_json, server_name->body.string, server_topic_cvt);
-        if (!config_set_result) {
-            LOG_ERROR_0("Unable to set config value");
-            goto err;
-        }
-    } else {
-        LOG_ERROR_0("Type should be either \"zmq_ipc\" or \"zmq_tcp\"");
-        goto err;
+static void cfgmgr_change_watches_notify(struct cfgmgr_change_watch* watch,
+                                         const cfgmgr_changes_t* changes) {
+    if (changes->count == 0) {
+        return;
     }
-
-    // Extracting and printing non-secret data from the config
-    type_value = c_json->get_config_value(c_json->cfg, "type");
-    if (type_value == NULL) {
-        LOG_ERROR_0("\"type\" key is missing in the config");
-        c_json = NULL;
-        goto err;
-    } else if (type_value->type != CVT_STRING) {
-        LOG_ERROR_0("\"type\" value has to be of string type");
-        c_json = NULL;
-        goto err;
+    for (; watch != NULL; watch = watch->next) {
+        watch->callback(changes, watch->user_data);
     }
-    if (!strcmp(type_value->body.string, "zmq_ipc")) {
-        config_value_cr = configt_to_char(c_json);
-        if (config_value_cr == NULL) {
-            LOG_ERROR_0("config_value_cr initialization failed");
-            c_json = NULL;
-            goto err;
-        }
-        LOG_DEBUG("Env Server Config is : %s \n", config_value_cr);
-    } else {
-        server_data = c_json->get_config_value(c_json->cfg, server_name->body.string);
-        if (server_data == NULL) {
-            LOG_ERROR("\"name\" key is missing in the config");
-            c_json = NULL;
-            goto err;
-        } else {
-            zmq_tcp_server_host = config_value_object_get(server_data,
-                                                                        "host");
-            if ( zmq_tcp_server_host == NULL ) {
-                LOG_ERROR_0("Server \"host\" key missing");
-                c_json = NULL;
-                goto err;
-            }
-            if (zmq_tcp_server_host->type != CVT_STRING) {
-                LOG_ERROR_0("Server \"host\" value has to be of string type");
-                c_json = NULL;
-                goto err;
-            }
-            zmq_tcp_server_port = config_value_object_get(server_data,
-                                                                        "port");
-            if ( zmq_tcp_server_port == NULL ) {
-                LOG_ERROR_0("Server \"port\" key missing");
-                c_json = NULL;
-                goto err;
-            }
-            if (zmq_tcp_server_port->type != CVT_INTEGER) {
-                LOG_ERROR_0("Server \"port\" value has to be of integer type");
-                c_json = NULL;
-                goto err;
-            }
-        }
+}
 
-        LOG_DEBUG("\nEnv Server Config is : \n Type : %s \n ServerName : %s \n Host : %s \n Port : %d \n", \
-                   type_value->body.string, \
-                   server_name->body.string, \
-                   zmq_tcp_server_host->body.string, \
-                   zmq_tcp_server_port->body.integer);
+// Publishes a snapshot of interfaces of the index, which the snapshots
+// reference until cfgmgr_snapshot_interface_release()
+static int cfgmgr_publish_interfaces(cfgmgr_ctx_t* cfgmgr) {
+    config_t* app_interface = cfgmgr_iface_index_acquire_interfaces(cfgmgr->iface_index);
+    if (app_interface == NULL) {
+        return -1;
+    }
+    if (cfgmgr_snapshots_publish(cfgmgr->snapshots, NULL, app_interface) != 0) {
+        cfgmgr_iface_index_release_interfaces(cfgmgr->iface_index, app_interface);
+        return -1;
     }
+    return 0;
+}
 
+static void cfgmgr_snapshot_interface_release(config_t* app_interface, void* user_data) {
+    cfgmgr_iface_index_release_interfaces((cfgmgr_iface_index_t*) user_data, app_interface);
+}
 
-err:
-    if (type_value != NULL) {
-        config_value_destroy(type_value);
-    }
-    if (server_data != NULL) {
-        config_value_destroy(server_data);
-    }
-    if (zmq_tcp_server_port != NULL) {
-        config_value_destroy(zmq_tcp_server_port);
-    }
-    if (zmq_tcp_server_host != NULL) {
-        config_value_destroy(zmq_tcp_server_host);
-    }
-    if (temp_array_value != NULL) {
-        config_value_destroy(temp_array_value);
-    }
-    if (server_name != NULL) {
-        config_value_destroy(server_name);
-    }
-    if (server_config_type != NULL) {
-        config_value_destroy(server_config_type);
-    }
-    if (ep_override_env != NULL) {
-        free(ep_override_env);
-    }
-    if (host_port != NULL) {
-        free_mem(host_port);
-    }
-    if (type_override_env != NULL) {
-        free(type_override_env);
-    }
-    if (server_json_clients != NULL) {
-        config_value_destroy(server_json_clients);
-    }
-    if (pub_key_values != NULL) {
-        config_value_destroy(pub_key_values);
-    }
-    if (server_endpoint != NULL) {
-        config_value_destroy(server_endpoint);
-    }
-    if (pub_pri_key != NULL) {
-        free(pub_pri_key);
-    }
-    if (server_secret_key != NULL) {
-        free(server_secret_key);
-    }
-    if (config_value_cr != NULL) {
-        free(config_value_cr);
-    }
-    if (grab_public_key != NULL) {
-        free(grab_public_key);
-    }
-    if (client_public_key != NULL) {
-        free(client_public_key);
-    }
-    if (type_cvt != NULL) {
-        config_value_destroy(type_cvt);
-    }
-    if (zmq_recv_hwm_value != NULL) {
-        config_value_destroy(zmq_recv_hwm_value);
-    }
-    if (server_topic != NULL) {
-        free(server_topic);
+static void cfgmgr_interfaces_watch_cb(const char* key, config_t* value, void* user_data) {
+    cfgmgr_ctx_t* cfgmgr = (cfgmgr_ctx_t*) user_data;
+    if (value == NULL) {
+        LOG_ERROR("%s was removed, keeping the current interfaces", key);
+        cfgmgr_key_watches_notify(cfgmgr, CFGMGR_LOAD_INTERFACES, key, NULL);
+        return;
+    }
+    // Keeps the previous interfaces and value alive until compared
+    cfgmgr_gen_guard_t guard = cfgmgr_iface_index_pin(cfgmgr->iface_index);
+    config_t* previous = cfgmgr_iface_index_interfaces(cfgmgr->iface_index);
+    // On success the index owns value
+    if (cfgmgr_iface_index_update(cfgmgr->iface_index, value) != 0) {
+        LOG_ERROR("Failed to index updated interfaces of %s", key);
+        cfgmgr_iface_index_unpin(cfgmgr->iface_index, &guard);
+        config_destroy(value);
+        return;
+    }
+    cfgmgr_msgbus_cache_invalidate(cfgmgr->msgbus_cache);
+    if (cfgmgr_publish_interfaces(cfgmgr) != 0) {
+        LOG_ERROR("Failed to publish snapshot of %s", key);
+    }
+    LOG_DEBUG("Interface index rebuilt for %s", key);
+    cfgmgr_key_watches_notify(cfgmgr, CFGMGR_LOAD_INTERFACES, key, value);
+
+    struct cfgmgr_change_watch* watch = __atomic_load_n(&cfgmgr->iface_watches, __ATOMIC_ACQUIRE);
+    if (watch != NULL) {
+        cfgmgr_changes_t* changes = cfgmgr_diff_interfaces(previous, value);
+        if (changes == NULL) {
+            LOG_ERROR("Failed to compute the changes of %s", key);
+        } else {
+            cfgmgr_change_watches_notify(watch, changes);
+            cfgmgr_changes_destroy(changes);
+        }
     }
-    if (zmq_tcp_host != NULL) {
-        config_value_destroy(zmq_tcp_host);
+    cfgmgr_iface_index_unpin(cfgmgr->iface_index, &guard);
+}
+
+static void cfgmgr_config_watch_cb(const char* key, config_t* value, void* user_data) {
+    cfgmgr_ctx_t* cfgmgr = (cfgmgr_ctx_t*) user_data;
+    if (value == NULL) {
+        LOG_ERROR("%s was removed, keeping the current config", key);
+        cfgmgr_key_watches_notify(cfgmgr, CFGMGR_LOAD_CONFIG, key, NULL);
+        return;
+    }
+    // Keeps the previous config alive until it is compared
+    cfgmgr_snapshot_guard_t guard = cfgmgr_snapshots_pin(cfgmgr->snapshots);
+    // On success the snapshots own value
+    if (cfgmgr_snapshots_publish(cfgmgr->snapshots, value, NULL) != 0) {
+        LOG_ERROR("Failed to publish snapshot of %s", key);
+        cfgmgr_snapshots_unpin(cfgmgr->snapshots, &guard);
+        config_destroy(value);
+        return;
+    }
+    LOG_DEBUG("Config snapshot published for %s", key);
+    // Only this watch replaces the config, value outlives the callback
+    cfgmgr_key_watches_notify(cfgmgr, CFGMGR_LOAD_CONFIG, key, value);
+
+    struct cfgmgr_change_watch* watch = __atomic_load_n(&cfgmgr->config_watches, __ATOMIC_ACQUIRE);
+    if (watch != NULL) {
+        cfgmgr_changes_t* changes = cfgmgr_diff_config(guard.snapshot->app_config, value);
+        if (changes == NULL) {
+            LOG_ERROR("Failed to compute the changes of %s", key);
+        } else {
+            cfgmgr_change_watches_notify(watch, changes);
+            cfgmgr_changes_destroy(changes);
+        }
     }
-    if (zmq_tcp_port != NULL) {
-        config_value_destroy(zmq_tcp_port);
+    cfgmgr_snapshots_unpin(cfgmgr->snapshots, &guard);
+}
+
+int cfgmgr_watch_interface_changes(cfgmgr_ctx_t* cfgmgr, cfgmgr_changes_callback_t callback, void* user_data) {
+    LOG_DEBUG("In %s function", __func__);
+    if (callback == NULL) {
+        LOG_ERROR_0("Callback is NULL");
+        return -1;
     }
-    if (all_clients_arr_config != NULL) {
-        free(all_clients_arr_config);
+    struct cfgmgr_change_watch* watch = (struct cfgmgr_change_watch*) calloc(
+            1, sizeof(struct cfgmgr_change_watch));
+    if (watch == NULL) {
+        LOG_ERROR_0("Calloc failed for interface changes watch");
+        return -1;
     }
-    if (all_clients_cvt != NULL) {
-        free(all_clients_cvt);
+    // Changes are watched once loaded
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES) != 0) {
+        LOG_ERROR_0("Failed to load the interfaces");
+        free(watch);
+        return -1;
     }
-    // Only freeing the calloc for all_clients
-    // since overall freeing of all_clients
-    // will be handled by all_clients_cvt
-    if (all_clients != NULL) {
-        free(all_clients);
+    watch->callback = callback;
+    watch->user_data = user_data;
+    cfgmgr_change_watch_push(&cfgmgr->iface_watches, watch);
+    return 0;
+}
+
+int cfgmgr_watch_config_changes(cfgmgr_ctx_t* cfgmgr, cfgmgr_changes_callback_t callback, void* user_data) {
+    LOG_DEBUG("In %s function", __func__);
+    if (callback == NULL) {
+        LOG_ERROR_0("Callback is NULL");
+        return -1;
     }
-    if (server_secret_key_cvt != NULL) {
-        config_value_destroy(server_secret_key_cvt);
+    struct cfgmgr_change_watch* watch = (struct cfgmgr_change_watch*) calloc(
+            1, sizeof(struct cfgmgr_change_watch));
+    if (watch == NULL) {
+        LOG_ERROR_0("Calloc failed for config changes watch");
+        return -1;
     }
-    if (server_topic_cvt != NULL) {
-        free(server_topic_cvt);
+    // Changes are watched once loaded
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_CONFIG) != 0) {
+        LOG_ERROR_0("Failed to load the app config");
+        free(watch);
+        return -1;
     }
-    return c_json;
+    watch->callback = callback;
+    watch->user_data = user_data;
+    cfgmgr_change_watch_push(&cfgmgr->config_watches, watch);
+    return 0;
 }
 
-config_t* cfgmgr_get_msgbus_config_client(cfgmgr_interface_t* ctx) {
-    LOG_DEBUG("In %s function", __func__);
-    // Initializing base_cfg variables
-    config_value_t* cli_config = ctx->interface;
-    char* app_name = ctx->cfg_mgr->app_name;
-    int dev_mode = ctx->cfg_mgr->dev_mode;
-    kv_store_client_t* kv_store_client = ctx->cfg_mgr->kv_store_client;
-    void* kv_store_handle = ctx->cfg_mgr->kv_store_handle;
-    config_t* m_config = NULL;
-    config_value_t* server_appname = NULL;
-    config_value_t* zmq_recv_hwm_value = NULL;
-    config_value_t* client_endpoint = NULL;
-    config_value_t* client_config_type = NULL;
-    char** host_port = NULL;
-    char* host = NULL;
-    char* port = NULL;
-    char* s_client_pri_key = NULL;
-    char* s_client_public_key = NULL;
-    char* retreive_server_pub_key = NULL;
-    char* sub_public_key = NULL;
-    char* sub_pri_key = NULL;
-    char* type_override_env = NULL;
-    char* type_override = NULL;
-    char* ep_override_env = NULL;
-    char* config_value = NULL;
-    config_t* c_json = NULL;
-    config_value_t* client_name = NULL;
-    config_value_t* type_cvt = NULL;
-    config_t* client_topic = NULL;
-    config_value_t* zmq_tcp_host = NULL;
-    config_value_t* zmq_tcp_port = NULL;
-    config_value_t* server_public_key_cvt = NULL;
-    config_value_t* client_public_key_cvt = NULL;
-    config_value_t* sub_pri_key_cvt = NULL;
-    config_value_t* client_topic_cvt = NULL;
-    config_value_t* type_value = NULL;
-    config_value_t* client_data = NULL;
-    config_value_t* zmq_tcp_client_port = NULL;
-    config_value_t* zmq_tcp_client_host = NULL;
-
-    // Creating the final config object
-    c_json = json_config_new_from_buffer("{}");
-    if (c_json == NULL) {
-        LOG_ERROR_0("Error creating c_json object");
-        goto err;
+cfgmgr_snapshot_guard_t cfgmgr_acquire_snapshot(cfgmgr_ctx_t* cfgmgr) {
+    if (cfgmgr_load(cfgmgr, CFGMGR_LOAD_INTERFACES | CFGMGR_LOAD_CONFIG) != 0) {
+        LOG_ERROR_0("Failed to load the app config and interfaces");
     }
+    return cfgmgr_snapshots_pin(cfgmgr->snapshots);
+}
 
-    // Fetching name from config
-    client_name = config_value_object_get(cli_config, NAME);
-    if (client_name == NULL || client_name->body.string == NULL) {
-        LOG_ERROR_0("client_name initialization failed");
-        goto err;
-    }
+void cfgmgr_release_snapshot(cfgmgr_ctx_t* cfgmgr, cfgmgr_snapshot_guard_t* guard) {
+    cfgmgr_snapshots_unpin(cfgmgr->snapshots, guard);
+}
 
-    // Fetching Type from config
-    client_config_type = config_value_object_get(cli_config, TYPE);
-    if (client_config_type == NULL || client_config_type->body.string == NULL) {
-        LOG_ERROR_0("client_config_type object initialization failed");
-        goto err;
-    }
+static void cfgmgr_keys_watch_cb(const char* key, config_t* value, void* user_data) {
+    cfgmgr_ctx_t* cfgmgr = (cfgmgr_ctx_t*) user_data;
+    LOG_DEBUG("%s changed, invalidating msgbus configs", key);
+    cfgmgr_msgbus_cache_invalidate(cfgmgr->msgbus_cache);
+    config_destroy(value);
+}
 
-    if(client_config_type->type != CVT_STRING || client_config_type->body.string == NULL){
-        LOG_ERROR_0("client_config_type type mismatch or the string value is NULL");
-        goto err;
-    }
+static void cfgmgr_private_key_watch_cb(const char* key, config_t* value, void* user_data) {
+    cfgmgr_key_watches_notify((cfgmgr_ctx_t*) user_data, CFGMGR_LOAD_KEYS, key, value);
+    cfgmgr_keys_watch_cb(key, value, user_data);
+}
 
-    char* type = client_config_type->body.string;
+static void cfgmgr_public_keys_cb(const char* app_name, const char* public_key, void* user_data) {
+    cfgmgr_ctx_t* cfgmgr = (cfgmgr_ctx_t*) user_data;
+    LOG_DEBUG("Public key of %s %s, invalidating msgbus configs", app_name,
+              (public_key != NULL) ? "changed" : "removed");
+    cfgmgr_msgbus_cache_invalidate(cfgmgr->msgbus_cache);
+}
 
-    // Fetching EndPoint from config
-    client_endpoint = config_value_object_get(cli_config, ENDPOINT);
-    if (client_endpoint == NULL) {
-        LOG_ERROR_0("client_endpoint object initialization failed");
+// Wraps the kv_store client with the warm-start snapshot at @p path, the
+// values under /<AppName>/private_key are only recorded when a key from
+// CONFIGMGR_SNAPSHOT_KEY_FILE encrypts the snapshot
+static int cfgmgr_warm_wrap(kv_store_client_t** kv_store_client, const char* path) {
+    unsigned char key[KV_STORE_WARM_KEY_SIZE];
+    bool encrypted = false;
+    char* scope = NULL;
+    char* secrets = NULL;
+    int ret_val = -1;
+
+    char* app_name_var = getenv("AppName");
+    if (app_name_var == NULL) {
+        LOG_ERROR_0("AppName env not set");
         goto err;
     }
-    char* end_point = client_endpoint->body.string;
-
-    // Overriding endpoint with CLIENT_<Name>_ENDPOINT if set
-    size_t init_len = strlen("CLIENT_") + strlen(client_name->body.string) + strlen("_ENDPOINT") + 2;
-    ep_override_env = concat_s(init_len, 3, "CLIENT_", client_name->body.string, "_ENDPOINT");
-    if (ep_override_env == NULL) {
-        LOG_ERROR_0("concatenation for ep_override_env failed");
+    scope = strdup(app_name_var);
+    if (scope == NULL) {
+        LOG_ERROR_0("Failed to copy AppName");
         goto err;
     }
-    char client_ep[MAX_ENDPOINT_LENGTH] = "";
-    char* ep_override = getenv(ep_override_env);
-    if (ep_override != NULL) {
-
-        int ret = strncpy_s(client_ep, MAX_ENDPOINT_LENGTH + 1,
-                        ep_override, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR("failed to copy CLIENT_%s_ENDPOINT env value", client_name->body.string);
+    trim(scope);
+    size_t init_len = strlen("/") + strlen(scope) + strlen(PRIVATE_KEY) + 1;
+    secrets = concat_s(init_len, 3, "/", scope, PRIVATE_KEY);
+    if (secrets == NULL) {
+        LOG_ERROR_0("concatenation PRIVATE_KEY and appname string failed");
+        goto err;
+    }
+    char* key_file = getenv("CONFIGMGR_SNAPSHOT_KEY_FILE");
+    if (key_file != NULL && strlen(key_file) != 0) {
+        if (kv_store_warm_read_key(key_file, key) != 0) {
             goto err;
         }
-
-        if (strlen(client_ep) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", ep_override_env);
-            end_point = client_ep;
-        }
-    } else {
-        LOG_DEBUG("env not set for overridding %s, and hence endpoint taking from interface ", ep_override_env);
+        encrypted = true;
     }
+    kv_store_client_t* warm = kv_store_warm_wrap(*kv_store_client, path, scope,
+                                                 encrypted ? key : NULL, secrets);
+    if (warm == NULL) {
+        LOG_ERROR("Failed to wrap kv_store_client with the snapshot %s", path);
+        goto err;
+    }
+    *kv_store_client = warm;
 
-    // Overriding endpoint with CLIENT_ENDPOINT if set
-    // Note: This overrides all the client endpoints if set
-    char* client_ep_env = getenv("CLIENT_ENDPOINT");
-    if (client_ep_env != NULL) {
-
-        int ret = strncpy_s(client_ep, MAX_ENDPOINT_LENGTH + 1,
-                        client_ep_env, MAX_ENDPOINT_LENGTH);
-        if (ret != 0) {
-            LOG_ERROR_0("failed to copy CLIENT_ENDPOINT env value");
-            goto err;
-        }
+    // We should add all success-path code above this line
+    ret_val = 0;
 
-        LOG_DEBUG_0("Overriding endpoint with CLIENT_ENDPOINT");
-        if (strlen(client_ep) != 0) {
-            end_point = client_ep;
-        }
-    } else {
-        LOG_DEBUG_0("env not set for overridding CLIENT_ENDPOINT, and hence endpoint taking from interface ");
+err:
+    memset(key, 0, sizeof(key));
+    if (scope != NULL) {
+        free(scope);
     }
+    if (secrets != NULL) {
+        free(secrets);
+    }
+    return ret_val;
+}
 
-    // Overriding endpoint with CLIENT_<Name>_TYPE if set
-    init_len = strlen("CLIENT_") + strlen(client_name->body.string) + strlen("_TYPE") + 2;
-    type_override_env = concat_s(init_len, 3, "CLIENT_", client_name->body.string, "_TYPE");
-    if (type_override_env == NULL) {
-        LOG_ERROR_0("concatenation for type_override_env failed");
-        goto err;
+// Writes the spans recorded so far to the file CONFIGMGR_TRACE names
+static void cfgmgr_trace_write() {
+    char* trace_path = getenv("CONFIGMGR_TRACE");
+    if (trace_path == NULL || strlen(trace_path) == 0 || !cfgmgr_trace_enabled()) {
+        return;
     }
-    type_override = getenv(type_override_env);
-    if (type_override != NULL) {
-        if (strlen(type_override) != 0) {
-            LOG_DEBUG("Overriding endpoint with %s", type_override_env);
-            type = type_override;
-        }
-    } else {
-        LOG_DEBUG("env not set for overridding %s, and hence type taking from interface ", type_override_env);
+    if (cfgmgr_trace_export(trace_path) != 0) {
+        LOG_WARN("Failed to write the trace to %s", trace_path);
     }
+}
 
-    // Overriding endpoint with CLIENT_TYPE if set
-    // Note: This overrides all the client type if set
-    char* client_type = getenv("CLIENT_TYPE");
-    if (client_type != NULL) {
-        LOG_DEBUG_0("Overriding endpoint with CLIENT_TYPE");
-        if (strlen(client_type) != 0) {
-            type = client_type;
-        }
-    } else {
-        LOG_DEBUG("env not set for overridding CLIENT_TYPE, and hence type taking from interface ");
-    }
+// Sets the log level from the value of C_LOG_LEVEL, which /GlobalEnv/ may set
+static void cfgmgr_set_log_level(const char* str_log_level) {
+    log_lvl_t log_level = LOG_LVL_ERROR; // default log level is `ERROR`
 
-    type_cvt = config_value_new_string(type);
-    if (type_cvt == NULL) {
-        LOG_ERROR_0("Get type_cvt failed");
-        goto err;
-    }
-    bool config_set_result = config_set(c_json, "type", type_cvt);
-    if (!config_set_result) {
-        LOG_ERROR_0("Unable to set config value");
-        goto err;
+    if (str_log_level == NULL) {
+        LOG_ERROR_0("C_LOG_LEVEL env not set");
+    } else if (strncmp(str_log_level, "DEBUG", 5) == 0) {
+        log_level = LOG_LVL_DEBUG;
+    } else if (strncmp(str_log_level, "INFO", 5) == 0) {
+        log_level = LOG_LVL_INFO;
+    } else if (strncmp(str_log_level, "WARN", 5) == 0) {
+        log_level = LOG_LVL_WARN;
+    } else if (strncmp(str_log_level, "ERROR", 5) == 0) {
+        log_level = LOG_LVL_ERROR;
     }
+    set_log_level(log_level);
+}
 
-    // Adding zmq_recv_hwm value if available
-    zmq_recv_hwm_value = config_value_object_get(cli_config, ZMQ_RECV_HWM);
-    if (zmq_recv_hwm_value != NULL) {
-        if (zmq_recv_hwm_value->type != CVT_INTEGER) {
-            LOG_ERROR_0("zmq_recv_hwm type is not integer");
-            goto err;
-        }
+// Sets one /GlobalEnv/ entry in the environment as it is parsed
+static int cfgmgr_set_global_env(const char* key, const char* value, void* user_data) {
+    if (setenv(key, value, 1) != 0) {
+        LOG_ERROR("Failed to set env %s", key);
+        return -1;
+    }
+    return 0;
+}
 
-        config_set_result = config_set(c_json, ZMQ_RECV_HWM, zmq_recv_hwm_value);
-        if (!config_set_result) {
-            LOG_ERROR_0("Unable to set config value");
-            goto err;
-        }
+// Sets the log level from the C_LOG_LEVEL entry of /GlobalEnv/ as it is parsed
+static int cfgmgr_global_env_log_level(const char* key, const char* value, void* user_data) {
+    if (strcmp(key, "C_LOG_LEVEL") == 0) {
+        cfgmgr_set_log_level(value);
     }
+    return 0;
+}
 
-    if (!strcmp(type, "zmq_ipc")) {
-        bool ret = get_ipc_config(c_json, cli_config, end_point, CFGMGR_CLIENT);
-        if (ret == false) {
-            LOG_ERROR_0("IPC configuration for client failed");
-            return NULL;
-        }
-    } else if (!strcmp(type, "zmq_tcp")) {
+// Initializes the kv_store client and applies /GlobalEnv/
+static int cfgmgr_load_connection(cfgmgr_ctx_t* cfg_mgr) {
+    char* env_var = NULL;
+    int ret_val = -1;
 
-        // Add host & port to client_topic object
-        client_topic = json_config_new_from_buffer("{}");
-        if (client_topic == NULL) {
-            LOG_ERROR_0("client_topic object initialization failed");
+    if (cfg_mgr->kv_store_handle == NULL) {
+        cfgmgr_trace_span_t step = cfgmgr_trace_begin("cfgmgr.kv_store_init");
+        void* handle = cfg_mgr->kv_store_client->init(cfg_mgr->kv_store_client);
+        cfgmgr_trace_end(&step, NULL);
+        if (handle == NULL) {
+            LOG_ERROR_0("ConfigMgr handle initialization failed");
             goto err;
         }
-        host_port = get_host_port(end_point);
-        if (host_port == NULL) {
-            LOG_ERROR_0("Get host and port failed");
-            goto err;
+        cfg_mgr->kv_store_handle = handle;
+        if (!kv_store_mirror_active(cfg_mgr->public_keys)) {
+            cfg_mgr->public_keys = NULL;
         }
-        host = host_port[0];
-        trim(host);
-        port = host_port[1];
-        trim(port);
-        int64_t i_port = atoi(port);
-        zmq_tcp_host = config_value_new_string(host);
-        if (zmq_tcp_host == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_host failed");
-            goto err;
+    }
+
+    // Fetching GlobalEnv
+    env_var = cfg_mgr->kv_store_client->get(cfg_mgr->kv_store_handle, "/GlobalEnv/");
+    if (env_var == NULL) {
+        LOG_WARN_0("Value is not found for the key /GlobalEnv/,"
+                   " continuing without setting GlobalEnv vars");
+    } else {
+        // /GlobalEnv/ is validated first so that no variable is set from
+        // an invalid document, then streamed into the environment entry by
+        // entry without building a cJSON tree of it
+        cfgmgr_trace_span_t step = cfgmgr_trace_begin("cfgmgr.parse_global_env");
+        size_t env_len = strlen(env_var);
+        int env_vars_count = cfgmgr_json_each_member(env_var, env_len, NULL, NULL);
+        // Contexts baking bundles leave the environment of the baker as
+        // is. Lazy contexts may be connected while other threads call
+        // getenv(), so they keep /GlobalEnv/ in the env overrides below
+        if (env_vars_count >= 0 && !cfg_mgr->baking && !cfg_mgr->lazy) {
+            env_vars_count = cfgmgr_json_each_member(env_var, env_len, cfgmgr_set_global_env, NULL);
+        } else if (env_vars_count >= 0 && cfg_mgr->lazy) {
+            env_vars_count = cfgmgr_json_each_member(env_var, env_len, cfgmgr_global_env_log_level,
+                                                     NULL);
         }
-        zmq_tcp_port = config_value_new_integer(i_port);
-        if (zmq_tcp_port == NULL) {
-            LOG_ERROR_0("Get zmq_tcp_port failed");
+        cfgmgr_trace_end(&step, NULL);
+        if (env_vars_count < 0) {
+            LOG_ERROR_0("Failed to apply /GlobalEnv/");
             goto err;
         }
-        config_set_result = config_set(client_topic, "host", zmq_tcp_host);
-        if (!config_set_result) {
-            LOG_ERROR_0("Unable to set config value");
+    }
+    if (!cfg_mgr->lazy) {
+        cfgmgr_set_log_level(getenv("C_LOG_LEVEL"));
+    }
+    // With CONFIGMGR_LAZY the overrides were scanned at initialization,
+    // /GlobalEnv/ is kept on top of them
+    if (env_var != NULL && cfg_mgr->env_overrides != NULL) {
+        if (cfgmgr_env_overrides_load_global_env(cfg_mgr->env_overrides, env_var) != 0) {
+            LOG_ERROR_0("Failed to load env overrides set by /GlobalEnv/");
             goto err;
         }
-        config_set_result = config_set(client_topic, "port", zmq_tcp_port);
-        if (!config_set_result) {
-            LOG_ERROR_0("Unable to set config value");
-            goto err;
+        if (cfg_mgr->msgbus_cache != NULL) {
+            cfgmgr_msgbus_cache_invalidate(cfg_mgr->msgbus_cache);
         }
+    }
+    cfg_mgr->env_var = env_var;
+    env_var = NULL;
 
-        if (dev_mode != 0) {
-            LOG_DEBUG_0("Running in Prod Mode...");
-
-            // Fetching Server AppName from config
-            server_appname = config_value_object_get(cli_config, SERVER_APPNAME);
-            if (server_appname == NULL) {
-                LOG_ERROR_0("server_appname object initialization failed");
-                goto err;
-            }
-
-            if (server_appname->type != CVT_STRING || server_appname->body.string == NULL) {
-                LOG_ERROR_0("server_appname type miss match, it should be string or srting value is NULL");
-                goto err;
-            }
-
-            // Adding server public key to config
-            size_t init_len = strlen(PUBLIC_KEYS) + strlen(server_appname->body.string) + 2;
-            retreive_server_pub_key = concat_s(init_len, 2, PUBLIC_KEYS, server_appname->body.string);
-            if (retreive_server_pub_key == NULL) {
-                LOG_ERROR_0("concatenation PUBLIC_KEYS and server_appname string failed");
-                goto err;
-            }
-            char* server_public_key = kv_store_client->get(kv_store_handle, retreive_server_pub_key);
-            if(server_public_key == NULL){
-                LOG_DEBUG("Value is not found for the key: %s", retreive_server_pub_key);
-            } else {
-                server_public_key_cvt = config_value_new_string(server_public_key);
-                if (server_public_key_cvt == NULL) {
-                    LOG_ERROR_0("Get server_secret_key_cvt failed");
-                    goto err;
-                }
-                config_set_result = config_set(client_topic, "server_public_key", server_public_key_cvt);
-                if (!config_set_result) {
-                    LOG_ERROR("Unable to set config value");
-                }
+    // We should add all success-path code above this line
+    ret_val = 0;
 
-                // free server_pub_key
-                if (server_public_key != NULL) {
-                    free(server_public_key);
-                }
-            }
+err:
+    if (env_var != NULL) {
+        free(env_var);
+    }
+    return ret_val;
+}
 
-            // Adding client public key to config
-            init_len = strlen(PUBLIC_KEYS) + strlen(app_name) + strlen(app_name) + 2;
-            s_client_public_key = concat_s(init_len, 2, PUBLIC_KEYS, app_name);
-            if (s_client_public_key == NULL) {
-                LOG_ERROR_0("concatenation PUBLIC_KEYS and appname string failed");
-                goto err;
-            }
-            sub_public_key = kv_store_client->get(kv_store_handle, s_client_public_key);
-            if(sub_public_key == NULL){
-                LOG_ERROR("Value is not found for the key: %s", s_client_public_key);
-                goto err;
-            }
+// Fetches and indexes /<AppName>/interfaces, then rebuilds the index
+// whenever it changes
+static int cfgmgr_load_interfaces(cfgmgr_ctx_t* cfg_mgr) {
+    char* interface_char = NULL;
+    char* interface = NULL;
+    config_t* app_interface = NULL;
+    int ret_val = -1;
 
-            client_public_key_cvt = config_value_new_string(sub_public_key);
-            if (client_public_key_cvt == NULL) {
-                LOG_ERROR_0("Get client_public_key_cvt failed");
-                goto err;
-            }
-            config_set_result = config_set(client_topic, "client_public_key", client_public_key_cvt);
-            if (!config_set_result) {
-                LOG_ERROR_0("Unable to set config value");
-                goto err;
-            }
+    size_t init_len = strlen("/") + strlen(cfg_mgr->app_name) + strlen("/interfaces") + 1;
+    interface_char = concat_s(init_len, 3, "/", cfg_mgr->app_name, "/interfaces");
+    if (interface_char == NULL){
+        LOG_ERROR_0("Concatenation of /appname and /interfaces failed");
+        goto err;
+    }
+    LOG_DEBUG("interface_char: %s", interface_char);
 
-            // Adding client private key to config
-            init_len = strlen("/") + strlen(app_name) + strlen(PRIVATE_KEY) + 2;
-            s_client_pri_key = concat_s(init_len, 3, "/", app_name, PRIVATE_KEY);
-            if (s_client_pri_key == NULL) {
-                LOG_ERROR_0("concatenation PRIVATE_KEY and appname string failed");
-                goto err;
-            }
-            sub_pri_key = kv_store_client->get(kv_store_handle, s_client_pri_key);
-            if(sub_pri_key == NULL){
-                LOG_ERROR("Value is not found for the key: %s", s_client_pri_key);
-                goto err;
-            }
+    interface = cfg_mgr->kv_store_client->get(cfg_mgr->kv_store_handle, interface_char);
+    if (interface == NULL) {
+        LOG_ERROR("Failed to fetch value for the key: %s", interface_char);
+        goto err;
+    }
 
-            sub_pri_key_cvt = config_value_new_string(sub_pri_key);
-            if (sub_pri_key_cvt == NULL) {
-                LOG_ERROR_0("Get sub_pri_key_cvt failed");
-                goto err;
-            }
-            config_set_result = config_set(client_topic, "client_secret_key", sub_pri_key_cvt);
-            if (!config_set_result) {
-                LOG_ERROR_0("Unable to set config value");
-                goto err;
-            }
-        } else {
-            LOG_DEBUG_0("Running in Dev Mode...");
-        }
-        client_topic_cvt = config_value_new_object(client_topic->cfg, get_config_value, NULL);
-        if (client_topic_cvt == NULL) {
-            LOG_ERROR_0("Unable to create config_value_t client_topic_cvt object");
-            goto err;
-        }
-        // Creating the final config object
-        config_set_result = config_set(c_json, client_name->body.string, client_topic_cvt);
-        if (!config_set_result) {
-            LOG_ERROR_0("Unable to set config value");
-            goto err;
-        }
-    } else {
-        LOG_ERROR_0("Type should be either \"zmq_ipc\" or \"zmq_tcp\"");
+    cfgmgr_trace_span_t step = cfgmgr_trace_begin("cfgmgr.parse_interfaces");
+    app_interface = cfgmgr_json_config_new(interface);
+    cfgmgr_trace_end(&step, interface_char);
+    if (app_interface == NULL) {
+        LOG_ERROR_0("app_interface initialization failed");
         goto err;
     }
 
-    // Extracting and printing non-secret data from the config
-    type_value = c_json->get_config_value(c_json->cfg, "type");
-    if (type_value == NULL) {
-        LOG_ERROR_0("\"type\" key is missing in the config");
-        c_json = NULL;
+    // On success the index owns app_interface
+    step = cfgmgr_trace_begin("cfgmgr.index_interfaces");
+    int indexed = cfgmgr_iface_index_update(cfg_mgr->iface_index, app_interface);
+    cfgmgr_trace_end(&step, NULL);
+    if (indexed != 0) {
+        LOG_ERROR_0("Failed to index app_interface");
         goto err;
-    } else if (type_value->type != CVT_STRING) {
-        LOG_ERROR_0("\"type\" value has to be of string type");
-        c_json = NULL;
+    }
+    app_interface = NULL;
+    // Held until the index is destroyed, whatever is handed out later
+    cfg_mgr->app_interface = cfgmgr_iface_index_acquire_interfaces(cfg_mgr->iface_index);
+    if (cfgmgr_publish_interfaces(cfg_mgr) != 0) {
+        LOG_ERROR("Failed to publish snapshot of %s", interface_char);
         goto err;
     }
-    if (!strcmp(type_value->body.string, "zmq_ipc")) {
-        config_value = configt_to_char(c_json);
-        if (config_value == NULL) {
-            LOG_ERROR_0("config_value_cr initialization failed");
-            c_json = NULL;
-            goto err;
-        }
-        LOG_DEBUG("Env Client Config is : %s \n", config_value);
-    } else {
-        client_data = c_json->get_config_value(c_json->cfg, client_name->body.string);
-        if (client_data == NULL) {
-            LOG_ERROR("\"name\" key is missing in the config");
-            c_json = NULL;
-            goto err;
-        } else {
-            zmq_tcp_client_host = config_value_object_get(client_data,
-                                                                        "host");
-            if ( zmq_tcp_client_host == NULL ) {
-                LOG_ERROR_0("Client \"host\" key missing");
-                c_json = NULL;
-                goto err;
-            }
-            if (zmq_tcp_client_host->type != CVT_STRING) {
-                LOG_ERROR_0("Client \"host\" value has to be of string type");
-                c_json = NULL;
-                goto err;
-            }
-            zmq_tcp_client_port = config_value_object_get(client_data,
-                                                                        "port");
-            if ( zmq_tcp_client_port == NULL ) {
-                LOG_ERROR_0("Client \"port\" key missing");
-                c_json = NULL;
-                goto err;
-            }
-            if (zmq_tcp_client_port->type != CVT_INTEGER) {
-                LOG_ERROR_0("Client \"port\" value has to be of integer type");
-                c_json = NULL;
-                goto err;
-            }
-        }
 
-        LOG_DEBUG("\n Env Client Config is : \n Type : %s \n ClientName : %s \n Host : %s \n Port : %d \n", \
-                   type_value->body.string, \
-                   client_name->body.string, \
-                   zmq_tcp_client_host->body.string, \
-                   zmq_tcp_client_port->body.integer);
-    }
+    // Rebuilding the interface index whenever /<AppName>/interfaces changes
+    cfg_mgr->kv_store_client->watch(cfg_mgr->kv_store_handle, interface_char,
+                                    cfgmgr_interfaces_watch_cb, cfg_mgr);
+
+    // We should add all success-path code above this line
+    ret_val = 0;
 
 err:
-    if (type_value != NULL) {
-        config_value_destroy(type_value);
-    }
-    if (client_data  != NULL) {
-        config_value_destroy(client_data);
-    }
-    if (zmq_tcp_client_port != NULL) {
-        config_value_destroy(zmq_tcp_client_port);
-    }
-    if (zmq_tcp_client_host != NULL) {
-        config_value_destroy(zmq_tcp_client_host);
-    }
-    if (s_client_pri_key != NULL) {
-        free(s_client_pri_key);
-    }
-    if (s_client_public_key != NULL) {
-        free(s_client_public_key);
-    }
-    if (retreive_server_pub_key != NULL) {
-        free(retreive_server_pub_key);
-    }
-    if (sub_public_key != NULL) {
-        free(sub_public_key);
-    }
-    if (sub_pri_key != NULL) {
-        free(sub_pri_key);
-    }
-    if (config_value != NULL) {
-        free(config_value);
-    }
-    if (host_port != NULL) {
-        free_mem(host_port);
-    }
-    if (client_config_type != NULL) {
-        config_value_destroy(client_config_type);
-    }
-    if (client_endpoint  != NULL) {
-        config_value_destroy(client_endpoint);
-    }
-    if (client_name != NULL) {
-        config_value_destroy(client_name);
-    }
-    if (ep_override_env != NULL) {
-        free(ep_override_env);
-    }
-    if (type_override_env != NULL) {
-        free(type_override_env);
-    }
-    if (zmq_recv_hwm_value != NULL) {
-        config_value_destroy(zmq_recv_hwm_value);
-    }
-    if (server_appname != NULL) {
-        config_value_destroy(server_appname);
-    }
-    if (type_cvt != NULL) {
-        config_value_destroy(type_cvt);
-    }
-    if (client_topic != NULL) {
-        free(client_topic);
-    }
-    if (zmq_tcp_host != NULL) {
-        config_value_destroy(zmq_tcp_host);
-    }
-    if (zmq_tcp_port != NULL) {
-        config_value_destroy(zmq_tcp_port);
+    if (interface_char != NULL) {
+        free(interface_char);
     }
-    if (server_public_key_cvt != NULL) {
-        config_value_destroy(server_public_key_cvt);
+    if (interface != NULL) {
+        free(interface);
     }
-    if (client_public_key_cvt != NULL) {
-        config_value_destroy(client_public_key_cvt);
+    if (app_interface != NULL) {
+        config_destroy(app_interface);
     }
-    if (sub_pri_key_cvt != NULL) {
-        config_value_destroy(sub_pri_key_cvt);
+    return ret_val;
+}
+
+// Fetches /<AppName>/config, then publishes a new snapshot whenever it
+// changes
+static int cfgmgr_load_config(cfgmgr_ctx_t* cfg_mgr) {
+    char* config_char = NULL;
+    char* value = NULL;
+    config_t* app_config = NULL;
+    int ret_val = -1;
+
+    size_t init_len = strlen("/") + strlen(cfg_mgr->app_name) + strlen("/config") + 1;
+    config_char = concat_s(init_len, 3, "/", cfg_mgr->app_name, "/config");
+    if (config_char == NULL) {
+        LOG_ERROR_0("Concatenation of /appname and /config failed");
+        goto err;
     }
-    if (client_topic_cvt != NULL) {
-        config_value_destroy(client_topic_cvt);
+    LOG_DEBUG("config_char: %s", config_char);
+
+    value = cfg_mgr->kv_store_client->get(cfg_mgr->kv_store_handle, config_char);
+    if (value == NULL) {
+        LOG_ERROR("Failed to fetch value for the key: %s", config_char);
+        goto err;
     }
-    return c_json;
-}
 
-config_t* cfgmgr_get_msgbus_config(cfgmgr_interface_t* ctx) {
-    LOG_DEBUG("In %s function", __func__);
-    config_t* config;
-    if (ctx->type == CFGMGR_PUBLISHER) {
-        config = cfgmgr_get_msgbus_config_pub(ctx);
-    } else if (ctx->type == CFGMGR_SUBSCRIBER) {
-        config = cfgmgr_get_msgbus_config_sub(ctx);
-    } else if (ctx->type == CFGMGR_SERVER) {
-        config = cfgmgr_get_msgbus_config_server(ctx);
-    } else if (ctx->type == CFGMGR_CLIENT) {
-        config = cfgmgr_get_msgbus_config_client(ctx);
-    } else {
-        LOG_ERROR_0("Interface type not supported");
-        return NULL;
+    cfgmgr_trace_span_t step = cfgmgr_trace_begin("cfgmgr.parse_config");
+    app_config = cfgmgr_json_config_new(value);
+    cfgmgr_trace_end(&step, config_char);
+    if (app_config == NULL) {
+        LOG_ERROR_0("app_config initialization failed");
+        goto err;
     }
-    return config;
-}
 
-bool cfgmgr_is_dev_mode(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    // Fetching dev mode from cfgmgr
-    int result = cfgmgr->dev_mode;
-    if (result == 0) {
-        return true;
+    // On success the snapshots own app_config
+    if (cfgmgr_snapshots_publish(cfg_mgr->snapshots, app_config, NULL) != 0) {
+        LOG_ERROR("Failed to publish snapshot of %s", config_char);
+        goto err;
     }
-    return false;
-}
+    app_config = NULL;
+    // Held until the snapshots are destroyed, whatever is handed out later
+    cfg_mgr->app_config = cfgmgr_snapshots_acquire_config(cfg_mgr->snapshots);
 
-config_value_t* cfgmgr_get_appname(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    // Fetching app name from cfgmgr
-    config_value_t* app_name = config_value_new_string(cfgmgr->app_name);
-    if (app_name == NULL) {
-        LOG_ERROR_0("Fetching appname failed");
-        return NULL;
+    // Publishing a new snapshot whenever /<AppName>/config changes
+    cfg_mgr->kv_store_client->watch(cfg_mgr->kv_store_handle, config_char,
+                                    cfgmgr_config_watch_cb, cfg_mgr);
+
+    // We should add all success-path code above this line
+    ret_val = 0;
+
+err:
+    if (config_char != NULL) {
+        free(config_char);
+    }
+    if (value != NULL) {
+        free(value);
     }
-    return app_name;
+    if (app_config != NULL) {
+        config_destroy(app_config);
+    }
+    return ret_val;
 }
 
-int cfgmgr_get_num_elements(config_t* config, const char* key) {
-    LOG_DEBUG("In %s function", __func__);
-    // Fetching list of interface elements
-    config_value_t* interfaces = config_get(config, key);
-    if (interfaces == NULL) {
-        LOG_ERROR_0("Failed to fetch number of elements in interface");
-        return -1;
+// Invalidates msgbus configs whenever the keys they embed change, only
+// needed in prod mode
+static int cfgmgr_load_keys(cfgmgr_ctx_t* cfg_mgr) {
+    if (cfg_mgr->dev_mode == 0) {
+        return 0;
     }
-    if (interfaces->type != CVT_ARRAY) {
-        LOG_ERROR("%s interface is not an array type", key);
+    size_t init_len = strlen("/") + strlen(cfg_mgr->app_name) + strlen(PRIVATE_KEY) + 2;
+    char* private_key_char = concat_s(init_len, 3, "/", cfg_mgr->app_name, PRIVATE_KEY);
+    if (private_key_char == NULL) {
+        LOG_ERROR_0("concatenation PRIVATE_KEY and appname string failed");
         return -1;
     }
-    int result = config_value_array_len(interfaces);
-    config_value_destroy(interfaces);
-    return result;
+    if (cfg_mgr->public_keys != NULL) {
+        // The mirror already watches /Publickeys/, deletes included
+        kv_store_mirror_listen(cfg_mgr->public_keys, cfgmgr_public_keys_cb, cfg_mgr);
+    } else {
+        cfg_mgr->kv_store_client->watch_prefix(cfg_mgr->kv_store_handle, PUBLIC_KEYS,
+                                               cfgmgr_keys_watch_cb, cfg_mgr);
+    }
+    cfg_mgr->kv_store_client->watch(cfg_mgr->kv_store_handle, private_key_char,
+                                    cfgmgr_private_key_watch_cb, cfg_mgr);
+    free(private_key_char);
+    return 0;
 }
 
-int cfgmgr_get_num_publishers(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    int result = cfgmgr_get_num_elements(cfgmgr->app_interface, PUBLISHERS);
-    return result;
+// Loads the parts of the context in @p parts which are not loaded yet,
+// each at most once. Every part needs the connection.
+static int cfgmgr_load(cfgmgr_ctx_t* cfgmgr, int parts) {
+    static const struct {
+        int part;
+        int (*load)(cfgmgr_ctx_t*);
+    } loaders[] = {
+        { CFGMGR_LOAD_CONNECTION, cfgmgr_load_connection },
+        { CFGMGR_LOAD_INTERFACES, cfgmgr_load_interfaces },
+        { CFGMGR_LOAD_CONFIG, cfgmgr_load_config },
+        { CFGMGR_LOAD_KEYS, cfgmgr_load_keys },
+    };
+    parts |= CFGMGR_LOAD_CONNECTION;
+    if ((__atomic_load_n(&cfgmgr->loaded, __ATOMIC_ACQUIRE) & parts) == parts) {
+        return 0;
+    }
+    int ret_val = 0;
+    pthread_mutex_lock(&cfgmgr->load_mtx);
+    for (size_t i = 0; i < sizeof(loaders) / sizeof(loaders[0]); i++) {
+        if ((parts & loaders[i].part) == 0 || (cfgmgr->loaded & loaders[i].part) != 0) {
+            continue;
+        }
+        // Failed parts are loaded again by the next call needing them
+        if (loaders[i].load(cfgmgr) != 0) {
+            ret_val = -1;
+            break;
+        }
+        __atomic_or_fetch(&cfgmgr->loaded, loaders[i].part, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&cfgmgr->load_mtx);
+    return ret_val;
 }
 
-int cfgmgr_get_num_subscribers(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    int result = cfgmgr_get_num_elements(cfgmgr->app_interface, SUBSCRIBERS);
-    return result;
-}
+// Creates the kv_store client reading the kv_store KVStore names, wrapped as
+// the CONFIGMGR_* variables request
+static kv_store_client_t* cfgmgr_kv_store_client_new(bool prod, kv_store_client_t** public_keys) {
+    kv_store_client_t* kv_store_client = NULL;
+    config_t* kv_store_config = NULL;
+    cfgmgr_trace_span_t step;
 
-int cfgmgr_get_num_servers(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    int result = cfgmgr_get_num_elements(cfgmgr->app_interface, SERVERS);
-    return result;
-}
+    step = cfgmgr_trace_begin("cfgmgr.kv_store_config");
+    kv_store_config = create_kv_store_config();
+    cfgmgr_trace_end(&step, NULL);
+    if (kv_store_config == NULL) {
+        LOG_ERROR_0("kv_store_config initialization failed");
+        goto err;
+    }
+    // Creating kv store client instance
+    kv_store_client = create_kv_client(kv_store_config);
+    if (kv_store_client == NULL) {
+        LOG_ERROR_0("kv_store_client is NULL");
+        goto err;
+    }
+    // Injecting faults into kv store client if requested, applied before
+    // the metrics decorator so that injected latency is recorded
+    char* kv_faults_env = getenv("CONFIGMGR_KV_FAULTS");
+    if (kv_faults_env != NULL && strlen(kv_faults_env) != 0) {
+        kv_fault_config_t fault_config;
+        if (kv_store_fault_parse(kv_faults_env, &fault_config) != 0) {
+            LOG_ERROR("Invalid CONFIGMGR_KV_FAULTS: %s", kv_faults_env);
+            goto err;
+        }
+        kv_store_client_t* faulty = kv_store_fault_wrap(kv_store_client, &fault_config);
+        if (faulty == NULL) {
+            LOG_ERROR_0("Failed to wrap kv_store_client with fault injection");
+            goto err;
+        }
+        LOG_WARN_0("Fault injection enabled on kv_store_client");
+        kv_store_client = faulty;
+    }
 
-int cfgmgr_get_num_clients(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    int result = cfgmgr_get_num_elements(cfgmgr->app_interface, CLIENTS);
-    return result;
-}
+    // Sharing the keys every application reads with the other processes of
+    // the node, one of which reads them from the kv_store for all
+    char* kv_shm_env = getenv("CONFIGMGR_SHM");
+    if (kv_shm_env != NULL && strlen(kv_shm_env) != 0) {
+        char* kv_shm_prefixes = getenv("CONFIGMGR_SHM_PREFIXES");
+        if (kv_shm_prefixes == NULL || strlen(kv_shm_prefixes) == 0) {
+            kv_shm_prefixes = KV_STORE_SHM_DEFAULT_PREFIXES;
+        }
+        kv_store_client_t* shared = kv_store_shm_wrap(kv_store_client, kv_shm_env, kv_shm_prefixes);
+        if (shared == NULL) {
+            LOG_ERROR("Failed to share %s through %s", kv_shm_prefixes, kv_shm_env);
+            goto err;
+        }
+        kv_store_client = shared;
+    }
 
-config_t* cfgmgr_get_app_config(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    return cfgmgr->app_config;
-}
+    // Starting from the keys the last run read, recorded in a snapshot file
+    // which is reconciled with the kv_store in the background
+    char* kv_snapshot_env = getenv("CONFIGMGR_SNAPSHOT_FILE");
+    if (kv_snapshot_env != NULL && strlen(kv_snapshot_env) != 0) {
+        if (cfgmgr_warm_wrap(&kv_store_client, kv_snapshot_env) != 0) {
+            goto err;
+        }
+    }
 
-config_t* cfgmgr_get_app_interface(cfgmgr_ctx_t* cfgmgr) {
-    LOG_DEBUG("In %s function", __func__);
-    return cfgmgr->app_interface;
-}
+    // Keeping every public key in memory in prod mode, so that msgbus configs
+    // allowing any client don't read all of /Publickeys/ on every build
+    if (prod) {
+        kv_store_client_t* mirrored = kv_store_mirror_wrap(kv_store_client, PUBLIC_KEYS);
+        if (mirrored == NULL) {
+            LOG_ERROR_0("Failed to wrap kv_store_client with the public keys mirror");
+            goto err;
+        }
+        kv_store_client = mirrored;
+        *public_keys = mirrored;
+    }
 
-config_value_t* cfgmgr_get_app_config_value(cfgmgr_ctx_t* cfgmgr, const char* key) {
-    LOG_DEBUG("In %s function", __func__);
-    return cfgmgr->app_config->get_config_value(cfgmgr->app_config->cfg, key);
-}
+    config_destroy(kv_store_config);
+    return kv_store_client;
 
-config_value_t* cfgmgr_get_app_interface_value(cfgmgr_ctx_t* cfgmgr, const char* key) {
-    LOG_DEBUG("In %s function", __func__);
-    return cfgmgr->app_interface->get_config_value(cfgmgr->app_interface->cfg, key);
+err:
+    if (kv_store_client != NULL) {
+        kv_client_free(kv_store_client);
+    }
+    if (kv_store_config != NULL) {
+        config_destroy(kv_store_config);
+    }
+    *public_keys = NULL;
+    return NULL;
 }
 
-config_value_t* cfgmgr_get_interface_value(cfgmgr_interface_t* cfgmgr_interface, const char* key) {
-    LOG_DEBUG("In %s function", __func__);
-    config_value_t* interface_value = config_value_object_get(cfgmgr_interface->interface, key);
-    return interface_value;
+// Caches the msgbus configs baked in @p bundle, but those of interfaces an
+// env override applies to, which are built from the baked keys instead
+static void cfgmgr_prefill_msgbus_configs(cfgmgr_ctx_t* cfg_mgr, const cfgmgr_bundle_t* bundle) {
+    const cfgmgr_iface_type_t types[] = {
+        CFGMGR_PUBLISHER, CFGMGR_SUBSCRIBER, CFGMGR_SERVER, CFGMGR_CLIENT
+    };
+    int prefilled = 0;
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        int count = cfgmgr_iface_index_count(cfg_mgr->iface_index, types[t]);
+        for (int i = 0; i < count; i++) {
+            cfgmgr_interface_t* iface = cfgmgr_get_interface_by_index(cfg_mgr, i, types[t]);
+            if (iface == NULL) {
+                continue;
+            }
+            const char* name = (iface->model != NULL) ? iface->model->name : NULL;
+            bool overridden = false;
+            cfgmgr_gen_guard_t guard = cfgmgr_env_overrides_pin(cfg_mgr->env_overrides);
+            for (int field = CFGMGR_OVERRIDE_ENDPOINT; field <= CFGMGR_OVERRIDE_TYPE; field++) {
+                if ((name != NULL && cfgmgr_env_overrides_get(cfg_mgr->env_overrides, types[t], name,
+                                                              (cfgmgr_override_field_t) field) != NULL) ||
+                        cfgmgr_env_overrides_get(cfg_mgr->env_overrides, types[t], NULL,
+                                                 (cfgmgr_override_field_t) field) != NULL) {
+                    overridden = true;
+                }
+            }
+            cfgmgr_env_overrides_unpin(cfg_mgr->env_overrides, &guard);
+            const void* key = cfgmgr_msgbus_cache_key(iface);
+            config_t* baked = (overridden || key == NULL) ? NULL :
+                cfgmgr_bundle_msgbus_config(bundle, cfg_mgr->app_name, types[t], i);
+            if (baked != NULL) {
+                uint64_t epoch = 0;
+                config_t* cached = cfgmgr_msgbus_cache_get(cfg_mgr->msgbus_cache, key, &epoch);
+                if (cached != NULL) {
+                    config_destroy(cached);
+                } else {
+                    cfgmgr_msgbus_cache_put(cfg_mgr->msgbus_cache, key, epoch, baked);
+                    prefilled++;
+                }
+                config_destroy(baked);
+            }
+            cfgmgr_interface_destroy(iface);
+        }
+    }
+    LOG_DEBUG("Prefilled %d baked msgbus configs", prefilled);
 }
 
-void cfgmgr_watch(cfgmgr_ctx_t* cfgmgr, const char* key, cfgmgr_watch_callback_t watch_callback, void* user_data) {
-    LOG_DEBUG("In %s function", __func__);
-    // Calling the base watch API
-    cfgmgr->kv_store_client->watch(cfgmgr->kv_store_handle, key, watch_callback, user_data);
-    return;
-}
+// Reads a bundle file, decrypted with the key of CONFIGMGR_BUNDLE_KEY_FILE
+// if set
+static cfgmgr_bundle_t* cfgmgr_read_bundle(const char* path) {
+    unsigned char key[CFGMGR_SEAL_KEY_SIZE];
+    bool encrypted = false;
 
-void cfgmgr_watch_prefix(cfgmgr_ctx_t* cfgmgr, char* prefix, cfgmgr_watch_callback_t watch_callback, void* user_data) {
-    LOG_DEBUG("In %s function", __func__);
-    // Calling the base watch_prefix API
-    cfgmgr->kv_store_client->watch_prefix(cfgmgr->kv_store_handle, prefix, watch_callback, user_data);
-    return;
+    char* key_file = getenv("CONFIGMGR_BUNDLE_KEY_FILE");
+    if (key_file != NULL && strlen(key_file) != 0) {
+        if (cfgmgr_seal_read_key(key_file, key) != 0) {
+            return NULL;
+        }
+        encrypted = true;
+    }
+    cfgmgr_bundle_t* bundle = cfgmgr_bundle_read(path, encrypted ? key : NULL);
+    cfgmgr_seal_clear_key(key);
+    return bundle;
 }
 
-cfgmgr_ctx_t* cfgmgr_initialize() {
+// Initializes the context of @p app_name, or of the AppName env, reading the
+// baked keys and msgbus configs of @p bundle, or of the CONFIGMGR_BUNDLE file,
+// if any. Contexts @p baking a bundle ignore the env overrides.
+static cfgmgr_ctx_t* cfgmgr_initialize_with(const cfgmgr_bundle_t* bundle, const char* app_name,
+                                            bool baking) {
     LOG_DEBUG("In %s function", __func__);
     int result = 0;
-    config_t* app_config = NULL;
-    char* interface = NULL;
-    config_t* app_interface = NULL;
-    char* value = NULL;
     char* c_app_name = NULL;
-    char* interface_char = NULL;
-    char* config_char = NULL;
-    char* env_var = NULL;
     kv_store_client_t* kv_store_client = NULL;
-    config_t* kv_store_config = NULL;
+    kv_store_client_t* public_keys = NULL;
+    cfgmgr_bundle_t* bundle_read = NULL;
     char dev_mode_var[MAX_MODE_LENGTH] = "";
     char* app_name_var = NULL;
+    bool lazy = false;
+    cfgmgr_trace_span_t step;
 
-    cfgmgr_ctx_t *cfg_mgr = (cfgmgr_ctx_t *)malloc(sizeof(cfgmgr_ctx_t));
+    // Tracing startup if requested, spans are written once initialized
+    char* trace_env = getenv("CONFIGMGR_TRACE");
+    if (trace_env != NULL && strlen(trace_env) != 0) {
+        cfgmgr_trace_enable(true);
+    }
+    cfgmgr_trace_span_t span = cfgmgr_trace_begin("cfgmgr_initialize");
+
+    cfgmgr_ctx_t *cfg_mgr = (cfgmgr_ctx_t *)calloc(1, sizeof(cfgmgr_ctx_t));
     if (cfg_mgr == NULL) {
         LOG_ERROR_0("Malloc failed for cfgmgr_ctx_t");
         goto err;
     }
-    // Setting app_cfg->env_var to NULL initially
-    cfg_mgr->env_var = NULL;
+    if (pthread_mutex_init(&cfg_mgr->load_mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize the load mutex");
+        free(cfg_mgr);
+        cfg_mgr = NULL;
+        goto err;
+    }
+    cfg_mgr->baking = baking;
+
+    // Connecting and fetching on first use if requested
+    char* lazy_env = getenv("CONFIGMGR_LAZY");
+    if (lazy_env != NULL && strcmp(lazy_env, "true") == 0) {
+        lazy = true;
+    }
+
+    // Reading the keys and msgbus configs baked by cfgmgr-bake if requested
+    char* bundle_env = getenv("CONFIGMGR_BUNDLE");
+    if (bundle == NULL && bundle_env != NULL && strlen(bundle_env) != 0) {
+        step = cfgmgr_trace_begin("cfgmgr.read_bundle");
+        bundle_read = cfgmgr_read_bundle(bundle_env);
+        cfgmgr_trace_end(&step, NULL);
+        if (bundle_read == NULL) {
+            LOG_ERROR("Failed to read the bundle %s", bundle_env);
+            goto err;
+        }
+        bundle = bundle_read;
+    }
+    if (bundle != NULL && lazy) {
+        LOG_DEBUG_0("Baked keys are in memory, ignoring CONFIGMGR_LAZY");
+        lazy = false;
+    }
+    cfg_mgr->lazy = lazy;
 
     // Fetching & intializing dev mode variable
     char* dev_mode_env = getenv("DEV_MODE");
@@ -2750,81 +2008,60 @@ cfgmgr_ctx_t* cfgmgr_initialize() {
 
         to_lower(dev_mode_var);
         strcmp_s(dev_mode_var, strlen(dev_mode_var), "true", &result);
+        if (bundle != NULL && (result == 0) != cfgmgr_bundle_dev_mode(bundle)) {
+            LOG_ERROR_0("DEV_MODE differs from the mode the bundle was baked in");
+            goto err;
+        }
+    } else if (bundle != NULL) {
+        // The bundle records the mode it was baked in
+        result = cfgmgr_bundle_dev_mode(bundle) ? 0 : 1;
     } else {
         LOG_ERROR_0("DEV_MODE variable not set");
         goto err;
     }
+    cfg_mgr->dev_mode = result;
 
-    kv_store_config = create_kv_store_config();
-    if (kv_store_config == NULL) {
-        LOG_ERROR_0("kv_store_config initialization failed");
-        goto err;
-    }
-    // Creating kv store client instance
-    kv_store_client = create_kv_client(kv_store_config);
-    if (kv_store_client == NULL) {
-        LOG_ERROR_0("kv_store_client is NULL");
-        goto err;
-    }
-
-    // Initializing etcd client handle
-    void *handle = kv_store_client->init(kv_store_client);
-    if (handle == NULL) {
-        LOG_ERROR_0("ConfigMgr handle initialization failed");
-        goto err;
-    }
-
-    // Fetching GlobalEnv
-    env_var = kv_store_client->get(handle, "/GlobalEnv/");
-    if (env_var == NULL) {
-        LOG_WARN_0("Value is not found for the key /GlobalEnv/,"
-                   " continuing without setting GlobalEnv vars");
+    if (bundle != NULL) {
+        // Serving the baked keys from memory, nothing is read from the
+        // kv_store and the keys don't change
+        kv_store_client = cfgmgr_bundle_kv_client(bundle);
+        if (kv_store_client == NULL) {
+            LOG_ERROR_0("Failed to create kv_store_client of the bundle");
+            goto err;
+        }
     } else {
-        // TODO: Find a way to parse a char* to iterate and fetch the
-        // key-value pairs using just config_t, not depending on cJSON
-        // Creating cJSON of /GlobalEnv/ to iterate over a loop
-        cJSON* env_json = cJSON_Parse(env_var);
-        if (env_json == NULL) {
-            LOG_ERROR("Error when parsing JSON: %s", cJSON_GetErrorPtr());
+        kv_store_client = cfgmgr_kv_store_client_new(result != 0, &public_keys);
+        if (kv_store_client == NULL) {
             goto err;
         }
-        int env_vars_count = cJSON_GetArraySize(env_json);
-        // Looping over env vars and setting them in env
-        for (int i = 0; i < env_vars_count; i++) {
-            cJSON *temp = cJSON_GetArrayItem(env_json, i);
-            int env_set = setenv(temp->string, temp->valuestring, 1);
-            if (env_set != 0) {
-                LOG_ERROR("Failed to set env %s", temp->string);
-                goto err;
-            }
+    }
+
+    // Instrumenting kv store client with metrics if enabled
+    char* kv_metrics_env = getenv("CONFIGMGR_KV_METRICS");
+    if (kv_metrics_env != NULL && strcmp(kv_metrics_env, "true") == 0) {
+        kv_store_client_t* instrumented = kv_store_metrics_wrap(kv_store_client);
+        if (instrumented == NULL) {
+            LOG_ERROR_0("Failed to instrument kv_store_client with metrics");
+            goto err;
         }
-        cJSON_Delete(env_json);
+        kv_store_client = instrumented;
     }
 
-    // Setting log level
-    char* str_log_level = NULL;
-    log_lvl_t log_level = LOG_LVL_ERROR; // default log level is `ERROR`
+    cfg_mgr->kv_store_client = kv_store_client;
+    // Set to NULL once connected unless the mirror is kept
+    cfg_mgr->public_keys = public_keys;
 
-    str_log_level = getenv("C_LOG_LEVEL");
-    if(str_log_level == NULL) {
-        LOG_ERROR_0("C_LOG_LEVEL env not set");
+    // Initializing etcd client handle and applying /GlobalEnv/
+    if (!lazy) {
+        if (cfgmgr_load(cfg_mgr, CFGMGR_LOAD_CONNECTION) != 0) {
+            goto err;
+        }
     } else {
-        if(strncmp(str_log_level, "DEBUG", 5) == 0) {
-            log_level = LOG_LVL_DEBUG;
-        } else if(strncmp(str_log_level, "INFO", 5) == 0) {
-            log_level = LOG_LVL_INFO;
-        } else if(strncmp(str_log_level, "WARN", 5) == 0) {
-            log_level = LOG_LVL_WARN;
-        } else if(strncmp(str_log_level, "ERROR", 5) == 0) {
-            log_level = LOG_LVL_ERROR;
-    }
-    set_log_level(log_level);
+        cfgmgr_set_log_level(getenv("C_LOG_LEVEL"));
     }
 
-    set_log_level(log_level);
-
     // Fetching AppName
-    app_name_var = getenv("AppName");
+    app_name_var = (app_name != NULL) ? (char*) app_name : getenv("AppName");
     if (app_name_var == NULL) {
         LOG_ERROR_0("AppName env not set");
         goto err;
@@ -2842,147 +2079,165 @@ cfgmgr_ctx_t* cfgmgr_initialize() {
     }
     LOG_DEBUG("AppName: %s", c_app_name);
     trim(c_app_name);
+    cfg_mgr->app_name = c_app_name;
+    c_app_name = NULL;
 
-    // Fetching App interfaces
-    size_t init_len = strlen("/") + strlen(c_app_name) + strlen("/interfaces") + 1;
-    interface_char = concat_s(init_len, 3, "/", c_app_name, "/interfaces");
-    if (interface_char == NULL){
-        LOG_ERROR_0("Concatenation of /appname and /interfaces failed");
+    cfg_mgr->iface_index = cfgmgr_iface_index_new();
+    if (cfg_mgr->iface_index == NULL) {
+        LOG_ERROR_0("Interface index initialization failed");
         goto err;
     }
 
-    // Fetching App config
-    init_len = strlen("/") + strlen(c_app_name) + strlen("/config") + 1;
-    config_char = concat_s(init_len, 3, "/", c_app_name, "/config");
-    if (config_char == NULL) {
-        LOG_ERROR_0("Concatenation of /appname and /config failed");
+    // Config and interfaces are published once loaded
+    cfg_mgr->snapshots = cfgmgr_snapshots_new(NULL, NULL);
+    if (cfg_mgr->snapshots == NULL) {
+        LOG_ERROR_0("Snapshots initialization failed");
         goto err;
     }
+    cfgmgr_snapshots_set_interface_release(cfg_mgr->snapshots, cfgmgr_snapshot_interface_release,
+                                           cfg_mgr->iface_index);
 
-    LOG_DEBUG("interface_char: %s", interface_char);
-    LOG_DEBUG("config_char: %s", config_char);
-
-    interface = kv_store_client->get(handle, interface_char);
-    if (interface == NULL) {
-        LOG_ERROR("Failed to fetch value for the key: %s", interface_char);
+    cfg_mgr->msgbus_cache = cfgmgr_msgbus_cache_new();
+    if (cfg_mgr->msgbus_cache == NULL) {
+        LOG_ERROR_0("msgbus config cache initialization failed");
         goto err;
     }
 
-    value = kv_store_client->get(handle, config_char);
-    if (value == NULL) {
-        LOG_ERROR("Failed to fetch value for the key: %s", config_char);
-        goto err;
+    // Building msgbus configs in arenas if requested
+    char* arena_env = getenv("CONFIGMGR_ARENA");
+    if (arena_env != NULL && strcmp(arena_env, "true") == 0) {
+        cfg_mgr->msgbus_arena = true;
+        cfgmgr_msgbus_cache_use_arena(cfg_mgr->msgbus_cache, CFGMGR_MSGBUS_ARENA_CHUNK_SIZE);
     }
 
-    app_config = json_config_new_from_buffer(value);
-    if (app_config == NULL) {
-        LOG_ERROR_0("app_config initialization failed");
+    cfg_mgr->env_overrides = cfgmgr_env_overrides_new();
+    if (cfg_mgr->env_overrides == NULL) {
+        LOG_ERROR_0("env overrides initialization failed");
         goto err;
     }
-
-    app_interface = json_config_new_from_buffer(interface);
-    if (app_interface == NULL) {
-        LOG_ERROR_0("app_interface initialization failed");
+    step = cfgmgr_trace_begin("cfgmgr.load_env_overrides");
+    int loaded = baking ? 0 : cfgmgr_env_overrides_load(cfg_mgr->env_overrides);
+    cfgmgr_trace_end(&step, NULL);
+    if (loaded != 0) {
+        LOG_ERROR_0("Failed to load env overrides");
         goto err;
     }
-
-    if (c_app_name != NULL) {
-        cfg_mgr->app_name = c_app_name;
-    }
-    if (kv_store_client != NULL) {
-        cfg_mgr->kv_store_client = kv_store_client;
-    }
-    if (app_config != NULL) {
-        cfg_mgr->app_config = app_config;
-    }
-    if (app_interface != NULL) {
-        cfg_mgr->app_interface = app_interface;
-    }
-    if (handle != NULL) {
-        cfg_mgr->kv_store_handle = handle;
-    }
-    if (env_var != NULL) {
-        cfg_mgr->env_var = env_var;
-    }
-    cfg_mgr->dev_mode = result;
     // Assigining this to NULL as its currently not being used
     cfg_mgr->data_store = NULL;
 
-    if (config_char != NULL) {
-        free(config_char);
-    }
-    if (interface_char != NULL) {
-        free(interface_char);
-    }
-    if (interface != NULL) {
-        free(interface);
-    }
-    if (kv_store_config != NULL) {
-        config_destroy(kv_store_config);
+    // Fetching the interfaces and config, and starting their watches
+    if (!lazy && cfgmgr_load(cfg_mgr, CFGMGR_LOAD_ALL) != 0) {
+        goto err;
     }
-    if (value != NULL) {
-        free(value);
+    if (bundle != NULL) {
+        cfgmgr_prefill_msgbus_configs(cfg_mgr, bundle);
     }
+    cfgmgr_bundle_destroy(bundle_read);
 
+    cfgmgr_trace_end(&span, cfg_mgr->app_name);
+    cfgmgr_trace_write();
     return cfg_mgr;
 
 err:
     if (c_app_name != NULL) {
         free(c_app_name);
     }
-    if (interface != NULL) {
-        free(interface);
-    }
-    if (interface_char != NULL) {
-        free(interface_char);
+    if (cfg_mgr != NULL && cfg_mgr->kv_store_client == NULL && kv_store_client != NULL) {
+        kv_client_free(kv_store_client);
     }
-    if (config_char != NULL) {
-        free(config_char);
+    cfgmgr_bundle_destroy(bundle_read);
+    if (cfg_mgr != NULL) {
+        cfgmgr_destroy(cfg_mgr);
     }
-    if (value != NULL) {
-        free(value);
+    cfgmgr_trace_end(&span, "failed");
+    cfgmgr_trace_write();
+    return NULL;
+}
+
+cfgmgr_ctx_t* cfgmgr_initialize() {
+    return cfgmgr_initialize_with(NULL, NULL, false);
+}
+
+cfgmgr_ctx_t* cfgmgr_bundle_initialize(const cfgmgr_bundle_t* bundle, const char* app_name) {
+    if (bundle == NULL || app_name == NULL) {
+        LOG_ERROR_0("Bundle and AppName can't be NULL");
+        return NULL;
     }
-    if (env_var != NULL) {
-        free(env_var);
+    return cfgmgr_initialize_with(bundle, app_name, false);
+}
+
+cfgmgr_ctx_t* cfgmgr_bundle_bake_initialize(const cfgmgr_bundle_t* bundle, const char* app_name) {
+    if (bundle == NULL || app_name == NULL) {
+        LOG_ERROR_0("Bundle and AppName can't be NULL");
+        return NULL;
     }
-    if (kv_store_client != NULL) {
-        kv_client_free(kv_store_client);
+    return cfgmgr_initialize_with(bundle, app_name, true);
+}
+
+int cfgmgr_reload_env(cfgmgr_ctx_t* cfgmgr) {
+    LOG_DEBUG("In %s function", __func__);
+    if (cfgmgr->env_overrides == NULL) {
+        LOG_ERROR_0("env overrides are not initialized");
+        return -1;
     }
-    if (kv_store_config != NULL) {
-        config_destroy(kv_store_config);
+    if (cfgmgr_env_overrides_load(cfgmgr->env_overrides) != 0) {
+        LOG_ERROR_0("Failed to reload env overrides");
+        return -1;
     }
-    if (cfg_mgr != NULL) {
-        free(cfg_mgr);
+    // msgbus configs built with the previous overrides are stale now
+    if (cfgmgr->msgbus_cache != NULL) {
+        cfgmgr_msgbus_cache_invalidate(cfgmgr->msgbus_cache);
     }
-    return NULL;
+    return 0;
 }
 
 void cfgmgr_destroy(cfgmgr_ctx_t *cfg_mgr) {
     LOG_DEBUG("In %s function", __func__);
     if (cfg_mgr != NULL) {
-        if (cfg_mgr->app_config) {
-            config_destroy(cfg_mgr->app_config);
+        // Freeing the client first joins its watch threads, which
+        // may otherwise still be updating the interface index
+        if (cfg_mgr->kv_store_client) {
+            kv_client_free(cfg_mgr->kv_store_client);
         }
-        if (cfg_mgr->app_interface) {
+        if (cfg_mgr->snapshots) {
+            // Also destroys every app_config published
+            cfgmgr_snapshots_destroy(cfg_mgr->snapshots);
+        }
+        cfgmgr_change_watches_free(cfg_mgr->iface_watches);
+        cfgmgr_change_watches_free(cfg_mgr->config_watches);
+        cfgmgr_key_watches_free(cfg_mgr->key_watches);
+        if (cfg_mgr->iface_index) {
+            if (cfg_mgr->app_interface) {
+                cfgmgr_iface_index_release_interfaces(cfg_mgr->iface_index,
+                                                      cfg_mgr->app_interface);
+            }
+            // Interfaces still referenced keep the index alive, it is
+            // freed along with every app_interface indexed otherwise
+            cfgmgr_iface_index_destroy(cfg_mgr->iface_index);
+        } else if (cfg_mgr->app_interface) {
             config_destroy(cfg_mgr->app_interface);
         }
+        if (cfg_mgr->msgbus_cache) {
+            cfgmgr_msgbus_cache_destroy(cfg_mgr->msgbus_cache);
+        }
+        if (cfg_mgr->env_overrides) {
+            cfgmgr_env_overrides_destroy(cfg_mgr->env_overrides);
+        }
         if (cfg_mgr->data_store) {
             config_destroy(cfg_mgr->data_store);
         }
-        if (cfg_mgr->kv_store_handle) {
-            free(cfg_mgr->kv_store_handle);
-        }
+        // kv_store_handle is owned and freed by the kv_store_client
         if (cfg_mgr->app_name) {
             free(cfg_mgr->app_name);
         }
         if (cfg_mgr->env_var) {
             free(cfg_mgr->env_var);
         }
-        if (cfg_mgr->kv_store_client) {
-            kv_client_free(cfg_mgr->kv_store_client);
-        }
+        pthread_mutex_destroy(&cfg_mgr->load_mtx);
         free(cfg_mgr);
     }
+    // Adding the msgbus config builds traced since initialization
+    cfgmgr_trace_write();
     LOG_DEBUG_0("cfgmgr_ctx_t destroy: Done");
 }
 
@@ -2997,6 +2252,10 @@ void cfgmgr_interface_destroy(cfgmgr_interface_t *cfg_mgr_interface) {
         if (cfg_mgr_interface->interface) {
             config_value_destroy(cfg_mgr_interface->interface);
         }
+        // The context may already be destroyed, the index is not
+        if (cfg_mgr_interface->model) {
+            cfgmgr_iface_index_unref(cfg_mgr_interface->iface_index, cfg_mgr_interface->model);
+        }
         free(cfg_mgr_interface);
     }
     LOG_DEBUG_0("cfgmgr_interface_t destroy: Done");
@@ -0,0 +1,384 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Arena allocator of the ConfigManager implementation
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/json_config.h>
+#include "eii/config_manager/cfgmgr_arena.h"
+
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+    size_t used;
+    size_t size;
+    max_align_t data[];
+} arena_chunk_t;
+
+// Lives in the first chunk it allocates
+struct cfgmgr_arena {
+    arena_chunk_t* chunks;
+    size_t chunk_size;
+    size_t reserved;
+};
+
+// Root object of an arena configuration, which finds its arena from it
+typedef struct {
+    cfgmgr_arena_t* arena;
+    cJSON node;
+} arena_root_t;
+
+static size_t arena_align(size_t size) {
+    size_t align = sizeof(max_align_t);
+    return (size + align - 1) & ~(align - 1);
+}
+
+static arena_chunk_t* arena_chunk_new(size_t size) {
+    arena_chunk_t* chunk = (arena_chunk_t*) malloc(sizeof(arena_chunk_t) + size);
+    if (chunk == NULL) {
+        LOG_ERROR_0("Failed to allocate an arena chunk");
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+    chunk->size = size;
+    return chunk;
+}
+
+cfgmgr_arena_t* cfgmgr_arena_new(size_t chunk_size) {
+    size_t header = arena_align(sizeof(cfgmgr_arena_t));
+    chunk_size = arena_align(chunk_size);
+    if (chunk_size < header) {
+        chunk_size = header;
+    }
+    arena_chunk_t* chunk = arena_chunk_new(chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    cfgmgr_arena_t* arena = (cfgmgr_arena_t*) chunk->data;
+    chunk->used = header;
+    arena->chunks = chunk;
+    arena->chunk_size = chunk_size;
+    arena->reserved = sizeof(arena_chunk_t) + chunk_size;
+    return arena;
+}
+
+void* cfgmgr_arena_alloc(cfgmgr_arena_t* arena, size_t size) {
+    size = arena_align(size);
+    arena_chunk_t* chunk = arena->chunks;
+    if (chunk->size - chunk->used < size) {
+        if (size > arena->chunk_size) {
+            // Own chunk, behind the current one which still has room
+            chunk = arena_chunk_new(size);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            chunk = arena_chunk_new(arena->chunk_size);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+        arena->reserved += sizeof(arena_chunk_t) + chunk->size;
+    }
+    void* ptr = (char*) chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+char* cfgmgr_arena_strndup(cfgmgr_arena_t* arena, const char* str, size_t len) {
+    char* copy = (char*) cfgmgr_arena_alloc(arena, len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* cfgmgr_arena_strdup(cfgmgr_arena_t* arena, const char* str) {
+    return cfgmgr_arena_strndup(arena, str, strlen(str));
+}
+
+bool cfgmgr_arena_owns(const cfgmgr_arena_t* arena, const void* ptr) {
+    uintptr_t addr = (uintptr_t) ptr;
+    for (const arena_chunk_t* chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+        uintptr_t begin = (uintptr_t) chunk->data;
+        if (addr >= begin && addr < begin + chunk->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t cfgmgr_arena_reserved(const cfgmgr_arena_t* arena) {
+    return arena->reserved;
+}
+
+void cfgmgr_arena_destroy(cfgmgr_arena_t* arena) {
+    if (arena == NULL) {
+        return;
+    }
+    // The arena itself is freed along with its first chunk, the last one
+    arena_chunk_t* chunk = arena->chunks;
+    while (chunk != NULL) {
+        arena_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+static cJSON* arena_json_node(cfgmgr_arena_t* arena, int type) {
+    cJSON* node = (cJSON*) cfgmgr_arena_alloc(arena, sizeof(cJSON));
+    if (node == NULL) {
+        return NULL;
+    }
+    memset(node, 0, sizeof(cJSON));
+    node->type = type;
+    return node;
+}
+
+cJSON* cfgmgr_arena_json_object(cfgmgr_arena_t* arena) {
+    return arena_json_node(arena, cJSON_Object);
+}
+
+cJSON* cfgmgr_arena_json_array(cfgmgr_arena_t* arena) {
+    return arena_json_node(arena, cJSON_Array);
+}
+
+cJSON* cfgmgr_arena_json_string(cfgmgr_arena_t* arena, const char* str) {
+    cJSON* node = arena_json_node(arena, cJSON_String);
+    if (node == NULL) {
+        return NULL;
+    }
+    node->valuestring = cfgmgr_arena_strdup(arena, str);
+    if (node->valuestring == NULL) {
+        return NULL;
+    }
+    return node;
+}
+
+cJSON* cfgmgr_arena_json_number(cfgmgr_arena_t* arena, double num) {
+    cJSON* node = arena_json_node(arena, cJSON_Number);
+    if (node == NULL) {
+        return NULL;
+    }
+    // Saturating valueint like cJSON_CreateNumber()
+    node->valuedouble = num;
+    if (num >= INT_MAX) {
+        node->valueint = INT_MAX;
+    } else if (num <= (double) INT_MIN) {
+        node->valueint = INT_MIN;
+    } else {
+        node->valueint = (int) num;
+    }
+    return node;
+}
+
+cJSON* cfgmgr_arena_json_bool(cfgmgr_arena_t* arena, bool value) {
+    return arena_json_node(arena, value ? cJSON_True : cJSON_False);
+}
+
+// Links item as the last child of parent. The first child's prev is the
+// last one, as cJSON keeps it.
+static void arena_json_link(cJSON* parent, cJSON* item) {
+    cJSON* child = parent->child;
+    item->next = NULL;
+    if (child == NULL) {
+        parent->child = item;
+        item->prev = item;
+        return;
+    }
+    cJSON* last = child->prev;
+    last->next = item;
+    item->prev = last;
+    child->prev = item;
+}
+
+cJSON* cfgmgr_arena_json_copy(cfgmgr_arena_t* arena, const cJSON* src) {
+    cJSON* copy = arena_json_node(arena, src->type & 0xFF);
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy->valueint = src->valueint;
+    copy->valuedouble = src->valuedouble;
+    if (src->valuestring != NULL) {
+        copy->valuestring = cfgmgr_arena_strdup(arena, src->valuestring);
+        if (copy->valuestring == NULL) {
+            return NULL;
+        }
+    }
+    for (const cJSON* child = src->child; child != NULL; child = child->next) {
+        cJSON* item = cfgmgr_arena_json_copy(arena, child);
+        if (item == NULL) {
+            return NULL;
+        }
+        if (child->string != NULL) {
+            item->string = cfgmgr_arena_strdup(arena, child->string);
+            if (item->string == NULL) {
+                return NULL;
+            }
+            item->type |= cJSON_StringIsConst;
+        }
+        arena_json_link(copy, item);
+    }
+    return copy;
+}
+
+bool cfgmgr_arena_json_set(cfgmgr_arena_t* arena, cJSON* obj, const char* key, cJSON* item) {
+    if (item == NULL) {
+        LOG_ERROR("Failed to create the value of \"%s\"", key);
+        return false;
+    }
+    item->string = cfgmgr_arena_strdup(arena, key);
+    if (item->string == NULL) {
+        LOG_ERROR("Failed to copy the key \"%s\"", key);
+        return false;
+    }
+    // Keys are not freed by anyone, the arena owns them
+    item->type |= cJSON_StringIsConst;
+
+    cJSON* old = obj->child;
+    while (old != NULL && strcmp(old->string, key) != 0) {
+        old = old->next;
+    }
+    if (old == NULL) {
+        arena_json_link(obj, item);
+        return true;
+    }
+    // Replacing old in place, its memory stays in the arena
+    if (old == obj->child) {
+        obj->child = item;
+    } else {
+        old->prev->next = item;
+    }
+    item->prev = old->prev;
+    item->next = old->next;
+    if (old->next != NULL) {
+        old->next->prev = item;
+    } else {
+        obj->child->prev = item;
+    }
+    return true;
+}
+
+void cfgmgr_arena_json_append(cJSON* array, cJSON* item) {
+    arena_json_link(array, item);
+}
+
+static void arena_config_free(void* cfg) {
+    arena_root_t* root = (arena_root_t*) ((char*) cfg - offsetof(arena_root_t, node));
+    cfgmgr_arena_destroy(root->arena);
+}
+
+// Copies a JSON object or array into the arena, taking ownership of the
+// source when the value has no free function of its own
+static cJSON* arena_config_copy_tree(cfgmgr_arena_t* arena, void* src, void (*free_fn)(void*)) {
+    cJSON* item = cfgmgr_arena_json_copy(arena, (const cJSON*) src);
+    if (item != NULL && free_fn == NULL && !cfgmgr_arena_owns(arena, src)) {
+        cJSON_Delete((cJSON*) src);
+    }
+    return item;
+}
+
+static bool arena_config_set(const void* cfg, const char* key, config_value_t* value) {
+    cJSON* obj = (cJSON*) cfg;
+    arena_root_t* root = (arena_root_t*) ((char*) cfg - offsetof(arena_root_t, node));
+    cfgmgr_arena_t* arena = root->arena;
+    cJSON* item = NULL;
+    switch (value->type) {
+        case CVT_INTEGER:
+            item = cfgmgr_arena_json_number(arena, (double) value->body.integer);
+            break;
+        case CVT_FLOATING:
+            item = cfgmgr_arena_json_number(arena, value->body.floating);
+            break;
+        case CVT_STRING:
+            item = cfgmgr_arena_json_string(arena, value->body.string);
+            break;
+        case CVT_BOOLEAN:
+            item = cfgmgr_arena_json_bool(arena, value->body.boolean);
+            break;
+        case CVT_OBJECT:
+            item = arena_config_copy_tree(arena, value->body.object->object, value->body.object->free);
+            break;
+        case CVT_ARRAY:
+            item = arena_config_copy_tree(arena, value->body.array->array, value->body.array->free);
+            break;
+        default:
+            item = arena_json_node(arena, cJSON_NULL);
+            break;
+    }
+    return cfgmgr_arena_json_set(arena, obj, key, item);
+}
+
+config_t* cfgmgr_arena_config_new(cfgmgr_arena_t* arena) {
+    arena_root_t* root = (arena_root_t*) cfgmgr_arena_alloc(arena, sizeof(arena_root_t));
+    if (root == NULL) {
+        return NULL;
+    }
+    memset(root, 0, sizeof(arena_root_t));
+    root->arena = arena;
+    root->node.type = cJSON_Object;
+    config_t* config = config_new(&root->node, arena_config_free, get_config_value, arena_config_set);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to create the arena configuration");
+        return NULL;
+    }
+    return config;
+}
+
+cfgmgr_arena_t* cfgmgr_arena_config_arena(const config_t* config) {
+    arena_root_t* root = (arena_root_t*) ((char*) config->cfg - offsetof(arena_root_t, node));
+    return root->arena;
+}
+
+config_t* cfgmgr_arena_config_copy(const cJSON* src, size_t chunk_size) {
+    cfgmgr_arena_t* arena = cfgmgr_arena_new(chunk_size);
+    if (arena == NULL) {
+        return NULL;
+    }
+    config_t* config = cfgmgr_arena_config_new(arena);
+    if (config == NULL) {
+        cfgmgr_arena_destroy(arena);
+        return NULL;
+    }
+    cJSON* root = (cJSON*) config->cfg;
+    for (const cJSON* child = src->child; child != NULL; child = child->next) {
+        cJSON* item = cfgmgr_arena_json_copy(arena, child);
+        if (item == NULL || child->string == NULL ||
+                !cfgmgr_arena_json_set(arena, root, child->string, item)) {
+            LOG_ERROR_0("Failed to copy the configuration into the arena");
+            config_destroy(config);
+            return NULL;
+        }
+    }
+    return config;
+}
@@ -0,0 +1,623 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Binary msgbus config implementation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_binary.h"
+
+// Deepest nesting accepted in a buffer, as by cJSON
+#define BINARY_NESTING_LIMIT    1000
+
+// Size of the type and len preceding the payload of a node
+#define BINARY_NODE_SIZE        8
+
+// Buffer the binary form is compiled into
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} binary_writer_t;
+
+// Member of an object being compiled, index keeps the first of duplicate
+// keys once sorted
+typedef struct {
+    const cJSON* item;
+    size_t index;
+} binary_member_t;
+
+static uint32_t binary_u32(const uint8_t* p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+           ((uint32_t) p[3] << 24);
+}
+
+static uint64_t binary_u64(const uint8_t* p) {
+    return (uint64_t) binary_u32(p) | ((uint64_t) binary_u32(p + 4) << 32);
+}
+
+static void binary_put_u32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+}
+
+static void binary_put_u64(uint8_t* p, uint64_t value) {
+    binary_put_u32(p, (uint32_t) value);
+    binary_put_u32(p + 4, (uint32_t) (value >> 32));
+}
+
+static cfgmgr_binary_t binary_of(const void* node) {
+    cfgmgr_binary_t value = { node };
+    return value;
+}
+
+static const char* binary_str(const uint8_t* node) {
+    return (const char*) node + BINARY_NODE_SIZE;
+}
+
+// Reserves a zeroed, 4 byte aligned block of the buffer at *off
+static bool binary_alloc(binary_writer_t* w, size_t size, size_t* off) {
+    size_t padded = (size + 3) & ~(size_t) 3;
+    if (padded < size || padded > UINT32_MAX - w->len) {
+        LOG_ERROR_0("Binary config is too large");
+        return false;
+    }
+    if (w->len + padded > w->cap) {
+        size_t cap = (w->cap != 0) ? w->cap : 256;
+        while (cap < w->len + padded) {
+            cap *= 2;
+        }
+        uint8_t* data = (uint8_t*) realloc(w->data, cap);
+        if (data == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for the binary config");
+            return false;
+        }
+        w->data = data;
+        w->cap = cap;
+    }
+    memset(w->data + w->len, 0, padded);
+    *off = w->len;
+    w->len += padded;
+    return true;
+}
+
+static bool binary_alloc_node(binary_writer_t* w, cfgmgr_view_type_t type, uint32_t len,
+                              size_t payload, size_t* off) {
+    if (!binary_alloc(w, BINARY_NODE_SIZE + payload, off)) {
+        return false;
+    }
+    w->data[*off] = (uint8_t) type;
+    binary_put_u32(w->data + *off + 4, len);
+    return true;
+}
+
+static bool binary_write_string(binary_writer_t* w, const char* str, size_t* off) {
+    size_t len = strlen(str);
+    if (len >= UINT32_MAX) {
+        LOG_ERROR_0("String is too large for a binary config");
+        return false;
+    }
+    if (!binary_alloc_node(w, CFGMGR_VIEW_STRING, (uint32_t) len, len + 1, off)) {
+        return false;
+    }
+    memcpy(w->data + *off + BINARY_NODE_SIZE, str, len);
+    return true;
+}
+
+static int binary_member_cmp(const void* a, const void* b) {
+    const binary_member_t* ma = (const binary_member_t*) a;
+    const binary_member_t* mb = (const binary_member_t*) b;
+    int cmp = strcmp(ma->item->string, mb->item->string);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (ma->index < mb->index) ? -1 : (ma->index > mb->index);
+}
+
+static bool binary_write_value(binary_writer_t* w, const cJSON* json, size_t* off, int depth);
+
+static bool binary_write_object(binary_writer_t* w, const cJSON* json, size_t* off, int depth) {
+    binary_member_t* members = NULL;
+    size_t count = 0;
+    size_t unique = 0;
+    bool ret = false;
+    const cJSON* item = NULL;
+
+    cJSON_ArrayForEach(item, json) {
+        count++;
+    }
+    if (count > 0) {
+        members = (binary_member_t*) malloc(sizeof(binary_member_t) * count);
+        if (members == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for the members of an object");
+            goto err;
+        }
+    }
+    count = 0;
+    cJSON_ArrayForEach(item, json) {
+        if (item->string != NULL) {
+            members[count].item = item;
+            members[count].index = count;
+            count++;
+        }
+    }
+    if (count > 1) {
+        qsort(members, count, sizeof(binary_member_t), binary_member_cmp);
+    }
+    // Keys are unique, lookups find the first of duplicate keys as in cJSON
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || strcmp(members[unique - 1].item->string, members[i].item->string) != 0) {
+            members[unique++] = members[i];
+        }
+    }
+    if (!binary_alloc_node(w, CFGMGR_VIEW_OBJECT, (uint32_t) unique, unique * 8, off)) {
+        goto err;
+    }
+    for (size_t i = 0; i < unique; i++) {
+        size_t key_off = 0;
+        size_t value_off = 0;
+        if (!binary_write_string(w, members[i].item->string, &key_off) ||
+                !binary_write_value(w, members[i].item, &value_off, depth + 1)) {
+            goto err;
+        }
+        uint8_t* pair = w->data + *off + BINARY_NODE_SIZE + i * 8;
+        binary_put_u32(pair, (uint32_t) (key_off - *off));
+        binary_put_u32(pair + 4, (uint32_t) (value_off - *off));
+    }
+
+    // We should add all success-path code above this line
+    ret = true;
+
+err:
+    free(members);
+    return ret;
+}
+
+static bool binary_write_array(binary_writer_t* w, const cJSON* json, size_t* off, int depth) {
+    size_t count = (size_t) cJSON_GetArraySize(json);
+    if (!binary_alloc_node(w, CFGMGR_VIEW_ARRAY, (uint32_t) count, count * 4, off)) {
+        return false;
+    }
+    size_t i = 0;
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, json) {
+        size_t item_off = 0;
+        if (!binary_write_value(w, item, &item_off, depth + 1)) {
+            return false;
+        }
+        binary_put_u32(w->data + *off + BINARY_NODE_SIZE + i * 4, (uint32_t) (item_off - *off));
+        i++;
+    }
+    return true;
+}
+
+static bool binary_write_value(binary_writer_t* w, const cJSON* json, size_t* off, int depth) {
+    if (depth >= BINARY_NESTING_LIMIT) {
+        LOG_ERROR_0("Config is nested too deeply for a binary config");
+        return false;
+    }
+    if (cJSON_IsObject(json)) {
+        return binary_write_object(w, json, off, depth);
+    } else if (cJSON_IsArray(json)) {
+        return binary_write_array(w, json, off, depth);
+    } else if (cJSON_IsString(json)) {
+        return binary_write_string(w, (json->valuestring != NULL) ? json->valuestring : "", off);
+    } else if (cJSON_IsNumber(json)) {
+        // Same integer/floating split json_config makes
+        if (json->valuedouble == (double) json->valueint) {
+            if (!binary_alloc_node(w, CFGMGR_VIEW_INTEGER, 0, 8, off)) {
+                return false;
+            }
+            binary_put_u64(w->data + *off + BINARY_NODE_SIZE, (uint64_t) (int64_t) json->valueint);
+        } else {
+            if (!binary_alloc_node(w, CFGMGR_VIEW_FLOATING, 0, 8, off)) {
+                return false;
+            }
+            uint64_t bits;
+            memcpy(&bits, &json->valuedouble, sizeof(bits));
+            binary_put_u64(w->data + *off + BINARY_NODE_SIZE, bits);
+        }
+        return true;
+    } else if (cJSON_IsBool(json)) {
+        return binary_alloc_node(w, CFGMGR_VIEW_BOOLEAN, cJSON_IsTrue(json) ? 1 : 0, 0, off);
+    }
+    return binary_alloc_node(w, CFGMGR_VIEW_NULL, 0, 0, off);
+}
+
+void* cfgmgr_binary_encode(const cJSON* json, size_t* size) {
+    binary_writer_t w = { NULL, 0, 0 };
+    size_t header = 0;
+    size_t root = 0;
+    void* ret = NULL;
+
+    if (json == NULL || size == NULL) {
+        LOG_ERROR_0("No config to compile into a binary config");
+        goto err;
+    }
+    if (!binary_alloc(&w, CFGMGR_BINARY_HEADER_SIZE, &header) ||
+            !binary_write_value(&w, json, &root, 0)) {
+        goto err;
+    }
+    memcpy(w.data, CFGMGR_BINARY_MAGIC, 4);
+    w.data[4] = (uint8_t) CFGMGR_BINARY_VERSION;
+    w.data[5] = (uint8_t) (CFGMGR_BINARY_VERSION >> 8);
+    binary_put_u32(w.data + 8, (uint32_t) w.len);
+    binary_put_u32(w.data + 12, (uint32_t) root);
+    *size = w.len;
+
+    // We should add all success-path code above this line
+    ret = w.data;
+    w.data = NULL;
+
+err:
+    free(w.data);
+    return ret;
+}
+
+void* cfgmgr_get_msgbus_config_binary(cfgmgr_interface_t* ctx, size_t* size) {
+    config_t* config = cfgmgr_get_msgbus_config(ctx);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to resolve the msgbus config");
+        return NULL;
+    }
+    // msgbus configs, heap or arena allocated, are cJSON trees
+    void* buf = cfgmgr_binary_encode((const cJSON*) config->cfg, size);
+    config_destroy(config);
+    return buf;
+}
+
+// Checks the node at off and everything it references. budget bounds the
+// nodes visited, so that crafted buffers referencing the same nodes over
+// and over are rejected in linear time
+static bool binary_check(const uint8_t* buf, size_t size, size_t off, int depth, size_t* budget) {
+    if (depth >= BINARY_NESTING_LIMIT || *budget == 0) {
+        return false;
+    }
+    (*budget)--;
+    if (off % 4 != 0 || off > size || size - off < BINARY_NODE_SIZE) {
+        return false;
+    }
+    const uint8_t* node = buf + off;
+    if (node[1] != 0 || node[2] != 0 || node[3] != 0) {
+        return false;
+    }
+    uint32_t len = binary_u32(node + 4);
+    size_t avail = size - off - BINARY_NODE_SIZE;
+    const char* prev_key = NULL;
+    switch (node[0]) {
+        case CFGMGR_VIEW_NULL:
+            return len == 0;
+        case CFGMGR_VIEW_BOOLEAN:
+            return len <= 1;
+        case CFGMGR_VIEW_INTEGER:
+        case CFGMGR_VIEW_FLOATING:
+            return len == 0 && avail >= 8;
+        case CFGMGR_VIEW_STRING:
+            return avail > len && node[BINARY_NODE_SIZE + len] == '\0' &&
+                   memchr(binary_str(node), '\0', len) == NULL;
+        case CFGMGR_VIEW_ARRAY:
+            if (len > avail / 4) {
+                return false;
+            }
+            for (uint32_t i = 0; i < len; i++) {
+                uint32_t item = binary_u32(node + BINARY_NODE_SIZE + i * 4);
+                if (item < BINARY_NODE_SIZE || !binary_check(buf, size, off + item, depth + 1, budget)) {
+                    return false;
+                }
+            }
+            return true;
+        case CFGMGR_VIEW_OBJECT:
+            if (len > avail / 8) {
+                return false;
+            }
+            for (uint32_t i = 0; i < len; i++) {
+                uint32_t key = binary_u32(node + BINARY_NODE_SIZE + i * 8);
+                uint32_t value = binary_u32(node + BINARY_NODE_SIZE + i * 8 + 4);
+                if (key < BINARY_NODE_SIZE || value < BINARY_NODE_SIZE ||
+                        !binary_check(buf, size, off + key, depth + 1, budget) ||
+                        node[key] != CFGMGR_VIEW_STRING ||
+                        !binary_check(buf, size, off + value, depth + 1, budget)) {
+                    return false;
+                }
+                const char* key_str = binary_str(node + key);
+                if (prev_key != NULL && strcmp(prev_key, key_str) >= 0) {
+                    return false;
+                }
+                prev_key = key_str;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+cfgmgr_binary_t cfgmgr_binary_root(const void* buf, size_t size) {
+    const uint8_t* data = (const uint8_t*) buf;
+    if (data == NULL || size < CFGMGR_BINARY_HEADER_SIZE ||
+            memcmp(data, CFGMGR_BINARY_MAGIC, 4) != 0) {
+        LOG_ERROR_0("Not a binary config");
+        return binary_of(NULL);
+    }
+    uint32_t version = (uint32_t) data[4] | ((uint32_t) data[5] << 8);
+    if (version != CFGMGR_BINARY_VERSION || data[6] != 0 || data[7] != 0) {
+        LOG_ERROR("Unsupported binary config version %u", version);
+        return binary_of(NULL);
+    }
+    // The buffer may be larger than the config, ex: a mapped file
+    uint32_t config_size = binary_u32(data + 8);
+    uint32_t root = binary_u32(data + 12);
+    size_t budget = config_size / BINARY_NODE_SIZE;
+    if (config_size > size || root < CFGMGR_BINARY_HEADER_SIZE ||
+            !binary_check(data, config_size, root, 0, &budget)) {
+        LOG_ERROR_0("Binary config is corrupted");
+        return binary_of(NULL);
+    }
+    return binary_of(data + root);
+}
+
+cfgmgr_view_type_t cfgmgr_binary_type(cfgmgr_binary_t value) {
+    const uint8_t* node = (const uint8_t*) value.node;
+    if (node == NULL) {
+        return CFGMGR_VIEW_NONE;
+    }
+    return (cfgmgr_view_type_t) node[0];
+}
+
+cfgmgr_binary_t cfgmgr_binary_get(cfgmgr_binary_t object, const char* key) {
+    const uint8_t* node = (const uint8_t*) object.node;
+    if (cfgmgr_binary_type(object) != CFGMGR_VIEW_OBJECT || key == NULL) {
+        return binary_of(NULL);
+    }
+    size_t lo = 0;
+    size_t hi = binary_u32(node + 4);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const uint8_t* pair = node + BINARY_NODE_SIZE + mid * 8;
+        int cmp = strcmp(key, binary_str(node + binary_u32(pair)));
+        if (cmp == 0) {
+            return binary_of(node + binary_u32(pair + 4));
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return binary_of(NULL);
+}
+
+cfgmgr_binary_t cfgmgr_binary_at(cfgmgr_binary_t array, size_t index) {
+    const uint8_t* node = (const uint8_t*) array.node;
+    if (cfgmgr_binary_type(array) != CFGMGR_VIEW_ARRAY || index >= binary_u32(node + 4)) {
+        return binary_of(NULL);
+    }
+    return binary_of(node + binary_u32(node + BINARY_NODE_SIZE + index * 4));
+}
+
+size_t cfgmgr_binary_len(cfgmgr_binary_t value) {
+    cfgmgr_view_type_t type = cfgmgr_binary_type(value);
+    if (type != CFGMGR_VIEW_ARRAY && type != CFGMGR_VIEW_OBJECT) {
+        return 0;
+    }
+    return binary_u32((const uint8_t*) value.node + 4);
+}
+
+bool cfgmgr_binary_string(cfgmgr_binary_t value, const char** str, size_t* len) {
+    if (cfgmgr_binary_type(value) != CFGMGR_VIEW_STRING) {
+        return false;
+    }
+    const uint8_t* node = (const uint8_t*) value.node;
+    *str = binary_str(node);
+    if (len != NULL) {
+        *len = binary_u32(node + 4);
+    }
+    return true;
+}
+
+bool cfgmgr_binary_integer(cfgmgr_binary_t value, int64_t* result) {
+    if (cfgmgr_binary_type(value) != CFGMGR_VIEW_INTEGER) {
+        return false;
+    }
+    *result = (int64_t) binary_u64((const uint8_t*) value.node + BINARY_NODE_SIZE);
+    return true;
+}
+
+bool cfgmgr_binary_floating(cfgmgr_binary_t value, double* result) {
+    cfgmgr_view_type_t type = cfgmgr_binary_type(value);
+    if (type == CFGMGR_VIEW_INTEGER) {
+        int64_t integer = 0;
+        cfgmgr_binary_integer(value, &integer);
+        *result = (double) integer;
+        return true;
+    } else if (type != CFGMGR_VIEW_FLOATING) {
+        return false;
+    }
+    uint64_t bits = binary_u64((const uint8_t*) value.node + BINARY_NODE_SIZE);
+    memcpy(result, &bits, sizeof(bits));
+    return true;
+}
+
+bool cfgmgr_binary_boolean(cfgmgr_binary_t value, bool* result) {
+    if (cfgmgr_binary_type(value) != CFGMGR_VIEW_BOOLEAN) {
+        return false;
+    }
+    *result = binary_u32((const uint8_t*) value.node + 4) != 0;
+    return true;
+}
+
+cfgmgr_binary_iter_t cfgmgr_binary_iter(cfgmgr_binary_t value) {
+    cfgmgr_binary_iter_t iter = { NULL, 0 };
+    if (cfgmgr_binary_len(value) > 0) {
+        iter.node = value.node;
+    }
+    return iter;
+}
+
+bool cfgmgr_binary_next(cfgmgr_binary_iter_t* iter, cfgmgr_binary_t* item, const char** key) {
+    cfgmgr_binary_t value = binary_of(iter->node);
+    if (iter->node == NULL || iter->index >= cfgmgr_binary_len(value)) {
+        return false;
+    }
+    const uint8_t* node = (const uint8_t*) iter->node;
+    if (cfgmgr_binary_type(value) == CFGMGR_VIEW_OBJECT) {
+        const uint8_t* pair = node + BINARY_NODE_SIZE + iter->index * 8;
+        *item = binary_of(node + binary_u32(pair + 4));
+        if (key != NULL) {
+            *key = binary_str(node + binary_u32(pair));
+        }
+    } else {
+        *item = cfgmgr_binary_at(value, iter->index);
+        if (key != NULL) {
+            *key = NULL;
+        }
+    }
+    iter->index++;
+    return true;
+}
+
+static cJSON* binary_decode(cfgmgr_binary_t value) {
+    cJSON* json = NULL;
+    cfgmgr_binary_t item;
+    const char* key = NULL;
+    cfgmgr_binary_iter_t iter = cfgmgr_binary_iter(value);
+    const uint8_t* node = (const uint8_t*) value.node;
+    double floating = 0;
+
+    switch (cfgmgr_binary_type(value)) {
+        case CFGMGR_VIEW_NULL:
+            return cJSON_CreateNull();
+        case CFGMGR_VIEW_BOOLEAN:
+            return cJSON_CreateBool(binary_u32(node + 4) != 0);
+        case CFGMGR_VIEW_INTEGER:
+        case CFGMGR_VIEW_FLOATING:
+            cfgmgr_binary_floating(value, &floating);
+            return cJSON_CreateNumber(floating);
+        case CFGMGR_VIEW_STRING:
+            return cJSON_CreateString(binary_str(node));
+        case CFGMGR_VIEW_ARRAY:
+        case CFGMGR_VIEW_OBJECT:
+            break;
+        default:
+            return NULL;
+    }
+    // Recursion is bounded, checked buffers nest BINARY_NESTING_LIMIT deep
+    // at most
+    json = (cfgmgr_binary_type(value) == CFGMGR_VIEW_ARRAY) ? cJSON_CreateArray() : cJSON_CreateObject();
+    if (json == NULL) {
+        return NULL;
+    }
+    while (cfgmgr_binary_next(&iter, &item, &key)) {
+        cJSON* child = binary_decode(item);
+        if (child == NULL) {
+            cJSON_Delete(json);
+            return NULL;
+        }
+        if (key != NULL) {
+            cJSON_AddItemToObject(json, key, child);
+        } else {
+            cJSON_AddItemToArray(json, child);
+        }
+    }
+    return json;
+}
+
+cJSON* cfgmgr_binary_decode(cfgmgr_binary_t value) {
+    cJSON* json = binary_decode(value);
+    if (json == NULL && value.node != NULL) {
+        LOG_ERROR_0("Failed to decode binary config");
+    }
+    return json;
+}
+
+static config_value_t* binary_config_get(const void* object, const char* key);
+static config_value_t* binary_config_get_item(const void* array, int index);
+
+// Converts a node into a config_value_t, objects and arrays reference the
+// buffer
+static config_value_t* binary_config_value(cfgmgr_binary_t value) {
+    const char* str = NULL;
+    int64_t integer = 0;
+    double floating = 0;
+    bool boolean = false;
+    switch (cfgmgr_binary_type(value)) {
+        case CFGMGR_VIEW_STRING:
+            cfgmgr_binary_string(value, &str, NULL);
+            return config_value_new_string(str);
+        case CFGMGR_VIEW_INTEGER:
+            cfgmgr_binary_integer(value, &integer);
+            return config_value_new_integer(integer);
+        case CFGMGR_VIEW_FLOATING:
+            cfgmgr_binary_floating(value, &floating);
+            return config_value_new_floating(floating);
+        case CFGMGR_VIEW_BOOLEAN:
+            cfgmgr_binary_boolean(value, &boolean);
+            return config_value_new_boolean(boolean);
+        case CFGMGR_VIEW_OBJECT:
+            return config_value_new_object((void*) value.node, binary_config_get, NULL);
+        case CFGMGR_VIEW_ARRAY:
+            return config_value_new_array((void*) value.node, cfgmgr_binary_len(value),
+                                          binary_config_get_item, NULL);
+        case CFGMGR_VIEW_NULL:
+            return config_value_new_none();
+        default:
+            return NULL;
+    }
+}
+
+static config_value_t* binary_config_get(const void* object, const char* key) {
+    return binary_config_value(cfgmgr_binary_get(binary_of(object), key));
+}
+
+static config_value_t* binary_config_get_item(const void* array, int index) {
+    if (index < 0) {
+        return NULL;
+    }
+    return binary_config_value(cfgmgr_binary_at(binary_of(array), (size_t) index));
+}
+
+static bool binary_config_set(const void* cfg, const char* key, config_value_t* value) {
+    LOG_ERROR("Binary configs are read-only, can't set \"%s\"", key);
+    return false;
+}
+
+// The buffer is borrowed
+static void binary_config_free(void* cfg) {
+}
+
+config_t* cfgmgr_binary_config_new(const void* buf, size_t size) {
+    cfgmgr_binary_t root = cfgmgr_binary_root(buf, size);
+    if (cfgmgr_binary_type(root) != CFGMGR_VIEW_OBJECT) {
+        LOG_ERROR_0("Binary config is not an object");
+        return NULL;
+    }
+    config_t* config = config_new((void*) root.node, binary_config_free,
+                                  binary_config_get, binary_config_set);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        return NULL;
+    }
+    return config;
+}
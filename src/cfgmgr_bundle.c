@@ -0,0 +1,659 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Config bundle implementation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cjson/cJSON.h>
+#include <openssl/crypto.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/string.h>
+#include <eii/utils/json_config.h>
+#include "eii/config_manager/cfgmgr_bundle.h"
+#include "eii/config_manager/cfgmgr_binary.h"
+#include "eii/config_manager/cfgmgr_seal.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_bundle.h"
+
+// Bundle files are sealed, see cfgmgr_seal.h, with this magic ("EIIB")
+#define BUNDLE_MAGIC    0x42494945u
+
+struct cfgmgr_bundle {
+    // Bundle object, as described in cfgmgr_bundle.h
+    cJSON* root;
+};
+
+// Keys read from the kv_store while baking
+typedef struct {
+    cJSON* values;
+    bool failed;
+} bundle_fetch_t;
+
+// Keys of the msgbus configs of each interface type in an application
+static const char* const bundle_iface_keys[] = {
+    [CFGMGR_PUBLISHER] = "Publishers",
+    [CFGMGR_SUBSCRIBER] = "Subscribers",
+    [CFGMGR_SERVER] = "Servers",
+    [CFGMGR_CLIENT] = "Clients",
+};
+
+#define BUNDLE_IFACE_TYPES  (sizeof(bundle_iface_keys) / sizeof(bundle_iface_keys[0]))
+
+// Key of an application, "/" followed by the AppName and the suffix
+static char* bundle_app_key(const char* app_name, const char* suffix) {
+    size_t init_len = strlen("/") + strlen(app_name) + strlen(suffix) + 1;
+    char* key = concat_s(init_len, 3, "/", app_name, suffix);
+    if (key == NULL) {
+        LOG_ERROR("Concatenation of the key %s of %s failed", suffix, app_name);
+    }
+    return key;
+}
+
+static bool bundle_has_prefix(const char* key, const char* prefix) {
+    return strncmp(key, prefix, strlen(prefix)) == 0;
+}
+
+static int bundle_set_value(cJSON* values, const char* key, const char* value) {
+    cJSON* item = cJSON_CreateString(value);
+    if (item == NULL) {
+        LOG_ERROR_0("Failed to copy bundle value");
+        return -1;
+    }
+    if (cJSON_GetObjectItemCaseSensitive(values, key) != NULL) {
+        cJSON_ReplaceItemInObjectCaseSensitive(values, key, item);
+    } else {
+        cJSON_AddItemToObject(values, key, item);
+    }
+    return 0;
+}
+
+static int bundle_fetch_kv(const char* key, const char* value, void* user_data) {
+    bundle_fetch_t* fetch = (bundle_fetch_t*) user_data;
+    if (key == NULL) {
+        LOG_ERROR_0("kv_store can't list the keys of a prefix");
+        fetch->failed = true;
+    } else if (bundle_set_value(fetch->values, key, value) != 0) {
+        fetch->failed = true;
+    }
+    return fetch->failed ? -1 : 0;
+}
+
+// Reads keys and key prefixes into @p fetch, in one get_batch() call when
+// the kv_store has it
+static int bundle_fetch(kv_store_client_t* client, void* handle, char** keys,
+                        const bool* prefixes, size_t count, bundle_fetch_t* fetch) {
+    if (client->get_batch != NULL) {
+        config_t* result = client->get_batch(handle, keys, prefixes, count);
+        if (result == NULL) {
+            LOG_ERROR_0("Failed to read the keys to bake");
+            return -1;
+        }
+        cJSON* item = NULL;
+        cJSON_ArrayForEach(item, (cJSON*) result->cfg) {
+            if (cJSON_IsString(item) && bundle_fetch_kv(item->string, item->valuestring, fetch) != 0) {
+                break;
+            }
+        }
+        config_destroy(result);
+        return fetch->failed ? -1 : 0;
+    }
+    LOG_DEBUG_0("kv_store has no get_batch(), reading the keys to bake one by one");
+    for (size_t i = 0; i < count && !fetch->failed; i++) {
+        if (prefixes[i]) {
+            if (kv_store_get_prefix_each(client, handle, keys[i], bundle_fetch_kv, fetch) < 0) {
+                LOG_ERROR("Failed to read the keys of %s", keys[i]);
+                return -1;
+            }
+            continue;
+        }
+        char* value = client->get(handle, keys[i]);
+        if (value != NULL) {
+            bundle_fetch_kv(keys[i], value, fetch);
+            free(value);
+        }
+    }
+    return fetch->failed ? -1 : 0;
+}
+
+// Copies a key read into the bundle, if it was found
+static int bundle_keep(cJSON* keys, const cJSON* fetched, const char* key) {
+    cJSON* value = cJSON_GetObjectItemCaseSensitive(fetched, key);
+    if (value == NULL || cJSON_GetObjectItemCaseSensitive(keys, key) != NULL) {
+        return 0;
+    }
+    return bundle_set_value(keys, key, value->valuestring);
+}
+
+// Queues the keys of an application
+static int bundle_queue_app(char** keys, bool* prefixes, size_t* count, const char* app_name,
+                            bool dev_mode) {
+    const char* suffixes[] = { "/interfaces", "/config", PRIVATE_KEY };
+    // Private keys are only read in prod mode
+    size_t n = dev_mode ? 2 : 3;
+    for (size_t i = 0; i < n; i++) {
+        keys[*count] = bundle_app_key(app_name, suffixes[i]);
+        if (keys[*count] == NULL) {
+            return -1;
+        }
+        prefixes[*count] = false;
+        (*count)++;
+    }
+    return 0;
+}
+
+// Resolves the msgbus configs of an application from the keys of the
+// bundle, with the same builders the application uses
+static int bundle_resolve(cfgmgr_bundle_t* bundle, const char* app_name) {
+    cfgmgr_ctx_t* ctx = NULL;
+    cfgmgr_msgbus_configs_t* configs = NULL;
+    cJSON* app = NULL;
+    int ret_val = -1;
+
+    LOG_INFO("Resolving the msgbus configs of %s", app_name);
+    ctx = cfgmgr_bundle_bake_initialize(bundle, app_name);
+    if (ctx == NULL) {
+        LOG_ERROR("Failed to initialize %s from the baked keys", app_name);
+        goto err;
+    }
+    configs = cfgmgr_get_all_msgbus_configs(ctx);
+    if (configs == NULL) {
+        LOG_ERROR("Failed to resolve the msgbus configs of %s", app_name);
+        goto err;
+    }
+    app = cJSON_CreateObject();
+    if (app == NULL) {
+        LOG_ERROR_0("Failed to allocate the baked application");
+        goto err;
+    }
+    for (size_t t = 0; t < BUNDLE_IFACE_TYPES; t++) {
+        if (cJSON_AddArrayToObject(app, bundle_iface_keys[t]) == NULL) {
+            LOG_ERROR_0("Failed to allocate the baked application");
+            goto err;
+        }
+    }
+    // Entries are sorted by type, then in the order of the interfaces
+    for (size_t i = 0; i < configs->count; i++) {
+        cfgmgr_msgbus_config_entry_t* entry = &configs->entries[i];
+        if (entry->config == NULL) {
+            LOG_ERROR("Failed to resolve the msgbus config of %s of %s",
+                      (entry->name != NULL) ? entry->name : "(unnamed)", app_name);
+            goto err;
+        }
+        cJSON* config = cJSON_Duplicate((const cJSON*) entry->config->cfg, true);
+        if (config == NULL) {
+            LOG_ERROR_0("Failed to copy the msgbus config");
+            goto err;
+        }
+        cJSON_AddItemToArray(cJSON_GetObjectItemCaseSensitive(app, bundle_iface_keys[entry->type]),
+                             config);
+    }
+    cJSON_AddItemToObject(cJSON_GetObjectItemCaseSensitive(bundle->root, "Apps"), app_name, app);
+    app = NULL;
+
+    // We should add all success-path code above this line
+    ret_val = 0;
+
+err:
+    if (app != NULL) {
+        cJSON_Delete(app);
+    }
+    if (configs != NULL) {
+        cfgmgr_msgbus_configs_destroy(configs);
+    }
+    if (ctx != NULL) {
+        cfgmgr_destroy(ctx);
+    }
+    return ret_val;
+}
+
+cfgmgr_bundle_t* cfgmgr_bundle_bake(kv_store_client_t* client, void* handle, bool dev_mode,
+                                    const char* const* app_names, size_t count) {
+    cfgmgr_bundle_t* bundle = NULL;
+    bundle_fetch_t fetch = { NULL, false };
+    char** keys = NULL;
+    bool* prefixes = NULL;
+    size_t key_count = 0;
+    cJSON* names = NULL;
+    bool ret_val = false;
+
+    if (client == NULL || handle == NULL) {
+        LOG_ERROR_0("kv_store_client to bake from is not initialized");
+        goto err;
+    }
+    bundle = (cfgmgr_bundle_t*) calloc(1, sizeof(cfgmgr_bundle_t));
+    fetch.values = cJSON_CreateObject();
+    names = cJSON_CreateArray();
+    // The keys of every application, /GlobalEnv/ and /Publickeys/
+    keys = (char**) calloc(count * 3 + 2, sizeof(char*));
+    prefixes = (bool*) calloc(count * 3 + 2, sizeof(bool));
+    if (bundle == NULL || fetch.values == NULL || names == NULL || keys == NULL || prefixes == NULL) {
+        LOG_ERROR_0("Failed to allocate the bundle");
+        goto err;
+    }
+    bundle->root = cJSON_CreateObject();
+    if (bundle->root == NULL ||
+            cJSON_AddNumberToObject(bundle->root, "Bundle", CFGMGR_BUNDLE_VERSION) == NULL ||
+            cJSON_AddBoolToObject(bundle->root, "DevMode", dev_mode) == NULL ||
+            cJSON_AddObjectToObject(bundle->root, "Keys") == NULL ||
+            cJSON_AddObjectToObject(bundle->root, "Apps") == NULL) {
+        LOG_ERROR_0("Failed to allocate the bundle");
+        goto err;
+    }
+
+    if (count == 0) {
+        // Every key is read, applications are those with interfaces
+        keys[key_count] = strdup("/");
+        prefixes[key_count++] = true;
+    } else {
+        keys[key_count] = strdup("/GlobalEnv/");
+        prefixes[key_count++] = false;
+        if (!dev_mode) {
+            keys[key_count] = strdup(PUBLIC_KEYS);
+            prefixes[key_count++] = true;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (bundle_queue_app(keys, prefixes, &key_count, app_names[i], dev_mode) != 0) {
+                goto err;
+            }
+        }
+    }
+    for (size_t i = 0; i < key_count; i++) {
+        if (keys[i] == NULL) {
+            LOG_ERROR_0("Failed to copy the keys to bake");
+            goto err;
+        }
+    }
+    LOG_INFO("Reading %zu keys and key prefixes to bake", key_count);
+    if (bundle_fetch(client, handle, keys, prefixes, key_count, &fetch) != 0) {
+        goto err;
+    }
+
+    if (count == 0) {
+        cJSON* item = NULL;
+        cJSON_ArrayForEach(item, fetch.values) {
+            const char* name = item->string + 1;
+            const char* end = strchr(name, '/');
+            if (item->string[0] != '/' || end == NULL || end == name ||
+                    strcmp(end, "/interfaces") != 0) {
+                continue;
+            }
+            char* copy = strndup(name, (size_t) (end - name));
+            cJSON* app_name = (copy != NULL) ? cJSON_CreateString(copy) : NULL;
+            free(copy);
+            if (app_name == NULL) {
+                LOG_ERROR_0("Failed to copy AppName");
+                goto err;
+            }
+            cJSON_AddItemToArray(names, app_name);
+        }
+        if (cJSON_GetArraySize(names) == 0) {
+            LOG_ERROR_0("No application with interfaces found in the kv_store");
+            goto err;
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            cJSON_AddItemToArray(names, cJSON_CreateString(app_names[i]));
+        }
+    }
+
+    // Only the keys the applications read are baked
+    cJSON* baked = cJSON_GetObjectItemCaseSensitive(bundle->root, "Keys");
+    if (bundle_keep(baked, fetch.values, "/GlobalEnv/") != 0) {
+        goto err;
+    }
+    cJSON* name = NULL;
+    cJSON_ArrayForEach(name, names) {
+        const char* suffixes[] = { "/interfaces", "/config", PRIVATE_KEY };
+        for (size_t i = 0; i < (dev_mode ? 2u : 3u); i++) {
+            char* key = bundle_app_key(name->valuestring, suffixes[i]);
+            if (key == NULL || bundle_keep(baked, fetch.values, key) != 0) {
+                free(key);
+                goto err;
+            }
+            free(key);
+        }
+    }
+    if (!dev_mode) {
+        cJSON* item = NULL;
+        cJSON_ArrayForEach(item, fetch.values) {
+            if (bundle_has_prefix(item->string, PUBLIC_KEYS) &&
+                    bundle_keep(baked, fetch.values, item->string) != 0) {
+                goto err;
+            }
+        }
+    }
+
+    cJSON_ArrayForEach(name, names) {
+        if (bundle_resolve(bundle, name->valuestring) != 0) {
+            goto err;
+        }
+    }
+    LOG_INFO("Baked %d applications and %d keys", cJSON_GetArraySize(names),
+             cJSON_GetArraySize(baked));
+
+    // We should add all success-path code above this line
+    ret_val = true;
+
+err:
+    if (!ret_val) {
+        cfgmgr_bundle_destroy(bundle);
+        bundle = NULL;
+    }
+    if (keys != NULL) {
+        for (size_t i = 0; i < key_count; i++) {
+            free(keys[i]);
+        }
+        free(keys);
+    }
+    free(prefixes);
+    cJSON_Delete(names);
+    cJSON_Delete(fetch.values);
+    return bundle;
+}
+
+cfgmgr_bundle_t* cfgmgr_bundle_app(const cfgmgr_bundle_t* bundle, const char* app_name) {
+    cfgmgr_bundle_t* app_bundle = NULL;
+    bool ret_val = false;
+
+    cJSON* apps = cJSON_GetObjectItemCaseSensitive(bundle->root, "Apps");
+    cJSON* app = cJSON_GetObjectItemCaseSensitive(apps, app_name);
+    if (app == NULL) {
+        LOG_ERROR("%s is not an application of the bundle", app_name);
+        return NULL;
+    }
+    app_bundle = (cfgmgr_bundle_t*) calloc(1, sizeof(cfgmgr_bundle_t));
+    if (app_bundle == NULL) {
+        LOG_ERROR_0("Failed to allocate the bundle");
+        goto err;
+    }
+    app_bundle->root = cJSON_CreateObject();
+    cJSON* app_copy = cJSON_Duplicate(app, true);
+    cJSON* app_apps = NULL;
+    cJSON* app_keys = NULL;
+    if (app_bundle->root == NULL || app_copy == NULL ||
+            cJSON_AddNumberToObject(app_bundle->root, "Bundle", CFGMGR_BUNDLE_VERSION) == NULL ||
+            cJSON_AddBoolToObject(app_bundle->root, "DevMode", cfgmgr_bundle_dev_mode(bundle)) == NULL ||
+            (app_keys = cJSON_AddObjectToObject(app_bundle->root, "Keys")) == NULL ||
+            (app_apps = cJSON_AddObjectToObject(app_bundle->root, "Apps")) == NULL) {
+        cJSON_Delete(app_copy);
+        LOG_ERROR_0("Failed to allocate the bundle");
+        goto err;
+    }
+    cJSON_AddItemToObject(app_apps, app_name, app_copy);
+
+    // The keys the application reads, its private key being the only one
+    cJSON* keys = cJSON_GetObjectItemCaseSensitive(bundle->root, "Keys");
+    if (bundle_keep(app_keys, keys, "/GlobalEnv/") != 0) {
+        goto err;
+    }
+    const char* suffixes[] = { "/interfaces", "/config", PRIVATE_KEY };
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        char* key = bundle_app_key(app_name, suffixes[i]);
+        if (key == NULL || bundle_keep(app_keys, keys, key) != 0) {
+            free(key);
+            goto err;
+        }
+        free(key);
+    }
+    cJSON* item = NULL;
+    cJSON_ArrayForEach(item, keys) {
+        if (bundle_has_prefix(item->string, PUBLIC_KEYS) &&
+                bundle_keep(app_keys, keys, item->string) != 0) {
+            goto err;
+        }
+    }
+
+    // We should add all success-path code above this line
+    ret_val = true;
+
+err:
+    if (!ret_val) {
+        cfgmgr_bundle_destroy(app_bundle);
+        app_bundle = NULL;
+    }
+    return app_bundle;
+}
+
+int cfgmgr_bundle_write(const cfgmgr_bundle_t* bundle, const char* path,
+                        const unsigned char* key) {
+    void* encoded = NULL;
+    void* buf = NULL;
+    char* tmp_path = NULL;
+    size_t encoded_size = 0;
+    size_t size = 0;
+    int fd = -1;
+    int ret = -1;
+
+    // Private keys are only written encrypted, each to the bundle of
+    // the application it belongs to
+    if (!cfgmgr_bundle_dev_mode(bundle)) {
+        if (key == NULL) {
+            LOG_ERROR("Bundles baked in prod mode are encrypted, no key given for %s", path);
+            goto err;
+        }
+        if (cfgmgr_bundle_app_count(bundle) != 1) {
+            LOG_ERROR("Bundles baked in prod mode hold one application, %s would hold %zu",
+                      path, cfgmgr_bundle_app_count(bundle));
+            goto err;
+        }
+    }
+    encoded = cfgmgr_binary_encode(bundle->root, &encoded_size);
+    if (encoded == NULL) {
+        LOG_ERROR_0("Failed to encode the bundle");
+        goto err;
+    }
+    buf = cfgmgr_seal(BUNDLE_MAGIC, CFGMGR_BUNDLE_VERSION, key, encoded, encoded_size, &size);
+    if (buf == NULL) {
+        LOG_ERROR_0("Failed to seal the bundle");
+        goto err;
+    }
+    size_t tmp_len = strlen(path) + strlen(".tmp") + 1;
+    tmp_path = concat_s(tmp_len, 2, path, ".tmp");
+    if (tmp_path == NULL) {
+        LOG_ERROR_0("Concatenation of the bundle path and .tmp failed");
+        goto err;
+    }
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create %s: %s", tmp_path, strerror(errno));
+        goto err;
+    }
+    for (size_t written = 0; written < size;) {
+        ssize_t rc = write(fd, (const char*) buf + written, size - written);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            LOG_ERROR("Failed to write %s: %s", tmp_path, strerror(errno));
+            goto err;
+        }
+        written += (size_t) rc;
+    }
+    // The bundle is replaced only once complete on disk
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        fd = -1;
+        LOG_ERROR("Failed to flush %s: %s", tmp_path, strerror(errno));
+        goto err;
+    }
+    fd = -1;
+    if (rename(tmp_path, path) != 0) {
+        LOG_ERROR("Failed to replace %s: %s", path, strerror(errno));
+        goto err;
+    }
+    ret = 0;
+
+err:
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (ret != 0 && tmp_path != NULL) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    if (encoded != NULL) {
+        OPENSSL_cleanse(encoded, encoded_size);
+        free(encoded);
+    }
+    free(buf);
+    return ret;
+}
+
+cfgmgr_bundle_t* cfgmgr_bundle_read(const char* path, const unsigned char* key) {
+    cfgmgr_bundle_t* bundle = NULL;
+    char* buf = NULL;
+    void* data = NULL;
+    size_t data_size = 0;
+    cJSON* root = NULL;
+    struct stat st;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size > CFGMGR_BUNDLE_MAX_SIZE) {
+        LOG_ERROR("%s is not a valid bundle", path);
+        goto err;
+    }
+    buf = (char*) malloc((size_t) st.st_size + 1);
+    if (buf == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for the bundle");
+        goto err;
+    }
+    size_t size = 0;
+    while (size < (size_t) st.st_size) {
+        ssize_t rc = read(fd, buf + size, (size_t) st.st_size - size);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            LOG_ERROR("Failed to read %s", path);
+            goto err;
+        }
+        size += (size_t) rc;
+    }
+    data = cfgmgr_seal_open(BUNDLE_MAGIC, CFGMGR_BUNDLE_VERSION, key, buf, size, &data_size, path);
+    if (data == NULL) {
+        LOG_ERROR("%s is not a bundle of version %d sealed with the key given", path,
+                  CFGMGR_BUNDLE_VERSION);
+        goto err;
+    }
+    root = cfgmgr_binary_decode(cfgmgr_binary_root(data, data_size));
+    cJSON* version = cJSON_GetObjectItemCaseSensitive(root, "Bundle");
+    if (!cJSON_IsNumber(version) ||
+            !cJSON_IsBool(cJSON_GetObjectItemCaseSensitive(root, "DevMode")) ||
+            !cJSON_IsObject(cJSON_GetObjectItemCaseSensitive(root, "Keys")) ||
+            !cJSON_IsObject(cJSON_GetObjectItemCaseSensitive(root, "Apps"))) {
+        LOG_ERROR("%s is not a valid bundle", path);
+        goto err;
+    }
+    if (version->valueint != CFGMGR_BUNDLE_VERSION) {
+        LOG_ERROR("%s is a bundle of version %d, expected %d", path, version->valueint,
+                  CFGMGR_BUNDLE_VERSION);
+        goto err;
+    }
+    bundle = (cfgmgr_bundle_t*) calloc(1, sizeof(cfgmgr_bundle_t));
+    if (bundle == NULL) {
+        LOG_ERROR_0("Failed to allocate the bundle");
+        goto err;
+    }
+    bundle->root = root;
+    root = NULL;
+
+err:
+    close(fd);
+    free(buf);
+    if (data != NULL) {
+        OPENSSL_cleanse(data, data_size);
+        free(data);
+    }
+    cJSON_Delete(root);
+    return bundle;
+}
+
+bool cfgmgr_bundle_dev_mode(const cfgmgr_bundle_t* bundle) {
+    return cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(bundle->root, "DevMode"));
+}
+
+size_t cfgmgr_bundle_app_count(const cfgmgr_bundle_t* bundle) {
+    return (size_t) cJSON_GetArraySize(cJSON_GetObjectItemCaseSensitive(bundle->root, "Apps"));
+}
+
+const char* cfgmgr_bundle_app_name(const cfgmgr_bundle_t* bundle, size_t index) {
+    cJSON* apps = cJSON_GetObjectItemCaseSensitive(bundle->root, "Apps");
+    cJSON* app = cJSON_GetArrayItem(apps, (int) index);
+    return (app != NULL) ? app->string : NULL;
+}
+
+kv_store_client_t* cfgmgr_bundle_kv_client(const cfgmgr_bundle_t* bundle) {
+    cJSON* keys = cJSON_Duplicate(cJSON_GetObjectItemCaseSensitive(bundle->root, "Keys"), true);
+    if (keys == NULL) {
+        LOG_ERROR_0("Failed to copy the bundle keys");
+        return NULL;
+    }
+    config_t* values = config_new((void*) keys, free_json, get_config_value, set_config_value);
+    if (values == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(keys);
+        return NULL;
+    }
+    // On failure too, the client takes ownership of values
+    return kv_store_bundle_new(values);
+}
+
+config_t* cfgmgr_bundle_msgbus_config(const cfgmgr_bundle_t* bundle, const char* app_name,
+                                      cfgmgr_iface_type_t type, int index) {
+    if ((size_t) type >= BUNDLE_IFACE_TYPES) {
+        return NULL;
+    }
+    cJSON* apps = cJSON_GetObjectItemCaseSensitive(bundle->root, "Apps");
+    cJSON* configs = cJSON_GetObjectItemCaseSensitive(
+            cJSON_GetObjectItemCaseSensitive(apps, app_name), bundle_iface_keys[type]);
+    cJSON* baked = cJSON_GetArrayItem(configs, index);
+    if (!cJSON_IsObject(baked)) {
+        return NULL;
+    }
+    cJSON* json = cJSON_Duplicate(baked, true);
+    if (json == NULL) {
+        LOG_ERROR_0("Failed to copy the baked msgbus config");
+        return NULL;
+    }
+    config_t* config = config_new((void*) json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(json);
+    }
+    return config;
+}
+
+void cfgmgr_bundle_destroy(cfgmgr_bundle_t* bundle) {
+    if (bundle == NULL) {
+        return;
+    }
+    cJSON_Delete(bundle->root);
+    free(bundle);
+}
@@ -0,0 +1,452 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Structural diff of ConfigManager documents implementation
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_diff.h"
+
+// Interface arrays, in cfgmgr_iface_type_t order
+static const char* const DIFF_IFACE_ARRAYS[] = {
+    "Publishers", "Subscribers", "Servers", "Clients"
+};
+
+typedef struct {
+    cfgmgr_changes_t* changes;
+    size_t cap;
+
+    // Interface the changes being added belong to
+    bool iface;
+    cfgmgr_iface_type_t iface_type;
+    const char* iface_name;
+} diff_t;
+
+// Copy of str, NULL only if str is NULL; sets *failed if the copy fails
+static char* diff_strdup(const char* str, bool* failed) {
+    if (str == NULL) {
+        return NULL;
+    }
+    char* copy = strdup(str);
+    if (copy == NULL) {
+        *failed = true;
+    }
+    return copy;
+}
+
+static char* diff_print(const cJSON* value, bool* failed) {
+    if (value == NULL) {
+        return NULL;
+    }
+    char* json = cJSON_PrintUnformatted(value);
+    if (json == NULL) {
+        *failed = true;
+    }
+    return json;
+}
+
+static void diff_change_free(cfgmgr_change_t* change) {
+    free((char*) change->path);
+    free((char*) change->iface_name);
+    free((char*) change->field);
+    free((char*) change->item);
+    // Printed by cJSON
+    cJSON_free((char*) change->old_value);
+    cJSON_free((char*) change->new_value);
+}
+
+static int diff_add(diff_t* diff, cfgmgr_change_kind_t kind, const char* path,
+                    const char* field, const char* item,
+                    const cJSON* old_value, const cJSON* new_value) {
+    cfgmgr_changes_t* changes = diff->changes;
+    if (changes->count == diff->cap) {
+        size_t cap = (diff->cap == 0) ? 8 : diff->cap * 2;
+        cfgmgr_change_t* grown = (cfgmgr_change_t*) realloc(
+                changes->changes, cap * sizeof(cfgmgr_change_t));
+        if (grown == NULL) {
+            LOG_ERROR_0("Failed to grow list of changes");
+            return -1;
+        }
+        changes->changes = grown;
+        diff->cap = cap;
+    }
+
+    bool failed = false;
+    cfgmgr_change_t* change = &changes->changes[changes->count];
+    change->kind = kind;
+    change->iface = diff->iface;
+    change->iface_type = diff->iface_type;
+    change->path = diff_strdup(path, &failed);
+    change->iface_name = diff_strdup(diff->iface_name, &failed);
+    change->field = diff_strdup(field, &failed);
+    change->item = diff_strdup(item, &failed);
+    change->old_value = diff_print(old_value, &failed);
+    change->new_value = diff_print(new_value, &failed);
+    if (failed) {
+        LOG_ERROR("Failed to record change of %s", path);
+        diff_change_free(change);
+        return -1;
+    }
+    changes->count++;
+    return 0;
+}
+
+// "<path>.<key>", or key for the root
+static char* diff_join(const char* path, const char* key) {
+    size_t path_len = strlen(path);
+    size_t len = path_len + strlen(key) + 2;
+    char* joined = (char*) malloc(len);
+    if (joined == NULL) {
+        LOG_ERROR_0("Malloc failed for change path");
+        return NULL;
+    }
+    if (path_len == 0) {
+        snprintf(joined, len, "%s", key);
+    } else {
+        snprintf(joined, len, "%s.%s", path, key);
+    }
+    return joined;
+}
+
+static int diff_values(diff_t* diff, const char* path, const cJSON* old_value,
+                       const cJSON* new_value) {
+    if (!cJSON_IsObject(old_value) || !cJSON_IsObject(new_value)) {
+        if (cJSON_Compare(old_value, new_value, true)) {
+            return 0;
+        }
+        return diff_add(diff, CFGMGR_CHANGE_MODIFIED, path, NULL, NULL, old_value, new_value);
+    }
+
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, old_value) {
+        char* item_path = diff_join(path, item->string);
+        if (item_path == NULL) {
+            return -1;
+        }
+        const cJSON* other = cJSON_GetObjectItemCaseSensitive(new_value, item->string);
+        int rc = (other == NULL)
+            ? diff_add(diff, CFGMGR_CHANGE_REMOVED, item_path, NULL, NULL, item, NULL)
+            : diff_values(diff, item_path, item, other);
+        free(item_path);
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    cJSON_ArrayForEach(item, new_value) {
+        if (cJSON_GetObjectItemCaseSensitive(old_value, item->string) != NULL) {
+            continue;
+        }
+        char* item_path = diff_join(path, item->string);
+        if (item_path == NULL) {
+            return -1;
+        }
+        int rc = diff_add(diff, CFGMGR_CHANGE_ADDED, item_path, NULL, NULL, NULL, item);
+        free(item_path);
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static bool diff_is_string_array(const cJSON* value) {
+    if (!cJSON_IsArray(value)) {
+        return false;
+    }
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, value) {
+        if (!cJSON_IsString(item)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool diff_has_string(const cJSON* array, const char* str) {
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, array) {
+        if (strcmp(item->valuestring, str) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Topics and AllowedClients are sets: report the entries added and removed
+static int diff_string_sets(diff_t* diff, const char* path, const char* field,
+                            const cJSON* old_value, const cJSON* new_value) {
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, old_value) {
+        if (!diff_has_string(new_value, item->valuestring) &&
+                diff_add(diff, CFGMGR_CHANGE_REMOVED, path, field, item->valuestring,
+                         item, NULL) != 0) {
+            return -1;
+        }
+    }
+    cJSON_ArrayForEach(item, new_value) {
+        if (!diff_has_string(old_value, item->valuestring) &&
+                diff_add(diff, CFGMGR_CHANGE_ADDED, path, field, item->valuestring,
+                         NULL, item) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int diff_iface_field(diff_t* diff, const char* path, const char* field,
+                            const cJSON* old_value, const cJSON* new_value) {
+    char* field_path = diff_join(path, field);
+    if (field_path == NULL) {
+        return -1;
+    }
+    int rc = 0;
+    if (old_value == NULL) {
+        rc = diff_add(diff, CFGMGR_CHANGE_ADDED, field_path, field, NULL, NULL, new_value);
+    } else if (new_value == NULL) {
+        rc = diff_add(diff, CFGMGR_CHANGE_REMOVED, field_path, field, NULL, old_value, NULL);
+    } else if ((strcmp(field, "Topics") == 0 || strcmp(field, "AllowedClients") == 0) &&
+               diff_is_string_array(old_value) && diff_is_string_array(new_value)) {
+        rc = diff_string_sets(diff, field_path, field, old_value, new_value);
+    } else if (!cJSON_Compare(old_value, new_value, true)) {
+        rc = diff_add(diff, CFGMGR_CHANGE_MODIFIED, field_path, field, NULL, old_value, new_value);
+    }
+    free(field_path);
+    return rc;
+}
+
+static int diff_iface(diff_t* diff, const char* path, const cJSON* old_iface,
+                      const cJSON* new_iface) {
+    if (!cJSON_IsObject(old_iface) || !cJSON_IsObject(new_iface)) {
+        if (cJSON_Compare(old_iface, new_iface, true)) {
+            return 0;
+        }
+        return diff_add(diff, CFGMGR_CHANGE_MODIFIED, path, NULL, NULL, old_iface, new_iface);
+    }
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, old_iface) {
+        if (diff_iface_field(diff, path, item->string, item,
+                    cJSON_GetObjectItemCaseSensitive(new_iface, item->string)) != 0) {
+            return -1;
+        }
+    }
+    cJSON_ArrayForEach(item, new_iface) {
+        if (cJSON_GetObjectItemCaseSensitive(old_iface, item->string) == NULL &&
+                diff_iface_field(diff, path, item->string, NULL, item) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static const char* diff_iface_name(const cJSON* iface) {
+    const cJSON* name = cJSON_GetObjectItemCaseSensitive(iface, "Name");
+    return cJSON_IsString(name) ? name->valuestring : NULL;
+}
+
+// Interface of the new array matching an interface of the previous one: the
+// first one not matched yet with the same Name, or without Name the one at
+// the same position if it has no Name either
+static int diff_match_iface(const cJSON* array, const char* name, int index, bool* matched) {
+    int count = cJSON_GetArraySize(array);
+    if (name == NULL) {
+        if (index < count && !matched[index] &&
+                diff_iface_name(cJSON_GetArrayItem(array, index)) == NULL) {
+            return index;
+        }
+        return -1;
+    }
+    int i = 0;
+    const cJSON* iface = NULL;
+    cJSON_ArrayForEach(iface, array) {
+        const char* other = diff_iface_name(iface);
+        if (!matched[i] && other != NULL && strcmp(other, name) == 0) {
+            return i;
+        }
+        i++;
+    }
+    return -1;
+}
+
+// "<Publishers|...>.<Name>", or "<Publishers|...>[<i>]" without Name
+static char* diff_iface_path(const char* array_key, const char* name, int index) {
+    if (name != NULL) {
+        return diff_join(array_key, name);
+    }
+    char position[16];
+    snprintf(position, sizeof(position), "[%d]", index);
+    size_t len = strlen(array_key) + strlen(position) + 1;
+    char* path = (char*) malloc(len);
+    if (path == NULL) {
+        LOG_ERROR_0("Malloc failed for change path");
+        return NULL;
+    }
+    snprintf(path, len, "%s%s", array_key, position);
+    return path;
+}
+
+static int diff_iface_array(diff_t* diff, cfgmgr_iface_type_t type, const cJSON* old_array,
+                            const cJSON* new_array) {
+    int ret_val = -1;
+    char* path = NULL;
+    const char* array_key = DIFF_IFACE_ARRAYS[type];
+    if (!cJSON_IsArray(old_array)) {
+        old_array = NULL;
+    }
+    if (!cJSON_IsArray(new_array)) {
+        new_array = NULL;
+    }
+    int new_count = cJSON_GetArraySize(new_array);
+    bool* matched = (bool*) calloc(new_count + 1, sizeof(bool));
+    if (matched == NULL) {
+        LOG_ERROR_0("Calloc failed for matched interfaces");
+        return -1;
+    }
+    diff->iface = true;
+    diff->iface_type = type;
+
+    int i = 0;
+    const cJSON* iface = NULL;
+    cJSON_ArrayForEach(iface, old_array) {
+        diff->iface_name = diff_iface_name(iface);
+        path = diff_iface_path(array_key, diff->iface_name, i);
+        if (path == NULL) {
+            goto err;
+        }
+        int match = diff_match_iface(new_array, diff->iface_name, i, matched);
+        if (match < 0) {
+            if (diff_add(diff, CFGMGR_CHANGE_REMOVED, path, NULL, NULL, iface, NULL) != 0) {
+                goto err;
+            }
+        } else {
+            matched[match] = true;
+            if (diff_iface(diff, path, iface, cJSON_GetArrayItem(new_array, match)) != 0) {
+                goto err;
+            }
+        }
+        free(path);
+        path = NULL;
+        i++;
+    }
+
+    i = 0;
+    cJSON_ArrayForEach(iface, new_array) {
+        if (!matched[i]) {
+            diff->iface_name = diff_iface_name(iface);
+            path = diff_iface_path(array_key, diff->iface_name, i);
+            if (path == NULL) {
+                goto err;
+            }
+            if (diff_add(diff, CFGMGR_CHANGE_ADDED, path, NULL, NULL, NULL, iface) != 0) {
+                goto err;
+            }
+            free(path);
+            path = NULL;
+        }
+        i++;
+    }
+
+    // We should add all success-path code above this line
+    ret_val = 0;
+err:
+    if (path != NULL) {
+        free(path);
+    }
+    diff->iface_name = NULL;
+    free(matched);
+    return ret_val;
+}
+
+static const cJSON* diff_document(const config_t* config) {
+    return (config != NULL) ? (const cJSON*) config->cfg : NULL;
+}
+
+static cfgmgr_changes_t* diff_changes_new() {
+    cfgmgr_changes_t* changes = (cfgmgr_changes_t*) calloc(1, sizeof(cfgmgr_changes_t));
+    if (changes == NULL) {
+        LOG_ERROR_0("Calloc failed for cfgmgr_changes_t");
+    }
+    return changes;
+}
+
+cfgmgr_changes_t* cfgmgr_diff_config(const config_t* old_config, const config_t* new_config) {
+    diff_t diff = {0};
+    diff.changes = diff_changes_new();
+    if (diff.changes == NULL) {
+        return NULL;
+    }
+    const cJSON* old_doc = diff_document(old_config);
+    const cJSON* new_doc = diff_document(new_config);
+    cJSON* empty = NULL;
+    if (old_doc == NULL || new_doc == NULL) {
+        empty = cJSON_CreateObject();
+        if (empty == NULL) {
+            LOG_ERROR_0("Failed to create empty config");
+            cfgmgr_changes_destroy(diff.changes);
+            return NULL;
+        }
+    }
+    int rc = diff_values(&diff, "", (old_doc != NULL) ? old_doc : empty,
+                         (new_doc != NULL) ? new_doc : empty);
+    if (empty != NULL) {
+        cJSON_Delete(empty);
+    }
+    if (rc != 0) {
+        cfgmgr_changes_destroy(diff.changes);
+        return NULL;
+    }
+    return diff.changes;
+}
+
+cfgmgr_changes_t* cfgmgr_diff_interfaces(const config_t* old_interfaces,
+                                         const config_t* new_interfaces) {
+    diff_t diff = {0};
+    diff.changes = diff_changes_new();
+    if (diff.changes == NULL) {
+        return NULL;
+    }
+    const cJSON* old_doc = diff_document(old_interfaces);
+    const cJSON* new_doc = diff_document(new_interfaces);
+    for (int type = CFGMGR_PUBLISHER; type <= CFGMGR_CLIENT; type++) {
+        const char* array_key = DIFF_IFACE_ARRAYS[type];
+        if (diff_iface_array(&diff, (cfgmgr_iface_type_t) type,
+                    cJSON_GetObjectItemCaseSensitive(old_doc, array_key),
+                    cJSON_GetObjectItemCaseSensitive(new_doc, array_key)) != 0) {
+            cfgmgr_changes_destroy(diff.changes);
+            return NULL;
+        }
+    }
+    return diff.changes;
+}
+
+void cfgmgr_changes_destroy(cfgmgr_changes_t* changes) {
+    if (changes == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < changes->count; i++) {
+        diff_change_free(&changes->changes[i]);
+    }
+    free(changes->changes);
+    free(changes);
+}
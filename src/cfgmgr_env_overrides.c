@@ -0,0 +1,370 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Environment overrides of the ConfigManager implementation
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_env_overrides.h"
+#include "eii/config_manager/cfgmgr_json.h"
+
+extern char** environ;
+
+// Number of interface types and of fields overridden
+#define OVERRIDE_TYPE_COUNT     4
+#define OVERRIDE_FIELD_COUNT    2
+
+static const char* override_prefixes[OVERRIDE_TYPE_COUNT] = {
+    "PUBLISHER_", "SUBSCRIBER_", "SERVER_", "CLIENT_"
+};
+
+static const char* override_fields[OVERRIDE_FIELD_COUNT] = {
+    "ENDPOINT", "TYPE"
+};
+
+typedef struct {
+    uint32_t hash;
+    int type;
+    int field;
+    char* name;
+    char* value;
+} override_entry_t;
+
+// Immutable once published
+typedef struct override_gen {
+    // <TYPE>_ENDPOINT and <TYPE>_TYPE
+    char* globals[OVERRIDE_TYPE_COUNT][OVERRIDE_FIELD_COUNT];
+    // <TYPE>_<Name>_*, power of two sized, linear probing
+    override_entry_t* entries;
+    size_t capacity;
+} override_gen_t;
+
+struct cfgmgr_env_overrides {
+    cfgmgr_gens_t* gens;
+    // Serializes loads
+    pthread_mutex_t mtx;
+    // NULL terminated <KEY>=<value> entries of /GlobalEnv/ scanned after
+    // the environment, NULL if none is kept
+    char** global_env;
+};
+
+// Hash of the name, mixed with the type and field
+static uint32_t override_hash(int type, int field, const char* name, size_t len) {
+    return cfgmgr_gen_hash(name, len, (uint32_t) (type * OVERRIDE_FIELD_COUNT + field + 1));
+}
+
+static void override_gen_destroy(override_gen_t* gen) {
+    for (int t = 0; t < OVERRIDE_TYPE_COUNT; t++) {
+        for (int f = 0; f < OVERRIDE_FIELD_COUNT; f++) {
+            free(gen->globals[t][f]);
+        }
+    }
+    for (size_t i = 0; i < gen->capacity; i++) {
+        free(gen->entries[i].name);
+        free(gen->entries[i].value);
+    }
+    free(gen->entries);
+    free(gen);
+}
+
+static void override_gen_free(void* gen) {
+    override_gen_destroy((override_gen_t*) gen);
+}
+
+/**
+ * Match an environment entry against <TYPE>_[<Name>_]<FIELD>=<value>
+ *
+ * @return true if it is a non empty override, with the name set to NULL for
+ *         the override of every interface of the type
+ */
+static bool override_match(const char* env, int* type, int* field,
+                           const char** name, size_t* name_len, const char** value) {
+    const char* eq = strchr(env, '=');
+    if (eq == NULL || eq[1] == '\0') {
+        return false;
+    }
+    for (int t = 0; t < OVERRIDE_TYPE_COUNT; t++) {
+        size_t prefix_len = strlen(override_prefixes[t]);
+        if (strncmp(env, override_prefixes[t], prefix_len) != 0) {
+            continue;
+        }
+        const char* rest = env + prefix_len;
+        size_t rest_len = eq - rest;
+        for (int f = 0; f < OVERRIDE_FIELD_COUNT; f++) {
+            size_t field_len = strlen(override_fields[f]);
+            if (rest_len == field_len && strncmp(rest, override_fields[f], field_len) == 0) {
+                *name = NULL;
+                *name_len = 0;
+            } else if (rest_len > field_len && rest[rest_len - field_len - 1] == '_' &&
+                    strncmp(rest + rest_len - field_len, override_fields[f], field_len) == 0) {
+                *name = rest;
+                *name_len = rest_len - field_len - 1;
+            } else {
+                continue;
+            }
+            *type = t;
+            *field = f;
+            *value = eq + 1;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+// Sets the override of an environment entry, if it is one, in a table
+// sized for it. Later entries replace earlier ones
+static int override_gen_set(override_gen_t* gen, const char* env) {
+    int type = 0;
+    int field = 0;
+    const char* name = NULL;
+    size_t name_len = 0;
+    const char* value = NULL;
+
+    if (!override_match(env, &type, &field, &name, &name_len, &value)) {
+        return 0;
+    }
+    char* value_copy = strdup(value);
+    if (value_copy == NULL) {
+        return -1;
+    }
+    if (name == NULL) {
+        free(gen->globals[type][field]);
+        gen->globals[type][field] = value_copy;
+        return 0;
+    }
+    size_t mask = gen->capacity - 1;
+    uint32_t hash = override_hash(type, field, name, name_len);
+    size_t slot = hash & mask;
+    while (gen->entries[slot].name != NULL) {
+        override_entry_t* entry = &gen->entries[slot];
+        if (entry->hash == hash && entry->type == type && entry->field == field &&
+                strlen(entry->name) == name_len && strncmp(entry->name, name, name_len) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    override_entry_t* entry = &gen->entries[slot];
+    if (entry->name == NULL) {
+        entry->name = strndup(name, name_len);
+        if (entry->name == NULL) {
+            free(value_copy);
+            return -1;
+        }
+    }
+    free(entry->value);
+    entry->hash = hash;
+    entry->type = type;
+    entry->field = field;
+    entry->value = value_copy;
+    return 0;
+}
+
+// Scans the environment, then the /GlobalEnv/ entries overriding it
+static override_gen_t* override_gen_new(char** global_env) {
+    char** sources[2] = {environ, global_env};
+    int type = 0;
+    int field = 0;
+    const char* name = NULL;
+    size_t name_len = 0;
+    const char* value = NULL;
+    size_t count = 0;
+
+    override_gen_t* gen = (override_gen_t*) calloc(1, sizeof(override_gen_t));
+    if (gen == NULL) {
+        LOG_ERROR_0("Failed to allocate env override table");
+        return NULL;
+    }
+    for (int s = 0; s < 2; s++) {
+        for (char** env = sources[s]; env != NULL && *env != NULL; env++) {
+            if (override_match(*env, &type, &field, &name, &name_len, &value) && name != NULL) {
+                count++;
+            }
+        }
+    }
+    gen->capacity = cfgmgr_gen_capacity(count);
+    gen->entries = (override_entry_t*) calloc(gen->capacity, sizeof(override_entry_t));
+    if (gen->entries == NULL) {
+        LOG_ERROR_0("Failed to allocate env override entries");
+        free(gen);
+        return NULL;
+    }
+
+    for (int s = 0; s < 2; s++) {
+        for (char** env = sources[s]; env != NULL && *env != NULL; env++) {
+            if (override_gen_set(gen, *env) != 0) {
+                goto err;
+            }
+        }
+    }
+    return gen;
+
+err:
+    LOG_ERROR_0("Failed to copy env override");
+    override_gen_destroy(gen);
+    return NULL;
+}
+
+cfgmgr_env_overrides_t* cfgmgr_env_overrides_new() {
+    cfgmgr_env_overrides_t* overrides = (cfgmgr_env_overrides_t*) malloc(sizeof(cfgmgr_env_overrides_t));
+    if (overrides == NULL) {
+        LOG_ERROR_0("Malloc failed for cfgmgr_env_overrides_t");
+        return NULL;
+    }
+    overrides->global_env = NULL;
+    overrides->gens = cfgmgr_gens_new(override_gen_free);
+    if (overrides->gens == NULL) {
+        free(overrides);
+        return NULL;
+    }
+    if (pthread_mutex_init(&overrides->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize env override mutex");
+        cfgmgr_gens_destroy(overrides->gens);
+        free(overrides);
+        return NULL;
+    }
+    return overrides;
+}
+
+// Publishes a table of the environment and /GlobalEnv/ kept, with the
+// lock of the table held
+static int override_publish(cfgmgr_env_overrides_t* overrides) {
+    override_gen_t* gen = override_gen_new(overrides->global_env);
+    if (gen == NULL) {
+        return -1;
+    }
+    if (cfgmgr_gens_publish(overrides->gens, gen) != 0) {
+        override_gen_destroy(gen);
+        return -1;
+    }
+    return 0;
+}
+
+int cfgmgr_env_overrides_load(cfgmgr_env_overrides_t* overrides) {
+    pthread_mutex_lock(&overrides->mtx);
+    int ret = override_publish(overrides);
+    pthread_mutex_unlock(&overrides->mtx);
+    return ret;
+}
+
+static void global_env_free(char** global_env) {
+    for (char** entry = global_env; entry != NULL && *entry != NULL; entry++) {
+        free(*entry);
+    }
+    free(global_env);
+}
+
+// Stores a /GlobalEnv/ member as <KEY>=<value> at the cursor of an array
+// sized for every member, and moves the cursor past it
+static int global_env_append(const char* key, const char* value, void* user_data) {
+    char*** cursor = (char***) user_data;
+    size_t len = strlen(key) + 1 + strlen(value) + 1;
+    char* entry = (char*) malloc(len);
+    if (entry == NULL) {
+        return -1;
+    }
+    snprintf(entry, len, "%s=%s", key, value);
+    **cursor = entry;
+    (*cursor)++;
+    return 0;
+}
+
+int cfgmgr_env_overrides_load_global_env(cfgmgr_env_overrides_t* overrides, const char* global_env) {
+    size_t len = strlen(global_env);
+    int count = cfgmgr_json_each_member(global_env, len, NULL, NULL);
+    if (count < 0) {
+        LOG_ERROR_0("/GlobalEnv/ is not a valid JSON object");
+        return -1;
+    }
+    char** entries = (char**) calloc((size_t) count + 1, sizeof(char*));
+    char** cursor = entries;
+    if (entries == NULL ||
+            cfgmgr_json_each_member(global_env, len, global_env_append, &cursor) < 0) {
+        LOG_ERROR_0("Failed to copy /GlobalEnv/ entries");
+        global_env_free(entries);
+        return -1;
+    }
+    pthread_mutex_lock(&overrides->mtx);
+    char** previous = overrides->global_env;
+    overrides->global_env = entries;
+    int ret = override_publish(overrides);
+    if (ret != 0) {
+        overrides->global_env = previous;
+        previous = entries;
+    }
+    pthread_mutex_unlock(&overrides->mtx);
+    global_env_free(previous);
+    return ret;
+}
+
+cfgmgr_gen_guard_t cfgmgr_env_overrides_pin(cfgmgr_env_overrides_t* overrides) {
+    return cfgmgr_gens_pin(overrides->gens);
+}
+
+void cfgmgr_env_overrides_unpin(cfgmgr_env_overrides_t* overrides, cfgmgr_gen_guard_t* guard) {
+    cfgmgr_gens_unpin(overrides->gens, guard);
+}
+
+size_t cfgmgr_env_overrides_retired(cfgmgr_env_overrides_t* overrides) {
+    return cfgmgr_gens_retired(overrides->gens);
+}
+
+const char* cfgmgr_env_overrides_get(cfgmgr_env_overrides_t* overrides, cfgmgr_iface_type_t type,
+                                     const char* name, cfgmgr_override_field_t field) {
+    if ((int) type < 0 || (int) type >= OVERRIDE_TYPE_COUNT ||
+            (int) field < 0 || (int) field >= OVERRIDE_FIELD_COUNT) {
+        return NULL;
+    }
+    override_gen_t* gen = (override_gen_t*) cfgmgr_gens_current(overrides->gens);
+    if (gen == NULL) {
+        return NULL;
+    }
+    if (name == NULL) {
+        return gen->globals[type][field];
+    }
+    size_t name_len = strlen(name);
+    uint32_t hash = override_hash(type, field, name, name_len);
+    size_t mask = gen->capacity - 1;
+    for (size_t slot = hash & mask; gen->entries[slot].name != NULL; slot = (slot + 1) & mask) {
+        override_entry_t* entry = &gen->entries[slot];
+        if (entry->hash == hash && entry->type == (int) type && entry->field == (int) field &&
+                strcmp(entry->name, name) == 0) {
+            return entry->value;
+        }
+    }
+    return NULL;
+}
+
+void cfgmgr_env_overrides_destroy(cfgmgr_env_overrides_t* overrides) {
+    if (overrides == NULL) {
+        return;
+    }
+    cfgmgr_gens_destroy(overrides->gens);
+    global_env_free(overrides->global_env);
+    pthread_mutex_destroy(&overrides->mtx);
+    free(overrides);
+}
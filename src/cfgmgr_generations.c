@@ -0,0 +1,270 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Generations of the ConfigManager immutable tables
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_generations.h"
+
+// Number of readers which can pin a store at the same time
+#define GENS_READER_SLOTS   64
+
+typedef struct gen_node {
+    void* gen;
+    // References taken with cfgmgr_gens_ref(), under the store mutex
+    size_t refs;
+    // Epoch the generation was retired at
+    uint64_t retired_epoch;
+    // Next retired generation
+    struct gen_node* next;
+} gen_node_t;
+
+struct cfgmgr_gens {
+    cfgmgr_gen_free_t free_gen;
+    _Atomic(gen_node_t*) current;
+
+    // Bumped by every generation retired, starts at 1
+    atomic_uint_fast64_t epoch;
+
+    // Epoch each reader pinned at, 0 for a free slot
+    atomic_uint_fast64_t readers[GENS_READER_SLOTS];
+
+    // Serializes publishing, references and reclamation
+    pthread_mutex_t mtx;
+    gen_node_t* retired;
+    size_t retired_count;
+};
+
+// Slot the thread pinned with last, free unless it pins twice
+static _Thread_local size_t gens_slot_hint;
+
+static void gen_node_free(cfgmgr_gens_t* gens, gen_node_t* node) {
+    gens->free_gen(node->gen);
+    free(node);
+}
+
+// Frees the retired generations older than every pinned epoch which are
+// not referenced, with the mutex held
+static void gens_reclaim(cfgmgr_gens_t* gens) {
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < GENS_READER_SLOTS; i++) {
+        uint64_t epoch = atomic_load(&gens->readers[i]);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    gen_node_t** link = &gens->retired;
+    while (*link != NULL) {
+        gen_node_t* node = *link;
+        // Readers which pinned at the retiring epoch may still read it
+        if (node->retired_epoch < oldest && node->refs == 0) {
+            *link = node->next;
+            gen_node_free(gens, node);
+            gens->retired_count--;
+        } else {
+            link = &node->next;
+        }
+    }
+}
+
+// Node of a generation, with the mutex held
+static gen_node_t* gens_node(cfgmgr_gens_t* gens, const void* gen) {
+    gen_node_t* node = atomic_load_explicit(&gens->current, memory_order_relaxed);
+    if (node != NULL && node->gen == gen) {
+        return node;
+    }
+    for (node = gens->retired; node != NULL; node = node->next) {
+        if (node->gen == gen) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+cfgmgr_gens_t* cfgmgr_gens_new(cfgmgr_gen_free_t free_gen) {
+    cfgmgr_gens_t* gens = (cfgmgr_gens_t*) calloc(1, sizeof(cfgmgr_gens_t));
+    if (gens == NULL) {
+        LOG_ERROR_0("Calloc failed for cfgmgr_gens_t");
+        return NULL;
+    }
+    if (pthread_mutex_init(&gens->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize generations mutex");
+        free(gens);
+        return NULL;
+    }
+    gens->free_gen = free_gen;
+    atomic_init(&gens->current, NULL);
+    atomic_init(&gens->epoch, 1);
+    for (size_t i = 0; i < GENS_READER_SLOTS; i++) {
+        atomic_init(&gens->readers[i], 0);
+    }
+    return gens;
+}
+
+int cfgmgr_gens_publish(cfgmgr_gens_t* gens, void* gen) {
+    gen_node_t* node = (gen_node_t*) calloc(1, sizeof(gen_node_t));
+    if (node == NULL) {
+        LOG_ERROR_0("Calloc failed for generation");
+        return -1;
+    }
+    node->gen = gen;
+
+    pthread_mutex_lock(&gens->mtx);
+    gen_node_t* prev = atomic_load_explicit(&gens->current, memory_order_relaxed);
+    atomic_store(&gens->current, node);
+    if (prev != NULL) {
+        // Readers pinning from now on can only see the new generation
+        prev->retired_epoch = atomic_fetch_add(&gens->epoch, 1);
+        prev->next = gens->retired;
+        gens->retired = prev;
+        gens->retired_count++;
+    }
+    gens_reclaim(gens);
+    pthread_mutex_unlock(&gens->mtx);
+    return 0;
+}
+
+void* cfgmgr_gens_current(cfgmgr_gens_t* gens) {
+    gen_node_t* node = atomic_load(&gens->current);
+    return (node != NULL) ? node->gen : NULL;
+}
+
+cfgmgr_gen_guard_t cfgmgr_gens_pin(cfgmgr_gens_t* gens) {
+    cfgmgr_gen_guard_t guard;
+    for (;;) {
+        for (size_t i = 0; i < GENS_READER_SLOTS; i++) {
+            size_t slot = (gens_slot_hint + i) % GENS_READER_SLOTS;
+            uint_fast64_t free_slot = 0;
+            uint_fast64_t epoch = atomic_load(&gens->epoch);
+            if (atomic_load_explicit(&gens->readers[slot], memory_order_relaxed) == 0 &&
+                    atomic_compare_exchange_strong(&gens->readers[slot], &free_slot, epoch)) {
+                gens_slot_hint = slot;
+                guard.slot = (int) slot;
+                guard.gen = cfgmgr_gens_current(gens);
+                return guard;
+            }
+        }
+        // Every slot is pinned
+        sched_yield();
+    }
+}
+
+void cfgmgr_gens_unpin(cfgmgr_gens_t* gens, cfgmgr_gen_guard_t* guard) {
+    if (guard->slot < 0) {
+        return;
+    }
+    atomic_store_explicit(&gens->readers[guard->slot], 0, memory_order_release);
+    guard->slot = -1;
+    guard->gen = NULL;
+}
+
+int cfgmgr_gens_ref(cfgmgr_gens_t* gens, const void* gen) {
+    pthread_mutex_lock(&gens->mtx);
+    gen_node_t* node = gens_node(gens, gen);
+    if (node != NULL) {
+        node->refs++;
+    }
+    pthread_mutex_unlock(&gens->mtx);
+    if (node == NULL) {
+        LOG_ERROR_0("Referenced a generation the store does not hold");
+        return -1;
+    }
+    return 0;
+}
+
+void cfgmgr_gens_unref(cfgmgr_gens_t* gens, const void* gen) {
+    pthread_mutex_lock(&gens->mtx);
+    gen_node_t* node = gens_node(gens, gen);
+    if (node == NULL || node->refs == 0) {
+        LOG_ERROR_0("Released a generation which was not referenced");
+    } else if (--node->refs == 0 && node != atomic_load_explicit(&gens->current,
+                                                                 memory_order_relaxed)) {
+        gens_reclaim(gens);
+    }
+    pthread_mutex_unlock(&gens->mtx);
+}
+
+void* cfgmgr_gens_find(cfgmgr_gens_t* gens, cfgmgr_gen_match_t match, const void* arg) {
+    void* gen = NULL;
+    pthread_mutex_lock(&gens->mtx);
+    gen_node_t* node = atomic_load_explicit(&gens->current, memory_order_relaxed);
+    if (node != NULL && match(node->gen, arg)) {
+        gen = node->gen;
+    }
+    for (node = gens->retired; gen == NULL && node != NULL; node = node->next) {
+        if (match(node->gen, arg)) {
+            gen = node->gen;
+        }
+    }
+    pthread_mutex_unlock(&gens->mtx);
+    return gen;
+}
+
+size_t cfgmgr_gens_retired(cfgmgr_gens_t* gens) {
+    pthread_mutex_lock(&gens->mtx);
+    size_t count = gens->retired_count;
+    pthread_mutex_unlock(&gens->mtx);
+    return count;
+}
+
+uint32_t cfgmgr_gen_hash(const char* str, size_t len, uint32_t tag) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+    return hash ^ (tag * 0x9E3779B1u);
+}
+
+size_t cfgmgr_gen_capacity(size_t count) {
+    size_t capacity = 8;
+    while (capacity < count * 2) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+void cfgmgr_gens_destroy(cfgmgr_gens_t* gens) {
+    if (gens == NULL) {
+        return;
+    }
+    gen_node_t* node = atomic_load(&gens->current);
+    if (node != NULL) {
+        node->next = gens->retired;
+    } else {
+        node = gens->retired;
+    }
+    while (node != NULL) {
+        gen_node_t* next = node->next;
+        gen_node_free(gens, node);
+        node = next;
+    }
+    pthread_mutex_destroy(&gens->mtx);
+    free(gens);
+}
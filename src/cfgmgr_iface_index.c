@@ -0,0 +1,768 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Interface index of the ConfigManager implementation
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/json_config.h>
+#include "eii/config_manager/cfgmgr_iface_index.h"
+
+// Number of interface types indexed
+#define IFACE_TYPE_COUNT    4
+
+// Minimum size of a string arena chunk
+#define IFACE_CHUNK_SIZE    4096
+
+static const char* iface_arrays[IFACE_TYPE_COUNT] = {
+    "Publishers", "Subscribers", "Servers", "Clients"
+};
+
+typedef struct {
+    uint32_t hash;
+    const cfgmgr_iface_model_t* model;
+} iface_entry_t;
+
+typedef struct iface_chunk {
+    struct iface_chunk* next;
+    size_t used;
+    size_t size;
+    max_align_t data[];
+} iface_chunk_t;
+
+typedef struct {
+    // NULL when the array is absent from the interfaces document
+    cfgmgr_iface_model_t* models;
+    int count;
+} iface_array_t;
+
+// Immutable once published
+typedef struct iface_gen {
+    config_t* app_interface;
+    iface_array_t arrays[IFACE_TYPE_COUNT];
+
+    // (type, Name) lookup, power of two, linear probing
+    iface_entry_t* entries;
+    size_t capacity;
+
+    // Storage of the models' strings and lists
+    iface_chunk_t* chunks;
+
+    // Interned strings, power of two, linear probing
+    const char** strings;
+    size_t strings_capacity;
+    size_t strings_count;
+
+    // [""] array handed out for wildcard Topics
+    cJSON* wildcard;
+} iface_gen_t;
+
+struct cfgmgr_iface_index {
+    // One for the creator, plus one per referenced model or document, so
+    // that interfaces may outlive the context which created the index
+    atomic_size_t refs;
+    cfgmgr_gens_t* gens;
+    // Serializes updates and topics changes
+    pthread_mutex_t mtx;
+    // Generation of the interfaces returned last by
+    // cfgmgr_iface_index_app_interface(), referenced
+    iface_gen_t* handed_out;
+};
+
+static uint32_t str_hash(const char* str) {
+    return cfgmgr_gen_hash(str, strlen(str), 0);
+}
+
+// Hash of the name, mixed with the interface type
+static uint32_t iface_hash(cfgmgr_iface_type_t type, const char* name) {
+    return cfgmgr_gen_hash(name, strlen(name), (uint32_t) type + 1);
+}
+
+static void* gen_alloc(iface_gen_t* gen, size_t size) {
+    size_t align = sizeof(max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    iface_chunk_t* chunk = gen->chunks;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunk_size = (size > IFACE_CHUNK_SIZE) ? size : IFACE_CHUNK_SIZE;
+        chunk = (iface_chunk_t*) malloc(sizeof(iface_chunk_t) + chunk_size);
+        if (chunk == NULL) {
+            LOG_ERROR_0("Failed to allocate interface model storage");
+            return NULL;
+        }
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        chunk->next = gen->chunks;
+        gen->chunks = chunk;
+    }
+    void* ptr = (char*) chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+static bool gen_strings_grow(iface_gen_t* gen) {
+    size_t capacity = (gen->strings_capacity == 0) ? 64 : gen->strings_capacity * 2;
+    const char** strings = (const char**) calloc(capacity, sizeof(const char*));
+    if (strings == NULL) {
+        LOG_ERROR_0("Failed to allocate interned strings");
+        return false;
+    }
+    for (size_t i = 0; i < gen->strings_capacity; i++) {
+        const char* str = gen->strings[i];
+        if (str == NULL) {
+            continue;
+        }
+        size_t slot = str_hash(str) & (capacity - 1);
+        while (strings[slot] != NULL) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        strings[slot] = str;
+    }
+    free(gen->strings);
+    gen->strings = strings;
+    gen->strings_capacity = capacity;
+    return true;
+}
+
+// Single copy of each distinct string of a generation
+static const char* gen_intern(iface_gen_t* gen, const char* str) {
+    if ((gen->strings_count + 1) * 2 > gen->strings_capacity) {
+        if (!gen_strings_grow(gen)) {
+            return NULL;
+        }
+    }
+    size_t mask = gen->strings_capacity - 1;
+    size_t slot = str_hash(str) & mask;
+    while (gen->strings[slot] != NULL) {
+        if (strcmp(gen->strings[slot], str) == 0) {
+            return gen->strings[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    size_t len = strlen(str) + 1;
+    char* copy = (char*) gen_alloc(gen, len);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    gen->strings[slot] = copy;
+    gen->strings_count++;
+    return copy;
+}
+
+// Interned string value of key, NULL if absent. Sets bad in invalid if the
+// key holds anything but a string.
+static const char* compile_string(iface_gen_t* gen, cJSON* node, const char* key,
+                                  uint32_t bad, uint32_t* invalid) {
+    cJSON* item = cJSON_GetObjectItem(node, key);
+    if (item == NULL) {
+        return NULL;
+    }
+    if (!cJSON_IsString(item) || item->valuestring == NULL) {
+        *invalid |= bad;
+        return NULL;
+    }
+    return gen_intern(gen, item->valuestring);
+}
+
+// List of strings of an array key, NULL if absent or invalid
+static const cfgmgr_iface_strings_t* compile_strings(iface_gen_t* gen, cJSON* node,
+                                                     const char* key, uint32_t bad,
+                                                     uint32_t* invalid) {
+    cJSON* arr = cJSON_GetObjectItem(node, key);
+    if (arr == NULL) {
+        return NULL;
+    }
+    if (!cJSON_IsArray(arr)) {
+        *invalid |= bad;
+        return NULL;
+    }
+    size_t count = (size_t) cJSON_GetArraySize(arr);
+    cfgmgr_iface_strings_t* list = (cfgmgr_iface_strings_t*) gen_alloc(gen,
+            sizeof(cfgmgr_iface_strings_t) + count * sizeof(const char*));
+    if (list == NULL) {
+        return NULL;
+    }
+    list->items = (const char**) (list + 1);
+    list->count = 0;
+    cJSON* item = NULL;
+    cJSON_ArrayForEach(item, arr) {
+        if (!cJSON_IsString(item) || item->valuestring == NULL) {
+            *invalid |= bad;
+            return NULL;
+        }
+        list->items[list->count] = gen_intern(gen, item->valuestring);
+        if (list->items[list->count] == NULL) {
+            return NULL;
+        }
+        list->count++;
+    }
+    list->wildcard = (list->count == 1 && strcmp(list->items[0], "*") == 0);
+    list->array = arr;
+    return list;
+}
+
+static const cfgmgr_iface_strings_t* compile_topics(iface_gen_t* gen, cJSON* node,
+                                                    uint32_t* invalid) {
+    cfgmgr_iface_strings_t* topics = (cfgmgr_iface_strings_t*) compile_strings(
+            gen, node, "Topics", CFGMGR_IFACE_BAD_TOPICS, invalid);
+    if (topics != NULL && topics->wildcard) {
+        // The message bus subscribes to every topic with an empty prefix
+        topics->array = gen->wildcard;
+    }
+    return topics;
+}
+
+// Parses "host:port" of a zmq_tcp EndPoint the way the msgbus config
+// builders always have
+static void compile_host_port(iface_gen_t* gen, cfgmgr_iface_model_t* model) {
+    char** host_port = get_host_port(model->endpoint);
+    if (host_port == NULL) {
+        return;
+    }
+    char* host = host_port[0];
+    trim(host);
+    char* port = host_port[1];
+    trim(port);
+    model->host = gen_intern(gen, host);
+    model->port = atoi(port);
+    model->has_host_port = (model->host != NULL);
+    free_mem(host_port);
+}
+
+static bool compile_model(iface_gen_t* gen, cfgmgr_iface_model_t* model,
+                          cfgmgr_iface_type_t type, cJSON* node) {
+    uint32_t* invalid = &model->invalid;
+    model->iface_type = type;
+    model->node = node;
+
+    model->name = compile_string(gen, node, "Name", CFGMGR_IFACE_BAD_NAME, invalid);
+    model->type = compile_string(gen, node, "Type", CFGMGR_IFACE_BAD_TYPE, invalid);
+    if (model->type != NULL) {
+        if (strcmp(model->type, "zmq_tcp") == 0) {
+            model->transport = CFGMGR_TRANSPORT_ZMQ_TCP;
+        } else if (strcmp(model->type, "zmq_ipc") == 0) {
+            model->transport = CFGMGR_TRANSPORT_ZMQ_IPC;
+        }
+    }
+
+    cJSON* endpoint = cJSON_GetObjectItem(node, "EndPoint");
+    if (cJSON_IsString(endpoint) && endpoint->valuestring != NULL) {
+        model->endpoint = gen_intern(gen, endpoint->valuestring);
+        if (model->transport == CFGMGR_TRANSPORT_ZMQ_TCP && model->endpoint != NULL) {
+            compile_host_port(gen, model);
+        }
+    } else if (cJSON_IsObject(endpoint)) {
+        // Keep the printed object as well, which is what the ipc config
+        // helpers expect as the endpoint string
+        char* printed = cJSON_Print(endpoint);
+        if (printed == NULL) {
+            LOG_ERROR_0("Failed to print EndPoint object");
+            return false;
+        }
+        model->endpoint = gen_intern(gen, printed);
+        cJSON_free(printed);
+        model->endpoint_object = endpoint;
+    } else if (endpoint != NULL) {
+        *invalid |= CFGMGR_IFACE_BAD_ENDPOINT;
+    }
+
+    model->topics = compile_topics(gen, node, invalid);
+    model->allowed_clients = compile_strings(gen, node, "AllowedClients",
+                                             CFGMGR_IFACE_BAD_ALLOWED_CLIENTS, invalid);
+    model->broker_appname = compile_string(gen, node, "BrokerAppName",
+                                           CFGMGR_IFACE_BAD_BROKER_APPNAME, invalid);
+    model->publisher_appname = compile_string(gen, node, "PublisherAppName",
+                                              CFGMGR_IFACE_BAD_PUBLISHER_APPNAME, invalid);
+    model->server_appname = compile_string(gen, node, "ServerAppName",
+                                           CFGMGR_IFACE_BAD_SERVER_APPNAME, invalid);
+
+    // Same integer/floating split json_config makes for numbers
+    cJSON* hwm = cJSON_GetObjectItem(node, "zmq_recv_hwm");
+    if (cJSON_IsNumber(hwm) && hwm->valuedouble == (double) hwm->valueint) {
+        model->has_zmq_recv_hwm = true;
+        model->zmq_recv_hwm = hwm->valueint;
+    } else if (hwm != NULL) {
+        *invalid |= CFGMGR_IFACE_BAD_ZMQ_RECV_HWM;
+    }
+
+    cJSON* brokered = cJSON_GetObjectItem(node, "brokered");
+    if (cJSON_IsBool(brokered)) {
+        model->has_brokered = true;
+        model->brokered = cJSON_IsTrue(brokered);
+    } else if (brokered != NULL) {
+        *invalid |= CFGMGR_IFACE_BAD_BROKERED;
+    }
+    return true;
+}
+
+static void iface_gen_destroy(iface_gen_t* gen);
+
+static void iface_gen_free(void* gen) {
+    iface_gen_destroy((iface_gen_t*) gen);
+}
+
+// Whether the generation compiled the model
+static bool iface_gen_owns_model(const void* gen, const void* arg) {
+    const cfgmgr_iface_model_t* model = (const cfgmgr_iface_model_t*) arg;
+    const iface_array_t* array = &((const iface_gen_t*) gen)->arrays[model->iface_type];
+    return array->count > 0 && model >= array->models && model < array->models + array->count;
+}
+
+static bool iface_gen_owns_interfaces(const void* gen, const void* arg) {
+    return ((const iface_gen_t*) gen)->app_interface == (const config_t*) arg;
+}
+
+static void iface_gen_destroy(iface_gen_t* gen) {
+    for (int type = 0; type < IFACE_TYPE_COUNT; type++) {
+        if (gen->arrays[type].models != NULL) {
+            free(gen->arrays[type].models);
+        }
+    }
+    if (gen->entries != NULL) {
+        free(gen->entries);
+    }
+    while (gen->chunks != NULL) {
+        iface_chunk_t* next = gen->chunks->next;
+        free(gen->chunks);
+        gen->chunks = next;
+    }
+    if (gen->strings != NULL) {
+        free(gen->strings);
+    }
+    if (gen->wildcard != NULL) {
+        cJSON_Delete(gen->wildcard);
+    }
+    if (gen->app_interface != NULL) {
+        config_destroy(gen->app_interface);
+    }
+    free(gen);
+}
+
+static iface_gen_t* iface_gen_new(config_t* app_interface) {
+    cJSON* root = (cJSON*) app_interface->cfg;
+    size_t count = 0;
+    iface_gen_t* gen = (iface_gen_t*) calloc(1, sizeof(iface_gen_t));
+    if (gen == NULL) {
+        LOG_ERROR_0("Failed to allocate interface index");
+        return NULL;
+    }
+    gen->wildcard = cJSON_CreateArray();
+    if (gen->wildcard == NULL) {
+        LOG_ERROR_0("Failed to allocate wildcard topics");
+        goto err;
+    }
+    cJSON_AddItemToArray(gen->wildcard, cJSON_CreateString(""));
+
+    // Compile every interface, in document order
+    for (int type = 0; type < IFACE_TYPE_COUNT; type++) {
+        iface_array_t* array = &gen->arrays[type];
+        cJSON* arr = cJSON_GetObjectItem(root, iface_arrays[type]);
+        if (!cJSON_IsArray(arr)) {
+            array->count = -1;
+            continue;
+        }
+        array->count = cJSON_GetArraySize(arr);
+        array->models = (cfgmgr_iface_model_t*) calloc((array->count > 0) ? array->count : 1,
+                                                       sizeof(cfgmgr_iface_model_t));
+        if (array->models == NULL) {
+            LOG_ERROR_0("Failed to allocate interface models");
+            goto err;
+        }
+        int i = 0;
+        cJSON* node = NULL;
+        cJSON_ArrayForEach(node, arr) {
+            if (!compile_model(gen, &array->models[i++], (cfgmgr_iface_type_t) type, node)) {
+                goto err;
+            }
+        }
+        count += (size_t) array->count;
+    }
+
+    gen->capacity = cfgmgr_gen_capacity(count);
+    gen->entries = (iface_entry_t*) calloc(gen->capacity, sizeof(iface_entry_t));
+    if (gen->entries == NULL) {
+        LOG_ERROR_0("Failed to allocate interface index entries");
+        goto err;
+    }
+
+    size_t mask = gen->capacity - 1;
+    for (int type = 0; type < IFACE_TYPE_COUNT; type++) {
+        iface_array_t* array = &gen->arrays[type];
+        for (int i = 0; i < array->count; i++) {
+            const cfgmgr_iface_model_t* model = &array->models[i];
+            if (model->name == NULL) {
+                LOG_WARN("%s interface without a Name is not indexed", iface_arrays[type]);
+                continue;
+            }
+            uint32_t hash = iface_hash((cfgmgr_iface_type_t) type, model->name);
+            size_t slot = hash & mask;
+            bool duplicate = false;
+            while (gen->entries[slot].model != NULL) {
+                iface_entry_t* entry = &gen->entries[slot];
+                // Names are interned, so equal names share a pointer
+                if (entry->hash == hash && entry->model->iface_type == model->iface_type &&
+                        entry->model->name == model->name) {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            // First interface with a name wins, as with a scan
+            if (duplicate) {
+                LOG_WARN("Duplicate %s interface %s", iface_arrays[type], model->name);
+                continue;
+            }
+            gen->entries[slot].hash = hash;
+            gen->entries[slot].model = model;
+        }
+    }
+    gen->app_interface = app_interface;
+    return gen;
+
+err:
+    iface_gen_destroy(gen);
+    return NULL;
+}
+
+cfgmgr_iface_index_t* cfgmgr_iface_index_new() {
+    cfgmgr_iface_index_t* index = (cfgmgr_iface_index_t*) malloc(sizeof(cfgmgr_iface_index_t));
+    if (index == NULL) {
+        LOG_ERROR_0("Malloc failed for cfgmgr_iface_index_t");
+        return NULL;
+    }
+    index->gens = cfgmgr_gens_new(iface_gen_free);
+    if (index->gens == NULL) {
+        free(index);
+        return NULL;
+    }
+    if (pthread_mutex_init(&index->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize interface index mutex");
+        cfgmgr_gens_destroy(index->gens);
+        free(index);
+        return NULL;
+    }
+    index->handed_out = NULL;
+    atomic_init(&index->refs, 1);
+    return index;
+}
+
+static void iface_index_hold(cfgmgr_iface_index_t* index) {
+    atomic_fetch_add_explicit(&index->refs, 1, memory_order_relaxed);
+}
+
+// Frees the index along with its generations on the last reference
+static void iface_index_release(cfgmgr_iface_index_t* index) {
+    if (atomic_fetch_sub_explicit(&index->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    cfgmgr_gens_destroy(index->gens);
+    pthread_mutex_destroy(&index->mtx);
+    free(index);
+}
+
+int cfgmgr_iface_index_update(cfgmgr_iface_index_t* index, config_t* app_interface) {
+    if (app_interface == NULL || app_interface->cfg == NULL) {
+        LOG_ERROR_0("Interfaces document to index is NULL");
+        return -1;
+    }
+    iface_gen_t* gen = iface_gen_new(app_interface);
+    if (gen == NULL) {
+        return -1;
+    }
+    pthread_mutex_lock(&index->mtx);
+    int ret = cfgmgr_gens_publish(index->gens, gen);
+    pthread_mutex_unlock(&index->mtx);
+    if (ret != 0) {
+        // Left to the caller
+        gen->app_interface = NULL;
+        iface_gen_destroy(gen);
+    }
+    return ret;
+}
+
+cfgmgr_gen_guard_t cfgmgr_iface_index_pin(cfgmgr_iface_index_t* index) {
+    return cfgmgr_gens_pin(index->gens);
+}
+
+void cfgmgr_iface_index_unpin(cfgmgr_iface_index_t* index, cfgmgr_gen_guard_t* guard) {
+    cfgmgr_gens_unpin(index->gens, guard);
+}
+
+int cfgmgr_iface_index_ref(cfgmgr_iface_index_t* index, const cfgmgr_iface_model_t* model) {
+    void* gen = cfgmgr_gens_find(index->gens, iface_gen_owns_model, model);
+    if (gen == NULL) {
+        LOG_ERROR_0("Interface model is not owned by the index");
+        return -1;
+    }
+    if (cfgmgr_gens_ref(index->gens, gen) != 0) {
+        return -1;
+    }
+    iface_index_hold(index);
+    return 0;
+}
+
+void cfgmgr_iface_index_unref(cfgmgr_iface_index_t* index, const cfgmgr_iface_model_t* model) {
+    void* gen = cfgmgr_gens_find(index->gens, iface_gen_owns_model, model);
+    if (gen == NULL) {
+        LOG_ERROR_0("Interface model is not owned by the index");
+        return;
+    }
+    cfgmgr_gens_unref(index->gens, gen);
+    iface_index_release(index);
+}
+
+config_t* cfgmgr_iface_index_interfaces(cfgmgr_iface_index_t* index) {
+    iface_gen_t* gen = (iface_gen_t*) cfgmgr_gens_current(index->gens);
+    if (gen == NULL) {
+        return NULL;
+    }
+    return gen->app_interface;
+}
+
+config_t* cfgmgr_iface_index_acquire_interfaces(cfgmgr_iface_index_t* index) {
+    cfgmgr_gen_guard_t guard = cfgmgr_gens_pin(index->gens);
+    iface_gen_t* gen = (iface_gen_t*) guard.gen;
+    config_t* app_interface = NULL;
+    if (gen != NULL && cfgmgr_gens_ref(index->gens, gen) == 0) {
+        iface_index_hold(index);
+        app_interface = gen->app_interface;
+    }
+    cfgmgr_gens_unpin(index->gens, &guard);
+    return app_interface;
+}
+
+void cfgmgr_iface_index_release_interfaces(cfgmgr_iface_index_t* index, config_t* app_interface) {
+    if (app_interface == NULL) {
+        return;
+    }
+    void* gen = cfgmgr_gens_find(index->gens, iface_gen_owns_interfaces, app_interface);
+    if (gen == NULL) {
+        LOG_ERROR_0("Released interfaces which the index does not hold");
+        return;
+    }
+    cfgmgr_gens_unref(index->gens, gen);
+    iface_index_release(index);
+}
+
+config_t* cfgmgr_iface_index_app_interface(cfgmgr_iface_index_t* index) {
+    cfgmgr_gen_guard_t guard = cfgmgr_gens_pin(index->gens);
+    iface_gen_t* gen = (iface_gen_t*) guard.gen;
+    config_t* app_interface = NULL;
+    if (gen != NULL) {
+        pthread_mutex_lock(&index->mtx);
+        // The index references the interfaces handed out last only
+        if (index->handed_out != gen && cfgmgr_gens_ref(index->gens, gen) == 0) {
+            if (index->handed_out != NULL) {
+                cfgmgr_gens_unref(index->gens, index->handed_out);
+            }
+            index->handed_out = gen;
+        }
+        if (index->handed_out != NULL) {
+            app_interface = index->handed_out->app_interface;
+        }
+        pthread_mutex_unlock(&index->mtx);
+    }
+    cfgmgr_gens_unpin(index->gens, &guard);
+    return app_interface;
+}
+
+size_t cfgmgr_iface_index_retired(cfgmgr_iface_index_t* index) {
+    return cfgmgr_gens_retired(index->gens);
+}
+
+const cfgmgr_iface_model_t* cfgmgr_iface_index_find(cfgmgr_iface_index_t* index,
+                                                    cfgmgr_iface_type_t type,
+                                                    const char* name) {
+    iface_gen_t* gen = (iface_gen_t*) cfgmgr_gens_current(index->gens);
+    if (gen == NULL || name == NULL) {
+        return NULL;
+    }
+    uint32_t hash = iface_hash(type, name);
+    size_t mask = gen->capacity - 1;
+    for (size_t slot = hash & mask; gen->entries[slot].model != NULL; slot = (slot + 1) & mask) {
+        const cfgmgr_iface_model_t* model = gen->entries[slot].model;
+        if (gen->entries[slot].hash == hash && model->iface_type == type &&
+                strcmp(model->name, name) == 0) {
+            return model;
+        }
+    }
+    return NULL;
+}
+
+config_value_t* cfgmgr_iface_index_get(cfgmgr_iface_index_t* index, cfgmgr_iface_type_t type,
+                                       const char* name) {
+    const cfgmgr_iface_model_t* model = cfgmgr_iface_index_find(index, type, name);
+    if (model == NULL) {
+        return NULL;
+    }
+    // Same object value config_value_array_get() returns, the
+    // node is owned by the interfaces document
+    return config_value_new_object((void*) model->node, get_config_value, NULL);
+}
+
+const cfgmgr_iface_model_t* cfgmgr_iface_index_at(cfgmgr_iface_index_t* index,
+                                                  cfgmgr_iface_type_t type, int i) {
+    iface_gen_t* gen = (iface_gen_t*) cfgmgr_gens_current(index->gens);
+    if (gen == NULL || (int) type < 0 || type >= IFACE_TYPE_COUNT) {
+        return NULL;
+    }
+    if (i < 0 || i >= gen->arrays[type].count) {
+        return NULL;
+    }
+    return &gen->arrays[type].models[i];
+}
+
+int cfgmgr_iface_index_count(cfgmgr_iface_index_t* index, cfgmgr_iface_type_t type) {
+    cfgmgr_gen_guard_t guard = cfgmgr_gens_pin(index->gens);
+    iface_gen_t* gen = (iface_gen_t*) guard.gen;
+    int count = -1;
+    if (gen != NULL && (int) type >= 0 && type < IFACE_TYPE_COUNT) {
+        count = gen->arrays[type].count;
+    }
+    cfgmgr_gens_unpin(index->gens, &guard);
+    return count;
+}
+
+const cfgmgr_iface_strings_t* cfgmgr_iface_model_topics(const cfgmgr_iface_model_t* model) {
+    return model->topics;
+}
+
+// Position of the interface of a model in the current generation, by
+// position in its own generation or else by name; -1 if it is gone
+static int iface_gen_position(iface_gen_t* current, iface_gen_t* gen,
+                              const cfgmgr_iface_model_t* model) {
+    if (gen == current) {
+        return (int) (model - gen->arrays[model->iface_type].models);
+    }
+    if (model->name == NULL) {
+        return -1;
+    }
+    uint32_t hash = iface_hash(model->iface_type, model->name);
+    size_t mask = current->capacity - 1;
+    for (size_t slot = hash & mask; current->entries[slot].model != NULL; slot = (slot + 1) & mask) {
+        const cfgmgr_iface_model_t* found = current->entries[slot].model;
+        if (current->entries[slot].hash == hash && found->iface_type == model->iface_type &&
+                strcmp(found->name, model->name) == 0) {
+            return (int) (found - current->arrays[model->iface_type].models);
+        }
+    }
+    return -1;
+}
+
+const cfgmgr_iface_model_t* cfgmgr_iface_index_set_topics(cfgmgr_iface_index_t* index,
+                                                          const cfgmgr_iface_model_t* model,
+                                                          const void* topics) {
+    const cfgmgr_iface_model_t* updated = NULL;
+    config_t* app_interface = NULL;
+    cJSON* root = NULL;
+    cJSON* topics_copy = NULL;
+    iface_gen_t* next = NULL;
+
+    // Serializes with updates, the current generation stays current
+    pthread_mutex_lock(&index->mtx);
+    iface_gen_t* current = (iface_gen_t*) cfgmgr_gens_current(index->gens);
+    iface_gen_t* gen = (iface_gen_t*) cfgmgr_gens_find(index->gens, iface_gen_owns_model, model);
+    if (current == NULL || gen == NULL) {
+        LOG_ERROR_0("Interface model is not owned by the index");
+        goto err;
+    }
+    int position = iface_gen_position(current, gen, model);
+    if (position < 0) {
+        LOG_ERROR("%s interface %s is not in the current interfaces",
+                  iface_arrays[model->iface_type], (model->name != NULL) ? model->name : "");
+        goto err;
+    }
+
+    // Copy of the current document with the new Topics
+    root = cJSON_Duplicate((const cJSON*) current->app_interface->cfg, true);
+    topics_copy = cJSON_Duplicate((const cJSON*) topics, true);
+    if (root == NULL || topics_copy == NULL) {
+        LOG_ERROR_0("Failed to copy the interfaces document");
+        goto err;
+    }
+    cJSON* node = cJSON_GetArrayItem(cJSON_GetObjectItem(root, iface_arrays[model->iface_type]),
+                                     position);
+    if (node == NULL) {
+        LOG_ERROR_0("Interface node is missing from the copy");
+        goto err;
+    }
+    if (cJSON_GetObjectItem(node, "Topics") != NULL) {
+        cJSON_ReplaceItemInObject(node, "Topics", topics_copy);
+    } else {
+        cJSON_AddItemToObject(node, "Topics", topics_copy);
+    }
+    topics_copy = NULL;
+    app_interface = config_new((void*) root, free_json, get_config_value, set_config_value);
+    if (app_interface == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        goto err;
+    }
+    root = NULL;
+
+    // On success the generation owns app_interface
+    next = iface_gen_new(app_interface);
+    if (next == NULL) {
+        goto err;
+    }
+    app_interface = NULL;
+    if (cfgmgr_gens_publish(index->gens, next) != 0) {
+        goto err;
+    }
+    updated = &next->arrays[model->iface_type].models[position];
+    next = NULL;
+    // Current, so it can not be reclaimed before it is referenced
+    if (cfgmgr_gens_ref(index->gens, (const void*) cfgmgr_gens_current(index->gens)) != 0) {
+        updated = NULL;
+    } else {
+        iface_index_hold(index);
+    }
+
+err:
+    pthread_mutex_unlock(&index->mtx);
+    if (next != NULL) {
+        iface_gen_destroy(next);
+    }
+    if (app_interface != NULL) {
+        config_destroy(app_interface);
+    }
+    if (root != NULL) {
+        cJSON_Delete(root);
+    }
+    if (topics_copy != NULL) {
+        cJSON_Delete(topics_copy);
+    }
+    return updated;
+}
+
+void cfgmgr_iface_index_destroy(cfgmgr_iface_index_t* index) {
+    if (index == NULL) {
+        return;
+    }
+    iface_index_release(index);
+}
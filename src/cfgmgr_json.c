@@ -0,0 +1,417 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief JSON parsing of the ConfigManager implementation
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/json_config.h>
+#include "eii/config_manager/cfgmgr_json.h"
+
+// Deepest nesting accepted by cfgmgr_json_each_member(), as by cJSON
+#define CFGMGR_JSON_NESTING_LIMIT   1000
+
+cJSON* cfgmgr_json_parse(const char* buf, size_t len) {
+#ifdef CFGMGR_WITH_SIMDJSON
+    if (len >= CFGMGR_JSON_SIMD_MIN_SIZE) {
+        return cfgmgr_json_simdjson_parse(buf, len);
+    }
+#endif
+    return cJSON_ParseWithLength(buf, len);
+}
+
+config_t* cfgmgr_json_config_new(const char* buf) {
+    cJSON* json = cfgmgr_json_parse(buf, strlen(buf));
+    if (json == NULL) {
+        LOG_ERROR_0("Failed to parse the JSON document");
+        return NULL;
+    }
+    config_t* config = config_new((void*) json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(json);
+        return NULL;
+    }
+    return config;
+}
+
+const char* cfgmgr_json_backend() {
+#ifdef CFGMGR_WITH_SIMDJSON
+    return "simdjson";
+#else
+    return "cjson";
+#endif
+}
+
+// Growable buffer a key or value is decoded into, reused for every member
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} json_buf_t;
+
+// Position of the tokenizer in the document
+typedef struct {
+    const char* pos;
+    const char* end;
+} json_reader_t;
+
+static bool json_buf_put(json_buf_t* buf, const char* str, size_t len) {
+    if (buf->len + len + 1 > buf->cap) {
+        size_t cap = (buf->cap != 0) ? buf->cap : 64;
+        while (cap < buf->len + len + 1) {
+            cap *= 2;
+        }
+        char* data = (char*) realloc(buf->data, cap);
+        if (data == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for a JSON string");
+            return false;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, str, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+    return true;
+}
+
+static void json_skip_ws(json_reader_t* r) {
+    while (r->pos < r->end &&
+           (*r->pos == ' ' || *r->pos == '\t' || *r->pos == '\n' || *r->pos == '\r')) {
+        r->pos++;
+    }
+}
+
+static int json_hex4(const char* p) {
+    int code = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        code <<= 4;
+        if (c >= '0' && c <= '9') {
+            code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            code |= c - 'A' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return code;
+}
+
+// Reads the \uXXXX escape at r->pos, and the low surrogate following a
+// high one, into UTF-8
+static bool json_read_unicode(json_reader_t* r, char* utf8, size_t* utf8_len) {
+    if (r->end - r->pos < 6) {
+        return false;
+    }
+    long code = json_hex4(r->pos + 2);
+    if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) {
+        return false;
+    }
+    r->pos += 6;
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        if (r->end - r->pos < 6 || r->pos[0] != '\\' || r->pos[1] != 'u') {
+            return false;
+        }
+        int low = json_hex4(r->pos + 2);
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return false;
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        r->pos += 6;
+    }
+    if (code < 0x80) {
+        utf8[0] = (char) code;
+        *utf8_len = 1;
+    } else if (code < 0x800) {
+        utf8[0] = (char) (0xC0 | (code >> 6));
+        utf8[1] = (char) (0x80 | (code & 0x3F));
+        *utf8_len = 2;
+    } else if (code < 0x10000) {
+        utf8[0] = (char) (0xE0 | (code >> 12));
+        utf8[1] = (char) (0x80 | ((code >> 6) & 0x3F));
+        utf8[2] = (char) (0x80 | (code & 0x3F));
+        *utf8_len = 3;
+    } else {
+        utf8[0] = (char) (0xF0 | (code >> 18));
+        utf8[1] = (char) (0x80 | ((code >> 12) & 0x3F));
+        utf8[2] = (char) (0x80 | ((code >> 6) & 0x3F));
+        utf8[3] = (char) (0x80 | (code & 0x3F));
+        *utf8_len = 4;
+    }
+    return true;
+}
+
+// Reads the string at r->pos, unescaped into out unless it is NULL
+static bool json_read_string(json_reader_t* r, json_buf_t* out) {
+    r->pos++;
+    if (out != NULL) {
+        out->len = 0;
+        if (!json_buf_put(out, "", 0)) {
+            return false;
+        }
+    }
+    const char* run = r->pos;
+    while (r->pos < r->end) {
+        unsigned char c = (unsigned char) *r->pos;
+        if (c == '"' || c == '\\') {
+            if (out != NULL && !json_buf_put(out, run, r->pos - run)) {
+                return false;
+            }
+            if (c == '"') {
+                r->pos++;
+                return true;
+            }
+            if (r->end - r->pos < 2) {
+                return false;
+            }
+            char esc[4];
+            size_t esc_len = 1;
+            char kind = r->pos[1];
+            switch (kind) {
+                case '"': esc[0] = '"'; break;
+                case '\\': esc[0] = '\\'; break;
+                case '/': esc[0] = '/'; break;
+                case 'b': esc[0] = '\b'; break;
+                case 'f': esc[0] = '\f'; break;
+                case 'n': esc[0] = '\n'; break;
+                case 'r': esc[0] = '\r'; break;
+                case 't': esc[0] = '\t'; break;
+                case 'u':
+                    if (!json_read_unicode(r, esc, &esc_len)) {
+                        return false;
+                    }
+                    break;
+                default:
+                    return false;
+            }
+            if (kind != 'u') {
+                r->pos += 2;
+            }
+            if (out != NULL && !json_buf_put(out, esc, esc_len)) {
+                return false;
+            }
+            run = r->pos;
+        } else if (c < 0x20) {
+            return false;
+        } else {
+            r->pos++;
+        }
+    }
+    return false;
+}
+
+static bool json_skip_literal(json_reader_t* r, const char* literal) {
+    size_t len = strlen(literal);
+    if ((size_t) (r->end - r->pos) < len || memcmp(r->pos, literal, len) != 0) {
+        return false;
+    }
+    r->pos += len;
+    return true;
+}
+
+static bool json_skip_digits(json_reader_t* r) {
+    const char* start = r->pos;
+    while (r->pos < r->end && *r->pos >= '0' && *r->pos <= '9') {
+        r->pos++;
+    }
+    return r->pos != start;
+}
+
+static bool json_skip_number(json_reader_t* r) {
+    if (r->pos < r->end && *r->pos == '-') {
+        r->pos++;
+    }
+    if (r->pos < r->end && *r->pos == '0') {
+        r->pos++;
+    } else if (!json_skip_digits(r)) {
+        return false;
+    }
+    if (r->pos < r->end && *r->pos == '.') {
+        r->pos++;
+        if (!json_skip_digits(r)) {
+            return false;
+        }
+    }
+    if (r->pos < r->end && (*r->pos == 'e' || *r->pos == 'E')) {
+        r->pos++;
+        if (r->pos < r->end && (*r->pos == '+' || *r->pos == '-')) {
+            r->pos++;
+        }
+        if (!json_skip_digits(r)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Validates the value at r->pos and moves past it
+static bool json_skip_value(json_reader_t* r, int depth) {
+    if (r->pos >= r->end) {
+        return false;
+    }
+    char open = *r->pos;
+    if (open == '"') {
+        return json_read_string(r, NULL);
+    }
+    if (open != '{' && open != '[') {
+        switch (open) {
+            case 't': return json_skip_literal(r, "true");
+            case 'f': return json_skip_literal(r, "false");
+            case 'n': return json_skip_literal(r, "null");
+            default: return json_skip_number(r);
+        }
+    }
+    if (depth >= CFGMGR_JSON_NESTING_LIMIT) {
+        return false;
+    }
+    char close = (open == '{') ? '}' : ']';
+    r->pos++;
+    json_skip_ws(r);
+    if (r->pos < r->end && *r->pos == close) {
+        r->pos++;
+        return true;
+    }
+    while (true) {
+        if (open == '{') {
+            if (r->pos >= r->end || *r->pos != '"' || !json_read_string(r, NULL)) {
+                return false;
+            }
+            json_skip_ws(r);
+            if (r->pos >= r->end || *r->pos != ':') {
+                return false;
+            }
+            r->pos++;
+            json_skip_ws(r);
+        }
+        if (!json_skip_value(r, depth + 1)) {
+            return false;
+        }
+        json_skip_ws(r);
+        if (r->pos >= r->end) {
+            return false;
+        }
+        if (*r->pos == close) {
+            r->pos++;
+            return true;
+        }
+        if (*r->pos != ',') {
+            return false;
+        }
+        r->pos++;
+        json_skip_ws(r);
+    }
+}
+
+static void json_log_invalid(const char* buf, const json_reader_t* r) {
+    LOG_ERROR("Invalid JSON object at offset %zu", (size_t) (r->pos - buf));
+}
+
+int cfgmgr_json_each_member(const char* buf, size_t len, cfgmgr_json_member_cb_t cb,
+                            void* user_data) {
+    json_reader_t r = { buf, buf + len };
+    json_buf_t key = { NULL, 0, 0 };
+    json_buf_t value = { NULL, 0, 0 };
+    int count = -1;
+    int members = 0;
+
+    json_skip_ws(&r);
+    if (r.pos >= r.end || *r.pos != '{') {
+        LOG_ERROR_0("JSON document is not an object");
+        goto err;
+    }
+    r.pos++;
+    json_skip_ws(&r);
+    if (r.pos < r.end && *r.pos == '}') {
+        r.pos++;
+    } else {
+        while (true) {
+            if (r.pos >= r.end || *r.pos != '"' ||
+                    !json_read_string(&r, (cb != NULL) ? &key : NULL)) {
+                json_log_invalid(buf, &r);
+                goto err;
+            }
+            json_skip_ws(&r);
+            if (r.pos >= r.end || *r.pos != ':') {
+                json_log_invalid(buf, &r);
+                goto err;
+            }
+            r.pos++;
+            json_skip_ws(&r);
+            if (r.pos < r.end && *r.pos == '"') {
+                if (!json_read_string(&r, (cb != NULL) ? &value : NULL)) {
+                    json_log_invalid(buf, &r);
+                    goto err;
+                }
+            } else {
+                // Other values are passed as their JSON text
+                const char* start = r.pos;
+                if (!json_skip_value(&r, 1)) {
+                    json_log_invalid(buf, &r);
+                    goto err;
+                }
+                value.len = 0;
+                if (cb != NULL && !json_buf_put(&value, start, r.pos - start)) {
+                    goto err;
+                }
+            }
+            members++;
+            if (cb != NULL && cb(key.data, value.data, user_data) != 0) {
+                goto err;
+            }
+            json_skip_ws(&r);
+            if (r.pos >= r.end) {
+                json_log_invalid(buf, &r);
+                goto err;
+            }
+            if (*r.pos == '}') {
+                r.pos++;
+                break;
+            }
+            if (*r.pos != ',') {
+                json_log_invalid(buf, &r);
+                goto err;
+            }
+            r.pos++;
+            json_skip_ws(&r);
+        }
+    }
+    json_skip_ws(&r);
+    if (r.pos != r.end) {
+        json_log_invalid(buf, &r);
+        goto err;
+    }
+
+    // We should add all success-path code above this line
+    count = members;
+
+err:
+    free(key.data);
+    free(value.data);
+    return count;
+}
@@ -0,0 +1,196 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief simdjson JSON parsing backend of the ConfigManager implementation,
+ *        compiled WITH_SIMDJSON
+ */
+
+#include <new>
+#include <string>
+#include <string_view>
+#include <simdjson.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_json.h"
+
+using simdjson::ondemand::json_type;
+
+// Deepest nesting converted, as cJSON's CJSON_NESTING_LIMIT
+#define SIMDJSON_MAX_DEPTH  1000
+
+/**
+ * Builds the cJSON tree of a document in one pass over simdjson's
+ * on-demand iterator
+ */
+class JsonConverter {
+public:
+    cJSON* convert(simdjson::ondemand::value value, int depth) {
+        json_type type;
+        if (depth > SIMDJSON_MAX_DEPTH || value.type().get(type)) {
+            return NULL;
+        }
+        switch (type) {
+            case json_type::object: {
+                simdjson::ondemand::object object;
+                if (value.get_object().get(object)) {
+                    return NULL;
+                }
+                return convert_object(object, depth);
+            }
+            case json_type::array: {
+                simdjson::ondemand::array array;
+                if (value.get_array().get(array)) {
+                    return NULL;
+                }
+                return convert_array(array, depth);
+            }
+            case json_type::number: {
+                double num;
+                if (value.get_double().get(num)) {
+                    return NULL;
+                }
+                return cJSON_CreateNumber(num);
+            }
+            case json_type::string: {
+                std::string_view str;
+                if (value.get_string().get(str)) {
+                    return NULL;
+                }
+                scratch.assign(str);
+                return cJSON_CreateString(scratch.c_str());
+            }
+            case json_type::boolean: {
+                bool boolean;
+                if (value.get_bool().get(boolean)) {
+                    return NULL;
+                }
+                return cJSON_CreateBool(boolean);
+            }
+            case json_type::null: {
+                bool null = false;
+                if (value.is_null().get(null) || !null) {
+                    return NULL;
+                }
+                return cJSON_CreateNull();
+            }
+            default:
+                return NULL;
+        }
+    }
+
+    cJSON* convert_object(simdjson::ondemand::object& object, int depth) {
+        cJSON* json = cJSON_CreateObject();
+        if (json == NULL) {
+            return NULL;
+        }
+        for (auto field : object) {
+            // Unescaped keys live in the parser until the next document
+            std::string_view key;
+            simdjson::ondemand::value value;
+            if (field.unescaped_key().get(key) || field.value().get(value)) {
+                cJSON_Delete(json);
+                return NULL;
+            }
+            cJSON* item = convert(value, depth + 1);
+            if (item == NULL) {
+                cJSON_Delete(json);
+                return NULL;
+            }
+            scratch.assign(key);
+            if (!cJSON_AddItemToObject(json, scratch.c_str(), item)) {
+                cJSON_Delete(item);
+                cJSON_Delete(json);
+                return NULL;
+            }
+        }
+        return json;
+    }
+
+    cJSON* convert_array(simdjson::ondemand::array& array, int depth) {
+        cJSON* json = cJSON_CreateArray();
+        if (json == NULL) {
+            return NULL;
+        }
+        for (auto element : array) {
+            simdjson::ondemand::value value;
+            if (element.get(value)) {
+                cJSON_Delete(json);
+                return NULL;
+            }
+            cJSON* item = convert(value, depth + 1);
+            if (item == NULL) {
+                cJSON_Delete(json);
+                return NULL;
+            }
+            cJSON_AddItemToArray(json, item);
+        }
+        return json;
+    }
+
+private:
+    // NUL terminated copy of the string or key being added
+    std::string scratch;
+};
+
+// simdjson is stricter than cJSON, e.g. about content after the document
+// or the nesting depth; cJSON gets the last word on documents it rejects,
+// so that both backends accept the same documents
+static cJSON* cfgmgr_json_fallback(const char* buf, size_t len) {
+    LOG_DEBUG_0("simdjson rejected the JSON document, parsing it with cJSON");
+    return cJSON_ParseWithLength(buf, len);
+}
+
+extern "C" cJSON* cfgmgr_json_simdjson_parse(const char* buf, size_t len) {
+    // One parser per thread, keeping its buffers across documents, e.g.
+    // for the watch threads
+    thread_local simdjson::ondemand::parser parser;
+    try {
+        simdjson::padded_string padded(buf, len);
+        simdjson::ondemand::document doc;
+        json_type type;
+        if (parser.iterate(padded).get(doc) || doc.type().get(type)) {
+            return cfgmgr_json_fallback(buf, len);
+        }
+        JsonConverter converter;
+        cJSON* json = NULL;
+        if (type == json_type::object) {
+            simdjson::ondemand::object object;
+            if (!doc.get_object().get(object)) {
+                json = converter.convert_object(object, 0);
+            }
+        } else if (type == json_type::array) {
+            simdjson::ondemand::array array;
+            if (!doc.get_array().get(array)) {
+                json = converter.convert_array(array, 0);
+            }
+        } else {
+            // Scalar documents are never large
+            return cJSON_ParseWithLength(buf, len);
+        }
+        if (json == NULL) {
+            return cfgmgr_json_fallback(buf, len);
+        }
+        return json;
+    } catch (const std::bad_alloc&) {
+        LOG_ERROR_0("Out of memory parsing the JSON document");
+        return NULL;
+    }
+}
@@ -0,0 +1,651 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Message bus configuration builder of the ConfigManager implementation
+ */
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/json_config.h>
+#include "eii/config_manager/cfgmgr_arena.h"
+#include "eii/config_manager/cfgmgr_msgbus_builder.h"
+
+// Where the zmq_tcp endpoint object of an interface goes in its config
+typedef enum {
+    // Under a fixed key
+    MSGBUS_SLOT_KEY,
+    // Under the Name of the interface
+    MSGBUS_SLOT_NAME,
+    // Once per topic, under "" for the "*" topic
+    MSGBUS_SLOT_TOPICS,
+} msgbus_slot_t;
+
+// When the AppName of the peer of an interface has to be set
+typedef enum {
+    MSGBUS_PEER_OPTIONAL,
+    // Only in prod mode, where keys are exchanged with the peer
+    MSGBUS_PEER_PROD,
+    MSGBUS_PEER_ALWAYS,
+} msgbus_peer_need_t;
+
+// What the msgbus config of an interface type is made of. In prod mode a
+// zmq_tcp interface with a peer is a CurveZMQ client of it, one without
+// (or with "*" as peer, i.e. a broker, when peer_wildcard_serves) serves
+// its AllowedClients.
+typedef struct {
+    // Interface type, for logs
+    const char* label;
+
+    msgbus_slot_t slot;
+    // Key of MSGBUS_SLOT_KEY
+    const char* slot_key;
+
+    // Whether Brokered is copied into the endpoint object
+    bool brokered;
+
+    // Key and model field of the AppName of the peer, NULL if none
+    const char* peer_key;
+    size_t peer_offset;
+    uint32_t peer_invalid;
+    msgbus_peer_need_t peer_need;
+    bool peer_wildcard_serves;
+} msgbus_iface_desc_t;
+
+// Indexed by cfgmgr_iface_type_t
+static const msgbus_iface_desc_t msgbus_iface_descs[] = {
+    [CFGMGR_PUBLISHER] = {
+        .label = "publisher",
+        .slot = MSGBUS_SLOT_KEY,
+        .slot_key = "zmq_tcp_publish",
+        .brokered = true,
+        .peer_key = BROKER_APPNAME,
+        .peer_offset = offsetof(cfgmgr_iface_model_t, broker_appname),
+        .peer_invalid = CFGMGR_IFACE_BAD_BROKER_APPNAME,
+        .peer_need = MSGBUS_PEER_OPTIONAL,
+    },
+    [CFGMGR_SUBSCRIBER] = {
+        .label = "subscriber",
+        .slot = MSGBUS_SLOT_TOPICS,
+        .peer_key = PUBLISHER_APPNAME,
+        .peer_offset = offsetof(cfgmgr_iface_model_t, publisher_appname),
+        .peer_invalid = CFGMGR_IFACE_BAD_PUBLISHER_APPNAME,
+        .peer_need = MSGBUS_PEER_ALWAYS,
+        .peer_wildcard_serves = true,
+    },
+    [CFGMGR_SERVER] = {
+        .label = "server",
+        .slot = MSGBUS_SLOT_NAME,
+    },
+    [CFGMGR_CLIENT] = {
+        .label = "client",
+        .slot = MSGBUS_SLOT_NAME,
+        .peer_key = SERVER_APPNAME,
+        .peer_offset = offsetof(cfgmgr_iface_model_t, server_appname),
+        .peer_invalid = CFGMGR_IFACE_BAD_SERVER_APPNAME,
+        .peer_need = MSGBUS_PEER_PROD,
+    },
+};
+
+#define MSGBUS_IFACE_DESC_COUNT (sizeof(msgbus_iface_descs) / sizeof(msgbus_iface_descs[0]))
+
+// State of one build
+typedef struct {
+    cfgmgr_interface_t* ctx;
+    const cfgmgr_iface_model_t* model;
+    const msgbus_iface_desc_t* desc;
+    kv_store_client_t* kv_store_client;
+    void* kv_store_handle;
+    bool prod;
+
+    // Type and EndPoint, after env overrides
+    const char* type;
+    const char* end_point;
+
+    // Config handed to the caller and its root object
+    config_t* config;
+    cJSON* root;
+
+    // Arena of config, NULL when it is built on the heap
+    cfgmgr_arena_t* arena;
+} msgbus_build_t;
+
+// Keys of a zmq_tcp interface in prod mode, read once per build and
+// copied into every endpoint object
+typedef struct {
+    bool serves;
+    // Public key of the peer, NULL if it is not provisioned
+    char* server_public_key;
+    char* client_public_key;
+    // Private key of the application
+    char* secret_key;
+} msgbus_keys_t;
+
+static bool msgbus_build_ipc(msgbus_build_t* build);
+static bool msgbus_build_tcp(msgbus_build_t* build);
+
+// Transports, by value of the Type key
+static const struct {
+    const char* type;
+    bool (*build)(msgbus_build_t* build);
+} msgbus_transports[] = {
+    {"zmq_ipc", msgbus_build_ipc},
+    {"zmq_tcp", msgbus_build_tcp},
+};
+
+// Overrides the Type and EndPoint of an interface with the env overrides
+// scanned at initialization or by the last cfgmgr_reload_env(). The
+// override of every interface of a type wins over the named one.
+static void cfgmgr_apply_env_overrides(cfgmgr_ctx_t* cfgmgr, cfgmgr_iface_type_t iface_type,
+                                       const char* name, const char** type, const char** end_point) {
+    if (cfgmgr->env_overrides == NULL) {
+        return;
+    }
+    const char* value = cfgmgr_env_overrides_get(cfgmgr->env_overrides, iface_type, name, CFGMGR_OVERRIDE_ENDPOINT);
+    if (value != NULL) {
+        LOG_DEBUG("Overriding endpoint of %s with env", name);
+        *end_point = value;
+    }
+    value = cfgmgr_env_overrides_get(cfgmgr->env_overrides, iface_type, NULL, CFGMGR_OVERRIDE_ENDPOINT);
+    if (value != NULL) {
+        LOG_DEBUG("Overriding endpoint of %s with env of every interface", name);
+        *end_point = value;
+    }
+    value = cfgmgr_env_overrides_get(cfgmgr->env_overrides, iface_type, name, CFGMGR_OVERRIDE_TYPE);
+    if (value != NULL) {
+        LOG_DEBUG("Overriding type of %s with env", name);
+        *type = value;
+    }
+    value = cfgmgr_env_overrides_get(cfgmgr->env_overrides, iface_type, NULL, CFGMGR_OVERRIDE_TYPE);
+    if (value != NULL) {
+        LOG_DEBUG("Overriding type of %s with env of every interface", name);
+        *type = value;
+    }
+}
+
+// Splits host:port into the arena, trimming both like get_host_port()
+static bool msgbus_arena_host_port(cfgmgr_arena_t* arena, const char* end_point,
+                                   const char** host, int64_t* port) {
+    const char* colon = strchr(end_point, ':');
+    if (colon == NULL) {
+        return false;
+    }
+    const char* begin = end_point;
+    const char* end = colon;
+    while (begin < end && isspace((unsigned char) *begin)) {
+        begin++;
+    }
+    while (end > begin && isspace((unsigned char) end[-1])) {
+        end--;
+    }
+    *host = cfgmgr_arena_strndup(arena, begin, (size_t) (end - begin));
+    if (*host == NULL) {
+        return false;
+    }
+    *port = atoi(colon + 1);
+    return true;
+}
+
+// Host and port of a zmq_tcp endpoint. They are parsed once into the
+// interface model, unless an env override replaced the EndPoint; the
+// parsed strings are then owned by host_port, or by the arena.
+static bool cfgmgr_tcp_host_port(const cfgmgr_iface_model_t* model, cfgmgr_arena_t* arena,
+                                 const char* end_point, char*** host_port,
+                                 const char** host, int64_t* port) {
+    if (end_point == model->endpoint && model->has_host_port) {
+        *host = model->host;
+        *port = model->port;
+        return true;
+    }
+    if (arena != NULL) {
+        return msgbus_arena_host_port(arena, end_point, host, port);
+    }
+    *host_port = get_host_port(end_point);
+    if (*host_port == NULL) {
+        return false;
+    }
+    trim((*host_port)[0]);
+    trim((*host_port)[1]);
+    *host = (*host_port)[0];
+    *port = atoi((*host_port)[1]);
+    return true;
+}
+
+// Nodes of the config, allocated from the arena of the build if any
+static cJSON* msgbus_object(msgbus_build_t* build) {
+    return (build->arena != NULL) ? cfgmgr_arena_json_object(build->arena) : cJSON_CreateObject();
+}
+
+static cJSON* msgbus_array(msgbus_build_t* build) {
+    return (build->arena != NULL) ? cfgmgr_arena_json_array(build->arena) : cJSON_CreateArray();
+}
+
+static cJSON* msgbus_string(msgbus_build_t* build, const char* str) {
+    return (build->arena != NULL) ? cfgmgr_arena_json_string(build->arena, str) : cJSON_CreateString(str);
+}
+
+static cJSON* msgbus_number(msgbus_build_t* build, double num) {
+    return (build->arena != NULL) ? cfgmgr_arena_json_number(build->arena, num) : cJSON_CreateNumber(num);
+}
+
+static cJSON* msgbus_bool(msgbus_build_t* build, bool value) {
+    return (build->arena != NULL) ? cfgmgr_arena_json_bool(build->arena, value) : cJSON_CreateBool(value);
+}
+
+// Frees a node which did not make it into the config; arena nodes go
+// with the arena
+static void msgbus_discard(msgbus_build_t* build, cJSON* item) {
+    if (build->arena == NULL) {
+        cJSON_Delete(item);
+    }
+}
+
+static void msgbus_append(msgbus_build_t* build, cJSON* array, cJSON* item) {
+    if (build->arena != NULL) {
+        cfgmgr_arena_json_append(array, item);
+    } else {
+        cJSON_AddItemToArray(array, item);
+    }
+}
+
+// Sets key of obj to item, replacing any previous value. Takes ownership
+// of item, which is NULL when creating it failed.
+static bool msgbus_set(msgbus_build_t* build, cJSON* obj, const char* key, cJSON* item) {
+    if (build->arena != NULL) {
+        return cfgmgr_arena_json_set(build->arena, obj, key, item);
+    }
+    if (item == NULL) {
+        LOG_ERROR("Failed to create the value of \"%s\"", key);
+        return false;
+    }
+    bool ret;
+    if (cJSON_GetObjectItemCaseSensitive(obj, key) != NULL) {
+        ret = cJSON_ReplaceItemInObjectCaseSensitive(obj, key, item);
+    } else {
+        ret = cJSON_AddItemToObject(obj, key, item);
+    }
+    if (!ret) {
+        LOG_ERROR("Unable to set \"%s\" in the msgbus config", key);
+        cJSON_Delete(item);
+    }
+    return ret;
+}
+
+// Reads the key <base><name><suffix>, built on the stack, into value,
+// which is NULL if the key is not found and not required
+static bool msgbus_read_key(msgbus_build_t* build, const char* base, const char* name,
+                            const char* suffix, bool required, char** value) {
+    char key[MAX_CONFIG_KEY_LENGTH];
+    int len = snprintf(key, sizeof(key), "%s%s%s", base, name, suffix);
+    if (len < 0 || (size_t) len >= sizeof(key)) {
+        LOG_ERROR("Key of %s is too long", name);
+        return false;
+    }
+    *value = build->kv_store_client->get(build->kv_store_handle, key);
+    if (*value != NULL) {
+        return true;
+    }
+    if (required) {
+        LOG_ERROR("Value is not found for the key: %s", key);
+        return false;
+    }
+    LOG_DEBUG("Value is not found for the key: %s", key);
+    return true;
+}
+
+// Public keys of every client, appended as they are streamed from the
+// kv_store rather than read into an intermediate array first
+typedef struct {
+    msgbus_build_t* build;
+    cJSON* keys;
+    bool failed;
+} msgbus_public_keys_t;
+
+static int msgbus_append_public_key(const char* key, const char* value, void* user_data) {
+    msgbus_public_keys_t* all = (msgbus_public_keys_t*) user_data;
+    cJSON* item = msgbus_string(all->build, value);
+    if (item == NULL) {
+        LOG_ERROR_0("Failed to create the public key of an allowed client");
+        all->failed = true;
+        return -1;
+    }
+    msgbus_append(all->build, all->keys, item);
+    return 0;
+}
+
+// Sets allowed_clients to the public keys of the AllowedClients of the
+// interface, or to every public key for "*". Clients which are not
+// provisioned yet are left out.
+static bool msgbus_add_allowed_clients(msgbus_build_t* build) {
+    const cfgmgr_iface_strings_t* clients = build->model->allowed_clients;
+    if (clients == NULL) {
+        LOG_ERROR("%s of the %s is missing or not an array", ALLOWED_CLIENTS, build->desc->label);
+        return false;
+    }
+    if (clients->count == 0) {
+        LOG_ERROR_0("Empty String is not supported in AllowedClients. Atleast one allowed clients is required");
+        return false;
+    }
+    cJSON* keys = msgbus_array(build);
+    if (keys == NULL) {
+        LOG_ERROR_0("Failed to create the allowed_clients array");
+        return false;
+    }
+    if (clients->wildcard) {
+        msgbus_public_keys_t all = { build, keys, false };
+        int count = kv_store_get_prefix_each(build->kv_store_client, build->kv_store_handle,
+                                             PUBLIC_KEYS, msgbus_append_public_key, &all);
+        if (count <= 0 || all.failed) {
+            LOG_ERROR_0("Failed to get the public keys of all the clients");
+            msgbus_discard(build, keys);
+            return false;
+        }
+        return msgbus_set(build, build->root, "allowed_clients", keys);
+    }
+    for (size_t i = 0; i < clients->count; i++) {
+        char* key = NULL;
+        if (!msgbus_read_key(build, PUBLIC_KEYS, clients->items[i], "", false, &key)) {
+            msgbus_discard(build, keys);
+            return false;
+        }
+        if (key == NULL) {
+            continue;
+        }
+        cJSON* item = msgbus_string(build, key);
+        free(key);
+        if (item == NULL) {
+            LOG_ERROR_0("Failed to create the public key of an allowed client");
+            msgbus_discard(build, keys);
+            return false;
+        }
+        msgbus_append(build, keys, item);
+    }
+    return msgbus_set(build, build->root, "allowed_clients", keys);
+}
+
+// Reads the keys of a zmq_tcp interface talking to the given peer; serving
+// ones add the public keys of their clients to the config along the way
+static bool msgbus_read_keys(msgbus_build_t* build, const char* peer, msgbus_keys_t* keys) {
+    const char* app_name = build->ctx->cfg_mgr->app_name;
+    keys->serves = (peer == NULL) ||
+                   (build->desc->peer_wildcard_serves && strcmp(peer, "*") == 0);
+    if (keys->serves) {
+        if (!msgbus_add_allowed_clients(build)) {
+            return false;
+        }
+    } else if (!msgbus_read_key(build, PUBLIC_KEYS, peer, "", false, &keys->server_public_key) ||
+               !msgbus_read_key(build, PUBLIC_KEYS, app_name, "", true, &keys->client_public_key)) {
+        return false;
+    }
+    return msgbus_read_key(build, "/", app_name, PRIVATE_KEY, true, &keys->secret_key);
+}
+
+// Creates the object holding the host and port of a zmq_tcp interface,
+// along with its keys in prod mode
+static cJSON* msgbus_endpoint_object(msgbus_build_t* build, const char* host, int64_t port,
+                                     const msgbus_keys_t* keys) {
+    const cfgmgr_iface_model_t* model = build->model;
+    cJSON* obj = msgbus_object(build);
+    if (obj == NULL) {
+        return NULL;
+    }
+    bool ok = msgbus_set(build, obj, "host", msgbus_string(build, host)) &&
+              msgbus_set(build, obj, "port", msgbus_number(build, (double) port));
+    if (ok && build->desc->brokered && model->has_brokered) {
+        ok = msgbus_set(build, obj, BROKERED, msgbus_bool(build, model->brokered));
+    }
+    if (ok && keys != NULL) {
+        if (keys->serves) {
+            ok = msgbus_set(build, obj, "server_secret_key", msgbus_string(build, keys->secret_key));
+        } else {
+            if (keys->server_public_key != NULL) {
+                ok = msgbus_set(build, obj, "server_public_key", msgbus_string(build, keys->server_public_key));
+            }
+            ok = ok && msgbus_set(build, obj, "client_public_key", msgbus_string(build, keys->client_public_key)) &&
+                 msgbus_set(build, obj, "client_secret_key", msgbus_string(build, keys->secret_key));
+        }
+    }
+    if (!ok) {
+        msgbus_discard(build, obj);
+        return NULL;
+    }
+    return obj;
+}
+
+static bool msgbus_build_ipc(msgbus_build_t* build) {
+    cfgmgr_trace_span_t span = cfgmgr_trace_begin("cfgmgr.get_ipc_config");
+    bool ret = get_ipc_config(build->config, build->ctx->interface, build->end_point, build->ctx->type);
+    cfgmgr_trace_end(&span, NULL);
+    if (!ret) {
+        LOG_ERROR("IPC configuration for %s failed", build->desc->label);
+        return false;
+    }
+    LOG_DEBUG("Env %s config is : Type : %s, EndPoint : %s", build->desc->label, build->type, build->end_point);
+    return true;
+}
+
+static bool msgbus_build_tcp(msgbus_build_t* build) {
+    const cfgmgr_iface_model_t* model = build->model;
+    const msgbus_iface_desc_t* desc = build->desc;
+    const cfgmgr_iface_strings_t* topics = NULL;
+    const char* peer = NULL;
+    const char* host = NULL;
+    int64_t port = 0;
+    char** host_port = NULL;
+    msgbus_keys_t keys;
+    bool ret_val = false;
+    memset(&keys, 0, sizeof(keys));
+
+    if (desc->slot == MSGBUS_SLOT_TOPICS) {
+        topics = cfgmgr_iface_model_topics(model);
+        if (topics == NULL) {
+            LOG_ERROR("%s of the %s is missing or not an array", TOPICS, desc->label);
+            goto err;
+        }
+        if (topics->count == 0) {
+            LOG_ERROR_0("Empty array is not supported, atleast one value should be given.");
+            goto err;
+        }
+    }
+    if (!cfgmgr_tcp_host_port(model, build->arena, build->end_point, &host_port, &host, &port)) {
+        LOG_ERROR("Get host and port of %s failed", build->end_point);
+        goto err;
+    }
+
+    if (desc->peer_key != NULL) {
+        if (build->prod && (model->invalid & desc->peer_invalid)) {
+            LOG_ERROR("[Type Missmatch]: %s should be of type String", desc->peer_key);
+            goto err;
+        }
+        peer = *(const char* const*) ((const char*) model + desc->peer_offset);
+        if (peer == NULL && (desc->peer_need == MSGBUS_PEER_ALWAYS ||
+                             (desc->peer_need == MSGBUS_PEER_PROD && build->prod))) {
+            LOG_ERROR("%s initialization failed or type mismatch", desc->peer_key);
+            goto err;
+        }
+    }
+
+    if (build->prod) {
+        LOG_DEBUG_0("Running in Prod Mode...");
+        cfgmgr_trace_span_t span = cfgmgr_trace_begin("cfgmgr.read_msgbus_keys");
+        bool ret = msgbus_read_keys(build, peer, &keys);
+        cfgmgr_trace_end(&span, NULL);
+        if (!ret) {
+            LOG_ERROR("Failed to read the keys of the %s", desc->label);
+            goto err;
+        }
+    } else {
+        LOG_DEBUG_0("Running in Dev Mode...");
+    }
+
+    const msgbus_keys_t* obj_keys = build->prod ? &keys : NULL;
+    if (desc->slot == MSGBUS_SLOT_TOPICS) {
+        for (size_t i = 0; i < topics->count; i++) {
+            const char* key = topics->wildcard ? "" : topics->items[i];
+            if (!msgbus_set(build, build->root, key, msgbus_endpoint_object(build, host, port, obj_keys))) {
+                goto err;
+            }
+        }
+    } else {
+        const char* key = (desc->slot == MSGBUS_SLOT_NAME) ? model->name : desc->slot_key;
+        if (!msgbus_set(build, build->root, key, msgbus_endpoint_object(build, host, port, obj_keys))) {
+            goto err;
+        }
+    }
+    LOG_DEBUG("Env %s config is : Type : %s, Name : %s, Host : %s, Port : %lld",
+              desc->label, build->type, model->name, host, (long long) port);
+
+    // We should add all success-path code above this line
+    ret_val = true;
+err:
+    if (keys.server_public_key != NULL) {
+        free(keys.server_public_key);
+    }
+    if (keys.client_public_key != NULL) {
+        free(keys.client_public_key);
+    }
+    if (keys.secret_key != NULL) {
+        free(keys.secret_key);
+    }
+    if (host_port != NULL) {
+        free_mem(host_port);
+    }
+    return ret_val;
+}
+
+// Builds with the env overrides pinned, see cfgmgr_msgbus_build()
+static config_t* msgbus_build(cfgmgr_interface_t* ctx, kv_store_client_t* kv_store_client,
+                              void* kv_store_handle) {
+    const cfgmgr_iface_model_t* model = ctx->model;
+    msgbus_build_t build;
+    bool (*build_transport)(msgbus_build_t*) = NULL;
+    memset(&build, 0, sizeof(build));
+
+    if ((size_t) ctx->type >= MSGBUS_IFACE_DESC_COUNT) {
+        LOG_ERROR_0("Interface type not supported");
+        return NULL;
+    }
+    build.desc = &msgbus_iface_descs[ctx->type];
+    if (model == NULL) {
+        LOG_ERROR("Model of the %s is not initialized", build.desc->label);
+        return NULL;
+    }
+    if (model->name == NULL) {
+        LOG_ERROR("%s of the %s is missing or not a string", NAME, build.desc->label);
+        return NULL;
+    }
+    if (model->type == NULL) {
+        LOG_ERROR("%s of the %s %s is missing or not a string", TYPE, build.desc->label, model->name);
+        return NULL;
+    }
+    if (model->endpoint == NULL) {
+        LOG_ERROR("%s of the %s %s is missing", ENDPOINT, build.desc->label, model->name);
+        return NULL;
+    }
+    if (model->invalid & CFGMGR_IFACE_BAD_ZMQ_RECV_HWM) {
+        LOG_ERROR_0("zmq_recv_hwm type is not integer");
+        return NULL;
+    }
+    if (build.desc->brokered && (model->invalid & CFGMGR_IFACE_BAD_BROKERED)) {
+        LOG_ERROR_0("brokered_value type is not boolean");
+        return NULL;
+    }
+
+    build.ctx = ctx;
+    build.model = model;
+    build.kv_store_client = kv_store_client;
+    build.kv_store_handle = kv_store_handle;
+    build.prod = ctx->cfg_mgr->dev_mode != 0;
+    build.type = model->type;
+    build.end_point = model->endpoint;
+    // Overriding Type and EndPoint with <TYPE>_<Name>_* or <TYPE>_* if set
+    cfgmgr_apply_env_overrides(ctx->cfg_mgr, ctx->type, model->name, &build.type, &build.end_point);
+    for (size_t i = 0; i < sizeof(msgbus_transports) / sizeof(msgbus_transports[0]); i++) {
+        if (strcmp(msgbus_transports[i].type, build.type) == 0) {
+            build_transport = msgbus_transports[i].build;
+            break;
+        }
+    }
+    if (build_transport == NULL) {
+        LOG_ERROR("Type %s is not supported, it should be either \"zmq_ipc\" or \"zmq_tcp\"", build.type);
+        return NULL;
+    }
+
+    if (ctx->cfg_mgr->msgbus_arena) {
+        build.arena = cfgmgr_arena_new(CFGMGR_MSGBUS_ARENA_CHUNK_SIZE);
+        if (build.arena == NULL) {
+            LOG_ERROR_0("Failed to create the arena of the msgbus config");
+            return NULL;
+        }
+        // The arena belongs to the config from here on
+        build.config = cfgmgr_arena_config_new(build.arena);
+        if (build.config == NULL) {
+            LOG_ERROR_0("Failed to create the msgbus config");
+            cfgmgr_arena_destroy(build.arena);
+            return NULL;
+        }
+        build.root = (cJSON*) build.config->cfg;
+    } else {
+        build.root = cJSON_CreateObject();
+        if (build.root == NULL) {
+            LOG_ERROR_0("Failed to create the msgbus config");
+            return NULL;
+        }
+        build.config = config_new(build.root, free_json, get_config_value, set_config_value);
+        if (build.config == NULL) {
+            LOG_ERROR_0("Failed to create the msgbus config");
+            cJSON_Delete(build.root);
+            return NULL;
+        }
+    }
+    if (!msgbus_set(&build, build.root, "type", msgbus_string(&build, build.type))) {
+        goto err;
+    }
+    if (model->has_zmq_recv_hwm &&
+            !msgbus_set(&build, build.root, ZMQ_RECV_HWM, msgbus_number(&build, (double) model->zmq_recv_hwm))) {
+        goto err;
+    }
+    if (!build_transport(&build)) {
+        goto err;
+    }
+    return build.config;
+err:
+    config_destroy(build.config);
+    return NULL;
+}
+
+config_t* cfgmgr_msgbus_build(cfgmgr_interface_t* ctx, kv_store_client_t* kv_store_client,
+                              void* kv_store_handle) {
+    LOG_DEBUG("In %s function", __func__);
+    cfgmgr_env_overrides_t* overrides = ctx->cfg_mgr->env_overrides;
+    if (overrides == NULL) {
+        return msgbus_build(ctx, kv_store_client, kv_store_handle);
+    }
+    // The override values are used until the config is built
+    cfgmgr_gen_guard_t guard = cfgmgr_env_overrides_pin(overrides);
+    config_t* config = msgbus_build(ctx, kv_store_client, kv_store_handle);
+    cfgmgr_env_overrides_unpin(overrides, &guard);
+    return config;
+}
@@ -0,0 +1,200 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Message bus configuration cache of the ConfigManager implementation
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/json_config.h>
+#include "eii/config_manager/cfgmgr_arena.h"
+#include "eii/config_manager/cfgmgr_msgbus_cache.h"
+
+// Number of hash buckets, power of two
+#define MSGBUS_CACHE_BUCKETS    128
+
+typedef struct msgbus_cache_entry {
+    const void* iface;
+    config_t* config;
+    struct msgbus_cache_entry* next;
+} msgbus_cache_entry_t;
+
+struct cfgmgr_msgbus_cache {
+    msgbus_cache_entry_t* buckets[MSGBUS_CACHE_BUCKETS];
+    // Bumped on every invalidation
+    uint64_t epoch;
+    // Chunk size of the arenas entries and copies live in, 0 for the heap
+    size_t arena_chunk_size;
+    pthread_mutex_t mtx;
+};
+
+static size_t msgbus_cache_bucket(const void* iface) {
+    uintptr_t key = (uintptr_t) iface;
+    // Nodes are heap allocated, the low bits carry no information
+    key ^= key >> 17;
+    key *= (uintptr_t) 0x9E3779B97F4A7C15ull;
+    return (size_t) (key >> 7) & (MSGBUS_CACHE_BUCKETS - 1);
+}
+
+static void msgbus_cache_entry_free(msgbus_cache_entry_t* entry) {
+    config_destroy(entry->config);
+    free(entry);
+}
+
+cfgmgr_msgbus_cache_t* cfgmgr_msgbus_cache_new() {
+    cfgmgr_msgbus_cache_t* cache = (cfgmgr_msgbus_cache_t*) calloc(1, sizeof(cfgmgr_msgbus_cache_t));
+    if (cache == NULL) {
+        LOG_ERROR_0("Malloc failed for cfgmgr_msgbus_cache_t");
+        return NULL;
+    }
+    if (pthread_mutex_init(&cache->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize msgbus cache mutex");
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void cfgmgr_msgbus_cache_use_arena(cfgmgr_msgbus_cache_t* cache, size_t chunk_size) {
+    pthread_mutex_lock(&cache->mtx);
+    cache->arena_chunk_size = chunk_size;
+    pthread_mutex_unlock(&cache->mtx);
+}
+
+// Deep copy of a configuration, in its own arena if the cache uses them
+static config_t* msgbus_cache_copy(size_t arena_chunk_size, const config_t* config) {
+    if (arena_chunk_size != 0) {
+        return cfgmgr_arena_config_copy((const cJSON*) config->cfg, arena_chunk_size);
+    }
+    cJSON* copy = cJSON_Duplicate((const cJSON*) config->cfg, true);
+    if (copy == NULL) {
+        return NULL;
+    }
+    config_t* result = config_new((void*) copy, free_json, get_config_value, set_config_value);
+    if (result == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(copy);
+        return NULL;
+    }
+    return result;
+}
+
+config_t* cfgmgr_msgbus_cache_get(cfgmgr_msgbus_cache_t* cache, const void* iface, uint64_t* epoch) {
+    config_t* copy = NULL;
+    pthread_mutex_lock(&cache->mtx);
+    *epoch = cache->epoch;
+    for (msgbus_cache_entry_t* entry = cache->buckets[msgbus_cache_bucket(iface)];
+            entry != NULL; entry = entry->next) {
+        if (entry->iface == iface) {
+            copy = msgbus_cache_copy(cache->arena_chunk_size, entry->config);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->mtx);
+    return copy;
+}
+
+void cfgmgr_msgbus_cache_put(cfgmgr_msgbus_cache_t* cache, const void* iface,
+                             uint64_t epoch, const config_t* config) {
+    msgbus_cache_entry_t* entry = (msgbus_cache_entry_t*) malloc(sizeof(msgbus_cache_entry_t));
+    if (entry == NULL) {
+        LOG_ERROR_0("Malloc failed for msgbus cache entry");
+        return;
+    }
+    pthread_mutex_lock(&cache->mtx);
+    size_t arena_chunk_size = cache->arena_chunk_size;
+    pthread_mutex_unlock(&cache->mtx);
+    entry->iface = iface;
+    entry->config = msgbus_cache_copy(arena_chunk_size, config);
+    entry->next = NULL;
+    if (entry->config == NULL) {
+        LOG_ERROR_0("Failed to copy msgbus config into the cache");
+        free(entry);
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mtx);
+    if (cache->epoch != epoch) {
+        // Invalidated while the configuration was being built
+        pthread_mutex_unlock(&cache->mtx);
+        msgbus_cache_entry_free(entry);
+        return;
+    }
+    // One entry per interface, replacing one built concurrently
+    msgbus_cache_entry_t** link = &cache->buckets[msgbus_cache_bucket(iface)];
+    while (*link != NULL && (*link)->iface != iface) {
+        link = &(*link)->next;
+    }
+    msgbus_cache_entry_t* old = *link;
+    if (old != NULL) {
+        entry->next = old->next;
+    }
+    *link = entry;
+    pthread_mutex_unlock(&cache->mtx);
+    if (old != NULL) {
+        msgbus_cache_entry_free(old);
+    }
+}
+
+// Must be called with the cache locked, returns the detached entries
+static msgbus_cache_entry_t* msgbus_cache_detach(cfgmgr_msgbus_cache_t* cache) {
+    msgbus_cache_entry_t* detached = NULL;
+    for (size_t i = 0; i < MSGBUS_CACHE_BUCKETS; i++) {
+        msgbus_cache_entry_t* entry = cache->buckets[i];
+        while (entry != NULL) {
+            msgbus_cache_entry_t* next = entry->next;
+            entry->next = detached;
+            detached = entry;
+            entry = next;
+        }
+        cache->buckets[i] = NULL;
+    }
+    return detached;
+}
+
+void cfgmgr_msgbus_cache_invalidate(cfgmgr_msgbus_cache_t* cache) {
+    pthread_mutex_lock(&cache->mtx);
+    cache->epoch++;
+    msgbus_cache_entry_t* entry = msgbus_cache_detach(cache);
+    pthread_mutex_unlock(&cache->mtx);
+    while (entry != NULL) {
+        msgbus_cache_entry_t* next = entry->next;
+        msgbus_cache_entry_free(entry);
+        entry = next;
+    }
+}
+
+void cfgmgr_msgbus_cache_destroy(cfgmgr_msgbus_cache_t* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    msgbus_cache_entry_t* entry = msgbus_cache_detach(cache);
+    while (entry != NULL) {
+        msgbus_cache_entry_t* next = entry->next;
+        msgbus_cache_entry_free(entry);
+        entry = next;
+    }
+    pthread_mutex_destroy(&cache->mtx);
+    free(cache);
+}
@@ -0,0 +1,247 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Sealed file implementation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_seal.h"
+
+#define SEAL_ENCRYPTED  0x1u
+#define SEAL_IV_SIZE    12
+#define SEAL_TAG_SIZE   16
+
+// Header of a sealed image, as described in cfgmgr_seal.h
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint8_t iv[SEAL_IV_SIZE];
+    uint64_t length;
+} seal_header_t;
+
+void* cfgmgr_seal(uint32_t magic, uint32_t version, const unsigned char* key,
+                  const void* data, size_t length, size_t* size) {
+    size_t trailer = (key != NULL) ? SEAL_TAG_SIZE : SHA256_DIGEST_LENGTH;
+    unsigned char* image = (unsigned char*) malloc(sizeof(seal_header_t) + length + trailer);
+    if (image == NULL) {
+        LOG_ERROR_0("Failed to allocate the sealed image");
+        return NULL;
+    }
+    seal_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = magic;
+    header.version = version;
+    header.flags = (key != NULL) ? SEAL_ENCRYPTED : 0;
+    header.length = length;
+    unsigned char* body = image + sizeof(header);
+
+    if (key == NULL) {
+        memcpy(image, &header, sizeof(header));
+        memcpy(body, data, length);
+        SHA256(image, sizeof(header) + length, body + length);
+        *size = sizeof(header) + length + trailer;
+        return image;
+    }
+
+    EVP_CIPHER_CTX* cipher = NULL;
+    int len;
+    if (RAND_bytes(header.iv, SEAL_IV_SIZE) != 1) {
+        goto err;
+    }
+    memcpy(image, &header, sizeof(header));
+    cipher = EVP_CIPHER_CTX_new();
+    if (cipher == NULL ||
+            EVP_EncryptInit_ex(cipher, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1 ||
+            EVP_CIPHER_CTX_ctrl(cipher, EVP_CTRL_GCM_SET_IVLEN, SEAL_IV_SIZE, NULL) != 1 ||
+            EVP_EncryptInit_ex(cipher, NULL, NULL, key, header.iv) != 1 ||
+            EVP_EncryptUpdate(cipher, NULL, &len, image, sizeof(header)) != 1 ||
+            EVP_EncryptUpdate(cipher, body, &len, (const unsigned char*) data, (int) length) != 1 ||
+            EVP_EncryptFinal_ex(cipher, body + len, &len) != 1 ||
+            EVP_CIPHER_CTX_ctrl(cipher, EVP_CTRL_GCM_GET_TAG, SEAL_TAG_SIZE, body + length) != 1) {
+        goto err;
+    }
+    EVP_CIPHER_CTX_free(cipher);
+    *size = sizeof(header) + length + trailer;
+    return image;
+
+err:
+    LOG_ERROR_0("Failed to encrypt the sealed image");
+    if (cipher != NULL) {
+        EVP_CIPHER_CTX_free(cipher);
+    }
+    free(image);
+    return NULL;
+}
+
+void* cfgmgr_seal_open(uint32_t magic, uint32_t version, const unsigned char* key,
+                       const void* image, size_t size, size_t* length, const char* name) {
+    const unsigned char* bytes = (const unsigned char*) image;
+    seal_header_t header;
+    if (size < sizeof(header)) {
+        LOG_WARN("%s is truncated", name);
+        return NULL;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != magic || header.version != version) {
+        LOG_WARN("%s is not a file of this version", name);
+        return NULL;
+    }
+    bool encrypted = (header.flags & SEAL_ENCRYPTED) != 0;
+    if (encrypted != (key != NULL)) {
+        LOG_WARN("%s is %s, ignoring it", name, encrypted ? "encrypted" : "not encrypted");
+        return NULL;
+    }
+    size_t trailer = encrypted ? SEAL_TAG_SIZE : SHA256_DIGEST_LENGTH;
+    if (size < sizeof(header) + trailer || header.length != size - sizeof(header) - trailer) {
+        LOG_WARN("%s is truncated", name);
+        return NULL;
+    }
+    size_t data_len = (size_t) header.length;
+    const unsigned char* body = bytes + sizeof(header);
+    unsigned char* data = (unsigned char*) malloc(data_len + 1);
+    if (data == NULL) {
+        LOG_ERROR_0("Failed to allocate the opened data");
+        return NULL;
+    }
+
+    if (!encrypted) {
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(bytes, sizeof(header) + data_len, digest);
+        if (CRYPTO_memcmp(digest, body + data_len, SHA256_DIGEST_LENGTH) != 0) {
+            LOG_WARN("%s is corrupt", name);
+            free(data);
+            return NULL;
+        }
+        memcpy(data, body, data_len);
+        data[data_len] = '\0';
+        *length = data_len;
+        return data;
+    }
+
+    int len;
+    EVP_CIPHER_CTX* cipher = EVP_CIPHER_CTX_new();
+    if (cipher == NULL ||
+            EVP_DecryptInit_ex(cipher, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1 ||
+            EVP_CIPHER_CTX_ctrl(cipher, EVP_CTRL_GCM_SET_IVLEN, SEAL_IV_SIZE, NULL) != 1 ||
+            EVP_DecryptInit_ex(cipher, NULL, NULL, key, header.iv) != 1 ||
+            EVP_DecryptUpdate(cipher, NULL, &len, bytes, sizeof(header)) != 1 ||
+            EVP_DecryptUpdate(cipher, data, &len, body, (int) data_len) != 1 ||
+            EVP_CIPHER_CTX_ctrl(cipher, EVP_CTRL_GCM_SET_TAG, SEAL_TAG_SIZE,
+                                (void*) (body + data_len)) != 1 ||
+            EVP_DecryptFinal_ex(cipher, data + len, &len) != 1) {
+        LOG_WARN("%s is corrupt or encrypted with another key", name);
+        if (cipher != NULL) {
+            EVP_CIPHER_CTX_free(cipher);
+        }
+        OPENSSL_cleanse(data, data_len);
+        free(data);
+        return NULL;
+    }
+    EVP_CIPHER_CTX_free(cipher);
+    data[data_len] = '\0';
+    *length = data_len;
+    return data;
+}
+
+static int seal_hex(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+int cfgmgr_seal_read_key(const char* path, unsigned char* key) {
+    unsigned char buf[2 * CFGMGR_SEAL_KEY_SIZE + 2];
+    int ret = -1;
+    size_t size = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open the key %s: %s", path, strerror(errno));
+        return -1;
+    }
+    while (size < sizeof(buf)) {
+        ssize_t rc = read(fd, buf + size, sizeof(buf) - size);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            LOG_ERROR("Failed to read the key %s", path);
+            goto err;
+        }
+        if (rc == 0) {
+            break;
+        }
+        size += (size_t) rc;
+    }
+    if (size == CFGMGR_SEAL_KEY_SIZE) {
+        memcpy(key, buf, CFGMGR_SEAL_KEY_SIZE);
+        ret = 0;
+        goto err;
+    }
+    // Hex, optionally followed by a newline
+    while (size > 0 && (buf[size - 1] == '\n' || buf[size - 1] == '\r')) {
+        size--;
+    }
+    if (size != 2 * CFGMGR_SEAL_KEY_SIZE) {
+        LOG_ERROR("The key %s must hold %d bytes or their hex encoding", path,
+                  CFGMGR_SEAL_KEY_SIZE);
+        goto err;
+    }
+    for (size_t i = 0; i < CFGMGR_SEAL_KEY_SIZE; i++) {
+        int high = seal_hex((char) buf[2 * i]);
+        int low = seal_hex((char) buf[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            LOG_ERROR("The key %s is not hex encoded", path);
+            goto err;
+        }
+        key[i] = (unsigned char) (high << 4 | low);
+    }
+    ret = 0;
+
+err:
+    OPENSSL_cleanse(buf, sizeof(buf));
+    close(fd);
+    return ret;
+}
+
+void cfgmgr_seal_clear_key(unsigned char* key) {
+    OPENSSL_cleanse(key, CFGMGR_SEAL_KEY_SIZE);
+}
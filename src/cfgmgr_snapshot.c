@@ -0,0 +1,386 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Versioned snapshots of the ConfigManager configuration implementation
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_snapshot.h"
+
+// Number of readers which can pin a snapshot at the same time
+#define SNAPSHOT_READER_SLOTS   64
+
+// Config shared by consecutive snapshots until one replaces it
+typedef struct snapshot_config {
+    config_t* config;
+    // References handed out, under the store mutex
+    size_t refs;
+    // Set once no snapshot owns it, freed with its last reference
+    bool retired;
+    // Set once cfgmgr_snapshots_app_config() returned it, which holds a
+    // reference until the store is destroyed
+    bool handed_out;
+    // Next retired config still referenced
+    struct snapshot_config* next;
+} snapshot_config_t;
+
+typedef struct snapshot_node {
+    cfgmgr_snapshot_t snapshot;
+    snapshot_config_t* config;
+    // Whether the config is freed with this snapshot, handed over to
+    // the next snapshot when it shares the config
+    bool owns_config;
+    // Whether the interfaces are released with this snapshot, handed over
+    // the same way
+    bool owns_interface;
+    // Epoch the snapshot was retired at
+    uint64_t retired_epoch;
+    // Next retired snapshot
+    struct snapshot_node* next;
+} snapshot_node_t;
+
+struct cfgmgr_snapshots {
+    _Atomic(snapshot_node_t*) current;
+
+    // Bumped by every snapshot retired, starts at 1
+    atomic_uint_fast64_t epoch;
+
+    // Epoch each reader pinned at, 0 for a free slot
+    atomic_uint_fast64_t readers[SNAPSHOT_READER_SLOTS];
+
+    // Serializes publishing and reclamation
+    pthread_mutex_t mtx;
+    snapshot_node_t* retired;
+    size_t retired_count;
+    // Retired configs still referenced
+    snapshot_config_t* held;
+    size_t held_count;
+
+    // Called for the interfaces no snapshot holds anymore
+    cfgmgr_snapshots_release_t release_interface;
+    void* release_user_data;
+};
+
+// Slot the thread pinned with last, free unless it pins twice
+static _Thread_local size_t snapshot_slot_hint;
+
+static void snapshot_config_free(snapshot_config_t* config) {
+    config_destroy(config->config);
+    free(config);
+}
+
+static void snapshot_node_free(cfgmgr_snapshots_t* snapshots, snapshot_node_t* node) {
+    if (node->owns_interface && snapshots->release_interface != NULL) {
+        snapshots->release_interface(node->snapshot.app_interface, snapshots->release_user_data);
+    }
+    if (node->owns_config) {
+        if (node->config->refs > 0) {
+            node->config->retired = true;
+            node->config->next = snapshots->held;
+            snapshots->held = node->config;
+            snapshots->held_count++;
+        } else {
+            snapshot_config_free(node->config);
+        }
+    }
+    free(node);
+}
+
+// Drops a reference, with the mutex held
+static void snapshot_config_unref(cfgmgr_snapshots_t* snapshots, snapshot_config_t* config) {
+    if (--config->refs > 0 || !config->retired) {
+        return;
+    }
+    snapshot_config_t** link = &snapshots->held;
+    while (*link != config) {
+        link = &(*link)->next;
+    }
+    *link = config->next;
+    snapshots->held_count--;
+    snapshot_config_free(config);
+}
+
+// Finds the config of a snapshot or a held config, with the mutex held
+static snapshot_config_t* snapshot_config_find(cfgmgr_snapshots_t* snapshots, config_t* config) {
+    snapshot_node_t* node = atomic_load_explicit(&snapshots->current, memory_order_relaxed);
+    if (node->config != NULL && node->config->config == config) {
+        return node->config;
+    }
+    for (node = snapshots->retired; node != NULL; node = node->next) {
+        if (node->config != NULL && node->config->config == config) {
+            return node->config;
+        }
+    }
+    for (snapshot_config_t* held = snapshots->held; held != NULL; held = held->next) {
+        if (held->config == config) {
+            return held;
+        }
+    }
+    return NULL;
+}
+
+// Frees the retired snapshots older than every pinned epoch
+static void snapshots_reclaim(cfgmgr_snapshots_t* snapshots) {
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < SNAPSHOT_READER_SLOTS; i++) {
+        uint64_t epoch = atomic_load(&snapshots->readers[i]);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    snapshot_node_t** link = &snapshots->retired;
+    while (*link != NULL) {
+        snapshot_node_t* node = *link;
+        // Readers which pinned at the retiring epoch may still read it
+        if (node->retired_epoch < oldest) {
+            *link = node->next;
+            snapshot_node_free(snapshots, node);
+            snapshots->retired_count--;
+        } else {
+            link = &node->next;
+        }
+    }
+}
+
+cfgmgr_snapshots_t* cfgmgr_snapshots_new(config_t* app_config, config_t* app_interface) {
+    cfgmgr_snapshots_t* snapshots = (cfgmgr_snapshots_t*) calloc(1, sizeof(cfgmgr_snapshots_t));
+    if (snapshots == NULL) {
+        LOG_ERROR_0("Calloc failed for cfgmgr_snapshots_t");
+        return NULL;
+    }
+    snapshot_node_t* node = (snapshot_node_t*) calloc(1, sizeof(snapshot_node_t));
+    snapshot_config_t* config = NULL;
+    if (app_config != NULL) {
+        config = (snapshot_config_t*) calloc(1, sizeof(snapshot_config_t));
+    }
+    if (node == NULL || (app_config != NULL && config == NULL)) {
+        LOG_ERROR_0("Calloc failed for snapshot");
+        goto err;
+    }
+    if (pthread_mutex_init(&snapshots->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize snapshots mutex");
+        goto err;
+    }
+    if (config != NULL) {
+        config->config = app_config;
+    }
+    // Without a config until one is published
+    node->config = config;
+    node->owns_config = config != NULL;
+    node->owns_interface = app_interface != NULL;
+    node->snapshot.version = 1;
+    node->snapshot.app_config = app_config;
+    node->snapshot.app_interface = app_interface;
+    atomic_init(&snapshots->current, node);
+    atomic_init(&snapshots->epoch, 1);
+    for (size_t i = 0; i < SNAPSHOT_READER_SLOTS; i++) {
+        atomic_init(&snapshots->readers[i], 0);
+    }
+    return snapshots;
+
+err:
+    free(config);
+    free(node);
+    free(snapshots);
+    return NULL;
+}
+
+int cfgmgr_snapshots_publish(cfgmgr_snapshots_t* snapshots, config_t* app_config,
+                             config_t* app_interface) {
+    snapshot_node_t* node = (snapshot_node_t*) calloc(1, sizeof(snapshot_node_t));
+    if (node == NULL) {
+        LOG_ERROR_0("Calloc failed for snapshot");
+        return -1;
+    }
+    snapshot_config_t* config = NULL;
+    if (app_config != NULL) {
+        config = (snapshot_config_t*) calloc(1, sizeof(snapshot_config_t));
+        if (config == NULL) {
+            LOG_ERROR_0("Calloc failed for snapshot config");
+            free(node);
+            return -1;
+        }
+        config->config = app_config;
+    }
+
+    pthread_mutex_lock(&snapshots->mtx);
+    snapshot_node_t* prev = atomic_load_explicit(&snapshots->current, memory_order_relaxed);
+    node->snapshot.version = prev->snapshot.version + 1;
+    node->snapshot.app_interface = (app_interface != NULL) ? app_interface
+                                                           : prev->snapshot.app_interface;
+    if (config != NULL) {
+        node->config = config;
+        node->owns_config = true;
+    } else {
+        node->config = prev->config;
+        node->owns_config = prev->owns_config;
+        prev->owns_config = false;
+    }
+    if (app_interface != NULL) {
+        node->owns_interface = true;
+    } else {
+        node->owns_interface = prev->owns_interface;
+        prev->owns_interface = false;
+    }
+    node->snapshot.app_config = (node->config != NULL) ? node->config->config : NULL;
+    atomic_store(&snapshots->current, node);
+
+    // Readers pinning from now on can only see the new snapshot
+    prev->retired_epoch = atomic_fetch_add(&snapshots->epoch, 1);
+    prev->next = snapshots->retired;
+    snapshots->retired = prev;
+    snapshots->retired_count++;
+    snapshots_reclaim(snapshots);
+    pthread_mutex_unlock(&snapshots->mtx);
+    return 0;
+}
+
+cfgmgr_snapshot_guard_t cfgmgr_snapshots_pin(cfgmgr_snapshots_t* snapshots) {
+    cfgmgr_snapshot_guard_t guard;
+    for (;;) {
+        for (size_t i = 0; i < SNAPSHOT_READER_SLOTS; i++) {
+            size_t slot = (snapshot_slot_hint + i) % SNAPSHOT_READER_SLOTS;
+            uint_fast64_t free_slot = 0;
+            uint_fast64_t epoch = atomic_load(&snapshots->epoch);
+            if (atomic_load_explicit(&snapshots->readers[slot], memory_order_relaxed) == 0 &&
+                    atomic_compare_exchange_strong(&snapshots->readers[slot], &free_slot, epoch)) {
+                snapshot_slot_hint = slot;
+                guard.slot = (int) slot;
+                guard.snapshot = &atomic_load(&snapshots->current)->snapshot;
+                return guard;
+            }
+        }
+        // Every slot is pinned
+        sched_yield();
+    }
+}
+
+void cfgmgr_snapshots_unpin(cfgmgr_snapshots_t* snapshots, cfgmgr_snapshot_guard_t* guard) {
+    if (guard->snapshot == NULL) {
+        return;
+    }
+    atomic_store_explicit(&snapshots->readers[guard->slot], 0, memory_order_release);
+    guard->snapshot = NULL;
+}
+
+config_t* cfgmgr_snapshots_acquire_config(cfgmgr_snapshots_t* snapshots) {
+    // The pin keeps the config alive until it is referenced
+    cfgmgr_snapshot_guard_t guard = cfgmgr_snapshots_pin(snapshots);
+    snapshot_node_t* node = (snapshot_node_t*) guard.snapshot;
+    config_t* app_config = NULL;
+    if (node->config != NULL) {
+        pthread_mutex_lock(&snapshots->mtx);
+        node->config->refs++;
+        pthread_mutex_unlock(&snapshots->mtx);
+        app_config = node->snapshot.app_config;
+    }
+    cfgmgr_snapshots_unpin(snapshots, &guard);
+    return app_config;
+}
+
+void cfgmgr_snapshots_release_config(cfgmgr_snapshots_t* snapshots, config_t* app_config) {
+    if (app_config == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&snapshots->mtx);
+    snapshot_config_t* config = snapshot_config_find(snapshots, app_config);
+    // The reference of cfgmgr_snapshots_app_config() is never released
+    if (config == NULL || config->refs <= (size_t) config->handed_out) {
+        LOG_ERROR_0("Released a config which was not acquired");
+    } else {
+        snapshot_config_unref(snapshots, config);
+    }
+    pthread_mutex_unlock(&snapshots->mtx);
+}
+
+config_t* cfgmgr_snapshots_app_config(cfgmgr_snapshots_t* snapshots) {
+    cfgmgr_snapshot_guard_t guard = cfgmgr_snapshots_pin(snapshots);
+    snapshot_node_t* node = (snapshot_node_t*) guard.snapshot;
+    config_t* app_config = NULL;
+    if (node->config != NULL) {
+        pthread_mutex_lock(&snapshots->mtx);
+        // Callers never release it, another thread may still read it
+        if (!node->config->handed_out) {
+            node->config->handed_out = true;
+            node->config->refs++;
+        }
+        pthread_mutex_unlock(&snapshots->mtx);
+        app_config = node->snapshot.app_config;
+    }
+    cfgmgr_snapshots_unpin(snapshots, &guard);
+    return app_config;
+}
+
+size_t cfgmgr_snapshots_retired(cfgmgr_snapshots_t* snapshots) {
+    pthread_mutex_lock(&snapshots->mtx);
+    size_t count = snapshots->retired_count;
+    pthread_mutex_unlock(&snapshots->mtx);
+    return count;
+}
+
+void cfgmgr_snapshots_set_interface_release(cfgmgr_snapshots_t* snapshots,
+                                            cfgmgr_snapshots_release_t release,
+                                            void* user_data) {
+    pthread_mutex_lock(&snapshots->mtx);
+    snapshots->release_interface = release;
+    snapshots->release_user_data = user_data;
+    pthread_mutex_unlock(&snapshots->mtx);
+}
+
+size_t cfgmgr_snapshots_held(cfgmgr_snapshots_t* snapshots) {
+    pthread_mutex_lock(&snapshots->mtx);
+    size_t count = snapshots->held_count;
+    pthread_mutex_unlock(&snapshots->mtx);
+    return count;
+}
+
+void cfgmgr_snapshots_destroy(cfgmgr_snapshots_t* snapshots) {
+    if (snapshots == NULL) {
+        return;
+    }
+    snapshot_node_t* node = atomic_load(&snapshots->current);
+    node->next = snapshots->retired;
+    while (node != NULL) {
+        snapshot_node_t* next = node->next;
+        if (node->owns_interface && snapshots->release_interface != NULL) {
+            snapshots->release_interface(node->snapshot.app_interface,
+                                         snapshots->release_user_data);
+        }
+        if (node->owns_config) {
+            snapshot_config_free(node->config);
+        }
+        free(node);
+        node = next;
+    }
+    while (snapshots->held != NULL) {
+        snapshot_config_t* next = snapshots->held->next;
+        snapshot_config_free(snapshots->held);
+        snapshots->held = next;
+    }
+    pthread_mutex_destroy(&snapshots->mtx);
+    free(snapshots);
+}
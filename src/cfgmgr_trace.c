@@ -0,0 +1,267 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Startup and msgbus config tracing of the ConfigManager implementation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_trace.h"
+
+typedef struct {
+    const char* name;
+    char* detail;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t tid;
+} trace_event_t;
+
+static atomic_bool trace_on = false;
+
+// Recorded spans, guarded by trace_mtx
+static pthread_mutex_t trace_mtx = PTHREAD_MUTEX_INITIALIZER;
+static trace_event_t* trace_events = NULL;
+static size_t trace_count = 0;
+static size_t trace_capacity = 0;
+static uint64_t trace_dropped = 0;
+
+static _Thread_local uint32_t trace_tid = 0;
+
+static uint64_t trace_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static uint32_t trace_thread_id() {
+    if (trace_tid == 0) {
+        trace_tid = (uint32_t) syscall(SYS_gettid);
+    }
+    return trace_tid;
+}
+
+void cfgmgr_trace_enable(bool enable) {
+    atomic_store(&trace_on, enable);
+}
+
+bool cfgmgr_trace_enabled() {
+    return atomic_load_explicit(&trace_on, memory_order_relaxed);
+}
+
+cfgmgr_trace_span_t cfgmgr_trace_begin(const char* name) {
+    cfgmgr_trace_span_t span;
+    span.name = name;
+    span.start_ns = cfgmgr_trace_enabled() ? trace_now_ns() : 0;
+    return span;
+}
+
+void cfgmgr_trace_end(cfgmgr_trace_span_t* span, const char* detail) {
+    if (span->start_ns == 0) {
+        return;
+    }
+    trace_event_t event;
+    event.name = span->name;
+    event.start_ns = span->start_ns;
+    event.duration_ns = trace_now_ns() - span->start_ns;
+    event.tid = trace_thread_id();
+    event.detail = (detail != NULL) ? strdup(detail) : NULL;
+    // Ending a span twice records it once
+    span->start_ns = 0;
+
+    pthread_mutex_lock(&trace_mtx);
+    if (trace_count == trace_capacity && trace_capacity < CFGMGR_TRACE_MAX_SPANS) {
+        size_t capacity = (trace_capacity == 0) ? 256 : trace_capacity * 2;
+        if (capacity > CFGMGR_TRACE_MAX_SPANS) {
+            capacity = CFGMGR_TRACE_MAX_SPANS;
+        }
+        trace_event_t* grown = (trace_event_t*) realloc(trace_events,
+                                                        capacity * sizeof(trace_event_t));
+        if (grown != NULL) {
+            trace_events = grown;
+            trace_capacity = capacity;
+        }
+    }
+    if (trace_count < trace_capacity) {
+        trace_events[trace_count++] = event;
+        event.detail = NULL;
+    } else {
+        trace_dropped++;
+    }
+    pthread_mutex_unlock(&trace_mtx);
+    free(event.detail);
+}
+
+int cfgmgr_trace_export(const char* path) {
+    int ret_val = -1;
+    char* json = NULL;
+    FILE* file = NULL;
+    cJSON* root = cJSON_CreateObject();
+    cJSON* events = cJSON_CreateArray();
+    if (root == NULL || events == NULL) {
+        LOG_ERROR_0("Failed to create trace JSON");
+        cJSON_Delete(events);
+        goto err;
+    }
+    cJSON_AddItemToObject(root, "traceEvents", events);
+    cJSON_AddStringToObject(root, "displayTimeUnit", "ms");
+
+    pid_t pid = getpid();
+    pthread_mutex_lock(&trace_mtx);
+    for (size_t i = 0; i < trace_count; i++) {
+        trace_event_t* event = &trace_events[i];
+        cJSON* item = cJSON_CreateObject();
+        if (item == NULL) {
+            pthread_mutex_unlock(&trace_mtx);
+            LOG_ERROR_0("Failed to create trace event");
+            goto err;
+        }
+        cJSON_AddItemToArray(events, item);
+        cJSON_AddStringToObject(item, "name", event->name);
+        cJSON_AddStringToObject(item, "cat", "cfgmgr");
+        cJSON_AddStringToObject(item, "ph", "X");
+        // Trace-event timestamps are in microseconds
+        cJSON_AddNumberToObject(item, "ts", (double) event->start_ns / 1000.0);
+        cJSON_AddNumberToObject(item, "dur", (double) event->duration_ns / 1000.0);
+        cJSON_AddNumberToObject(item, "pid", (double) pid);
+        cJSON_AddNumberToObject(item, "tid", (double) event->tid);
+        if (event->detail != NULL) {
+            cJSON* args = cJSON_AddObjectToObject(item, "args");
+            if (args != NULL) {
+                cJSON_AddStringToObject(args, "detail", event->detail);
+            }
+        }
+    }
+    cJSON* other = cJSON_AddObjectToObject(root, "otherData");
+    if (other != NULL) {
+        cJSON_AddNumberToObject(other, "dropped", (double) trace_dropped);
+    }
+    pthread_mutex_unlock(&trace_mtx);
+
+    json = cJSON_PrintUnformatted(root);
+    if (json == NULL) {
+        LOG_ERROR_0("Failed to print trace JSON");
+        goto err;
+    }
+    file = fopen(path, "w");
+    if (file == NULL) {
+        LOG_ERROR("Failed to open trace file %s", path);
+        goto err;
+    }
+    if (fputs(json, file) < 0) {
+        LOG_ERROR("Failed to write trace file %s", path);
+        goto err;
+    }
+
+    // We should add all success-path code above this line
+    ret_val = 0;
+err:
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (json != NULL) {
+        cJSON_free(json);
+    }
+    if (root != NULL) {
+        cJSON_Delete(root);
+    }
+    return ret_val;
+}
+
+static int trace_stat_cmp(const void* a, const void* b) {
+    const cfgmgr_trace_stat_t* left = (const cfgmgr_trace_stat_t*) a;
+    const cfgmgr_trace_stat_t* right = (const cfgmgr_trace_stat_t*) b;
+    if (left->total_ns != right->total_ns) {
+        return (left->total_ns < right->total_ns) ? 1 : -1;
+    }
+    return strcmp(left->name, right->name);
+}
+
+cfgmgr_trace_summary_t* cfgmgr_trace_summary() {
+    cfgmgr_trace_summary_t* summary = (cfgmgr_trace_summary_t*) calloc(
+            1, sizeof(cfgmgr_trace_summary_t));
+    if (summary == NULL) {
+        LOG_ERROR_0("Calloc failed for cfgmgr_trace_summary_t");
+        return NULL;
+    }
+    pthread_mutex_lock(&trace_mtx);
+    // At most one stat per span
+    summary->stats = (cfgmgr_trace_stat_t*) calloc(trace_count + 1, sizeof(cfgmgr_trace_stat_t));
+    if (summary->stats == NULL) {
+        pthread_mutex_unlock(&trace_mtx);
+        LOG_ERROR_0("Calloc failed for trace stats");
+        free(summary);
+        return NULL;
+    }
+    for (size_t i = 0; i < trace_count; i++) {
+        trace_event_t* event = &trace_events[i];
+        cfgmgr_trace_stat_t* stat = NULL;
+        // Few distinct names, a linear scan is enough
+        for (size_t j = 0; j < summary->count; j++) {
+            if (strcmp(summary->stats[j].name, event->name) == 0) {
+                stat = &summary->stats[j];
+                break;
+            }
+        }
+        if (stat == NULL) {
+            stat = &summary->stats[summary->count++];
+            stat->name = event->name;
+        }
+        stat->count++;
+        stat->total_ns += event->duration_ns;
+        if (event->duration_ns > stat->max_ns) {
+            stat->max_ns = event->duration_ns;
+        }
+    }
+    summary->dropped = trace_dropped;
+    pthread_mutex_unlock(&trace_mtx);
+    qsort(summary->stats, summary->count, sizeof(cfgmgr_trace_stat_t), trace_stat_cmp);
+    return summary;
+}
+
+void cfgmgr_trace_summary_destroy(cfgmgr_trace_summary_t* summary) {
+    if (summary == NULL) {
+        return;
+    }
+    free(summary->stats);
+    free(summary);
+}
+
+void cfgmgr_trace_reset() {
+    pthread_mutex_lock(&trace_mtx);
+    for (size_t i = 0; i < trace_count; i++) {
+        free(trace_events[i].detail);
+    }
+    free(trace_events);
+    trace_events = NULL;
+    trace_count = 0;
+    trace_capacity = 0;
+    trace_dropped = 0;
+    pthread_mutex_unlock(&trace_mtx);
+}
@@ -65,6 +65,7 @@ bool get_ipc_config(config_t* c_json, config_value_t* config, const char* end_po
     char* sock_dir = NULL;
     config_value_t* json_endpoint = NULL;
     char** socket_ep = NULL;
+    char* end_point_copy = NULL;
     config_value_t* topics_list = NULL;
     config_value_t* service_name = NULL;
     config_value_t* socketdir_cvt = NULL;
@@ -143,9 +144,16 @@ bool get_ipc_config(config_t* c_json, config_value_t* config, const char* end_po
             goto err;
         }
 
+        // Tokenizing a copy, end_point may be shared with the interface model
+        end_point_copy = strdup(end_point);
+        if (end_point_copy == NULL) {
+            LOG_ERROR_0("strdup failed for end_point");
+            goto err;
+        }
+
         // Tokenzing the comma separated EndPoint w.r.t IPC to extract the socket directory and socket file
         // Eg: EndPoint: "/SocketDir, SocketFile"
-        for (i = 0, str = end_point; ; str = NULL, i++) {
+        for (i = 0, str = end_point_copy; ; str = NULL, i++) {
             data = strtok_r(str, ",", &ref_ptr);
             if (data == NULL) {
                 break;
@@ -315,6 +323,9 @@ bool get_ipc_config(config_t* c_json, config_value_t* config, const char* end_po
                 if (socket_file_obj_cvt_temp != NULL){
                     config_value_destroy(socket_file_obj_cvt_temp);
                 }
+                // The cJSON object now belongs to c_json, only the wrapper is ours
+                free(socket_file_obj);
+                socket_file_obj = NULL;
                 if (topics != NULL){
                     config_value_destroy(topics);
                 }
@@ -359,6 +370,9 @@ bool get_ipc_config(config_t* c_json, config_value_t* config, const char* end_po
                     LOG_ERROR_0("Unable to set config value");
                     goto err;
                 }
+                // The cJSON object now belongs to c_json, only the wrapper is ours
+                free(socket_file_obj);
+                socket_file_obj = NULL;
             }
         }
     } else {
@@ -411,6 +425,9 @@ err:
     if (socket_ep != NULL) {
         free_mem(socket_ep);
     }
+    if (end_point_copy != NULL) {
+        free(end_point_copy);
+    }
     if (sock_dir_cvt != NULL) {
         config_value_destroy(sock_dir_cvt);
     }
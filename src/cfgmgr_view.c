@@ -0,0 +1,211 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Borrowed view implementation of the ConfigManager
+ */
+
+#include <string.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include "eii/config_manager/cfgmgr_view.h"
+
+// What cfgmgr_get_topics() hands out for a single "*" topic
+static const char* const wildcard_topics[] = { "" };
+
+static cfgmgr_view_t view_of(const void* node) {
+    cfgmgr_view_t view = { node };
+    return view;
+}
+
+cfgmgr_view_t cfgmgr_view_app_config(cfgmgr_ctx_t* cfgmgr) {
+    if (cfgmgr == NULL) {
+        return view_of(NULL);
+    }
+    // Current config, kept as handed out
+    config_t* app_config = cfgmgr_get_app_config(cfgmgr);
+    if (app_config == NULL) {
+        return view_of(NULL);
+    }
+    return view_of(app_config->cfg);
+}
+
+cfgmgr_view_t cfgmgr_view_app_interface(cfgmgr_ctx_t* cfgmgr) {
+    if (cfgmgr == NULL) {
+        return view_of(NULL);
+    }
+    config_t* app_interface = cfgmgr_get_app_interface(cfgmgr);
+    if (app_interface == NULL) {
+        return view_of(NULL);
+    }
+    return view_of(app_interface->cfg);
+}
+
+cfgmgr_view_t cfgmgr_view_interface(cfgmgr_interface_t* ctx) {
+    if (ctx == NULL || ctx->model == NULL) {
+        return view_of(NULL);
+    }
+    return view_of(ctx->model->node);
+}
+
+cfgmgr_view_t cfgmgr_view_get(cfgmgr_view_t object, const char* key) {
+    const cJSON* node = (const cJSON*) object.node;
+    if (!cJSON_IsObject(node) || key == NULL) {
+        return view_of(NULL);
+    }
+    return view_of(cJSON_GetObjectItem(node, key));
+}
+
+cfgmgr_view_type_t cfgmgr_view_type(cfgmgr_view_t view) {
+    const cJSON* node = (const cJSON*) view.node;
+    if (node == NULL) {
+        return CFGMGR_VIEW_NONE;
+    }
+    if (cJSON_IsNull(node)) {
+        return CFGMGR_VIEW_NULL;
+    } else if (cJSON_IsBool(node)) {
+        return CFGMGR_VIEW_BOOLEAN;
+    } else if (cJSON_IsNumber(node)) {
+        // Same integer/floating split json_config makes
+        if (node->valuedouble == (double) node->valueint) {
+            return CFGMGR_VIEW_INTEGER;
+        }
+        return CFGMGR_VIEW_FLOATING;
+    } else if (cJSON_IsString(node)) {
+        return CFGMGR_VIEW_STRING;
+    } else if (cJSON_IsArray(node)) {
+        return CFGMGR_VIEW_ARRAY;
+    } else if (cJSON_IsObject(node)) {
+        return CFGMGR_VIEW_OBJECT;
+    }
+    return CFGMGR_VIEW_NONE;
+}
+
+bool cfgmgr_view_string(cfgmgr_view_t view, const char** str, size_t* len) {
+    const cJSON* node = (const cJSON*) view.node;
+    if (!cJSON_IsString(node) || node->valuestring == NULL) {
+        return false;
+    }
+    *str = node->valuestring;
+    if (len != NULL) {
+        *len = strlen(node->valuestring);
+    }
+    return true;
+}
+
+bool cfgmgr_view_integer(cfgmgr_view_t view, int64_t* value) {
+    if (cfgmgr_view_type(view) != CFGMGR_VIEW_INTEGER) {
+        return false;
+    }
+    *value = ((const cJSON*) view.node)->valueint;
+    return true;
+}
+
+bool cfgmgr_view_floating(cfgmgr_view_t view, double* value) {
+    const cJSON* node = (const cJSON*) view.node;
+    if (!cJSON_IsNumber(node)) {
+        return false;
+    }
+    *value = node->valuedouble;
+    return true;
+}
+
+bool cfgmgr_view_boolean(cfgmgr_view_t view, bool* value) {
+    const cJSON* node = (const cJSON*) view.node;
+    if (!cJSON_IsBool(node)) {
+        return false;
+    }
+    *value = cJSON_IsTrue(node);
+    return true;
+}
+
+size_t cfgmgr_view_len(cfgmgr_view_t view) {
+    const cJSON* node = (const cJSON*) view.node;
+    if (!cJSON_IsArray(node) && !cJSON_IsObject(node)) {
+        return 0;
+    }
+    return (size_t) cJSON_GetArraySize(node);
+}
+
+cfgmgr_view_iter_t cfgmgr_view_iter(cfgmgr_view_t view) {
+    const cJSON* node = (const cJSON*) view.node;
+    cfgmgr_view_iter_t iter = { NULL };
+    if (cJSON_IsArray(node) || cJSON_IsObject(node)) {
+        iter.next = node->child;
+    }
+    return iter;
+}
+
+bool cfgmgr_view_next(cfgmgr_view_iter_t* iter, cfgmgr_view_t* item, const char** key) {
+    const cJSON* node = (const cJSON*) iter->next;
+    if (node == NULL) {
+        return false;
+    }
+    item->node = node;
+    if (key != NULL) {
+        *key = node->string;
+    }
+    iter->next = node->next;
+    return true;
+}
+
+bool cfgmgr_view_topics(cfgmgr_interface_t* ctx, const char* const** topics, size_t* count) {
+    if (ctx->type == CFGMGR_SERVER || ctx->type == CFGMGR_CLIENT) {
+        LOG_ERROR_0("cfgmgr_view_topics not applicable for CFGMGR_SERVER/CFGMGR_CLIENT");
+        return false;
+    }
+    if (ctx->model == NULL) {
+        return false;
+    }
+    const cfgmgr_iface_strings_t* list = cfgmgr_iface_model_topics(ctx->model);
+    if (list == NULL || list->count == 0) {
+        return false;
+    }
+    if (list->wildcard) {
+        *topics = wildcard_topics;
+        *count = 1;
+    } else {
+        *topics = list->items;
+        *count = list->count;
+    }
+    return true;
+}
+
+bool cfgmgr_view_allowed_clients(cfgmgr_interface_t* ctx, const char* const** clients,
+                                 size_t* count) {
+    if (ctx->type == CFGMGR_SUBSCRIBER || ctx->type == CFGMGR_CLIENT) {
+        LOG_ERROR_0("cfgmgr_view_allowed_clients not applicable for CFGMGR_SUBSCRIBER/CFGMGR_CLIENT");
+        return false;
+    }
+    if (ctx->model == NULL || ctx->model->allowed_clients == NULL) {
+        return false;
+    }
+    *clients = ctx->model->allowed_clients->items;
+    *count = ctx->model->allowed_clients->count;
+    return true;
+}
+
+const char* cfgmgr_view_endpoint(cfgmgr_interface_t* ctx) {
+    if (ctx->model == NULL) {
+        return NULL;
+    }
+    return ctx->model->endpoint;
+}
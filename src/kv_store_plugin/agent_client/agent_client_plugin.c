@@ -0,0 +1,1040 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief cfgmgr-agent client implementation
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/json_config.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_protocol.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_client_plugin.h>
+#include <eii/config_manager/kv_store_plugin/etcd_client/etcd_client_plugin.h>
+#include <eii/config_manager/cfgmgr_json.h>
+
+#define SOCKET_PATH     "socket_path"
+#define ETCD_KV_STORE   "etcd_kv_store"
+
+/**
+ * Watch registered with the agent. Watches are freed with the client,
+ * events may still reference removed ones
+ */
+typedef struct agent_watch {
+    uint32_t id;
+    char* key;
+    bool prefix;
+    kv_store_watch_callback_t cb;
+    kv_store_watch_kv_callback_t kv_cb;
+    void* user_data;
+    bool removed;
+    // Keys last delivered, only used under dispatch_mtx
+    kv_table_t last;
+    struct agent_watch* next;
+} agent_watch_t;
+
+/**
+ * Change handed to the dispatcher: a put or delete, or after a reconnect
+ * the current keys of the watch
+ */
+typedef struct agent_event {
+    agent_watch_t* watch;
+    bool resync;
+    char* key;
+    char* value;
+    kv_table_t entries;
+    struct agent_event* next;
+} agent_event_t;
+
+typedef struct {
+    char* socket_path;
+
+    // Guards everything below but the dispatch and request locks
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    int fd;
+    // Incremented on every disconnect, fails the requests in flight
+    uint64_t conn_gen;
+    bool stop;
+    uint32_t next_id;
+
+    // One request in flight, its response is swapped into resp
+    pthread_mutex_t req_mtx;
+    uint32_t wait_id;
+    bool wait_done;
+    agent_frame_header_t resp_header;
+    agent_buf_t resp;
+
+    pthread_mutex_t write_mtx;
+
+    agent_watch_t* watches;
+    agent_event_t* events_head;
+    agent_event_t* events_tail;
+    pthread_cond_t events_cv;
+
+    // Recursive, held while callbacks run so that a watch delivers its
+    // current keys before any change
+    pthread_mutex_t dispatch_mtx;
+
+    pthread_t reader;
+    pthread_t dispatcher;
+    bool threads_started;
+
+    // Own client of the application for the requests an agent in prod
+    // mode denies, initialized on first use. NULL without etcd_kv_store
+    kv_store_client_t* inner;
+    void* inner_handle;
+    pthread_mutex_t inner_mtx;
+    // Set once the agent denied a request: unshared keys, writes and
+    // leases then go to the own client directly
+    atomic_bool restricted;
+} agent_client_t;
+
+static int agent_connect(const char* socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path) + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static uint32_t agent_next_id(agent_client_t* ctx) {
+    pthread_mutex_lock(&ctx->mtx);
+    uint32_t id = ++ctx->next_id;
+    pthread_mutex_unlock(&ctx->mtx);
+    return id;
+}
+
+static int agent_send(agent_client_t* ctx, int fd, uint8_t op, uint32_t id, const agent_buf_t* payload) {
+    pthread_mutex_lock(&ctx->write_mtx);
+    int rc = agent_send_frame(fd, op, AGENT_STATUS_OK, id, payload);
+    pthread_mutex_unlock(&ctx->write_mtx);
+    return rc;
+}
+
+/**
+ * Send a request and wait for its response
+ *
+ * @param ctx     - client
+ * @param op      - @c agent_op_t
+ * @param id      - id of the request, 0 to pick one
+ * @param payload - request payload
+ * @param resp    - filled with the response payload
+ * @param status  - filled with the @c agent_status_t of the response
+ * @return 0 once a response was received, -1 if the agent is unreachable
+ */
+static int agent_request(agent_client_t* ctx, uint8_t op, uint32_t id, const agent_buf_t* payload,
+                         agent_buf_t* resp, uint8_t* status) {
+    if (id == 0) {
+        id = agent_next_id(ctx);
+    }
+    pthread_mutex_lock(&ctx->req_mtx);
+    pthread_mutex_lock(&ctx->mtx);
+    int fd = ctx->fd;
+    uint64_t gen = ctx->conn_gen;
+    ctx->wait_id = id;
+    ctx->wait_done = false;
+    pthread_mutex_unlock(&ctx->mtx);
+
+    int ret = -1;
+    if (fd < 0) {
+        LOG_ERROR("Not connected to the agent at %s", ctx->socket_path);
+        goto err;
+    }
+    if (agent_send(ctx, fd, op, id, payload) != 0) {
+        LOG_ERROR("Failed to send a request to the agent: %s", strerror(errno));
+        goto err;
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    while (!ctx->wait_done && ctx->conn_gen == gen && !ctx->stop) {
+        pthread_cond_wait(&ctx->cv, &ctx->mtx);
+    }
+    if (ctx->wait_done) {
+        agent_buf_t tmp = *resp;
+        *resp = ctx->resp;
+        ctx->resp = tmp;
+        *status = ctx->resp_header.status;
+        ret = 0;
+    } else {
+        LOG_ERROR("Lost the connection to the agent at %s", ctx->socket_path);
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    if (ret == 0) {
+        kv_store_set_status((*status == AGENT_STATUS_OK) ? KV_STORE_OK :
+                            (*status == AGENT_STATUS_NOT_FOUND) ? KV_STORE_NOT_FOUND :
+                            (*status == AGENT_STATUS_PERMISSION_DENIED) ? KV_STORE_PERMISSION_DENIED :
+                            KV_STORE_ERROR);
+    }
+
+err:
+    if (ret != 0) {
+        kv_store_set_status(KV_STORE_UNAVAILABLE);
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    ctx->wait_id = 0;
+    pthread_mutex_unlock(&ctx->mtx);
+    pthread_mutex_unlock(&ctx->req_mtx);
+    return ret;
+}
+
+// Whether a request on a key, NULL for writes and leases, goes to the own
+// client instead of the agent
+static bool agent_direct(agent_client_t* ctx, const char* key) {
+    return ctx->inner != NULL && atomic_load(&ctx->restricted) &&
+           (key == NULL || !agent_key_shared(key));
+}
+
+// Whether the agent denied a request, which then goes to the own client
+static bool agent_denied(agent_client_t* ctx, uint8_t status) {
+    if (status != AGENT_STATUS_PERMISSION_DENIED || ctx->inner == NULL) {
+        return false;
+    }
+    if (!atomic_exchange(&ctx->restricted, true)) {
+        LOG_INFO("The agent at %s only serves shared keys, using the kv_store for the others",
+                 ctx->socket_path);
+    }
+    return true;
+}
+
+// Initializes the own client on first use
+static void* agent_inner(agent_client_t* ctx) {
+    pthread_mutex_lock(&ctx->inner_mtx);
+    if (ctx->inner_handle == NULL) {
+        LOG_DEBUG_0("Connecting to the kv_store, the agent does not serve the request");
+        ctx->inner_handle = ctx->inner->init(ctx->inner);
+        if (ctx->inner_handle == NULL) {
+            LOG_ERROR_0("Failed to initialize the kv_store_client of the application");
+            kv_store_set_status(KV_STORE_UNAVAILABLE);
+        }
+    }
+    void* inner_handle = ctx->inner_handle;
+    pthread_mutex_unlock(&ctx->inner_mtx);
+    return inner_handle;
+}
+
+// Reads the u32 count and key-value pairs of a response into entries
+static int agent_read_entries(agent_reader_t* reader, kv_table_t* entries) {
+    uint32_t count;
+    if (agent_read_u32(reader, &count) != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const char* key;
+        const char* value;
+        if (agent_read_str(reader, &key) != 0 || agent_read_str(reader, &value) != 0 ||
+                kv_table_apply(entries, key, value) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void agent_event_free(agent_event_t* event) {
+    free(event->key);
+    free(event->value);
+    kv_table_clear(&event->entries);
+    free(event);
+}
+
+// Queues a change for the dispatcher, called with ctx->mtx held
+static void agent_enqueue(agent_client_t* ctx, agent_event_t* event) {
+    if (ctx->events_tail == NULL) {
+        ctx->events_head = event;
+    } else {
+        ctx->events_tail->next = event;
+    }
+    ctx->events_tail = event;
+    pthread_cond_signal(&ctx->events_cv);
+}
+
+static agent_watch_t* agent_find_watch(agent_client_t* ctx, uint32_t id) {
+    for (agent_watch_t* watch = ctx->watches; watch != NULL; watch = watch->next) {
+        if (watch->id == id && !watch->removed) {
+            return watch;
+        }
+    }
+    return NULL;
+}
+
+// Handles an EVENT frame, or the WATCH response of a watch registered
+// again after a reconnect
+static void agent_handle_push(agent_client_t* ctx, agent_frame_header_t* header, agent_buf_t* in) {
+    agent_reader_t reader = {in->data, in->len, 0};
+    agent_event_t* event = (agent_event_t*) calloc(1, sizeof(agent_event_t));
+    if (event == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for an agent event");
+        return;
+    }
+    if (header->op == AGENT_OP_EVENT) {
+        uint8_t deleted;
+        const char* key;
+        const char* value;
+        if (agent_read_u8(&reader, &deleted) != 0 || agent_read_str(&reader, &key) != 0 ||
+                agent_read_str(&reader, &value) != 0) {
+            LOG_ERROR_0("Malformed event from the agent");
+            agent_event_free(event);
+            return;
+        }
+        event->key = strdup(key);
+        event->value = deleted ? NULL : strdup(value);
+        if (event->key == NULL || (!deleted && event->value == NULL)) {
+            LOG_ERROR_0("Failed to allocate memory for an agent event");
+            agent_event_free(event);
+            return;
+        }
+    } else {
+        if (header->status != AGENT_STATUS_OK) {
+            LOG_ERROR("Failed to watch again after reconnecting to the agent, watch %u is lost",
+                      header->id);
+            agent_event_free(event);
+            return;
+        }
+        event->resync = true;
+        if (agent_read_entries(&reader, &event->entries) != 0) {
+            LOG_ERROR_0("Malformed watch response from the agent");
+            agent_event_free(event);
+            return;
+        }
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    event->watch = agent_find_watch(ctx, header->id);
+    if (event->watch == NULL) {
+        pthread_mutex_unlock(&ctx->mtx);
+        agent_event_free(event);
+        return;
+    }
+    agent_enqueue(ctx, event);
+    pthread_mutex_unlock(&ctx->mtx);
+}
+
+// Connects again and registers the watches again, their current keys
+// come back as WATCH responses
+static int agent_reconnect(agent_client_t* ctx) {
+    int fd = agent_connect(ctx->socket_path);
+    if (fd < 0) {
+        return -1;
+    }
+    agent_buf_t payload = {NULL, 0, 0};
+    pthread_mutex_lock(&ctx->mtx);
+    if (ctx->stop) {
+        pthread_mutex_unlock(&ctx->mtx);
+        close(fd);
+        return -1;
+    }
+    ctx->fd = fd;
+    for (agent_watch_t* watch = ctx->watches; watch != NULL; watch = watch->next) {
+        if (watch->removed) {
+            continue;
+        }
+        agent_buf_reset(&payload);
+        if (agent_buf_put_u8(&payload, watch->prefix ? 1 : 0) != 0 ||
+                agent_buf_put_str(&payload, watch->key) != 0 ||
+                agent_send(ctx, fd, AGENT_OP_WATCH, watch->id, &payload) != 0) {
+            // The reader notices the broken connection
+            LOG_ERROR("Failed to watch %s again", watch->key);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    agent_buf_free(&payload);
+    LOG_INFO("Reconnected to the agent at %s", ctx->socket_path);
+    return 0;
+}
+
+static void* agent_reader_run(void* arg) {
+    agent_client_t* ctx = (agent_client_t*) arg;
+    agent_frame_header_t header;
+    agent_buf_t in = {NULL, 0, 0};
+
+    while (true) {
+        pthread_mutex_lock(&ctx->mtx);
+        if (ctx->stop) {
+            pthread_mutex_unlock(&ctx->mtx);
+            break;
+        }
+        int fd = ctx->fd;
+        if (fd < 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += AGENT_RECONNECT_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            while (!ctx->stop && pthread_cond_timedwait(&ctx->cv, &ctx->mtx, &deadline) == 0) {
+            }
+            pthread_mutex_unlock(&ctx->mtx);
+            agent_reconnect(ctx);
+            continue;
+        }
+        pthread_mutex_unlock(&ctx->mtx);
+
+        if (agent_recv_frame(fd, &header, &in) != 0) {
+            pthread_mutex_lock(&ctx->mtx);
+            if (!ctx->stop) {
+                LOG_WARN("Disconnected from the agent at %s, reconnecting", ctx->socket_path);
+            }
+            close(ctx->fd);
+            ctx->fd = -1;
+            ctx->conn_gen++;
+            pthread_cond_broadcast(&ctx->cv);
+            pthread_mutex_unlock(&ctx->mtx);
+            continue;
+        }
+
+        pthread_mutex_lock(&ctx->mtx);
+        if (header.op != AGENT_OP_EVENT && header.id == ctx->wait_id && !ctx->wait_done) {
+            agent_buf_t tmp = ctx->resp;
+            ctx->resp = in;
+            in = tmp;
+            ctx->resp_header = header;
+            ctx->wait_done = true;
+            pthread_cond_broadcast(&ctx->cv);
+            pthread_mutex_unlock(&ctx->mtx);
+            continue;
+        }
+        pthread_mutex_unlock(&ctx->mtx);
+        if (header.op == AGENT_OP_EVENT || header.op == AGENT_OP_WATCH) {
+            agent_handle_push(ctx, &header, &in);
+        }
+    }
+    agent_buf_free(&in);
+    return NULL;
+}
+
+// Hands a put or delete to a watch callback
+static void agent_notify(const char* key, const char* value, void* user_data) {
+    agent_watch_t* watch = (agent_watch_t*) user_data;
+    if (watch->kv_cb != NULL) {
+        watch->kv_cb(key, value, watch->user_data);
+        return;
+    }
+    if (value == NULL) {
+        // Like the kv_store, watch callbacks only get puts
+        return;
+    }
+    cJSON* val_json;
+    if (value[0] != '{') {
+        if (strlen(value) == 0) {
+            LOG_ERROR_0("Value shouldn't be empty. Empty string is not supported");
+            return;
+        }
+        val_json = cJSON_CreateObject();
+        if (val_json == NULL) {
+            LOG_ERROR_0("Create json object failed");
+            return;
+        }
+        cJSON_AddStringToObject(val_json, key, value);
+    } else {
+        val_json = cfgmgr_json_parse(value, strlen(value));
+        if (val_json == NULL) {
+            LOG_ERROR_0("cJSON Parse failed");
+            return;
+        }
+    }
+    config_t* config = config_new((void*) val_json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(val_json);
+        return;
+    }
+    watch->cb(key, config, watch->user_data);
+}
+
+// Notifies a watch of the differences between its last keys and the keys
+// read after a reconnect, which become its last keys
+static void agent_resync(agent_watch_t* watch, kv_table_t* current) {
+    kv_table_diff(&watch->last, current, agent_notify, watch);
+    kv_table_move(&watch->last, current);
+}
+
+static void* agent_dispatcher_run(void* arg) {
+    agent_client_t* ctx = (agent_client_t*) arg;
+    while (true) {
+        pthread_mutex_lock(&ctx->mtx);
+        while (ctx->events_head == NULL && !ctx->stop) {
+            pthread_cond_wait(&ctx->events_cv, &ctx->mtx);
+        }
+        if (ctx->stop) {
+            pthread_mutex_unlock(&ctx->mtx);
+            break;
+        }
+        agent_event_t* event = ctx->events_head;
+        ctx->events_head = event->next;
+        if (ctx->events_head == NULL) {
+            ctx->events_tail = NULL;
+        }
+        pthread_mutex_unlock(&ctx->mtx);
+
+        pthread_mutex_lock(&ctx->dispatch_mtx);
+        agent_watch_t* watch = event->watch;
+        if (!watch->removed) {
+            if (event->resync) {
+                agent_resync(watch, &event->entries);
+            } else if (kv_table_apply(&watch->last, event->key, event->value) != 0) {
+                agent_notify(event->key, event->value, watch);
+            }
+        }
+        pthread_mutex_unlock(&ctx->dispatch_mtx);
+        agent_event_free(event);
+    }
+    return NULL;
+}
+
+static void* agent_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    agent_client_t* ctx = (agent_client_t*) client->handler;
+
+    ctx->fd = agent_connect(ctx->socket_path);
+    if (ctx->fd < 0) {
+        LOG_ERROR("Failed to connect to the agent at %s: %s", ctx->socket_path, strerror(errno));
+        return NULL;
+    }
+    if (pthread_create(&ctx->reader, NULL, agent_reader_run, ctx) != 0) {
+        LOG_ERROR_0("Failed to start the agent reader");
+        return NULL;
+    }
+    if (pthread_create(&ctx->dispatcher, NULL, agent_dispatcher_run, ctx) != 0) {
+        LOG_ERROR_0("Failed to start the agent dispatcher");
+        pthread_mutex_lock(&ctx->mtx);
+        ctx->stop = true;
+        shutdown(ctx->fd, SHUT_RDWR);
+        pthread_mutex_unlock(&ctx->mtx);
+        pthread_join(ctx->reader, NULL);
+        return NULL;
+    }
+    ctx->threads_started = true;
+    LOG_DEBUG("Connected to the agent at %s", ctx->socket_path);
+    return ctx;
+}
+
+// Reads a key from the agent, @p denied is set if it does not serve it
+static char* agent_get_served(agent_client_t* ctx, char* key, bool* denied) {
+    agent_buf_t req = {NULL, 0, 0};
+    agent_buf_t resp = {NULL, 0, 0};
+    char* value = NULL;
+    uint8_t status;
+
+    if (agent_buf_put_str(&req, key) != 0 ||
+            agent_request(ctx, AGENT_OP_GET, 0, &req, &resp, &status) != 0) {
+        goto err;
+    }
+    if (agent_denied(ctx, status)) {
+        *denied = true;
+        goto err;
+    }
+    if (status == AGENT_STATUS_NOT_FOUND) {
+        LOG_DEBUG("Value is not found for the key %s", key);
+        goto err;
+    }
+    const char* found;
+    agent_reader_t reader = {resp.data, resp.len, 0};
+    if (status != AGENT_STATUS_OK || agent_read_str(&reader, &found) != 0) {
+        LOG_ERROR("Agent failed to read %s", key);
+        goto err;
+    }
+    value = strdup(found);
+    if (value == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for the value");
+    }
+
+err:
+    agent_buf_free(&req);
+    agent_buf_free(&resp);
+    return value;
+}
+
+static char* agent_get(void* handle, char* key) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    bool denied = agent_direct(ctx, key);
+    char* value = denied ? NULL : agent_get_served(ctx, key, &denied);
+    if (denied) {
+        void* inner_handle = agent_inner(ctx);
+        value = (inner_handle != NULL) ? ctx->inner->get(inner_handle, key) : NULL;
+    }
+    return value;
+}
+
+// Reads a prefix from the agent, @p denied is set if it does not serve it
+static config_value_t* agent_get_prefix_served(agent_client_t* ctx, char* key, bool* denied) {
+    agent_buf_t req = {NULL, 0, 0};
+    agent_buf_t resp = {NULL, 0, 0};
+    config_value_t* values = NULL;
+    kv_table_t found = {NULL, 0, 0};
+    uint8_t status;
+    uint32_t count;
+
+    if (agent_buf_put_str(&req, key) != 0 ||
+            agent_request(ctx, AGENT_OP_GET_PREFIX, 0, &req, &resp, &status) != 0) {
+        goto err;
+    }
+    if (agent_denied(ctx, status)) {
+        *denied = true;
+        goto err;
+    }
+    agent_reader_t reader = {resp.data, resp.len, 0};
+    if (status != AGENT_STATUS_OK || agent_read_u32(&reader, &count) != 0) {
+        LOG_ERROR("Agent failed to read the prefix %s", key);
+        goto err;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const char* found_key;
+        const char* found_value;
+        if (agent_read_str(&reader, &found_key) != 0 || agent_read_str(&reader, &found_value) != 0) {
+            LOG_ERROR_0("Malformed prefix response from the agent");
+            goto err;
+        }
+        char* copy_key = strdup(found_key);
+        char* copy_value = strdup(found_value);
+        if (copy_key == NULL || copy_value == NULL ||
+                kv_table_insert(&found, found.count, copy_key, copy_value) != 0) {
+            LOG_ERROR_0("Failed to copy prefix value");
+            free(copy_key);
+            free(copy_value);
+            goto err;
+        }
+    }
+    kv_table_sort(&found);
+    values = kv_table_to_prefix_value(&found, key);
+
+err:
+    kv_table_clear(&found);
+    agent_buf_free(&req);
+    agent_buf_free(&resp);
+    return values;
+}
+
+static config_value_t* agent_get_prefix(void* handle, char* key) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    bool denied = agent_direct(ctx, key);
+    config_value_t* values = denied ? NULL : agent_get_prefix_served(ctx, key, &denied);
+    if (denied) {
+        void* inner_handle = agent_inner(ctx);
+        values = (inner_handle != NULL) ? ctx->inner->get_prefix(inner_handle, key) : NULL;
+    }
+    return values;
+}
+
+// Sends a request answered with a status only. Returns 1 if the agent
+// denied it, to be sent with the own client
+static int agent_status_request(agent_client_t* ctx, uint8_t op, agent_buf_t* req, const char* what) {
+    agent_buf_t resp = {NULL, 0, 0};
+    uint8_t status;
+    int ret = -1;
+    if (agent_request(ctx, op, 0, req, &resp, &status) == 0) {
+        if (status == AGENT_STATUS_OK) {
+            ret = 0;
+        } else if (agent_denied(ctx, status)) {
+            ret = 1;
+        } else {
+            LOG_ERROR("Agent failed to %s", what);
+        }
+    }
+    agent_buf_free(&resp);
+    agent_buf_free(req);
+    return ret;
+}
+
+static int agent_put(void* handle, char* key, char* value) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    agent_buf_t req = {NULL, 0, 0};
+    int ret = 1;
+    if (!agent_direct(ctx, NULL)) {
+        if (agent_buf_put_str(&req, key) != 0 || agent_buf_put_str(&req, value) != 0) {
+            agent_buf_free(&req);
+            return -1;
+        }
+        ret = agent_status_request(ctx, AGENT_OP_PUT, &req, "write a key");
+    }
+    if (ret == 1) {
+        void* inner_handle = agent_inner(ctx);
+        ret = (inner_handle != NULL) ? ctx->inner->put(inner_handle, key, value) : -1;
+    }
+    return ret;
+}
+
+// Grants a lease through the agent. Returns 1 if the agent denied it
+static int agent_grant_lease_served(agent_client_t* ctx, int64_t ttl, int64_t* lease_id) {
+    agent_buf_t req = {NULL, 0, 0};
+    agent_buf_t resp = {NULL, 0, 0};
+    uint8_t status;
+    int ret = -1;
+
+    if (agent_buf_put_i64(&req, ttl) != 0 ||
+            agent_request(ctx, AGENT_OP_GRANT_LEASE, 0, &req, &resp, &status) != 0) {
+        goto err;
+    }
+    if (agent_denied(ctx, status)) {
+        ret = 1;
+        goto err;
+    }
+    agent_reader_t reader = {resp.data, resp.len, 0};
+    if (status != AGENT_STATUS_OK || agent_read_i64(&reader, lease_id) != 0) {
+        LOG_ERROR_0("Agent failed to grant a lease");
+        goto err;
+    }
+    ret = 0;
+
+err:
+    agent_buf_free(&req);
+    agent_buf_free(&resp);
+    return ret;
+}
+
+static int agent_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    int ret = agent_direct(ctx, NULL) ? 1 : agent_grant_lease_served(ctx, ttl, lease_id);
+    if (ret == 1) {
+        void* inner_handle = agent_inner(ctx);
+        ret = (inner_handle != NULL) ? ctx->inner->grant_lease(inner_handle, ttl, lease_id) : -1;
+    }
+    return ret;
+}
+
+static int agent_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    agent_buf_t req = {NULL, 0, 0};
+    int ret = 1;
+    if (!agent_direct(ctx, NULL)) {
+        if (agent_buf_put_str(&req, key) != 0 || agent_buf_put_str(&req, value) != 0 ||
+                agent_buf_put_i64(&req, lease_id) != 0) {
+            agent_buf_free(&req);
+            return -1;
+        }
+        ret = agent_status_request(ctx, AGENT_OP_PUT_WITH_LEASE, &req, "write a key with a lease");
+    }
+    if (ret == 1) {
+        void* inner_handle = agent_inner(ctx);
+        ret = (inner_handle != NULL)
+              ? ctx->inner->put_with_lease(inner_handle, key, value, lease_id) : -1;
+    }
+    return ret;
+}
+
+static int agent_keepalive(void* handle, int64_t lease_id) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    agent_buf_t req = {NULL, 0, 0};
+    int ret = 1;
+    if (!agent_direct(ctx, NULL)) {
+        if (agent_buf_put_i64(&req, lease_id) != 0) {
+            agent_buf_free(&req);
+            return -1;
+        }
+        ret = agent_status_request(ctx, AGENT_OP_KEEPALIVE, &req, "keep a lease alive");
+    }
+    if (ret == 1) {
+        void* inner_handle = agent_inner(ctx);
+        ret = (inner_handle != NULL) ? ctx->inner->keepalive(inner_handle, lease_id) : -1;
+    }
+    return ret;
+}
+
+static int agent_revoke_lease(void* handle, int64_t lease_id) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    agent_buf_t req = {NULL, 0, 0};
+    int ret = 1;
+    if (!agent_direct(ctx, NULL)) {
+        if (agent_buf_put_i64(&req, lease_id) != 0) {
+            agent_buf_free(&req);
+            return -1;
+        }
+        ret = agent_status_request(ctx, AGENT_OP_REVOKE_LEASE, &req, "revoke a lease");
+    }
+    if (ret == 1) {
+        void* inner_handle = agent_inner(ctx);
+        ret = (inner_handle != NULL) ? ctx->inner->revoke_lease(inner_handle, lease_id) : -1;
+    }
+    return ret;
+}
+
+// Registers a watch, kv watches get the current keys before it returns.
+// Returns 1 if the agent denied it, to be registered with the own client
+static int agent_watch_add(agent_client_t* ctx, const char* key, bool prefix,
+                           kv_store_watch_callback_t cb, kv_store_watch_kv_callback_t kv_cb,
+                           void* user_data) {
+    agent_buf_t req = {NULL, 0, 0};
+    agent_buf_t resp = {NULL, 0, 0};
+    uint8_t status;
+    int ret = -1;
+
+    agent_watch_t* watch = (agent_watch_t*) calloc(1, sizeof(agent_watch_t));
+    if (watch == NULL || (watch->key = strdup(key)) == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for the watch");
+        free(watch);
+        return -1;
+    }
+    watch->id = agent_next_id(ctx);
+    watch->prefix = prefix;
+    watch->cb = cb;
+    watch->kv_cb = kv_cb;
+    watch->user_data = user_data;
+
+    // Changes received before the current keys are delivered wait for
+    // the dispatch lock
+    pthread_mutex_lock(&ctx->dispatch_mtx);
+    pthread_mutex_lock(&ctx->mtx);
+    watch->next = ctx->watches;
+    ctx->watches = watch;
+    pthread_mutex_unlock(&ctx->mtx);
+
+    if (agent_buf_put_u8(&req, prefix ? 1 : 0) != 0 || agent_buf_put_str(&req, key) != 0 ||
+            agent_request(ctx, AGENT_OP_WATCH, watch->id, &req, &resp, &status) != 0) {
+        goto err;
+    }
+    if (agent_denied(ctx, status)) {
+        ret = 1;
+        goto err;
+    }
+    agent_reader_t reader = {resp.data, resp.len, 0};
+    if (status != AGENT_STATUS_OK || agent_read_entries(&reader, &watch->last) != 0) {
+        LOG_ERROR("Agent failed to watch %s", key);
+        goto err;
+    }
+    if (kv_cb != NULL) {
+        for (size_t i = 0; i < watch->last.count; i++) {
+            kv_cb(watch->last.items[i].key, watch->last.items[i].value, user_data);
+        }
+    }
+    ret = 0;
+
+err:
+    if (ret != 0) {
+        pthread_mutex_lock(&ctx->mtx);
+        watch->removed = true;
+        pthread_mutex_unlock(&ctx->mtx);
+        kv_table_clear(&watch->last);
+    }
+    pthread_mutex_unlock(&ctx->dispatch_mtx);
+    agent_buf_free(&req);
+    agent_buf_free(&resp);
+    return ret;
+}
+
+static void agent_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    if (agent_direct(ctx, key) || agent_watch_add(ctx, key, false, cb, NULL, user_data) == 1) {
+        void* inner_handle = agent_inner(ctx);
+        if (inner_handle != NULL) {
+            ctx->inner->watch(inner_handle, key, cb, user_data);
+        }
+    }
+}
+
+static void agent_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    if (agent_direct(ctx, key) || agent_watch_add(ctx, key, true, cb, NULL, user_data) == 1) {
+        void* inner_handle = agent_inner(ctx);
+        if (inner_handle != NULL) {
+            ctx->inner->watch_prefix(inner_handle, key, cb, user_data);
+        }
+    }
+}
+
+static int agent_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                 void* user_data) {
+    agent_client_t* ctx = (agent_client_t*) handle;
+    int ret = agent_direct(ctx, key) ? 1 : agent_watch_add(ctx, key, true, NULL, cb, user_data);
+    if (ret == 1) {
+        void* inner_handle = agent_inner(ctx);
+        ret = (inner_handle != NULL) ? ctx->inner->watch_prefix_kv(inner_handle, key, cb, user_data) : -1;
+    }
+    return ret;
+}
+
+static void agent_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    agent_client_t* ctx = (agent_client_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    ctx->stop = true;
+    if (ctx->fd >= 0) {
+        shutdown(ctx->fd, SHUT_RDWR);
+    }
+    pthread_cond_broadcast(&ctx->cv);
+    pthread_cond_broadcast(&ctx->events_cv);
+    pthread_mutex_unlock(&ctx->mtx);
+    if (ctx->threads_started) {
+        pthread_join(ctx->reader, NULL);
+        pthread_join(ctx->dispatcher, NULL);
+    }
+    if (ctx->fd >= 0) {
+        close(ctx->fd);
+    }
+    // Joins the watch threads of the own client
+    if (ctx->inner != NULL) {
+        kv_client_free(ctx->inner);
+    }
+    agent_event_t* event = ctx->events_head;
+    while (event != NULL) {
+        agent_event_t* next = event->next;
+        agent_event_free(event);
+        event = next;
+    }
+    agent_watch_t* watch = ctx->watches;
+    while (watch != NULL) {
+        agent_watch_t* next = watch->next;
+        kv_table_clear(&watch->last);
+        free(watch->key);
+        free(watch);
+        watch = next;
+    }
+    agent_buf_free(&ctx->resp);
+    free(ctx->socket_path);
+    pthread_mutex_destroy(&ctx->mtx);
+    pthread_mutex_destroy(&ctx->req_mtx);
+    pthread_mutex_destroy(&ctx->write_mtx);
+    pthread_mutex_destroy(&ctx->dispatch_mtx);
+    pthread_mutex_destroy(&ctx->inner_mtx);
+    pthread_cond_destroy(&ctx->cv);
+    pthread_cond_destroy(&ctx->events_cv);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+// Socket path from the config, CONFIGMGR_AGENT_SOCKET or the default
+static char* agent_socket_path(config_t* config) {
+    char* socket_path = NULL;
+    config_value_t* conf_obj = config->get_config_value(config->cfg, AGENT_KV_STORE);
+    if (conf_obj != NULL) {
+        if (conf_obj->type == CVT_OBJECT) {
+            config_value_t* path = config_value_object_get(conf_obj, SOCKET_PATH);
+            if (path != NULL) {
+                if (path->type == CVT_STRING) {
+                    socket_path = strdup(path->body.string);
+                } else {
+                    LOG_ERROR("'%s' must be a string", SOCKET_PATH);
+                }
+                config_value_destroy(path);
+            }
+        } else {
+            LOG_ERROR("Configuration for '%s' must be an object", AGENT_KV_STORE);
+        }
+        config_value_destroy(conf_obj);
+        if (socket_path != NULL) {
+            return socket_path;
+        }
+    }
+    const char* env = getenv("CONFIGMGR_AGENT_SOCKET");
+    return strdup((env != NULL && env[0] != '\0') ? env : AGENT_DEFAULT_SOCKET);
+}
+
+// Own etcd client of the application from its etcd_kv_store config, for
+// the requests the agent denies. Sets @p inner to NULL without one
+static int agent_inner_client(config_t* config, kv_store_client_t** inner) {
+    *inner = NULL;
+    config_value_t* conf_obj = config->get_config_value(config->cfg, ETCD_KV_STORE);
+    if (conf_obj == NULL) {
+        LOG_DEBUG("No '%s' configured, the agent must serve every request", ETCD_KV_STORE);
+        return 0;
+    }
+    config_value_destroy(conf_obj);
+    *inner = create_etcd_client(config);
+    if (*inner == NULL) {
+        LOG_ERROR_0("Failed to create the kv_store_client of the application");
+        return -1;
+    }
+    return 0;
+}
+
+kv_store_client_t* create_agent_client(config_t* config) {
+    kv_store_client_t* client = NULL;
+    agent_client_t* ctx = NULL;
+    pthread_mutexattr_t attr;
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (agent_client_t*) calloc(1, sizeof(agent_client_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Agent client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx->fd = -1;
+    ctx->socket_path = agent_socket_path(config);
+    if (ctx->socket_path == NULL) {
+        LOG_ERROR_0("Failed to copy the agent socket path");
+        goto err;
+    }
+    if (ctx->socket_path[0] == '\0' ||
+            strlen(ctx->socket_path) >= sizeof(((struct sockaddr_un*) NULL)->sun_path)) {
+        LOG_ERROR("Invalid agent socket path %s", ctx->socket_path);
+        goto err;
+    }
+    if (agent_inner_client(config, &ctx->inner) != 0) {
+        goto err;
+    }
+    atomic_init(&ctx->restricted, false);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->dispatch_mtx, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&ctx->mtx, NULL);
+    pthread_mutex_init(&ctx->req_mtx, NULL);
+    pthread_mutex_init(&ctx->write_mtx, NULL);
+    pthread_mutex_init(&ctx->inner_mtx, NULL);
+    pthread_cond_init(&ctx->cv, NULL);
+    pthread_cond_init(&ctx->events_cv, NULL);
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = agent_init;
+    client->get = agent_get;
+    client->get_prefix = agent_get_prefix;
+    client->get_prefix_kv = NULL;
+    // Reads are answered from the memory of the agent, kv_store_batch
+    // reads key by key
+    client->get_batch = NULL;
+    client->put = agent_put;
+    client->watch = agent_watch;
+    client->watch_prefix = agent_watch_prefix;
+    client->watch_prefix_kv = agent_watch_prefix_kv;
+    client->grant_lease = agent_grant_lease;
+    client->put_with_lease = agent_put_with_lease;
+    client->keepalive = agent_keepalive;
+    client->revoke_lease = agent_revoke_lease;
+    client->deinit = agent_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        free(ctx->socket_path);
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
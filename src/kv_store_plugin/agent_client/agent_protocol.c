@@ -0,0 +1,205 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Wire protocol between the cfgmgr-agent and its clients
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_protocol.h>
+
+static int agent_buf_reserve(agent_buf_t* buf, size_t extra) {
+    if (buf->len + extra <= buf->cap) {
+        return 0;
+    }
+    size_t cap = (buf->cap == 0) ? 256 : buf->cap;
+    while (cap < buf->len + extra) {
+        cap *= 2;
+    }
+    uint8_t* data = (uint8_t*) realloc(buf->data, cap);
+    if (data == NULL) {
+        return -1;
+    }
+    buf->data = data;
+    buf->cap = cap;
+    return 0;
+}
+
+static int agent_buf_put(agent_buf_t* buf, const void* data, size_t len) {
+    if (agent_buf_reserve(buf, len) != 0) {
+        return -1;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+int agent_buf_put_u8(agent_buf_t* buf, uint8_t value) {
+    return agent_buf_put(buf, &value, sizeof(value));
+}
+
+int agent_buf_put_u32(agent_buf_t* buf, uint32_t value) {
+    return agent_buf_put(buf, &value, sizeof(value));
+}
+
+int agent_buf_put_i64(agent_buf_t* buf, int64_t value) {
+    return agent_buf_put(buf, &value, sizeof(value));
+}
+
+int agent_buf_put_str(agent_buf_t* buf, const char* str) {
+    size_t len = strlen(str);
+    if (len > AGENT_MAX_PAYLOAD) {
+        return -1;
+    }
+    if (agent_buf_put_u32(buf, (uint32_t) len) != 0) {
+        return -1;
+    }
+    // Terminator included so that readers use strings in place
+    return agent_buf_put(buf, str, len + 1);
+}
+
+void agent_buf_reset(agent_buf_t* buf) {
+    buf->len = 0;
+}
+
+void agent_buf_free(agent_buf_t* buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+static int agent_read(agent_reader_t* reader, void* out, size_t len) {
+    if (reader->len - reader->pos < len) {
+        return -1;
+    }
+    memcpy(out, reader->data + reader->pos, len);
+    reader->pos += len;
+    return 0;
+}
+
+int agent_read_u8(agent_reader_t* reader, uint8_t* value) {
+    return agent_read(reader, value, sizeof(*value));
+}
+
+int agent_read_u32(agent_reader_t* reader, uint32_t* value) {
+    return agent_read(reader, value, sizeof(*value));
+}
+
+int agent_read_i64(agent_reader_t* reader, int64_t* value) {
+    return agent_read(reader, value, sizeof(*value));
+}
+
+int agent_read_str(agent_reader_t* reader, const char** str) {
+    uint32_t len;
+    if (agent_read_u32(reader, &len) != 0) {
+        return -1;
+    }
+    if (reader->len - reader->pos < (size_t) len + 1 || reader->data[reader->pos + len] != '\0') {
+        return -1;
+    }
+    *str = (const char*) reader->data + reader->pos;
+    reader->pos += (size_t) len + 1;
+    return 0;
+}
+
+static int agent_send_all(int fd, const void* data, size_t len) {
+    const uint8_t* pos = (const uint8_t*) data;
+    while (len > 0) {
+        // MSG_NOSIGNAL: a peer gone is an error, not a SIGPIPE
+        ssize_t sent = send(fd, pos, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        pos += sent;
+        len -= (size_t) sent;
+    }
+    return 0;
+}
+
+static int agent_recv_all(int fd, void* data, size_t len) {
+    uint8_t* pos = (uint8_t*) data;
+    while (len > 0) {
+        ssize_t got = recv(fd, pos, len, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return -1;
+        }
+        pos += got;
+        len -= (size_t) got;
+    }
+    return 0;
+}
+
+bool agent_key_shared(const char* key) {
+    static const char* const shared[] = {"/GlobalEnv/", "/Publickeys/"};
+    for (size_t i = 0; i < sizeof(shared) / sizeof(shared[0]); i++) {
+        if (strncmp(key, shared[i], strlen(shared[i])) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int agent_send_frame(int fd, uint8_t op, uint8_t status, uint32_t id, const agent_buf_t* payload) {
+    agent_frame_header_t header;
+    header.length = (payload != NULL) ? (uint32_t) payload->len : 0;
+    header.op = op;
+    header.status = status;
+    header.reserved = 0;
+    header.id = id;
+    if (header.length > AGENT_MAX_PAYLOAD) {
+        return -1;
+    }
+    if (agent_send_all(fd, &header, sizeof(header)) != 0) {
+        return -1;
+    }
+    if (header.length > 0 && agent_send_all(fd, payload->data, payload->len) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int agent_recv_frame(int fd, agent_frame_header_t* header, agent_buf_t* payload) {
+    if (agent_recv_all(fd, header, sizeof(*header)) != 0) {
+        return -1;
+    }
+    if (header->length > AGENT_MAX_PAYLOAD) {
+        return -1;
+    }
+    agent_buf_reset(payload);
+    if (agent_buf_reserve(payload, header->length) != 0) {
+        return -1;
+    }
+    if (agent_recv_all(fd, payload->data, header->length) != 0) {
+        return -1;
+    }
+    payload->len = header->length;
+    return 0;
+}
@@ -0,0 +1,830 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief Server side of the cfgmgr-agent implementation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <cjson/cJSON.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_protocol.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_server.h>
+
+typedef enum {
+    // Not watched, or the last attempt failed
+    AGENT_ROOT_EMPTY,
+    // watch_prefix_kv() is delivering the current keys, or the keys of a
+    // dormant root are read again
+    AGENT_ROOT_LOADING,
+    AGENT_ROOT_READY,
+    // Evicted: watched, but its keys are dropped and its events ignored
+    AGENT_ROOT_DORMANT,
+} agent_root_state_t;
+
+typedef struct agent_conn agent_conn_t;
+
+/**
+ * Watch of a client on a key or prefix of a root
+ */
+typedef struct agent_sub {
+    agent_conn_t* conn;
+    uint32_t id;
+    char* key;
+    bool prefix;
+    struct agent_sub* next;
+} agent_sub_t;
+
+/**
+ * Top-level prefix mirrored from the kv_store through a single watch, which
+ * serves every read and watch below it. Roots live until the server stops,
+ * the watches of the kv_store client referencing them
+ */
+typedef struct agent_root {
+    char* key;
+    agent_root_state_t state;
+    // Set once watch_prefix_kv() succeeded
+    bool watched;
+    kv_table_t entries;
+    // While a dormant root is read again: changes delivered meanwhile,
+    // NULL values for deletes, and whether a resync replaced the read
+    bool reloading;
+    kv_table_t pending;
+    bool pending_complete;
+    // Keys delivered by a resync of the kv_store
+    bool resyncing;
+    kv_table_t resync;
+    uint64_t last_used_ns;
+    agent_sub_t* subs;
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    // Set once the root is listed, never changed after
+    struct agent_root* next;
+} agent_root_t;
+
+struct agent_conn {
+    int fd;
+    // Serializes the responses of the connection thread with the events
+    // of the kv_store watch threads
+    pthread_mutex_t write_mtx;
+    agent_server_t* server;
+    struct agent_conn* next;
+};
+
+struct agent_server {
+    kv_store_client_t* client;
+    void* handle;
+    // Otherwise only shared keys are served, see agent_key_shared()
+    bool dev_mode;
+    char* socket_path;
+    int listen_fd;
+    pthread_t acceptor;
+    bool acceptor_started;
+
+    // Guards the list head, count and eviction time, roots are prepended
+    pthread_mutex_t roots_mtx;
+    agent_root_t* roots;
+    size_t root_count;
+    uint64_t evict_at_ns;
+
+    pthread_mutex_t conns_mtx;
+    pthread_cond_t conns_cv;
+    agent_conn_t* conns;
+    bool stopping;
+};
+
+static uint64_t agent_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// Sends a frame, a client not reading its socket is disconnected
+static void agent_conn_send(agent_conn_t* conn, uint8_t op, uint8_t status, uint32_t id,
+                            const agent_buf_t* payload) {
+    pthread_mutex_lock(&conn->write_mtx);
+    int rc = agent_send_frame(conn->fd, op, status, id, payload);
+    pthread_mutex_unlock(&conn->write_mtx);
+    if (rc != 0) {
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+}
+
+// Length of the root of a key: up to its second '/', e.g. "/<AppName>/",
+// or the whole key if it has none. The root always covers the key
+static size_t agent_root_len(const char* key) {
+    const char* slash = (key[0] != '\0') ? strchr(key + 1, '/') : NULL;
+    return (slash != NULL) ? (size_t) (slash - key) + 1 : strlen(key);
+}
+
+static bool agent_sub_matches(const agent_sub_t* sub, const char* key) {
+    if (sub->prefix) {
+        return strncmp(key, sub->key, strlen(sub->key)) == 0;
+    }
+    return strcmp(key, sub->key) == 0;
+}
+
+// Sends a put or delete to the watches of a locked root matching the key
+static void agent_root_notify(const char* key, const char* value, void* user_data) {
+    agent_root_t* root = (agent_root_t*) user_data;
+    agent_buf_t event = {NULL, 0, 0};
+    for (agent_sub_t* sub = root->subs; sub != NULL; sub = sub->next) {
+        if (!agent_sub_matches(sub, key)) {
+            continue;
+        }
+        if (event.len == 0 &&
+                (agent_buf_put_u8(&event, (value == NULL) ? 1 : 0) != 0 ||
+                 agent_buf_put_str(&event, key) != 0 ||
+                 agent_buf_put_str(&event, (value == NULL) ? "" : value) != 0)) {
+            LOG_ERROR("Failed to allocate the event of %s", key);
+            break;
+        }
+        agent_conn_send(sub->conn, AGENT_OP_EVENT, AGENT_STATUS_OK, sub->id, &event);
+    }
+    agent_buf_free(&event);
+}
+
+// Resync of the kv_store, keys it does not deliver again were deleted.
+// Called with the lock of the root held
+static void agent_root_resync(agent_root_t* root, const char* key, const char* value) {
+    if (key != NULL) {
+        if (kv_table_apply(&root->resync, key, value) < 0) {
+            LOG_ERROR("Failed to cache %s, reads of it are stale", key);
+        }
+        return;
+    }
+    if (value != NULL) {
+        kv_table_clear(&root->resync);
+        root->resyncing = true;
+        return;
+    }
+    root->resyncing = false;
+    if (root->reloading) {
+        // Newer than anything pending, the read in progress is dropped
+        kv_table_move(&root->pending, &root->resync);
+        root->pending_complete = true;
+    } else if (root->state == AGENT_ROOT_READY || root->state == AGENT_ROOT_LOADING) {
+        kv_table_diff(&root->entries, &root->resync, agent_root_notify, root);
+        kv_table_move(&root->entries, &root->resync);
+    }
+    kv_table_clear(&root->resync);
+}
+
+// Mirror callback: keeps the entries of a root and notifies its watches
+static void agent_root_cb(const char* key, const char* value, void* cb_user_data) {
+    agent_root_t* root = (agent_root_t*) cb_user_data;
+    pthread_mutex_lock(&root->mtx);
+    if (key == NULL || root->resyncing) {
+        agent_root_resync(root, key, value);
+    } else if (root->reloading) {
+        if (kv_table_set(&root->pending, key, value) < 0) {
+            LOG_ERROR("Failed to cache %s, reads of it are stale", key);
+        }
+    } else if (root->state == AGENT_ROOT_READY || root->state == AGENT_ROOT_LOADING) {
+        int changed = kv_table_apply(&root->entries, key, value);
+        if (changed < 0) {
+            LOG_ERROR("Failed to cache %s, reads of it are stale", key);
+        } else if (changed > 0) {
+            agent_root_notify(key, value, root);
+        }
+    }
+    pthread_mutex_unlock(&root->mtx);
+}
+
+static int agent_root_collect(const char* key, const char* value, void* cb_user_data) {
+    return (kv_table_set((kv_table_t*) cb_user_data, key, value) < 0) ? -1 : 0;
+}
+
+// Reads the keys of a dormant root again. Changes delivered by its watch
+// meanwhile are applied on top, in the order they came: they may predate
+// the read, but then every later change follows them on the watch
+static void agent_root_reload(agent_server_t* server, agent_root_t* root) {
+    kv_table_t loaded = {NULL, 0, 0};
+    root->state = AGENT_ROOT_LOADING;
+    root->reloading = true;
+    root->pending_complete = false;
+    kv_table_clear(&root->pending);
+    pthread_mutex_unlock(&root->mtx);
+    int rc = server->client->get_prefix_kv(server->handle, root->key, agent_root_collect, &loaded);
+    pthread_mutex_lock(&root->mtx);
+    if (rc >= 0 || root->pending_complete) {
+        if (root->pending_complete) {
+            kv_table_clear(&loaded);
+        }
+        for (size_t i = 0; i < root->pending.count; i++) {
+            if (kv_table_apply(&loaded, root->pending.items[i].key,
+                               root->pending.items[i].value) < 0) {
+                LOG_ERROR("Failed to cache %s, reads of it are stale", root->pending.items[i].key);
+            }
+        }
+        kv_table_move(&root->entries, &loaded);
+        root->state = AGENT_ROOT_READY;
+    } else {
+        LOG_ERROR("Failed to read %s again", root->key);
+        root->state = AGENT_ROOT_DORMANT;
+    }
+    root->reloading = false;
+    kv_table_clear(&root->pending);
+    kv_table_clear(&loaded);
+    pthread_cond_broadcast(&root->cv);
+}
+
+// Drops the keys of the roots without watches not read for @p idle_ns,
+// with roots_mtx held. Their watches stay, the kv_store has no way to
+// cancel them, so they still count in AGENT_SERVER_MAX_ROOTS
+static size_t agent_roots_evict(agent_server_t* server, uint64_t idle_ns) {
+    uint64_t now = agent_now_ns();
+    size_t evicted = 0;
+    for (agent_root_t* root = server->roots; root != NULL; root = root->next) {
+        if (pthread_mutex_trylock(&root->mtx) != 0) {
+            continue;
+        }
+        if (root->state == AGENT_ROOT_READY && root->subs == NULL && !root->resyncing &&
+                now - root->last_used_ns >= idle_ns) {
+            LOG_DEBUG("Evicting %zu idle keys of %s", root->entries.count, root->key);
+            kv_table_clear(&root->entries);
+            root->state = AGENT_ROOT_DORMANT;
+            evicted++;
+        }
+        pthread_mutex_unlock(&root->mtx);
+    }
+    return evicted;
+}
+
+// Returns the ready root covering a key or prefix, locked, mirroring it if
+// needed. NULL if it cannot be mirrored, or if the server mirrors
+// AGENT_SERVER_MAX_ROOTS already
+static agent_root_t* agent_root_acquire(agent_server_t* server, const char* key) {
+    size_t len = agent_root_len(key);
+    uint64_t now = agent_now_ns();
+    agent_root_t* root = NULL;
+    pthread_mutex_lock(&server->roots_mtx);
+    if (now >= server->evict_at_ns) {
+        server->evict_at_ns = now + (uint64_t) AGENT_SERVER_IDLE_MS * 1000000ULL;
+        agent_roots_evict(server, (uint64_t) AGENT_SERVER_IDLE_MS * 1000000ULL);
+    }
+    for (root = server->roots; root != NULL; root = root->next) {
+        if (strncmp(root->key, key, len) == 0 && root->key[len] == '\0') {
+            break;
+        }
+    }
+    if (root == NULL) {
+        if (server->root_count >= AGENT_SERVER_MAX_ROOTS) {
+            pthread_mutex_unlock(&server->roots_mtx);
+            return NULL;
+        }
+        root = (agent_root_t*) calloc(1, sizeof(agent_root_t));
+        if (root == NULL || (root->key = strndup(key, len)) == NULL) {
+            LOG_ERROR("Failed to allocate memory to mirror %s", key);
+            free(root);
+            pthread_mutex_unlock(&server->roots_mtx);
+            return NULL;
+        }
+        root->state = AGENT_ROOT_EMPTY;
+        pthread_mutex_init(&root->mtx, NULL);
+        pthread_cond_init(&root->cv, NULL);
+        root->next = server->roots;
+        server->roots = root;
+        server->root_count++;
+    }
+    pthread_mutex_unlock(&server->roots_mtx);
+
+    pthread_mutex_lock(&root->mtx);
+    while (root->state == AGENT_ROOT_LOADING) {
+        pthread_cond_wait(&root->cv, &root->mtx);
+    }
+    if (root->state == AGENT_ROOT_EMPTY) {
+        root->state = AGENT_ROOT_LOADING;
+        kv_table_clear(&root->entries);
+        pthread_mutex_unlock(&root->mtx);
+        // The current keys are delivered to agent_root_cb() before it
+        // returns, later changes by the watch thread of the kv_store
+        int rc = server->client->watch_prefix_kv(server->handle, root->key, agent_root_cb, root);
+        pthread_mutex_lock(&root->mtx);
+        root->watched = rc == 0;
+        root->state = (rc == 0) ? AGENT_ROOT_READY : AGENT_ROOT_EMPTY;
+        pthread_cond_broadcast(&root->cv);
+        if (rc != 0) {
+            LOG_ERROR("Failed to mirror %s", root->key);
+        }
+    } else if (root->state == AGENT_ROOT_DORMANT && server->client->get_prefix_kv != NULL) {
+        agent_root_reload(server, root);
+    }
+    if (root->state != AGENT_ROOT_READY) {
+        pthread_mutex_unlock(&root->mtx);
+        return NULL;
+    }
+    root->last_used_ns = now;
+    return root;
+}
+
+size_t agent_server_evict_idle(agent_server_t* server, uint64_t idle_ms) {
+    if (server == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&server->roots_mtx);
+    size_t evicted = agent_roots_evict(server, idle_ms * 1000000ULL);
+    pthread_mutex_unlock(&server->roots_mtx);
+    return evicted;
+}
+
+// Appends the count and the entries of a locked root matching a read
+static int agent_root_put_entries(agent_root_t* root, const char* key, bool prefix,
+                                  agent_buf_t* out) {
+    size_t first = kv_table_lower_bound(&root->entries, key);
+    size_t end = first;
+    size_t key_len = strlen(key);
+    while (end < root->entries.count &&
+           (prefix ? strncmp(root->entries.items[end].key, key, key_len) == 0
+                   : strcmp(root->entries.items[end].key, key) == 0)) {
+        end++;
+    }
+    if (agent_buf_put_u32(out, (uint32_t) (end - first)) != 0) {
+        return -1;
+    }
+    for (size_t i = first; i < end; i++) {
+        if (agent_buf_put_str(out, root->entries.items[i].key) != 0 ||
+                agent_buf_put_str(out, root->entries.items[i].value) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Whether reads and watches of a key or prefix are served
+static bool agent_server_serves(agent_server_t* server, const char* key) {
+    if (server->dev_mode || agent_key_shared(key)) {
+        return true;
+    }
+    LOG_DEBUG("Denied %s, only shared keys are served in prod mode", key);
+    return false;
+}
+
+static agent_status_t agent_handle_get(agent_server_t* server, agent_reader_t* req, agent_buf_t* out) {
+    const char* key;
+    if (agent_read_str(req, &key) != 0) {
+        return AGENT_STATUS_ERROR;
+    }
+    if (!agent_server_serves(server, key)) {
+        return AGENT_STATUS_PERMISSION_DENIED;
+    }
+    agent_root_t* root = agent_root_acquire(server, key);
+    if (root == NULL) {
+        char* value = server->client->get(server->handle, (char*) key);
+        if (value == NULL) {
+            return AGENT_STATUS_NOT_FOUND;
+        }
+        int rc = agent_buf_put_str(out, value);
+        free(value);
+        return (rc == 0) ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+    }
+    agent_status_t status = AGENT_STATUS_NOT_FOUND;
+    size_t pos = kv_table_lower_bound(&root->entries, key);
+    if (pos < root->entries.count && strcmp(root->entries.items[pos].key, key) == 0) {
+        status = (agent_buf_put_str(out, root->entries.items[pos].value) == 0)
+                 ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+    }
+    pthread_mutex_unlock(&root->mtx);
+    return status;
+}
+
+// Reads a prefix with get_batch(), for prefixes the server does not mirror
+static agent_status_t agent_forward_prefix(agent_server_t* server, const char* prefix, agent_buf_t* out) {
+    if (server->client->get_batch == NULL) {
+        LOG_ERROR("Cannot read %s, the agent mirrors too many prefixes", prefix);
+        return AGENT_STATUS_ERROR;
+    }
+    char* keys[1] = {(char*) prefix};
+    bool prefixes[1] = {true};
+    config_t* values = server->client->get_batch(server->handle, keys, prefixes, 1);
+    if (values == NULL) {
+        return AGENT_STATUS_ERROR;
+    }
+    agent_status_t status = AGENT_STATUS_OK;
+    cJSON* obj = (cJSON*) values->cfg;
+    if (agent_buf_put_u32(out, (uint32_t) cJSON_GetArraySize(obj)) != 0) {
+        status = AGENT_STATUS_ERROR;
+    }
+    for (cJSON* item = obj->child; item != NULL && status == AGENT_STATUS_OK; item = item->next) {
+        if (!cJSON_IsString(item) || agent_buf_put_str(out, item->string) != 0 ||
+                agent_buf_put_str(out, item->valuestring) != 0) {
+            status = AGENT_STATUS_ERROR;
+        }
+    }
+    config_destroy(values);
+    return status;
+}
+
+static agent_status_t agent_handle_get_prefix(agent_server_t* server, agent_reader_t* req,
+                                              agent_buf_t* out) {
+    const char* prefix;
+    if (agent_read_str(req, &prefix) != 0) {
+        return AGENT_STATUS_ERROR;
+    }
+    if (!agent_server_serves(server, prefix)) {
+        return AGENT_STATUS_PERMISSION_DENIED;
+    }
+    agent_root_t* root = agent_root_acquire(server, prefix);
+    if (root == NULL) {
+        return agent_forward_prefix(server, prefix, out);
+    }
+    int rc = agent_root_put_entries(root, prefix, true, out);
+    pthread_mutex_unlock(&root->mtx);
+    return (rc == 0) ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+}
+
+// Subscribes the connection to the root of a key or prefix and replies
+// with its current keys. The reply is sent under the lock of the root,
+// before any event
+static void agent_handle_watch(agent_conn_t* conn, uint32_t id, agent_reader_t* req, agent_buf_t* out) {
+    agent_server_t* server = conn->server;
+    uint8_t prefix;
+    const char* key;
+    if (agent_read_u8(req, &prefix) != 0 || agent_read_str(req, &key) != 0) {
+        agent_conn_send(conn, AGENT_OP_WATCH, AGENT_STATUS_ERROR, id, NULL);
+        return;
+    }
+    if (!agent_server_serves(server, key)) {
+        agent_conn_send(conn, AGENT_OP_WATCH, AGENT_STATUS_PERMISSION_DENIED, id, NULL);
+        return;
+    }
+    agent_root_t* root = agent_root_acquire(server, key);
+    if (root == NULL) {
+        LOG_ERROR("Cannot watch %s, the agent mirrors too many prefixes", key);
+        agent_conn_send(conn, AGENT_OP_WATCH, AGENT_STATUS_ERROR, id, NULL);
+        return;
+    }
+    agent_sub_t* sub = (agent_sub_t*) calloc(1, sizeof(agent_sub_t));
+    if (sub == NULL || (sub->key = strdup(key)) == NULL ||
+            agent_root_put_entries(root, key, prefix != 0, out) != 0) {
+        LOG_ERROR("Failed to allocate the watch of %s", key);
+        pthread_mutex_unlock(&root->mtx);
+        if (sub != NULL) {
+            free(sub->key);
+        }
+        free(sub);
+        agent_conn_send(conn, AGENT_OP_WATCH, AGENT_STATUS_ERROR, id, NULL);
+        return;
+    }
+    sub->conn = conn;
+    sub->id = id;
+    sub->prefix = prefix != 0;
+    sub->next = root->subs;
+    root->subs = sub;
+    agent_conn_send(conn, AGENT_OP_WATCH, AGENT_STATUS_OK, id, out);
+    pthread_mutex_unlock(&root->mtx);
+}
+
+// Handles a request other than WATCH
+static agent_status_t agent_handle(agent_server_t* server, uint8_t op, agent_reader_t* req,
+                                   agent_buf_t* out) {
+    const char* key;
+    const char* value;
+    int64_t lease_id;
+    int64_t ttl;
+    // Writes and leases would be made with the credentials of the agent
+    if (!server->dev_mode && op != AGENT_OP_GET && op != AGENT_OP_GET_PREFIX) {
+        LOG_DEBUG("Denied agent request %u, only reads are served in prod mode", op);
+        return AGENT_STATUS_PERMISSION_DENIED;
+    }
+    switch (op) {
+        case AGENT_OP_GET:
+            return agent_handle_get(server, req, out);
+        case AGENT_OP_GET_PREFIX:
+            return agent_handle_get_prefix(server, req, out);
+        case AGENT_OP_PUT:
+            if (agent_read_str(req, &key) != 0 || agent_read_str(req, &value) != 0) {
+                return AGENT_STATUS_ERROR;
+            }
+            return (server->client->put(server->handle, (char*) key, (char*) value) == 0)
+                   ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+        case AGENT_OP_GRANT_LEASE:
+            if (agent_read_i64(req, &ttl) != 0 ||
+                    server->client->grant_lease(server->handle, ttl, &lease_id) != 0) {
+                return AGENT_STATUS_ERROR;
+            }
+            return (agent_buf_put_i64(out, lease_id) == 0) ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+        case AGENT_OP_PUT_WITH_LEASE:
+            if (agent_read_str(req, &key) != 0 || agent_read_str(req, &value) != 0 ||
+                    agent_read_i64(req, &lease_id) != 0) {
+                return AGENT_STATUS_ERROR;
+            }
+            return (server->client->put_with_lease(server->handle, (char*) key, (char*) value,
+                                                   lease_id) == 0)
+                   ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+        case AGENT_OP_KEEPALIVE:
+            if (agent_read_i64(req, &lease_id) != 0) {
+                return AGENT_STATUS_ERROR;
+            }
+            return (server->client->keepalive(server->handle, lease_id) == 0)
+                   ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+        case AGENT_OP_REVOKE_LEASE:
+            if (agent_read_i64(req, &lease_id) != 0) {
+                return AGENT_STATUS_ERROR;
+            }
+            return (server->client->revoke_lease(server->handle, lease_id) == 0)
+                   ? AGENT_STATUS_OK : AGENT_STATUS_ERROR;
+        default:
+            LOG_ERROR("Unknown agent request %u", op);
+            return AGENT_STATUS_ERROR;
+    }
+}
+
+// Removes the watches of a connection from every root
+static void agent_conn_unsubscribe(agent_conn_t* conn) {
+    agent_server_t* server = conn->server;
+    pthread_mutex_lock(&server->roots_mtx);
+    agent_root_t* root = server->roots;
+    pthread_mutex_unlock(&server->roots_mtx);
+    for (; root != NULL; root = root->next) {
+        pthread_mutex_lock(&root->mtx);
+        agent_sub_t** link = &root->subs;
+        while (*link != NULL) {
+            agent_sub_t* sub = *link;
+            if (sub->conn == conn) {
+                *link = sub->next;
+                free(sub->key);
+                free(sub);
+            } else {
+                link = &sub->next;
+            }
+        }
+        pthread_mutex_unlock(&root->mtx);
+    }
+}
+
+static void* agent_conn_run(void* arg) {
+    agent_conn_t* conn = (agent_conn_t*) arg;
+    agent_server_t* server = conn->server;
+    agent_frame_header_t header;
+    agent_buf_t in = {NULL, 0, 0};
+    agent_buf_t out = {NULL, 0, 0};
+
+    while (agent_recv_frame(conn->fd, &header, &in) == 0) {
+        agent_reader_t req = {in.data, in.len, 0};
+        agent_buf_reset(&out);
+        if (header.op == AGENT_OP_WATCH) {
+            agent_handle_watch(conn, header.id, &req, &out);
+            continue;
+        }
+        agent_status_t status = agent_handle(server, header.op, &req, &out);
+        if (status != AGENT_STATUS_OK) {
+            agent_buf_reset(&out);
+        }
+        agent_conn_send(conn, header.op, status, header.id, &out);
+    }
+
+    agent_conn_unsubscribe(conn);
+    agent_buf_free(&in);
+    agent_buf_free(&out);
+    pthread_mutex_lock(&server->conns_mtx);
+    agent_conn_t** link = &server->conns;
+    while (*link != conn) {
+        link = &(*link)->next;
+    }
+    *link = conn->next;
+    pthread_cond_broadcast(&server->conns_cv);
+    pthread_mutex_unlock(&server->conns_mtx);
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->write_mtx);
+    free(conn);
+    return NULL;
+}
+
+static void* agent_accept_run(void* arg) {
+    agent_server_t* server = (agent_server_t*) arg;
+    while (true) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        pthread_mutex_lock(&server->conns_mtx);
+        bool stopping = server->stopping;
+        pthread_mutex_unlock(&server->conns_mtx);
+        if (stopping) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            break;
+        }
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                LOG_ERROR("Failed to accept an agent client: %s", strerror(errno));
+                // Out of descriptors or memory, retried once some are freed
+                usleep(100000);
+            }
+            continue;
+        }
+
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        struct timeval timeout;
+        timeout.tv_sec = AGENT_SERVER_SEND_TIMEOUT_MS / 1000;
+        timeout.tv_usec = (AGENT_SERVER_SEND_TIMEOUT_MS % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        agent_conn_t* conn = (agent_conn_t*) calloc(1, sizeof(agent_conn_t));
+        if (conn == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for an agent client");
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->server = server;
+        pthread_mutex_init(&conn->write_mtx, NULL);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_mutex_lock(&server->conns_mtx);
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, agent_conn_run, conn) != 0) {
+            pthread_mutex_unlock(&server->conns_mtx);
+            LOG_ERROR_0("Failed to start the thread of an agent client");
+            pthread_mutex_destroy(&conn->write_mtx);
+            close(fd);
+            free(conn);
+        } else {
+            conn->next = server->conns;
+            server->conns = conn;
+            pthread_mutex_unlock(&server->conns_mtx);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    return NULL;
+}
+
+// Binds the socket, replacing a stale one left by an agent which exited
+static int agent_server_listen(agent_server_t* server) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, server->socket_path, strlen(server->socket_path) + 1);
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) {
+        LOG_ERROR("Failed to create the agent socket: %s", strerror(errno));
+        return -1;
+    }
+    if (connect(server->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) == 0) {
+        LOG_ERROR("An agent is already serving %s", server->socket_path);
+        return -1;
+    }
+    close(server->listen_fd);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) {
+        LOG_ERROR("Failed to create the agent socket: %s", strerror(errno));
+        return -1;
+    }
+    unlink(server->socket_path);
+    if (bind(server->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        LOG_ERROR("Failed to bind %s: %s", server->socket_path, strerror(errno));
+        return -1;
+    }
+    if (chmod(server->socket_path, 0660) != 0) {
+        LOG_ERROR("Failed to restrict %s: %s", server->socket_path, strerror(errno));
+        return -1;
+    }
+    if (listen(server->listen_fd, SOMAXCONN) != 0) {
+        LOG_ERROR("Failed to listen on %s: %s", server->socket_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void agent_server_free(agent_server_t* server) {
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    // Joins the watch threads calling agent_root_cb()
+    kv_client_free(server->client);
+    agent_root_t* root = server->roots;
+    while (root != NULL) {
+        agent_root_t* next = root->next;
+        agent_sub_t* sub = root->subs;
+        while (sub != NULL) {
+            agent_sub_t* next_sub = sub->next;
+            free(sub->key);
+            free(sub);
+            sub = next_sub;
+        }
+        kv_table_clear(&root->entries);
+        kv_table_clear(&root->pending);
+        kv_table_clear(&root->resync);
+        pthread_mutex_destroy(&root->mtx);
+        pthread_cond_destroy(&root->cv);
+        free(root->key);
+        free(root);
+        root = next;
+    }
+    pthread_mutex_destroy(&server->roots_mtx);
+    pthread_mutex_destroy(&server->conns_mtx);
+    pthread_cond_destroy(&server->conns_cv);
+    free(server->socket_path);
+    free(server);
+}
+
+agent_server_t* agent_server_start(kv_store_client_t* client, const char* socket_path,
+                                   bool dev_mode) {
+    agent_server_t* server = NULL;
+
+    if (client == NULL) {
+        LOG_ERROR_0("kv_store_client to serve is NULL");
+        return NULL;
+    }
+    if (client->watch_prefix_kv == NULL) {
+        LOG_ERROR_0("The agent needs a kv_store supporting watch_prefix_kv");
+        goto err;
+    }
+    if (socket_path == NULL || socket_path[0] == '\0' ||
+            strlen(socket_path) >= sizeof(((struct sockaddr_un*) NULL)->sun_path)) {
+        LOG_ERROR("Invalid agent socket path %s", (socket_path != NULL) ? socket_path : "(null)");
+        goto err;
+    }
+
+    server = (agent_server_t*) calloc(1, sizeof(agent_server_t));
+    if (server == NULL) {
+        LOG_ERROR_0("Agent server: Failed to allocate Memory");
+        goto err;
+    }
+    server->listen_fd = -1;
+    server->client = client;
+    server->dev_mode = dev_mode;
+    pthread_mutex_init(&server->roots_mtx, NULL);
+    pthread_mutex_init(&server->conns_mtx, NULL);
+    pthread_cond_init(&server->conns_cv, NULL);
+    server->socket_path = strdup(socket_path);
+    if (server->socket_path == NULL) {
+        LOG_ERROR_0("Failed to copy the agent socket path");
+        goto err;
+    }
+
+    server->handle = client->init(client);
+    if (server->handle == NULL) {
+        LOG_ERROR_0("Failed to initialize the kv_store client of the agent");
+        goto err;
+    }
+    if (agent_server_listen(server) != 0) {
+        goto err;
+    }
+    if (pthread_create(&server->acceptor, NULL, agent_accept_run, server) != 0) {
+        LOG_ERROR_0("Failed to start the agent acceptor");
+        unlink(server->socket_path);
+        goto err;
+    }
+    server->acceptor_started = true;
+    LOG_INFO("cfgmgr-agent serving %s in %s mode", socket_path, dev_mode ? "dev" : "prod");
+    return server;
+
+err:
+    if (server != NULL) {
+        agent_server_free(server);
+    } else {
+        kv_client_free(client);
+    }
+    return NULL;
+}
+
+void agent_server_stop(agent_server_t* server) {
+    if (server == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&server->conns_mtx);
+    server->stopping = true;
+    for (agent_conn_t* conn = server->conns; conn != NULL; conn = conn->next) {
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&server->conns_mtx);
+
+    // Wakes the acceptor up
+    shutdown(server->listen_fd, SHUT_RDWR);
+    pthread_join(server->acceptor, NULL);
+    unlink(server->socket_path);
+
+    pthread_mutex_lock(&server->conns_mtx);
+    while (server->conns != NULL) {
+        pthread_cond_wait(&server->conns_cv, &server->conns_mtx);
+    }
+    pthread_mutex_unlock(&server->conns_mtx);
+    agent_server_free(server);
+}
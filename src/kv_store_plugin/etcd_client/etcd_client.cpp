@@ -18,6 +18,7 @@
 // FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
 #include <exception>
 #include <thread>
 #include <stdlib.h>
@@ -25,35 +26,90 @@
 
 #include <safe_lib.h>
 #include <eii/utils/logger.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
 #include <eii/config_manager/kv_store_plugin/etcd_client/etcd_client.h>
+#include <eii/config_manager/cfgmgr_trace.h>
+#include <eii/config_manager/cfgmgr_json.h>
 
 #define NO_VALUE_ERROR    "CHECK failed: (index) < (current_size_): "
 
+// Seconds to wait before re-opening a broken LeaseKeepAlive stream
+#define KEEPALIVE_RETRY_INTERVAL    1
+
+// Milliseconds to wait before re-opening a broken Watch stream
+#define WATCH_RETRY_INTERVAL_MS     100
+
+// Operations per Txn request, etcd rejects transactions with more than
+// --max-txn-ops (128 by default) operations
+#define ETCD_MAX_TXN_OPS    128
+
+// Keys per Range request when reading a prefix, bounds the memory held by
+// a response for prefixes with thousands of keys
+#define ETCD_RANGE_PAGE_SIZE    256
+
+/**
+ * Records a cfgmgr trace span over its scope
+ */
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const std::string& detail) : detail(detail) {
+        span = cfgmgr_trace_begin(name);
+    }
+    ~TraceSpan() {
+        cfgmgr_trace_end(&span, detail.c_str());
+    }
+private:
+    cfgmgr_trace_span_t span;
+    std::string detail;
+};
+
+/**
+ * Records the outcome of a request as the kv_store status of the thread
+ */
+static void set_status(const Status& status) {
+    switch (status.error_code()) {
+    case grpc::StatusCode::OK:
+        kv_store_set_status(KV_STORE_OK);
+        break;
+    case grpc::StatusCode::UNAVAILABLE:
+        kv_store_set_status(KV_STORE_UNAVAILABLE);
+        break;
+    case grpc::StatusCode::DEADLINE_EXCEEDED:
+        kv_store_set_status(KV_STORE_DEADLINE_EXCEEDED);
+        break;
+    case grpc::StatusCode::PERMISSION_DENIED:
+    case grpc::StatusCode::UNAUTHENTICATED:
+        kv_store_set_status(KV_STORE_PERMISSION_DENIED);
+        break;
+    default:
+        kv_store_set_status(KV_STORE_ERROR);
+        break;
+    }
+}
+
 static std::string get_file_contents(const char *fpath) {
+  TraceSpan trace("etcd.read_tls", fpath);
   std::ifstream finstream(fpath);
   std::string contents((std::istreambuf_iterator<char>(finstream)), std::istreambuf_iterator<char>());
   return contents;
 }
 
-// Forward declaration of internally used locally defined functions
-void register_watch_loop(char* address, grpc::SslCredentialsOptions ssl_opts,
-                         WatchRequest watch_req, kv_store_watch_callback_t user_callback,
-                         void *user_data);
-
-bool register_watch(char* address, grpc::SslCredentialsOptions ssl_opts,
-                    WatchRequest watch_req, kv_store_watch_callback_t user_callback,
-                    void *user_data);
-
 EtcdClient::EtcdClient(const std::string& host, const std::string& port) {
     LOG_INFO("Initialize EtcdClient in Dev mode");
     kv_stub = NULL;
+    keepalive_ctx = NULL;
+    keepalive_stop = false;
+    watch_stop = false;
 
     LOG_DEBUG("host:%s and port:%s", host.c_str(), port.c_str());
     // TODO: Add port check availability function
     snprintf(address, ADDRESS_LEN, "%s:%s", host.c_str(), port.c_str());
 
     try {
-        kv_stub = KV::NewStub(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+        TraceSpan trace("etcd.create_channel", address);
+        channel = grpc::CreateChannel(address, grpc::InsecureChannelCredentials());
+        kv_stub = KV::NewStub(channel);
+        lease_stub = Lease::NewStub(channel);
     }catch(...) {
         LOG_ERROR("Exception Occurred while creating grpc channel for KV Store");
         throw "KV Channel Creation Failed";
@@ -63,6 +119,9 @@ EtcdClient::EtcdClient(const std::string& host, const std::string& port) {
 EtcdClient::EtcdClient(const std::string& host, const std::string& port, const std::string& cert_file,
                        const std::string& key_file, const std::string ca_file) {
     LOG_INFO("Initialize EtcdClient in Prod mode");
+    keepalive_ctx = NULL;
+    keepalive_stop = false;
+    watch_stop = false;
     LOG_DEBUG("host:%s and port:%s", host.c_str(), port.c_str());
     snprintf(address, ADDRESS_LEN, "%s:%s", host.c_str(), port.c_str());
     const char* croot = ca_file.c_str();
@@ -78,13 +137,32 @@ EtcdClient::EtcdClient(const std::string& host, const std::string& port, const s
     ssl_opts.pem_cert_chain = cert_pem;
 
     try {
-        kv_stub = KV::NewStub(grpc::CreateChannel(address, grpc::SslCredentials(ssl_opts)));
+        TraceSpan trace("etcd.create_channel", address);
+        channel = grpc::CreateChannel(address, grpc::SslCredentials(ssl_opts));
+        kv_stub = KV::NewStub(channel);
+        lease_stub = Lease::NewStub(channel);
     }catch(...) {
         LOG_ERROR("Exception Occurred while creating grpc channel for KV Store");
         throw "KV Channel Creation Failed";
     }
 }
 
+EtcdClient::EtcdClient(std::shared_ptr<Channel> channel) {
+    LOG_INFO_0("Initialize EtcdClient over an existing channel");
+    keepalive_ctx = NULL;
+    keepalive_stop = false;
+    watch_stop = false;
+    snprintf(address, ADDRESS_LEN, "%s", "channel");
+
+    if (channel == nullptr) {
+        LOG_ERROR_0("gRPC channel for KV Store is NULL");
+        throw "KV Channel Creation Failed";
+    }
+    this->channel = channel;
+    kv_stub = KV::NewStub(channel);
+    lease_stub = Lease::NewStub(channel);
+}
+
 /**
 * Sends a get request to the etcd server
 * @param key is the key to be read
@@ -109,12 +187,16 @@ std::string EtcdClient::get(std::string& key) {
             }
         }
         get_request.set_key(key);
+        TraceSpan trace("etcd.range", get_request.key());
         status = kv_stub->Range(&context,get_request,&reply);
+        set_status(status);
         if (status.ok()) {
             // Check for kvs_size() which is 0
             // in error conditions
             if (reply.kvs_size() != 0) {
                 kvs.CopyFrom(reply.kvs(0));
+            } else {
+                kv_store_set_status(KV_STORE_NOT_FOUND);
             }
         } else {
             LOG_ERROR("get() API Failed with Error:%s and Error Code: %d",
@@ -123,6 +205,7 @@ std::string EtcdClient::get(std::string& key) {
         }
     } catch(std::exception const & ex) {
         LOG_ERROR("Exception Occurred in get() API with the Error: %s", ex.what());
+        kv_store_set_status(KV_STORE_ERROR);
         int no_val_error;
         strcmp_s(NO_VALUE_ERROR, strlen(NO_VALUE_ERROR), ex.what(), &no_val_error);
         // Report due to what error the key could not be found
@@ -134,108 +217,365 @@ std::string EtcdClient::get(std::string& key) {
     return kvs.value();
 }
 
+// Collects the values streamed by get_prefix_kv() for get_prefix()
+static int get_prefix_push_value(const char* key, const char* value, void* user_data) {
+    std::vector<std::string>* values = static_cast<std::vector<std::string>*>(user_data);
+    values->push_back(value);
+    return 0;
+}
+
 std::vector<std::string> EtcdClient::get_prefix(std::string& key_prefix) {
     LOG_DEBUG_0("In get_prefix() API");
     LOG_DEBUG("get all values for keys starting from %s", key_prefix.c_str());
-    mvccpb::KeyValue kvs;
-    RangeRequest get_request;
-    RangeResponse reply;
-    Status status;
-    ClientContext context;
     std::vector<std::string> values;
-    std::vector<std::string>::iterator it;
+    get_prefix_kv(key_prefix, get_prefix_push_value, &values);
+    return values;
+}
 
-    std::string& range_end = key_prefix;
+/**
+* Streams every key of a prefix and its raw value to user_callback, a page
+* of keys at a time
+* @param key is the prefix of the keys to be read
+* @param user_callback user_call back called for every key
+* @param user_data user_data to be passed, it can be NULL also
+*/
+int EtcdClient::get_prefix_kv(std::string& key, kv_store_get_kv_callback_t user_callback, void *user_data) {
+    LOG_DEBUG_0("In get_prefix_kv() API");
+    LOG_DEBUG("stream all keys starting from %s", key.c_str());
+
+    std::string etcd_prefix;
+    char* etcd_prefix_env = getenv("ETCD_PREFIX");
+    if (etcd_prefix_env == NULL) {
+        LOG_DEBUG_0("ETCD_PREFIX env not set, fetching keys without ETCD_PREFIX");
+    } else {
+        etcd_prefix = etcd_prefix_env;
+    }
 
+    int count = 0;
     try {
-        char* etcd_prefix = getenv("ETCD_PREFIX");
-        if (etcd_prefix == NULL) {
-            LOG_DEBUG_0("ETCD_PREFIX env not set, fetching key without ETCD_PREFIX");
-        } else {
-            if (strlen(etcd_prefix) != 0) {
-                std::string prefix(etcd_prefix);
-                key_prefix = prefix + key_prefix;
-                range_end = key_prefix;
+        std::string start = etcd_prefix + key;
+        if (start.empty()) {
+            LOG_ERROR_0("Prefix to read is empty");
+            kv_store_set_status(KV_STORE_ERROR);
+            return -1;
+        }
+        std::string range_end = start;
+        range_end.back() = range_end.back() + 1;
+
+        bool ok = range_paged(start, range_end, [&](const mvccpb::KeyValue& kv) {
+            std::string kv_key = kv.key().substr(etcd_prefix.size());
+            count++;
+            return user_callback(kv_key.c_str(), kv.value().c_str(), user_data) == 0;
+        }, NULL);
+        if (!ok) {
+            return -1;
+        }
+    } catch(std::exception const & ex) {
+        LOG_ERROR("Exception Occurred in get_prefix_kv() API with the Error: %s", ex.what());
+        kv_store_set_status(KV_STORE_ERROR);
+        return -1;
+    }
+    return count;
+}
+
+/**
+* Reads every key of [start, range_end) a page of ETCD_RANGE_PAGE_SIZE keys
+* at a time, later pages are read at the revision of the first one and start
+* right after the last key of the previous page
+* @param start is the first key of the range
+* @param range_end is the end of the range, excluded
+* @param on_kv called for every key, reading stops when it returns false
+* @param revision set to the revision the keys were read at, can be NULL
+*/
+bool EtcdClient::range_paged(const std::string& start, const std::string& range_end,
+                             const std::function<bool(const mvccpb::KeyValue&)>& on_kv,
+                             int64_t* revision) {
+    RangeRequest get_request;
+    get_request.set_key(start);
+    get_request.set_range_end(range_end);
+    get_request.set_limit(ETCD_RANGE_PAGE_SIZE);
+
+    while (true) {
+        RangeResponse reply;
+        ClientContext context;
+        Status status;
+        {
+            TraceSpan trace("etcd.range", get_request.key());
+            status = kv_stub->Range(&context, get_request, &reply);
+        }
+        set_status(status);
+        if (!status.ok()) {
+            LOG_ERROR("Range request Failed with Error:%s and Error Code: %d",
+                status.error_message().c_str(), status.error_code());
+            return false;
+        }
+        if (get_request.revision() == 0) {
+            get_request.set_revision(reply.header().revision());
+            if (revision != NULL) {
+                *revision = reply.header().revision();
             }
         }
-        get_request.set_key(key_prefix);
+        for (int i = 0; i < reply.kvs_size(); i++) {
+            if (!on_kv(reply.kvs(i))) {
+                return true;
+            }
+        }
+        if (!reply.more() || reply.kvs_size() == 0) {
+            return true;
+        }
+        std::string next = reply.kvs(reply.kvs_size() - 1).key();
+        next.push_back('\0');
+        get_request.set_key(next);
+    }
+}
 
-        int ascii = (int)range_end[range_end.length()-1];
-        range_end.back() = ascii+1;
+/**
+* Reads several keys and key prefixes with one Txn of range requests per
+* ETCD_MAX_TXN_OPS keys, all read at the revision of the first Txn
+* @param keys is the list of keys and key prefixes to be read
+* @param prefixes tells for every entry of keys whether it is a prefix
+* @param kvs is filled with the (key, value) pairs found
+*/
+int EtcdClient::get_batch(const std::vector<std::string>& keys, const std::vector<bool>& prefixes,
+                          std::vector<std::pair<std::string, std::string>>& kvs) {
+    LOG_DEBUG_0("In get_batch() API");
+    LOG_DEBUG("get values for %zu keys and key prefixes", keys.size());
 
-        get_request.set_range_end(range_end);
+    std::string etcd_prefix;
+    char* etcd_prefix_env = getenv("ETCD_PREFIX");
+    if (etcd_prefix_env == NULL) {
+        LOG_DEBUG_0("ETCD_PREFIX env not set, fetching keys without ETCD_PREFIX");
+    } else {
+        etcd_prefix = etcd_prefix_env;
+    }
 
-        status = kv_stub->Range(&context,get_request,&reply);
+    int64_t revision = 0;
+    try {
+        for (size_t start = 0; start < keys.size(); start += ETCD_MAX_TXN_OPS) {
+            size_t end = std::min(keys.size(), start + ETCD_MAX_TXN_OPS);
+            TxnRequest txn_request;
+            TxnResponse reply;
+            ClientContext context;
 
-        if (status.ok()) {
-            // Check for kvs_size() which is 0
-            // in error conditions
-            if (reply.kvs_size() != 0) {
-                for(int i=0; i<reply.kvs_size(); i++) {
-                    kvs.CopyFrom(reply.kvs(i));
-                    values.push_back( kvs.value());
+            // No compares, the success branch is always taken
+            for (size_t i = start; i < end; i++) {
+                RangeRequest* range = txn_request.add_success()->mutable_request_range();
+                std::string key = etcd_prefix + keys[i];
+                range->set_key(key);
+                range->set_revision(revision);
+                if (prefixes[i] && !key.empty()) {
+                    std::string range_end = key;
+                    range_end.back() = range_end.back() + 1;
+                    range->set_range_end(range_end);
+                }
+            }
+
+            TraceSpan trace("etcd.txn", std::to_string(end - start) + " keys");
+            Status status = kv_stub->Txn(&context, txn_request, &reply);
+            set_status(status);
+            if (!status.ok()) {
+                LOG_ERROR("get_batch() API Failed with Error:%s and Error Code: %d",
+                    status.error_message().c_str(), status.error_code());
+                return -1;
+            }
+            if (revision == 0) {
+                revision = reply.header().revision();
+            }
+
+            for (const ResponseOp& op : reply.responses()) {
+                const RangeResponse& range = op.response_range();
+                for (int i = 0; i < range.kvs_size(); i++) {
+                    const mvccpb::KeyValue& kv = range.kvs(i);
+                    kvs.emplace_back(kv.key().substr(etcd_prefix.size()), kv.value());
                 }
             }
-        } else {
-            LOG_ERROR("get() API Failed with Error:%s and Error Code: %d",
-                status.error_message().c_str(), status.error_code());
         }
     } catch(std::exception const & ex) {
-        int no_val_error;
-        LOG_ERROR("Exception Occurred in get() API with the Error: %s", ex.what());
-        strcmp_s(NO_VALUE_ERROR, strlen(NO_VALUE_ERROR), ex.what(), &no_val_error);
-        // Report due to what error the key could not be found
-        if(no_val_error == 0) {
-            LOG_ERROR("Value for the key %s is not found %s", key_prefix.c_str(), ex.what());
-        }
+        LOG_ERROR("Exception Occurred in get_batch() API with the Error: %s", ex.what());
+        kv_store_set_status(KV_STORE_ERROR);
+        return -1;
     }
+    return 0;
+}
 
-    return values;
+void EtcdClient::start_watch(WatchRequest& watch_req, kv_store_watch_callback_t user_callback,
+                             void *user_data, kv_store_watch_kv_callback_t user_kv_callback) {
+    std::lock_guard<std::mutex> lk(watch_mtx);
+    if (watch_stop) {
+        LOG_ERROR_0("watch() called on a client being destroyed");
+        return;
+    }
+    watch_threads.push_back(std::thread(&EtcdClient::register_watch_loop, this,
+                                        watch_req, user_callback, user_data, user_kv_callback));
 }
 
-void register_watch_loop(char* address, grpc::SslCredentialsOptions ssl_opts,
-                         WatchRequest watch_req, kv_store_watch_callback_t user_callback,
-                         void *user_data) {
-    bool watch_registered = true;
+void EtcdClient::register_watch_loop(WatchRequest watch_req, kv_store_watch_callback_t user_callback,
+                                     void *user_data, kv_store_watch_kv_callback_t user_kv_callback) {
     // Register watch once and check for watch expired conditions
-    // If watch is expired, register it again
-    do {
-        // TODO: We are relying on register_watch returning on error
-        // conditions here, should be replaced with a means to catch
-        // specific error conditions like timeout, socket closed etc.
-        watch_registered = register_watch(address, ssl_opts, watch_req,
-                                          user_callback, user_data);
-        if (!watch_registered) {
-            LOG_DEBUG_0("Watch expired, re-registering...");
-        }
-    } while (!watch_registered);
+    // If watch is expired, register it again from the next revision
+    // so that no event is lost or delivered twice
+    while (!register_watch(watch_req, user_callback, user_data, user_kv_callback)) {
+        LOG_DEBUG_0("Watch expired, re-registering...");
+        std::unique_lock<std::mutex> lk(watch_mtx);
+        if (watch_cv.wait_for(lk, std::chrono::milliseconds(WATCH_RETRY_INTERVAL_MS),
+                              [this] { return watch_stop; })) {
+            break;
+        }
+    }
+}
+
+// Builds the value handed to watch callbacks, non JSON values are wrapped
+// as {key: value}
+static config_t* watch_value_to_config(const char* key, const char* value) {
+    cJSON* val_json;
+    // Checking if the value updated is not in Json format
+    if (value[0] != '{') {
+        if (strlen(value) == 0) {
+            LOG_ERROR_0("Value shouldn't be empty. Empty string is not supported");
+            return NULL;
+        }
+        // Creating the cJSON object with Key as key and value as value
+        val_json = cJSON_CreateObject();
+        if (val_json == NULL) {
+            LOG_ERROR_0("Create json object failed");
+            return NULL;
+        }
+        cJSON_AddStringToObject(val_json, key, value);
+    } else {
+        // char* to cJSON conversion
+        val_json = cfgmgr_json_parse(value, strlen(value));
+        if (val_json == NULL) {
+            LOG_ERROR_0("cJSON Parse failed");
+            return NULL;
+        }
+    }
+
+    // cJSON to config_t conversion
+    config_t* config = config_new(
+        (void*) val_json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        cJSON_Delete(val_json);
+        LOG_ERROR_0("Failed to initialize configuration object");
+    }
+    return config;
+}
+
+/**
+* Re-reads the keys of a watch which can not resume from its revision and
+* delivers them, between the resync markers of watch_prefix_kv() for raw
+* callbacks. The watch then resumes from the revision they were read at
+* @return false if the keys could not be read
+*/
+bool EtcdClient::resync_watch(WatchCreateRequest* watch_create_req, kv_store_watch_callback_t user_callback,
+                              void *user_data, kv_store_watch_kv_callback_t user_kv_callback) {
+    size_t etcd_prefix_len = 0;
+    char* etcd_prefix = getenv("ETCD_PREFIX");
+    if (etcd_prefix != NULL) {
+        etcd_prefix_len = strlen(etcd_prefix);
+    }
+
+    // Keys are read before any is delivered, a resync is never cut short
+    std::vector<std::pair<std::string, std::string>> kvs;
+    int64_t revision = 0;
+    bool ok = range_paged(watch_create_req->key(), watch_create_req->range_end(),
+                          [&](const mvccpb::KeyValue& kv) {
+        kvs.emplace_back(kv.key(), kv.value());
+        return true;
+    }, &revision);
+    if (!ok) {
+        return false;
+    }
+
+    if (user_kv_callback != NULL) {
+        const std::string& start = watch_create_req->key();
+        std::string prefix = (start.size() >= etcd_prefix_len) ? start.substr(etcd_prefix_len) : start;
+        user_kv_callback(NULL, prefix.c_str(), user_data);
+        for (const auto& kv : kvs) {
+            std::string kv_key = (kv.first.size() >= etcd_prefix_len) ?
+                                 kv.first.substr(etcd_prefix_len) : kv.first;
+            user_kv_callback(kv_key.c_str(), kv.second.c_str(), user_data);
+        }
+        user_kv_callback(NULL, NULL, user_data);
+    } else {
+        // Watch callbacks only get puts, deleted keys go unnoticed
+        for (const auto& kv : kvs) {
+            config_t* config = watch_value_to_config(kv.first.c_str(), kv.second.c_str());
+            if (config != NULL) {
+                user_callback(kv.first.c_str(), config, user_data);
+            }
+        }
+    }
+    LOG_INFO("Resynced %zu keys of %s at revision %lld", kvs.size(),
+             watch_create_req->key().c_str(), (long long) revision);
+    watch_create_req->set_start_revision(revision + 1);
+    return true;
 }
 
-bool register_watch(char* address, grpc::SslCredentialsOptions ssl_opts,
-                    WatchRequest watch_req, kv_store_watch_callback_t user_callback, void *user_data) {
+bool EtcdClient::register_watch(WatchRequest& watch_req, kv_store_watch_callback_t user_callback,
+                                void *user_data, kv_store_watch_kv_callback_t user_kv_callback) {
     WatchResponse reply;
     mvccpb::KeyValue kvs;
     ClientContext context;
+    WatchCreateRequest* watch_create_req = watch_req.mutable_create_request();
+    bool stream_ok = true;
 
-    std::unique_ptr<Watch::Stub> watch_stub;
+    // Raw events are delivered without ETCD_PREFIX
+    size_t etcd_prefix_len = 0;
+    char* etcd_prefix = getenv("ETCD_PREFIX");
+    if (etcd_prefix != NULL) {
+        etcd_prefix_len = strlen(etcd_prefix);
+    }
 
-    if((ssl_opts.pem_root_certs.empty()) && (ssl_opts.pem_private_key.empty()) \
-            && (ssl_opts.pem_cert_chain.empty())) {
-        watch_stub = Watch::NewStub(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
-    }else {
-        watch_stub = Watch::NewStub(grpc::CreateChannel(address, grpc::SslCredentials(ssl_opts)));
+    {
+        std::lock_guard<std::mutex> lk(watch_mtx);
+        if (watch_stop) {
+            return true;
+        }
+        watch_ctxs.insert(&context);
     }
 
+    // Watch streams share the channel of the client
+    std::unique_ptr<Watch::Stub> watch_stub = Watch::NewStub(channel);
+
     // TODO: make use of AsyncWatch instead of Watch
     std::unique_ptr<ClientReaderWriter<WatchRequest, WatchResponse> > stream = watch_stub->Watch(&context);
 
     stream->Write(watch_req);
 
     // Checking for any changes in key
-    while (stream->Read(&reply)) {
+    while (stream_ok && stream->Read(&reply)) {
+        if (reply.compact_revision() > 0) {
+            // Events up to the compact revision are gone, deletes included,
+            // so the keys are read again and the watch resumes after them.
+            // On failure the next registration is compacted again and retries
+            LOG_WARN("Watch on %s compacted at revision %lld, resyncing its keys",
+                     watch_create_req->key().c_str(), (long long) reply.compact_revision());
+            if (!resync_watch(watch_create_req, user_callback, user_data, user_kv_callback)) {
+                LOG_ERROR("Failed to resync the watch on %s", watch_create_req->key().c_str());
+            }
+            stream_ok = false;
+            break;
+        }
+        if (reply.created() && watch_create_req->start_revision() == 0) {
+            // Pin the watch to the revision it started at, for re-registering
+            watch_create_req->set_start_revision(reply.header().revision() + 1);
+        }
         if (reply.events_size()) {
-            for (int cnt = 0; cnt < reply.events_size(); cnt++) {
+            for (int cnt = 0; stream_ok && cnt < reply.events_size(); cnt++) {
                 auto event = reply.events(cnt);
+                watch_create_req->set_start_revision(event.kv().mod_revision() + 1);
+                if (user_kv_callback != NULL) {
+                    const std::string& event_key = event.kv().key();
+                    std::string kv_key = (event_key.size() >= etcd_prefix_len) ?
+                                         event_key.substr(etcd_prefix_len) : event_key;
+                    if (mvccpb::Event::EventType::Event_EventType_DELETE == event.type()) {
+                        LOG_DEBUG("key:%s is deleted", kv_key.c_str());
+                        user_kv_callback(kv_key.c_str(), NULL, user_data);
+                    } else {
+                        user_kv_callback(kv_key.c_str(), event.kv().value().c_str(), user_data);
+                    }
+                    continue;
+                }
                 if(mvccpb::Event::EventType::Event_EventType_PUT == event.type())
                 {
                     kvs = event.kv();
@@ -243,48 +583,25 @@ bool register_watch(char* address, grpc::SslCredentialsOptions ssl_opts,
                     char *kvs_value = const_cast<char*>(kvs.value().c_str());
                     LOG_DEBUG("key:%s is updated with the value %s", kvs_key, kvs_value);
 
-                    cJSON* val_json;
-                    // Checking if the value updated is not in Json format
-                    if (kvs_value[0] != '{') {
-                        if(strlen(kvs_value) == 0) {
-                            LOG_ERROR_0("Value shouldn't be empty. Empty string is not supported");
-                            return false;
-                        }
-                        // Creating the cJSON object with Key as kvs_key and value as kvs_value
-                        val_json = cJSON_CreateObject();
-                        if(val_json == NULL){
-                            LOG_ERROR_0("Create json object failed");
-                            return false;
-                        }
-                        cJSON_AddStringToObject(val_json, kvs_key, kvs_value);
-                    } else{
-                        // char* to cJSON conversion
-                        val_json = cJSON_Parse(kvs_value);
-                        if(val_json == NULL){
-                            LOG_ERROR_0("cJSON Parse failed");
-                            return false;
-                        }
-                    }
-
-                    // cJSON to config_t conversion
-                    config_t* config = config_new(
-                        (void*) val_json, free_json, get_config_value, set_config_value);
+                    config_t* config = watch_value_to_config(kvs_key, kvs_value);
                     if (config == NULL) {
-                        cJSON_Delete(val_json);
-                        config_destroy(config);
-                        LOG_ERROR_0("Failed to initialize configuration object");
-                        return false;
+                        stream_ok = false;
+                        break;
                     }
                     user_callback(kvs_key, config, user_data);
                 }
             }
         }
     }
-    // Returns false to indicate stream->Read() returned 0
-    // and that the watch has expired
-    // User can choose to re-register the watch based
-    // on this return value
-    return false;
+
+    context.TryCancel();
+    stream->Finish();
+
+    std::lock_guard<std::mutex> lk(watch_mtx);
+    watch_ctxs.erase(&context);
+    // Returns false to indicate the stream broke and that the watch
+    // must be re-registered, unless the client is being destroyed
+    return watch_stop;
 }
 
 /**
@@ -327,14 +644,68 @@ void EtcdClient::watch_prefix(std::string& key, kv_store_watch_callback_t user_c
         watch_create_req.set_start_revision(revision);
         watch_req.mutable_create_request()->CopyFrom(watch_create_req);
 
-        std::thread register_watch_prefix_thread(register_watch_loop, address, ssl_opts, watch_req, user_callback, user_data);
-        register_watch_prefix_thread.detach();
+        start_watch(watch_req, user_callback, user_data);
     } catch(std::exception const & ex) {
         LOG_ERROR("Exception Occurred in watch_prefix() API with the Error: %s", ex.what());
         return;
     }
 }
 
+/**
+* Delivers every key of a prefix and its value, then watches the prefix from
+* the revision they were read at so that no update is lost or delivered twice
+* @param key is the prefix to be mirrored
+* @param user_callback user_call back called with the raw value of every key,
+*                      NULL for deleted keys
+* @param user_data user_data to be passed, it can be NULL also
+*/
+int EtcdClient::watch_prefix_kv(std::string& key, kv_store_watch_kv_callback_t user_callback,
+                                void *user_data) {
+    LOG_DEBUG_0("In watch_prefix_kv() API");
+    LOG_DEBUG("Register the prefix of the the key %s to mirror", key.c_str());
+
+    std::string etcd_prefix;
+    char* etcd_prefix_env = getenv("ETCD_PREFIX");
+    if (etcd_prefix_env == NULL) {
+        LOG_DEBUG_0("ETCD_PREFIX env not set, fetching keys without ETCD_PREFIX");
+    } else {
+        etcd_prefix = etcd_prefix_env;
+    }
+
+    try {
+        std::string start = etcd_prefix + key;
+        if (start.empty()) {
+            LOG_ERROR_0("Prefix to mirror is empty");
+            return -1;
+        }
+        std::string range_end = start;
+        range_end.back() = range_end.back() + 1;
+
+        int64_t revision = 0;
+        bool ok = range_paged(start, range_end, [&](const mvccpb::KeyValue& kv) {
+            std::string kv_key = kv.key().substr(etcd_prefix.size());
+            user_callback(kv_key.c_str(), kv.value().c_str(), user_data);
+            return true;
+        }, &revision);
+        if (!ok) {
+            LOG_ERROR_0("watch_prefix_kv() API Failed to read the current keys");
+            return -1;
+        }
+
+        WatchRequest watch_req;
+        WatchCreateRequest* watch_create_req = watch_req.mutable_create_request();
+        watch_create_req->set_key(start);
+        watch_create_req->set_range_end(range_end);
+        watch_create_req->set_prev_kv(false);
+        watch_create_req->set_start_revision(revision + 1);
+        start_watch(watch_req, NULL, user_data, user_callback);
+    } catch(std::exception const & ex) {
+        LOG_ERROR("Exception Occurred in watch_prefix_kv() API with the Error: %s", ex.what());
+        return -1;
+    }
+    return 0;
+}
+
 /**
 * Watches for changes of a key, registers user_callback and notify
 * user if any change on key occured
@@ -369,9 +740,8 @@ void EtcdClient::watch(std::string& key, kv_store_watch_callback_t user_callback
         watch_create_req.set_start_revision(revision);
         watch_req.mutable_create_request()->CopyFrom(watch_create_req);
 
-        std::thread register_watch_thread(register_watch_loop, address, ssl_opts, watch_req, user_callback, user_data);
+        start_watch(watch_req, user_callback, user_data);
         LOG_DEBUG("Thread created to wait on any change on the key %s", key.c_str());
-        register_watch_thread.detach();
     } catch(std::exception const & ex) {
         LOG_ERROR("Exception Occurred in watch() API with the Error: %s", ex.what());
         return;
@@ -385,9 +755,19 @@ void EtcdClient::watch(std::string& key, kv_store_watch_callback_t user_callback
 * @param value is the new value to be set
 */
 int EtcdClient::put(std::string& key, std::string& value) {
+    return put(key, value, 0);
+}
+
+/**
+* Saves the value of a key to etcd attached to a lease. The key will be
+* modified if already exists or created if it does not exist.
+* @param key is the key to be created or modified
+* @param value is the new value to be set
+* @param lease_id is the lease to attach the key to, 0 for no lease
+*/
+int EtcdClient::put(std::string& key, std::string& value, int64_t lease_id) {
     LOG_DEBUG_0("In put() API");
 
-    int64_t leaseid = 0;
     mvccpb::KeyValue kvs;
     PutRequest put_request;
     PutResponse reply;
@@ -409,8 +789,9 @@ int EtcdClient::put(std::string& key, std::string& value) {
         put_request.set_key(key);
         put_request.set_value(value);
         put_request.set_prev_kv(false);
-        put_request.set_lease(leaseid);
+        put_request.set_lease(lease_id);
         status = kv_stub->Put(&context,put_request,&reply);
+        set_status(status);
 
         if (!status.ok()) {
             LOG_ERROR("Failed to put value %s for key %s", value.c_str(), key.c_str());
@@ -419,6 +800,7 @@ int EtcdClient::put(std::string& key, std::string& value) {
         }
     } catch(std::exception const & ex) {
         LOG_ERROR("Exception Occurred in put() API with the Error: %s", ex.what());
+        kv_store_set_status(KV_STORE_ERROR);
         return -1;
     }
     LOG_DEBUG_0("put() is successful");
@@ -426,8 +808,219 @@ int EtcdClient::put(std::string& key, std::string& value) {
     return 0;
 }
 
+/**
+* Grants a new lease from the etcd server
+* @param ttl is the requested time-to-live of the lease in seconds
+* @param lease_id is set to the granted lease id on success
+*/
+int EtcdClient::lease_grant(int64_t ttl, int64_t* lease_id) {
+    LOG_DEBUG_0("In lease_grant() API");
+    LeaseGrantRequest grant_request;
+    LeaseGrantResponse reply;
+    Status status;
+    ClientContext context;
+
+    try {
+        grant_request.set_ttl(ttl);
+        status = lease_stub->LeaseGrant(&context, grant_request, &reply);
+        set_status(status);
+        if (!status.ok()) {
+            LOG_ERROR("lease_grant() API Failed with Error:%s and Error Code: %d",
+                status.error_message().c_str(), status.error_code());
+            return -1;
+        }
+        if (!reply.error().empty()) {
+            LOG_ERROR("lease_grant() API Failed with Error:%s", reply.error().c_str());
+            kv_store_set_status(KV_STORE_ERROR);
+            return -1;
+        }
+    } catch(std::exception const & ex) {
+        LOG_ERROR("Exception Occurred in lease_grant() API with the Error: %s", ex.what());
+        kv_store_set_status(KV_STORE_ERROR);
+        return -1;
+    }
+    *lease_id = reply.id();
+    LOG_DEBUG("Granted lease %lld with TTL %lld", (long long) reply.id(), (long long) reply.ttl());
+    return 0;
+}
+
+/**
+* Adds a lease to the set of leases renewed by the keepalive thread,
+* starting the thread on first use
+* @param lease_id is the lease to be kept alive
+*/
+int EtcdClient::lease_keepalive(int64_t lease_id) {
+    LOG_DEBUG_0("In lease_keepalive() API");
+    std::lock_guard<std::mutex> lk(lease_mtx);
+    if (keepalive_stop) {
+        LOG_ERROR_0("lease_keepalive() called on a client being destroyed");
+        return -1;
+    }
+    // TTL is unknown until the first renewal, so renew it right away
+    // and let the keepalive response schedule the next one
+    lease_entry_t entry;
+    entry.ttl = 0;
+    entry.next_renewal = std::chrono::steady_clock::now();
+    leases[lease_id] = entry;
+    try {
+        if (!keepalive_thread.joinable()) {
+            keepalive_thread = std::thread(&EtcdClient::keepalive_loop, this);
+        }
+    } catch(std::exception const & ex) {
+        LOG_ERROR("Exception Occurred in lease_keepalive() API with the Error: %s", ex.what());
+        leases.erase(lease_id);
+        return -1;
+    }
+    lease_cv.notify_one();
+    return 0;
+}
+
+/**
+* Revokes a lease and stops keeping it alive
+* @param lease_id is the lease to be revoked
+*/
+int EtcdClient::lease_revoke(int64_t lease_id) {
+    LOG_DEBUG_0("In lease_revoke() API");
+    LeaseRevokeRequest revoke_request;
+    LeaseRevokeResponse reply;
+    Status status;
+    ClientContext context;
+
+    {
+        std::lock_guard<std::mutex> lk(lease_mtx);
+        leases.erase(lease_id);
+    }
+
+    try {
+        revoke_request.set_id(lease_id);
+        status = lease_stub->LeaseRevoke(&context, revoke_request, &reply);
+        set_status(status);
+        if (!status.ok()) {
+            LOG_ERROR("lease_revoke() API Failed with Error:%s and Error Code: %d",
+                status.error_message().c_str(), status.error_code());
+            return -1;
+        }
+    } catch(std::exception const & ex) {
+        LOG_ERROR("Exception Occurred in lease_revoke() API with the Error: %s", ex.what());
+        kv_store_set_status(KV_STORE_ERROR);
+        return -1;
+    }
+    return 0;
+}
+
+void EtcdClient::keepalive_loop() {
+    LeaseKeepAliveRequest keepalive_request;
+    LeaseKeepAliveResponse reply;
+    std::unique_lock<std::mutex> lk(lease_mtx);
+
+    while (!keepalive_stop) {
+        // One stream carries the renewals of every lease of this client
+        ClientContext context;
+        keepalive_ctx = &context;
+        lk.unlock();
+        std::unique_ptr<ClientReaderWriter<LeaseKeepAliveRequest, LeaseKeepAliveResponse> > stream =
+            lease_stub->LeaseKeepAlive(&context);
+        lk.lock();
+
+        bool stream_ok = true;
+        while (!keepalive_stop && stream_ok) {
+            auto now = std::chrono::steady_clock::now();
+            auto wake_up = std::chrono::steady_clock::time_point::max();
+            std::vector<int64_t> due;
+            for (auto const& it : leases) {
+                if (it.second.next_renewal <= now) {
+                    due.push_back(it.first);
+                } else if (it.second.next_renewal < wake_up) {
+                    wake_up = it.second.next_renewal;
+                }
+            }
+            if (due.empty()) {
+                if (wake_up == std::chrono::steady_clock::time_point::max()) {
+                    lease_cv.wait(lk);
+                } else {
+                    lease_cv.wait_until(lk, wake_up);
+                }
+                continue;
+            }
+            lk.unlock();
+
+            // Pipeline all due renewals before reading back the responses,
+            // etcd answers the requests of a stream in order
+            size_t written = 0;
+            for (int64_t id : due) {
+                keepalive_request.set_id(id);
+                if (!stream->Write(keepalive_request)) {
+                    stream_ok = false;
+                    break;
+                }
+                written++;
+            }
+            std::vector<LeaseKeepAliveResponse> replies;
+            for (size_t i = 0; stream_ok && i < written; i++) {
+                if (!stream->Read(&reply)) {
+                    stream_ok = false;
+                    break;
+                }
+                replies.push_back(reply);
+            }
+
+            lk.lock();
+            now = std::chrono::steady_clock::now();
+            for (auto const& r : replies) {
+                auto it = leases.find(r.id());
+                if (it == leases.end()) {
+                    // Revoked while the renewal was in flight
+                    continue;
+                }
+                if (r.ttl() <= 0) {
+                    LOG_ERROR("Lease %lld has expired, no longer keeping it alive",
+                        (long long) r.id());
+                    leases.erase(it);
+                    continue;
+                }
+                it->second.ttl = r.ttl();
+                it->second.next_renewal = now + std::chrono::milliseconds(r.ttl() * 1000 / 3);
+            }
+        }
+
+        keepalive_ctx = NULL;
+        lk.unlock();
+        context.TryCancel();
+        stream->Finish();
+        lk.lock();
+        if (!keepalive_stop) {
+            LOG_WARN_0("LeaseKeepAlive stream closed, re-opening");
+            lease_cv.wait_for(lk, std::chrono::seconds(KEEPALIVE_RETRY_INTERVAL));
+        }
+    }
+}
+
 EtcdClient::~EtcdClient() {
     LOG_DEBUG_0("EtcdClient Destructor is called");
+    {
+        std::lock_guard<std::mutex> lk(lease_mtx);
+        keepalive_stop = true;
+        if (keepalive_ctx != NULL) {
+            keepalive_ctx->TryCancel();
+        }
+    }
+    lease_cv.notify_one();
+    if (keepalive_thread.joinable()) {
+        keepalive_thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lk(watch_mtx);
+        watch_stop = true;
+        for (ClientContext* ctx : watch_ctxs) {
+            ctx->TryCancel();
+        }
+    }
+    watch_cv.notify_all();
+    for (auto& t : watch_threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
     if (kv_stub != NULL) {
         kv_stub.reset();
     }
@@ -38,9 +38,16 @@
 void* etcd_init(void* etcd_client);
 char* etcd_get(void * handle, char *key);
 config_value_t* etcd_get_prefix(void * handle, char *key);
+int etcd_get_prefix_kv(void* handle, char *key, kv_store_get_kv_callback_t cb, void* user_data);
+config_t* etcd_get_batch(void* handle, char **keys, const bool* prefixes, size_t count);
 int etcd_put(void* handle, char *key, char *value);
 void etcd_watch(void* handle, char *key_test, kv_store_watch_callback_t cb, void* user_data);
 void etcd_watch_prefix(void* handle, char *key_test, kv_store_watch_callback_t cb, void* user_data);
+int etcd_watch_prefix_kv(void* handle, char *key_test, kv_store_watch_kv_callback_t cb, void* user_data);
+int etcd_grant_lease(void* handle, int64_t ttl, int64_t* lease_id);
+int etcd_put_with_lease(void* handle, char *key, char *value, int64_t lease_id);
+int etcd_keepalive(void* handle, int64_t lease_id);
+int etcd_revoke_lease(void* handle, int64_t lease_id);
 void etcd_client_free(void* handle);
 bool create_cert_copy(char **dest_cert, char *src_cert, unsigned int src_len);
 int strncpy_s(char *dest, unsigned int dmax, char *src, unsigned int slen);
@@ -86,6 +93,8 @@ kv_store_client_t* create_etcd_client(config_t *config) {
         LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
         goto err;
     }
+    // Set by init(), clients freed without being initialized have none
+    kv_store_client->handler = NULL;
 
     conf_obj = config->get_config_value(
                 config->cfg, ETCD_KV_STORE);
@@ -274,9 +283,16 @@ kv_store_client_t* create_etcd_client(config_t *config) {
         kv_store_client->kv_store_config = etcd_config;
         kv_store_client->get = etcd_get;
         kv_store_client->get_prefix = etcd_get_prefix;
+        kv_store_client->get_prefix_kv = etcd_get_prefix_kv;
+        kv_store_client->get_batch = etcd_get_batch;
         kv_store_client->put = etcd_put;
         kv_store_client->watch = etcd_watch;
         kv_store_client->watch_prefix = etcd_watch_prefix;
+        kv_store_client->watch_prefix_kv = etcd_watch_prefix_kv;
+        kv_store_client->grant_lease = etcd_grant_lease;
+        kv_store_client->put_with_lease = etcd_put_with_lease;
+        kv_store_client->keepalive = etcd_keepalive;
+        kv_store_client->revoke_lease = etcd_revoke_lease;
         kv_store_client->init = etcd_init;
         kv_store_client->deinit = etcd_values_destroy;
         ret = kv_store_client;
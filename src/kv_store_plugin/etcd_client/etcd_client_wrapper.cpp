@@ -20,6 +20,8 @@
 
 #include <cstdlib>
 #include <stdlib.h>
+#include <string>
+#include <unordered_set>
 
 #include <safe_lib.h>
 #include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
@@ -84,16 +86,21 @@ char* etcd_get(void* handle, char *key) {
     return val;
 }
 
+// Appends every value streamed by get_prefix_kv() to the cJSON array
+static int etcd_get_prefix_append(const char* key, const char* value, void* user_data) {
+    cJSON* item = cJSON_CreateString(value);
+    if (item == NULL) {
+        LOG_ERROR_0("Create new json string failed");
+        return -1;
+    }
+    cJSON_AddItemToArray(static_cast<cJSON*>(user_data), item);
+    return 0;
+}
+
 config_value_t* etcd_get_prefix(void* handle, char *key) {
     std::string str_key = key;
     config_value_t* values;
     EtcdClient *cli = static_cast<EtcdClient *>(handle);
-    std::vector<std::string> vec = cli->get_prefix(str_key);
-
-    if(!vec.size()){
-        LOG_ERROR("Key not found %s",key);
-        return NULL;
-    }
 
     cJSON* all_values = cJSON_CreateArray();
     if(all_values == NULL){
@@ -101,8 +108,15 @@ config_value_t* etcd_get_prefix(void* handle, char *key) {
         return NULL;
     }
 
-    for(size_t i = 0; i < vec.size(); i++){
-        cJSON_AddItemToArray(all_values, cJSON_CreateString(vec[i].c_str()));
+    // Values go straight into the array, a page of keys at a time
+    int count = cli->get_prefix_kv(str_key, etcd_get_prefix_append, all_values);
+    if (count <= 0 || cJSON_GetArraySize(all_values) != count) {
+        LOG_ERROR("Key not found %s",key);
+        if (count == 0) {
+            kv_store_set_status(KV_STORE_NOT_FOUND);
+        }
+        cJSON_Delete(all_values);
+        return NULL;
     }
 
     values = config_value_new_array(
@@ -116,6 +130,56 @@ config_value_t* etcd_get_prefix(void* handle, char *key) {
     return values;
 }
 
+int etcd_get_prefix_kv(void* handle, char *key, kv_store_get_kv_callback_t user_cb, void* user_data) {
+    std::string str_key = key;
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    return cli->get_prefix_kv(str_key, user_cb, user_data);
+}
+
+config_t* etcd_get_batch(void* handle, char **keys, const bool* prefixes, size_t count) {
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    std::vector<std::string> str_keys(keys, keys + count);
+    std::vector<bool> str_prefixes(prefixes, prefixes + count);
+    std::vector<std::pair<std::string, std::string>> kvs;
+    config_t* values = NULL;
+
+    if (cli->get_batch(str_keys, str_prefixes, kvs) != 0) {
+        return NULL;
+    }
+
+    cJSON* all_values = cJSON_CreateObject();
+    if (all_values == NULL) {
+        LOG_ERROR_0("Create new json object failed");
+        return NULL;
+    }
+
+    // Keys read by more than one overlapping prefix are added once
+    std::unordered_set<std::string> seen;
+    seen.reserve(kvs.size());
+    for (size_t i = 0; i < kvs.size(); i++) {
+        if (!seen.insert(kvs[i].first).second) {
+            continue;
+        }
+        cJSON* value = cJSON_CreateString(kvs[i].second.c_str());
+        if (value == NULL) {
+            LOG_ERROR_0("Create new json string failed");
+            cJSON_Delete(all_values);
+            return NULL;
+        }
+        cJSON_AddItemToObject(all_values, kvs[i].first.c_str(), value);
+    }
+
+    values = config_new(
+        (void*) all_values, free_json, get_config_value, set_config_value);
+    if (values == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for etcd batch");
+        cJSON_Delete(all_values);
+        return NULL;
+    }
+
+    return values;
+}
+
 int etcd_put(void* handle, char *key, char *value){
     std::string str_key = key;
     std::string str_value = value;
@@ -136,10 +200,38 @@ void etcd_watch_prefix(void* handle, char *key, kv_store_watch_callback_t user_c
     cli->watch_prefix(str_key, user_cb, user_data);
 }
 
+int etcd_watch_prefix_kv(void* handle, char *key, kv_store_watch_kv_callback_t user_cb, void* user_data) {
+    std::string str_key = key;
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    return cli->watch_prefix_kv(str_key, user_cb, user_data);
+}
+
+int etcd_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    return cli->lease_grant(ttl, lease_id);
+}
+
+int etcd_put_with_lease(void* handle, char *key, char *value, int64_t lease_id) {
+    std::string str_key = key;
+    std::string str_value = value;
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    return cli->put(str_key, str_value, lease_id);
+}
+
+int etcd_keepalive(void* handle, int64_t lease_id) {
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    return cli->lease_keepalive(lease_id);
+}
+
+int etcd_revoke_lease(void* handle, int64_t lease_id) {
+    EtcdClient *cli = static_cast<EtcdClient *>(handle);
+    return cli->lease_revoke(lease_id);
+}
+
 void etcd_client_free(void* handle){
     if (handle != NULL) {
         EtcdClient *cli = static_cast<EtcdClient *>(handle);
-        cli->~EtcdClient();
+        delete cli;
     }
 }
 
@@ -0,0 +1,503 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store read-through snapshot implementation
+ */
+
+#include <string.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/json_config.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_batch.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+
+// Values of a prefix read with get_prefix(), an empty array if nothing
+// was found
+typedef struct {
+    char* prefix;
+    cJSON* values;
+} kv_batch_prefix_t;
+
+typedef struct {
+    kv_store_client_t* inner;
+    void* inner_handle;
+
+    // Queued keys and prefixes, the first fetched of them have been read
+    char** keys;
+    bool* prefixes;
+    size_t count;
+    size_t cap;
+    size_t fetched;
+
+    // Values read so far, with a NULL value for a key known to be absent
+    kv_table_t values;
+
+    // Prefixes read with get_prefix() outside of a batch, sorted by prefix
+    kv_batch_prefix_t* prefix_values;
+    size_t prefix_count;
+    size_t prefix_cap;
+} kv_batch_ctx_t;
+
+static bool kv_batch_has_prefix(const char* key, const char* prefix) {
+    return strncmp(key, prefix, strlen(prefix)) == 0;
+}
+
+// Whether a key or a prefix was read with a batch
+static bool kv_batch_covered(kv_batch_ctx_t* ctx, size_t count, const char* key, bool prefix) {
+    for (size_t i = 0; i < count; i++) {
+        if (ctx->prefixes[i]) {
+            if (kv_batch_has_prefix(key, ctx->keys[i])) {
+                return true;
+            }
+        } else if (!prefix && strcmp(ctx->keys[i], key) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Index of the first prefix read with get_prefix() not less than @p prefix
+static size_t kv_batch_prefix_lower_bound(kv_batch_ctx_t* ctx, const char* prefix) {
+    size_t lo = 0;
+    size_t hi = ctx->prefix_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(ctx->prefix_values[mid].prefix, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Keeps the values of a prefix read with get_prefix(), taking ownership of
+// @p values
+static void kv_batch_prefix_insert(kv_batch_ctx_t* ctx, size_t pos, const char* prefix,
+                                   cJSON* values) {
+    if (ctx->prefix_count == ctx->prefix_cap) {
+        size_t cap = (ctx->prefix_cap == 0) ? 8 : ctx->prefix_cap * 2;
+        kv_batch_prefix_t* grown = (kv_batch_prefix_t*) realloc(
+                ctx->prefix_values, cap * sizeof(kv_batch_prefix_t));
+        if (grown == NULL) {
+            LOG_ERROR_0("Failed to grow prefix values");
+            cJSON_Delete(values);
+            return;
+        }
+        ctx->prefix_values = grown;
+        ctx->prefix_cap = cap;
+    }
+    char* copy = strdup(prefix);
+    if (copy == NULL) {
+        LOG_ERROR_0("Failed to copy prefix");
+        cJSON_Delete(values);
+        return;
+    }
+    memmove(&ctx->prefix_values[pos + 1], &ctx->prefix_values[pos],
+            (ctx->prefix_count - pos) * sizeof(kv_batch_prefix_t));
+    ctx->prefix_values[pos].prefix = copy;
+    ctx->prefix_values[pos].values = values;
+    ctx->prefix_count++;
+}
+
+// Merges the values read by a batch into the values read so far, both
+// sorted by key; values read by the batch win. @p fetched is left empty.
+static int kv_batch_merge(kv_table_t* values, kv_table_t* fetched) {
+    kv_table_t merged = { NULL, 0, 0 };
+    size_t cap = values->count + fetched->count;
+    if (cap == 0) {
+        return 0;
+    }
+    merged.items = (kv_table_entry_t*) malloc(cap * sizeof(kv_table_entry_t));
+    if (merged.items == NULL) {
+        LOG_ERROR_0("Failed to merge batch values");
+        return -1;
+    }
+    merged.cap = cap;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < values->count || j < fetched->count) {
+        int cmp = (i == values->count) ? 1 : (j == fetched->count) ? -1 :
+                  strcmp(values->items[i].key, fetched->items[j].key);
+        if (cmp < 0) {
+            merged.items[merged.count++] = values->items[i++];
+            continue;
+        }
+        if (cmp == 0) {
+            free(values->items[i].key);
+            free(values->items[i].value);
+            i++;
+        }
+        merged.items[merged.count++] = fetched->items[j++];
+    }
+    // Entries moved to merged, only the arrays are left to free
+    free(values->items);
+    free(fetched->items);
+    *values = merged;
+    fetched->items = NULL;
+    fetched->count = 0;
+    fetched->cap = 0;
+    return 0;
+}
+
+// Hands out a copy of an array of values, NULL if it is empty, as the
+// kv_store does when no key has the prefix. Like the kv_store's arrays, the
+// copy has no free function: config_set() hands it to the target object.
+static config_value_t* kv_batch_new_array(const cJSON* array) {
+    if (array == NULL || cJSON_GetArraySize(array) == 0) {
+        return NULL;
+    }
+    cJSON* copy = cJSON_Duplicate(array, true);
+    if (copy == NULL) {
+        LOG_ERROR_0("Failed to copy prefix values");
+        return NULL;
+    }
+    config_value_t* values = config_value_new_array(
+            (void*) copy, cJSON_GetArraySize(copy), get_array_item, NULL);
+    if (values == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for prefix values");
+        cJSON_Delete(copy);
+    }
+    return values;
+}
+
+static void* kv_batch_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    return client->handler;
+}
+
+static char* kv_batch_get(void* handle, char* key) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    kv_table_entry_t* entry = kv_table_find(&ctx->values, key);
+    if (entry != NULL) {
+        return (entry->value != NULL) ? strdup(entry->value) : NULL;
+    }
+    if (kv_batch_covered(ctx, ctx->fetched, key, false)) {
+        LOG_DEBUG("Value is not found in the batch for the key %s", key);
+        return NULL;
+    }
+    kv_store_set_status(KV_STORE_OK);
+    char* value = ctx->inner->get(ctx->inner_handle, key);
+    // Failed reads are tried again, only keys known to be absent are kept
+    if ((value != NULL || kv_store_last_status() == KV_STORE_NOT_FOUND) &&
+            kv_table_set(&ctx->values, key, value) < 0) {
+        LOG_ERROR("Failed to keep the value of %s", key);
+    }
+    return value;
+}
+
+static config_value_t* kv_batch_get_prefix(void* handle, char* key) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    config_value_t* values = NULL;
+
+    if (kv_batch_covered(ctx, ctx->fetched, key, true)) {
+        cJSON* array = cJSON_CreateArray();
+        if (array == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for prefix values");
+            return NULL;
+        }
+        // Keys of the prefix are contiguous and sorted, as from get_prefix()
+        for (size_t i = kv_table_lower_bound(&ctx->values, key);
+                i < ctx->values.count && kv_batch_has_prefix(ctx->values.items[i].key, key); i++) {
+            if (ctx->values.items[i].value != NULL) {
+                cJSON_AddItemToArray(array, cJSON_CreateString(ctx->values.items[i].value));
+            }
+        }
+        values = kv_batch_new_array(array);
+        cJSON_Delete(array);
+        return values;
+    }
+
+    size_t pos = kv_batch_prefix_lower_bound(ctx, key);
+    if (pos < ctx->prefix_count && strcmp(ctx->prefix_values[pos].prefix, key) == 0) {
+        return kv_batch_new_array(ctx->prefix_values[pos].values);
+    }
+
+    kv_store_set_status(KV_STORE_OK);
+    values = ctx->inner->get_prefix(ctx->inner_handle, key);
+    cJSON* array = cJSON_CreateArray();
+    if (array == NULL) {
+        return values;
+    }
+    if (values != NULL && values->type == CVT_ARRAY) {
+        size_t len = config_value_array_len(values);
+        for (size_t i = 0; i < len; i++) {
+            config_value_t* item = config_value_array_get(values, (int) i);
+            if (item == NULL) {
+                continue;
+            }
+            if (item->type == CVT_STRING) {
+                cJSON_AddItemToArray(array, cJSON_CreateString(item->body.string));
+            }
+            config_value_destroy(item);
+        }
+    }
+    // Failed reads are tried again
+    if (values != NULL || kv_store_last_status() == KV_STORE_NOT_FOUND) {
+        kv_batch_prefix_insert(ctx, pos, key, array);
+    } else {
+        cJSON_Delete(array);
+    }
+    return values;
+}
+
+// Writes, watches and leases go to the underlying client and are not
+// reflected in the snapshot
+
+static int kv_batch_put(void* handle, char* key, char* value) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->put(ctx->inner_handle, key, value);
+}
+
+static config_t* kv_batch_get_batch(void* handle, char** keys, const bool* prefixes, size_t count) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->get_batch(ctx->inner_handle, keys, prefixes, count);
+}
+
+static void kv_batch_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    ctx->inner->watch(ctx->inner_handle, key, cb, user_data);
+}
+
+static void kv_batch_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    ctx->inner->watch_prefix(ctx->inner_handle, key, cb, user_data);
+}
+
+static int kv_batch_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                    void* user_data) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->watch_prefix_kv(ctx->inner_handle, key, cb, user_data);
+}
+
+static int kv_batch_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->grant_lease(ctx->inner_handle, ttl, lease_id);
+}
+
+static int kv_batch_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->put_with_lease(ctx->inner_handle, key, value, lease_id);
+}
+
+static int kv_batch_keepalive(void* handle, int64_t lease_id) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->keepalive(ctx->inner_handle, lease_id);
+}
+
+static int kv_batch_revoke_lease(void* handle, int64_t lease_id) {
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) handle;
+    return ctx->inner->revoke_lease(ctx->inner_handle, lease_id);
+}
+
+static void kv_batch_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    // The underlying client is borrowed and left untouched
+    for (size_t i = 0; i < ctx->count; i++) {
+        free(ctx->keys[i]);
+    }
+    free(ctx->keys);
+    free(ctx->prefixes);
+    kv_table_clear(&ctx->values);
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        free(ctx->prefix_values[i].prefix);
+        cJSON_Delete(ctx->prefix_values[i].values);
+    }
+    free(ctx->prefix_values);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+kv_store_client_t* kv_store_batch_new(kv_store_client_t* inner, void* inner_handle) {
+    kv_store_client_t* client = NULL;
+    kv_batch_ctx_t* ctx = NULL;
+
+    if (inner == NULL || inner_handle == NULL) {
+        LOG_ERROR_0("kv_store_client to snapshot is not initialized");
+        return NULL;
+    }
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (kv_batch_ctx_t*) calloc(1, sizeof(kv_batch_ctx_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Batch context: Failed to allocate Memory");
+        goto err;
+    }
+    ctx->inner = inner;
+    ctx->inner_handle = inner_handle;
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_batch_init;
+    client->get = kv_batch_get;
+    client->get_prefix = kv_batch_get_prefix;
+    // Prefixes go through get_prefix() so they are kept in the snapshot
+    client->get_prefix_kv = NULL;
+    client->get_batch = (inner->get_batch != NULL) ? kv_batch_get_batch : NULL;
+    client->put = kv_batch_put;
+    client->watch = kv_batch_watch;
+    client->watch_prefix = kv_batch_watch_prefix;
+    client->watch_prefix_kv = (inner->watch_prefix_kv != NULL) ? kv_batch_watch_prefix_kv : NULL;
+    client->grant_lease = kv_batch_grant_lease;
+    client->put_with_lease = kv_batch_put_with_lease;
+    client->keepalive = kv_batch_keepalive;
+    client->revoke_lease = kv_batch_revoke_lease;
+    client->deinit = kv_batch_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
+
+int kv_store_batch_add(kv_store_client_t* batch, const char* key, bool prefix) {
+    if (batch == NULL || batch->init != kv_batch_init || key == NULL) {
+        LOG_ERROR_0("kv_store_client is not a batch");
+        return -1;
+    }
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) batch->handler;
+    for (size_t i = 0; i < ctx->count; i++) {
+        if (ctx->prefixes[i] == prefix && strcmp(ctx->keys[i], key) == 0) {
+            return 0;
+        }
+    }
+    if (ctx->count == ctx->cap) {
+        size_t cap = (ctx->cap == 0) ? 16 : ctx->cap * 2;
+        char** keys = (char**) realloc(ctx->keys, cap * sizeof(char*));
+        if (keys == NULL) {
+            LOG_ERROR_0("Failed to grow batch keys");
+            return -1;
+        }
+        ctx->keys = keys;
+        bool* prefixes = (bool*) realloc(ctx->prefixes, cap * sizeof(bool));
+        if (prefixes == NULL) {
+            LOG_ERROR_0("Failed to grow batch keys");
+            return -1;
+        }
+        ctx->prefixes = prefixes;
+        ctx->cap = cap;
+    }
+    char* copy = strdup(key);
+    if (copy == NULL) {
+        LOG_ERROR_0("Failed to copy batch key");
+        return -1;
+    }
+    ctx->keys[ctx->count] = copy;
+    ctx->prefixes[ctx->count] = prefix;
+    ctx->count++;
+    return 0;
+}
+
+int kv_store_batch_fetch(kv_store_client_t* batch) {
+    int ret = -1;
+    char** keys = NULL;
+    bool* prefixes = NULL;
+    config_t* result = NULL;
+    kv_table_t fetched = { NULL, 0, 0 };
+
+    if (batch == NULL || batch->init != kv_batch_init) {
+        LOG_ERROR_0("kv_store_client is not a batch");
+        return -1;
+    }
+    kv_batch_ctx_t* ctx = (kv_batch_ctx_t*) batch->handler;
+    if (ctx->fetched == ctx->count) {
+        return 0;
+    }
+    if (ctx->inner->get_batch == NULL) {
+        LOG_DEBUG_0("kv_store_client has no get_batch(), keys are read on first use");
+        return -1;
+    }
+
+    size_t pending = ctx->count - ctx->fetched;
+    keys = (char**) malloc(pending * sizeof(char*));
+    prefixes = (bool*) malloc(pending * sizeof(bool));
+    if (keys == NULL || prefixes == NULL) {
+        LOG_ERROR_0("Failed to allocate batch keys");
+        goto err;
+    }
+
+    // Drop keys and prefixes covered by another queued prefix, every key
+    // is then read by exactly one range
+    size_t n = 0;
+    for (size_t i = ctx->fetched; i < ctx->count; i++) {
+        bool covered = false;
+        for (size_t j = 0; j < ctx->count && !covered; j++) {
+            covered = j != i && ctx->prefixes[j] &&
+                      kv_batch_has_prefix(ctx->keys[i], ctx->keys[j]);
+        }
+        if (!covered) {
+            keys[n] = ctx->keys[i];
+            prefixes[n] = ctx->prefixes[i];
+            n++;
+        }
+    }
+
+    LOG_DEBUG("Reading %zu keys and prefixes of %zu queued in one batch", n, pending);
+    result = ctx->inner->get_batch(ctx->inner_handle, keys, prefixes, n);
+    if (result == NULL) {
+        LOG_ERROR_0("Batch read failed, keys are read on first use");
+        goto err;
+    }
+
+    // Sorted, then merged with the values read so far
+    cJSON* item = NULL;
+    cJSON_ArrayForEach(item, (cJSON*) result->cfg) {
+        if (!cJSON_IsString(item)) {
+            continue;
+        }
+        char* key = strdup(item->string);
+        char* value = strdup(item->valuestring);
+        if (key == NULL || value == NULL ||
+                kv_table_insert(&fetched, fetched.count, key, value) != 0) {
+            LOG_ERROR_0("Failed to copy batch value");
+            free(key);
+            free(value);
+            goto err;
+        }
+    }
+    kv_table_sort(&fetched);
+    if (kv_batch_merge(&ctx->values, &fetched) != 0) {
+        goto err;
+    }
+    ctx->fetched = ctx->count;
+    ret = 0;
+
+err:
+    kv_table_clear(&fetched);
+    if (result != NULL) {
+        config_destroy(result);
+    }
+    free(keys);
+    free(prefixes);
+    return ret;
+}
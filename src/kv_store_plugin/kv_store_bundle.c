@@ -0,0 +1,222 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief KV Store client over a fixed set of keys implementation
+ */
+
+#include <string.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/json_config.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_bundle.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+
+typedef struct {
+    // Keys and their values, sorted by key
+    kv_table_t table;
+} kv_bundle_ctx_t;
+
+static void* kv_bundle_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    return client->handler;
+}
+
+static char* kv_bundle_get(void* handle, char* key) {
+    kv_bundle_ctx_t* ctx = (kv_bundle_ctx_t*) handle;
+    kv_table_entry_t* entry = kv_table_find(&ctx->table, key);
+    if (entry == NULL) {
+        LOG_DEBUG("Value is not found in the bundle for the key %s", key);
+        return NULL;
+    }
+    char* value = strdup(entry->value);
+    if (value == NULL) {
+        LOG_ERROR_0("Failed to copy bundle value");
+    }
+    return value;
+}
+
+static int kv_bundle_get_prefix_kv(void* handle, char* key, kv_store_get_kv_callback_t cb,
+                                   void* user_data) {
+    kv_bundle_ctx_t* ctx = (kv_bundle_ctx_t*) handle;
+    size_t len = strlen(key);
+    int count = 0;
+    for (size_t i = kv_table_lower_bound(&ctx->table, key); i < ctx->table.count; i++) {
+        const kv_table_entry_t* entry = &ctx->table.items[i];
+        if (strncmp(entry->key, key, len) != 0) {
+            break;
+        }
+        count++;
+        if (cb(entry->key, entry->value, user_data) != 0) {
+            break;
+        }
+    }
+    return count;
+}
+
+static int kv_bundle_append(const char* key, const char* value, void* user_data) {
+    cJSON* item = cJSON_CreateString(value);
+    if (item == NULL) {
+        return -1;
+    }
+    cJSON_AddItemToArray((cJSON*) user_data, item);
+    return 0;
+}
+
+// Like the kv_store's arrays, the array has no free function: config_set()
+// hands it to the target object
+static config_value_t* kv_bundle_get_prefix(void* handle, char* key) {
+    cJSON* array = cJSON_CreateArray();
+    if (array == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for prefix values");
+        return NULL;
+    }
+    int count = kv_bundle_get_prefix_kv(handle, key, kv_bundle_append, array);
+    if (count != cJSON_GetArraySize(array)) {
+        LOG_ERROR_0("Failed to allocate memory for prefix values");
+        cJSON_Delete(array);
+        return NULL;
+    }
+    // NULL for prefixes without any key, as the kv_store does
+    if (count == 0) {
+        cJSON_Delete(array);
+        return NULL;
+    }
+    config_value_t* values = config_value_new_array(
+            (void*) array, (size_t) count, get_array_item, NULL);
+    if (values == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for prefix values");
+        cJSON_Delete(array);
+    }
+    return values;
+}
+
+// The keys never change, so watches are accepted and never notified, and
+// writes and leases are refused
+
+static int kv_bundle_put(void* handle, char* key, char* value) {
+    LOG_ERROR("Bundle is read-only, can't put %s", key);
+    return -1;
+}
+
+static void kv_bundle_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    LOG_DEBUG("Bundle keys never change, not watching %s", key);
+}
+
+static int kv_bundle_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    LOG_ERROR_0("Bundle is read-only, can't grant leases");
+    return -1;
+}
+
+static int kv_bundle_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    LOG_ERROR("Bundle is read-only, can't put %s", key);
+    return -1;
+}
+
+static int kv_bundle_keepalive(void* handle, int64_t lease_id) {
+    LOG_ERROR_0("Bundle is read-only, has no leases");
+    return -1;
+}
+
+static int kv_bundle_revoke_lease(void* handle, int64_t lease_id) {
+    LOG_ERROR_0("Bundle is read-only, has no leases");
+    return -1;
+}
+
+static void kv_bundle_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_bundle_ctx_t* ctx = (kv_bundle_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    kv_table_clear(&ctx->table);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+kv_store_client_t* kv_store_bundle_new(config_t* values) {
+    kv_store_client_t* client = NULL;
+    kv_bundle_ctx_t* ctx = NULL;
+
+    if (values == NULL || !cJSON_IsObject((cJSON*) values->cfg)) {
+        LOG_ERROR_0("Bundle keys are not an object");
+        goto err;
+    }
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (kv_bundle_ctx_t*) calloc(1, sizeof(kv_bundle_ctx_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Bundle context: Failed to allocate Memory");
+        goto err;
+    }
+    // Keys are appended as they come and sorted once
+    cJSON* item = NULL;
+    cJSON_ArrayForEach(item, (cJSON*) values->cfg) {
+        if (!cJSON_IsString(item) || item->string == NULL) {
+            continue;
+        }
+        char* key = strdup(item->string);
+        char* value = strdup(item->valuestring);
+        if (key == NULL || value == NULL ||
+                kv_table_insert(&ctx->table, ctx->table.count, key, value) != 0) {
+            LOG_ERROR_0("Bundle context: Failed to allocate Memory");
+            free(key);
+            free(value);
+            goto err;
+        }
+    }
+    kv_table_sort(&ctx->table);
+    config_destroy(values);
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_bundle_init;
+    client->get = kv_bundle_get;
+    client->get_prefix = kv_bundle_get_prefix;
+    client->get_prefix_kv = kv_bundle_get_prefix_kv;
+    // Keys are in memory, batches would save nothing
+    client->get_batch = NULL;
+    client->put = kv_bundle_put;
+    client->watch = kv_bundle_watch;
+    client->watch_prefix = kv_bundle_watch;
+    client->watch_prefix_kv = NULL;
+    client->grant_lease = kv_bundle_grant_lease;
+    client->put_with_lease = kv_bundle_put_with_lease;
+    client->keepalive = kv_bundle_keepalive;
+    client->revoke_lease = kv_bundle_revoke_lease;
+    client->deinit = kv_bundle_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        kv_table_clear(&ctx->table);
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    if (values != NULL) {
+        config_destroy(values);
+    }
+    return NULL;
+}
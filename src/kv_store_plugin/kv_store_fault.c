@@ -0,0 +1,849 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store fault injection decorator implementation
+ */
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/json_config.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_fault.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+#include <eii/config_manager/cfgmgr_json.h>
+
+// Maximum length of a fault specification string
+#define KV_FAULT_MAX_SPEC_LEN   1024
+
+struct kv_fault_ctx;
+
+// Watch registration, routes events through the fault ctx to the
+// user callback. Every registration simulates its own watch stream
+typedef struct kv_fault_watch {
+    kv_store_watch_callback_t cb;
+    kv_store_watch_kv_callback_t kv_cb;
+    void* user_data;
+    struct kv_fault_ctx* ctx;
+    // Watched key or prefix, re-read when the stream resyncs
+    char* key;
+    bool prefix;
+    // Serializes deliveries, as one stream delivers one event at a time
+    pthread_mutex_t deliver_mtx;
+    // Stream state, protected by the ctx mutex
+    bool down;
+    uint64_t reconnect_at_ns;
+    // Resync of the wrapped client in progress, under deliver_mtx, and
+    // whether it is dropped as it began while the stream was down
+    bool inner_resyncing;
+    bool inner_resync_dropped;
+    struct kv_fault_watch* next;
+} kv_fault_watch_t;
+
+typedef struct kv_fault_ctx {
+    kv_store_client_t* inner;
+    void* inner_handle;
+    pthread_mutex_t mtx;
+    kv_fault_config_t config;
+    kv_fault_watch_t* watches;
+    atomic_uint_fast64_t injected_errors[KV_OP_COUNT];
+    atomic_uint_fast64_t injected_delay_us[KV_OP_COUNT];
+    atomic_uint_fast64_t dropped_events;
+    atomic_uint_fast64_t stream_drops;
+    atomic_uint_fast64_t reconnects;
+    atomic_uint_fast64_t compactions;
+    // Reconnects dropped streams once their outage is over, started on
+    // the first stream drop
+    pthread_t reconnect_thread;
+    pthread_cond_t reconnect_cond;
+    bool reconnect_started;
+    bool stopping;
+    // Seed generation, bumped on every configuration change so that
+    // threads re-seed their generator
+    atomic_uint_fast64_t generation;
+} kv_fault_ctx_t;
+
+static atomic_uint_fast64_t kv_fault_thread_counter = 0;
+static _Thread_local uint64_t kv_fault_rng_state = 0;
+static _Thread_local uint64_t kv_fault_rng_generation = 0;
+
+// xorshift64* generator, one state per thread
+static uint64_t kv_fault_next(kv_fault_ctx_t* ctx, uint64_t seed) {
+    uint64_t generation = atomic_load_explicit(&ctx->generation, memory_order_relaxed);
+    if (kv_fault_rng_state == 0 || kv_fault_rng_generation != generation) {
+        uint64_t thread_idx = atomic_fetch_add_explicit(
+                &kv_fault_thread_counter, 1, memory_order_relaxed) + 1;
+        kv_fault_rng_state = (seed ^ (thread_idx * 0x9E3779B97F4A7C15ULL)) | 1;
+        kv_fault_rng_generation = generation;
+    }
+    uint64_t x = kv_fault_rng_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    kv_fault_rng_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform double in [0, 1)
+static double kv_fault_uniform(kv_fault_ctx_t* ctx, uint64_t seed) {
+    return (double) (kv_fault_next(ctx, seed) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void kv_fault_get_config(kv_fault_ctx_t* ctx, kv_fault_config_t* config) {
+    pthread_mutex_lock(&ctx->mtx);
+    *config = ctx->config;
+    pthread_mutex_unlock(&ctx->mtx);
+}
+
+// Sleeps for the injected latency of an operation
+static void kv_fault_delay(kv_fault_ctx_t* ctx, const kv_fault_config_t* config, kv_store_op_t op) {
+    const kv_fault_op_config_t* op_config = &config->ops[op];
+    uint64_t delay_us = 0;
+    switch (op_config->latency) {
+        case KV_FAULT_LATENCY_FIXED:
+            delay_us = op_config->min_us;
+            break;
+        case KV_FAULT_LATENCY_UNIFORM:
+            delay_us = op_config->min_us;
+            if (op_config->max_us > op_config->min_us) {
+                delay_us += (uint64_t) (kv_fault_uniform(ctx, config->seed) *
+                                        (double) (op_config->max_us - op_config->min_us));
+            }
+            break;
+        case KV_FAULT_LATENCY_EXPONENTIAL:
+            delay_us = op_config->min_us + (uint64_t) (-log(1.0 - kv_fault_uniform(ctx, config->seed)) *
+                                                       (double) op_config->max_us);
+            break;
+        default:
+            return;
+    }
+    if (delay_us == 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(&ctx->injected_delay_us[op], delay_us, memory_order_relaxed);
+    struct timespec ts;
+    ts.tv_sec = (time_t) (delay_us / 1000000);
+    ts.tv_nsec = (long) ((delay_us % 1000000) * 1000);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+}
+
+// Decides whether an operation fails, counting the injected error
+static bool kv_fault_error(kv_fault_ctx_t* ctx, const kv_fault_config_t* config, kv_store_op_t op) {
+    double rate = config->ops[op].error_rate;
+    if (rate <= 0 || kv_fault_uniform(ctx, config->seed) >= rate) {
+        return false;
+    }
+    atomic_fetch_add_explicit(&ctx->injected_errors[op], 1, memory_order_relaxed);
+    // Injected errors look like an unreachable kv_store
+    kv_store_set_status(KV_STORE_UNAVAILABLE);
+    return true;
+}
+
+static void* kv_fault_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) client->handler;
+    ctx->inner_handle = ctx->inner->init(ctx->inner);
+    if (ctx->inner_handle == NULL) {
+        LOG_ERROR_0("Failed to initialize decorated kv_store_client");
+        return NULL;
+    }
+    return ctx;
+}
+
+static char* kv_fault_get(void* handle, char* key) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+    kv_fault_delay(ctx, &config, KV_OP_GET);
+    if (kv_fault_error(ctx, &config, KV_OP_GET)) {
+        LOG_DEBUG("Injected get() failure for the key %s", key);
+        return NULL;
+    }
+    return ctx->inner->get(ctx->inner_handle, key);
+}
+
+static config_value_t* kv_fault_get_prefix(void* handle, char* key) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+    kv_fault_delay(ctx, &config, KV_OP_GET_PREFIX);
+    if (kv_fault_error(ctx, &config, KV_OP_GET_PREFIX)) {
+        LOG_DEBUG("Injected get_prefix() failure for the prefix %s", key);
+        return NULL;
+    }
+    return ctx->inner->get_prefix(ctx->inner_handle, key);
+}
+
+static int kv_fault_get_prefix_kv(void* handle, char* key, kv_store_get_kv_callback_t cb,
+                                  void* user_data) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+    kv_fault_delay(ctx, &config, KV_OP_GET_PREFIX);
+    if (kv_fault_error(ctx, &config, KV_OP_GET_PREFIX)) {
+        LOG_DEBUG("Injected get_prefix_kv() failure for the prefix %s", key);
+        return -1;
+    }
+    return ctx->inner->get_prefix_kv(ctx->inner_handle, key, cb, user_data);
+}
+
+static config_t* kv_fault_get_batch(void* handle, char** keys, const bool* prefixes, size_t count) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+    kv_fault_delay(ctx, &config, KV_OP_GET_BATCH);
+    if (kv_fault_error(ctx, &config, KV_OP_GET_BATCH)) {
+        LOG_DEBUG("Injected get_batch() failure for %zu keys", count);
+        return NULL;
+    }
+    return ctx->inner->get_batch(ctx->inner_handle, keys, prefixes, count);
+}
+
+static int kv_fault_put(void* handle, char* key, char* value) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+    kv_fault_delay(ctx, &config, KV_OP_PUT);
+    if (kv_fault_error(ctx, &config, KV_OP_PUT)) {
+        LOG_DEBUG("Injected put() failure for the key %s", key);
+        return -1;
+    }
+    return ctx->inner->put(ctx->inner_handle, key, value);
+}
+
+static int kv_fault_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+    kv_fault_delay(ctx, &config, KV_OP_PUT);
+    if (kv_fault_error(ctx, &config, KV_OP_PUT)) {
+        LOG_DEBUG("Injected put_with_lease() failure for the key %s", key);
+        return -1;
+    }
+    return ctx->inner->put_with_lease(ctx->inner_handle, key, value, lease_id);
+}
+
+// Builds the watch value of a key the same way the etcd backend does,
+// non JSON values are wrapped as {key: value}
+static config_t* kv_fault_value_to_config(const char* key, const char* value) {
+    cJSON* json = NULL;
+    if (value[0] != '{') {
+        json = cJSON_CreateObject();
+        if (json == NULL) {
+            return NULL;
+        }
+        cJSON_AddStringToObject(json, key, value);
+    } else {
+        json = cfgmgr_json_parse(value, strlen(value));
+        if (json == NULL) {
+            return NULL;
+        }
+    }
+    config_t* config = config_new((void*) json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        cJSON_Delete(json);
+    }
+    return config;
+}
+
+static uint64_t kv_fault_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int kv_fault_resync_cb(const char* key, const char* value, void* cb_user_data) {
+    kv_fault_watch_t* watch = (kv_fault_watch_t*) cb_user_data;
+    // get_prefix() fallback does not return keys
+    const char* event_key = (key != NULL) ? key : watch->key;
+    config_t* config = kv_fault_value_to_config(event_key, value);
+    if (config == NULL) {
+        LOG_ERROR("Failed to build resynced value of the key %s", event_key);
+        return 0;
+    }
+    watch->cb(event_key, config, watch->user_data);
+    return 0;
+}
+
+static int kv_fault_resync_collect(const char* key, const char* value, void* cb_user_data) {
+    return (kv_table_set((kv_table_t*) cb_user_data, key, value) < 0) ? -1 : 0;
+}
+
+// Re-reads the watched key or prefix and delivers its current values, as
+// etcd clients do when a watch can not resume from its last revision.
+// Raw watches get them between the resync markers of watch_prefix_kv(),
+// other watches as puts carrying the keys as given to the kv_store_client,
+// keys deleted meanwhile are not notified. Called with deliver_mtx held
+static void kv_fault_resync(kv_fault_watch_t* watch) {
+    kv_fault_ctx_t* ctx = watch->ctx;
+    if (watch->kv_cb != NULL) {
+        // Keys are read first, a failed read must not end the resync
+        kv_table_t keys = {NULL, 0, 0};
+        if (ctx->inner->get_prefix_kv == NULL ||
+            ctx->inner->get_prefix_kv(ctx->inner_handle, watch->key,
+                                      kv_fault_resync_collect, &keys) < 0) {
+            LOG_ERROR("Failed to resync the watched prefix %s", watch->key);
+            kv_table_clear(&keys);
+            return;
+        }
+        watch->kv_cb(NULL, watch->key, watch->user_data);
+        for (size_t i = 0; i < keys.count; i++) {
+            watch->kv_cb(keys.items[i].key, keys.items[i].value, watch->user_data);
+        }
+        watch->kv_cb(NULL, NULL, watch->user_data);
+        kv_table_clear(&keys);
+        return;
+    }
+    if (watch->prefix) {
+        if (kv_store_get_prefix_each(ctx->inner, ctx->inner_handle, watch->key,
+                                     kv_fault_resync_cb, watch) < 0) {
+            LOG_ERROR("Failed to resync the watched prefix %s", watch->key);
+        }
+        return;
+    }
+    char* value = ctx->inner->get(ctx->inner_handle, watch->key);
+    if (value == NULL || strlen(value) == 0) {
+        LOG_DEBUG("Key %s removed while the watch was down, nothing to resync", watch->key);
+        free(value);
+        return;
+    }
+    kv_fault_resync_cb(watch->key, value, watch);
+    free(value);
+}
+
+// Breaks the watch stream, events are lost until it reconnects
+static void kv_fault_drop_stream(kv_fault_watch_t* watch, const kv_fault_config_t* config);
+
+// Decides the fate of an event on the stream of @p watch, called with
+// deliver_mtx held. Returns true if the event is to be delivered
+static bool kv_fault_event(kv_fault_watch_t* watch, const char* key) {
+    kv_fault_ctx_t* ctx = watch->ctx;
+    kv_fault_config_t config;
+    kv_fault_get_config(ctx, &config);
+
+    pthread_mutex_lock(&ctx->mtx);
+    bool down = watch->down;
+    pthread_mutex_unlock(&ctx->mtx);
+    if (down) {
+        LOG_DEBUG("Watch of %s is down, lost the event of the key %s", watch->key, key);
+        atomic_fetch_add_explicit(&ctx->dropped_events, 1, memory_order_relaxed);
+        return false;
+    }
+
+    kv_fault_delay(ctx, &config, KV_OP_WATCH_EVENT);
+    if (config.watch_compact_rate > 0 &&
+            kv_fault_uniform(ctx, config.seed) < config.watch_compact_rate) {
+        LOG_DEBUG("Injected compaction on the watch event of the key %s", key);
+        atomic_fetch_add_explicit(&ctx->compactions, 1, memory_order_relaxed);
+        kv_fault_resync(watch);
+        return false;
+    }
+    if (kv_fault_error(ctx, &config, KV_OP_WATCH_EVENT)) {
+        LOG_DEBUG("Injected drop of the watch stream of %s", watch->key);
+        atomic_fetch_add_explicit(&ctx->dropped_events, 1, memory_order_relaxed);
+        kv_fault_drop_stream(watch, &config);
+        return false;
+    }
+    return true;
+}
+
+static void kv_fault_watch_cb(const char* key, config_t* value, void* cb_user_data) {
+    kv_fault_watch_t* watch = (kv_fault_watch_t*) cb_user_data;
+    pthread_mutex_lock(&watch->deliver_mtx);
+    if (kv_fault_event(watch, key)) {
+        watch->cb(key, value, watch->user_data);
+    } else {
+        config_destroy(value);
+    }
+    pthread_mutex_unlock(&watch->deliver_mtx);
+}
+
+static void kv_fault_watch_kv_cb(const char* key, const char* value, void* cb_user_data) {
+    kv_fault_watch_t* watch = (kv_fault_watch_t*) cb_user_data;
+    kv_fault_ctx_t* ctx = watch->ctx;
+    pthread_mutex_lock(&watch->deliver_mtx);
+    if (key == NULL) {
+        // Resyncs of the wrapped client are passed on whole, without faults,
+        // or lost whole while the stream is down
+        if (value != NULL) {
+            pthread_mutex_lock(&ctx->mtx);
+            watch->inner_resync_dropped = watch->down;
+            pthread_mutex_unlock(&ctx->mtx);
+        }
+        watch->inner_resyncing = value != NULL;
+        if (!watch->inner_resync_dropped) {
+            watch->kv_cb(key, value, watch->user_data);
+        }
+    } else if (watch->inner_resyncing) {
+        if (!watch->inner_resync_dropped) {
+            watch->kv_cb(key, value, watch->user_data);
+        }
+    } else if (kv_fault_event(watch, key)) {
+        watch->kv_cb(key, value, watch->user_data);
+    }
+    pthread_mutex_unlock(&watch->deliver_mtx);
+}
+
+// Brings the stream of @p watch back up and resyncs it, unless it is up
+// already or, when @p due_ns is not 0, its outage lasts past @p due_ns
+static bool kv_fault_reconnect(kv_fault_watch_t* watch, uint64_t due_ns) {
+    kv_fault_ctx_t* ctx = watch->ctx;
+    bool reconnected = false;
+    pthread_mutex_lock(&watch->deliver_mtx);
+    pthread_mutex_lock(&ctx->mtx);
+    if (watch->down && (due_ns == 0 || watch->reconnect_at_ns <= due_ns)) {
+        watch->down = false;
+        reconnected = true;
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    if (reconnected) {
+        LOG_DEBUG("Watch of %s reconnected", watch->key);
+        atomic_fetch_add_explicit(&ctx->reconnects, 1, memory_order_relaxed);
+        kv_fault_resync(watch);
+    }
+    pthread_mutex_unlock(&watch->deliver_mtx);
+    return reconnected;
+}
+
+static void* kv_fault_reconnect_run(void* arg) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) arg;
+    pthread_mutex_lock(&ctx->mtx);
+    while (!ctx->stopping) {
+        uint64_t now_ns = kv_fault_now_ns();
+        uint64_t next_ns = UINT64_MAX;
+        kv_fault_watch_t* due = NULL;
+        for (kv_fault_watch_t* watch = ctx->watches; watch != NULL; watch = watch->next) {
+            if (!watch->down) {
+                continue;
+            }
+            if (watch->reconnect_at_ns <= now_ns) {
+                due = watch;
+                break;
+            }
+            if (watch->reconnect_at_ns < next_ns) {
+                next_ns = watch->reconnect_at_ns;
+            }
+        }
+        if (due != NULL) {
+            // deliver_mtx is taken before the ctx mutex
+            pthread_mutex_unlock(&ctx->mtx);
+            kv_fault_reconnect(due, now_ns);
+            pthread_mutex_lock(&ctx->mtx);
+        } else if (next_ns == UINT64_MAX) {
+            pthread_cond_wait(&ctx->reconnect_cond, &ctx->mtx);
+        } else {
+            struct timespec ts;
+            ts.tv_sec = (time_t) (next_ns / 1000000000ULL);
+            ts.tv_nsec = (long) (next_ns % 1000000000ULL);
+            pthread_cond_timedwait(&ctx->reconnect_cond, &ctx->mtx, &ts);
+        }
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    return NULL;
+}
+
+static void kv_fault_drop_stream(kv_fault_watch_t* watch, const kv_fault_config_t* config) {
+    kv_fault_ctx_t* ctx = watch->ctx;
+    atomic_fetch_add_explicit(&ctx->stream_drops, 1, memory_order_relaxed);
+    pthread_mutex_lock(&ctx->mtx);
+    watch->down = true;
+    watch->reconnect_at_ns = kv_fault_now_ns() + config->watch_reconnect_us * 1000;
+    if (!ctx->reconnect_started && !ctx->stopping) {
+        if (pthread_create(&ctx->reconnect_thread, NULL, kv_fault_reconnect_run, ctx) != 0) {
+            LOG_ERROR_0("Failed to start the watch reconnect thread");
+        } else {
+            ctx->reconnect_started = true;
+        }
+    }
+    pthread_cond_signal(&ctx->reconnect_cond);
+    pthread_mutex_unlock(&ctx->mtx);
+}
+
+static kv_fault_watch_t* kv_fault_add_watch(kv_fault_ctx_t* ctx, const char* key, bool prefix,
+                                            kv_store_watch_callback_t cb,
+                                            kv_store_watch_kv_callback_t kv_cb, void* user_data) {
+    kv_fault_watch_t* watch = (kv_fault_watch_t*) calloc(1, sizeof(kv_fault_watch_t));
+    if (watch == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for watch registration");
+        return NULL;
+    }
+    watch->key = strdup(key);
+    if (watch->key == NULL) {
+        LOG_ERROR_0("Failed to copy the watched key");
+        free(watch);
+        return NULL;
+    }
+    if (pthread_mutex_init(&watch->deliver_mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize watch delivery mutex");
+        free(watch->key);
+        free(watch);
+        return NULL;
+    }
+    watch->prefix = prefix;
+    watch->cb = cb;
+    watch->kv_cb = kv_cb;
+    watch->user_data = user_data;
+    watch->ctx = ctx;
+    pthread_mutex_lock(&ctx->mtx);
+    watch->next = ctx->watches;
+    ctx->watches = watch;
+    pthread_mutex_unlock(&ctx->mtx);
+    return watch;
+}
+
+static void kv_fault_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_watch_t* watch = kv_fault_add_watch(ctx, key, false, cb, NULL, user_data);
+    if (watch == NULL) {
+        return;
+    }
+    ctx->inner->watch(ctx->inner_handle, key, kv_fault_watch_cb, watch);
+}
+
+static void kv_fault_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_watch_t* watch = kv_fault_add_watch(ctx, key, true, cb, NULL, user_data);
+    if (watch == NULL) {
+        return;
+    }
+    ctx->inner->watch_prefix(ctx->inner_handle, key, kv_fault_watch_cb, watch);
+}
+
+static int kv_fault_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                    void* user_data) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    kv_fault_watch_t* watch = kv_fault_add_watch(ctx, key, true, NULL, cb, user_data);
+    if (watch == NULL) {
+        return -1;
+    }
+    return ctx->inner->watch_prefix_kv(ctx->inner_handle, key, kv_fault_watch_kv_cb, watch);
+}
+
+static int kv_fault_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    return ctx->inner->grant_lease(ctx->inner_handle, ttl, lease_id);
+}
+
+static int kv_fault_keepalive(void* handle, int64_t lease_id) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    return ctx->inner->keepalive(ctx->inner_handle, lease_id);
+}
+
+static int kv_fault_revoke_lease(void* handle, int64_t lease_id) {
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) handle;
+    return ctx->inner->revoke_lease(ctx->inner_handle, lease_id);
+}
+
+static void kv_fault_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    // Reconnects stop first, they read from the inner client
+    pthread_mutex_lock(&ctx->mtx);
+    ctx->stopping = true;
+    pthread_cond_signal(&ctx->reconnect_cond);
+    pthread_mutex_unlock(&ctx->mtx);
+    if (ctx->reconnect_started) {
+        pthread_join(ctx->reconnect_thread, NULL);
+    }
+    // Inner client is freed next, watch callbacks must not outlive
+    // the client, same as their user_data
+    kv_client_free(ctx->inner);
+    ctx->inner = NULL;
+    kv_fault_watch_t* watch = ctx->watches;
+    while (watch != NULL) {
+        kv_fault_watch_t* next = watch->next;
+        pthread_mutex_destroy(&watch->deliver_mtx);
+        free(watch->key);
+        free(watch);
+        watch = next;
+    }
+    ctx->watches = NULL;
+    pthread_cond_destroy(&ctx->reconnect_cond);
+    pthread_mutex_destroy(&ctx->mtx);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+kv_store_client_t* kv_store_fault_wrap(kv_store_client_t* inner, const kv_fault_config_t* config) {
+    kv_store_client_t* client = NULL;
+    kv_fault_ctx_t* ctx = NULL;
+
+    if (inner == NULL) {
+        LOG_ERROR_0("kv_store_client to decorate is NULL");
+        return NULL;
+    }
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (kv_fault_ctx_t*) calloc(1, sizeof(kv_fault_ctx_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Fault injection context: Failed to allocate Memory");
+        goto err;
+    }
+    if (pthread_mutex_init(&ctx->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize fault injection mutex");
+        goto err;
+    }
+    // Outages are timed with the monotonic clock
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    int rc = pthread_cond_init(&ctx->reconnect_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    if (rc != 0) {
+        LOG_ERROR_0("Failed to initialize watch reconnect condition");
+        pthread_mutex_destroy(&ctx->mtx);
+        goto err;
+    }
+    ctx->inner = inner;
+    if (config != NULL) {
+        ctx->config = *config;
+    }
+    if (ctx->config.seed == 0) {
+        ctx->config.seed = (uint64_t) time(NULL);
+    }
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_fault_init;
+    client->get = kv_fault_get;
+    client->get_prefix = kv_fault_get_prefix;
+    client->get_prefix_kv = (inner->get_prefix_kv != NULL) ? kv_fault_get_prefix_kv : NULL;
+    client->get_batch = (inner->get_batch != NULL) ? kv_fault_get_batch : NULL;
+    client->put = kv_fault_put;
+    client->watch = kv_fault_watch;
+    client->watch_prefix = kv_fault_watch_prefix;
+    client->watch_prefix_kv = (inner->watch_prefix_kv != NULL) ? kv_fault_watch_prefix_kv : NULL;
+    client->grant_lease = kv_fault_grant_lease;
+    client->put_with_lease = kv_fault_put_with_lease;
+    client->keepalive = kv_fault_keepalive;
+    client->revoke_lease = kv_fault_revoke_lease;
+    client->deinit = kv_fault_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
+
+int kv_store_fault_configure(kv_store_client_t* client, const kv_fault_config_t* config) {
+    if (client == NULL || client->init != kv_fault_init) {
+        LOG_ERROR_0("kv_store_client is not decorated with fault injection");
+        return -1;
+    }
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) client->handler;
+    pthread_mutex_lock(&ctx->mtx);
+    ctx->config = *config;
+    if (ctx->config.seed == 0) {
+        ctx->config.seed = (uint64_t) time(NULL);
+    }
+    atomic_fetch_add_explicit(&ctx->generation, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&ctx->mtx);
+    return 0;
+}
+
+int kv_store_fault_stats(kv_store_client_t* client, kv_fault_stats_t* stats) {
+    if (client == NULL || client->init != kv_fault_init) {
+        LOG_ERROR_0("kv_store_client is not decorated with fault injection");
+        return -1;
+    }
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) client->handler;
+    for (int op = 0; op < KV_OP_COUNT; op++) {
+        stats->injected_errors[op] = atomic_load_explicit(&ctx->injected_errors[op], memory_order_relaxed);
+        stats->injected_delay_us[op] = atomic_load_explicit(&ctx->injected_delay_us[op], memory_order_relaxed);
+    }
+    stats->dropped_events = atomic_load_explicit(&ctx->dropped_events, memory_order_relaxed);
+    stats->stream_drops = atomic_load_explicit(&ctx->stream_drops, memory_order_relaxed);
+    stats->reconnects = atomic_load_explicit(&ctx->reconnects, memory_order_relaxed);
+    stats->compactions = atomic_load_explicit(&ctx->compactions, memory_order_relaxed);
+    return 0;
+}
+
+int kv_store_fault_reconnect(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_fault_init) {
+        LOG_ERROR_0("kv_store_client is not decorated with fault injection");
+        return -1;
+    }
+    kv_fault_ctx_t* ctx = (kv_fault_ctx_t*) client->handler;
+    pthread_mutex_lock(&ctx->mtx);
+    kv_fault_watch_t* watch = ctx->watches;
+    pthread_mutex_unlock(&ctx->mtx);
+    // Registrations are only freed along with the client
+    int count = 0;
+    for (; watch != NULL; watch = watch->next) {
+        if (kv_fault_reconnect(watch, 0)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Parses an unsigned integer, rejecting trailing characters
+static bool kv_fault_parse_uint(const char* value, uint64_t* result) {
+    char* end = NULL;
+    if (value == NULL || value[0] == '\0' || value[0] == '-') {
+        return false;
+    }
+    errno = 0;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    *result = (uint64_t) parsed;
+    return true;
+}
+
+// Parses a probability, which must lie in [0, 1]
+static bool kv_fault_parse_rate(const char* value, double* result) {
+    char* end = NULL;
+    if (value[0] == '\0') {
+        return false;
+    }
+    errno = 0;
+    double parsed = strtod(value, &end);
+    if (errno != 0 || *end != '\0' || !(parsed >= 0.0 && parsed <= 1.0)) {
+        return false;
+    }
+    *result = parsed;
+    return true;
+}
+
+// Parses `fixed:<us>`, `uniform:<min>:<max>` or `exp:<min>:<mean>`
+static bool kv_fault_parse_latency(char* value, kv_fault_op_config_t* op_config) {
+    char* save = NULL;
+    char* dist = strtok_r(value, ":", &save);
+    char* first = strtok_r(NULL, ":", &save);
+    char* second = strtok_r(NULL, ":", &save);
+    if (dist == NULL || first == NULL) {
+        return false;
+    }
+    if (strtok_r(NULL, ":", &save) != NULL || !kv_fault_parse_uint(first, &op_config->min_us)) {
+        return false;
+    }
+    op_config->max_us = op_config->min_us;
+    if (second != NULL && !kv_fault_parse_uint(second, &op_config->max_us)) {
+        return false;
+    }
+    if (strcmp(dist, "fixed") == 0 && second == NULL) {
+        op_config->latency = KV_FAULT_LATENCY_FIXED;
+    } else if (strcmp(dist, "uniform") == 0 && second != NULL) {
+        op_config->latency = KV_FAULT_LATENCY_UNIFORM;
+    } else if (strcmp(dist, "exp") == 0 && second != NULL) {
+        op_config->latency = KV_FAULT_LATENCY_EXPONENTIAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int kv_store_fault_parse(const char* spec, kv_fault_config_t* config) {
+    char buf[KV_FAULT_MAX_SPEC_LEN];
+    char* entry_save = NULL;
+
+    memset(config, 0, sizeof(kv_fault_config_t));
+    if (spec == NULL || strlen(spec) >= KV_FAULT_MAX_SPEC_LEN) {
+        LOG_ERROR_0("Fault specification is NULL or too long");
+        return -1;
+    }
+    memcpy(buf, spec, strlen(spec) + 1);
+
+    for (char* entry = strtok_r(buf, ";", &entry_save); entry != NULL;
+            entry = strtok_r(NULL, ";", &entry_save)) {
+        if (strncmp(entry, "seed=", strlen("seed=")) == 0) {
+            if (!kv_fault_parse_uint(entry + strlen("seed="), &config->seed)) {
+                LOG_ERROR("Invalid fault seed: %s", entry);
+                return -1;
+            }
+            continue;
+        }
+        char* faults = strchr(entry, ':');
+        if (faults == NULL) {
+            LOG_ERROR("Invalid fault entry: %s", entry);
+            return -1;
+        }
+        *faults++ = '\0';
+        kv_store_op_t op;
+        if (strcmp(entry, "get") == 0) {
+            op = KV_OP_GET;
+        } else if (strcmp(entry, "get_prefix") == 0) {
+            op = KV_OP_GET_PREFIX;
+        } else if (strcmp(entry, "get_batch") == 0) {
+            op = KV_OP_GET_BATCH;
+        } else if (strcmp(entry, "put") == 0) {
+            op = KV_OP_PUT;
+        } else if (strcmp(entry, "watch") == 0) {
+            op = KV_OP_WATCH_EVENT;
+        } else {
+            LOG_ERROR("Unknown operation in fault specification: %s", entry);
+            return -1;
+        }
+
+        char* fault_save = NULL;
+        for (char* fault = strtok_r(faults, ",", &fault_save); fault != NULL;
+                fault = strtok_r(NULL, ",", &fault_save)) {
+            char* value = strchr(fault, '=');
+            if (value == NULL) {
+                LOG_ERROR("Invalid fault: %s", fault);
+                return -1;
+            }
+            *value++ = '\0';
+            if (strcmp(fault, "latency") == 0) {
+                if (!kv_fault_parse_latency(value, &config->ops[op])) {
+                    LOG_ERROR("Invalid latency distribution for %s", entry);
+                    return -1;
+                }
+            } else if ((strcmp(fault, "error") == 0 && op != KV_OP_WATCH_EVENT) ||
+                       (strcmp(fault, "drop") == 0 && op == KV_OP_WATCH_EVENT)) {
+                if (!kv_fault_parse_rate(value, &config->ops[op].error_rate)) {
+                    LOG_ERROR("Invalid %s rate for %s: %s", fault, entry, value);
+                    return -1;
+                }
+            } else if (strcmp(fault, "compact") == 0 && op == KV_OP_WATCH_EVENT) {
+                if (!kv_fault_parse_rate(value, &config->watch_compact_rate)) {
+                    LOG_ERROR("Invalid compact rate for %s: %s", entry, value);
+                    return -1;
+                }
+            } else if (strcmp(fault, "reconnect") == 0 && op == KV_OP_WATCH_EVENT) {
+                if (!kv_fault_parse_uint(value, &config->watch_reconnect_us)) {
+                    LOG_ERROR("Invalid reconnect delay for %s: %s", entry, value);
+                    return -1;
+                }
+            } else {
+                LOG_ERROR("Unknown fault %s for %s", fault, entry);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
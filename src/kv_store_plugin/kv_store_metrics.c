@@ -0,0 +1,606 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store metrics decorator implementation
+ */
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <cjson/cJSON.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_metrics.h>
+
+// Number of per-thread shards, threads are assigned shards round-robin
+#define KV_METRICS_SHARDS       8
+#define KV_METRICS_CACHE_LINE   64
+
+// Lowest power of two (in ns) exported as a Prometheus bucket, ~1us
+#define KV_METRICS_PROM_MIN_BITS    10
+
+// Size of the buffer used for one line of the Prometheus dump
+#define KV_METRICS_LINE_LEN     256
+
+typedef struct {
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t statuses[KV_STORE_STATUS_COUNT];
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t sum_ns;
+    atomic_uint_fast64_t max_ns;
+    atomic_uint_fast64_t buckets[KV_METRICS_BUCKETS];
+} kv_metrics_op_t;
+
+typedef struct {
+    _Alignas(KV_METRICS_CACHE_LINE) kv_metrics_op_t ops[KV_OP_COUNT];
+} kv_metrics_shard_t;
+
+struct kv_metrics_ctx;
+
+// Watch registration, routes events through the metrics ctx to the
+// user callback
+typedef struct kv_metrics_watch {
+    kv_store_watch_callback_t cb;
+    kv_store_watch_kv_callback_t kv_cb;
+    void* user_data;
+    struct kv_metrics_ctx* ctx;
+    struct kv_metrics_watch* next;
+} kv_metrics_watch_t;
+
+typedef struct kv_metrics_ctx {
+    kv_metrics_shard_t shards[KV_METRICS_SHARDS];
+    kv_store_client_t* inner;
+    void* inner_handle;
+    pthread_mutex_t watch_mtx;
+    kv_metrics_watch_t* watches;
+} kv_metrics_ctx_t;
+
+static const char* kv_metrics_op_names[KV_OP_COUNT] = {
+    "get", "get_prefix", "put", "watch_event", "get_batch"
+};
+
+static atomic_uint kv_metrics_next_shard = 0;
+static _Thread_local int kv_metrics_shard = -1;
+
+static inline uint64_t kv_metrics_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static inline int kv_metrics_bucket(uint64_t ns) {
+    if (ns < (1 << KV_METRICS_SUB_BITS)) {
+        return (int) ns;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    if (msb > KV_METRICS_MAX_BITS) {
+        return KV_METRICS_BUCKETS - 1;
+    }
+    int shift = msb - KV_METRICS_SUB_BITS;
+    return ((msb - KV_METRICS_SUB_BITS + 1) << KV_METRICS_SUB_BITS) +
+           (int) ((ns >> shift) & ((1 << KV_METRICS_SUB_BITS) - 1));
+}
+
+// Highest latency in ns falling into the given bucket
+static uint64_t kv_metrics_bucket_upper(int index) {
+    if (index < (1 << KV_METRICS_SUB_BITS)) {
+        return (uint64_t) index;
+    }
+    int group = index >> KV_METRICS_SUB_BITS;
+    uint64_t sub = (uint64_t) (index & ((1 << KV_METRICS_SUB_BITS) - 1));
+    int shift = group - 1;
+    uint64_t lower = ((1ULL << KV_METRICS_SUB_BITS) + sub) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+// Status of an operation as recorded by the inner client, @p failed tells
+// whether the operation returned a failure. Clients which don't record
+// statuses leave KV_STORE_OK, their NULL reads are missing keys
+static kv_store_status_t kv_metrics_status(bool failed, bool read) {
+    kv_store_status_t status = kv_store_last_status();
+    if (failed && status == KV_STORE_OK) {
+        status = read ? KV_STORE_NOT_FOUND : KV_STORE_ERROR;
+    }
+    return status;
+}
+
+static void kv_metrics_record(kv_metrics_ctx_t* ctx, kv_store_op_t op,
+                              uint64_t ns, size_t bytes, kv_store_status_t status) {
+    if (kv_metrics_shard < 0) {
+        kv_metrics_shard = (int) (atomic_fetch_add_explicit(
+                &kv_metrics_next_shard, 1, memory_order_relaxed) % KV_METRICS_SHARDS);
+    }
+    kv_metrics_op_t* m = &ctx->shards[kv_metrics_shard].ops[op];
+    atomic_fetch_add_explicit(&m->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->statuses[status], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->sum_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->buckets[kv_metrics_bucket(ns)], 1, memory_order_relaxed);
+    uint_fast64_t max = atomic_load_explicit(&m->max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(
+                &m->max_ns, &max, ns, memory_order_relaxed, memory_order_relaxed));
+}
+
+static void* kv_metrics_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) client->handler;
+    ctx->inner_handle = ctx->inner->init(ctx->inner);
+    if (ctx->inner_handle == NULL) {
+        LOG_ERROR_0("Failed to initialize instrumented kv_store_client");
+        return NULL;
+    }
+    return ctx;
+}
+
+static char* kv_metrics_get(void* handle, char* key) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_store_set_status(KV_STORE_OK);
+    uint64_t start = kv_metrics_now_ns();
+    char* value = ctx->inner->get(ctx->inner_handle, key);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    kv_metrics_record(ctx, KV_OP_GET, elapsed, (value != NULL) ? strlen(value) : 0,
+                      kv_metrics_status(value == NULL, true));
+    return value;
+}
+
+static config_value_t* kv_metrics_get_prefix(void* handle, char* key) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_store_set_status(KV_STORE_OK);
+    uint64_t start = kv_metrics_now_ns();
+    config_value_t* values = ctx->inner->get_prefix(ctx->inner_handle, key);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    // Bytes would take copying every value out of the array, they are
+    // only counted for get_prefix_kv()
+    kv_metrics_record(ctx, KV_OP_GET_PREFIX, elapsed, 0, kv_metrics_status(values == NULL, true));
+    return values;
+}
+
+// Counts the bytes of the values streamed by get_prefix_kv()
+typedef struct {
+    kv_store_get_kv_callback_t cb;
+    void* user_data;
+    size_t bytes;
+} kv_metrics_get_kv_t;
+
+static int kv_metrics_get_kv_cb(const char* key, const char* value, void* user_data) {
+    kv_metrics_get_kv_t* get = (kv_metrics_get_kv_t*) user_data;
+    get->bytes += strlen(value);
+    return get->cb(key, value, get->user_data);
+}
+
+static int kv_metrics_get_prefix_kv(void* handle, char* key, kv_store_get_kv_callback_t cb,
+                                    void* user_data) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_metrics_get_kv_t get = { cb, user_data, 0 };
+    kv_store_set_status(KV_STORE_OK);
+    uint64_t start = kv_metrics_now_ns();
+    int count = ctx->inner->get_prefix_kv(ctx->inner_handle, key, kv_metrics_get_kv_cb, &get);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    kv_store_status_t status = kv_metrics_status(count < 0, false);
+    if (count == 0 && status == KV_STORE_OK) {
+        status = KV_STORE_NOT_FOUND;
+    }
+    kv_metrics_record(ctx, KV_OP_GET_PREFIX, elapsed, get.bytes, status);
+    return count;
+}
+
+static config_t* kv_metrics_get_batch(void* handle, char** keys, const bool* prefixes, size_t count) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_store_set_status(KV_STORE_OK);
+    uint64_t start = kv_metrics_now_ns();
+    config_t* values = ctx->inner->get_batch(ctx->inner_handle, keys, prefixes, count);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    size_t bytes = 0;
+    if (values != NULL) {
+        cJSON* item = NULL;
+        cJSON_ArrayForEach(item, (cJSON*) values->cfg) {
+            if (cJSON_IsString(item)) {
+                bytes += strlen(item->valuestring);
+            }
+        }
+    }
+    kv_metrics_record(ctx, KV_OP_GET_BATCH, elapsed, bytes, kv_metrics_status(values == NULL, false));
+    return values;
+}
+
+static int kv_metrics_put(void* handle, char* key, char* value) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_store_set_status(KV_STORE_OK);
+    uint64_t start = kv_metrics_now_ns();
+    int ret = ctx->inner->put(ctx->inner_handle, key, value);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    kv_metrics_record(ctx, KV_OP_PUT, elapsed, strlen(value), kv_metrics_status(ret != 0, false));
+    return ret;
+}
+
+static int kv_metrics_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_store_set_status(KV_STORE_OK);
+    uint64_t start = kv_metrics_now_ns();
+    int ret = ctx->inner->put_with_lease(ctx->inner_handle, key, value, lease_id);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    kv_metrics_record(ctx, KV_OP_PUT, elapsed, strlen(value), kv_metrics_status(ret != 0, false));
+    return ret;
+}
+
+static void kv_metrics_watch_cb(const char* key, config_t* value, void* cb_user_data) {
+    kv_metrics_watch_t* watch = (kv_metrics_watch_t*) cb_user_data;
+    uint64_t start = kv_metrics_now_ns();
+    watch->cb(key, value, watch->user_data);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    kv_metrics_record(watch->ctx, KV_OP_WATCH_EVENT, elapsed, 0, KV_STORE_OK);
+}
+
+static void kv_metrics_watch_kv_cb(const char* key, const char* value, void* cb_user_data) {
+    kv_metrics_watch_t* watch = (kv_metrics_watch_t*) cb_user_data;
+    uint64_t start = kv_metrics_now_ns();
+    watch->kv_cb(key, value, watch->user_data);
+    uint64_t elapsed = kv_metrics_now_ns() - start;
+    kv_metrics_record(watch->ctx, KV_OP_WATCH_EVENT, elapsed, 0, KV_STORE_OK);
+}
+
+static kv_metrics_watch_t* kv_metrics_add_watch(kv_metrics_ctx_t* ctx,
+                                                kv_store_watch_callback_t cb,
+                                                kv_store_watch_kv_callback_t kv_cb,
+                                                void* user_data) {
+    kv_metrics_watch_t* watch = (kv_metrics_watch_t*) malloc(sizeof(kv_metrics_watch_t));
+    if (watch == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for watch registration");
+        return NULL;
+    }
+    watch->cb = cb;
+    watch->kv_cb = kv_cb;
+    watch->user_data = user_data;
+    watch->ctx = ctx;
+    pthread_mutex_lock(&ctx->watch_mtx);
+    watch->next = ctx->watches;
+    ctx->watches = watch;
+    pthread_mutex_unlock(&ctx->watch_mtx);
+    return watch;
+}
+
+static void kv_metrics_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_metrics_watch_t* watch = kv_metrics_add_watch(ctx, cb, NULL, user_data);
+    if (watch == NULL) {
+        return;
+    }
+    ctx->inner->watch(ctx->inner_handle, key, kv_metrics_watch_cb, watch);
+}
+
+static void kv_metrics_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_metrics_watch_t* watch = kv_metrics_add_watch(ctx, cb, NULL, user_data);
+    if (watch == NULL) {
+        return;
+    }
+    ctx->inner->watch_prefix(ctx->inner_handle, key, kv_metrics_watch_cb, watch);
+}
+
+static int kv_metrics_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                      void* user_data) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    kv_metrics_watch_t* watch = kv_metrics_add_watch(ctx, NULL, cb, user_data);
+    if (watch == NULL) {
+        return -1;
+    }
+    return ctx->inner->watch_prefix_kv(ctx->inner_handle, key, kv_metrics_watch_kv_cb, watch);
+}
+
+static int kv_metrics_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    return ctx->inner->grant_lease(ctx->inner_handle, ttl, lease_id);
+}
+
+static int kv_metrics_keepalive(void* handle, int64_t lease_id) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    return ctx->inner->keepalive(ctx->inner_handle, lease_id);
+}
+
+static int kv_metrics_revoke_lease(void* handle, int64_t lease_id) {
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) handle;
+    return ctx->inner->revoke_lease(ctx->inner_handle, lease_id);
+}
+
+static void kv_metrics_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    // Inner client is freed first, watch callbacks must not outlive
+    // the client, same as their user_data
+    kv_client_free(ctx->inner);
+    ctx->inner = NULL;
+    kv_metrics_watch_t* watch = ctx->watches;
+    while (watch != NULL) {
+        kv_metrics_watch_t* next = watch->next;
+        free(watch);
+        watch = next;
+    }
+    ctx->watches = NULL;
+    pthread_mutex_destroy(&ctx->watch_mtx);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+kv_store_client_t* kv_store_metrics_wrap(kv_store_client_t* inner) {
+    kv_store_client_t* client = NULL;
+    kv_metrics_ctx_t* ctx = NULL;
+
+    if (inner == NULL) {
+        LOG_ERROR_0("kv_store_client to instrument is NULL");
+        return NULL;
+    }
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+
+    // Rounded up to the alignment as required by aligned_alloc()
+    size_t ctx_size = (sizeof(kv_metrics_ctx_t) + KV_METRICS_CACHE_LINE - 1) &
+                      ~((size_t) KV_METRICS_CACHE_LINE - 1);
+    ctx = (kv_metrics_ctx_t*) aligned_alloc(KV_METRICS_CACHE_LINE, ctx_size);
+    if (ctx == NULL) {
+        LOG_ERROR_0("Metrics context: Failed to allocate Memory");
+        goto err;
+    }
+    memset(ctx, 0, ctx_size);
+    if (pthread_mutex_init(&ctx->watch_mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize watch mutex");
+        goto err;
+    }
+    ctx->inner = inner;
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_metrics_init;
+    client->get = kv_metrics_get;
+    client->get_prefix = kv_metrics_get_prefix;
+    client->get_prefix_kv = (inner->get_prefix_kv != NULL) ? kv_metrics_get_prefix_kv : NULL;
+    client->get_batch = (inner->get_batch != NULL) ? kv_metrics_get_batch : NULL;
+    client->put = kv_metrics_put;
+    client->watch = kv_metrics_watch;
+    client->watch_prefix = kv_metrics_watch_prefix;
+    client->watch_prefix_kv = (inner->watch_prefix_kv != NULL) ? kv_metrics_watch_prefix_kv : NULL;
+    client->grant_lease = kv_metrics_grant_lease;
+    client->put_with_lease = kv_metrics_put_with_lease;
+    client->keepalive = kv_metrics_keepalive;
+    client->revoke_lease = kv_metrics_revoke_lease;
+    client->deinit = kv_metrics_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
+
+bool kv_store_metrics_enabled(kv_store_client_t* client) {
+    return client != NULL && client->init == kv_metrics_init;
+}
+
+int kv_store_metrics_snapshot(kv_store_client_t* client, kv_store_metrics_snapshot_t* snapshot) {
+    if (!kv_store_metrics_enabled(client)) {
+        LOG_ERROR_0("kv_store_client is not instrumented with metrics");
+        return -1;
+    }
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) client->handler;
+    memset(snapshot, 0, sizeof(kv_store_metrics_snapshot_t));
+    for (int s = 0; s < KV_METRICS_SHARDS; s++) {
+        for (int op = 0; op < KV_OP_COUNT; op++) {
+            kv_metrics_op_t* m = &ctx->shards[s].ops[op];
+            kv_store_op_metrics_t* out = &snapshot->ops[op];
+            out->count += atomic_load_explicit(&m->count, memory_order_relaxed);
+            for (int st = 0; st < KV_STORE_STATUS_COUNT; st++) {
+                uint64_t n = atomic_load_explicit(&m->statuses[st], memory_order_relaxed);
+                out->statuses[st] += n;
+                if (st != KV_STORE_OK && st != KV_STORE_NOT_FOUND) {
+                    out->errors += n;
+                }
+            }
+            out->bytes += atomic_load_explicit(&m->bytes, memory_order_relaxed);
+            out->latency_sum_ns += atomic_load_explicit(&m->sum_ns, memory_order_relaxed);
+            uint64_t max = atomic_load_explicit(&m->max_ns, memory_order_relaxed);
+            if (max > out->latency_max_ns) {
+                out->latency_max_ns = max;
+            }
+            for (int b = 0; b < KV_METRICS_BUCKETS; b++) {
+                out->buckets[b] += atomic_load_explicit(&m->buckets[b], memory_order_relaxed);
+            }
+        }
+    }
+    return 0;
+}
+
+void kv_store_metrics_reset(kv_store_client_t* client) {
+    if (!kv_store_metrics_enabled(client)) {
+        return;
+    }
+    kv_metrics_ctx_t* ctx = (kv_metrics_ctx_t*) client->handler;
+    for (int s = 0; s < KV_METRICS_SHARDS; s++) {
+        for (int op = 0; op < KV_OP_COUNT; op++) {
+            kv_metrics_op_t* m = &ctx->shards[s].ops[op];
+            atomic_store_explicit(&m->count, 0, memory_order_relaxed);
+            for (int st = 0; st < KV_STORE_STATUS_COUNT; st++) {
+                atomic_store_explicit(&m->statuses[st], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&m->bytes, 0, memory_order_relaxed);
+            atomic_store_explicit(&m->sum_ns, 0, memory_order_relaxed);
+            atomic_store_explicit(&m->max_ns, 0, memory_order_relaxed);
+            for (int b = 0; b < KV_METRICS_BUCKETS; b++) {
+                atomic_store_explicit(&m->buckets[b], 0, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+uint64_t kv_store_metrics_percentile(const kv_store_op_metrics_t* op, double percentile) {
+    uint64_t total = 0;
+    for (int b = 0; b < KV_METRICS_BUCKETS; b++) {
+        total += op->buckets[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    if (percentile < 0) {
+        percentile = 0;
+    } else if (percentile > 100) {
+        percentile = 100;
+    }
+    uint64_t rank = (uint64_t) ((percentile / 100.0) * (double) total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < KV_METRICS_BUCKETS; b++) {
+        seen += op->buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = kv_metrics_bucket_upper(b);
+            return (upper < op->latency_max_ns) ? upper : op->latency_max_ns;
+        }
+    }
+    return op->latency_max_ns;
+}
+
+const char* kv_store_metrics_op_name(kv_store_op_t op) {
+    if (op < 0 || op >= KV_OP_COUNT) {
+        return "unknown";
+    }
+    return kv_metrics_op_names[op];
+}
+
+// Appends a line to a growing malloc'd buffer
+static bool kv_metrics_append(char** buf, size_t* len, size_t* cap, const char* line) {
+    size_t line_len = strlen(line);
+    if (*len + line_len + 1 > *cap) {
+        size_t new_cap = (*cap * 2 > *len + line_len + 1) ? *cap * 2 : *len + line_len + 1;
+        char* tmp = (char*) realloc(*buf, new_cap);
+        if (tmp == NULL) {
+            LOG_ERROR_0("Failed to grow metrics buffer");
+            return false;
+        }
+        *buf = tmp;
+        *cap = new_cap;
+    }
+    memcpy(*buf + *len, line, line_len + 1);
+    *len += line_len;
+    return true;
+}
+
+char* kv_store_metrics_prometheus(kv_store_client_t* client) {
+    kv_store_metrics_snapshot_t* snap = NULL;
+    char line[KV_METRICS_LINE_LEN];
+    char* buf = NULL;
+    size_t len = 0;
+    size_t cap = 4096;
+
+    snap = (kv_store_metrics_snapshot_t*) malloc(sizeof(kv_store_metrics_snapshot_t));
+    if (snap == NULL) {
+        LOG_ERROR_0("Failed to allocate metrics snapshot");
+        goto err;
+    }
+    if (kv_store_metrics_snapshot(client, snap) != 0) {
+        goto err;
+    }
+    buf = (char*) malloc(cap);
+    if (buf == NULL) {
+        LOG_ERROR_0("Failed to allocate metrics buffer");
+        goto err;
+    }
+    buf[0] = '\0';
+
+#define KV_METRICS_EMIT(...) \
+    do { \
+        snprintf(line, KV_METRICS_LINE_LEN, __VA_ARGS__); \
+        if (!kv_metrics_append(&buf, &len, &cap, line)) { \
+            goto err; \
+        } \
+    } while (0)
+
+    KV_METRICS_EMIT("# HELP cfgmgr_kv_requests_total KV store operations performed.\n");
+    KV_METRICS_EMIT("# TYPE cfgmgr_kv_requests_total counter\n");
+    for (int op = 0; op < KV_OP_COUNT; op++) {
+        KV_METRICS_EMIT("cfgmgr_kv_requests_total{op=\"%s\"} %llu\n",
+                        kv_metrics_op_names[op], (unsigned long long) snap->ops[op].count);
+    }
+    KV_METRICS_EMIT("# HELP cfgmgr_kv_errors_total KV store operations which failed.\n");
+    KV_METRICS_EMIT("# TYPE cfgmgr_kv_errors_total counter\n");
+    for (int op = 0; op < KV_OP_COUNT; op++) {
+        KV_METRICS_EMIT("cfgmgr_kv_errors_total{op=\"%s\"} %llu\n",
+                        kv_metrics_op_names[op], (unsigned long long) snap->ops[op].errors);
+    }
+    KV_METRICS_EMIT("# HELP cfgmgr_kv_responses_total KV store operations by status.\n");
+    KV_METRICS_EMIT("# TYPE cfgmgr_kv_responses_total counter\n");
+    for (int op = 0; op < KV_OP_COUNT; op++) {
+        for (int st = 0; st < KV_STORE_STATUS_COUNT; st++) {
+            KV_METRICS_EMIT("cfgmgr_kv_responses_total{op=\"%s\",status=\"%s\"} %llu\n",
+                            kv_metrics_op_names[op], kv_store_status_name((kv_store_status_t) st),
+                            (unsigned long long) snap->ops[op].statuses[st]);
+        }
+    }
+    KV_METRICS_EMIT("# HELP cfgmgr_kv_bytes_total Value bytes transferred by KV store operations.\n");
+    KV_METRICS_EMIT("# TYPE cfgmgr_kv_bytes_total counter\n");
+    for (int op = 0; op < KV_OP_COUNT; op++) {
+        KV_METRICS_EMIT("cfgmgr_kv_bytes_total{op=\"%s\"} %llu\n",
+                        kv_metrics_op_names[op], (unsigned long long) snap->ops[op].bytes);
+    }
+    KV_METRICS_EMIT("# HELP cfgmgr_kv_latency_seconds Latency of KV store operations.\n");
+    KV_METRICS_EMIT("# TYPE cfgmgr_kv_latency_seconds histogram\n");
+    for (int op = 0; op < KV_OP_COUNT; op++) {
+        kv_store_op_metrics_t* m = &snap->ops[op];
+        uint64_t cumulative = 0;
+        int b = 0;
+        // Power of two boundaries line up with the histogram groups,
+        // so the cumulative counts are exact
+        for (int bits = KV_METRICS_PROM_MIN_BITS; bits <= KV_METRICS_MAX_BITS; bits++) {
+            int end = (bits - KV_METRICS_SUB_BITS + 1) << KV_METRICS_SUB_BITS;
+            for (; b < end; b++) {
+                cumulative += m->buckets[b];
+            }
+            KV_METRICS_EMIT("cfgmgr_kv_latency_seconds_bucket{op=\"%s\",le=\"%.9g\"} %llu\n",
+                            kv_metrics_op_names[op], (double) (1ULL << bits) / 1e9,
+                            (unsigned long long) cumulative);
+        }
+        KV_METRICS_EMIT("cfgmgr_kv_latency_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n",
+                        kv_metrics_op_names[op], (unsigned long long) m->count);
+        KV_METRICS_EMIT("cfgmgr_kv_latency_seconds_sum{op=\"%s\"} %.9f\n",
+                        kv_metrics_op_names[op], (double) m->latency_sum_ns / 1e9);
+        KV_METRICS_EMIT("cfgmgr_kv_latency_seconds_count{op=\"%s\"} %llu\n",
+                        kv_metrics_op_names[op], (unsigned long long) m->count);
+    }
+#undef KV_METRICS_EMIT
+
+    free(snap);
+    return buf;
+err:
+    if (snap != NULL) {
+        free(snap);
+    }
+    if (buf != NULL) {
+        free(buf);
+    }
+    return NULL;
+}
@@ -0,0 +1,409 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store prefix mirror implementation
+ */
+
+#include <pthread.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/json_config.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_mirror.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+
+// Change listener, listeners are only added and freed with the client
+typedef struct kv_mirror_listener {
+    kv_store_mirror_callback_t cb;
+    void* user_data;
+    struct kv_mirror_listener* next;
+} kv_mirror_listener_t;
+
+typedef struct {
+    kv_store_client_t* inner;
+    void* inner_handle;
+    char* prefix;
+    size_t prefix_len;
+
+    // Set once by init(), before any read
+    bool active;
+
+    // Mirrored keys sorted by key, as the kv_store returns them
+    pthread_mutex_t mtx;
+    kv_table_t table;
+    kv_mirror_listener_t* listeners;
+
+    // Keys of a resync in progress, only used by the watch callback
+    kv_table_t resync;
+    bool resyncing;
+} kv_mirror_ctx_t;
+
+static bool kv_mirror_covers(kv_mirror_ctx_t* ctx, const char* key) {
+    return ctx->active && strncmp(key, ctx->prefix, ctx->prefix_len) == 0;
+}
+
+static void kv_mirror_notify(const char* key, const char* value, void* user_data) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) user_data;
+    LOG_DEBUG("Mirrored key %s %s", key, (value != NULL) ? "updated" : "deleted");
+    pthread_mutex_lock(&ctx->mtx);
+    kv_mirror_listener_t* listener = ctx->listeners;
+    pthread_mutex_unlock(&ctx->mtx);
+    for (; listener != NULL; listener = listener->next) {
+        listener->cb(key + ctx->prefix_len, value, listener->user_data);
+    }
+}
+
+// Replaces the mirrored keys by the resynced ones at once, and notifies
+// the listeners of the keys which changed meanwhile, deletes included
+static void kv_mirror_resync(kv_mirror_ctx_t* ctx) {
+    pthread_mutex_lock(&ctx->mtx);
+    kv_table_t old = ctx->table;
+    ctx->table = ctx->resync;
+    pthread_mutex_unlock(&ctx->mtx);
+    memset(&ctx->resync, 0, sizeof(ctx->resync));
+    LOG_INFO("Resynced %zu mirrored keys of %s", ctx->table.count, ctx->prefix);
+    // Only this callback writes the table, it can be read without the mutex
+    kv_table_diff(&old, &ctx->table, kv_mirror_notify, ctx);
+    kv_table_clear(&old);
+}
+
+static void kv_mirror_watch_cb(const char* key, const char* value, void* cb_user_data) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) cb_user_data;
+    if (key == NULL) {
+        // Resync markers, the keys in between replace the mirrored ones
+        ctx->resyncing = value != NULL;
+        if (!ctx->resyncing) {
+            kv_mirror_resync(ctx);
+        } else {
+            kv_table_clear(&ctx->resync);
+        }
+        return;
+    }
+    if (strncmp(key, ctx->prefix, ctx->prefix_len) != 0) {
+        return;
+    }
+    if (ctx->resyncing) {
+        if (kv_table_apply(&ctx->resync, key, value) < 0) {
+            LOG_ERROR("Failed to mirror the key %s", key);
+        }
+        return;
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    int changed = kv_table_apply(&ctx->table, key, value);
+    pthread_mutex_unlock(&ctx->mtx);
+    if (changed < 0) {
+        LOG_ERROR("Failed to mirror the key %s", key);
+    }
+    if (changed > 0) {
+        kv_mirror_notify(key, value, ctx);
+    }
+}
+
+static void* kv_mirror_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) client->handler;
+    ctx->inner_handle = ctx->inner->init(ctx->inner);
+    if (ctx->inner_handle == NULL) {
+        LOG_ERROR_0("Failed to initialize decorated kv_store_client");
+        return NULL;
+    }
+    if (ctx->inner->watch_prefix_kv == NULL) {
+        LOG_DEBUG("kv_store can't mirror keys, reading %s from the kv_store", ctx->prefix);
+        return ctx;
+    }
+    if (ctx->inner->watch_prefix_kv(ctx->inner_handle, ctx->prefix, kv_mirror_watch_cb, ctx) != 0) {
+        LOG_WARN("Failed to mirror %s, reading it from the kv_store", ctx->prefix);
+        pthread_mutex_lock(&ctx->mtx);
+        kv_table_clear(&ctx->table);
+        pthread_mutex_unlock(&ctx->mtx);
+        return ctx;
+    }
+    ctx->active = true;
+    LOG_DEBUG("Mirrored %zu keys of %s", ctx->table.count, ctx->prefix);
+    return ctx;
+}
+
+static char* kv_mirror_get(void* handle, char* key) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    if (!kv_mirror_covers(ctx, key)) {
+        return ctx->inner->get(ctx->inner_handle, key);
+    }
+    char* value = NULL;
+    pthread_mutex_lock(&ctx->mtx);
+    kv_table_entry_t* entry = kv_table_find(&ctx->table, key);
+    if (entry != NULL) {
+        value = strdup(entry->value);
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    if (value == NULL) {
+        LOG_DEBUG("Value is not found for the key %s", key);
+    }
+    return value;
+}
+
+static config_value_t* kv_mirror_get_prefix(void* handle, char* key) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    if (!kv_mirror_covers(ctx, key)) {
+        return ctx->inner->get_prefix(ctx->inner_handle, key);
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    config_value_t* values = kv_table_to_prefix_value(&ctx->table, key);
+    pthread_mutex_unlock(&ctx->mtx);
+    return values;
+}
+
+// Adds the mirrored keys matching a key or a prefix to a get_batch() result
+static void kv_mirror_add_batch(kv_mirror_ctx_t* ctx, cJSON* result, const char* key, bool prefix) {
+    size_t key_len = strlen(key);
+    for (size_t i = kv_table_lower_bound(&ctx->table, key); i < ctx->table.count; i++) {
+        const kv_table_entry_t* entry = &ctx->table.items[i];
+        bool match = prefix ? strncmp(entry->key, key, key_len) == 0 : strcmp(entry->key, key) == 0;
+        if (!match) {
+            break;
+        }
+        if (!cJSON_HasObjectItem(result, entry->key)) {
+            cJSON_AddItemToObject(result, entry->key, cJSON_CreateString(entry->value));
+        }
+    }
+}
+
+static config_t* kv_mirror_get_batch(void* handle, char** keys, const bool* prefixes, size_t count) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    config_t* values = NULL;
+    char** rest = NULL;
+    bool* rest_prefixes = NULL;
+    size_t rest_count = 0;
+
+    rest = (char**) malloc(sizeof(char*) * (count + 1));
+    rest_prefixes = (bool*) malloc(sizeof(bool) * (count + 1));
+    if (rest == NULL || rest_prefixes == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for batched keys");
+        goto err;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!kv_mirror_covers(ctx, keys[i])) {
+            rest[rest_count] = keys[i];
+            rest_prefixes[rest_count] = prefixes[i];
+            rest_count++;
+        }
+    }
+
+    if (rest_count > 0) {
+        values = ctx->inner->get_batch(ctx->inner_handle, rest, rest_prefixes, rest_count);
+        if (values == NULL) {
+            goto err;
+        }
+    } else {
+        cJSON* all_values = cJSON_CreateObject();
+        if (all_values == NULL) {
+            LOG_ERROR_0("Create new json object failed");
+            goto err;
+        }
+        values = config_new(all_values, free_json, get_config_value, set_config_value);
+        if (values == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for batched values");
+            cJSON_Delete(all_values);
+            goto err;
+        }
+    }
+
+    if (rest_count < count) {
+        pthread_mutex_lock(&ctx->mtx);
+        for (size_t i = 0; i < count; i++) {
+            if (kv_mirror_covers(ctx, keys[i])) {
+                kv_mirror_add_batch(ctx, (cJSON*) values->cfg, keys[i], prefixes[i]);
+            }
+        }
+        pthread_mutex_unlock(&ctx->mtx);
+    }
+
+    free(rest);
+    free(rest_prefixes);
+    return values;
+
+err:
+    if (rest != NULL) {
+        free(rest);
+    }
+    if (rest_prefixes != NULL) {
+        free(rest_prefixes);
+    }
+    return NULL;
+}
+
+// Writes, watches and leases go to the underlying client, writes under the
+// prefix reach the mirror through its watch
+
+static int kv_mirror_put(void* handle, char* key, char* value) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    return ctx->inner->put(ctx->inner_handle, key, value);
+}
+
+static int kv_mirror_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    return ctx->inner->put_with_lease(ctx->inner_handle, key, value, lease_id);
+}
+
+static void kv_mirror_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    ctx->inner->watch(ctx->inner_handle, key, cb, user_data);
+}
+
+static void kv_mirror_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    ctx->inner->watch_prefix(ctx->inner_handle, key, cb, user_data);
+}
+
+static int kv_mirror_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                     void* user_data) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    return ctx->inner->watch_prefix_kv(ctx->inner_handle, key, cb, user_data);
+}
+
+static int kv_mirror_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    return ctx->inner->grant_lease(ctx->inner_handle, ttl, lease_id);
+}
+
+static int kv_mirror_keepalive(void* handle, int64_t lease_id) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    return ctx->inner->keepalive(ctx->inner_handle, lease_id);
+}
+
+static int kv_mirror_revoke_lease(void* handle, int64_t lease_id) {
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) handle;
+    return ctx->inner->revoke_lease(ctx->inner_handle, lease_id);
+}
+
+static void kv_mirror_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    // Inner client is freed first, which joins the watch thread
+    // updating the mirror
+    kv_client_free(ctx->inner);
+    ctx->inner = NULL;
+    kv_table_clear(&ctx->table);
+    kv_table_clear(&ctx->resync);
+    kv_mirror_listener_t* listener = ctx->listeners;
+    while (listener != NULL) {
+        kv_mirror_listener_t* next = listener->next;
+        free(listener);
+        listener = next;
+    }
+    ctx->listeners = NULL;
+    free(ctx->prefix);
+    pthread_mutex_destroy(&ctx->mtx);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+kv_store_client_t* kv_store_mirror_wrap(kv_store_client_t* inner, const char* prefix) {
+    kv_store_client_t* client = NULL;
+    kv_mirror_ctx_t* ctx = NULL;
+
+    if (inner == NULL) {
+        LOG_ERROR_0("kv_store_client to decorate is NULL");
+        return NULL;
+    }
+    if (prefix == NULL || strlen(prefix) == 0) {
+        LOG_ERROR_0("Prefix to mirror is empty");
+        return NULL;
+    }
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (kv_mirror_ctx_t*) calloc(1, sizeof(kv_mirror_ctx_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Mirror context: Failed to allocate Memory");
+        goto err;
+    }
+    ctx->prefix = strdup(prefix);
+    if (ctx->prefix == NULL) {
+        LOG_ERROR_0("Failed to copy the prefix to mirror");
+        goto err;
+    }
+    ctx->prefix_len = strlen(prefix);
+    if (pthread_mutex_init(&ctx->mtx, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize mirror mutex");
+        goto err;
+    }
+    ctx->inner = inner;
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_mirror_init;
+    client->get = kv_mirror_get;
+    client->get_prefix = kv_mirror_get_prefix;
+    // Mirrored prefixes are served from memory by get_prefix()
+    client->get_prefix_kv = NULL;
+    client->get_batch = (inner->get_batch != NULL) ? kv_mirror_get_batch : NULL;
+    client->put = kv_mirror_put;
+    client->watch = kv_mirror_watch;
+    client->watch_prefix = kv_mirror_watch_prefix;
+    client->watch_prefix_kv = (inner->watch_prefix_kv != NULL) ? kv_mirror_watch_prefix_kv : NULL;
+    client->grant_lease = kv_mirror_grant_lease;
+    client->put_with_lease = kv_mirror_put_with_lease;
+    client->keepalive = kv_mirror_keepalive;
+    client->revoke_lease = kv_mirror_revoke_lease;
+    client->deinit = kv_mirror_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        free(ctx->prefix);
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
+
+bool kv_store_mirror_active(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_mirror_init) {
+        return false;
+    }
+    return ((kv_mirror_ctx_t*) client->handler)->active;
+}
+
+int kv_store_mirror_listen(kv_store_client_t* client, kv_store_mirror_callback_t cb, void* user_data) {
+    if (!kv_store_mirror_active(client)) {
+        LOG_ERROR_0("kv_store_client does not mirror any prefix");
+        return -1;
+    }
+    kv_mirror_ctx_t* ctx = (kv_mirror_ctx_t*) client->handler;
+    kv_mirror_listener_t* listener = (kv_mirror_listener_t*) malloc(sizeof(kv_mirror_listener_t));
+    if (listener == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for mirror listener");
+        return -1;
+    }
+    listener->cb = cb;
+    listener->user_data = user_data;
+    pthread_mutex_lock(&ctx->mtx);
+    listener->next = ctx->listeners;
+    ctx->listeners = listener;
+    pthread_mutex_unlock(&ctx->mtx);
+    return 0;
+}
@@ -26,11 +26,36 @@
 #include <stdint.h>
 #include <eii/config_manager/kv_store_plugin/kv_store_plugin.h>
 #include <eii/config_manager/kv_store_plugin/etcd_client/etcd_client_plugin.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_client_plugin.h>
 
 #include <eii/utils/config.h>
+#include <cjson/cJSON.h>
 #include <safe_lib.h>
 
 #define KV_ETCD "etcd"
+#define KV_AGENT "agent"
+
+// Outcome of the last kv_store operation of the thread
+static _Thread_local kv_store_status_t kv_store_status = KV_STORE_OK;
+
+static const char* kv_store_status_names[KV_STORE_STATUS_COUNT] = {
+    "ok", "not_found", "unavailable", "deadline_exceeded", "permission_denied", "error"
+};
+
+void kv_store_set_status(kv_store_status_t status) {
+    kv_store_status = status;
+}
+
+kv_store_status_t kv_store_last_status(void) {
+    return kv_store_status;
+}
+
+const char* kv_store_status_name(kv_store_status_t status) {
+    if (status < 0 || status >= KV_STORE_STATUS_COUNT) {
+        return "unknown";
+    }
+    return kv_store_status_names[status];
+}
 
 kv_store_client_t* create_kv_client(config_t* config){
     kv_store_client_t* kv_store_client = NULL;
@@ -49,11 +74,17 @@ kv_store_client_t* create_kv_client(config_t* config){
 
     int ind_etcd;
     strcmp_s(value->body.string, strlen(KV_ETCD), KV_ETCD, &ind_etcd);
+    int ind_agent;
+    strcmp_s(value->body.string, strlen(KV_AGENT), KV_AGENT, &ind_agent);
 
     if(ind_etcd == 0) {
         kv_store_client = create_etcd_client(config);
         if(kv_store_client == NULL)
             goto err;
+     }else if(ind_agent == 0) {
+        kv_store_client = create_agent_client(config);
+        if(kv_store_client == NULL)
+            goto err;
      }else {
         LOG_ERROR("Unknown KV Store type: %s", value->body.string);
         goto err;
@@ -80,3 +111,45 @@ void kv_client_free(kv_store_client_t* kv_store_client) {
         free(kv_store_client);
     }
 }
+
+int kv_store_get_prefix_each(kv_store_client_t* client, void* handle, char* key,
+                             kv_store_get_kv_callback_t cb, void* user_data) {
+    if (client->get_prefix_kv != NULL) {
+        return client->get_prefix_kv(handle, key, cb, user_data);
+    }
+
+    // get_prefix() returns NULL for prefixes without any key
+    config_value_t* values = client->get_prefix(handle, key);
+    if (values == NULL) {
+        return 0;
+    }
+    if (values->type != CVT_ARRAY) {
+        LOG_ERROR("Values of the prefix %s are not an array", key);
+        config_value_destroy(values);
+        return -1;
+    }
+    int count = 0;
+    size_t len = config_value_array_len(values);
+    for (size_t i = 0; i < len; i++) {
+        config_value_t* item = config_value_array_get(values, (int) i);
+        if (item == NULL) {
+            continue;
+        }
+        int stop = 0;
+        if (item->type == CVT_STRING) {
+            stop = cb(NULL, item->body.string, user_data);
+            count++;
+        }
+        config_value_destroy(item);
+        if (stop != 0) {
+            break;
+        }
+    }
+    // get_prefix() arrays are cJSON arrays without a free function, left to
+    // whoever they are set into
+    if (values->body.array->free == NULL) {
+        cJSON_Delete((cJSON*) values->body.array->array);
+    }
+    config_value_destroy(values);
+    return count;
+}
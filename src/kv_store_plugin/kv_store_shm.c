@@ -0,0 +1,1081 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store node-local shared-memory cache implementation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/json_config.h>
+#include <eii/utils/string.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_shm.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+#include <eii/config_manager/cfgmgr_json.h>
+
+// "EIIS", set once the first snapshot is published
+#define KV_SHM_MAGIC    0x45494953u
+#define KV_SHM_LAYOUT   1
+
+// Attempts of a read racing with the leader before giving up on the segment
+#define KV_SHM_READ_RETRIES  100000
+
+// Delay before taking the lead again after a failure, doubled up to the
+// maximum with every failure
+#define KV_SHM_LEAD_BACKOFF_MS      100
+#define KV_SHM_LEAD_BACKOFF_MAX_MS  30000
+
+/**
+ * Segment header, followed by the snapshot: the uint32_t offsets of its
+ * records sorted by key, then the records, each a uint32_t key length, a
+ * uint32_t value length, the key and the value, both NUL terminated.
+ * Offsets are relative to the end of the header.
+ */
+typedef struct {
+    _Atomic uint32_t magic;
+    uint32_t layout;
+
+    // Odd while the leader writes a snapshot
+    _Atomic uint64_t seq;
+
+    // Written under seq
+    _Atomic uint64_t used;
+    _Atomic uint64_t count;
+    _Atomic uint64_t overflow;
+} kv_shm_header_t;
+
+// Watch served from the segment, watches are only added and freed with
+// the client
+typedef struct kv_shm_watch {
+    char* key;
+    bool prefix;
+    kv_store_watch_callback_t cb;
+    kv_store_watch_kv_callback_t kv_cb;
+    void* user_data;
+
+    // Keys of the watch in the last snapshot polled, only used by the poller
+    kv_table_t last;
+    struct kv_shm_watch* next;
+} kv_shm_watch_t;
+
+struct kv_shm_ctx;
+
+// Watch of a shared prefix mirrored by the leader, guarded by store_mtx
+typedef struct {
+    struct kv_shm_ctx* ctx;
+    const char* prefix;
+    // Registered with the kv_store, watches stay until the client is freed
+    bool watched;
+    // Keys delivered by a resync of the kv_store, which replace the prefix
+    bool resyncing;
+    kv_table_t resync;
+} kv_shm_mirror_t;
+
+typedef struct kv_shm_ctx {
+    kv_store_client_t* inner;
+    void* inner_handle;
+    pthread_mutex_t inner_mtx;
+    atomic_bool connected;
+
+    char* name;
+    char** prefixes;
+    kv_shm_mirror_t* mirrors;
+    size_t prefix_count;
+
+    // Segment, active once a snapshot was published
+    int fd;
+    kv_shm_header_t* header;
+    uint8_t* data;
+    size_t data_size;
+    size_t map_size;
+    bool active;
+
+    // Leadership is taken again after failures once lead_retry_ns is due
+    unsigned lead_failures;
+    uint64_t lead_retry_ns;
+
+    // Mirror of the leader, guarded by store_mtx
+    atomic_bool leader;
+    pthread_mutex_t store_mtx;
+    kv_table_t store;
+    bool seeding;
+    char* blob;
+    size_t blob_cap;
+
+    pthread_mutex_t watch_mtx;
+    kv_shm_watch_t* watches;
+
+    // Poller of the segment, for watches and leadership
+    pthread_t poller;
+    bool poller_started;
+    pthread_mutex_t poll_mtx;
+    pthread_cond_t poll_cv;
+    bool stop;
+
+    // Snapshot the watches were last notified of, 0 to notify them again
+    _Atomic uint64_t polled_seq;
+} kv_shm_ctx_t;
+
+static bool kv_shm_shared(kv_shm_ctx_t* ctx, const char* key) {
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        if (strncmp(key, ctx->prefixes[i], strlen(ctx->prefixes[i])) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool kv_shm_covers(kv_shm_ctx_t* ctx, const char* key) {
+    return ctx->active && kv_shm_shared(ctx, key);
+}
+
+// Initializes the wrapped client on first use
+static void* kv_shm_inner(kv_shm_ctx_t* ctx) {
+    if (atomic_load(&ctx->connected)) {
+        return ctx->inner_handle;
+    }
+    pthread_mutex_lock(&ctx->inner_mtx);
+    if (!atomic_load(&ctx->connected)) {
+        LOG_DEBUG("Connecting to the kv_store, %s does not cover the request", ctx->name);
+        ctx->inner_handle = ctx->inner->init(ctx->inner);
+        if (ctx->inner_handle == NULL) {
+            LOG_ERROR_0("Failed to initialize decorated kv_store_client");
+        } else {
+            atomic_store(&ctx->connected, true);
+        }
+    }
+    pthread_mutex_unlock(&ctx->inner_mtx);
+    return ctx->inner_handle;
+}
+
+// Locates the record at off of a snapshot of used bytes, which may be torn
+static bool kv_shm_record(kv_shm_ctx_t* ctx, uint64_t used, uint32_t off,
+                          const char** key, uint32_t* key_len,
+                          const char** value, uint32_t* value_len) {
+    if ((uint64_t) off + 2 * sizeof(uint32_t) > used) {
+        return false;
+    }
+    memcpy(key_len, ctx->data + off, sizeof(uint32_t));
+    memcpy(value_len, ctx->data + off + sizeof(uint32_t), sizeof(uint32_t));
+    uint64_t end = (uint64_t) off + 2 * sizeof(uint32_t) + *key_len + 1 + *value_len + 1;
+    if (end > used) {
+        return false;
+    }
+    *key = (const char*) ctx->data + off + 2 * sizeof(uint32_t);
+    *value = *key + *key_len + 1;
+    return true;
+}
+
+static int kv_shm_compare(const char* a, size_t a_len, const char* b, size_t b_len) {
+    int cmp = memcmp(a, b, (a_len < b_len) ? a_len : b_len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (a_len < b_len) ? -1 : (a_len > b_len) ? 1 : 0;
+}
+
+static char* kv_shm_copy(const char* str, size_t len) {
+    char* copy = (char*) malloc(len + 1);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+// Collects the keys of the snapshot matching a key or a prefix, without
+// checking that the snapshot was stable
+// @return 0 on success, 1 if the snapshot is not shared, -1 if invalid
+static int kv_shm_scan(kv_shm_ctx_t* ctx, const char* key, bool prefix, kv_table_t* out) {
+    kv_shm_header_t* header = ctx->header;
+    if (atomic_load_explicit(&header->overflow, memory_order_relaxed) != 0) {
+        return 1;
+    }
+    uint64_t used = atomic_load_explicit(&header->used, memory_order_relaxed);
+    uint64_t count = atomic_load_explicit(&header->count, memory_order_relaxed);
+    if (used > ctx->data_size || count * sizeof(uint32_t) > used) {
+        return -1;
+    }
+    size_t key_len = strlen(key);
+    const char* rec_key;
+    const char* rec_value;
+    uint32_t rec_key_len;
+    uint32_t rec_value_len;
+    uint32_t off;
+
+    size_t lo = 0;
+    size_t hi = (size_t) count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        memcpy(&off, ctx->data + mid * sizeof(uint32_t), sizeof(uint32_t));
+        if (!kv_shm_record(ctx, used, off, &rec_key, &rec_key_len, &rec_value, &rec_value_len)) {
+            return -1;
+        }
+        if (kv_shm_compare(rec_key, rec_key_len, key, key_len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (size_t i = lo; i < count; i++) {
+        memcpy(&off, ctx->data + i * sizeof(uint32_t), sizeof(uint32_t));
+        if (!kv_shm_record(ctx, used, off, &rec_key, &rec_key_len, &rec_value, &rec_value_len)) {
+            return -1;
+        }
+        bool match = prefix ? (rec_key_len >= key_len && memcmp(rec_key, key, key_len) == 0)
+                            : kv_shm_compare(rec_key, rec_key_len, key, key_len) == 0;
+        if (!match) {
+            break;
+        }
+        char* key_copy = kv_shm_copy(rec_key, rec_key_len);
+        char* value_copy = kv_shm_copy(rec_value, rec_value_len);
+        if (key_copy == NULL || value_copy == NULL ||
+                kv_table_insert(out, out->count, key_copy, value_copy) != 0) {
+            free(key_copy);
+            free(value_copy);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Reads the keys matching a key or a prefix from a stable snapshot
+// @return 0 on success, -1 if they must be read from the kv_store
+static int kv_shm_read(kv_shm_ctx_t* ctx, const char* key, bool prefix, kv_table_t* out) {
+    kv_shm_header_t* header = ctx->header;
+    for (int attempt = 0; attempt < KV_SHM_READ_RETRIES; attempt++) {
+        uint64_t seq = atomic_load_explicit(&header->seq, memory_order_acquire);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        kv_table_clear(out);
+        int status = kv_shm_scan(ctx, key, prefix, out);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&header->seq, memory_order_relaxed) != seq) {
+            continue;
+        }
+        if (status == 0) {
+            return 0;
+        }
+        kv_table_clear(out);
+        if (status == 1) {
+            LOG_DEBUG("Keys of %s did not fit in %s", key, ctx->name);
+        } else {
+            LOG_ERROR("Invalid snapshot in %s", ctx->name);
+        }
+        return -1;
+    }
+    kv_table_clear(out);
+    LOG_WARN("Snapshot of %s kept changing, reading %s from the kv_store", ctx->name, key);
+    return -1;
+}
+
+// Writes the leader's keys to the segment, with store_mtx held
+static void kv_shm_publish(kv_shm_ctx_t* ctx) {
+    kv_shm_header_t* header = ctx->header;
+    kv_table_t* store = &ctx->store;
+
+    // Staging the snapshot first keeps the seqlock held briefly
+    size_t size = store->count * sizeof(uint32_t);
+    for (size_t i = 0; i < store->count; i++) {
+        size += 2 * sizeof(uint32_t) + strlen(store->items[i].key) + 1 +
+                strlen(store->items[i].value) + 1;
+    }
+    bool overflow = size > ctx->data_size || size > UINT32_MAX;
+    if (!overflow && size > ctx->blob_cap) {
+        char* blob = (char*) realloc(ctx->blob, size);
+        if (blob == NULL) {
+            LOG_ERROR_0("Failed to allocate the shared snapshot");
+            overflow = true;
+        } else {
+            ctx->blob = blob;
+            ctx->blob_cap = size;
+        }
+    }
+    if (!overflow) {
+        uint32_t off = (uint32_t) (store->count * sizeof(uint32_t));
+        for (size_t i = 0; i < store->count; i++) {
+            uint32_t key_len = (uint32_t) strlen(store->items[i].key);
+            uint32_t value_len = (uint32_t) strlen(store->items[i].value);
+            memcpy(ctx->blob + i * sizeof(uint32_t), &off, sizeof(uint32_t));
+            char* rec = ctx->blob + off;
+            memcpy(rec, &key_len, sizeof(uint32_t));
+            memcpy(rec + sizeof(uint32_t), &value_len, sizeof(uint32_t));
+            rec += 2 * sizeof(uint32_t);
+            memcpy(rec, store->items[i].key, key_len + 1);
+            memcpy(rec + key_len + 1, store->items[i].value, value_len + 1);
+            off += 2 * sizeof(uint32_t) + key_len + 1 + value_len + 1;
+        }
+    } else {
+        LOG_ERROR("Shared keys need %zu bytes, more than %s holds, "
+                  "processes read them from the kv_store", size, ctx->name);
+    }
+
+    // A leader which died while writing left seq odd
+    uint64_t seq = atomic_load_explicit(&header->seq, memory_order_relaxed);
+    if (seq & 1) {
+        seq++;
+    }
+    atomic_store_explicit(&header->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (overflow) {
+        atomic_store_explicit(&header->used, 0, memory_order_relaxed);
+        atomic_store_explicit(&header->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&header->overflow, 1, memory_order_relaxed);
+    } else {
+        memcpy(ctx->data, ctx->blob, size);
+        atomic_store_explicit(&header->used, size, memory_order_relaxed);
+        atomic_store_explicit(&header->count, store->count, memory_order_relaxed);
+        atomic_store_explicit(&header->overflow, 0, memory_order_relaxed);
+    }
+    header->layout = KV_SHM_LAYOUT;
+    atomic_store_explicit(&header->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&header->magic, KV_SHM_MAGIC, memory_order_release);
+}
+
+static void kv_shm_mirror_cb(const char* key, const char* value, void* cb_user_data) {
+    kv_shm_mirror_t* mirror = (kv_shm_mirror_t*) cb_user_data;
+    kv_shm_ctx_t* ctx = mirror->ctx;
+    int changed = 0;
+    pthread_mutex_lock(&ctx->store_mtx);
+    if (key == NULL) {
+        // Resync of the kv_store, keys it does not deliver again were
+        // deleted, the prefix is replaced once all of them are in
+        if (value != NULL) {
+            kv_table_clear(&mirror->resync);
+            mirror->resyncing = true;
+        } else if (mirror->resyncing) {
+            mirror->resyncing = false;
+            if (kv_table_replace_prefix(&ctx->store, mirror->prefix, &mirror->resync) != 0) {
+                LOG_ERROR("Failed to resync the shared keys of %s", mirror->prefix);
+                kv_table_clear(&mirror->resync);
+            } else {
+                LOG_INFO("Resynced the shared keys of %s", mirror->prefix);
+                changed = 1;
+            }
+        }
+    } else if (mirror->resyncing) {
+        if (kv_table_apply(&mirror->resync, key, value) < 0) {
+            LOG_ERROR("Failed to copy the key %s", key);
+        }
+    } else {
+        changed = kv_table_apply(&ctx->store, key, value);
+        if (changed < 0) {
+            LOG_ERROR("Failed to copy the key %s", key);
+        }
+    }
+    if (changed > 0 && !ctx->seeding &&
+            atomic_load(&ctx->leader)) {
+        kv_shm_publish(ctx);
+    }
+    pthread_mutex_unlock(&ctx->store_mtx);
+}
+
+// Maps the segment once it has a size
+// @return 0 on success, -1 if not sized yet or on failure
+static int kv_shm_map(kv_shm_ctx_t* ctx) {
+    if (ctx->header != NULL) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(ctx->fd, &st) != 0) {
+        LOG_ERROR("Failed to stat %s: %s", ctx->name, strerror(errno));
+        return -1;
+    }
+    if ((size_t) st.st_size <= sizeof(kv_shm_header_t)) {
+        return -1;
+    }
+    void* addr = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd, 0);
+    if (addr == MAP_FAILED) {
+        LOG_ERROR("Failed to map %s: %s", ctx->name, strerror(errno));
+        return -1;
+    }
+    ctx->header = (kv_shm_header_t*) addr;
+    ctx->data = (uint8_t*) addr + sizeof(kv_shm_header_t);
+    ctx->map_size = (size_t) st.st_size;
+    ctx->data_size = ctx->map_size - sizeof(kv_shm_header_t);
+    return 0;
+}
+
+static uint64_t kv_shm_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// Takes the lead once the segment lock is held: mirrors the shared prefixes
+// and publishes them
+// @return 0 on success, -1 on failure, after which the lock is released
+static int kv_shm_lead(kv_shm_ctx_t* ctx) {
+    struct stat st;
+    if (fstat(ctx->fd, &st) != 0 ||
+            (st.st_size < KV_STORE_SHM_SIZE && ftruncate(ctx->fd, KV_STORE_SHM_SIZE) != 0)) {
+        LOG_ERROR("Failed to size %s: %s", ctx->name, strerror(errno));
+        goto err;
+    }
+    if (kv_shm_map(ctx) != 0) {
+        goto err;
+    }
+    void* handle = kv_shm_inner(ctx);
+    if (handle == NULL) {
+        goto err;
+    }
+    if (ctx->inner->watch_prefix_kv == NULL) {
+        LOG_WARN("kv_store can't mirror keys, %s is not shared", ctx->name);
+        // Retrying would not help
+        ctx->lead_retry_ns = UINT64_MAX;
+        flock(ctx->fd, LOCK_UN);
+        return -1;
+    }
+
+    // Keys are delivered before watch_prefix_kv() returns, the snapshot
+    // is published once all of them are in. Prefixes mirrored by a failed
+    // attempt are still watched and kept up to date
+    pthread_mutex_lock(&ctx->store_mtx);
+    ctx->seeding = true;
+    atomic_store(&ctx->leader, true);
+    pthread_mutex_unlock(&ctx->store_mtx);
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        kv_shm_mirror_t* mirror = &ctx->mirrors[i];
+        if (mirror->watched) {
+            continue;
+        }
+        if (ctx->inner->watch_prefix_kv(handle, ctx->prefixes[i], kv_shm_mirror_cb, mirror) != 0) {
+            LOG_ERROR("Failed to mirror %s into %s", ctx->prefixes[i], ctx->name);
+            pthread_mutex_lock(&ctx->store_mtx);
+            atomic_store(&ctx->leader, false);
+            ctx->seeding = false;
+            pthread_mutex_unlock(&ctx->store_mtx);
+            goto err;
+        }
+        mirror->watched = true;
+    }
+    pthread_mutex_lock(&ctx->store_mtx);
+    ctx->seeding = false;
+    kv_shm_publish(ctx);
+    pthread_mutex_unlock(&ctx->store_mtx);
+    ctx->lead_failures = 0;
+    LOG_INFO("Leading %s with %zu shared keys", ctx->name, ctx->store.count);
+    return 0;
+
+err:
+    if (ctx->lead_failures < 16) {
+        ctx->lead_failures++;
+    }
+    uint64_t backoff_ms = (uint64_t) KV_SHM_LEAD_BACKOFF_MS << (ctx->lead_failures - 1);
+    if (backoff_ms > KV_SHM_LEAD_BACKOFF_MAX_MS) {
+        backoff_ms = KV_SHM_LEAD_BACKOFF_MAX_MS;
+    }
+    ctx->lead_retry_ns = kv_shm_now_ns() + backoff_ms * 1000000ULL;
+    LOG_WARN("Failed to lead %s, retrying in %lu ms", ctx->name, (unsigned long) backoff_ms);
+    flock(ctx->fd, LOCK_UN);
+    return -1;
+}
+
+// Whether leadership may be taken, failed attempts are retried with backoff
+static bool kv_shm_lead_due(kv_shm_ctx_t* ctx) {
+    return ctx->lead_retry_ns != UINT64_MAX && kv_shm_now_ns() >= ctx->lead_retry_ns;
+}
+
+static bool kv_shm_try_lock(kv_shm_ctx_t* ctx) {
+    return flock(ctx->fd, LOCK_EX | LOCK_NB) == 0;
+}
+
+// Hands a put of a shared key to a watch callback
+static void kv_shm_notify(const char* key, const char* value, void* user_data) {
+    kv_shm_watch_t* watch = (kv_shm_watch_t*) user_data;
+    if (watch->kv_cb != NULL) {
+        watch->kv_cb(key, value, watch->user_data);
+        return;
+    }
+    if (value == NULL) {
+        // Like the kv_store, watch callbacks only get puts
+        return;
+    }
+    cJSON* val_json;
+    if (value[0] != '{') {
+        if (strlen(value) == 0) {
+            LOG_ERROR_0("Value shouldn't be empty. Empty string is not supported");
+            return;
+        }
+        val_json = cJSON_CreateObject();
+        if (val_json == NULL) {
+            LOG_ERROR_0("Create json object failed");
+            return;
+        }
+        cJSON_AddStringToObject(val_json, key, value);
+    } else {
+        val_json = cfgmgr_json_parse(value, strlen(value));
+        if (val_json == NULL) {
+            LOG_ERROR_0("cJSON Parse failed");
+            return;
+        }
+    }
+    config_t* config = config_new((void*) val_json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(val_json);
+        return;
+    }
+    watch->cb(key, config, watch->user_data);
+}
+
+// Notifies a watch of the differences between its last keys and the
+// current ones, which become its last keys
+static void kv_shm_dispatch(kv_shm_watch_t* watch, kv_table_t* current) {
+    kv_table_diff(&watch->last, current, kv_shm_notify, watch);
+    kv_table_move(&watch->last, current);
+}
+
+static void* kv_shm_poll(void* arg) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) arg;
+    while (true) {
+        pthread_mutex_lock(&ctx->poll_mtx);
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += KV_STORE_SHM_POLL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        while (!ctx->stop && pthread_cond_timedwait(&ctx->poll_cv, &ctx->poll_mtx, &deadline) == 0) {
+        }
+        bool stop = ctx->stop;
+        pthread_mutex_unlock(&ctx->poll_mtx);
+        if (stop) {
+            break;
+        }
+
+        // The lock of a leader is released when its process exits
+        if (!atomic_load(&ctx->leader) && kv_shm_lead_due(ctx) && kv_shm_try_lock(ctx)) {
+            LOG_INFO("Leader of %s is gone, taking the lead", ctx->name);
+            kv_shm_lead(ctx);
+        }
+
+        uint64_t seq = atomic_load_explicit(&ctx->header->seq, memory_order_acquire);
+        if (seq == atomic_load(&ctx->polled_seq) || (seq & 1)) {
+            continue;
+        }
+        atomic_store(&ctx->polled_seq, seq);
+        pthread_mutex_lock(&ctx->watch_mtx);
+        kv_shm_watch_t* watch = ctx->watches;
+        pthread_mutex_unlock(&ctx->watch_mtx);
+        for (; watch != NULL; watch = watch->next) {
+            kv_table_t current = {NULL, 0, 0};
+            if (kv_shm_read(ctx, watch->key, watch->prefix, &current) == 0) {
+                kv_shm_dispatch(watch, &current);
+            }
+            kv_table_clear(&current);
+        }
+    }
+    return NULL;
+}
+
+static void* kv_shm_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) client->handler;
+
+    ctx->fd = shm_open(ctx->name, O_RDWR | O_CREAT, 0660);
+    if (ctx->fd < 0) {
+        LOG_WARN("Failed to open %s: %s, reading from the kv_store", ctx->name, strerror(errno));
+        return (kv_shm_inner(ctx) != NULL) ? ctx : NULL;
+    }
+
+    // Followers wait for the leader's first snapshot, and take the lead if
+    // the process holding the lock exits before publishing it. Failures to
+    // lead are retried with backoff while waiting
+    bool ready = false;
+    for (int waited = 0; waited <= KV_STORE_SHM_WAIT_MS; waited += 10) {
+        if (kv_shm_lead_due(ctx) && kv_shm_try_lock(ctx) && kv_shm_lead(ctx) == 0) {
+            ready = true;
+            break;
+        }
+        if (kv_shm_map(ctx) == 0 &&
+                atomic_load_explicit(&ctx->header->magic, memory_order_acquire) == KV_SHM_MAGIC) {
+            ready = true;
+            break;
+        }
+        usleep(10000);
+    }
+    if (!ready) {
+        LOG_WARN("No snapshot was published to %s, reading from the kv_store", ctx->name);
+        return (kv_shm_inner(ctx) != NULL) ? ctx : NULL;
+    }
+
+    if (pthread_create(&ctx->poller, NULL, kv_shm_poll, ctx) != 0) {
+        LOG_ERROR_0("Failed to start the shared-memory poller");
+        return NULL;
+    }
+    ctx->poller_started = true;
+    ctx->active = true;
+    LOG_DEBUG("Sharing keys through %s as %s", ctx->name,
+              atomic_load(&ctx->leader) ? "leader" : "follower");
+    return ctx;
+}
+
+static char* kv_shm_get(void* handle, char* key) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    if (kv_shm_covers(ctx, key)) {
+        kv_table_t found = {NULL, 0, 0};
+        if (kv_shm_read(ctx, key, false, &found) == 0) {
+            char* value = NULL;
+            if (found.count == 1) {
+                value = found.items[0].value;
+                found.items[0].value = NULL;
+            } else {
+                LOG_DEBUG("Value is not found for the key %s", key);
+            }
+            kv_table_clear(&found);
+            return value;
+        }
+    }
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return NULL;
+    }
+    return ctx->inner->get(inner_handle, key);
+}
+
+static config_value_t* kv_shm_get_prefix(void* handle, char* key) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    kv_table_t found = {NULL, 0, 0};
+    if (!kv_shm_covers(ctx, key) || kv_shm_read(ctx, key, true, &found) != 0) {
+        void* inner_handle = kv_shm_inner(ctx);
+        if (inner_handle == NULL) {
+            return NULL;
+        }
+        return ctx->inner->get_prefix(inner_handle, key);
+    }
+
+    config_value_t* values = kv_table_to_prefix_value(&found, key);
+    kv_table_clear(&found);
+    return values;
+}
+
+static config_t* kv_shm_get_batch(void* handle, char** keys, const bool* prefixes, size_t count) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    config_t* values = NULL;
+    char** rest = NULL;
+    bool* rest_prefixes = NULL;
+    size_t rest_count = 0;
+    kv_table_t found = {NULL, 0, 0};
+    kv_table_t read = {NULL, 0, 0};
+
+    rest = (char**) malloc(sizeof(char*) * (count + 1));
+    rest_prefixes = (bool*) malloc(sizeof(bool) * (count + 1));
+    if (rest == NULL || rest_prefixes == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for batched keys");
+        goto err;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (kv_shm_covers(ctx, keys[i]) && kv_shm_read(ctx, keys[i], prefixes[i], &read) == 0) {
+            for (size_t j = 0; j < read.count; j++) {
+                if (kv_table_insert(&found, found.count, read.items[j].key,
+                                          read.items[j].value) != 0) {
+                    goto err;
+                }
+                read.items[j].key = NULL;
+                read.items[j].value = NULL;
+            }
+            kv_table_clear(&read);
+        } else {
+            rest[rest_count] = keys[i];
+            rest_prefixes[rest_count] = prefixes[i];
+            rest_count++;
+        }
+    }
+
+    if (rest_count > 0) {
+        void* inner_handle = kv_shm_inner(ctx);
+        if (inner_handle == NULL) {
+            goto err;
+        }
+        values = ctx->inner->get_batch(inner_handle, rest, rest_prefixes, rest_count);
+        if (values == NULL) {
+            goto err;
+        }
+    } else {
+        cJSON* all_values = cJSON_CreateObject();
+        if (all_values == NULL) {
+            LOG_ERROR_0("Create new json object failed");
+            goto err;
+        }
+        values = config_new(all_values, free_json, get_config_value, set_config_value);
+        if (values == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for batched values");
+            cJSON_Delete(all_values);
+            goto err;
+        }
+    }
+    for (size_t i = 0; i < found.count; i++) {
+        if (!cJSON_HasObjectItem((cJSON*) values->cfg, found.items[i].key)) {
+            cJSON_AddItemToObject((cJSON*) values->cfg, found.items[i].key,
+                                  cJSON_CreateString(found.items[i].value));
+        }
+    }
+
+    kv_table_clear(&found);
+    free(rest);
+    free(rest_prefixes);
+    return values;
+
+err:
+    kv_table_clear(&read);
+    kv_table_clear(&found);
+    if (rest != NULL) {
+        free(rest);
+    }
+    if (rest_prefixes != NULL) {
+        free(rest_prefixes);
+    }
+    return NULL;
+}
+
+// Registers a watch served from the segment, kv watches get the current
+// keys first
+// @return 0 on success, -1 if it must be served by the kv_store
+static int kv_shm_watch_add(kv_shm_ctx_t* ctx, const char* key, bool prefix,
+                            kv_store_watch_callback_t cb, kv_store_watch_kv_callback_t kv_cb,
+                            void* user_data) {
+    if (!kv_shm_covers(ctx, key)) {
+        return -1;
+    }
+    kv_shm_watch_t* watch = (kv_shm_watch_t*) calloc(1, sizeof(kv_shm_watch_t));
+    if (watch == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for shared-memory watch");
+        return -1;
+    }
+    watch->key = strdup(key);
+    if (watch->key == NULL || kv_shm_read(ctx, key, prefix, &watch->last) != 0) {
+        free(watch->key);
+        free(watch);
+        return -1;
+    }
+    watch->prefix = prefix;
+    watch->cb = cb;
+    watch->kv_cb = kv_cb;
+    watch->user_data = user_data;
+    if (kv_cb != NULL) {
+        for (size_t i = 0; i < watch->last.count; i++) {
+            kv_cb(watch->last.items[i].key, watch->last.items[i].value, user_data);
+        }
+    }
+    pthread_mutex_lock(&ctx->watch_mtx);
+    watch->next = ctx->watches;
+    ctx->watches = watch;
+    pthread_mutex_unlock(&ctx->watch_mtx);
+    // Snapshots published since the read above reach the new watch on the
+    // next poll
+    atomic_store(&ctx->polled_seq, 0);
+    return 0;
+}
+
+static void kv_shm_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    if (kv_shm_watch_add(ctx, key, false, cb, NULL, user_data) == 0) {
+        return;
+    }
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle != NULL) {
+        ctx->inner->watch(inner_handle, key, cb, user_data);
+    }
+}
+
+static void kv_shm_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    if (kv_shm_watch_add(ctx, key, true, cb, NULL, user_data) == 0) {
+        return;
+    }
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle != NULL) {
+        ctx->inner->watch_prefix(inner_handle, key, cb, user_data);
+    }
+}
+
+static int kv_shm_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                  void* user_data) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    if (kv_shm_watch_add(ctx, key, true, NULL, cb, user_data) == 0) {
+        return 0;
+    }
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->watch_prefix_kv(inner_handle, key, cb, user_data);
+}
+
+// Writes and leases go to the kv_store, writes of shared keys reach the
+// segment through the leader's watch
+
+static int kv_shm_put(void* handle, char* key, char* value) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->put(inner_handle, key, value);
+}
+
+static int kv_shm_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->put_with_lease(inner_handle, key, value, lease_id);
+}
+
+static int kv_shm_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->grant_lease(inner_handle, ttl, lease_id);
+}
+
+static int kv_shm_keepalive(void* handle, int64_t lease_id) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->keepalive(inner_handle, lease_id);
+}
+
+static int kv_shm_revoke_lease(void* handle, int64_t lease_id) {
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) handle;
+    void* inner_handle = kv_shm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->revoke_lease(inner_handle, lease_id);
+}
+
+static void kv_shm_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_shm_ctx_t* ctx = (kv_shm_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    if (ctx->poller_started) {
+        pthread_mutex_lock(&ctx->poll_mtx);
+        ctx->stop = true;
+        pthread_cond_signal(&ctx->poll_cv);
+        pthread_mutex_unlock(&ctx->poll_mtx);
+        pthread_join(ctx->poller, NULL);
+    }
+    // Inner client is freed first, which joins the watch threads
+    // updating the leader's mirror
+    kv_client_free(ctx->inner);
+    ctx->inner = NULL;
+    kv_shm_watch_t* watch = ctx->watches;
+    while (watch != NULL) {
+        kv_shm_watch_t* next = watch->next;
+        kv_table_clear(&watch->last);
+        free(watch->key);
+        free(watch);
+        watch = next;
+    }
+    ctx->watches = NULL;
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        kv_table_clear(&ctx->mirrors[i].resync);
+    }
+    free(ctx->mirrors);
+    kv_table_clear(&ctx->store);
+    free(ctx->blob);
+    // The segment stays for the other processes, closing it releases
+    // the lead
+    if (ctx->header != NULL) {
+        munmap(ctx->header, ctx->map_size);
+    }
+    if (ctx->fd >= 0) {
+        close(ctx->fd);
+    }
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        free(ctx->prefixes[i]);
+    }
+    free(ctx->prefixes);
+    free(ctx->name);
+    pthread_mutex_destroy(&ctx->inner_mtx);
+    pthread_mutex_destroy(&ctx->store_mtx);
+    pthread_mutex_destroy(&ctx->watch_mtx);
+    pthread_mutex_destroy(&ctx->poll_mtx);
+    pthread_cond_destroy(&ctx->poll_cv);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+// Splits the comma separated prefixes into ctx->prefixes
+static int kv_shm_parse_prefixes(kv_shm_ctx_t* ctx, const char* prefixes) {
+    char* copy = strdup(prefixes);
+    if (copy == NULL) {
+        LOG_ERROR_0("Failed to copy the prefixes to share");
+        return -1;
+    }
+    size_t max = 1;
+    for (const char* c = prefixes; *c != '\0'; c++) {
+        if (*c == ',') {
+            max++;
+        }
+    }
+    ctx->prefixes = (char**) calloc(max, sizeof(char*));
+    ctx->mirrors = (kv_shm_mirror_t*) calloc(max, sizeof(kv_shm_mirror_t));
+    if (ctx->prefixes == NULL || ctx->mirrors == NULL) {
+        LOG_ERROR_0("Failed to allocate the prefixes to share");
+        free(copy);
+        return -1;
+    }
+    char* saveptr = NULL;
+    for (char* token = strtok_r(copy, ",", &saveptr); token != NULL;
+            token = strtok_r(NULL, ",", &saveptr)) {
+        trim(token);
+        if (strlen(token) == 0) {
+            continue;
+        }
+        ctx->prefixes[ctx->prefix_count] = strdup(token);
+        if (ctx->prefixes[ctx->prefix_count] == NULL) {
+            LOG_ERROR_0("Failed to copy a prefix to share");
+            free(copy);
+            return -1;
+        }
+        ctx->mirrors[ctx->prefix_count].ctx = ctx;
+        ctx->mirrors[ctx->prefix_count].prefix = ctx->prefixes[ctx->prefix_count];
+        ctx->prefix_count++;
+    }
+    free(copy);
+    if (ctx->prefix_count == 0) {
+        LOG_ERROR_0("No prefix to share");
+        return -1;
+    }
+    return 0;
+}
+
+kv_store_client_t* kv_store_shm_wrap(kv_store_client_t* inner, const char* name, const char* prefixes) {
+    kv_store_client_t* client = NULL;
+    kv_shm_ctx_t* ctx = NULL;
+    bool mutexes = false;
+
+    if (inner == NULL) {
+        LOG_ERROR_0("kv_store_client to decorate is NULL");
+        return NULL;
+    }
+    if (name == NULL || name[0] != '/' || strchr(name + 1, '/') != NULL) {
+        LOG_ERROR("Invalid shared-memory name %s, expected /<name>", (name != NULL) ? name : "(null)");
+        return NULL;
+    }
+    if (prefixes == NULL) {
+        LOG_ERROR_0("Prefixes to share are NULL");
+        return NULL;
+    }
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (kv_shm_ctx_t*) calloc(1, sizeof(kv_shm_ctx_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Shared-memory context: Failed to allocate Memory");
+        goto err;
+    }
+    ctx->fd = -1;
+    ctx->name = strdup(name);
+    if (ctx->name == NULL) {
+        LOG_ERROR_0("Failed to copy the shared-memory name");
+        goto err;
+    }
+    if (kv_shm_parse_prefixes(ctx, prefixes) != 0) {
+        goto err;
+    }
+    if (pthread_mutex_init(&ctx->inner_mtx, NULL) != 0 ||
+            pthread_mutex_init(&ctx->store_mtx, NULL) != 0 ||
+            pthread_mutex_init(&ctx->watch_mtx, NULL) != 0 ||
+            pthread_mutex_init(&ctx->poll_mtx, NULL) != 0 ||
+            pthread_cond_init(&ctx->poll_cv, NULL) != 0) {
+        LOG_ERROR_0("Failed to initialize shared-memory locks");
+        goto err;
+    }
+    mutexes = true;
+    ctx->inner = inner;
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_shm_init;
+    client->get = kv_shm_get;
+    client->get_prefix = kv_shm_get_prefix;
+    client->get_prefix_kv = NULL;
+    client->get_batch = (inner->get_batch != NULL) ? kv_shm_get_batch : NULL;
+    client->put = kv_shm_put;
+    client->watch = kv_shm_watch;
+    client->watch_prefix = kv_shm_watch_prefix;
+    client->watch_prefix_kv = (inner->watch_prefix_kv != NULL) ? kv_shm_watch_prefix_kv : NULL;
+    client->grant_lease = kv_shm_grant_lease;
+    client->put_with_lease = kv_shm_put_with_lease;
+    client->keepalive = kv_shm_keepalive;
+    client->revoke_lease = kv_shm_revoke_lease;
+    client->deinit = kv_shm_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        if (mutexes) {
+            pthread_mutex_destroy(&ctx->inner_mtx);
+            pthread_mutex_destroy(&ctx->store_mtx);
+            pthread_mutex_destroy(&ctx->watch_mtx);
+            pthread_mutex_destroy(&ctx->poll_mtx);
+            pthread_cond_destroy(&ctx->poll_cv);
+        }
+        for (size_t i = 0; i < ctx->prefix_count; i++) {
+            free(ctx->prefixes[i]);
+        }
+        free(ctx->prefixes);
+        free(ctx->mirrors);
+        free(ctx->name);
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
+
+bool kv_store_shm_leader(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_shm_init) {
+        return false;
+    }
+    return atomic_load(&((kv_shm_ctx_t*) client->handler)->leader);
+}
+
+bool kv_store_shm_connected(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_shm_init) {
+        return false;
+    }
+    return atomic_load(&((kv_shm_ctx_t*) client->handler)->connected);
+}
@@ -0,0 +1,242 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+/**
+ * @file
+ * @brief Sorted key-value table implementation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <cjson/cJSON.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/json_config.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+
+static bool kv_table_same(const char* a, const char* b) {
+    return (a == NULL || b == NULL) ? a == b : strcmp(a, b) == 0;
+}
+
+size_t kv_table_lower_bound(const kv_table_t* table, const char* key) {
+    size_t lo = 0;
+    size_t hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(table->items[mid].key, key) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+kv_table_entry_t* kv_table_find(const kv_table_t* table, const char* key) {
+    size_t pos = kv_table_lower_bound(table, key);
+    if (pos < table->count && strcmp(table->items[pos].key, key) == 0) {
+        return &table->items[pos];
+    }
+    return NULL;
+}
+
+int kv_table_insert(kv_table_t* table, size_t pos, char* key, char* value) {
+    if (table->count == table->cap) {
+        size_t cap = (table->cap == 0) ? 16 : table->cap * 2;
+        kv_table_entry_t* items = (kv_table_entry_t*) realloc(
+                table->items, cap * sizeof(kv_table_entry_t));
+        if (items == NULL) {
+            return -1;
+        }
+        table->items = items;
+        table->cap = cap;
+    }
+    memmove(&table->items[pos + 1], &table->items[pos],
+            (table->count - pos) * sizeof(kv_table_entry_t));
+    table->items[pos].key = key;
+    table->items[pos].value = value;
+    table->count++;
+    return 0;
+}
+
+void kv_table_remove_at(kv_table_t* table, size_t pos) {
+    free(table->items[pos].key);
+    free(table->items[pos].value);
+    memmove(&table->items[pos], &table->items[pos + 1],
+            (table->count - pos - 1) * sizeof(kv_table_entry_t));
+    table->count--;
+}
+
+int kv_table_set(kv_table_t* table, const char* key, const char* value) {
+    size_t pos = kv_table_lower_bound(table, key);
+    bool found = pos < table->count && strcmp(table->items[pos].key, key) == 0;
+    if (found && kv_table_same(table->items[pos].value, value)) {
+        return 0;
+    }
+    char* value_copy = NULL;
+    if (value != NULL && (value_copy = strdup(value)) == NULL) {
+        return -1;
+    }
+    if (found) {
+        free(table->items[pos].value);
+        table->items[pos].value = value_copy;
+        return 1;
+    }
+    char* key_copy = strdup(key);
+    if (key_copy == NULL || kv_table_insert(table, pos, key_copy, value_copy) != 0) {
+        free(key_copy);
+        free(value_copy);
+        return -1;
+    }
+    return 1;
+}
+
+int kv_table_apply(kv_table_t* table, const char* key, const char* value) {
+    if (value != NULL) {
+        return kv_table_set(table, key, value);
+    }
+    size_t pos = kv_table_lower_bound(table, key);
+    if (pos < table->count && strcmp(table->items[pos].key, key) == 0) {
+        kv_table_remove_at(table, pos);
+        return 1;
+    }
+    return 0;
+}
+
+static int kv_table_cmp(const void* a, const void* b) {
+    return strcmp(((const kv_table_entry_t*) a)->key, ((const kv_table_entry_t*) b)->key);
+}
+
+void kv_table_sort(kv_table_t* table) {
+    if (table->count > 1) {
+        qsort(table->items, table->count, sizeof(kv_table_entry_t), kv_table_cmp);
+    }
+}
+
+void kv_table_clear(kv_table_t* table) {
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->items[i].key);
+        free(table->items[i].value);
+    }
+    free(table->items);
+    table->items = NULL;
+    table->count = 0;
+    table->cap = 0;
+}
+
+void kv_table_move(kv_table_t* dst, kv_table_t* src) {
+    kv_table_clear(dst);
+    *dst = *src;
+    src->items = NULL;
+    src->count = 0;
+    src->cap = 0;
+}
+
+void kv_table_diff(const kv_table_t* from, const kv_table_t* to, kv_table_diff_cb_t cb,
+                   void* user_data) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < from->count || j < to->count) {
+        int cmp = (i == from->count) ? 1 : (j == to->count) ? -1
+                  : strcmp(from->items[i].key, to->items[j].key);
+        if (cmp < 0) {
+            cb(from->items[i].key, NULL, user_data);
+            i++;
+        } else if (cmp > 0) {
+            cb(to->items[j].key, to->items[j].value, user_data);
+            j++;
+        } else {
+            if (!kv_table_same(from->items[i].value, to->items[j].value)) {
+                cb(to->items[j].key, to->items[j].value, user_data);
+            }
+            i++;
+            j++;
+        }
+    }
+}
+
+int kv_table_replace_prefix(kv_table_t* table, const char* prefix, kv_table_t* keys) {
+    size_t prefix_len = strlen(prefix);
+    size_t first = kv_table_lower_bound(table, prefix);
+    size_t last = first;
+    while (last < table->count && strncmp(table->items[last].key, prefix, prefix_len) == 0) {
+        last++;
+    }
+    size_t count = table->count - (last - first) + keys->count;
+    if (count > table->cap) {
+        kv_table_entry_t* items = (kv_table_entry_t*) realloc(
+                table->items, count * sizeof(kv_table_entry_t));
+        if (items == NULL) {
+            return -1;
+        }
+        table->items = items;
+        table->cap = count;
+    }
+    for (size_t i = first; i < last; i++) {
+        free(table->items[i].key);
+        free(table->items[i].value);
+    }
+    memmove(&table->items[first + keys->count], &table->items[last],
+            (table->count - last) * sizeof(kv_table_entry_t));
+    if (keys->count > 0) {
+        memcpy(&table->items[first], keys->items, keys->count * sizeof(kv_table_entry_t));
+    }
+    table->count = count;
+    free(keys->items);
+    keys->items = NULL;
+    keys->count = 0;
+    keys->cap = 0;
+    return 0;
+}
+
+config_value_t* kv_table_to_prefix_value(const kv_table_t* table, const char* prefix) {
+    size_t prefix_len = strlen(prefix);
+    size_t first = kv_table_lower_bound(table, prefix);
+    size_t last = first;
+    while (last < table->count && strncmp(table->items[last].key, prefix, prefix_len) == 0) {
+        last++;
+    }
+    if (last == first) {
+        LOG_DEBUG("Key not found %s", prefix);
+        return NULL;
+    }
+    cJSON* array = cJSON_CreateArray();
+    if (array == NULL) {
+        LOG_ERROR_0("Create new json array failed");
+        return NULL;
+    }
+    for (size_t i = first; i < last; i++) {
+        cJSON* item = cJSON_CreateString(table->items[i].value);
+        if (item == NULL) {
+            LOG_ERROR_0("Failed to copy prefix value");
+            cJSON_Delete(array);
+            return NULL;
+        }
+        cJSON_AddItemToArray(array, item);
+    }
+    config_value_t* values = config_value_new_array(
+            (void*) array, last - first, get_array_item, NULL);
+    if (values == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for prefix values");
+        cJSON_Delete(array);
+    }
+    return values;
+}
@@ -0,0 +1,1208 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief KV Store warm-start snapshot implementation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cjson/cJSON.h>
+#include <openssl/crypto.h>
+#include <eii/utils/json_config.h>
+#include <eii/utils/string.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_warm.h>
+#include <eii/config_manager/kv_store_plugin/kv_store_table.h>
+#include <eii/config_manager/cfgmgr_json.h>
+#include <eii/config_manager/cfgmgr_seal.h>
+
+// Snapshot files are sealed, see cfgmgr_seal.h, with this magic ("EIIW")
+// and version. Their data is a JSON object of the scope, the recorded keys
+// and the complete prefixes.
+#define KV_WARM_MAGIC       0x57494945u
+#define KV_WARM_VERSION     1
+
+// Milliseconds the writer waits for more changes before writing them
+#define KV_WARM_WRITE_DELAY_MS  100
+
+struct kv_warm_ctx;
+
+typedef struct kv_warm_watch {
+    struct kv_warm_ctx* ctx;
+    char* key;
+    bool prefix;
+    kv_store_watch_callback_t cb;
+    kv_store_watch_kv_callback_t kv_cb;
+    void* user_data;
+    // Set once registered with the wrapped client, under ctx->mtx
+    bool registered;
+
+    // Guards the fields below, held while the callbacks run
+    pthread_mutex_t mtx;
+    // Keys last delivered, the changes are notified
+    kv_table_t last;
+    // While registering or resyncing: keys delivered by watch_prefix_kv()
+    bool seeding;
+    bool resyncing;
+    kv_table_t seeds;
+    // Watches of the kv_store only notify later changes, the keys of
+    // watches registered live are not notified
+    bool quiet_seeds;
+    struct kv_warm_watch* next;
+} kv_warm_watch_t;
+
+typedef struct kv_warm_ctx {
+    kv_store_client_t* inner;
+    void* inner_handle;
+    pthread_mutex_t inner_mtx;
+
+    char* path;
+    char* scope;
+    unsigned char key[KV_STORE_WARM_KEY_SIZE];
+    bool encrypted;
+    char** secrets;
+    size_t secret_count;
+
+    // Guards the recorded keys, the watch list and the writer state
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    // Recorded keys, with a NULL value for keys known to be absent
+    kv_table_t entries;
+    // Prefixes whose every key is recorded
+    char** prefixes;
+    size_t prefix_count;
+    size_t prefix_cap;
+    bool dirty;
+    bool stop;
+    kv_warm_watch_t* watches;
+
+    // Serializes the writes of the snapshot file
+    pthread_mutex_t write_mtx;
+
+    _Atomic bool warm;
+    _Atomic bool live;
+    pthread_t thread;
+    bool thread_started;
+} kv_warm_ctx_t;
+
+static bool kv_warm_starts_with(const char* key, const char* prefix) {
+    return strncmp(key, prefix, strlen(prefix)) == 0;
+}
+
+// Whether a key or prefix may hold secrets which can't be recorded
+static bool kv_warm_secret(kv_warm_ctx_t* ctx, const char* key, bool prefix) {
+    if (ctx->encrypted) {
+        return false;
+    }
+    for (size_t i = 0; i < ctx->secret_count; i++) {
+        if (kv_warm_starts_with(key, ctx->secrets[i]) ||
+                (prefix && kv_warm_starts_with(ctx->secrets[i], key))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether every key of a prefix is recorded, called with ctx->mtx held
+static bool kv_warm_complete(kv_warm_ctx_t* ctx, const char* key) {
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        if (kv_warm_starts_with(key, ctx->prefixes[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void kv_warm_mark_dirty(kv_warm_ctx_t* ctx) {
+    ctx->dirty = true;
+    pthread_cond_signal(&ctx->cv);
+}
+
+// Records the value of a key read, NULL if it is absent
+static void kv_warm_record(kv_warm_ctx_t* ctx, const char* key, const char* value) {
+    if (kv_warm_secret(ctx, key, false)) {
+        return;
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    int changed = kv_table_set(&ctx->entries, key, value);
+    if (changed < 0) {
+        LOG_ERROR("Failed to record %s", key);
+    } else if (changed > 0) {
+        kv_warm_mark_dirty(ctx);
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+}
+
+// Records every key of a prefix, keys of the prefix not in @p found are
+// recorded as absent
+static void kv_warm_record_prefix(kv_warm_ctx_t* ctx, const char* prefix, const kv_table_t* found) {
+    if (kv_warm_secret(ctx, prefix, true)) {
+        return;
+    }
+    pthread_mutex_lock(&ctx->mtx);
+    bool changed = false;
+    for (size_t i = kv_table_lower_bound(&ctx->entries, prefix);
+         i < ctx->entries.count && kv_warm_starts_with(ctx->entries.items[i].key, prefix); i++) {
+        kv_table_entry_t* entry = &ctx->entries.items[i];
+        if (entry->value != NULL && kv_table_find(found, entry->key) == NULL) {
+            free(entry->value);
+            entry->value = NULL;
+            changed = true;
+        }
+    }
+    for (size_t i = 0; i < found->count; i++) {
+        int rc = kv_table_set(&ctx->entries, found->items[i].key, found->items[i].value);
+        if (rc < 0) {
+            LOG_ERROR("Failed to record %s", prefix);
+            pthread_mutex_unlock(&ctx->mtx);
+            return;
+        }
+        changed = changed || rc > 0;
+    }
+    if (!kv_warm_complete(ctx, prefix)) {
+        if (ctx->prefix_count == ctx->prefix_cap) {
+            size_t cap = (ctx->prefix_cap == 0) ? 8 : ctx->prefix_cap * 2;
+            char** prefixes = (char**) realloc(ctx->prefixes, cap * sizeof(char*));
+            if (prefixes == NULL) {
+                LOG_ERROR("Failed to record %s", prefix);
+                pthread_mutex_unlock(&ctx->mtx);
+                return;
+            }
+            ctx->prefixes = prefixes;
+            ctx->prefix_cap = cap;
+        }
+        char* copy = strdup(prefix);
+        if (copy == NULL) {
+            LOG_ERROR("Failed to record %s", prefix);
+            pthread_mutex_unlock(&ctx->mtx);
+            return;
+        }
+        ctx->prefixes[ctx->prefix_count++] = copy;
+        changed = true;
+    }
+    if (changed) {
+        kv_warm_mark_dirty(ctx);
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+}
+
+// Copies the recorded keys present under a key or prefix
+// @return 0 on success, -1 if they are not all recorded
+static int kv_warm_lookup(kv_warm_ctx_t* ctx, const char* key, bool prefix, kv_table_t* out) {
+    int ret = -1;
+    pthread_mutex_lock(&ctx->mtx);
+    if (!prefix) {
+        kv_table_entry_t* entry = kv_table_find(&ctx->entries, key);
+        if (entry != NULL || kv_warm_complete(ctx, key)) {
+            ret = 0;
+            if (entry != NULL && entry->value != NULL && kv_table_set(out, key, entry->value) < 0) {
+                ret = -1;
+            }
+        }
+    } else if (kv_warm_complete(ctx, key)) {
+        ret = 0;
+        for (size_t i = kv_table_lower_bound(&ctx->entries, key);
+             i < ctx->entries.count && kv_warm_starts_with(ctx->entries.items[i].key, key); i++) {
+            kv_table_entry_t* entry = &ctx->entries.items[i];
+            if (entry->value != NULL && kv_table_set(out, entry->key, entry->value) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    return ret;
+}
+
+static void* kv_warm_inner(kv_warm_ctx_t* ctx) {
+    pthread_mutex_lock(&ctx->inner_mtx);
+    if (ctx->inner_handle == NULL) {
+        ctx->inner_handle = ctx->inner->init(ctx->inner);
+        if (ctx->inner_handle == NULL) {
+            LOG_ERROR_0("Failed to initialize the kv_store behind the snapshot");
+        }
+    }
+    void* handle = ctx->inner_handle;
+    pthread_mutex_unlock(&ctx->inner_mtx);
+    return handle;
+}
+
+// Whether reads are answered from the snapshot
+static bool kv_warm_serving(kv_warm_ctx_t* ctx) {
+    return !atomic_load(&ctx->live);
+}
+
+// Hands a put or delete to a watch callback, called with watch->mtx held
+static void kv_warm_notify(const char* key, const char* value, void* user_data) {
+    kv_warm_watch_t* watch = (kv_warm_watch_t*) user_data;
+    if (watch->kv_cb != NULL) {
+        watch->kv_cb(key, value, watch->user_data);
+        return;
+    }
+    if (value == NULL) {
+        // Like the kv_store, watch callbacks only get puts
+        return;
+    }
+    cJSON* val_json;
+    if (value[0] != '{') {
+        if (strlen(value) == 0) {
+            LOG_ERROR_0("Value shouldn't be empty. Empty string is not supported");
+            return;
+        }
+        val_json = cJSON_CreateObject();
+        if (val_json == NULL) {
+            LOG_ERROR_0("Create json object failed");
+            return;
+        }
+        cJSON_AddStringToObject(val_json, key, value);
+    } else {
+        val_json = cfgmgr_json_parse(value, strlen(value));
+        if (val_json == NULL) {
+            LOG_ERROR_0("cJSON Parse failed");
+            return;
+        }
+    }
+    config_t* config = config_new((void*) val_json, free_json, get_config_value, set_config_value);
+    if (config == NULL) {
+        LOG_ERROR_0("Failed to initialize configuration object");
+        cJSON_Delete(val_json);
+        return;
+    }
+    watch->cb(key, config, watch->user_data);
+}
+
+// Replaces the last keys of a watch with its seeds, recording them and
+// notifying the changes. Called with watch->mtx held
+static void kv_warm_watch_settle(kv_warm_ctx_t* ctx, kv_warm_watch_t* watch, bool notify) {
+    if (watch->prefix) {
+        kv_warm_record_prefix(ctx, watch->key, &watch->seeds);
+    } else {
+        kv_table_entry_t* seed = kv_table_find(&watch->seeds, watch->key);
+        kv_warm_record(ctx, watch->key, (seed != NULL) ? seed->value : NULL);
+    }
+    if (notify) {
+        kv_table_diff(&watch->last, &watch->seeds, kv_warm_notify, watch);
+    }
+    kv_table_move(&watch->last, &watch->seeds);
+}
+
+// Watch callback of the wrapped client
+static void kv_warm_watch_cb(const char* key, const char* value, void* cb_user_data) {
+    kv_warm_watch_t* watch = (kv_warm_watch_t*) cb_user_data;
+    if (key == NULL) {
+        // Resync of the wrapped client, the keys it does not deliver
+        // again were deleted. Resyncs while registering restart the seeds
+        pthread_mutex_lock(&watch->mtx);
+        if (value != NULL) {
+            kv_table_clear(&watch->seeds);
+            watch->resyncing = !watch->seeding;
+        } else if (watch->resyncing) {
+            watch->resyncing = false;
+            kv_warm_watch_settle(watch->ctx, watch, true);
+        }
+        pthread_mutex_unlock(&watch->mtx);
+        return;
+    }
+    if (!watch->prefix && strcmp(key, watch->key) != 0) {
+        // Exact keys are watched as a prefix
+        return;
+    }
+    pthread_mutex_lock(&watch->mtx);
+    if (!watch->resyncing) {
+        kv_warm_record(watch->ctx, key, value);
+    }
+    if (watch->seeding || watch->resyncing) {
+        if (kv_table_apply(&watch->seeds, key, value) < 0) {
+            LOG_ERROR("Failed to allocate memory for the watch of %s", watch->key);
+        }
+    } else if (kv_table_apply(&watch->last, key, value) != 0) {
+        kv_warm_notify(key, value, watch);
+    }
+    pthread_mutex_unlock(&watch->mtx);
+}
+
+// Registers a watch with the wrapped client, and notifies it of every
+// key which changed since its last keys
+static int kv_warm_watch_register(kv_warm_ctx_t* ctx, kv_warm_watch_t* watch, void* handle) {
+    pthread_mutex_lock(&watch->mtx);
+    watch->seeding = true;
+    kv_table_clear(&watch->seeds);
+    pthread_mutex_unlock(&watch->mtx);
+
+    int rc = ctx->inner->watch_prefix_kv(handle, watch->key, kv_warm_watch_cb, watch);
+
+    pthread_mutex_lock(&watch->mtx);
+    watch->seeding = false;
+    if (rc != 0) {
+        LOG_ERROR("Failed to watch %s", watch->key);
+        kv_table_clear(&watch->seeds);
+        pthread_mutex_unlock(&watch->mtx);
+        return -1;
+    }
+    kv_warm_watch_settle(ctx, watch, !watch->quiet_seeds);
+    pthread_mutex_unlock(&watch->mtx);
+    return 0;
+}
+
+static int kv_warm_payload(kv_warm_ctx_t* ctx, char** payload) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON* keys = cJSON_CreateObject();
+    cJSON* prefixes = cJSON_CreateArray();
+    if (root == NULL || keys == NULL || prefixes == NULL) {
+        cJSON_Delete(root);
+        cJSON_Delete(keys);
+        cJSON_Delete(prefixes);
+        return -1;
+    }
+    cJSON_AddStringToObject(root, "scope", ctx->scope);
+    cJSON_AddItemToObject(root, "keys", keys);
+    cJSON_AddItemToObject(root, "prefixes", prefixes);
+    pthread_mutex_lock(&ctx->mtx);
+    for (size_t i = 0; i < ctx->entries.count; i++) {
+        kv_table_entry_t* entry = &ctx->entries.items[i];
+        cJSON_AddItemToObject(keys, entry->key, (entry->value != NULL)
+                              ? cJSON_CreateString(entry->value) : cJSON_CreateNull());
+    }
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        cJSON_AddItemToArray(prefixes, cJSON_CreateString(ctx->prefixes[i]));
+    }
+    ctx->dirty = false;
+    pthread_mutex_unlock(&ctx->mtx);
+    *payload = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return (*payload != NULL) ? 0 : -1;
+}
+
+static int kv_warm_write(kv_warm_ctx_t* ctx) {
+    char* payload = NULL;
+    unsigned char* image = NULL;
+    char* tmp_path = NULL;
+    size_t size = 0;
+    int fd = -1;
+    int ret = -1;
+
+    pthread_mutex_lock(&ctx->write_mtx);
+    if (kv_warm_payload(ctx, &payload) != 0) {
+        LOG_ERROR_0("Failed to serialize the snapshot");
+        goto err;
+    }
+    image = (unsigned char*) cfgmgr_seal(KV_WARM_MAGIC, KV_WARM_VERSION,
+                                         ctx->encrypted ? ctx->key : NULL,
+                                         payload, strlen(payload), &size);
+    if (image == NULL) {
+        goto err;
+    }
+    size_t tmp_len = strlen(ctx->path) + strlen(".tmp") + 1;
+    tmp_path = concat_s(tmp_len, 2, ctx->path, ".tmp");
+    if (tmp_path == NULL) {
+        LOG_ERROR_0("Concatenation of the snapshot path and .tmp failed");
+        goto err;
+    }
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create %s: %s", tmp_path, strerror(errno));
+        goto err;
+    }
+    for (size_t written = 0; written < size;) {
+        ssize_t rc = write(fd, image + written, size - written);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            LOG_ERROR("Failed to write %s: %s", tmp_path, strerror(errno));
+            goto err;
+        }
+        written += (size_t) rc;
+    }
+    // The snapshot is replaced only once complete on disk
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        fd = -1;
+        LOG_ERROR("Failed to flush %s: %s", tmp_path, strerror(errno));
+        goto err;
+    }
+    fd = -1;
+    if (rename(tmp_path, ctx->path) != 0) {
+        LOG_ERROR("Failed to replace %s: %s", ctx->path, strerror(errno));
+        goto err;
+    }
+    ret = 0;
+
+err:
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (ret != 0 && tmp_path != NULL) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    if (image != NULL) {
+        free(image);
+    }
+    if (payload != NULL) {
+        // The payload may hold secrets
+        OPENSSL_cleanse(payload, strlen(payload));
+        free(payload);
+    }
+    pthread_mutex_unlock(&ctx->write_mtx);
+    return ret;
+}
+
+// Loads the snapshot file into the recorded keys
+static int kv_warm_load(kv_warm_ctx_t* ctx) {
+    unsigned char* image = NULL;
+    char* payload = NULL;
+    cJSON* root = NULL;
+    int ret = -1;
+    struct stat st;
+
+    int fd = open(ctx->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            LOG_WARN("Failed to open %s: %s", ctx->path, strerror(errno));
+        }
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size > KV_STORE_WARM_MAX_SIZE) {
+        LOG_WARN("%s is not a valid snapshot", ctx->path);
+        goto err;
+    }
+    image = (unsigned char*) malloc((size_t) st.st_size + 1);
+    if (image == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for the snapshot");
+        goto err;
+    }
+    size_t size = 0;
+    while (size < (size_t) st.st_size) {
+        ssize_t rc = read(fd, image + size, (size_t) st.st_size - size);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            LOG_WARN("Failed to read %s", ctx->path);
+            goto err;
+        }
+        size += (size_t) rc;
+    }
+    size_t length = 0;
+    payload = (char*) cfgmgr_seal_open(KV_WARM_MAGIC, KV_WARM_VERSION,
+                                       ctx->encrypted ? ctx->key : NULL,
+                                       image, size, &length, ctx->path);
+    if (payload == NULL) {
+        goto err;
+    }
+    root = cfgmgr_json_parse(payload, length);
+    cJSON* scope = cJSON_GetObjectItem(root, "scope");
+    cJSON* keys = cJSON_GetObjectItem(root, "keys");
+    cJSON* prefixes = cJSON_GetObjectItem(root, "prefixes");
+    if (!cJSON_IsString(scope) || !cJSON_IsObject(keys) || !cJSON_IsArray(prefixes)) {
+        LOG_WARN("%s is not a valid snapshot", ctx->path);
+        goto err;
+    }
+    if (strcmp(scope->valuestring, ctx->scope) != 0) {
+        LOG_WARN("%s is a snapshot of %s, ignoring it", ctx->path, scope->valuestring);
+        goto err;
+    }
+    for (cJSON* item = keys->child; item != NULL; item = item->next) {
+        if (kv_warm_secret(ctx, item->string, false)) {
+            continue;
+        }
+        if (kv_table_set(&ctx->entries, item->string,
+                        cJSON_IsString(item) ? item->valuestring : NULL) < 0) {
+            LOG_ERROR_0("Failed to allocate memory for the snapshot");
+            goto err;
+        }
+    }
+    for (cJSON* item = prefixes->child; item != NULL; item = item->next) {
+        if (!cJSON_IsString(item) || kv_warm_secret(ctx, item->valuestring, true)) {
+            continue;
+        }
+        kv_table_t none = {NULL, 0, 0};
+        kv_warm_record_prefix(ctx, item->valuestring, &none);
+        // Recording a prefix marks its keys absent, they are set again
+        for (cJSON* key = keys->child; key != NULL; key = key->next) {
+            if (kv_warm_starts_with(key->string, item->valuestring) &&
+                    kv_table_set(&ctx->entries, key->string,
+                                cJSON_IsString(key) ? key->valuestring : NULL) < 0) {
+                LOG_ERROR_0("Failed to allocate memory for the snapshot");
+                goto err;
+            }
+        }
+    }
+    ctx->dirty = false;
+    ret = 0;
+
+err:
+    close(fd);
+    if (root != NULL) {
+        cJSON_Delete(root);
+    }
+    if (payload != NULL) {
+        OPENSSL_cleanse(payload, strlen(payload));
+        free(payload);
+    }
+    free(image);
+    if (ret != 0) {
+        kv_table_clear(&ctx->entries);
+        for (size_t i = 0; i < ctx->prefix_count; i++) {
+            free(ctx->prefixes[i]);
+        }
+        ctx->prefix_count = 0;
+    }
+    return ret;
+}
+
+// Waits until stopped or until @p ms elapsed, called with ctx->mtx held
+// @return true if stopped
+static bool kv_warm_wait(kv_warm_ctx_t* ctx, long ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += ms * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    while (!ctx->stop && pthread_cond_timedwait(&ctx->cv, &ctx->mtx, &deadline) == 0) {
+    }
+    return ctx->stop;
+}
+
+// Re-reads the recorded keys no watch keeps current
+static void kv_warm_refresh(kv_warm_ctx_t* ctx, void* handle) {
+    kv_table_t keys = {NULL, 0, 0};
+    char** prefixes = NULL;
+    size_t prefix_count = 0;
+
+    pthread_mutex_lock(&ctx->mtx);
+    for (size_t i = 0; i < ctx->entries.count; i++) {
+        bool watched = false;
+        for (kv_warm_watch_t* watch = ctx->watches; watch != NULL && !watched; watch = watch->next) {
+            watched = watch->prefix ? kv_warm_starts_with(ctx->entries.items[i].key, watch->key)
+                                    : strcmp(ctx->entries.items[i].key, watch->key) == 0;
+        }
+        if (!watched && !kv_warm_complete(ctx, ctx->entries.items[i].key) &&
+                kv_table_set(&keys, ctx->entries.items[i].key, NULL) < 0) {
+            break;
+        }
+    }
+    prefixes = (char**) calloc(ctx->prefix_count + 1, sizeof(char*));
+    for (size_t i = 0; prefixes != NULL && i < ctx->prefix_count; i++) {
+        bool watched = false;
+        for (kv_warm_watch_t* watch = ctx->watches; watch != NULL && !watched; watch = watch->next) {
+            watched = watch->prefix && kv_warm_starts_with(ctx->prefixes[i], watch->key);
+        }
+        if (!watched && (prefixes[prefix_count] = strdup(ctx->prefixes[i])) != NULL) {
+            prefix_count++;
+        }
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+
+    for (size_t i = 0; i < keys.count; i++) {
+        char* value = ctx->inner->get(handle, keys.items[i].key);
+        kv_warm_record(ctx, keys.items[i].key, value);
+        free(value);
+    }
+    for (size_t i = 0; i < prefix_count; i++) {
+        if (ctx->inner->get_batch != NULL) {
+            bool is_prefix = true;
+            config_t* values = ctx->inner->get_batch(handle, &prefixes[i], &is_prefix, 1);
+            if (values != NULL) {
+                kv_table_t found = {NULL, 0, 0};
+                for (cJSON* item = ((cJSON*) values->cfg)->child; item != NULL; item = item->next) {
+                    if (cJSON_IsString(item)) {
+                        kv_table_set(&found, item->string, item->valuestring);
+                    }
+                }
+                kv_warm_record_prefix(ctx, prefixes[i], &found);
+                kv_table_clear(&found);
+                config_destroy(values);
+            }
+        }
+        free(prefixes[i]);
+    }
+    free(prefixes);
+    kv_table_clear(&keys);
+}
+
+// Brings a warm start up to date, then writes the snapshot whenever the
+// recorded keys change
+static void* kv_warm_run(void* arg) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) arg;
+
+    while (atomic_load(&ctx->warm) && !atomic_load(&ctx->live)) {
+        void* handle = kv_warm_inner(ctx);
+        bool failed = handle == NULL;
+        while (!failed) {
+            // Watches added meanwhile are registered by the next pass
+            pthread_mutex_lock(&ctx->mtx);
+            kv_warm_watch_t* watch = ctx->watches;
+            while (watch != NULL && watch->registered) {
+                watch = watch->next;
+            }
+            if (watch == NULL) {
+                pthread_mutex_unlock(&ctx->mtx);
+                break;
+            }
+            pthread_mutex_unlock(&ctx->mtx);
+            if (kv_warm_watch_register(ctx, watch, handle) != 0) {
+                failed = true;
+                break;
+            }
+            pthread_mutex_lock(&ctx->mtx);
+            watch->registered = true;
+            pthread_mutex_unlock(&ctx->mtx);
+        }
+        if (!failed) {
+            kv_warm_refresh(ctx, handle);
+            pthread_mutex_lock(&ctx->mtx);
+            kv_warm_watch_t* watch = ctx->watches;
+            while (watch != NULL && watch->registered) {
+                watch = watch->next;
+            }
+            if (watch == NULL) {
+                atomic_store(&ctx->live, true);
+                LOG_INFO("Reconciled the snapshot %s with the kv_store", ctx->path);
+            }
+            pthread_mutex_unlock(&ctx->mtx);
+            continue;
+        }
+        pthread_mutex_lock(&ctx->mtx);
+        bool stop = kv_warm_wait(ctx, KV_STORE_WARM_RETRY_MS);
+        pthread_mutex_unlock(&ctx->mtx);
+        if (stop) {
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock(&ctx->mtx);
+    while (!ctx->stop) {
+        if (!ctx->dirty) {
+            pthread_cond_wait(&ctx->cv, &ctx->mtx);
+            continue;
+        }
+        // Bursts of changes are written once
+        if (kv_warm_wait(ctx, KV_WARM_WRITE_DELAY_MS)) {
+            break;
+        }
+        pthread_mutex_unlock(&ctx->mtx);
+        kv_warm_write(ctx);
+        pthread_mutex_lock(&ctx->mtx);
+    }
+    pthread_mutex_unlock(&ctx->mtx);
+    return NULL;
+}
+
+static void* kv_warm_init(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) client->handler;
+
+    if (kv_warm_load(ctx) == 0) {
+        atomic_store(&ctx->warm, true);
+        LOG_INFO("Starting from the snapshot %s", ctx->path);
+    } else if (kv_warm_inner(ctx) == NULL) {
+        return NULL;
+    } else {
+        atomic_store(&ctx->live, true);
+    }
+    if (pthread_create(&ctx->thread, NULL, kv_warm_run, ctx) != 0) {
+        LOG_ERROR_0("Failed to start the snapshot writer");
+        return NULL;
+    }
+    ctx->thread_started = true;
+    return ctx;
+}
+
+static char* kv_warm_get(void* handle, char* key) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    if (kv_warm_serving(ctx)) {
+        kv_table_t found = {NULL, 0, 0};
+        if (kv_warm_lookup(ctx, key, false, &found) == 0) {
+            char* value = NULL;
+            if (found.count == 1) {
+                value = found.items[0].value;
+                found.items[0].value = NULL;
+            } else {
+                LOG_DEBUG("Value is not found for the key %s", key);
+            }
+            kv_table_clear(&found);
+            return value;
+        }
+        kv_table_clear(&found);
+    }
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL) {
+        return NULL;
+    }
+    char* value = ctx->inner->get(inner_handle, key);
+    kv_warm_record(ctx, key, value);
+    return value;
+}
+
+// Reads a prefix with get_batch(), which unlike get_prefix() returns the
+// keys to record
+static int kv_warm_read_prefix(kv_warm_ctx_t* ctx, void* inner_handle, char* key, kv_table_t* out) {
+    bool is_prefix = true;
+    config_t* values = ctx->inner->get_batch(inner_handle, &key, &is_prefix, 1);
+    if (values == NULL) {
+        return -1;
+    }
+    for (cJSON* item = ((cJSON*) values->cfg)->child; item != NULL; item = item->next) {
+        if (cJSON_IsString(item) && kv_table_set(out, item->string, item->valuestring) < 0) {
+            config_destroy(values);
+            return -1;
+        }
+    }
+    config_destroy(values);
+    kv_warm_record_prefix(ctx, key, out);
+    return 0;
+}
+
+static config_value_t* kv_warm_get_prefix(void* handle, char* key) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    kv_table_t found = {NULL, 0, 0};
+    if (!kv_warm_serving(ctx) || kv_warm_lookup(ctx, key, true, &found) != 0) {
+        kv_table_clear(&found);
+        void* inner_handle = kv_warm_inner(ctx);
+        if (inner_handle == NULL) {
+            return NULL;
+        }
+        if (ctx->inner->get_batch == NULL || kv_warm_secret(ctx, key, true)) {
+            return ctx->inner->get_prefix(inner_handle, key);
+        }
+        if (kv_warm_read_prefix(ctx, inner_handle, key, &found) != 0) {
+            kv_table_clear(&found);
+            return NULL;
+        }
+    }
+
+    config_value_t* values = kv_table_to_prefix_value(&found, key);
+    kv_table_clear(&found);
+    return values;
+}
+
+static config_t* kv_warm_get_batch(void* handle, char** keys, const bool* prefixes, size_t count) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    config_t* values = NULL;
+    char** rest = NULL;
+    bool* rest_prefixes = NULL;
+    size_t rest_count = 0;
+    kv_table_t found = {NULL, 0, 0};
+    kv_table_t read = {NULL, 0, 0};
+
+    rest = (char**) malloc(sizeof(char*) * (count + 1));
+    rest_prefixes = (bool*) malloc(sizeof(bool) * (count + 1));
+    if (rest == NULL || rest_prefixes == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for batched keys");
+        goto err;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (kv_warm_serving(ctx) && kv_warm_lookup(ctx, keys[i], prefixes[i], &read) == 0) {
+            for (size_t j = 0; j < read.count; j++) {
+                if (kv_table_set(&found, read.items[j].key, read.items[j].value) < 0) {
+                    goto err;
+                }
+            }
+            kv_table_clear(&read);
+        } else {
+            kv_table_clear(&read);
+            rest[rest_count] = keys[i];
+            rest_prefixes[rest_count] = prefixes[i];
+            rest_count++;
+        }
+    }
+
+    if (rest_count > 0) {
+        void* inner_handle = kv_warm_inner(ctx);
+        if (inner_handle == NULL) {
+            goto err;
+        }
+        values = ctx->inner->get_batch(inner_handle, rest, rest_prefixes, rest_count);
+        if (values == NULL) {
+            goto err;
+        }
+        cJSON* obj = (cJSON*) values->cfg;
+        for (size_t i = 0; i < rest_count; i++) {
+            if (!rest_prefixes[i]) {
+                cJSON* item = cJSON_GetObjectItem(obj, rest[i]);
+                kv_warm_record(ctx, rest[i], cJSON_IsString(item) ? item->valuestring : NULL);
+                continue;
+            }
+            kv_table_t under = {NULL, 0, 0};
+            for (cJSON* item = obj->child; item != NULL; item = item->next) {
+                if (cJSON_IsString(item) && kv_warm_starts_with(item->string, rest[i])) {
+                    kv_table_set(&under, item->string, item->valuestring);
+                }
+            }
+            kv_warm_record_prefix(ctx, rest[i], &under);
+            kv_table_clear(&under);
+        }
+    } else {
+        cJSON* all_values = cJSON_CreateObject();
+        if (all_values == NULL) {
+            LOG_ERROR_0("Create new json object failed");
+            goto err;
+        }
+        values = config_new(all_values, free_json, get_config_value, set_config_value);
+        if (values == NULL) {
+            LOG_ERROR_0("Failed to allocate memory for batched values");
+            cJSON_Delete(all_values);
+            goto err;
+        }
+    }
+    for (size_t i = 0; i < found.count; i++) {
+        if (!cJSON_HasObjectItem((cJSON*) values->cfg, found.items[i].key)) {
+            cJSON_AddItemToObject((cJSON*) values->cfg, found.items[i].key,
+                                  cJSON_CreateString(found.items[i].value));
+        }
+    }
+
+    kv_table_clear(&found);
+    free(rest);
+    free(rest_prefixes);
+    return values;
+
+err:
+    kv_table_clear(&read);
+    kv_table_clear(&found);
+    if (rest != NULL) {
+        free(rest);
+    }
+    if (rest_prefixes != NULL) {
+        free(rest_prefixes);
+    }
+    return NULL;
+}
+
+// Registers a watch: while serving the snapshot kv watches get the
+// recorded keys and every watch is registered with the wrapped client in
+// the background, otherwise right away
+static int kv_warm_watch_add(kv_warm_ctx_t* ctx, const char* key, bool prefix,
+                             kv_store_watch_callback_t cb, kv_store_watch_kv_callback_t kv_cb,
+                             void* user_data) {
+    kv_warm_watch_t* watch = (kv_warm_watch_t*) calloc(1, sizeof(kv_warm_watch_t));
+    if (watch == NULL || (watch->key = strdup(key)) == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for the watch");
+        free(watch);
+        return -1;
+    }
+    watch->ctx = ctx;
+    watch->prefix = prefix;
+    watch->cb = cb;
+    watch->kv_cb = kv_cb;
+    watch->user_data = user_data;
+    pthread_mutex_init(&watch->mtx, NULL);
+
+    bool deferred = false;
+    if (kv_warm_serving(ctx)) {
+        // The snapshot stands for the keys the watch has seen
+        deferred = kv_warm_lookup(ctx, key, prefix, &watch->last) == 0;
+        if (!deferred) {
+            kv_table_clear(&watch->last);
+        } else if (kv_cb != NULL) {
+            for (size_t i = 0; i < watch->last.count; i++) {
+                kv_cb(watch->last.items[i].key, watch->last.items[i].value, user_data);
+            }
+        }
+    }
+    // Like the kv_store, watches other than kv watches start with the
+    // current keys without being notified of them
+    watch->quiet_seeds = !deferred && kv_cb == NULL;
+
+    pthread_mutex_lock(&ctx->mtx);
+    watch->next = ctx->watches;
+    ctx->watches = watch;
+    // Registered by the background thread until it went live
+    deferred = deferred && !atomic_load(&ctx->live);
+    watch->registered = !deferred;
+    pthread_mutex_unlock(&ctx->mtx);
+    if (deferred) {
+        return 0;
+    }
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL || kv_warm_watch_register(ctx, watch, inner_handle) != 0) {
+        // Left in the list, without callbacks, until the client is freed
+        pthread_mutex_lock(&watch->mtx);
+        watch->cb = NULL;
+        watch->kv_cb = NULL;
+        pthread_mutex_unlock(&watch->mtx);
+        return -1;
+    }
+    return 0;
+}
+
+static void kv_warm_watch(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_warm_watch_add((kv_warm_ctx_t*) handle, key, false, cb, NULL, user_data);
+}
+
+static void kv_warm_watch_prefix(void* handle, char* key, kv_store_watch_callback_t cb, void* user_data) {
+    kv_warm_watch_add((kv_warm_ctx_t*) handle, key, true, cb, NULL, user_data);
+}
+
+static int kv_warm_watch_prefix_kv(void* handle, char* key, kv_store_watch_kv_callback_t cb,
+                                   void* user_data) {
+    return kv_warm_watch_add((kv_warm_ctx_t*) handle, key, true, NULL, cb, user_data);
+}
+
+// Writes go to the kv_store, and reach the snapshot through the watches
+// or the next read
+
+static int kv_warm_put(void* handle, char* key, char* value) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->put(inner_handle, key, value);
+}
+
+static int kv_warm_put_with_lease(void* handle, char* key, char* value, int64_t lease_id) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->put_with_lease(inner_handle, key, value, lease_id);
+}
+
+static int kv_warm_grant_lease(void* handle, int64_t ttl, int64_t* lease_id) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->grant_lease(inner_handle, ttl, lease_id);
+}
+
+static int kv_warm_keepalive(void* handle, int64_t lease_id) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->keepalive(inner_handle, lease_id);
+}
+
+static int kv_warm_revoke_lease(void* handle, int64_t lease_id) {
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) handle;
+    void* inner_handle = kv_warm_inner(ctx);
+    if (inner_handle == NULL) {
+        return -1;
+    }
+    return ctx->inner->revoke_lease(inner_handle, lease_id);
+}
+
+static void kv_warm_free_ctx(kv_warm_ctx_t* ctx) {
+    kv_warm_watch_t* watch = ctx->watches;
+    while (watch != NULL) {
+        kv_warm_watch_t* next = watch->next;
+        kv_table_clear(&watch->last);
+        kv_table_clear(&watch->seeds);
+        pthread_mutex_destroy(&watch->mtx);
+        free(watch->key);
+        free(watch);
+        watch = next;
+    }
+    ctx->watches = NULL;
+    kv_table_clear(&ctx->entries);
+    for (size_t i = 0; i < ctx->prefix_count; i++) {
+        free(ctx->prefixes[i]);
+    }
+    free(ctx->prefixes);
+    for (size_t i = 0; i < ctx->secret_count; i++) {
+        free(ctx->secrets[i]);
+    }
+    free(ctx->secrets);
+    free(ctx->path);
+    free(ctx->scope);
+    OPENSSL_cleanse(ctx->key, sizeof(ctx->key));
+    pthread_mutex_destroy(&ctx->inner_mtx);
+    pthread_mutex_destroy(&ctx->mtx);
+    pthread_mutex_destroy(&ctx->write_mtx);
+    pthread_cond_destroy(&ctx->cv);
+}
+
+static void kv_warm_deinit(void* kv_store_client) {
+    kv_store_client_t* client = (kv_store_client_t*) kv_store_client;
+    kv_warm_ctx_t* ctx = (kv_warm_ctx_t*) client->handler;
+    if (ctx == NULL) {
+        return;
+    }
+    if (ctx->thread_started) {
+        pthread_mutex_lock(&ctx->mtx);
+        ctx->stop = true;
+        pthread_cond_broadcast(&ctx->cv);
+        pthread_mutex_unlock(&ctx->mtx);
+        pthread_join(ctx->thread, NULL);
+    }
+    // Inner client is freed first, which joins the watch threads
+    // updating the recorded keys
+    kv_client_free(ctx->inner);
+    ctx->inner = NULL;
+    if (ctx->dirty) {
+        kv_warm_write(ctx);
+    }
+    kv_warm_free_ctx(ctx);
+    // ctx itself is the kv_store_config, freed by kv_client_free()
+}
+
+// Splits the comma separated secret prefixes into ctx->secrets
+static int kv_warm_parse_secrets(kv_warm_ctx_t* ctx, const char* secrets) {
+    if (secrets == NULL || secrets[0] == '\0') {
+        return 0;
+    }
+    char* copy = strdup(secrets);
+    if (copy == NULL) {
+        LOG_ERROR_0("Failed to copy the secret prefixes");
+        return -1;
+    }
+    size_t max = 1;
+    for (const char* c = secrets; *c != '\0'; c++) {
+        if (*c == ',') {
+            max++;
+        }
+    }
+    ctx->secrets = (char**) calloc(max, sizeof(char*));
+    if (ctx->secrets == NULL) {
+        LOG_ERROR_0("Failed to allocate memory for the secret prefixes");
+        free(copy);
+        return -1;
+    }
+    char* saveptr = NULL;
+    for (char* token = strtok_r(copy, ",", &saveptr); token != NULL;
+         token = strtok_r(NULL, ",", &saveptr)) {
+        trim(token);
+        if (strlen(token) == 0) {
+            continue;
+        }
+        ctx->secrets[ctx->secret_count] = strdup(token);
+        if (ctx->secrets[ctx->secret_count] == NULL) {
+            LOG_ERROR_0("Failed to copy a secret prefix");
+            free(copy);
+            return -1;
+        }
+        ctx->secret_count++;
+    }
+    free(copy);
+    return 0;
+}
+
+kv_store_client_t* kv_store_warm_wrap(kv_store_client_t* inner, const char* path, const char* scope,
+                                      const unsigned char* key, const char* secrets) {
+    kv_store_client_t* client = NULL;
+    kv_warm_ctx_t* ctx = NULL;
+
+    if (inner == NULL) {
+        LOG_ERROR_0("kv_store_client to decorate is NULL");
+        return NULL;
+    }
+    if (inner->watch_prefix_kv == NULL) {
+        LOG_ERROR_0("Warm starts need a kv_store supporting watch_prefix_kv");
+        return NULL;
+    }
+    if (path == NULL || path[0] == '\0' || scope == NULL) {
+        LOG_ERROR_0("Snapshot path and scope must be given");
+        return NULL;
+    }
+
+    client = (kv_store_client_t*) malloc(sizeof(kv_store_client_t));
+    if (client == NULL) {
+        LOG_ERROR_0("KV Store Client: Failed to allocate Memory");
+        goto err;
+    }
+    ctx = (kv_warm_ctx_t*) calloc(1, sizeof(kv_warm_ctx_t));
+    if (ctx == NULL) {
+        LOG_ERROR_0("Warm-start context: Failed to allocate Memory");
+        goto err;
+    }
+    pthread_mutex_init(&ctx->inner_mtx, NULL);
+    pthread_mutex_init(&ctx->mtx, NULL);
+    pthread_mutex_init(&ctx->write_mtx, NULL);
+    pthread_cond_init(&ctx->cv, NULL);
+    ctx->path = strdup(path);
+    ctx->scope = strdup(scope);
+    if (ctx->path == NULL || ctx->scope == NULL) {
+        LOG_ERROR_0("Failed to copy the snapshot path");
+        goto err;
+    }
+    if (key != NULL) {
+        memcpy(ctx->key, key, KV_STORE_WARM_KEY_SIZE);
+        ctx->encrypted = true;
+    }
+    if (kv_warm_parse_secrets(ctx, secrets) != 0) {
+        goto err;
+    }
+    ctx->inner = inner;
+
+    client->kv_store_config = ctx;
+    client->handler = ctx;
+    client->init = kv_warm_init;
+    client->get = kv_warm_get;
+    client->get_prefix = kv_warm_get_prefix;
+    client->get_prefix_kv = NULL;
+    client->get_batch = (inner->get_batch != NULL) ? kv_warm_get_batch : NULL;
+    client->put = kv_warm_put;
+    client->watch = kv_warm_watch;
+    client->watch_prefix = kv_warm_watch_prefix;
+    client->watch_prefix_kv = kv_warm_watch_prefix_kv;
+    client->grant_lease = kv_warm_grant_lease;
+    client->put_with_lease = kv_warm_put_with_lease;
+    client->keepalive = kv_warm_keepalive;
+    client->revoke_lease = kv_warm_revoke_lease;
+    client->deinit = kv_warm_deinit;
+    return client;
+
+err:
+    if (ctx != NULL) {
+        kv_warm_free_ctx(ctx);
+        free(ctx);
+    }
+    if (client != NULL) {
+        free(client);
+    }
+    return NULL;
+}
+
+int kv_store_warm_read_key(const char* path, unsigned char* key) {
+    return cfgmgr_seal_read_key(path, key);
+}
+
+int kv_store_warm_persist(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_warm_init) {
+        return -1;
+    }
+    return kv_warm_write((kv_warm_ctx_t*) client->handler);
+}
+
+bool kv_store_warm_started(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_warm_init) {
+        return false;
+    }
+    return atomic_load(&((kv_warm_ctx_t*) client->handler)->warm);
+}
+
+bool kv_store_warm_live(kv_store_client_t* client) {
+    if (client == NULL || client->init != kv_warm_init) {
+        return false;
+    }
+    return atomic_load(&((kv_warm_ctx_t*) client->handler)->live);
+}
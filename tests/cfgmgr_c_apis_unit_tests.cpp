@@ -31,9 +31,17 @@
 #include "eii/msgbus/msgbus.h"
 #include "eii/utils/json_config.h"
 #include "eii/config_manager/config_mgr.hpp"
+#include "eii/config_manager/cfgmgr_arena.h"
+#include "eii/config_manager/cfgmgr_msgbus_builder.h"
+#include "eii/config_manager/cfgmgr_json.h"
+#include "eii/config_manager/cfgmgr_binary.h"
+#include "eii/config_manager/cfgmgr_bundle.h"
 #include <cjson/cJSON.h>
 #include <iostream>
+#include <thread>
+#include <atomic>
 #include <fstream>
+#include <map>
 
 #define KV_STORE_CONFIG "./kv_store_unittest_config_cpp.json"
 
@@ -801,6 +809,1719 @@ TEST(ConfigManagerTest, getConfigValue) {
     cout << " =========== End Of getConfigValue() testcase ===========" << endl;
 }
 
+TEST(ConfigManagerTest, interfaceIndex) {
+    cout << "Test Case: interfaceIndex()\n";
+
+    cfgmgr_iface_index_t* index = cfgmgr_iface_index_new();
+    ASSERT_NE(index, nullptr);
+    EXPECT_EQ(cfgmgr_iface_index_get(index, CFGMGR_PUBLISHER, "pub0"), nullptr);
+
+    // Publishers and Subscribers sharing names, plus a duplicate
+    string interfaces = "{\"Publishers\": [";
+    for (int i = 0; i < 128; i++) {
+        interfaces += (i ? ", " : "") + string("{\"Name\": \"pub") + to_string(i) +
+                      "\", \"Type\": \"zmq_tcp\"}";
+    }
+    interfaces += ", {\"Name\": \"pub0\", \"Type\": \"zmq_ipc\"}],"
+                  " \"Subscribers\": [{\"Name\": \"pub0\", \"Type\": \"zmq_ipc\"}]}";
+    config_t* app_interface = json_config_new_from_buffer(interfaces.c_str());
+    ASSERT_NE(app_interface, nullptr);
+    ASSERT_EQ(cfgmgr_iface_index_update(index, app_interface), 0);
+    EXPECT_EQ(cfgmgr_iface_index_interfaces(index), app_interface);
+
+    for (int i = 0; i < 128; i++) {
+        string name = "pub" + to_string(i);
+        config_value_t* iface = cfgmgr_iface_index_get(index, CFGMGR_PUBLISHER, name.c_str());
+        ASSERT_NE(iface, nullptr);
+        config_value_t* iface_name = config_value_object_get(iface, "Name");
+        EXPECT_EQ(string(iface_name->body.string), name);
+        config_value_destroy(iface_name);
+        config_value_destroy(iface);
+    }
+    // The first interface with a given name wins
+    config_value_t* iface = cfgmgr_iface_index_get(index, CFGMGR_PUBLISHER, "pub0");
+    config_value_t* iface_type = config_value_object_get(iface, "Type");
+    EXPECT_EQ(string(iface_type->body.string), "zmq_tcp");
+    config_value_destroy(iface_type);
+    config_value_destroy(iface);
+    iface = cfgmgr_iface_index_get(index, CFGMGR_SUBSCRIBER, "pub0");
+    EXPECT_NE(iface, nullptr);
+    config_value_destroy(iface);
+    EXPECT_EQ(cfgmgr_iface_index_get(index, CFGMGR_SUBSCRIBER, "pub1"), nullptr);
+    EXPECT_EQ(cfgmgr_iface_index_get(index, CFGMGR_SERVER, "pub0"), nullptr);
+    EXPECT_EQ(cfgmgr_iface_index_get(index, CFGMGR_PUBLISHER, "pub128"), nullptr);
+
+    // Interfaces looked up while pinned stay valid across an update, and
+    // referenced models until they are released
+    cfgmgr_gen_guard_t guard = cfgmgr_iface_index_pin(index);
+    config_value_t* old_iface = cfgmgr_iface_index_get(index, CFGMGR_PUBLISHER, "pub1");
+    const cfgmgr_iface_model_t* old_model = cfgmgr_iface_index_find(index, CFGMGR_PUBLISHER, "pub2");
+    ASSERT_NE(old_model, nullptr);
+    ASSERT_EQ(cfgmgr_iface_index_ref(index, old_model), 0);
+    app_interface = json_config_new_from_buffer(
+        "{\"Servers\": [{\"Name\": \"srv\", \"Type\": \"zmq_tcp\"}]}");
+    ASSERT_NE(app_interface, nullptr);
+    ASSERT_EQ(cfgmgr_iface_index_update(index, app_interface), 0);
+    EXPECT_EQ(cfgmgr_iface_index_get(index, CFGMGR_PUBLISHER, "pub1"), nullptr);
+    iface = cfgmgr_iface_index_get(index, CFGMGR_SERVER, "srv");
+    EXPECT_NE(iface, nullptr);
+    config_value_destroy(iface);
+    iface_type = config_value_object_get(old_iface, "Type");
+    EXPECT_EQ(string(iface_type->body.string), "zmq_tcp");
+    config_value_destroy(iface_type);
+    config_value_destroy(old_iface);
+    cfgmgr_iface_index_unpin(index, &guard);
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 1u);
+    EXPECT_EQ(string(old_model->name), "pub2");
+    cfgmgr_iface_index_unref(index, old_model);
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 0u);
+
+    // Replaced generations are freed once nothing reads them
+    config_t* held = cfgmgr_iface_index_acquire_interfaces(index);
+    EXPECT_EQ(held, app_interface);
+    for (int i = 0; i < 8; i++) {
+        app_interface = json_config_new_from_buffer("{\"Clients\": []}");
+        ASSERT_NE(app_interface, nullptr);
+        ASSERT_EQ(cfgmgr_iface_index_update(index, app_interface), 0);
+        EXPECT_EQ(cfgmgr_iface_index_retired(index), 1u);
+    }
+    cfgmgr_iface_index_release_interfaces(index, held);
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 0u);
+    EXPECT_EQ(cfgmgr_iface_index_count(index, CFGMGR_CLIENT), 0);
+    cfgmgr_iface_index_destroy(index);
+
+    // Unknown names are not found through the ConfigMgr either
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* pub_cfg = cfgmgr_get_publisher_by_name(cfg_mgr, "default");
+    EXPECT_NE(pub_cfg, nullptr);
+    cfgmgr_interface_destroy(pub_cfg);
+    EXPECT_EQ(cfgmgr_get_publisher_by_name(cfg_mgr, "not_a_publisher"), nullptr);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of interfaceIndex() testcase ===========" << endl;
+}
+
+// Language bindings may garbage collect the ConfigMgr before its interfaces
+TEST(ConfigManagerTest, interfaceOutlivesContext) {
+    cout << "Test Case: interfaceOutlivesContext()\n";
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* pub_cfg = cfgmgr_get_publisher_by_name(cfg_mgr, "default");
+    ASSERT_NE(pub_cfg, nullptr);
+    cfgmgr_destroy(cfg_mgr);
+
+    // The model of the interface is still readable
+    config_value_t* type = cfgmgr_get_interface_value(pub_cfg, "Type");
+    ASSERT_NE(type, nullptr);
+    ASSERT_EQ(type->type, CVT_STRING);
+    EXPECT_EQ(string(type->body.string), "zmq_ipc");
+    config_value_destroy(type);
+    cfgmgr_interface_destroy(pub_cfg);
+
+    cout << " =========== End Of interfaceOutlivesContext() testcase ===========" << endl;
+}
+
+TEST(ConfigManagerTest, envOverrides) {
+    cout << "Test Case: envOverrides()\n";
+
+    setenv("PUBLISHER_cam_1_ENDPOINT", "127.0.0.1:65001", 1);
+    setenv("PUBLISHER_ENDPOINT", "127.0.0.1:65000", 1);
+    setenv("SUBSCRIBER_cam_1_TYPE", "zmq_ipc", 1);
+    setenv("SERVER_TYPE", "", 1);
+    setenv("CLIENT_ENDPOINT_TYPE", "zmq_tcp", 1);
+    unsetenv("SUBSCRIBER_TYPE");
+
+    cfgmgr_env_overrides_t* overrides = cfgmgr_env_overrides_new();
+    ASSERT_NE(overrides, nullptr);
+    EXPECT_EQ(cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, NULL, CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+    ASSERT_EQ(cfgmgr_env_overrides_load(overrides), 0);
+
+    const char* value = cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, "cam_1", CFGMGR_OVERRIDE_ENDPOINT);
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(string(value), "127.0.0.1:65001");
+    value = cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, NULL, CFGMGR_OVERRIDE_ENDPOINT);
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(string(value), "127.0.0.1:65000");
+    value = cfgmgr_env_overrides_get(overrides, CFGMGR_SUBSCRIBER, "cam_1", CFGMGR_OVERRIDE_TYPE);
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(string(value), "zmq_ipc");
+    // Names ending like a field are still names
+    value = cfgmgr_env_overrides_get(overrides, CFGMGR_CLIENT, "ENDPOINT", CFGMGR_OVERRIDE_TYPE);
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(string(value), "zmq_tcp");
+    EXPECT_EQ(cfgmgr_env_overrides_get(overrides, CFGMGR_CLIENT, NULL, CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+    // Empty overrides are ignored
+    EXPECT_EQ(cfgmgr_env_overrides_get(overrides, CFGMGR_SERVER, NULL, CFGMGR_OVERRIDE_TYPE), nullptr);
+    EXPECT_EQ(cfgmgr_env_overrides_get(overrides, CFGMGR_SUBSCRIBER, "cam_1", CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+    EXPECT_EQ(cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, "cam_2", CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+
+    // Values looked up while pinned stay valid across loads
+    cfgmgr_gen_guard_t guard = cfgmgr_env_overrides_pin(overrides);
+    const char* old_value = cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, "cam_1", CFGMGR_OVERRIDE_ENDPOINT);
+    unsetenv("PUBLISHER_cam_1_ENDPOINT");
+    EXPECT_NE(cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, "cam_1", CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+    ASSERT_EQ(cfgmgr_env_overrides_load(overrides), 0);
+    EXPECT_EQ(cfgmgr_env_overrides_get(overrides, CFGMGR_PUBLISHER, "cam_1", CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+    EXPECT_EQ(string(old_value), "127.0.0.1:65001");
+    EXPECT_EQ(cfgmgr_env_overrides_retired(overrides), 1u);
+    cfgmgr_env_overrides_unpin(overrides, &guard);
+    // Replaced tables are freed once nothing pins them
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(cfgmgr_env_overrides_load(overrides), 0);
+        EXPECT_EQ(cfgmgr_env_overrides_retired(overrides), 0u);
+    }
+    cfgmgr_env_overrides_destroy(overrides);
+
+    unsetenv("PUBLISHER_ENDPOINT");
+    unsetenv("SUBSCRIBER_cam_1_TYPE");
+    unsetenv("SERVER_TYPE");
+    unsetenv("CLIENT_ENDPOINT_TYPE");
+
+    cout << " =========== End Of envOverrides() testcase ===========" << endl;
+}
+
+static string msgbus_config_str(cfgmgr_interface_t* iface) {
+    config_t* config = cfgmgr_get_msgbus_config(iface);
+    if (config == NULL) {
+        return "";
+    }
+    char* config_char = configt_to_char(config);
+    string result(config_char);
+    free(config_char);
+    config_destroy(config);
+    return result;
+}
+
+TEST(ConfigManagerTest, msgbusConfigCache) {
+    cout << "Test Case: msgbusConfigCache()\n";
+
+    setenv("AppName", "TestPubServer", 1);
+    unsetenv("SERVER_ENDPOINT");
+    unsetenv("SERVER_default_ENDPOINT");
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* server_cfg = cfgmgr_get_server_by_name(cfg_mgr, "default");
+    ASSERT_NE(server_cfg, nullptr);
+
+    string built = msgbus_config_str(server_cfg);
+    ASSERT_NE(built, "");
+    EXPECT_NE(built.find("66013"), string::npos);
+    // Served from the cache, as a copy owned by the caller
+    EXPECT_EQ(msgbus_config_str(server_cfg), built);
+
+    // Overrides are only picked up by cfgmgr_reload_env()
+    setenv("SERVER_default_ENDPOINT", "127.0.0.1:66014", 1);
+    EXPECT_EQ(msgbus_config_str(server_cfg), built);
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+    string overridden = msgbus_config_str(server_cfg);
+    EXPECT_NE(overridden.find("66014"), string::npos);
+    unsetenv("SERVER_default_ENDPOINT");
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+    EXPECT_EQ(msgbus_config_str(server_cfg), built);
+
+    cfgmgr_interface_destroy(server_cfg);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of msgbusConfigCache() testcase ===========" << endl;
+}
+
+TEST(ConfigManagerTest, msgbusConfigBuilder) {
+    cout << "Test Case: msgbusConfigBuilder()\n";
+
+    setenv("AppName", "TestSubClient", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* sub_cfg = cfgmgr_get_subscriber_by_name(cfg_mgr, "default");
+    ASSERT_NE(sub_cfg, nullptr);
+    cfgmgr_interface_t* client_cfg = cfgmgr_get_client_by_name(cfg_mgr, "default");
+    ASSERT_NE(client_cfg, nullptr);
+
+    // Unsupported transports fail the build rather than returning a
+    // partial config
+    setenv("CLIENT_default_TYPE", "zmq_shm", 1);
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+    EXPECT_EQ(msgbus_config_str(client_cfg), "");
+    unsetenv("CLIENT_default_TYPE");
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+    string client = msgbus_config_str(client_cfg);
+    EXPECT_NE(client.find("\"default\""), string::npos);
+    EXPECT_NE(client.find("66013"), string::npos);
+
+    // Socket file given in the EndPoint, which builds leave untouched
+    setenv("SUBSCRIBER_default_ENDPOINT", "/EII/sockets, sub_socket", 1);
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+    string sub = msgbus_config_str(sub_cfg);
+    EXPECT_NE(sub.find("sub_socket"), string::npos);
+    EXPECT_NE(sub.find("camera1_stream"), string::npos);
+    cfgmgr_msgbus_cache_invalidate(cfg_mgr->msgbus_cache);
+    EXPECT_EQ(msgbus_config_str(sub_cfg), sub);
+    unsetenv("SUBSCRIBER_default_ENDPOINT");
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+
+    cfgmgr_interface_destroy(client_cfg);
+    cfgmgr_interface_destroy(sub_cfg);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of msgbusConfigBuilder() testcase ===========" << endl;
+}
+
+// Client, subscriber with a socket file and overridden TCP client configs
+static vector<string> msgbus_configs_str(cfgmgr_ctx_t* cfg_mgr) {
+    vector<string> configs;
+    cfgmgr_interface_t* sub_cfg = cfgmgr_get_subscriber_by_name(cfg_mgr, "default");
+    cfgmgr_interface_t* client_cfg = cfgmgr_get_client_by_name(cfg_mgr, "default");
+    if (sub_cfg == NULL || client_cfg == NULL) {
+        return configs;
+    }
+    configs.push_back(msgbus_config_str(client_cfg));
+    // Served from the cache
+    configs.push_back(msgbus_config_str(client_cfg));
+    setenv("SUBSCRIBER_default_ENDPOINT", "/EII/sockets, sub_socket", 1);
+    setenv("CLIENT_default_ENDPOINT", " 127.0.0.1 : 66100", 1);
+    cfgmgr_reload_env(cfg_mgr);
+    configs.push_back(msgbus_config_str(sub_cfg));
+    configs.push_back(msgbus_config_str(client_cfg));
+    unsetenv("SUBSCRIBER_default_ENDPOINT");
+    unsetenv("CLIENT_default_ENDPOINT");
+    cfgmgr_reload_env(cfg_mgr);
+    cfgmgr_interface_destroy(client_cfg);
+    cfgmgr_interface_destroy(sub_cfg);
+    return configs;
+}
+
+TEST(ConfigManagerTest, msgbusConfigArena) {
+    cout << "Test Case: msgbusConfigArena()\n";
+
+    setenv("AppName", "TestSubClient", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    EXPECT_FALSE(cfg_mgr->msgbus_arena);
+    vector<string> heap = msgbus_configs_str(cfg_mgr);
+    cfgmgr_destroy(cfg_mgr);
+    ASSERT_EQ(heap.size(), 4u);
+    EXPECT_NE(heap[3].find("66100"), string::npos);
+
+    // Arena configs are the same configs
+    setenv("CONFIGMGR_ARENA", "true", 1);
+    cfg_mgr = cfgmgr_initialize();
+    unsetenv("CONFIGMGR_ARENA");
+    ASSERT_NE(cfg_mgr, nullptr);
+    EXPECT_TRUE(cfg_mgr->msgbus_arena);
+    EXPECT_EQ(msgbus_configs_str(cfg_mgr), heap);
+
+    // Built in a single chunk, and still settable
+    cfgmgr_interface_t* client_cfg = cfgmgr_get_client_by_name(cfg_mgr, "default");
+    ASSERT_NE(client_cfg, nullptr);
+    config_t* config = cfgmgr_get_msgbus_config(client_cfg);
+    ASSERT_NE(config, nullptr);
+    cfgmgr_arena_t* arena = cfgmgr_arena_config_arena(config);
+    EXPECT_LT(cfgmgr_arena_reserved(arena), (size_t) 2 * CFGMGR_MSGBUS_ARENA_CHUNK_SIZE);
+    config_value_t* value = config_value_new_string("zmq_ipc");
+    ASSERT_NE(value, nullptr);
+    EXPECT_TRUE(config_set(config, "type", value));
+    config_value_destroy(value);
+    value = config_get(config, "type");
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(string(value->body.string), "zmq_ipc");
+    config_value_destroy(value);
+    cJSON* extra = cJSON_Parse("{\"socket_file\": \"f\"}");
+    value = config_value_new_object(extra, get_config_value, NULL);
+    ASSERT_NE(value, nullptr);
+    EXPECT_TRUE(config_set(config, "extra", value));
+    config_value_destroy(value);
+    char* config_char = cJSON_PrintUnformatted((cJSON*) config->cfg);
+    EXPECT_NE(string(config_char).find("\"extra\":{\"socket_file\":\"f\"}"), string::npos);
+    free(config_char);
+    config_destroy(config);
+
+    cfgmgr_interface_destroy(client_cfg);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of msgbusConfigArena() testcase ===========" << endl;
+}
+
+// Parses doc with cfgmgr_json_parse() and cJSON, returning both prints
+static pair<string, string> json_parse_both(const string& doc) {
+    pair<string, string> prints;
+    cJSON* parsed = cfgmgr_json_parse(doc.data(), doc.size());
+    cJSON* expected = cJSON_ParseWithLength(doc.data(), doc.size());
+    char* print = (parsed != NULL) ? cJSON_PrintUnformatted(parsed) : NULL;
+    prints.first = (print != NULL) ? print : "NULL";
+    free(print);
+    print = (expected != NULL) ? cJSON_PrintUnformatted(expected) : NULL;
+    prints.second = (print != NULL) ? print : "NULL";
+    free(print);
+    cJSON_Delete(parsed);
+    cJSON_Delete(expected);
+    return prints;
+}
+
+TEST(ConfigManagerTest, jsonParse) {
+    cout << "Test Case: jsonParse() with " << cfgmgr_json_backend() << "\n";
+
+    // Large UDF-like config, parsed by the simdjson backend if built with it
+    string large = "{\"udfs\": [";
+    for (int i = 0; i < 2000; i++) {
+        large += (i == 0) ? "" : ",";
+        large += "{\"name\": \"model_" + to_string(i) + "\", \"weights\": [0.25, -1e3, " +
+                 to_string(i) + "], \"device\": \"CPU\\u00e9\\n\", \"enabled\": true, \"roi\": null}";
+    }
+    large += "], \"metadata\": {\"blob\": \"" + string(4 * CFGMGR_JSON_SIMD_MIN_SIZE, 'x') + "\"}}";
+    ASSERT_GE(large.size(), (size_t) CFGMGR_JSON_SIMD_MIN_SIZE);
+    vector<string> docs = {
+        large,
+        large + " trailing content",
+        large.substr(0, large.size() - 1),
+        "{\"a\": 1, \"a\": [true, false, {}], \"b\": \"\\\"quoted\\\"\"}",
+        "{\"a\": }",
+        "",
+    };
+    for (const string& doc : docs) {
+        pair<string, string> prints = json_parse_both(doc);
+        EXPECT_EQ(prints.first, prints.second) << doc.substr(0, 64);
+    }
+    EXPECT_EQ(json_parse_both(large.substr(0, large.size() - 1)).first, "NULL");
+
+    config_t* config = cfgmgr_json_config_new(large.c_str());
+    ASSERT_NE(config, nullptr);
+    config_value_t* udfs = config_get(config, "udfs");
+    ASSERT_NE(udfs, nullptr);
+    EXPECT_EQ(config_value_array_len(udfs), 2000u);
+    config_value_destroy(udfs);
+    config_destroy(config);
+    EXPECT_EQ(cfgmgr_json_config_new("{\"a\": }"), nullptr);
+
+    cout << " =========== End Of jsonParse() testcase ===========" << endl;
+}
+
+// Collects the members streamed by cfgmgr_json_each_member(), stopping at
+// the key "stop"
+static int json_member_cb(const char* key, const char* value, void* user_data) {
+    vector<pair<string, string>>* members = (vector<pair<string, string>>*) user_data;
+    members->push_back(make_pair(string(key), string(value)));
+    return (strcmp(key, "stop") == 0) ? 1 : 0;
+}
+
+TEST(ConfigManagerTest, jsonEachMember) {
+    cout << "Test Case: jsonEachMember()\n";
+
+    string doc = "{\"A\": \"plain\", \"B\\u00e9\": \"tab\\tquote\\\"slash\\/ \\u00e9\\ud83d\\ude00\","
+                 " \"N\": -1.5e3, \"T\": true, \"Z\": null,\n \"O\": {\"x\": [1, {\"y\": \"}\"}]}, \"E\": \"\"}";
+    vector<pair<string, string>> members;
+    ASSERT_EQ(cfgmgr_json_each_member(doc.data(), doc.size(), json_member_cb, &members), 7);
+    vector<pair<string, string>> expected = {
+        {"A", "plain"}, {"B\xc3\xa9", "tab\tquote\"slash/ \xc3\xa9\xf0\x9f\x98\x80"}, {"N", "-1.5e3"},
+        {"T", "true"}, {"Z", "null"}, {"O", "{\"x\": [1, {\"y\": \"}\"}]}"}, {"E", ""},
+    };
+    EXPECT_EQ(members, expected);
+
+    // Strings are unescaped as by cJSON
+    cJSON* json = cJSON_ParseWithLength(doc.data(), doc.size());
+    ASSERT_NE(json, nullptr);
+    EXPECT_EQ(members[1].first, cJSON_GetArrayItem(json, 1)->string);
+    EXPECT_EQ(members[1].second, cJSON_GetArrayItem(json, 1)->valuestring);
+    cJSON_Delete(json);
+
+    // Validating only, and stopping from the callback
+    EXPECT_EQ(cfgmgr_json_each_member(doc.data(), doc.size(), NULL, NULL), 7);
+    members.clear();
+    string stop = "{\"a\": \"1\", \"stop\": \"2\", \"c\": \"3\"}";
+    EXPECT_EQ(cfgmgr_json_each_member(stop.data(), stop.size(), json_member_cb, &members), -1);
+    EXPECT_EQ(members.size(), 2u);
+
+    vector<string> invalid = {
+        "", "[]", "\"a\"", "{\"a\": 1,}", "{\"a\" 1}", "{\"a\": 01}", "{\"a\": \"\\ud83d\"}",
+        "{\"a\": \"x\"} x", "{\"a\": tru}", "{\"a\": \"\x01\"}", "{\"a\": [1, 2}", "{\"a\": \"x",
+        string(2000, '[') + "1" + string(2000, ']'),
+    };
+    for (const string& bad : invalid) {
+        EXPECT_EQ(cfgmgr_json_each_member(bad.data(), bad.size(), NULL, NULL), -1) << bad.substr(0, 64);
+    }
+    EXPECT_EQ(cfgmgr_json_each_member(" {} ", 4, NULL, NULL), 0);
+
+    // /GlobalEnv/ with hundreds of entries is streamed into the environment
+    setenv("AppName", "TestSubClient", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    string global_env = "{\"C_LOG_LEVEL\": \"ERROR\"";
+    for (int i = 0; i < 500; i++) {
+        global_env += ", \"CFGMGR_TEST_ENV_" + to_string(i) + "\": \"value\\u0020" + to_string(i) + "\"";
+    }
+    global_env += "}";
+    kv_store_client_t* client = cfg_mgr->kv_store_client;
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/",
+                          (char*) global_env.c_str()), 0);
+    cfgmgr_destroy(cfg_mgr);
+    cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    EXPECT_STREQ(getenv("CFGMGR_TEST_ENV_0"), "value 0");
+    EXPECT_STREQ(getenv("CFGMGR_TEST_ENV_499"), "value 499");
+    client = cfg_mgr->kv_store_client;
+
+    // Nothing is set from an invalid /GlobalEnv/
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/",
+                          (char*) "{\"CFGMGR_TEST_ENV_BAD\": \"x\",}"), 0);
+    EXPECT_EQ(cfgmgr_initialize(), nullptr);
+    EXPECT_EQ(getenv("CFGMGR_TEST_ENV_BAD"), nullptr);
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/", (char*) "{}"), 0);
+    cfgmgr_destroy(cfg_mgr);
+    for (int i = 0; i < 500; i++) {
+        unsetenv(("CFGMGR_TEST_ENV_" + to_string(i)).c_str());
+    }
+
+    cout << " =========== End Of jsonEachMember() testcase ===========" << endl;
+}
+
+TEST(ConfigManagerTest, interfaceModel) {
+    cout << "Test Case: interfaceModel()\n";
+
+    cfgmgr_iface_index_t* index = cfgmgr_iface_index_new();
+    ASSERT_NE(index, nullptr);
+    config_t* app_interface = json_config_new_from_buffer(
+        "{\"Publishers\": ["
+        "  {\"Name\": \"pub\", \"Type\": \"zmq_tcp\", \"EndPoint\": \" 127.0.0.1 : 65013\","
+        "   \"Topics\": [\"camera1\", \"camera2\"], \"AllowedClients\": [\"*\"],"
+        "   \"zmq_recv_hwm\": 50, \"brokered\": true, \"BrokerAppName\": \"Broker\"},"
+        "  {\"Name\": \"ipc\", \"Type\": \"zmq_ipc\","
+        "   \"EndPoint\": {\"SocketDir\": \"/tmp\", \"SocketFile\": \"f\"},"
+        "   \"Topics\": \"camera1\", \"zmq_recv_hwm\": 1.5}],"
+        " \"Subscribers\": ["
+        "  {\"Name\": \"sub\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:65013\","
+        "   \"Topics\": [\"*\"], \"PublisherAppName\": \"VideoIngestion\"}]}");
+    ASSERT_NE(app_interface, nullptr);
+    ASSERT_EQ(cfgmgr_iface_index_update(index, app_interface), 0);
+    EXPECT_EQ(cfgmgr_iface_index_count(index, CFGMGR_PUBLISHER), 2);
+    EXPECT_EQ(cfgmgr_iface_index_count(index, CFGMGR_SUBSCRIBER), 1);
+    EXPECT_EQ(cfgmgr_iface_index_count(index, CFGMGR_SERVER), -1);
+    EXPECT_EQ(cfgmgr_iface_index_at(index, CFGMGR_PUBLISHER, 2), nullptr);
+
+    const cfgmgr_iface_model_t* pub = cfgmgr_iface_index_find(index, CFGMGR_PUBLISHER, "pub");
+    ASSERT_NE(pub, nullptr);
+    EXPECT_EQ(pub, cfgmgr_iface_index_at(index, CFGMGR_PUBLISHER, 0));
+    EXPECT_EQ(pub->invalid, 0u);
+    EXPECT_EQ(pub->transport, CFGMGR_TRANSPORT_ZMQ_TCP);
+    ASSERT_TRUE(pub->has_host_port);
+    EXPECT_EQ(string(pub->host), "127.0.0.1");
+    EXPECT_EQ(pub->port, 65013);
+    const cfgmgr_iface_strings_t* topics = cfgmgr_iface_model_topics(pub);
+    ASSERT_NE(topics, nullptr);
+    ASSERT_EQ(topics->count, 2u);
+    EXPECT_EQ(string(topics->items[1]), "camera2");
+    EXPECT_FALSE(topics->wildcard);
+    ASSERT_NE(pub->allowed_clients, nullptr);
+    EXPECT_TRUE(pub->allowed_clients->wildcard);
+    EXPECT_TRUE(pub->has_zmq_recv_hwm);
+    EXPECT_EQ(pub->zmq_recv_hwm, 50);
+    EXPECT_TRUE(pub->has_brokered && pub->brokered);
+    EXPECT_EQ(string(pub->broker_appname), "Broker");
+
+    // Keys with unexpected types are flagged once, at compile time
+    const cfgmgr_iface_model_t* ipc = cfgmgr_iface_index_at(index, CFGMGR_PUBLISHER, 1);
+    ASSERT_NE(ipc, nullptr);
+    EXPECT_EQ(ipc->transport, CFGMGR_TRANSPORT_ZMQ_IPC);
+    EXPECT_NE(ipc->endpoint_object, nullptr);
+    EXPECT_EQ(ipc->invalid, (uint32_t) (CFGMGR_IFACE_BAD_TOPICS | CFGMGR_IFACE_BAD_ZMQ_RECV_HWM));
+    EXPECT_EQ(cfgmgr_iface_model_topics(ipc), nullptr);
+
+    // Strings are interned across interfaces
+    const cfgmgr_iface_model_t* sub = cfgmgr_iface_index_find(index, CFGMGR_SUBSCRIBER, "sub");
+    ASSERT_NE(sub, nullptr);
+    EXPECT_EQ(sub->type, pub->type);
+    EXPECT_EQ(sub->host, pub->host);
+    EXPECT_EQ(string(sub->publisher_appname), "VideoIngestion");
+    EXPECT_TRUE(cfgmgr_iface_model_topics(sub)->wildcard);
+
+    // New topics are published in a new generation, older models keep theirs
+    ASSERT_EQ(cfgmgr_iface_index_ref(index, ipc), 0);
+    cJSON* new_ipc_topics = cJSON_CreateArray();
+    cJSON_AddItemToArray(new_ipc_topics, cJSON_CreateString("camera3"));
+    const cfgmgr_iface_model_t* ipc2 = cfgmgr_iface_index_set_topics(index, ipc, new_ipc_topics);
+    cJSON_Delete(new_ipc_topics);
+    ASSERT_NE(ipc2, nullptr);
+    EXPECT_NE(ipc2, ipc);
+    EXPECT_EQ(ipc2, cfgmgr_iface_index_at(index, CFGMGR_PUBLISHER, 1));
+    EXPECT_EQ(ipc2->invalid, (uint32_t) CFGMGR_IFACE_BAD_ZMQ_RECV_HWM);
+    ASSERT_NE(cfgmgr_iface_model_topics(ipc2), nullptr);
+    EXPECT_EQ(string(cfgmgr_iface_model_topics(ipc2)->items[0]), "camera3");
+    EXPECT_EQ(cfgmgr_iface_model_topics(ipc), nullptr);
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 1u);
+
+    // A model of an older generation is matched by name
+    cJSON* newer_ipc_topics = cJSON_CreateArray();
+    cJSON_AddItemToArray(newer_ipc_topics, cJSON_CreateString("camera4"));
+    const cfgmgr_iface_model_t* ipc3 = cfgmgr_iface_index_set_topics(index, ipc, newer_ipc_topics);
+    cJSON_Delete(newer_ipc_topics);
+    ASSERT_NE(ipc3, nullptr);
+    EXPECT_EQ(string(ipc3->name), "ipc");
+    EXPECT_EQ(string(cfgmgr_iface_model_topics(ipc3)->items[0]), "camera4");
+    EXPECT_EQ(string(cfgmgr_iface_model_topics(
+        cfgmgr_iface_index_find(index, CFGMGR_PUBLISHER, "pub"))->items[0]), "camera1");
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 2u);
+    // Replaced generations are reclaimed with their last reference
+    cfgmgr_iface_index_unref(index, ipc2);
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 1u);
+    cfgmgr_iface_index_unref(index, ipc);
+    EXPECT_EQ(cfgmgr_iface_index_retired(index), 0u);
+    cfgmgr_iface_index_unref(index, ipc3);
+    cfgmgr_iface_index_destroy(index);
+
+    // Accessors read the model of the interface
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* pub_cfg = cfgmgr_get_publisher_by_name(cfg_mgr, "default");
+    ASSERT_NE(pub_cfg, nullptr);
+    ASSERT_NE(pub_cfg->model, nullptr);
+    cfgmgr_interface_t* old_pub_cfg = cfgmgr_get_publisher_by_name(cfg_mgr, "default");
+    ASSERT_NE(old_pub_cfg, nullptr);
+    config_value_t* old_topics_cvt = cfgmgr_get_topics(old_pub_cfg);
+    ASSERT_NE(old_topics_cvt, nullptr);
+    size_t old_topics_len = config_value_array_len(old_topics_cvt);
+    config_value_destroy(old_topics_cvt);
+    const char* new_topics[] = {"topic_a", "topic_b", "topic_c"};
+    ASSERT_TRUE(cfgmgr_set_topics(pub_cfg, new_topics, 3));
+    // Interfaces handed out earlier keep the topics they were created with
+    old_topics_cvt = cfgmgr_get_topics(old_pub_cfg);
+    ASSERT_NE(old_topics_cvt, nullptr);
+    EXPECT_EQ(config_value_array_len(old_topics_cvt), old_topics_len);
+    config_value_destroy(old_topics_cvt);
+    cfgmgr_interface_destroy(old_pub_cfg);
+    config_value_t* topics_cvt = cfgmgr_get_topics(pub_cfg);
+    ASSERT_NE(topics_cvt, nullptr);
+    ASSERT_EQ(config_value_array_len(topics_cvt), 3u);
+    config_value_t* topic = config_value_array_get(topics_cvt, 2);
+    EXPECT_EQ(string(topic->body.string), "topic_c");
+    config_value_destroy(topic);
+    config_value_destroy(topics_cvt);
+    cfgmgr_interface_destroy(pub_cfg);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of interfaceModel() testcase ===========" << endl;
+}
+
+TEST(ConfigManagerTest, configViews) {
+    cout << "Test Case: configViews()\n";
+
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+
+    // Typed getters on the app config
+    cfgmgr_view_t app_config = cfgmgr_view_app_config(cfg_mgr);
+    EXPECT_EQ(cfgmgr_view_type(app_config), CFGMGR_VIEW_OBJECT);
+    int64_t max_workers = 0;
+    ASSERT_TRUE(cfgmgr_view_integer(cfgmgr_view_get(app_config, "max_workers"), &max_workers));
+    EXPECT_EQ(max_workers, 4);
+    EXPECT_EQ(cfgmgr_view_type(cfgmgr_view_get(app_config, "not_a_key")), CFGMGR_VIEW_NONE);
+
+    cfgmgr_view_t ingestor = cfgmgr_view_get(app_config, "ingestor");
+    const char* type = NULL;
+    size_t len = 0;
+    ASSERT_TRUE(cfgmgr_view_string(cfgmgr_view_get(ingestor, "type"), &type, &len));
+    EXPECT_EQ(string(type, len), "opencv");
+    double poll_interval = 0;
+    ASSERT_TRUE(cfgmgr_view_floating(cfgmgr_view_get(ingestor, "poll_interval"), &poll_interval));
+    EXPECT_EQ(poll_interval, 0.2);
+    EXPECT_FALSE(cfgmgr_view_integer(cfgmgr_view_get(ingestor, "poll_interval"), &max_workers));
+    bool loop_video = false;
+    ASSERT_TRUE(cfgmgr_view_boolean(cfgmgr_view_get(ingestor, "loop_video"), &loop_video));
+    EXPECT_TRUE(loop_video);
+
+    // Iterating without allocations
+    cfgmgr_view_t udfs = cfgmgr_view_get(app_config, "udfs");
+    EXPECT_EQ(cfgmgr_view_type(udfs), CFGMGR_VIEW_ARRAY);
+    EXPECT_EQ(cfgmgr_view_len(udfs), 1u);
+    cfgmgr_view_iter_t iter = cfgmgr_view_iter(udfs);
+    cfgmgr_view_t udf;
+    const char* key = NULL;
+    ASSERT_TRUE(cfgmgr_view_next(&iter, &udf, &key));
+    EXPECT_EQ(key, nullptr);
+    ASSERT_TRUE(cfgmgr_view_string(cfgmgr_view_get(udf, "type"), &type, NULL));
+    EXPECT_EQ(string(type), "python");
+    EXPECT_FALSE(cfgmgr_view_next(&iter, &udf, &key));
+
+    size_t keys = 0;
+    iter = cfgmgr_view_iter(ingestor);
+    while (cfgmgr_view_next(&iter, &udf, &key)) {
+        EXPECT_NE(key, nullptr);
+        keys++;
+    }
+    EXPECT_EQ(keys, cfgmgr_view_len(ingestor));
+
+    // Interface lists match the allocating getters
+    cfgmgr_interface_t* pub_cfg = cfgmgr_get_publisher_by_name(cfg_mgr, "default");
+    ASSERT_NE(pub_cfg, nullptr);
+    const char* const* topics = NULL;
+    size_t count = 0;
+    ASSERT_TRUE(cfgmgr_view_topics(pub_cfg, &topics, &count));
+    config_value_t* topics_cvt = cfgmgr_get_topics(pub_cfg);
+    ASSERT_NE(topics_cvt, nullptr);
+    ASSERT_EQ(config_value_array_len(topics_cvt), count);
+    for (size_t i = 0; i < count; i++) {
+        config_value_t* topic = config_value_array_get(topics_cvt, i);
+        EXPECT_EQ(string(topic->body.string), topics[i]);
+        config_value_destroy(topic);
+    }
+    config_value_destroy(topics_cvt);
+    const char* end_point = cfgmgr_view_endpoint(pub_cfg);
+    ASSERT_NE(end_point, nullptr);
+    ASSERT_TRUE(cfgmgr_view_string(cfgmgr_view_get(cfgmgr_view_interface(pub_cfg), "EndPoint"), &type, NULL));
+    EXPECT_EQ(string(end_point), type);
+    const char* const* clients = NULL;
+    ASSERT_TRUE(cfgmgr_view_allowed_clients(pub_cfg, &clients, &count));
+    ASSERT_EQ(count, 5u);
+    EXPECT_EQ(string(clients[0]), "TestSubClient");
+    cfgmgr_interface_destroy(pub_cfg);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of configViews() testcase ===========" << endl;
+}
+
+TEST(ConfigManagerTest, allMsgbusConfigs) {
+    cout << "Test Case: allMsgbusConfigs()\n";
+
+    const char* app_names[] = {"TestPubServer", "TestSubClient"};
+    for (const char* app_name : app_names) {
+        setenv("AppName", app_name, 1);
+        cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+        ASSERT_NE(cfg_mgr, nullptr);
+
+        cfgmgr_msgbus_configs_t* configs = cfgmgr_get_all_msgbus_configs(cfg_mgr);
+        ASSERT_NE(configs, nullptr);
+        // Absent interface arrays are counted as -1
+        int counts[] = {cfgmgr_get_num_publishers(cfg_mgr), cfgmgr_get_num_subscribers(cfg_mgr),
+                        cfgmgr_get_num_servers(cfg_mgr), cfgmgr_get_num_clients(cfg_mgr)};
+        size_t expected = 0;
+        for (int count : counts) {
+            expected += (count > 0) ? count : 0;
+        }
+        ASSERT_EQ(configs->count, expected);
+
+        // Same configs as built one interface at a time
+        for (size_t i = 0; i < configs->count; i++) {
+            cfgmgr_msgbus_config_entry_t* entry = &configs->entries[i];
+            ASSERT_NE(entry->name, nullptr);
+            ASSERT_NE(entry->config, nullptr);
+            cfgmgr_interface_t* iface = NULL;
+            if (entry->type == CFGMGR_PUBLISHER) {
+                iface = cfgmgr_get_publisher_by_name(cfg_mgr, entry->name);
+            } else if (entry->type == CFGMGR_SUBSCRIBER) {
+                iface = cfgmgr_get_subscriber_by_name(cfg_mgr, entry->name);
+            } else if (entry->type == CFGMGR_SERVER) {
+                iface = cfgmgr_get_server_by_name(cfg_mgr, entry->name);
+            } else {
+                iface = cfgmgr_get_client_by_name(cfg_mgr, entry->name);
+            }
+            ASSERT_NE(iface, nullptr);
+            char* config_char = configt_to_char(entry->config);
+            EXPECT_EQ(msgbus_config_str(iface), string(config_char));
+            free(config_char);
+            cfgmgr_interface_destroy(iface);
+        }
+        if (configs->count > 1) {
+            EXPECT_LE(configs->entries[0].type, configs->entries[configs->count - 1].type);
+        }
+
+        // Configs can be taken over by the caller
+        config_t* taken = configs->entries[0].config;
+        configs->entries[0].config = NULL;
+        cfgmgr_msgbus_configs_destroy(configs);
+        config_destroy(taken);
+        cfgmgr_destroy(cfg_mgr);
+    }
+
+    cout << " =========== End Of allMsgbusConfigs() testcase ===========" << endl;
+}
+
+// Rebuilds a JSON tree from a binary config through its accessors
+static cJSON* binary_to_json(cfgmgr_binary_t value) {
+    const char* str = NULL;
+    int64_t integer = 0;
+    double floating = 0;
+    bool boolean = false;
+    cfgmgr_binary_t item;
+    const char* key = NULL;
+    cfgmgr_binary_iter_t iter = cfgmgr_binary_iter(value);
+    cJSON* json = NULL;
+    switch (cfgmgr_binary_type(value)) {
+        case CFGMGR_VIEW_STRING:
+            cfgmgr_binary_string(value, &str, NULL);
+            return cJSON_CreateString(str);
+        case CFGMGR_VIEW_INTEGER:
+            cfgmgr_binary_integer(value, &integer);
+            return cJSON_CreateNumber((double) integer);
+        case CFGMGR_VIEW_FLOATING:
+            cfgmgr_binary_floating(value, &floating);
+            return cJSON_CreateNumber(floating);
+        case CFGMGR_VIEW_BOOLEAN:
+            cfgmgr_binary_boolean(value, &boolean);
+            return cJSON_CreateBool(boolean);
+        case CFGMGR_VIEW_NULL:
+            return cJSON_CreateNull();
+        case CFGMGR_VIEW_ARRAY:
+            json = cJSON_CreateArray();
+            while (cfgmgr_binary_next(&iter, &item, NULL)) {
+                cJSON_AddItemToArray(json, binary_to_json(item));
+            }
+            return json;
+        case CFGMGR_VIEW_OBJECT:
+            json = cJSON_CreateObject();
+            while (cfgmgr_binary_next(&iter, &item, &key)) {
+                cJSON_AddItemToObject(json, key, binary_to_json(item));
+            }
+            return json;
+        default:
+            return NULL;
+    }
+}
+
+TEST(ConfigManagerTest, msgbusConfigBinary) {
+    cout << "Test Case: msgbusConfigBinary()\n";
+
+    // Every value type, with keys out of order
+    const char* doc = "{\"z\": [1, -2.5, \"s\\u00e9\", true, false, null, {}, []],"
+                      " \"a\": {\"n\": -2147483648, \"m\": \"\", \"f\": 4294967296}}";
+    cJSON* json = cJSON_Parse(doc);
+    ASSERT_NE(json, nullptr);
+    size_t size = 0;
+    void* buf = cfgmgr_binary_encode(json, &size);
+    ASSERT_NE(buf, nullptr);
+    EXPECT_EQ(size % 4, 0u);
+    EXPECT_EQ(memcmp(buf, CFGMGR_BINARY_MAGIC, 4), 0);
+    cfgmgr_binary_t root = cfgmgr_binary_root(buf, size);
+    ASSERT_EQ(cfgmgr_binary_type(root), CFGMGR_VIEW_OBJECT);
+    EXPECT_EQ(cfgmgr_binary_len(root), 2u);
+    cJSON* rebuilt = binary_to_json(root);
+    EXPECT_TRUE(cJSON_Compare(json, rebuilt, true));
+    cJSON_Delete(rebuilt);
+    cJSON_Delete(json);
+
+    // Lookups and typed accessors
+    cfgmgr_binary_t a = cfgmgr_binary_get(root, "a");
+    EXPECT_EQ(cfgmgr_binary_type(a), CFGMGR_VIEW_OBJECT);
+    int64_t integer = 0;
+    EXPECT_TRUE(cfgmgr_binary_integer(cfgmgr_binary_get(a, "n"), &integer));
+    EXPECT_EQ(integer, -2147483648LL);
+    // Numbers beyond int are floating, as in json_config
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_get(a, "f")), CFGMGR_VIEW_FLOATING);
+    double floating = 0;
+    cfgmgr_binary_t z = cfgmgr_binary_get(root, "z");
+    EXPECT_TRUE(cfgmgr_binary_floating(cfgmgr_binary_at(z, 1), &floating));
+    EXPECT_EQ(floating, -2.5);
+    EXPECT_FALSE(cfgmgr_binary_integer(cfgmgr_binary_at(z, 1), &integer));
+    const char* str = NULL;
+    size_t len = 0;
+    EXPECT_TRUE(cfgmgr_binary_string(cfgmgr_binary_at(z, 2), &str, &len));
+    EXPECT_EQ(string(str, len), "s\xc3\xa9");
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_at(z, 8)), CFGMGR_VIEW_NONE);
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_get(root, "A")), CFGMGR_VIEW_NONE);
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_get(z, "a")), CFGMGR_VIEW_NONE);
+
+    // Truncated, foreign, newer and corrupted buffers are rejected
+    uint8_t* bytes = (uint8_t*) buf;
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_root(buf, size - 4)), CFGMGR_VIEW_NONE);
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_root(buf, 8)), CFGMGR_VIEW_NONE);
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_root(NULL, size)), CFGMGR_VIEW_NONE);
+    vector<uint8_t> copy(bytes, bytes + size);
+    copy[0] = 'X';
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_root(copy.data(), size)), CFGMGR_VIEW_NONE);
+    copy.assign(bytes, bytes + size);
+    copy[4] = CFGMGR_BINARY_VERSION + 1;
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_root(copy.data(), size)), CFGMGR_VIEW_NONE);
+    size_t root_off = (const uint8_t*) root.node - bytes;
+    for (size_t i = root_off; i < size; i += 4) {
+        copy.assign(bytes, bytes + size);
+        copy[i] ^= 0x80;
+        cfgmgr_binary_t corrupted = cfgmgr_binary_root(copy.data(), size);
+        if (corrupted.node != NULL) {
+            // Only payload bytes may change undetected
+            rebuilt = binary_to_json(corrupted);
+            EXPECT_NE(rebuilt, nullptr);
+            cJSON_Delete(rebuilt);
+        }
+    }
+    // A buffer larger than the config, ex: a mapped file
+    copy.assign(bytes, bytes + size);
+    copy.resize(size + 64, 0xff);
+    EXPECT_EQ(cfgmgr_binary_type(cfgmgr_binary_root(copy.data(), copy.size())), CFGMGR_VIEW_OBJECT);
+    free(buf);
+
+    // The first of duplicate keys is kept, as found by cJSON
+    json = cJSON_Parse("{\"k\": 1, \"j\": 2, \"k\": 3}");
+    buf = cfgmgr_binary_encode(json, &size);
+    cJSON_Delete(json);
+    ASSERT_NE(buf, nullptr);
+    root = cfgmgr_binary_root(buf, size);
+    EXPECT_EQ(cfgmgr_binary_len(root), 2u);
+    EXPECT_TRUE(cfgmgr_binary_integer(cfgmgr_binary_get(root, "k"), &integer));
+    EXPECT_EQ(integer, 1);
+    free(buf);
+
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* pub_cfg = cfgmgr_get_publisher_by_name(cfg_mgr, "default");
+    ASSERT_NE(pub_cfg, nullptr);
+
+    // Same config as the JSON one
+    buf = cfgmgr_get_msgbus_config_binary(pub_cfg, &size);
+    ASSERT_NE(buf, nullptr);
+    root = cfgmgr_binary_root(buf, size);
+    rebuilt = binary_to_json(root);
+    config_t* config = cfgmgr_get_msgbus_config(pub_cfg);
+    ASSERT_NE(config, nullptr);
+    EXPECT_TRUE(cJSON_Compare((cJSON*) config->cfg, rebuilt, true));
+    cJSON_Delete(rebuilt);
+    config_value_t* expected = config_get(config, "type");
+    ASSERT_NE(expected, nullptr);
+
+    // config_t over the buffer, for msgbus_initialize()
+    config_t* binary_config = cfgmgr_binary_config_new(buf, size);
+    ASSERT_NE(binary_config, nullptr);
+    config_value_t* value = config_get(binary_config, "type");
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(value->type, CVT_STRING);
+    EXPECT_EQ(string(value->body.string), string(expected->body.string));
+    config_value_destroy(value);
+    cJSON* member = NULL;
+    cJSON_ArrayForEach(member, (cJSON*) config->cfg) {
+        config_value_t* json_value = config_get(config, member->string);
+        value = config_get(binary_config, member->string);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->type, json_value->type);
+        config_value_destroy(json_value);
+        config_value_destroy(value);
+    }
+    EXPECT_EQ(config_get(binary_config, "not_a_key"), nullptr);
+    value = config_value_new_string("zmq_ipc");
+    EXPECT_FALSE(config_set(binary_config, "type", value));
+    config_value_destroy(value);
+    config_destroy(binary_config);
+    config_value_destroy(expected);
+    config_destroy(config);
+
+    // Arrays are not configs
+    json = cJSON_Parse("[1]");
+    void* array_buf = cfgmgr_binary_encode(json, &len);
+    cJSON_Delete(json);
+    ASSERT_NE(array_buf, nullptr);
+    EXPECT_EQ(cfgmgr_binary_config_new(array_buf, len), nullptr);
+    free(array_buf);
+
+    // C++ accessors, taking over the buffer
+    BinaryConfig* cpp_config = new BinaryConfig(buf, size, true);
+    BinaryValue type = (*cpp_config)["type"];
+    EXPECT_EQ(type.type(), CFGMGR_VIEW_STRING);
+    EXPECT_FALSE((*cpp_config)["not_a_key"].exists());
+    BinaryValue cpp_root = cpp_config->root();
+    for (size_t i = 1; i < cpp_root.size(); i++) {
+        EXPECT_LT(strcmp(cpp_root.keyAt(i - 1), cpp_root.keyAt(i)), 0);
+    }
+    EXPECT_THROW(type.getInteger(), const char*);
+    EXPECT_THROW(cpp_root.keyAt(cpp_root.size()), const char*);
+    EXPECT_THROW(BinaryConfig(copy.data(), 8, false), const char*);
+    config = cpp_config->toConfig();
+    value = config_get(config, "type");
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(string(value->body.string), string(type.getString()));
+    config_value_destroy(value);
+    config_destroy(config);
+    delete cpp_config;
+
+    cfgmgr_interface_destroy(pub_cfg);
+    cfgmgr_destroy(cfg_mgr);
+
+    cout << " =========== End Of msgbusConfigBinary() testcase ===========" << endl;
+}
+
+static string change_str(const cfgmgr_change_t& change) {
+    const char* kinds[] = {"added", "removed", "modified"};
+    string str = string(kinds[change.kind]) + " " + change.path;
+    if (change.item != NULL) {
+        str += " " + string(change.item);
+    }
+    return str;
+}
+
+TEST(ConfigManagerTest, diffInterfaces) {
+    cout << "Test Case: diffInterfaces()\n";
+
+    config_t* old_interfaces = json_config_new_from_buffer(
+        "{\"Publishers\": ["
+        "  {\"Name\": \"pub\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:65013\","
+        "   \"Topics\": [\"camera1\", \"camera2\"], \"AllowedClients\": [\"*\"]},"
+        "  {\"Name\": \"gone\", \"Type\": \"zmq_ipc\", \"EndPoint\": \"/tmp\"}],"
+        " \"Subscribers\": ["
+        "  {\"Name\": \"sub\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:65013\","
+        "   \"Topics\": [\"camera1\"], \"zmq_recv_hwm\": 50}]}");
+    config_t* new_interfaces = json_config_new_from_buffer(
+        "{\"Publishers\": ["
+        "  {\"Name\": \"pub\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:65014\","
+        "   \"Topics\": [\"camera2\", \"camera3\"], \"AllowedClients\": [\"*\"]}],"
+        " \"Subscribers\": ["
+        "  {\"Name\": \"sub\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:65013\","
+        "   \"Topics\": [\"camera1\", \"camera4\"]}],"
+        " \"Servers\": [{\"Name\": \"srv\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:66013\"}]}");
+    ASSERT_NE(old_interfaces, nullptr);
+    ASSERT_NE(new_interfaces, nullptr);
+
+    cfgmgr_changes_t* changes = cfgmgr_diff_interfaces(old_interfaces, new_interfaces);
+    ASSERT_NE(changes, nullptr);
+    vector<string> found;
+    for (size_t i = 0; i < changes->count; i++) {
+        found.push_back(change_str(changes->changes[i]));
+        EXPECT_TRUE(changes->changes[i].iface);
+    }
+    vector<string> expected = {
+        "modified Publishers.pub.EndPoint",
+        "removed Publishers.pub.Topics camera1",
+        "added Publishers.pub.Topics camera3",
+        "removed Publishers.gone",
+        "added Subscribers.sub.Topics camera4",
+        "removed Subscribers.sub.zmq_recv_hwm",
+        "added Servers.srv",
+    };
+    EXPECT_EQ(found, expected);
+    ASSERT_EQ(changes->count, expected.size());
+
+    const cfgmgr_change_t& endpoint = changes->changes[0];
+    EXPECT_EQ(endpoint.iface_type, CFGMGR_PUBLISHER);
+    EXPECT_EQ(string(endpoint.iface_name), "pub");
+    EXPECT_EQ(string(endpoint.field), "EndPoint");
+    EXPECT_EQ(string(endpoint.old_value), "\"127.0.0.1:65013\"");
+    EXPECT_EQ(string(endpoint.new_value), "\"127.0.0.1:65014\"");
+    const cfgmgr_change_t& server = changes->changes[6];
+    EXPECT_EQ(server.iface_type, CFGMGR_SERVER);
+    EXPECT_EQ(server.field, nullptr);
+    EXPECT_EQ(server.old_value, nullptr);
+    ASSERT_NE(server.new_value, nullptr);
+    cfgmgr_changes_destroy(changes);
+
+    // Nothing changed
+    changes = cfgmgr_diff_interfaces(new_interfaces, new_interfaces);
+    ASSERT_NE(changes, nullptr);
+    EXPECT_EQ(changes->count, 0u);
+    cfgmgr_changes_destroy(changes);
+
+    config_destroy(old_interfaces);
+    config_destroy(new_interfaces);
+
+    cout << " =========== End Of diffInterfaces() testcase ===========" << endl;
+}
+
+static void on_config_changes(const cfgmgr_changes_t* changes, void* user_data) {
+    vector<string>* found = (vector<string>*) user_data;
+    for (size_t i = 0; i < changes->count; i++) {
+        found->push_back(change_str(changes->changes[i]));
+    }
+}
+
+static void on_config_key(const char* key, config_t* value, void* user_data) {
+    vector<string>* found = (vector<string>*) user_data;
+    ASSERT_NE(value, nullptr);
+    char* config_char = configt_to_char(value);
+    found->push_back(string(key) + " " + config_char);
+    free(config_char);
+    // Each watch owns its copy
+    config_destroy(value);
+}
+
+TEST(ConfigManagerTest, watchConfigChanges) {
+    cout << "Test Case: watchConfigChanges()\n";
+
+    config_t* old_config = json_config_new_from_buffer(
+        "{\"encoding\": {\"level\": 95, \"type\": \"jpeg\"}, \"udfs\": [1], \"max_workers\": 4}");
+    config_t* new_config = json_config_new_from_buffer(
+        "{\"encoding\": {\"level\": 90, \"type\": \"jpeg\"}, \"udfs\": [1, 2], \"queue\": 10}");
+    ASSERT_NE(old_config, nullptr);
+    ASSERT_NE(new_config, nullptr);
+    cfgmgr_changes_t* changes = cfgmgr_diff_config(old_config, new_config);
+    ASSERT_NE(changes, nullptr);
+    vector<string> found;
+    for (size_t i = 0; i < changes->count; i++) {
+        found.push_back(change_str(changes->changes[i]));
+        EXPECT_FALSE(changes->changes[i].iface);
+    }
+    vector<string> expected = {
+        "modified encoding.level", "modified udfs", "removed max_workers", "added queue",
+    };
+    EXPECT_EQ(found, expected);
+    cfgmgr_changes_destroy(changes);
+    config_destroy(old_config);
+    config_destroy(new_config);
+
+    // Live updates of /TestSubClient/config, which is {}
+    setenv("AppName", "TestSubClient", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    vector<string> watched;
+    ASSERT_EQ(cfgmgr_watch_config_changes(cfg_mgr, on_config_changes, &watched), 0);
+    // Shares the watch publishing the config snapshots
+    vector<string> keyed;
+    cfgmgr_watch(cfg_mgr, "/TestSubClient/config", on_config_key, &keyed);
+    // Letting the watch start
+    sleep(2);
+    kv_store_client_t* client = cfg_mgr->kv_store_client;
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/TestSubClient/config",
+                          (char*) "{\"a\": {\"b\": 1}}"), 0);
+    for (int i = 0; i < 50 && watched.empty(); i++) {
+        usleep(100 * 1000);
+    }
+    // The config change was published before being reported
+    config_value_t* published = cfgmgr_get_app_config_value(cfg_mgr, "a");
+    ASSERT_NE(published, nullptr);
+    config_t* handed_out = cfgmgr_get_app_config(cfg_mgr);
+    ASSERT_NE(handed_out, nullptr);
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/TestSubClient/config",
+                          (char*) "{}"), 0);
+    for (int i = 0; i < 50 && (watched.size() < 2 || keyed.size() < 2); i++) {
+        usleep(100 * 1000);
+    }
+    // Both the copied value and the config handed out outlive the update
+    config_value_t* b = config_value_object_get(published, "b");
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(b->body.integer, 1);
+    config_value_destroy(b);
+    config_value_destroy(published);
+    char* handed_out_char = configt_to_char(handed_out);
+    ASSERT_NE(handed_out_char, nullptr);
+    EXPECT_NE(string(handed_out_char).find("\"b\""), string::npos);
+    free(handed_out_char);
+    EXPECT_EQ(cfgmgr_get_app_config_value(cfg_mgr, "a"), nullptr);
+    cfgmgr_destroy(cfg_mgr);
+    EXPECT_EQ(watched, vector<string>({"added a", "removed a"}));
+    ASSERT_EQ(keyed.size(), 2u);
+    EXPECT_EQ(keyed[0].find("/TestSubClient/config {"), 0u);
+    EXPECT_NE(keyed[0].find("\"b\""), string::npos);
+    EXPECT_EQ(keyed[1].find("\"b\""), string::npos);
+
+    cout << " =========== End Of watchConfigChanges() testcase ===========" << endl;
+}
+
+static string snapshot_str(const cfgmgr_snapshot_t* snapshot) {
+    char* config_char = configt_to_char(snapshot->app_config);
+    string str(config_char);
+    free(config_char);
+    return str;
+}
+
+TEST(ConfigManagerTest, snapshots) {
+    cout << "Test Case: snapshots()\n";
+
+    config_t* app_interface = json_config_new_from_buffer("{\"Publishers\": []}");
+    ASSERT_NE(app_interface, nullptr);
+    cfgmgr_snapshots_t* snapshots = cfgmgr_snapshots_new(
+        json_config_new_from_buffer("{\"v\": 1}"), app_interface);
+    ASSERT_NE(snapshots, nullptr);
+
+    cfgmgr_snapshot_guard_t first = cfgmgr_snapshots_pin(snapshots);
+    EXPECT_EQ(first.snapshot->version, 1u);
+    EXPECT_EQ(first.snapshot->app_interface, app_interface);
+    string first_config = snapshot_str(first.snapshot);
+
+    // Pinned snapshots are not reclaimed and do not change
+    ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, json_config_new_from_buffer("{\"v\": 2}"), NULL), 0);
+    EXPECT_EQ(cfgmgr_snapshots_retired(snapshots), 1u);
+    EXPECT_EQ(snapshot_str(first.snapshot), first_config);
+    cfgmgr_snapshot_guard_t second = cfgmgr_snapshots_pin(snapshots);
+    EXPECT_EQ(second.snapshot->version, 2u);
+    EXPECT_NE(snapshot_str(second.snapshot), first_config);
+    EXPECT_NE(second.slot, first.slot);
+
+    // The first one is reclaimed once unpinned, the second one is still pinned
+    cfgmgr_snapshots_unpin(snapshots, &first);
+    EXPECT_EQ(first.snapshot, nullptr);
+    ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, NULL, app_interface), 0);
+    EXPECT_EQ(cfgmgr_snapshots_retired(snapshots), 1u);
+    cfgmgr_snapshot_guard_t third = cfgmgr_snapshots_pin(snapshots);
+    EXPECT_EQ(third.snapshot->version, 3u);
+    // Interfaces only update, the config is shared
+    EXPECT_EQ(third.snapshot->app_config, second.snapshot->app_config);
+    cfgmgr_snapshots_unpin(snapshots, &second);
+    cfgmgr_snapshots_unpin(snapshots, &third);
+
+    // Configs handed out are held until the store is destroyed
+    config_t* kept = cfgmgr_snapshots_app_config(snapshots);
+    ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, json_config_new_from_buffer("{\"v\": 4}"), NULL), 0);
+    EXPECT_EQ(cfgmgr_snapshots_retired(snapshots), 0u);
+    EXPECT_EQ(cfgmgr_snapshots_held(snapshots), 1u);
+    EXPECT_NE(cfgmgr_snapshots_app_config(snapshots), kept);
+    EXPECT_EQ(cfgmgr_snapshots_held(snapshots), 1u);
+    config_value_t* value = kept->get_config_value(kept->cfg, "v");
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(value->body.integer, 2);
+    config_value_destroy(value);
+
+    // Acquired configs are held until released
+    config_t* acquired = cfgmgr_snapshots_acquire_config(snapshots);
+    ASSERT_NE(acquired, nullptr);
+    ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, json_config_new_from_buffer("{\"v\": 5}"), NULL), 0);
+    EXPECT_EQ(cfgmgr_snapshots_held(snapshots), 2u);
+    value = acquired->get_config_value(acquired->cfg, "v");
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(value->body.integer, 4);
+    config_value_destroy(value);
+    cfgmgr_snapshots_release_config(snapshots, acquired);
+    // Still referenced as it was handed out
+    EXPECT_EQ(cfgmgr_snapshots_held(snapshots), 2u);
+    // Configs only acquired are freed with their last reference
+    acquired = cfgmgr_snapshots_acquire_config(snapshots);
+    ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, json_config_new_from_buffer("{\"v\": 6}"), NULL), 0);
+    EXPECT_EQ(cfgmgr_snapshots_held(snapshots), 3u);
+    cfgmgr_snapshots_release_config(snapshots, acquired);
+    EXPECT_EQ(cfgmgr_snapshots_held(snapshots), 2u);
+
+    // Readers always see whole snapshots, in publishing order
+    const int publishes = 2000;
+    std::atomic<bool> done(false);
+    std::atomic<int> errors(0);
+    vector<std::thread> readers;
+    for (int r = 0; r < 4; r++) {
+        readers.emplace_back([&]() {
+            uint64_t last = 0;
+            while (!done) {
+                cfgmgr_snapshot_guard_t guard = cfgmgr_snapshots_pin(snapshots);
+                config_value_t* v = guard.snapshot->app_config->get_config_value(
+                    guard.snapshot->app_config->cfg, "v");
+                if (guard.snapshot->version < last || v == NULL ||
+                        (uint64_t) v->body.integer != guard.snapshot->version) {
+                    errors++;
+                }
+                last = guard.snapshot->version;
+                if (v != NULL) {
+                    config_value_destroy(v);
+                }
+                cfgmgr_snapshots_unpin(snapshots, &guard);
+            }
+        });
+    }
+    for (int i = 7; i < 7 + publishes; i++) {
+        string config = "{\"v\": " + to_string(i) + "}";
+        ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, json_config_new_from_buffer(config.c_str()), NULL), 0);
+    }
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(errors, 0);
+    // Nothing is pinned, the next publish reclaims every retired snapshot
+    ASSERT_EQ(cfgmgr_snapshots_publish(snapshots, NULL, NULL), 0);
+    EXPECT_EQ(cfgmgr_snapshots_retired(snapshots), 0u);
+
+    cfgmgr_snapshots_destroy(snapshots);
+    config_destroy(app_interface);
+
+    cout << " =========== End Of snapshots() testcase ===========" << endl;
+}
+
+TEST(ConfigManagerTest, trace) {
+    cout << "Test Case: trace()\n";
+
+    const char* trace_file = "/tmp/cfgmgr_trace_test.json";
+    remove(trace_file);
+    cfgmgr_trace_reset();
+    setenv("CONFIGMGR_TRACE", trace_file, 1);
+    setenv("AppName", "TestPubServer", 1);
+    unsetenv("SERVER_ENDPOINT");
+    unsetenv("SERVER_default_ENDPOINT");
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    EXPECT_TRUE(cfgmgr_trace_enabled());
+    cfgmgr_interface_t* server_cfg = cfgmgr_get_server_by_name(cfg_mgr, "default");
+    ASSERT_NE(server_cfg, nullptr);
+    ASSERT_NE(msgbus_config_str(server_cfg), "");
+    cfgmgr_interface_destroy(server_cfg);
+    cfgmgr_destroy(cfg_mgr);
+    unsetenv("CONFIGMGR_TRACE");
+    cfgmgr_trace_enable(false);
+
+    cfgmgr_trace_summary_t* summary = cfgmgr_trace_summary();
+    ASSERT_NE(summary, nullptr);
+    std::map<string, cfgmgr_trace_stat_t> stats;
+    for (size_t i = 0; i < summary->count; i++) {
+        stats[summary->stats[i].name] = summary->stats[i];
+        if (i > 0) {
+            EXPECT_GE(summary->stats[i - 1].total_ns, summary->stats[i].total_ns);
+        }
+    }
+    EXPECT_EQ(summary->dropped, 0u);
+    cfgmgr_trace_summary_destroy(summary);
+    ASSERT_EQ(stats.count("cfgmgr_initialize"), 1u);
+    EXPECT_EQ(stats["cfgmgr_initialize"].count, 1u);
+    EXPECT_GE(stats["etcd.range"].count, 3u);
+    EXPECT_EQ(stats["cfgmgr_get_msgbus_config"].count, 1u);
+    EXPECT_EQ(stats["cfgmgr.build_msgbus_config"].count, 1u);
+    // Child spans fit in their parent
+    EXPECT_LE(stats["cfgmgr.parse_config"].total_ns, stats["cfgmgr_initialize"].total_ns);
+
+    // Written again by cfgmgr_destroy(), with the msgbus config build
+    std::ifstream file(trace_file);
+    string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    cJSON* json = cJSON_Parse(contents.c_str());
+    ASSERT_NE(json, nullptr);
+    cJSON* events = cJSON_GetObjectItem(json, "traceEvents");
+    ASSERT_TRUE(cJSON_IsArray(events));
+    bool built = false;
+    cJSON* event = NULL;
+    cJSON_ArrayForEach(event, events) {
+        EXPECT_STREQ(cJSON_GetObjectItem(event, "ph")->valuestring, "X");
+        EXPECT_GE(cJSON_GetObjectItem(event, "dur")->valuedouble, 0.0);
+        if (strcmp(cJSON_GetObjectItem(event, "name")->valuestring, "cfgmgr_get_msgbus_config") == 0) {
+            cJSON* args = cJSON_GetObjectItem(event, "args");
+            ASSERT_NE(args, nullptr);
+            EXPECT_STREQ(cJSON_GetObjectItem(args, "detail")->valuestring, "default");
+            built = true;
+        }
+    }
+    EXPECT_TRUE(built);
+    cJSON_Delete(json);
+
+    // Nothing is recorded while disabled
+    cfgmgr_trace_reset();
+    cfgmgr_trace_span_t span = cfgmgr_trace_begin("disabled");
+    cfgmgr_trace_end(&span, NULL);
+    summary = cfgmgr_trace_summary();
+    ASSERT_NE(summary, nullptr);
+    EXPECT_EQ(summary->count, 0u);
+    cfgmgr_trace_summary_destroy(summary);
+    remove(trace_file);
+
+    cout << " =========== End Of trace() testcase ===========" << endl;
+}
+
+// Number of spans of that name recorded since the last reset
+static uint64_t trace_count(const char* name) {
+    uint64_t count = 0;
+    cfgmgr_trace_summary_t* summary = cfgmgr_trace_summary();
+    for (size_t i = 0; summary != NULL && i < summary->count; i++) {
+        if (strcmp(summary->stats[i].name, name) == 0) {
+            count = summary->stats[i].count;
+        }
+    }
+    cfgmgr_trace_summary_destroy(summary);
+    return count;
+}
+
+TEST(ConfigManagerTest, lazy) {
+    cout << "Test Case: lazy()\n";
+
+    // Reads of the kv_store are counted as spans
+    cfgmgr_trace_reset();
+    cfgmgr_trace_enable(true);
+    setenv("CONFIGMGR_LAZY", "true", 1);
+    setenv("AppName", "TestPubServer", 1);
+    unsetenv("SERVER_ENDPOINT");
+    unsetenv("SERVER_default_ENDPOINT");
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    unsetenv("CONFIGMGR_LAZY");
+    ASSERT_NE(cfg_mgr, nullptr);
+    EXPECT_EQ(trace_count("cfgmgr.kv_store_init"), 0u);
+    cfgmgr_is_dev_mode(cfg_mgr);
+    config_value_t* app_name = cfgmgr_get_appname(cfg_mgr);
+    ASSERT_NE(app_name, nullptr);
+    EXPECT_STREQ(app_name->body.string, "TestPubServer");
+    config_value_destroy(app_name);
+    EXPECT_EQ(trace_count("cfgmgr.kv_store_init"), 0u);
+    EXPECT_EQ(trace_count("etcd.range"), 0u);
+
+    // The config is fetched on first use, once
+    config_t* app_config = cfgmgr_get_app_config(cfg_mgr);
+    ASSERT_NE(app_config, nullptr);
+    EXPECT_EQ(trace_count("cfgmgr.kv_store_init"), 1u);
+    EXPECT_EQ(trace_count("cfgmgr.parse_config"), 1u);
+    EXPECT_EQ(trace_count("cfgmgr.parse_interfaces"), 0u);
+    uint64_t ranges = trace_count("etcd.range");
+    EXPECT_GT(ranges, 0u);
+    config_value_t* max_workers = cfgmgr_get_app_config_value(cfg_mgr, "max_workers");
+    ASSERT_NE(max_workers, nullptr);
+    EXPECT_EQ(max_workers->body.integer, 4);
+    config_value_destroy(max_workers);
+    EXPECT_EQ(trace_count("etcd.range"), ranges);
+
+    // And so are the interfaces, independently
+    EXPECT_GT(cfgmgr_get_num_servers(cfg_mgr), 0);
+    EXPECT_EQ(trace_count("cfgmgr.parse_interfaces"), 1u);
+    ranges = trace_count("etcd.range");
+    cfgmgr_interface_t* server_cfg = cfgmgr_get_server_by_name(cfg_mgr, "default");
+    ASSERT_NE(server_cfg, nullptr);
+    EXPECT_EQ(trace_count("etcd.range"), ranges);
+    EXPECT_EQ(trace_count("cfgmgr.kv_store_init"), 1u);
+    ASSERT_NE(msgbus_config_str(server_cfg), "");
+    cfgmgr_interface_destroy(server_cfg);
+    cfgmgr_snapshot_guard_t guard = cfgmgr_acquire_snapshot(cfg_mgr);
+    EXPECT_NE(guard.snapshot->app_config, nullptr);
+    EXPECT_NE(guard.snapshot->app_interface, nullptr);
+    cfgmgr_release_snapshot(cfg_mgr, &guard);
+
+    // Overrides set by /GlobalEnv/ are seen once connected, without
+    // setting them in the environment other threads may be reading
+    kv_store_client_t* client = cfg_mgr->kv_store_client;
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/",
+                          (char*) "{\"C_LOG_LEVEL\": \"ERROR\","
+                                  " \"SERVER_default_ENDPOINT\": \"127.0.0.1:65099\"}"), 0);
+    cfgmgr_destroy(cfg_mgr);
+    unsetenv("SERVER_default_ENDPOINT");
+    setenv("CONFIGMGR_LAZY", "true", 1);
+    cfg_mgr = cfgmgr_initialize();
+    unsetenv("CONFIGMGR_LAZY");
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_gen_guard_t overrides_guard = cfgmgr_env_overrides_pin(cfg_mgr->env_overrides);
+    EXPECT_EQ(cfgmgr_env_overrides_get(cfg_mgr->env_overrides, CFGMGR_SERVER, "default",
+                                       CFGMGR_OVERRIDE_ENDPOINT), nullptr);
+    cfgmgr_env_overrides_unpin(cfg_mgr->env_overrides, &overrides_guard);
+    ASSERT_NE(cfgmgr_get_app_config(cfg_mgr), nullptr);
+    overrides_guard = cfgmgr_env_overrides_pin(cfg_mgr->env_overrides);
+    const char* endpoint = cfgmgr_env_overrides_get(cfg_mgr->env_overrides, CFGMGR_SERVER,
+                                                    "default", CFGMGR_OVERRIDE_ENDPOINT);
+    ASSERT_NE(endpoint, nullptr);
+    EXPECT_EQ(string(endpoint), "127.0.0.1:65099");
+    cfgmgr_env_overrides_unpin(cfg_mgr->env_overrides, &overrides_guard);
+    EXPECT_EQ(getenv("SERVER_default_ENDPOINT"), nullptr);
+    // They outlive scans of the environment
+    ASSERT_EQ(cfgmgr_reload_env(cfg_mgr), 0);
+    overrides_guard = cfgmgr_env_overrides_pin(cfg_mgr->env_overrides);
+    endpoint = cfgmgr_env_overrides_get(cfg_mgr->env_overrides, CFGMGR_SERVER, "default",
+                                        CFGMGR_OVERRIDE_ENDPOINT);
+    ASSERT_NE(endpoint, nullptr);
+    EXPECT_EQ(string(endpoint), "127.0.0.1:65099");
+    cfgmgr_env_overrides_unpin(cfg_mgr->env_overrides, &overrides_guard);
+    client = cfg_mgr->kv_store_client;
+    ASSERT_EQ(client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/", (char*) "{}"), 0);
+    cfgmgr_destroy(cfg_mgr);
+
+    // Nothing is fetched by a context which is never used
+    cfgmgr_trace_reset();
+    setenv("CONFIGMGR_LAZY", "true", 1);
+    cfg_mgr = cfgmgr_initialize();
+    unsetenv("CONFIGMGR_LAZY");
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_destroy(cfg_mgr);
+    EXPECT_EQ(trace_count("cfgmgr.kv_store_init"), 0u);
+    cfgmgr_trace_enable(false);
+    cfgmgr_trace_reset();
+
+    cout << " =========== End Of lazy() testcase ===========" << endl;
+}
+
+// msgbus configs of every interface of the AppName env, in order
+static vector<string> all_msgbus_configs_str(cfgmgr_ctx_t* cfg_mgr) {
+    vector<string> configs;
+    cfgmgr_msgbus_configs_t* all = cfgmgr_get_all_msgbus_configs(cfg_mgr);
+    for (size_t i = 0; all != NULL && i < all->count; i++) {
+        char* config_char = configt_to_char(all->entries[i].config);
+        configs.push_back((config_char != NULL) ? config_char : "");
+        free(config_char);
+    }
+    cfgmgr_msgbus_configs_destroy(all);
+    return configs;
+}
+
+// Whether both JSON documents are equal, whatever the order of their keys
+static bool same_json(const string& a, const string& b) {
+    cJSON* a_json = cJSON_Parse(a.c_str());
+    cJSON* b_json = cJSON_Parse(b.c_str());
+    bool same = a_json != NULL && cJSON_Compare(a_json, b_json, true);
+    cJSON_Delete(a_json);
+    cJSON_Delete(b_json);
+    return same;
+}
+
+static bool same_json(const vector<string>& a, const vector<string>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!same_json(a[i], b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(ConfigManagerTest, bundle) {
+    cout << "Test Case: bundle()\n";
+
+    const char* app_names[] = {"TestPubServer", "TestSubClient"};
+    unsetenv("SERVER_ENDPOINT");
+    unsetenv("SERVER_default_ENDPOINT");
+    map<string, vector<string>> expected;
+    for (const char* app_name : app_names) {
+        setenv("AppName", app_name, 1);
+        cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+        ASSERT_NE(cfg_mgr, nullptr);
+        expected[app_name] = all_msgbus_configs_str(cfg_mgr);
+        ASSERT_FALSE(expected[app_name].empty());
+        cfgmgr_destroy(cfg_mgr);
+    }
+
+    // Baked from one connection to the kv_store, without the overrides of
+    // the baking process nor setting /GlobalEnv/ in its environment
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    ASSERT_EQ(cfg_mgr->kv_store_client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/",
+                                            (char*) "{\"CFGMGR_TEST_BAKE_ENV\": \"x\"}"), 0);
+    setenv("CLIENT_default_ENDPOINT", "127.0.0.1:66101", 1);
+    cfgmgr_bundle_t* bundle = cfgmgr_bundle_bake(cfg_mgr->kv_store_client, cfg_mgr->kv_store_handle,
+                                                 true, app_names, 2);
+    unsetenv("CLIENT_default_ENDPOINT");
+    EXPECT_EQ(getenv("CFGMGR_TEST_BAKE_ENV"), nullptr);
+    ASSERT_EQ(cfg_mgr->kv_store_client->put(cfg_mgr->kv_store_handle, (char*) "/GlobalEnv/",
+                                            (char*) "{}"), 0);
+    ASSERT_NE(bundle, nullptr);
+    EXPECT_TRUE(cfgmgr_bundle_dev_mode(bundle));
+    ASSERT_EQ(cfgmgr_bundle_app_count(bundle), 2u);
+    EXPECT_STREQ(cfgmgr_bundle_app_name(bundle, 0), "TestPubServer");
+    EXPECT_STREQ(cfgmgr_bundle_app_name(bundle, 1), "TestSubClient");
+    EXPECT_EQ(cfgmgr_bundle_app_name(bundle, 2), nullptr);
+    config_t* baked = cfgmgr_bundle_msgbus_config(bundle, "TestSubClient", CFGMGR_SUBSCRIBER, 0);
+    ASSERT_NE(baked, nullptr);
+    char* baked_char = configt_to_char(baked);
+    EXPECT_TRUE(same_json(baked_char, expected["TestSubClient"][0]));
+    free(baked_char);
+    config_destroy(baked);
+    EXPECT_EQ(cfgmgr_bundle_msgbus_config(bundle, "TestSubClient", CFGMGR_PUBLISHER, 100), nullptr);
+    EXPECT_EQ(cfgmgr_bundle_msgbus_config(bundle, "Unknown", CFGMGR_SERVER, 0), nullptr);
+
+    // Only the keys of the applications are baked
+    kv_store_client_t* kv_client = cfgmgr_bundle_kv_client(bundle);
+    ASSERT_NE(kv_client, nullptr);
+    void* handle = kv_client->init(kv_client);
+    char* value = kv_client->get(handle, (char*) "/TestSubClient/interfaces");
+    ASSERT_NE(value, nullptr);
+    free(value);
+    EXPECT_EQ(kv_client->get(handle, (char*) "/TestSubClient/private_key"), nullptr);
+    EXPECT_NE(kv_client->put(handle, (char*) "/TestSubClient/config", (char*) "{}"), 0);
+    kv_client_free(kv_client);
+    baked = cfgmgr_bundle_msgbus_config(bundle, "TestSubClient", CFGMGR_CLIENT, 0);
+    ASSERT_NE(baked, nullptr);
+    baked_char = configt_to_char(baked);
+    EXPECT_EQ(string(baked_char).find("66101"), string::npos);
+    free(baked_char);
+    config_destroy(baked);
+
+    // The bundle of one application holds its keys only
+    cfgmgr_bundle_t* app_bundle = cfgmgr_bundle_app(bundle, "TestSubClient");
+    ASSERT_NE(app_bundle, nullptr);
+    ASSERT_EQ(cfgmgr_bundle_app_count(app_bundle), 1u);
+    EXPECT_STREQ(cfgmgr_bundle_app_name(app_bundle, 0), "TestSubClient");
+    EXPECT_TRUE(cfgmgr_bundle_dev_mode(app_bundle));
+    kv_client = cfgmgr_bundle_kv_client(app_bundle);
+    ASSERT_NE(kv_client, nullptr);
+    handle = kv_client->init(kv_client);
+    value = kv_client->get(handle, (char*) "/TestSubClient/config");
+    ASSERT_NE(value, nullptr);
+    free(value);
+    EXPECT_EQ(kv_client->get(handle, (char*) "/TestPubServer/interfaces"), nullptr);
+    kv_client_free(kv_client);
+    baked = cfgmgr_bundle_msgbus_config(app_bundle, "TestSubClient", CFGMGR_SUBSCRIBER, 0);
+    ASSERT_NE(baked, nullptr);
+    config_destroy(baked);
+    EXPECT_EQ(cfgmgr_bundle_msgbus_config(app_bundle, "TestPubServer", CFGMGR_SERVER, 0), nullptr);
+    cfgmgr_bundle_destroy(app_bundle);
+    EXPECT_EQ(cfgmgr_bundle_app(bundle, "Unknown"), nullptr);
+
+    char bundle_path[] = "/tmp/cfgmgr_bundle_XXXXXX";
+    int fd = mkstemp(bundle_path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    // Encrypted bundles are only read with their key
+    char key_path[] = "/tmp/cfgmgr_bundle_key_XXXXXX";
+    fd = mkstemp(key_path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    std::ofstream(key_path, std::ios::trunc) << string(2 * CFGMGR_SEAL_KEY_SIZE, 'a') << "\n";
+    unsigned char key[CFGMGR_SEAL_KEY_SIZE];
+    ASSERT_EQ(cfgmgr_seal_read_key(key_path, key), 0);
+    EXPECT_EQ(key[0], 0xaa);
+    ASSERT_EQ(cfgmgr_bundle_write(bundle, bundle_path, key), 0);
+    EXPECT_EQ(cfgmgr_bundle_read(bundle_path, NULL), nullptr);
+    unsigned char other_key[CFGMGR_SEAL_KEY_SIZE];
+    memset(other_key, 0xbb, sizeof(other_key));
+    EXPECT_EQ(cfgmgr_bundle_read(bundle_path, other_key), nullptr);
+    cfgmgr_bundle_t* read_bundle = cfgmgr_bundle_read(bundle_path, key);
+    ASSERT_NE(read_bundle, nullptr);
+    EXPECT_EQ(cfgmgr_bundle_app_count(read_bundle), 2u);
+    cfgmgr_bundle_destroy(read_bundle);
+    setenv("CONFIGMGR_BUNDLE", bundle_path, 1);
+    setenv("CONFIGMGR_BUNDLE_KEY_FILE", key_path, 1);
+    setenv("AppName", "TestSubClient", 1);
+    cfgmgr_ctx_t* sealed_cfg_mgr = cfgmgr_initialize();
+    unsetenv("CONFIGMGR_BUNDLE_KEY_FILE");
+    ASSERT_NE(sealed_cfg_mgr, nullptr);
+    cfgmgr_destroy(sealed_cfg_mgr);
+    EXPECT_EQ(cfgmgr_initialize(), nullptr);
+    unsetenv("CONFIGMGR_BUNDLE");
+    setenv("AppName", "TestPubServer", 1);
+    remove(key_path);
+
+    ASSERT_EQ(cfgmgr_bundle_write(bundle, bundle_path, NULL), 0);
+    cfgmgr_bundle_destroy(bundle);
+
+    // Every application baked when none is named
+    bundle = cfgmgr_bundle_bake(cfg_mgr->kv_store_client, cfg_mgr->kv_store_handle, true, NULL, 0);
+    ASSERT_NE(bundle, nullptr);
+    EXPECT_GE(cfgmgr_bundle_app_count(bundle), 2u);
+    baked = cfgmgr_bundle_msgbus_config(bundle, "TestPubServer", CFGMGR_SERVER, 0);
+    EXPECT_NE(baked, nullptr);
+    config_destroy(baked);
+    cfgmgr_bundle_destroy(bundle);
+    cfgmgr_destroy(cfg_mgr);
+
+    // Initialized from the bundle, without reading the kv_store nor
+    // building msgbus configs
+    cfgmgr_trace_reset();
+    cfgmgr_trace_enable(true);
+    setenv("CONFIGMGR_BUNDLE", bundle_path, 1);
+    for (const char* app_name : app_names) {
+        setenv("AppName", app_name, 1);
+        cfg_mgr = cfgmgr_initialize();
+        ASSERT_NE(cfg_mgr, nullptr);
+        EXPECT_TRUE(same_json(all_msgbus_configs_str(cfg_mgr), expected[app_name]));
+        config_t* app_config = cfgmgr_get_app_config(cfg_mgr);
+        EXPECT_NE(app_config, nullptr);
+        cfgmgr_destroy(cfg_mgr);
+    }
+    EXPECT_EQ(trace_count("cfgmgr.read_bundle"), 2u);
+    EXPECT_EQ(trace_count("etcd.range"), 0u);
+    EXPECT_EQ(trace_count("cfgmgr.build_msgbus_config"), 0u);
+
+    // Overridden interfaces are built from the baked keys
+    setenv("CLIENT_default_ENDPOINT", "127.0.0.1:66100", 1);
+    cfg_mgr = cfgmgr_initialize();
+    unsetenv("CLIENT_default_ENDPOINT");
+    ASSERT_NE(cfg_mgr, nullptr);
+    cfgmgr_interface_t* client_cfg = cfgmgr_get_client_by_name(cfg_mgr, "default");
+    ASSERT_NE(client_cfg, nullptr);
+    EXPECT_NE(msgbus_config_str(client_cfg).find("66100"), string::npos);
+    EXPECT_EQ(trace_count("cfgmgr.build_msgbus_config"), 1u);
+    EXPECT_EQ(trace_count("etcd.range"), 0u);
+    cfgmgr_interface_destroy(client_cfg);
+    cfgmgr_destroy(cfg_mgr);
+    cfgmgr_trace_enable(false);
+    cfgmgr_trace_reset();
+
+    // The bundle must match DEV_MODE
+    setenv("DEV_MODE", "false", 1);
+    EXPECT_EQ(cfgmgr_initialize(), nullptr);
+    setenv("DEV_MODE", "true", 1);
+
+    // Corrupted and missing bundles are rejected
+    std::ofstream(bundle_path, std::ios::binary | std::ios::trunc) << "CFGB not a bundle";
+    EXPECT_EQ(cfgmgr_bundle_read(bundle_path, NULL), nullptr);
+    EXPECT_EQ(cfgmgr_initialize(), nullptr);
+    remove(bundle_path);
+    EXPECT_EQ(cfgmgr_bundle_read(bundle_path, NULL), nullptr);
+    unsetenv("CONFIGMGR_BUNDLE");
+
+    cout << " =========== End Of bundle() testcase ===========" << endl;
+}
+
+// Msgbus config of an interface built in prod mode, "" if the build failed
+static string prod_msgbus_config_str(cfgmgr_ctx_t* cfg_mgr, cfgmgr_interface_t* iface) {
+    int dev_mode = cfg_mgr->dev_mode;
+    cfg_mgr->dev_mode = 1;
+    config_t* config = cfgmgr_msgbus_build(iface, cfg_mgr->kv_store_client, cfg_mgr->kv_store_handle);
+    cfg_mgr->dev_mode = dev_mode;
+    if (config == NULL) {
+        return "";
+    }
+    char* config_char = configt_to_char(config);
+    string result(config_char);
+    free(config_char);
+    config_destroy(config);
+    return result;
+}
+
+TEST(ConfigManagerTest, msgbusConfigBuilderProd) {
+    cout << "Test Case: msgbusConfigBuilderProd()\n";
+
+    // TestBuilderMissing is not provisioned: it has no public key
+    setenv("AppName", "TestPubServer", 1);
+    cfgmgr_ctx_t* cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    map<string, string> kvs = {
+        {"/TestBuilderProd/config", "{}"},
+        {"/TestBuilderProd/interfaces", "{"
+            "\"Publishers\": ["
+                "{\"Name\": \"brokered\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:66200\","
+                " \"Topics\": [\"t1\"], \"AllowedClients\": [\"TestBuilderSub\"],"
+                " \"BrokerAppName\": \"TestBuilderBroker\", \"brokered\": true},"
+                "{\"Name\": \"direct\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:66201\","
+                " \"Topics\": [\"t2\"], \"AllowedClients\": [\"TestBuilderMissing\", \"TestBuilderSub\"]}],"
+            "\"Subscribers\": ["
+                "{\"Name\": \"any\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:66202\","
+                " \"PublisherAppName\": \"*\", \"Topics\": [\"*\"], \"AllowedClients\": [\"TestBuilderSub\"]}],"
+            "\"Clients\": ["
+                "{\"Name\": \"keyed\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:66203\","
+                " \"ServerAppName\": \"TestBuilderSub\"},"
+                "{\"Name\": \"unkeyed\", \"Type\": \"zmq_tcp\", \"EndPoint\": \"127.0.0.1:66204\","
+                " \"ServerAppName\": \"TestBuilderMissing\"}]}"},
+        {"/TestBuilderProd/private_key", "prod_secret"},
+        {"/Publickeys/TestBuilderProd", "prod_public"},
+        {"/Publickeys/TestBuilderSub", "sub_public"},
+        {"/Publickeys/TestBuilderBroker", "broker_public"},
+    };
+    for (auto const& kv : kvs) {
+        ASSERT_EQ(cfg_mgr->kv_store_client->put(cfg_mgr->kv_store_handle, (char*) kv.first.c_str(),
+                                                (char*) kv.second.c_str()), 0);
+    }
+    cfgmgr_destroy(cfg_mgr);
+
+    setenv("AppName", "TestBuilderProd", 1);
+    cfg_mgr = cfgmgr_initialize();
+    ASSERT_NE(cfg_mgr, nullptr);
+    vector<cfgmgr_interface_t*> ifaces = {
+        cfgmgr_get_publisher_by_name(cfg_mgr, "brokered"),
+        cfgmgr_get_publisher_by_name(cfg_mgr, "direct"),
+        cfgmgr_get_subscriber_by_name(cfg_mgr, "any"),
+        cfgmgr_get_client_by_name(cfg_mgr, "keyed"),
+        cfgmgr_get_client_by_name(cfg_mgr, "unkeyed"),
+    };
+    const char* expected[] = {
+        // Publisher connecting to its broker, as a client of it
+        "{\"type\": \"zmq_tcp\", \"zmq_tcp_publish\": {\"host\": \"127.0.0.1\", \"port\": 66200,"
+        " \"brokered\": true, \"server_public_key\": \"broker_public\","
+        " \"client_public_key\": \"prod_public\", \"client_secret_key\": \"prod_secret\"}}",
+        // Serving publisher, the client without a public key is skipped
+        "{\"type\": \"zmq_tcp\", \"allowed_clients\": [\"sub_public\"],"
+        " \"zmq_tcp_publish\": {\"host\": \"127.0.0.1\", \"port\": 66201,"
+        " \"server_secret_key\": \"prod_secret\"}}",
+        // Subscriber of any publisher serves, under "" for the "*" topic
+        "{\"type\": \"zmq_tcp\", \"allowed_clients\": [\"sub_public\"],"
+        " \"\": {\"host\": \"127.0.0.1\", \"port\": 66202, \"server_secret_key\": \"prod_secret\"}}",
+        // Client of a provisioned server
+        "{\"type\": \"zmq_tcp\", \"keyed\": {\"host\": \"127.0.0.1\", \"port\": 66203,"
+        " \"server_public_key\": \"sub_public\", \"client_public_key\": \"prod_public\","
+        " \"client_secret_key\": \"prod_secret\"}}",
+        // Client of a server without a public key yet
+        "{\"type\": \"zmq_tcp\", \"unkeyed\": {\"host\": \"127.0.0.1\", \"port\": 66204,"
+        " \"client_public_key\": \"prod_public\", \"client_secret_key\": \"prod_secret\"}}",
+    };
+    for (size_t i = 0; i < ifaces.size(); i++) {
+        ASSERT_NE(ifaces[i], nullptr);
+        string built = prod_msgbus_config_str(cfg_mgr, ifaces[i]);
+        EXPECT_TRUE(same_json(built, expected[i])) << built;
+    }
+    // Same configs when built in an arena
+    cfg_mgr->msgbus_arena = !cfg_mgr->msgbus_arena;
+    for (size_t i = 0; i < ifaces.size(); i++) {
+        EXPECT_TRUE(same_json(prod_msgbus_config_str(cfg_mgr, ifaces[i]), expected[i]));
+    }
+    cfg_mgr->msgbus_arena = !cfg_mgr->msgbus_arena;
+
+    for (cfgmgr_interface_t* iface : ifaces) {
+        cfgmgr_interface_destroy(iface);
+    }
+    cfgmgr_destroy(cfg_mgr);
+    setenv("AppName", "TestPubServer", 1);
+
+    cout << " =========== End Of msgbusConfigBuilderProd() testcase ===========" << endl;
+}
+
 int main(int argc, char **argv) {
     etcd_requirements_put();
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,735 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM,OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief In-process fake etcd server for hermetic tests and benchmarks
+ *
+ * Implements the subset of the etcd v3 KV, Watch and Lease gRPC services
+ * used by EtcdClient on top of an ordered map with MVCC revisions. Values
+ * are only kept at their latest revision, the event history is kept for
+ * watches resuming from an older revision until it is compacted.
+ */
+
+#ifndef _EII_FAKE_ETCD_SERVER_H
+#define _EII_FAKE_ETCD_SERVER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <condition_variable>
+
+#include <grpcpp/grpcpp.h>
+#include <eii/config_manager/kv_store_plugin/etcd_client/protobuf/rpc.grpc.pb.h>
+#include <eii/config_manager/kv_store_plugin/etcd_client/protobuf/kv.pb.h>
+
+// Interval at which streams and lease expiry re-check for shutdown
+#define FAKE_ETCD_POLL_INTERVAL_MS  50
+
+class FakeEtcdServer {
+    public:
+        FakeEtcdServer() : kv_service(this), watch_service(this),
+                           lease_service(this), revision(1),
+                           compact_revision(0), next_lease_id(1),
+                           stream_generation(0), watches_paused(false),
+                           stopping(false) {}
+
+        ~FakeEtcdServer() {
+            shutdown();
+        }
+
+        /**
+        * Starts serving on the given address
+        * @param address - listening address, port 0 picks a free port
+        * @param creds   - server credentials, ex: grpc::SslServerCredentials()
+        *                  to serve clients in prod mode
+        * @return bound port, or -1 on failure
+        */
+        int start(const std::string& address = "127.0.0.1:0",
+                  std::shared_ptr<grpc::ServerCredentials> creds = grpc::InsecureServerCredentials()) {
+            grpc::ServerBuilder builder;
+            builder.AddListeningPort(address, creds, &bound_port);
+            builder.RegisterService(&kv_service);
+            builder.RegisterService(&watch_service);
+            builder.RegisterService(&lease_service);
+            server = builder.BuildAndStart();
+            if (server == nullptr || bound_port == 0) {
+                return -1;
+            }
+            expiry_thread = std::thread(&FakeEtcdServer::expire_leases, this);
+            return bound_port;
+        }
+
+        /**
+        * Port the server is listening on
+        */
+        int port() const {
+            return bound_port;
+        }
+
+        /**
+        * Channel connected to the server without going through a socket
+        */
+        std::shared_ptr<grpc::Channel> in_process_channel() {
+            grpc::ChannelArguments args;
+            return server->InProcessChannel(args);
+        }
+
+        /**
+        * Stops the server, cancelling all open streams
+        */
+        void shutdown() {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                if (stopping) {
+                    return;
+                }
+                stopping = true;
+            }
+            cv.notify_all();
+            if (server != nullptr) {
+                server->Shutdown(std::chrono::system_clock::now() +
+                                 std::chrono::seconds(1));
+            }
+            if (expiry_thread.joinable()) {
+                expiry_thread.join();
+            }
+        }
+
+        /**
+        * Current store revision
+        */
+        int64_t current_revision() {
+            std::lock_guard<std::mutex> lk(mtx);
+            return revision;
+        }
+
+        /**
+        * Revisions requested by the range requests served since the last
+        * call, 0 for the current revision
+        */
+        std::vector<int64_t> take_range_revisions() {
+            std::lock_guard<std::mutex> lk(mtx);
+            std::vector<int64_t> revisions;
+            revisions.swap(range_revisions);
+            return revisions;
+        }
+
+        /**
+        * Discards the event history before the given revision, watchers
+        * lagging behind it are cancelled with the compact revision set
+        */
+        void compact(int64_t rev) {
+            std::lock_guard<std::mutex> lk(mtx);
+            do_compact(rev);
+        }
+
+        /**
+        * Deletes a key, as a client with DeleteRange rights would
+        * @return number of keys deleted
+        */
+        int64_t erase(const std::string& key) {
+            int64_t deleted;
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                deleted = do_delete(key, "", NULL, false, revision + 1);
+                if (deleted > 0) {
+                    revision++;
+                }
+            }
+            cv.notify_all();
+            return deleted;
+        }
+
+        /**
+        * Holds back the events of every watcher until resumed, as a slow
+        * watch stream would
+        */
+        void pause_watches(bool paused) {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                watches_paused = paused;
+            }
+            cv.notify_all();
+        }
+
+        /**
+        * Aborts every open Watch and LeaseKeepAlive stream, as a
+        * connection loss to etcd would
+        */
+        void drop_streams() {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                stream_generation++;
+            }
+            cv.notify_all();
+        }
+
+    private:
+        struct lease_t {
+            int64_t ttl;
+            std::chrono::steady_clock::time_point deadline;
+            std::set<std::string> keys;
+        };
+
+        // Checks whether key falls in the etcd range [key, range_end)
+        static bool in_range(const std::string& key, const std::string& start,
+                             const std::string& range_end) {
+            if (range_end.empty()) {
+                return key == start;
+            }
+            if (range_end == std::string(1, '\0')) {
+                return key >= start;
+            }
+            return key >= start && key < range_end;
+        }
+
+        void fill_header(etcdserverpb::ResponseHeader* header) {
+            header->set_cluster_id(1);
+            header->set_member_id(1);
+            header->set_revision(revision);
+            header->set_raft_term(1);
+        }
+
+        void do_range(const etcdserverpb::RangeRequest* req,
+                      etcdserverpb::RangeResponse* resp) {
+            range_revisions.push_back(req->revision());
+            int64_t count = 0;
+            auto it = kvs.lower_bound(req->key());
+            for (; it != kvs.end(); ++it) {
+                if (!in_range(it->first, req->key(), req->range_end())) {
+                    if (req->range_end().empty() || it->first >= req->range_end()) {
+                        break;
+                    }
+                    continue;
+                }
+                count++;
+                if (req->count_only()) {
+                    continue;
+                }
+                if (req->limit() > 0 && resp->kvs_size() >= req->limit()) {
+                    resp->set_more(true);
+                    continue;
+                }
+                mvccpb::KeyValue* kv = resp->add_kvs();
+                kv->CopyFrom(it->second);
+                if (req->keys_only()) {
+                    kv->clear_value();
+                }
+            }
+            resp->set_count(count);
+            fill_header(resp->mutable_header());
+        }
+
+        void detach_lease(const std::string& key, int64_t lease_id) {
+            if (lease_id == 0) {
+                return;
+            }
+            auto it = leases.find(lease_id);
+            if (it != leases.end()) {
+                it->second.keys.erase(key);
+            }
+        }
+
+        grpc::Status do_put(const etcdserverpb::PutRequest* req,
+                            etcdserverpb::PutResponse* resp, int64_t rev) {
+            if (req->lease() != 0 && leases.find(req->lease()) == leases.end()) {
+                return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                                    "etcdserver: requested lease not found");
+            }
+            mvccpb::KeyValue kv;
+            auto it = kvs.find(req->key());
+            if (it != kvs.end()) {
+                if (req->prev_kv()) {
+                    resp->mutable_prev_kv()->CopyFrom(it->second);
+                }
+                detach_lease(req->key(), it->second.lease());
+                kv.set_create_revision(it->second.create_revision());
+                kv.set_version(it->second.version() + 1);
+            } else {
+                kv.set_create_revision(rev);
+                kv.set_version(1);
+            }
+            kv.set_key(req->key());
+            kv.set_value(req->value());
+            kv.set_mod_revision(rev);
+            kv.set_lease(req->lease());
+            kvs[req->key()] = kv;
+            if (req->lease() != 0) {
+                leases[req->lease()].keys.insert(req->key());
+            }
+
+            mvccpb::Event event;
+            event.set_type(mvccpb::Event::PUT);
+            event.mutable_kv()->CopyFrom(kv);
+            history.push_back(event);
+            return grpc::Status::OK;
+        }
+
+        int64_t do_delete(const std::string& key, const std::string& range_end,
+                          etcdserverpb::DeleteRangeResponse* resp, bool prev_kv,
+                          int64_t rev) {
+            std::vector<std::string> deleted;
+            for (auto it = kvs.lower_bound(key); it != kvs.end(); ++it) {
+                if (in_range(it->first, key, range_end)) {
+                    deleted.push_back(it->first);
+                } else if (range_end.empty() || it->first >= range_end) {
+                    break;
+                }
+            }
+            for (auto const& k : deleted) {
+                mvccpb::KeyValue& kv = kvs[k];
+                if (resp != NULL && prev_kv) {
+                    resp->add_prev_kvs()->CopyFrom(kv);
+                }
+                detach_lease(k, kv.lease());
+                mvccpb::Event event;
+                event.set_type(mvccpb::Event::DELETE);
+                event.mutable_kv()->set_key(k);
+                event.mutable_kv()->set_mod_revision(rev);
+                history.push_back(event);
+                kvs.erase(k);
+            }
+            return (int64_t) deleted.size();
+        }
+
+        bool compare(const etcdserverpb::Compare& cmp) {
+            auto it = kvs.find(cmp.key());
+            int c = 0;
+            switch (cmp.target()) {
+                case etcdserverpb::Compare::VERSION: {
+                    int64_t v = (it == kvs.end()) ? 0 : it->second.version();
+                    c = (v > cmp.version()) - (v < cmp.version());
+                    break;
+                }
+                case etcdserverpb::Compare::CREATE: {
+                    int64_t v = (it == kvs.end()) ? 0 : it->second.create_revision();
+                    c = (v > cmp.create_revision()) - (v < cmp.create_revision());
+                    break;
+                }
+                case etcdserverpb::Compare::MOD: {
+                    int64_t v = (it == kvs.end()) ? 0 : it->second.mod_revision();
+                    c = (v > cmp.mod_revision()) - (v < cmp.mod_revision());
+                    break;
+                }
+                case etcdserverpb::Compare::VALUE: {
+                    if (it == kvs.end()) {
+                        return false;
+                    }
+                    c = it->second.value().compare(cmp.value());
+                    c = (c > 0) - (c < 0);
+                    break;
+                }
+                default:
+                    return false;
+            }
+            switch (cmp.result()) {
+                case etcdserverpb::Compare::EQUAL:   return c == 0;
+                case etcdserverpb::Compare::GREATER: return c > 0;
+                case etcdserverpb::Compare::LESS:    return c < 0;
+                default:                             return false;
+            }
+        }
+
+        void do_compact(int64_t rev) {
+            if (rev <= compact_revision) {
+                return;
+            }
+            compact_revision = rev;
+            auto it = history.begin();
+            while (it != history.end() && it->kv().mod_revision() < rev) {
+                ++it;
+            }
+            history.erase(history.begin(), it);
+            cv.notify_all();
+        }
+
+        void expire_leases() {
+            std::unique_lock<std::mutex> lk(mtx);
+            while (!stopping) {
+                cv.wait_for(lk, std::chrono::milliseconds(FAKE_ETCD_POLL_INTERVAL_MS));
+                auto now = std::chrono::steady_clock::now();
+                std::vector<int64_t> expired;
+                for (auto const& it : leases) {
+                    if (it.second.deadline <= now) {
+                        expired.push_back(it.first);
+                    }
+                }
+                for (int64_t id : expired) {
+                    revoke(id);
+                }
+                if (!expired.empty()) {
+                    cv.notify_all();
+                }
+            }
+        }
+
+        void revoke(int64_t id) {
+            std::set<std::string> keys = leases[id].keys;
+            leases.erase(id);
+            if (keys.empty()) {
+                return;
+            }
+            int64_t rev = ++revision;
+            for (auto const& k : keys) {
+                do_delete(k, "", NULL, false, rev);
+            }
+        }
+
+        class KVService : public etcdserverpb::KV::Service {
+            public:
+                explicit KVService(FakeEtcdServer* s) : srv(s) {}
+
+                grpc::Status Range(grpc::ServerContext* context,
+                                   const etcdserverpb::RangeRequest* request,
+                                   etcdserverpb::RangeResponse* response) override {
+                    std::lock_guard<std::mutex> lk(srv->mtx);
+                    if (request->revision() > 0 && request->revision() < srv->compact_revision) {
+                        return grpc::Status(grpc::StatusCode::OUT_OF_RANGE,
+                                            "etcdserver: mvcc: required revision has been compacted");
+                    }
+                    srv->do_range(request, response);
+                    return grpc::Status::OK;
+                }
+
+                grpc::Status Put(grpc::ServerContext* context,
+                                 const etcdserverpb::PutRequest* request,
+                                 etcdserverpb::PutResponse* response) override {
+                    grpc::Status status;
+                    {
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        status = srv->do_put(request, response, srv->revision + 1);
+                        if (status.ok()) {
+                            srv->revision++;
+                        }
+                        srv->fill_header(response->mutable_header());
+                    }
+                    srv->cv.notify_all();
+                    return status;
+                }
+
+                grpc::Status DeleteRange(grpc::ServerContext* context,
+                                         const etcdserverpb::DeleteRangeRequest* request,
+                                         etcdserverpb::DeleteRangeResponse* response) override {
+                    {
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        int64_t deleted = srv->do_delete(request->key(), request->range_end(),
+                                                         response, request->prev_kv(),
+                                                         srv->revision + 1);
+                        if (deleted > 0) {
+                            srv->revision++;
+                        }
+                        response->set_deleted(deleted);
+                        srv->fill_header(response->mutable_header());
+                    }
+                    srv->cv.notify_all();
+                    return grpc::Status::OK;
+                }
+
+                grpc::Status Txn(grpc::ServerContext* context,
+                                 const etcdserverpb::TxnRequest* request,
+                                 etcdserverpb::TxnResponse* response) override {
+                    {
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        bool succeeded = true;
+                        for (int i = 0; i < request->compare_size(); i++) {
+                            if (!srv->compare(request->compare(i))) {
+                                succeeded = false;
+                                break;
+                            }
+                        }
+                        auto const& ops = succeeded ? request->success() : request->failure();
+                        // All writes of a transaction share a single revision
+                        int64_t rev = srv->revision + 1;
+                        bool written = false;
+                        for (auto const& op : ops) {
+                            etcdserverpb::ResponseOp* r = response->add_responses();
+                            if (op.has_request_range()) {
+                                int64_t range_rev = op.request_range().revision();
+                                if (range_rev > 0 && range_rev < srv->compact_revision) {
+                                    return grpc::Status(grpc::StatusCode::OUT_OF_RANGE,
+                                                        "etcdserver: mvcc: required revision has been compacted");
+                                }
+                                srv->do_range(&op.request_range(), r->mutable_response_range());
+                            } else if (op.has_request_put()) {
+                                grpc::Status status = srv->do_put(&op.request_put(),
+                                                                  r->mutable_response_put(), rev);
+                                if (!status.ok()) {
+                                    return status;
+                                }
+                                written = true;
+                            } else if (op.has_request_delete_range()) {
+                                auto const& del = op.request_delete_range();
+                                etcdserverpb::DeleteRangeResponse* dr = r->mutable_response_delete_range();
+                                int64_t n = srv->do_delete(del.key(), del.range_end(), dr,
+                                                           del.prev_kv(), rev);
+                                dr->set_deleted(n);
+                                written = written || n > 0;
+                            }
+                        }
+                        if (written) {
+                            srv->revision = rev;
+                        }
+                        response->set_succeeded(succeeded);
+                        srv->fill_header(response->mutable_header());
+                    }
+                    srv->cv.notify_all();
+                    return grpc::Status::OK;
+                }
+
+                grpc::Status Compact(grpc::ServerContext* context,
+                                     const etcdserverpb::CompactionRequest* request,
+                                     etcdserverpb::CompactionResponse* response) override {
+                    std::lock_guard<std::mutex> lk(srv->mtx);
+                    srv->do_compact(request->revision());
+                    srv->fill_header(response->mutable_header());
+                    return grpc::Status::OK;
+                }
+
+            private:
+                FakeEtcdServer* srv;
+        };
+
+        class WatchService : public etcdserverpb::Watch::Service {
+            public:
+                explicit WatchService(FakeEtcdServer* s) : srv(s) {}
+
+                grpc::Status Watch(grpc::ServerContext* context,
+                                   grpc::ServerReaderWriter<etcdserverpb::WatchResponse,
+                                                            etcdserverpb::WatchRequest>* stream) override {
+                    struct watcher_t {
+                        int64_t id;
+                        std::string key;
+                        std::string range_end;
+                        int64_t next_revision;
+                    };
+                    std::vector<watcher_t> watchers;
+                    std::vector<etcdserverpb::WatchResponse> pending;
+                    bool closed = false;
+                    int64_t next_id = 0;
+                    uint64_t generation;
+                    {
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        generation = srv->stream_generation;
+                    }
+
+                    // Requests are read on their own thread so that events
+                    // can be pushed while the client is idle
+                    std::thread reader([&]() {
+                        etcdserverpb::WatchRequest req;
+                        while (stream->Read(&req)) {
+                            std::lock_guard<std::mutex> lk(srv->mtx);
+                            etcdserverpb::WatchResponse resp;
+                            srv->fill_header(resp.mutable_header());
+                            if (req.has_create_request()) {
+                                auto const& create = req.create_request();
+                                resp.set_watch_id(next_id);
+                                resp.set_created(true);
+                                int64_t start = create.start_revision();
+                                if (start > 0 && start < srv->compact_revision) {
+                                    pending.push_back(resp);
+                                    resp.set_created(false);
+                                    resp.set_canceled(true);
+                                    resp.set_compact_revision(srv->compact_revision);
+                                } else {
+                                    watcher_t w;
+                                    w.id = next_id;
+                                    w.key = create.key();
+                                    w.range_end = create.range_end();
+                                    w.next_revision = (start > 0) ? start : srv->revision + 1;
+                                    watchers.push_back(w);
+                                }
+                                next_id++;
+                                pending.push_back(resp);
+                            } else if (req.has_cancel_request()) {
+                                int64_t id = req.cancel_request().watch_id();
+                                watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+                                    [id](const watcher_t& w) { return w.id == id; }), watchers.end());
+                                resp.set_watch_id(id);
+                                resp.set_canceled(true);
+                                pending.push_back(resp);
+                            }
+                            srv->cv.notify_all();
+                        }
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        closed = true;
+                        srv->cv.notify_all();
+                    });
+
+                    std::unique_lock<std::mutex> lk(srv->mtx);
+                    while (!closed && !srv->stopping && !context->IsCancelled() &&
+                           generation == srv->stream_generation) {
+                        for (auto& w : watchers) {
+                            if (srv->watches_paused || w.next_revision > srv->revision) {
+                                continue;
+                            }
+                            etcdserverpb::WatchResponse resp;
+                            srv->fill_header(resp.mutable_header());
+                            resp.set_watch_id(w.id);
+                            if (w.next_revision < srv->compact_revision) {
+                                resp.set_canceled(true);
+                                resp.set_compact_revision(srv->compact_revision);
+                                w.next_revision = INT64_MAX;
+                                pending.push_back(resp);
+                                continue;
+                            }
+                            auto it = std::lower_bound(srv->history.begin(), srv->history.end(),
+                                w.next_revision, [](const mvccpb::Event& e, int64_t rev) {
+                                    return e.kv().mod_revision() < rev;
+                                });
+                            for (; it != srv->history.end(); ++it) {
+                                if (in_range(it->kv().key(), w.key, w.range_end)) {
+                                    resp.add_events()->CopyFrom(*it);
+                                }
+                            }
+                            w.next_revision = srv->revision + 1;
+                            if (resp.events_size() > 0) {
+                                pending.push_back(resp);
+                            }
+                        }
+                        watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+                            [](const watcher_t& w) { return w.next_revision == INT64_MAX; }),
+                            watchers.end());
+                        if (pending.empty()) {
+                            srv->cv.wait_for(lk, std::chrono::milliseconds(FAKE_ETCD_POLL_INTERVAL_MS));
+                            continue;
+                        }
+                        std::vector<etcdserverpb::WatchResponse> out;
+                        out.swap(pending);
+                        lk.unlock();
+                        for (auto const& resp : out) {
+                            stream->Write(resp);
+                        }
+                        lk.lock();
+                    }
+                    bool dropped = (generation != srv->stream_generation);
+                    lk.unlock();
+                    context->TryCancel();
+                    reader.join();
+                    if (dropped) {
+                        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "stream dropped");
+                    }
+                    return grpc::Status::OK;
+                }
+
+            private:
+                FakeEtcdServer* srv;
+        };
+
+        class LeaseService : public etcdserverpb::Lease::Service {
+            public:
+                explicit LeaseService(FakeEtcdServer* s) : srv(s) {}
+
+                grpc::Status LeaseGrant(grpc::ServerContext* context,
+                                        const etcdserverpb::LeaseGrantRequest* request,
+                                        etcdserverpb::LeaseGrantResponse* response) override {
+                    std::lock_guard<std::mutex> lk(srv->mtx);
+                    int64_t id = (request->id() != 0) ? request->id() : srv->next_lease_id++;
+                    lease_t lease;
+                    lease.ttl = request->ttl();
+                    lease.deadline = std::chrono::steady_clock::now() +
+                                     std::chrono::seconds(request->ttl());
+                    srv->leases[id] = lease;
+                    response->set_id(id);
+                    response->set_ttl(request->ttl());
+                    srv->fill_header(response->mutable_header());
+                    return grpc::Status::OK;
+                }
+
+                grpc::Status LeaseRevoke(grpc::ServerContext* context,
+                                         const etcdserverpb::LeaseRevokeRequest* request,
+                                         etcdserverpb::LeaseRevokeResponse* response) override {
+                    {
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        if (srv->leases.find(request->id()) == srv->leases.end()) {
+                            return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                                                "etcdserver: requested lease not found");
+                        }
+                        srv->revoke(request->id());
+                        srv->fill_header(response->mutable_header());
+                    }
+                    srv->cv.notify_all();
+                    return grpc::Status::OK;
+                }
+
+                grpc::Status LeaseKeepAlive(grpc::ServerContext* context,
+                                            grpc::ServerReaderWriter<etcdserverpb::LeaseKeepAliveResponse,
+                                                                     etcdserverpb::LeaseKeepAliveRequest>* stream) override {
+                    etcdserverpb::LeaseKeepAliveRequest req;
+                    uint64_t generation;
+                    {
+                        std::lock_guard<std::mutex> lk(srv->mtx);
+                        generation = srv->stream_generation;
+                    }
+                    while (stream->Read(&req)) {
+                        etcdserverpb::LeaseKeepAliveResponse resp;
+                        {
+                            std::lock_guard<std::mutex> lk(srv->mtx);
+                            if (srv->stopping || generation != srv->stream_generation) {
+                                return grpc::Status(grpc::StatusCode::UNAVAILABLE, "stream dropped");
+                            }
+                            resp.set_id(req.id());
+                            auto it = srv->leases.find(req.id());
+                            if (it != srv->leases.end()) {
+                                it->second.deadline = std::chrono::steady_clock::now() +
+                                                      std::chrono::seconds(it->second.ttl);
+                                resp.set_ttl(it->second.ttl);
+                            }
+                            srv->fill_header(resp.mutable_header());
+                        }
+                        if (!stream->Write(resp)) {
+                            break;
+                        }
+                    }
+                    return grpc::Status::OK;
+                }
+
+            private:
+                FakeEtcdServer* srv;
+        };
+
+        KVService kv_service;
+        WatchService watch_service;
+        LeaseService lease_service;
+        std::unique_ptr<grpc::Server> server;
+        std::thread expiry_thread;
+        int bound_port = 0;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        int64_t revision;
+        int64_t compact_revision;
+        int64_t next_lease_id;
+        uint64_t stream_generation;
+        bool watches_paused;
+        bool stopping;
+        std::map<std::string, mvccpb::KeyValue> kvs;
+        std::vector<mvccpb::Event> history;
+        std::vector<int64_t> range_revisions;
+        std::map<int64_t, lease_t> leases;
+};
+
+#endif // _EII_FAKE_ETCD_SERVER_H
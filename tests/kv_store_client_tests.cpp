@@ -23,16 +23,59 @@
  */
 
 #include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <condition_variable>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "eii/config_manager/kv_store_plugin/kv_store_plugin.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_metrics.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_fault.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_batch.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_mirror.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_shm.h"
+#include "eii/config_manager/kv_store_plugin/kv_store_warm.h"
+#include "eii/config_manager/kv_store_plugin/agent_client/agent_server.h"
+#include "eii/config_manager/kv_store_plugin/etcd_client/etcd_client.h"
 #include "eii/utils/json_config.h"
+#include "fake_etcd_server.h"
 
 #define KV_STORE_CONFIG "./kv_store_unittest_config.json"
 
 static int watch_cb = 0;
 static int watch_prefix_cb = 0;
+static FakeEtcdServer* fake_etcd = NULL;
+
+/**
+ * Runs the tests against an in-process fake etcd server, unless
+ * KV_STORE_TEST_ETCD is set to "real" to use the etcd server at
+ * ETCD_HOST:ETCD_CLIENT_PORT
+ */
+class FakeEtcdEnvironment : public ::testing::Environment {
+    public:
+        void SetUp() override {
+            char* test_etcd = getenv("KV_STORE_TEST_ETCD");
+            if (test_etcd != NULL && strcmp(test_etcd, "real") == 0) {
+                return;
+            }
+            fake_etcd = new FakeEtcdServer();
+            int port = fake_etcd->start();
+            ASSERT_GT(port, 0);
+            setenv("ETCD_HOST", "127.0.0.1", 1);
+            setenv("ETCD_CLIENT_PORT", std::to_string(port).c_str(), 1);
+        }
+
+        void TearDown() override {
+            delete fake_etcd;
+            fake_etcd = NULL;
+        }
+};
 
 void watch_callback(const char* key, config_t* value, void *user_data){
     std::cout << "kv_store_client: watch_callback is called ....." << std::endl;
@@ -44,6 +87,69 @@ void watch_prefix_callback(const char* key, config_t* value, void *user_data){
     watch_prefix_cb++;
 }
 
+static std::mutex fault_watch_mtx;
+static std::condition_variable fault_watch_cv;
+static std::vector<std::string> fault_watch_values;
+
+void fault_watch_callback(const char* key, config_t* value, void *user_data){
+    config_value_t* val = value->get_config_value(value->cfg, key);
+    {
+        std::lock_guard<std::mutex> lock(fault_watch_mtx);
+        fault_watch_values.push_back((val != NULL && val->type == CVT_STRING) ? val->body.string : "");
+    }
+    fault_watch_cv.notify_all();
+    if (val != NULL) {
+        config_value_destroy(val);
+    }
+    config_destroy(value);
+}
+
+// Waits until the fault watch callback got @p count values, or 10 seconds
+static bool wait_fault_watch(size_t count) {
+    std::unique_lock<std::mutex> lock(fault_watch_mtx);
+    return fault_watch_cv.wait_for(lock, std::chrono::seconds(10), [count] {
+        return fault_watch_values.size() >= count;
+    });
+}
+
+static std::string fault_watch_last() {
+    std::lock_guard<std::mutex> lock(fault_watch_mtx);
+    return fault_watch_values.empty() ? "" : fault_watch_values.back();
+}
+
+// Waits until the watch of @p key on @p client delivers events: puts a
+// marker until it is seen, then everything delivered so far is cleared
+static bool sync_fault_watch(kv_store_client_t* client, void* handle, const char* key) {
+    for (int i = 0; i < 100; i++) {
+        client->put(handle, (char*) key, (char*) "sync");
+        std::unique_lock<std::mutex> lock(fault_watch_mtx);
+        if (fault_watch_cv.wait_for(lock, std::chrono::milliseconds(100), [] {
+                return !fault_watch_values.empty() && fault_watch_values.back() == "sync"; })) {
+            break;
+        }
+    }
+    // Ordered after the markers put meanwhile
+    client->put(handle, (char*) key, (char*) "synced");
+    std::unique_lock<std::mutex> lock(fault_watch_mtx);
+    bool synced = fault_watch_cv.wait_for(lock, std::chrono::seconds(10), [] {
+        return !fault_watch_values.empty() && fault_watch_values.back() == "synced"; });
+    fault_watch_values.clear();
+    return synced;
+}
+
+// Polls the fault counters until @p pred holds, or 10 seconds
+template <typename Pred>
+static bool wait_fault_stats(kv_store_client_t* client, Pred pred) {
+    kv_fault_stats_t stats;
+    for (int i = 0; i < 1000; i++) {
+        if (kv_store_fault_stats(client, &stats) == 0 && pred(stats)) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
 kv_store_client_t* get_kv_store_client(){
     config_t* config = json_config_new(KV_STORE_CONFIG);
     kv_store_client_t *kv_store_client = create_kv_client(config);
@@ -116,9 +222,1107 @@ TEST(KVStoreClientTest, watch_prefix){
     kv_client_free(kv_store_client); 
 }
 
+TEST(KVStoreClientTest, lease){
+    std::cout << "Test Case: lease()\n";
+    kv_store_client_t *kv_store_client = get_kv_store_client();
+    EXPECT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+
+    int64_t lease_id = 0;
+    int status = kv_store_client->grant_lease(handle, 2, &lease_id);
+    ASSERT_EQ(0, status);
+    ASSERT_NE(0, lease_id);
+
+    status = kv_store_client->put_with_lease(handle, "/lease_test", "alive", lease_id);
+    ASSERT_EQ(0, status);
+    status = kv_store_client->keepalive(handle, lease_id);
+    ASSERT_EQ(0, status);
+
+    // Key must outlive the lease TTL while it is being kept alive
+    sleep(4);
+    char *get_value = kv_store_client->get(handle, "/lease_test");
+    ASSERT_STREQ("alive", get_value);
+    free(get_value);
+
+    status = kv_store_client->revoke_lease(handle, lease_id);
+    ASSERT_EQ(0, status);
+    // Revoking the lease removes the key attached to it
+    get_value = kv_store_client->get(handle, "/lease_test");
+    ASSERT_TRUE(get_value == NULL || strlen(get_value) == 0);
+    free(get_value);
+
+    // Lease requests record their outcome like every other request
+    ASSERT_NE(0, kv_store_client->revoke_lease(handle, lease_id));
+    ASSERT_EQ(KV_STORE_ERROR, kv_store_last_status());
+    ASSERT_EQ(0, kv_store_client->grant_lease(handle, 2, &lease_id));
+    ASSERT_EQ(KV_STORE_OK, kv_store_last_status());
+    ASSERT_EQ(0, kv_store_client->revoke_lease(handle, lease_id));
+    ASSERT_EQ(KV_STORE_OK, kv_store_last_status());
+
+    kv_client_free(kv_store_client);
+}
+
+TEST(KVStoreClientTest, metrics){
+    std::cout << "Test Case: metrics()\n";
+    kv_store_client_t *kv_store_client = kv_store_metrics_wrap(get_kv_store_client());
+    ASSERT_NE(kv_store_client, nullptr);
+    ASSERT_TRUE(kv_store_metrics_enabled(kv_store_client));
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+
+    for (int i = 0; i < 10; i++) {
+        int status = kv_store_client->put(handle, "/metrics_test", "0123456789");
+        ASSERT_EQ(0, status);
+        char *get_value = kv_store_client->get(handle, "/metrics_test");
+        ASSERT_STREQ("0123456789", get_value);
+        free(get_value);
+    }
+
+    kv_store_metrics_snapshot_t* snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(kv_store_client, snapshot));
+    ASSERT_EQ(10, snapshot->ops[KV_OP_PUT].count);
+    ASSERT_EQ(0, snapshot->ops[KV_OP_PUT].errors);
+    ASSERT_EQ(100, snapshot->ops[KV_OP_PUT].bytes);
+    ASSERT_EQ(10, snapshot->ops[KV_OP_GET].count);
+    ASSERT_EQ(10, snapshot->ops[KV_OP_GET].statuses[KV_STORE_OK]);
+    ASSERT_EQ(100, snapshot->ops[KV_OP_GET].bytes);
+
+    uint64_t p50 = kv_store_metrics_percentile(&snapshot->ops[KV_OP_GET], 50);
+    uint64_t p99 = kv_store_metrics_percentile(&snapshot->ops[KV_OP_GET], 99);
+    ASSERT_GT(p50, 0);
+    ASSERT_LE(p50, p99);
+    ASSERT_LE(p99, snapshot->ops[KV_OP_GET].latency_max_ns);
+    delete snapshot;
+
+    char* prom = kv_store_metrics_prometheus(kv_store_client);
+    ASSERT_NE(prom, nullptr);
+    ASSERT_NE(strstr(prom, "cfgmgr_kv_requests_total{op=\"put\"} 10"), nullptr);
+    ASSERT_NE(strstr(prom, "cfgmgr_kv_latency_seconds_count{op=\"get\"} 10"), nullptr);
+    free(prom);
+
+    // Missing keys are not errors, failures are counted by status
+    kv_store_metrics_reset(kv_store_client);
+    char *missing = kv_store_client->get(handle, "/metrics_test_missing");
+    ASSERT_TRUE(missing == NULL || strlen(missing) == 0);
+    free(missing);
+    snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(kv_store_client, snapshot));
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET].statuses[KV_STORE_NOT_FOUND]);
+    ASSERT_EQ(0, snapshot->ops[KV_OP_GET].errors);
+    delete snapshot;
+    kv_client_free(kv_store_client);
+
+    kv_fault_config_t fault_config;
+    ASSERT_EQ(0, kv_store_fault_parse("get:error=1", &fault_config));
+    kv_store_client = kv_store_metrics_wrap(kv_store_fault_wrap(get_kv_store_client(), &fault_config));
+    ASSERT_NE(kv_store_client, nullptr);
+    handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_EQ(nullptr, kv_store_client->get(handle, "/metrics_test"));
+    snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(kv_store_client, snapshot));
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET].statuses[KV_STORE_UNAVAILABLE]);
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET].errors);
+    ASSERT_EQ(0, snapshot->ops[KV_OP_GET].statuses[KV_STORE_NOT_FOUND]);
+    delete snapshot;
+    prom = kv_store_metrics_prometheus(kv_store_client);
+    ASSERT_NE(prom, nullptr);
+    ASSERT_NE(strstr(prom, "cfgmgr_kv_responses_total{op=\"get\",status=\"unavailable\"} 1"), nullptr);
+    free(prom);
+
+    kv_client_free(kv_store_client);
+}
+
+TEST(KVStoreClientTest, get_batch){
+    std::cout << "Test Case: get_batch()\n";
+    kv_store_client_t *kv_store_client = kv_store_metrics_wrap(get_kv_store_client());
+    ASSERT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_NE(kv_store_client->get_batch, nullptr);
+
+    ASSERT_EQ(0, kv_store_client->put(handle, "/batch_test/a", "value_a"));
+    ASSERT_EQ(0, kv_store_client->put(handle, "/batch_test/b", "value_b"));
+    ASSERT_EQ(0, kv_store_client->put(handle, "/batch_keys/k2", "key_2"));
+    ASSERT_EQ(0, kv_store_client->put(handle, "/batch_keys/k1", "key_1"));
+
+    char* keys[] = {(char*) "/batch_test/a", (char*) "/batch_keys/", (char*) "/batch_test/missing"};
+    bool prefixes[] = {false, true, false};
+    config_t* values = kv_store_client->get_batch(handle, keys, prefixes, 3);
+    ASSERT_NE(values, nullptr);
+    config_value_t* value = config_get(values, "/batch_test/a");
+    ASSERT_NE(value, nullptr);
+    ASSERT_STREQ("value_a", value->body.string);
+    config_value_destroy(value);
+    value = config_get(values, "/batch_keys/k1");
+    ASSERT_NE(value, nullptr);
+    ASSERT_STREQ("key_1", value->body.string);
+    config_value_destroy(value);
+    ASSERT_EQ(nullptr, config_get(values, "/batch_test/missing"));
+    ASSERT_EQ(nullptr, config_get(values, "/batch_test/b"));
+    config_destroy(values);
+
+    // Snapshot over the instrumented client, queued keys are read in one
+    // get_batch() and every other key at most once
+    kv_store_metrics_reset(kv_store_client);
+    kv_store_client_t* batch = kv_store_batch_new(kv_store_client, handle);
+    ASSERT_NE(batch, nullptr);
+    void* batch_handle = batch->init(batch);
+    ASSERT_EQ(0, kv_store_batch_add(batch, "/batch_test/a", false));
+    ASSERT_EQ(0, kv_store_batch_add(batch, "/batch_test/a", false));
+    ASSERT_EQ(0, kv_store_batch_add(batch, "/batch_keys/k1", false));
+    ASSERT_EQ(0, kv_store_batch_add(batch, "/batch_keys/", true));
+    ASSERT_EQ(0, kv_store_batch_add(batch, "/batch_test/missing", false));
+    ASSERT_EQ(0, kv_store_batch_fetch(batch));
+
+    char* get_value = batch->get(batch_handle, (char*) "/batch_test/a");
+    ASSERT_STREQ("value_a", get_value);
+    free(get_value);
+    get_value = batch->get(batch_handle, (char*) "/batch_keys/k2");
+    ASSERT_STREQ("key_2", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, batch->get(batch_handle, (char*) "/batch_test/missing"));
+    ASSERT_EQ(nullptr, batch->get(batch_handle, (char*) "/batch_keys/k3"));
+
+    // Values of a prefix come back sorted by key, as from get_prefix()
+    config_value_t* prefix_values = batch->get_prefix(batch_handle, (char*) "/batch_keys/");
+    ASSERT_NE(prefix_values, nullptr);
+    ASSERT_EQ(2, config_value_array_len(prefix_values));
+    value = config_value_array_get(prefix_values, 0);
+    ASSERT_STREQ("key_1", value->body.string);
+    config_value_destroy(value);
+    config_value_destroy(prefix_values);
+
+    for (int i = 0; i < 2; i++) {
+        get_value = batch->get(batch_handle, (char*) "/batch_test/b");
+        ASSERT_STREQ("value_b", get_value);
+        free(get_value);
+    }
+    kv_client_free(batch);
+
+    kv_store_metrics_snapshot_t* snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(kv_store_client, snapshot));
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET_BATCH].count);
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET].count);
+    ASSERT_EQ(0, snapshot->ops[KV_OP_GET_PREFIX].count);
+    delete snapshot;
+
+    // Keys of later Txns are read at the revision of the first one
+    std::vector<std::string> many_keys;
+    for (int i = 0; i < 300; i++) {
+        many_keys.push_back("/batch_many/" + std::to_string(i));
+    }
+    std::vector<char*> many_ptrs;
+    for (std::string& key : many_keys) {
+        many_ptrs.push_back(&key[0]);
+    }
+    bool many_prefixes[300] = {};
+    ASSERT_EQ(0, kv_store_client->put(handle, many_ptrs[299], "last"));
+    if (fake_etcd != NULL) {
+        fake_etcd->take_range_revisions();
+    }
+    values = kv_store_client->get_batch(handle, many_ptrs.data(), many_prefixes, 300);
+    ASSERT_NE(values, nullptr);
+    value = config_get(values, "/batch_many/299");
+    ASSERT_NE(value, nullptr);
+    ASSERT_STREQ("last", value->body.string);
+    config_value_destroy(value);
+    config_destroy(values);
+    if (fake_etcd != NULL) {
+        std::vector<int64_t> revisions = fake_etcd->take_range_revisions();
+        ASSERT_EQ(300, revisions.size());
+        ASSERT_EQ(0, revisions[0]);
+        ASSERT_EQ(0, revisions[127]);
+        for (size_t i = 128; i < revisions.size(); i++) {
+            ASSERT_EQ(fake_etcd->current_revision(), revisions[i]);
+        }
+    }
+    kv_client_free(kv_store_client);
+
+    // Failed reads are not kept by the snapshot, keys found to be absent are
+    kv_fault_config_t fault_config;
+    ASSERT_EQ(0, kv_store_fault_parse("get:error=1", &fault_config));
+    kv_store_client_t* faulty = kv_store_fault_wrap(get_kv_store_client(), &fault_config);
+    ASSERT_NE(faulty, nullptr);
+    kv_store_client = kv_store_metrics_wrap(faulty);
+    ASSERT_NE(kv_store_client, nullptr);
+    handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+    batch = kv_store_batch_new(kv_store_client, handle);
+    ASSERT_NE(batch, nullptr);
+    batch_handle = batch->init(batch);
+    ASSERT_EQ(nullptr, batch->get(batch_handle, (char*) "/batch_test/a"));
+    memset(&fault_config, 0, sizeof(fault_config));
+    ASSERT_EQ(0, kv_store_fault_configure(faulty, &fault_config));
+    get_value = batch->get(batch_handle, (char*) "/batch_test/a");
+    ASSERT_STREQ("value_a", get_value);
+    free(get_value);
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(nullptr, batch->get(batch_handle, (char*) "/batch_test/missing"));
+    }
+    kv_client_free(batch);
+
+    snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(kv_store_client, snapshot));
+    ASSERT_EQ(3, snapshot->ops[KV_OP_GET].count);
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET].statuses[KV_STORE_NOT_FOUND]);
+    delete snapshot;
+
+    kv_client_free(kv_store_client);
+}
+
+// Collects the keys and values streamed by get_prefix_kv(), stopping once
+// stop_after of them were read when set
+struct prefix_kv_read {
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    size_t stop_after;
+};
+
+int prefix_kv_callback(const char* key, const char* value, void *user_data){
+    prefix_kv_read* read = (prefix_kv_read*) user_data;
+    read->keys.push_back((key != NULL) ? key : "(NULL)");
+    read->values.push_back(value);
+    return (read->stop_after != 0 && read->values.size() >= read->stop_after) ? 1 : 0;
+}
+
+TEST(KVStoreClientTest, get_prefix_kv){
+    std::cout << "Test Case: get_prefix_kv()\n";
+    kv_store_client_t *kv_store_client = kv_store_metrics_wrap(get_kv_store_client());
+    ASSERT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_NE(kv_store_client->get_prefix_kv, nullptr);
+
+    // More keys than fit in one page of the etcd client
+    const int count = 600;
+    char key[64];
+    char value[64];
+    for (int i = count - 1; i >= 0; i--) {
+        snprintf(key, sizeof(key), "/prefix_kv_test/key_%04d", i);
+        snprintf(value, sizeof(value), "value_%04d", i);
+        ASSERT_EQ(0, kv_store_client->put(handle, key, value));
+    }
+    ASSERT_EQ(0, kv_store_client->put(handle, "/prefix_kv_testx", "outside"));
+    kv_store_metrics_reset(kv_store_client);
+
+    prefix_kv_read read = {};
+    ASSERT_EQ(count, kv_store_client->get_prefix_kv(handle, (char*) "/prefix_kv_test/",
+                                                     prefix_kv_callback, &read));
+    ASSERT_EQ((size_t) count, read.values.size());
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "/prefix_kv_test/key_%04d", i);
+        snprintf(value, sizeof(value), "value_%04d", i);
+        ASSERT_EQ(key, read.keys[i]);
+        ASSERT_EQ(value, read.values[i]);
+    }
+
+    kv_store_metrics_snapshot_t* snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(kv_store_client, snapshot));
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET_PREFIX].count);
+    ASSERT_EQ(count * 10, snapshot->ops[KV_OP_GET_PREFIX].bytes);
+    delete snapshot;
+
+    // The callback stops the read early
+    read = {};
+    read.stop_after = 10;
+    ASSERT_EQ(10, kv_store_client->get_prefix_kv(handle, (char*) "/prefix_kv_test/",
+                                                  prefix_kv_callback, &read));
+    ASSERT_EQ(10u, read.values.size());
+    ASSERT_EQ(0, kv_store_client->get_prefix_kv(handle, (char*) "/prefix_kv_missing/",
+                                                 prefix_kv_callback, &read));
+
+    // get_prefix() reads the same values
+    config_value_t* values = kv_store_client->get_prefix(handle, (char*) "/prefix_kv_test/");
+    ASSERT_NE(values, nullptr);
+    ASSERT_EQ(count, config_value_array_len(values));
+    config_value_t* last = config_value_array_get(values, count - 1);
+    ASSERT_STREQ("value_0599", last->body.string);
+    config_value_destroy(last);
+    config_value_destroy(values);
+
+    // kv_stores without get_prefix_kv() fall back to get_prefix()
+    kv_store_client_t* batch = kv_store_batch_new(kv_store_client, handle);
+    ASSERT_NE(batch, nullptr);
+    void* batch_handle = batch->init(batch);
+    ASSERT_EQ(nullptr, batch->get_prefix_kv);
+    read = {};
+    ASSERT_EQ(count, kv_store_get_prefix_each(batch, batch_handle, (char*) "/prefix_kv_test/",
+                                              prefix_kv_callback, &read));
+    ASSERT_EQ("(NULL)", read.keys[0]);
+    ASSERT_EQ("value_0000", read.values[0]);
+    kv_client_free(batch);
+
+    kv_client_free(kv_store_client);
+}
+
+static int mirror_cb = 0;
+static int mirror_deleted_cb = 0;
+
+void mirror_callback(const char* name, const char* value, void *user_data){
+    mirror_cb++;
+    if (value == NULL) {
+        mirror_deleted_cb++;
+    }
+}
+
+TEST(KVStoreClientTest, mirror){
+    std::cout << "Test Case: mirror()\n";
+    kv_store_client_t *writer = get_kv_store_client();
+    ASSERT_NE(writer, nullptr);
+    void *writer_handle = writer->init(writer);
+    ASSERT_NE(writer_handle, nullptr);
+    ASSERT_EQ(0, writer->put(writer_handle, "/mirror_test/b", "key_b"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/mirror_test/a", "key_a"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/mirror_other", "other"));
+
+    // Metrics below the mirror count the reads which reach the kv_store
+    kv_store_client_t *instrumented = kv_store_metrics_wrap(get_kv_store_client());
+    ASSERT_NE(instrumented, nullptr);
+    kv_store_client_t *kv_store_client = kv_store_mirror_wrap(instrumented, "/mirror_test/");
+    ASSERT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_TRUE(kv_store_mirror_active(kv_store_client));
+    ASSERT_FALSE(kv_store_mirror_active(instrumented));
+    mirror_cb = 0;
+    mirror_deleted_cb = 0;
+    ASSERT_EQ(0, kv_store_mirror_listen(kv_store_client, mirror_callback, NULL));
+    kv_store_metrics_reset(instrumented);
+
+    char* get_value = kv_store_client->get(handle, (char*) "/mirror_test/a");
+    ASSERT_STREQ("key_a", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, kv_store_client->get(handle, (char*) "/mirror_test/missing"));
+
+    // Updates, new keys and deleted keys reach the mirror through its watch
+    int64_t lease_id = 0;
+    ASSERT_EQ(0, writer->grant_lease(writer_handle, 60, &lease_id));
+    ASSERT_EQ(0, writer->put_with_lease(writer_handle, "/mirror_test/d", "key_d", lease_id));
+    ASSERT_EQ(0, writer->put(writer_handle, "/mirror_test/c", "key_c"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/mirror_test/a", "key_a2"));
+    ASSERT_EQ(0, writer->revoke_lease(writer_handle, lease_id));
+    sleep(2);
+    ASSERT_EQ(4, mirror_cb);
+    ASSERT_EQ(1, mirror_deleted_cb);
+
+    get_value = kv_store_client->get(handle, (char*) "/mirror_test/a");
+    ASSERT_STREQ("key_a2", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, kv_store_client->get(handle, (char*) "/mirror_test/d"));
+
+    // Values of a prefix come back sorted by key, as from get_prefix()
+    config_value_t* prefix_values = kv_store_client->get_prefix(handle, (char*) "/mirror_test/");
+    ASSERT_NE(prefix_values, nullptr);
+    ASSERT_EQ(3, config_value_array_len(prefix_values));
+    const char* expected[] = {"key_a2", "key_b", "key_c"};
+    for (int i = 0; i < 3; i++) {
+        config_value_t* value = config_value_array_get(prefix_values, i);
+        ASSERT_STREQ(expected[i], value->body.string);
+        config_value_destroy(value);
+    }
+    config_value_destroy(prefix_values);
+
+    // Only keys outside of the prefix are read from the kv_store
+    char* keys[] = {(char*) "/mirror_test/", (char*) "/mirror_other", (char*) "/mirror_test/b"};
+    bool prefixes[] = {true, false, false};
+    config_t* values = kv_store_client->get_batch(handle, keys, prefixes, 3);
+    ASSERT_NE(values, nullptr);
+    config_value_t* value = config_get(values, "/mirror_other");
+    ASSERT_NE(value, nullptr);
+    ASSERT_STREQ("other", value->body.string);
+    config_value_destroy(value);
+    value = config_get(values, "/mirror_test/c");
+    ASSERT_NE(value, nullptr);
+    ASSERT_STREQ("key_c", value->body.string);
+    config_value_destroy(value);
+    ASSERT_EQ(nullptr, config_get(values, "/mirror_test/d"));
+    config_destroy(values);
+
+    kv_store_metrics_snapshot_t* snapshot = new kv_store_metrics_snapshot_t;
+    ASSERT_EQ(0, kv_store_metrics_snapshot(instrumented, snapshot));
+    ASSERT_EQ(0, snapshot->ops[KV_OP_GET].count);
+    ASSERT_EQ(0, snapshot->ops[KV_OP_GET_PREFIX].count);
+    ASSERT_EQ(1, snapshot->ops[KV_OP_GET_BATCH].count);
+    ASSERT_EQ(4, snapshot->ops[KV_OP_WATCH_EVENT].count);
+    delete snapshot;
+
+    kv_client_free(kv_store_client);
+    kv_client_free(writer);
+}
+
+// Polls a client until @p key reads @p expected, NULL for deleted, or
+// 10 seconds
+static bool wait_kv_value(kv_store_client_t* client, void* handle, const char* key,
+                              const char* expected) {
+    for (int i = 0; i < 100; i++) {
+        char* value = client->get(handle, (char*) key);
+        bool same = (value == NULL || expected == NULL) ? value == expected :
+                    strcmp(value, expected) == 0;
+        free(value);
+        if (same) {
+            return true;
+        }
+        usleep(100 * 1000);
+    }
+    return false;
+}
+
+TEST(KVStoreClientTest, mirror_compaction){
+    std::cout << "Test Case: mirror_compaction()\n";
+    if (fake_etcd == NULL) {
+        std::cout << "Skipped, needs the in-process fake etcd server\n";
+        return;
+    }
+    kv_store_client_t *writer = get_kv_store_client();
+    ASSERT_NE(writer, nullptr);
+    void *writer_handle = writer->init(writer);
+    ASSERT_NE(writer_handle, nullptr);
+    ASSERT_EQ(0, writer->put(writer_handle, "/compact_test/revoked", "key_1"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/compact_test/kept", "kept_1"));
+
+    kv_store_client_t *kv_store_client = kv_store_mirror_wrap(get_kv_store_client(),
+                                                              "/compact_test/");
+    ASSERT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_TRUE(kv_store_mirror_active(kv_store_client));
+    mirror_cb = 0;
+    mirror_deleted_cb = 0;
+    ASSERT_EQ(0, kv_store_mirror_listen(kv_store_client, mirror_callback, NULL));
+    ASSERT_TRUE(wait_kv_value(kv_store_client, handle, "/compact_test/revoked", "key_1"));
+
+    // The delete is compacted away before the watch sees it, the mirror
+    // resyncs and drops the key all the same
+    fake_etcd->pause_watches(true);
+    char* etcd_prefix = getenv("ETCD_PREFIX");
+    std::string revoked = std::string((etcd_prefix != NULL) ? etcd_prefix : "") +
+                          "/compact_test/revoked";
+    ASSERT_EQ(1, fake_etcd->erase(revoked));
+    ASSERT_EQ(0, writer->put(writer_handle, "/compact_test/kept", "kept_2"));
+    fake_etcd->compact(fake_etcd->current_revision());
+    fake_etcd->pause_watches(false);
+
+    ASSERT_TRUE(wait_kv_value(kv_store_client, handle, "/compact_test/revoked", NULL));
+    ASSERT_TRUE(wait_kv_value(kv_store_client, handle, "/compact_test/kept", "kept_2"));
+    ASSERT_EQ(2, mirror_cb);
+    ASSERT_EQ(1, mirror_deleted_cb);
+
+    // Later events are delivered from the revision of the resync
+    ASSERT_EQ(0, writer->put(writer_handle, "/compact_test/kept", "kept_3"));
+    ASSERT_TRUE(wait_kv_value(kv_store_client, handle, "/compact_test/kept", "kept_3"));
+
+    kv_client_free(kv_store_client);
+    kv_client_free(writer);
+}
+
+static int shm_cb = 0;
+static int shm_deleted_cb = 0;
+
+void shm_callback(const char* key, const char* value, void *user_data){
+    shm_cb++;
+    if (value == NULL) {
+        shm_deleted_cb++;
+    }
+}
+
+TEST(KVStoreClientTest, shared_memory){
+    std::cout << "Test Case: shared_memory()\n";
+    std::string name = "/cfgmgr_shm_test_" + std::to_string(getpid());
+    shm_unlink(name.c_str());
+    kv_store_client_t *writer = get_kv_store_client();
+    ASSERT_NE(writer, nullptr);
+    void *writer_handle = writer->init(writer);
+    ASSERT_NE(writer_handle, nullptr);
+    ASSERT_EQ(0, writer->put(writer_handle, "/shm_test/a", "key_a"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/shm_test/b", "key_b"));
+
+    // The first client leads, the second one reads the segment
+    kv_store_client_t *leader = kv_store_shm_wrap(get_kv_store_client(), name.c_str(), "/shm_test/, /shm_other/");
+    ASSERT_NE(leader, nullptr);
+    void *leader_handle = leader->init(leader);
+    ASSERT_NE(leader_handle, nullptr);
+    ASSERT_TRUE(kv_store_shm_leader(leader));
+    ASSERT_TRUE(kv_store_shm_connected(leader));
+    kv_store_client_t *follower = kv_store_shm_wrap(get_kv_store_client(), name.c_str(), "/shm_test/, /shm_other/");
+    ASSERT_NE(follower, nullptr);
+    void *handle = follower->init(follower);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_FALSE(kv_store_shm_leader(follower));
+
+    char* get_value = follower->get(handle, (char*) "/shm_test/a");
+    ASSERT_STREQ("key_a", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, follower->get(handle, (char*) "/shm_test/missing"));
+    config_value_t* prefix_values = follower->get_prefix(handle, (char*) "/shm_test/");
+    ASSERT_NE(prefix_values, nullptr);
+    ASSERT_EQ(2, config_value_array_len(prefix_values));
+    config_value_destroy(prefix_values);
+    shm_cb = 0;
+    shm_deleted_cb = 0;
+    ASSERT_EQ(0, follower->watch_prefix_kv(handle, (char*) "/shm_test/", shm_callback, NULL));
+    ASSERT_EQ(2, shm_cb);
+    ASSERT_FALSE(kv_store_shm_connected(follower));
+
+    // Updates reach the follower through the leader
+    ASSERT_EQ(0, writer->put(writer_handle, "/shm_test/a", "key_a2"));
+    int64_t lease_id = 0;
+    ASSERT_EQ(0, writer->grant_lease(writer_handle, 60, &lease_id));
+    ASSERT_EQ(0, writer->put_with_lease(writer_handle, "/shm_test/c", "key_c", lease_id));
+    ASSERT_EQ(0, writer->revoke_lease(writer_handle, lease_id));
+    sleep(1);
+    get_value = follower->get(handle, (char*) "/shm_test/a");
+    ASSERT_STREQ("key_a2", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, follower->get(handle, (char*) "/shm_test/c"));
+    ASSERT_GE(shm_cb, 3);
+    ASSERT_EQ(shm_cb - 3, 2 * shm_deleted_cb);
+    ASSERT_FALSE(kv_store_shm_connected(follower));
+
+    // A delete compacted away before the leader's watch sees it is
+    // resynced all the same
+    if (fake_etcd != NULL) {
+        fake_etcd->pause_watches(true);
+        char* etcd_prefix = getenv("ETCD_PREFIX");
+        std::string removed = std::string((etcd_prefix != NULL) ? etcd_prefix : "") + "/shm_test/b";
+        ASSERT_EQ(1, fake_etcd->erase(removed));
+        fake_etcd->compact(fake_etcd->current_revision());
+        fake_etcd->pause_watches(false);
+        ASSERT_TRUE(wait_kv_value(follower, handle, "/shm_test/b", NULL));
+        get_value = follower->get(handle, (char*) "/shm_test/a");
+        ASSERT_STREQ("key_a2", get_value);
+        free(get_value);
+        ASSERT_FALSE(kv_store_shm_connected(follower));
+    }
+
+    // Keys outside of the shared prefixes are read from the kv_store
+    ASSERT_EQ(0, writer->put(writer_handle, "/shm_unshared", "unshared"));
+    get_value = follower->get(handle, (char*) "/shm_unshared");
+    ASSERT_STREQ("unshared", get_value);
+    free(get_value);
+    ASSERT_TRUE(kv_store_shm_connected(follower));
+
+    // The follower takes the lead once the leader is gone
+    kv_client_free(leader);
+    sleep(1);
+    ASSERT_TRUE(kv_store_shm_leader(follower));
+    ASSERT_EQ(0, writer->put(writer_handle, "/shm_test/b", "key_b2"));
+    sleep(1);
+    get_value = follower->get(handle, (char*) "/shm_test/b");
+    ASSERT_STREQ("key_b2", get_value);
+    free(get_value);
+
+    kv_client_free(follower);
+    kv_client_free(writer);
+    shm_unlink(name.c_str());
+}
+
+static int agent_kv_cb = 0;
+static int agent_deleted_cb = 0;
+static int agent_watch_cb = 0;
+
+void agent_kv_callback(const char* key, const char* value, void *user_data){
+    agent_kv_cb++;
+    if (value == NULL) {
+        agent_deleted_cb++;
+    }
+}
+
+void agent_watch_callback(const char* key, config_t* value, void *user_data){
+    agent_watch_cb++;
+    config_destroy(value);
+}
+
+TEST(KVStoreClientTest, agent){
+    std::cout << "Test Case: agent()\n";
+    std::string path = "/tmp/cfgmgr_agent_test_" + std::to_string(getpid()) + ".sock";
+    kv_store_client_t *writer = get_kv_store_client();
+    ASSERT_NE(writer, nullptr);
+    void *writer_handle = writer->init(writer);
+    ASSERT_NE(writer_handle, nullptr);
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_test/a", "key_a"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_test/b", "key_b"));
+
+    agent_server_t* server = agent_server_start(get_kv_store_client(), path.c_str(), true);
+    ASSERT_NE(server, nullptr);
+    // A second agent does not steal the socket
+    ASSERT_EQ(nullptr, agent_server_start(get_kv_store_client(), path.c_str(), true));
+
+    std::string agent_config = "{\"type\": \"agent\", \"agent_kv_store\": {\"socket_path\": \"" + path + "\"}}";
+    config_t* config = json_config_new_from_buffer(agent_config.c_str());
+    ASSERT_NE(config, nullptr);
+    kv_store_client_t *agent = create_kv_client(config);
+    config_destroy(config);
+    ASSERT_NE(agent, nullptr);
+    void *handle = agent->init(agent);
+    ASSERT_NE(handle, nullptr);
+
+    char* get_value = agent->get(handle, (char*) "/agent_test/a");
+    ASSERT_STREQ("key_a", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, agent->get(handle, (char*) "/agent_test/missing"));
+    config_value_t* prefix_values = agent->get_prefix(handle, (char*) "/agent_test/");
+    ASSERT_NE(prefix_values, nullptr);
+    ASSERT_EQ(2, config_value_array_len(prefix_values));
+    config_value_destroy(prefix_values);
+    ASSERT_EQ(nullptr, agent->get_prefix(handle, (char*) "/agent_missing/"));
+
+    agent_kv_cb = 0;
+    agent_deleted_cb = 0;
+    agent_watch_cb = 0;
+    ASSERT_EQ(0, agent->watch_prefix_kv(handle, (char*) "/agent_test/", agent_kv_callback, NULL));
+    ASSERT_EQ(2, agent_kv_cb);
+    agent->watch(handle, (char*) "/agent_test/b", agent_watch_callback, NULL);
+
+    // Writes and leases go through the agent, and come back from its cache
+    ASSERT_EQ(0, agent->put(handle, (char*) "/agent_test/a", (char*) "key_a2"));
+    int64_t lease_id = 0;
+    ASSERT_EQ(0, agent->grant_lease(handle, 60, &lease_id));
+    ASSERT_EQ(0, agent->put_with_lease(handle, (char*) "/agent_test/c", (char*) "key_c", lease_id));
+    ASSERT_EQ(0, agent->keepalive(handle, lease_id));
+    ASSERT_EQ(0, agent->revoke_lease(handle, lease_id));
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_test/b", "key_b2"));
+    sleep(1);
+    get_value = agent->get(handle, (char*) "/agent_test/a");
+    ASSERT_STREQ("key_a2", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, agent->get(handle, (char*) "/agent_test/c"));
+    ASSERT_EQ(6, agent_kv_cb);
+    ASSERT_EQ(1, agent_deleted_cb);
+    ASSERT_EQ(1, agent_watch_cb);
+
+    // Idle prefixes without watches are dropped, and read again on their
+    // next use
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_idle/a", "idle_1"));
+    ASSERT_TRUE(wait_kv_value(agent, handle, "/agent_idle/a", "idle_1"));
+    ASSERT_GE(agent_server_evict_idle(server, 0), 1);
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_idle/a", "idle_2"));
+    get_value = agent->get(handle, (char*) "/agent_idle/a");
+    ASSERT_STREQ("idle_2", get_value);
+    free(get_value);
+    get_value = agent->get(handle, (char*) "/agent_test/a");
+    ASSERT_STREQ("key_a2", get_value);
+    free(get_value);
+
+    // Deletes compacted away before the agent's watch sees them reach the
+    // watches of the clients all the same
+    int compaction_cb = 0;
+    if (fake_etcd != NULL) {
+        ASSERT_EQ(0, writer->put(writer_handle, "/agent_test/d", "key_d"));
+        ASSERT_TRUE(wait_kv_value(agent, handle, "/agent_test/d", "key_d"));
+        fake_etcd->pause_watches(true);
+        char* etcd_prefix = getenv("ETCD_PREFIX");
+        std::string removed = std::string((etcd_prefix != NULL) ? etcd_prefix : "") + "/agent_test/d";
+        ASSERT_EQ(1, fake_etcd->erase(removed));
+        fake_etcd->compact(fake_etcd->current_revision());
+        fake_etcd->pause_watches(false);
+        ASSERT_TRUE(wait_kv_value(agent, handle, "/agent_test/d", NULL));
+        sleep(1);
+        ASSERT_EQ(8, agent_kv_cb);
+        ASSERT_EQ(2, agent_deleted_cb);
+        compaction_cb = 2;
+    }
+
+    // Watches get the changes made while the agent was down
+    agent_server_stop(server);
+    ASSERT_EQ(nullptr, agent->get(handle, (char*) "/agent_test/a"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_test/b", "key_b3"));
+    server = agent_server_start(get_kv_store_client(), path.c_str(), true);
+    ASSERT_NE(server, nullptr);
+    sleep(2);
+    ASSERT_EQ(7 + compaction_cb, agent_kv_cb);
+    ASSERT_EQ(2, agent_watch_cb);
+    get_value = agent->get(handle, (char*) "/agent_test/b");
+    ASSERT_STREQ("key_b3", get_value);
+    free(get_value);
+
+    kv_client_free(agent);
+    agent_server_stop(server);
+    kv_client_free(writer);
+}
+
+TEST(KVStoreClientTest, agentProdMode){
+    std::cout << "Test Case: agentProdMode()\n";
+    std::string path = "/tmp/cfgmgr_agent_prod_test_" + std::to_string(getpid()) + ".sock";
+    kv_store_client_t *writer = get_kv_store_client();
+    ASSERT_NE(writer, nullptr);
+    void *writer_handle = writer->init(writer);
+    ASSERT_NE(writer_handle, nullptr);
+    ASSERT_EQ(0, writer->put(writer_handle, "/GlobalEnv/agent_prod", "global"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/agent_prod/private_key", "secret"));
+
+    agent_server_t* server = agent_server_start(get_kv_store_client(), path.c_str(), false);
+    ASSERT_NE(server, nullptr);
+
+    // Only shared keys are served, private keys and writes are denied
+    std::string socket_config = "\"agent_kv_store\": {\"socket_path\": \"" + path + "\"}";
+    config_t* config = json_config_new_from_buffer(("{\"type\": \"agent\", " + socket_config + "}").c_str());
+    ASSERT_NE(config, nullptr);
+    kv_store_client_t *agent = create_kv_client(config);
+    config_destroy(config);
+    ASSERT_NE(agent, nullptr);
+    void *handle = agent->init(agent);
+    ASSERT_NE(handle, nullptr);
+    char* get_value = agent->get(handle, (char*) "/GlobalEnv/agent_prod");
+    ASSERT_STREQ("global", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, agent->get(handle, (char*) "/agent_prod/private_key"));
+    ASSERT_EQ(KV_STORE_PERMISSION_DENIED, kv_store_last_status());
+    ASSERT_EQ(nullptr, agent->get_prefix(handle, (char*) "/"));
+    ASSERT_EQ(KV_STORE_PERMISSION_DENIED, kv_store_last_status());
+    ASSERT_EQ(-1, agent->watch_prefix_kv(handle, (char*) "/agent_prod/", agent_kv_callback, NULL));
+    ASSERT_EQ(-1, agent->put(handle, (char*) "/GlobalEnv/agent_prod", (char*) "changed"));
+    int64_t lease_id = 0;
+    ASSERT_EQ(-1, agent->grant_lease(handle, 60, &lease_id));
+    kv_client_free(agent);
+
+    // With its own etcd config, the application reads and writes the
+    // denied keys itself
+    config = json_config_new_from_buffer(("{\"type\": \"agent\", " + socket_config + ", "
+        "\"etcd_kv_store\": {\"cert_file\": \"\", \"key_file\": \"\", \"ca_file\": \"\"}}").c_str());
+    ASSERT_NE(config, nullptr);
+    agent = create_kv_client(config);
+    config_destroy(config);
+    ASSERT_NE(agent, nullptr);
+    handle = agent->init(agent);
+    ASSERT_NE(handle, nullptr);
+    get_value = agent->get(handle, (char*) "/agent_prod/private_key");
+    ASSERT_STREQ("secret", get_value);
+    free(get_value);
+    ASSERT_EQ(KV_STORE_OK, kv_store_last_status());
+    agent_kv_cb = 0;
+    ASSERT_EQ(0, agent->watch_prefix_kv(handle, (char*) "/agent_prod/", agent_kv_callback, NULL));
+    ASSERT_EQ(1, agent_kv_cb);
+    ASSERT_EQ(0, agent->put(handle, (char*) "/agent_prod/a", (char*) "key_a"));
+    ASSERT_EQ(0, agent->grant_lease(handle, 60, &lease_id));
+    ASSERT_EQ(0, agent->put_with_lease(handle, (char*) "/agent_prod/b", (char*) "key_b", lease_id));
+    ASSERT_EQ(0, agent->revoke_lease(handle, lease_id));
+    get_value = writer->get(writer_handle, (char*) "/agent_prod/a");
+    ASSERT_STREQ("key_a", get_value);
+    free(get_value);
+    get_value = agent->get(handle, (char*) "/GlobalEnv/agent_prod");
+    ASSERT_STREQ("global", get_value);
+    free(get_value);
+    sleep(1);
+    ASSERT_EQ(4, agent_kv_cb);
+
+    kv_client_free(agent);
+    agent_server_stop(server);
+    kv_client_free(writer);
+}
+
+static int warm_watch_cb = 0;
+
+void warm_watch_callback(const char* key, config_t* value, void *user_data){
+    warm_watch_cb++;
+    config_destroy(value);
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+static kv_store_client_t* get_warm_client(const std::string& path, const unsigned char* key, bool slow) {
+    kv_store_client_t* inner = get_kv_store_client();
+    if (slow) {
+        kv_fault_config_t fault_config;
+        kv_store_fault_parse("get:latency=fixed:500000", &fault_config);
+        inner = kv_store_fault_wrap(inner, &fault_config);
+    }
+    return kv_store_warm_wrap(inner, path.c_str(), "warm_test", key, "/warm_test/private_key");
+}
+
+TEST(KVStoreClientTest, warm_start){
+    std::cout << "Test Case: warm_start()\n";
+    std::string path = "/tmp/cfgmgr_warm_test_" + std::to_string(getpid());
+    unlink(path.c_str());
+    kv_store_client_t *writer = get_kv_store_client();
+    ASSERT_NE(writer, nullptr);
+    void *writer_handle = writer->init(writer);
+    ASSERT_NE(writer_handle, nullptr);
+    ASSERT_EQ(0, writer->put(writer_handle, "/warm_test/config", "{\"a\": 1}"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/warm_test/private_key", "secret_value"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/warm_test/keys/x", "key_x"));
+    ASSERT_EQ(0, writer->put(writer_handle, "/warm_test/keys/y", "key_y"));
+
+    // Without a snapshot the kv_store is read, and recorded
+    kv_store_client_t *warm = get_warm_client(path, NULL, false);
+    ASSERT_NE(warm, nullptr);
+    void *handle = warm->init(warm);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_FALSE(kv_store_warm_started(warm));
+    ASSERT_TRUE(kv_store_warm_live(warm));
+    char* get_value = warm->get(handle, (char*) "/warm_test/config");
+    ASSERT_STREQ("{\"a\": 1}", get_value);
+    free(get_value);
+    get_value = warm->get(handle, (char*) "/warm_test/private_key");
+    ASSERT_STREQ("secret_value", get_value);
+    free(get_value);
+    config_value_t* prefix_values = warm->get_prefix(handle, (char*) "/warm_test/keys/");
+    ASSERT_NE(prefix_values, nullptr);
+    ASSERT_EQ(2, config_value_array_len(prefix_values));
+    config_value_destroy(prefix_values);
+    ASSERT_EQ(0, kv_store_warm_persist(warm));
+    kv_client_free(warm);
+    std::string content = read_file(path);
+    ASSERT_NE(std::string::npos, content.find("key_x"));
+    // Secrets are only recorded in encrypted snapshots
+    ASSERT_EQ(std::string::npos, content.find("secret_value"));
+
+    // The next start reads the snapshot, while the kv_store is slow
+    ASSERT_EQ(0, writer->put(writer_handle, "/warm_test/config", "{\"a\": 2}"));
+    warm = get_warm_client(path, NULL, true);
+    ASSERT_NE(warm, nullptr);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    handle = warm->init(warm);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_TRUE(kv_store_warm_started(warm));
+    get_value = warm->get(handle, (char*) "/warm_test/config");
+    ASSERT_STREQ("{\"a\": 1}", get_value);
+    free(get_value);
+    ASSERT_EQ(nullptr, warm->get(handle, (char*) "/warm_test/keys/z"));
+    prefix_values = warm->get_prefix(handle, (char*) "/warm_test/keys/");
+    ASSERT_NE(prefix_values, nullptr);
+    ASSERT_EQ(2, config_value_array_len(prefix_values));
+    config_value_destroy(prefix_values);
+    warm_watch_cb = 0;
+    warm->watch(handle, (char*) "/warm_test/config", warm_watch_callback, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long elapsed_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+    ASSERT_LT(elapsed_us, 250000);
+
+    // The change made meanwhile is notified once reconciled
+    for (int i = 0; i < 50 && !kv_store_warm_live(warm); i++) {
+        usleep(100000);
+    }
+    ASSERT_TRUE(kv_store_warm_live(warm));
+    ASSERT_EQ(1, warm_watch_cb);
+    get_value = warm->get(handle, (char*) "/warm_test/config");
+    ASSERT_STREQ("{\"a\": 2}", get_value);
+    free(get_value);
+    ASSERT_EQ(0, writer->put(writer_handle, "/warm_test/config", "{\"a\": 3}"));
+    sleep(1);
+    ASSERT_EQ(2, warm_watch_cb);
+    kv_client_free(warm);
+
+    // A tampered snapshot is ignored
+    content = read_file(path);
+    content[content.size() / 2] ^= 0x1;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    warm = get_warm_client(path, NULL, false);
+    ASSERT_NE(warm, nullptr);
+    ASSERT_NE(nullptr, warm->init(warm));
+    ASSERT_FALSE(kv_store_warm_started(warm));
+    kv_client_free(warm);
+
+    // Encrypted snapshots record secrets, and only open with their key
+    unsigned char key[KV_STORE_WARM_KEY_SIZE];
+    for (int i = 0; i < KV_STORE_WARM_KEY_SIZE; i++) {
+        key[i] = (unsigned char) i;
+    }
+    warm = get_warm_client(path, key, false);
+    ASSERT_NE(warm, nullptr);
+    handle = warm->init(warm);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_FALSE(kv_store_warm_started(warm));
+    get_value = warm->get(handle, (char*) "/warm_test/private_key");
+    ASSERT_STREQ("secret_value", get_value);
+    free(get_value);
+    ASSERT_EQ(0, kv_store_warm_persist(warm));
+    kv_client_free(warm);
+    content = read_file(path);
+    ASSERT_EQ(std::string::npos, content.find("secret_value"));
+    ASSERT_EQ(std::string::npos, content.find("warm_test"));
+    warm = get_warm_client(path, key, true);
+    ASSERT_NE(warm, nullptr);
+    handle = warm->init(warm);
+    ASSERT_NE(handle, nullptr);
+    ASSERT_TRUE(kv_store_warm_started(warm));
+    get_value = warm->get(handle, (char*) "/warm_test/private_key");
+    ASSERT_STREQ("secret_value", get_value);
+    free(get_value);
+    kv_client_free(warm);
+    key[0] ^= 0x1;
+    warm = get_warm_client(path, key, false);
+    ASSERT_NE(warm, nullptr);
+    ASSERT_NE(nullptr, warm->init(warm));
+    ASSERT_FALSE(kv_store_warm_started(warm));
+    kv_client_free(warm);
+
+    kv_client_free(writer);
+    unlink(path.c_str());
+    unlink((path + ".tmp").c_str());
+}
+
+TEST(KVStoreClientTest, fault_injection){
+    std::cout << "Test Case: fault_injection()\n";
+    kv_fault_config_t fault_config;
+    ASSERT_EQ(0, kv_store_fault_parse("get:error=1;put:latency=fixed:20000;seed=7", &fault_config));
+    ASSERT_EQ(1.0, fault_config.ops[KV_OP_GET].error_rate);
+    ASSERT_EQ(KV_FAULT_LATENCY_FIXED, fault_config.ops[KV_OP_PUT].latency);
+    ASSERT_EQ(20000, fault_config.ops[KV_OP_PUT].min_us);
+    ASSERT_EQ(7, fault_config.seed);
+    ASSERT_EQ(-1, kv_store_fault_parse("get:latency=gauss:10", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("get:latency=fixed:10us", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("delete:error=1", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("get:error=abc", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("get:error=0.5x", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("get:error=1.5", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("get:error=", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("watch:compact=-0.1", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("watch:reconnect=-1", &fault_config));
+    ASSERT_EQ(-1, kv_store_fault_parse("seed=7x", &fault_config));
+    ASSERT_EQ(0, kv_store_fault_parse("watch:drop=0.25,reconnect=1000", &fault_config));
+    ASSERT_EQ(0.25, fault_config.ops[KV_OP_WATCH_EVENT].error_rate);
+    ASSERT_EQ(1000, fault_config.watch_reconnect_us);
+
+    ASSERT_EQ(0, kv_store_fault_parse("get:error=1;put:latency=fixed:20000;seed=7", &fault_config));
+    kv_store_client_t *kv_store_client = kv_store_fault_wrap(get_kv_store_client(), &fault_config);
+    ASSERT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status = kv_store_client->put(handle, "/fault_test", "fault_1234");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ASSERT_EQ(0, status);
+    int64_t elapsed_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+    ASSERT_GE(elapsed_us, 20000);
+
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(nullptr, kv_store_client->get(handle, "/fault_test"));
+    }
+
+    kv_fault_stats_t stats;
+    ASSERT_EQ(0, kv_store_fault_stats(kv_store_client, &stats));
+    ASSERT_EQ(5, stats.injected_errors[KV_OP_GET]);
+    ASSERT_EQ(0, stats.injected_errors[KV_OP_PUT]);
+    ASSERT_EQ(20000, stats.injected_delay_us[KV_OP_PUT]);
+
+    // Clearing the faults lets requests through again
+    memset(&fault_config, 0, sizeof(fault_config));
+    ASSERT_EQ(0, kv_store_fault_configure(kv_store_client, &fault_config));
+    char *get_value = kv_store_client->get(handle, "/fault_test");
+    ASSERT_STREQ("fault_1234", get_value);
+    free(get_value);
+
+    kv_client_free(kv_store_client);
+}
+
+TEST(KVStoreClientTest, fault_watch){
+    std::cout << "Test Case: fault_watch()\n";
+    kv_fault_config_t fault_config;
+    memset(&fault_config, 0, sizeof(fault_config));
+    kv_store_client_t *kv_store_client = kv_store_fault_wrap(get_kv_store_client(), &fault_config);
+    ASSERT_NE(kv_store_client, nullptr);
+    void *handle = kv_store_client->init(kv_store_client);
+    ASSERT_NE(handle, nullptr);
+
+    fault_watch_values.clear();
+    kv_store_client->watch(handle, "/fault_watch", fault_watch_callback, NULL);
+    ASSERT_TRUE(sync_fault_watch(kv_store_client, handle, "/fault_watch"));
+
+    // The first event breaks the stream, which stays down and loses every
+    // event until it reconnects
+    ASSERT_EQ(0, kv_store_fault_parse("watch:drop=1,reconnect=60000000", &fault_config));
+    ASSERT_EQ(0, kv_store_fault_configure(kv_store_client, &fault_config));
+    kv_store_client->put(handle, "/fault_watch", "dropped_1");
+    kv_store_client->put(handle, "/fault_watch", "dropped_2");
+    ASSERT_TRUE(wait_fault_stats(kv_store_client, [](const kv_fault_stats_t& stats) {
+        return stats.dropped_events == 2; }));
+    kv_fault_stats_t stats;
+    ASSERT_EQ(0, kv_store_fault_stats(kv_store_client, &stats));
+    ASSERT_EQ(1, stats.stream_drops);
+    ASSERT_EQ(0, stats.reconnects);
+    ASSERT_TRUE(fault_watch_values.empty());
+
+    // Reconnecting resyncs the latest value
+    ASSERT_EQ(1, kv_store_fault_reconnect(kv_store_client));
+    ASSERT_EQ(1, fault_watch_values.size());
+    ASSERT_EQ("dropped_2", fault_watch_last());
+    ASSERT_EQ(0, kv_store_fault_reconnect(kv_store_client));
+
+    // Streams reconnect by themselves once the outage is over
+    ASSERT_EQ(0, kv_store_fault_parse("watch:drop=1,reconnect=50000", &fault_config));
+    ASSERT_EQ(0, kv_store_fault_configure(kv_store_client, &fault_config));
+    kv_store_client->put(handle, "/fault_watch", "reconnected");
+    ASSERT_TRUE(wait_fault_watch(2));
+    ASSERT_EQ("reconnected", fault_watch_last());
+
+    // Compacted events are lost but the latest value is re-read and delivered
+    ASSERT_EQ(0, kv_store_fault_parse("watch:compact=1", &fault_config));
+    ASSERT_EQ(0, kv_store_fault_configure(kv_store_client, &fault_config));
+    kv_store_client->put(handle, "/fault_watch", "resynced");
+    ASSERT_TRUE(wait_fault_watch(3));
+    ASSERT_EQ("resynced", fault_watch_last());
+
+    ASSERT_EQ(0, kv_store_fault_stats(kv_store_client, &stats));
+    ASSERT_EQ(3, stats.dropped_events);
+    ASSERT_EQ(2, stats.stream_drops);
+    ASSERT_EQ(2, stats.reconnects);
+    ASSERT_EQ(1, stats.compactions);
+
+    kv_client_free(kv_store_client);
+}
+
+static int channel_watch_cb = 0;
+static std::string channel_watch_value;
+
+void channel_watch_callback(const char* key, config_t* value, void *user_data){
+    config_value_t* val = value->get_config_value(value->cfg, key);
+    if (val != NULL) {
+        channel_watch_value = val->body.string;
+        config_value_destroy(val);
+    }
+    channel_watch_cb++;
+    config_destroy(value);
+}
+
+TEST(KVStoreClientTest, in_process_channel){
+    std::cout << "Test Case: in_process_channel()\n";
+    if (fake_etcd == NULL) {
+        std::cout << "Skipped, needs the in-process fake etcd server\n";
+        return;
+    }
+    EtcdClient* etcd_cli = new EtcdClient(fake_etcd->in_process_channel());
+
+    std::string key = "/channel_test";
+    std::string value = "channel_1234";
+    ASSERT_EQ(0, etcd_cli->put(key, value));
+    key = "/channel_test";
+    ASSERT_EQ("channel_1234", etcd_cli->get(key));
+
+    key = "/channel_watch";
+    etcd_cli->watch(key, channel_watch_callback, NULL);
+    sleep(1);
+    key = "/channel_watch";
+    value = "before_drop";
+    ASSERT_EQ(0, etcd_cli->put(key, value));
+    sleep(1);
+    ASSERT_EQ(1, channel_watch_cb);
+
+    // Updates made while the stream is down are delivered once it is
+    // re-opened, from the revision following the last event
+    fake_etcd->drop_streams();
+    key = "/channel_watch";
+    value = "after_drop";
+    ASSERT_EQ(0, etcd_cli->put(key, value));
+    sleep(1);
+    ASSERT_EQ(2, channel_watch_cb);
+    ASSERT_EQ("after_drop", channel_watch_value);
+
+    delete etcd_cli;
+}
+
 int main(int argc, char **argv) {
 
     testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new FakeEtcdEnvironment());
     return RUN_ALL_TESTS();
 
 }
@@ -0,0 +1,113 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief cfgmgr-agent: serves the kv_store to the applications of a node
+ *
+ * Holds one etcd client for every application of the node, which select it
+ * with KVStore=agent. Configured like an application, through the AppName,
+ * DEV_MODE, ETCD_HOST, ETCD_CLIENT_PORT and CONFIGMGR_CERT, CONFIGMGR_KEY
+ * and CONFIGMGR_CACERT envs. Listens on the path given as argument,
+ * CONFIGMGR_AGENT_SOCKET or /run/eii/cfgmgr-agent.sock. In prod mode only
+ * /GlobalEnv/ and /Publickeys/ are served, the applications read their own
+ * keys and write with their own certificates.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <strings.h>
+#include <eii/utils/logger.h>
+#include <eii/config_manager/cfgmgr.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_protocol.h>
+#include <eii/config_manager/kv_store_plugin/agent_client/agent_server.h>
+
+int main(int argc, char** argv) {
+    config_t* kv_store_config = NULL;
+    kv_store_client_t* kv_store_client = NULL;
+    agent_server_t* server = NULL;
+    config_value_t* type = NULL;
+    sigset_t signals;
+    int sig;
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [socket path]\n", argv[0]);
+        return 1;
+    }
+    const char* socket_path = getenv("CONFIGMGR_AGENT_SOCKET");
+    if (argc == 2) {
+        socket_path = argv[1];
+    } else if (socket_path == NULL || socket_path[0] == '\0') {
+        socket_path = AGENT_DEFAULT_SOCKET;
+    }
+
+    // Handled by sigwait() below, blocked before any thread is started
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    kv_store_config = create_kv_store_config();
+    if (kv_store_config == NULL) {
+        LOG_ERROR_0("kv_store_config initialization failed");
+        goto err;
+    }
+    // The agent itself always talks to etcd, whatever KVStore says
+    type = config_value_new_string("etcd");
+    if (type == NULL || !config_set(kv_store_config, "type", type)) {
+        LOG_ERROR_0("Unable to set config value");
+        goto err;
+    }
+    kv_store_client = create_kv_client(kv_store_config);
+    if (kv_store_client == NULL) {
+        LOG_ERROR_0("kv_store_client is NULL");
+        goto err;
+    }
+
+    // DEV_MODE defaults to true, like create_kv_store_config() does
+    const char* dev_mode_env = getenv("DEV_MODE");
+    bool dev_mode = dev_mode_env == NULL || dev_mode_env[0] == '\0' ||
+                    strcasecmp(dev_mode_env, "true") == 0;
+    server = agent_server_start(kv_store_client, socket_path, dev_mode);
+    kv_store_client = NULL;
+    if (server == NULL) {
+        goto err;
+    }
+    sigwait(&signals, &sig);
+    LOG_INFO("Received signal %d, stopping", sig);
+    agent_server_stop(server);
+
+    config_value_destroy(type);
+    config_destroy(kv_store_config);
+    return 0;
+
+err:
+    if (kv_store_client != NULL) {
+        kv_client_free(kv_store_client);
+    }
+    if (type != NULL) {
+        config_value_destroy(type);
+    }
+    if (kv_store_config != NULL) {
+        config_destroy(kv_store_config);
+    }
+    return 1;
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2021 Intel Corporation.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/**
+ * @file
+ * @brief cfgmgr-bake: resolves the msgbus configs of applications offline
+ *
+ * Connects to the kv_store once, like an application configured through the
+ * DEV_MODE, ETCD_HOST, ETCD_CLIENT_PORT and CONFIGMGR_CERT, CONFIGMGR_KEY and
+ * CONFIGMGR_CACERT envs, and writes the keys and the msgbus configs of the
+ * applications named, of the AppName env, or of every application with
+ * --all, to the bundle file given as first argument. Applications started
+ * with CONFIGMGR_BUNDLE naming that file read nothing from the kv_store.
+ *
+ * Bundles are encrypted with the key of CONFIGMGR_BUNDLE_KEY_FILE if set. In
+ * prod mode the key is required and the first argument is a directory: each
+ * application gets its own bundle, <AppName>.bundle, holding only its own
+ * private key.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <eii/utils/logger.h>
+#include <eii/utils/string.h>
+#include <eii/config_manager/cfgmgr.h>
+#include <eii/config_manager/cfgmgr_bundle.h>
+
+int main(int argc, char** argv) {
+    config_t* kv_store_config = NULL;
+    kv_store_client_t* kv_store_client = NULL;
+    cfgmgr_bundle_t* bundle = NULL;
+    cfgmgr_bundle_t* app_bundle = NULL;
+    char* app_path = NULL;
+    unsigned char key[CFGMGR_SEAL_KEY_SIZE];
+    bool encrypted = false;
+    const char* const* app_names = NULL;
+    const char* app_name_env = NULL;
+    size_t count = 0;
+    char dev_mode_var[MAX_MODE_LENGTH] = "";
+    int ret_val = 1;
+
+    if (argc < 2 || (argc > 3 && strcmp(argv[2], "--all") == 0)) {
+        fprintf(stderr, "usage: %s <bundle file | prod mode directory> [--all | AppName...]\n",
+                argv[0]);
+        return 1;
+    }
+    if (argc > 2 && strcmp(argv[2], "--all") != 0) {
+        app_names = (const char* const*) &argv[2];
+        count = (size_t) (argc - 2);
+    } else if (argc == 2) {
+        app_name_env = getenv("AppName");
+        if (app_name_env == NULL || app_name_env[0] == '\0') {
+            fprintf(stderr, "%s: no AppName given and AppName env not set\n", argv[0]);
+            return 1;
+        }
+        app_names = &app_name_env;
+        count = 1;
+    }
+
+    char* dev_mode_env = getenv("DEV_MODE");
+    if (dev_mode_env == NULL) {
+        LOG_ERROR_0("DEV_MODE variable not set");
+        goto err;
+    }
+    if (strncpy_s(dev_mode_var, MAX_MODE_LENGTH, dev_mode_env, MAX_MODE_LENGTH - 1) != 0) {
+        LOG_ERROR_0("Failed to copy DEV_MODE env value");
+        goto err;
+    }
+    to_lower(dev_mode_var);
+    bool dev_mode = strcmp(dev_mode_var, "true") == 0;
+
+    char* key_file = getenv("CONFIGMGR_BUNDLE_KEY_FILE");
+    if (key_file != NULL && strlen(key_file) != 0) {
+        if (cfgmgr_seal_read_key(key_file, key) != 0) {
+            goto err;
+        }
+        encrypted = true;
+    } else if (!dev_mode) {
+        LOG_ERROR_0("CONFIGMGR_BUNDLE_KEY_FILE must be set in prod mode");
+        goto err;
+    }
+
+    kv_store_config = create_kv_store_config();
+    if (kv_store_config == NULL) {
+        LOG_ERROR_0("kv_store_config initialization failed");
+        goto err;
+    }
+    kv_store_client = create_kv_client(kv_store_config);
+    if (kv_store_client == NULL) {
+        LOG_ERROR_0("kv_store_client is NULL");
+        goto err;
+    }
+    void* handle = kv_store_client->init(kv_store_client);
+    if (handle == NULL) {
+        LOG_ERROR_0("kv_store_client initialization failed");
+        goto err;
+    }
+
+    bundle = cfgmgr_bundle_bake(kv_store_client, handle, dev_mode, app_names, count);
+    if (bundle == NULL) {
+        LOG_ERROR_0("Failed to bake the bundle");
+        goto err;
+    }
+    if (dev_mode) {
+        if (cfgmgr_bundle_write(bundle, argv[1], encrypted ? key : NULL) != 0) {
+            LOG_ERROR("Failed to write the bundle to %s", argv[1]);
+            goto err;
+        }
+        LOG_INFO("Baked %zu applications into %s", cfgmgr_bundle_app_count(bundle), argv[1]);
+    }
+    // One bundle per application, so that each holds its own private key only
+    for (size_t i = 0; !dev_mode && i < cfgmgr_bundle_app_count(bundle); i++) {
+        const char* app_name = cfgmgr_bundle_app_name(bundle, i);
+        size_t path_len = strlen(argv[1]) + strlen("/") + strlen(app_name) +
+                          strlen(".bundle") + 1;
+        app_path = concat_s(path_len, 4, argv[1], "/", app_name, ".bundle");
+        if (app_path == NULL) {
+            LOG_ERROR("Concatenation of the bundle path of %s failed", app_name);
+            goto err;
+        }
+        app_bundle = cfgmgr_bundle_app(bundle, app_name);
+        if (app_bundle == NULL || cfgmgr_bundle_write(app_bundle, app_path, key) != 0) {
+            LOG_ERROR("Failed to write the bundle of %s to %s", app_name, app_path);
+            goto err;
+        }
+        LOG_INFO("Baked %s into %s", app_name, app_path);
+        cfgmgr_bundle_destroy(app_bundle);
+        app_bundle = NULL;
+        free(app_path);
+        app_path = NULL;
+    }
+
+    // We should add all success-path code above this line
+    ret_val = 0;
+
+err:
+    cfgmgr_seal_clear_key(key);
+    free(app_path);
+    if (app_bundle != NULL) {
+        cfgmgr_bundle_destroy(app_bundle);
+    }
+    if (bundle != NULL) {
+        cfgmgr_bundle_destroy(bundle);
+    }
+    if (kv_store_client != NULL) {
+        kv_client_free(kv_store_client);
+    }
+    if (kv_store_config != NULL) {
+        config_destroy(kv_store_config);
+    }
+    return ret_val;
+}